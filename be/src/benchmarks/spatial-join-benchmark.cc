@@ -0,0 +1,448 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include <stdlib.h>
+#include <vector>
+
+#include "common/logging.h"
+#include "runtime/spatial-grid.h"
+#include "runtime/spatial-value.h"
+#include "udf/udf-test-harness.h"
+#include "udf_samples/uda-sample.h"
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+#include "util/spatial-kernels.h"
+
+using namespace impala;
+using namespace std;
+
+// Benchmark for joining two sets of rectangles on MBR intersection, i.e. counting the
+// pairs (r, s) with r.Intersects(s). It compares the kernels an operator could use:
+//   Overlapped UDA:   the OverlappedUpdate/Merge/Finalize aggregate function in
+//                     udf_samples, which collects both sets into one buffer and plane
+//                     sweeps them in Finalize(). The rows are updated into
+//                     NUM_UDA_PARTIALS intermediate values that are then merged, as
+//                     they would be by the pre-aggregation and merge fragments.
+//   Sweep:            sort both sets on x1 and plane sweep them.
+//   Sweep (batched):  the same sweep, but the candidates of each rectangle are tested
+//                     with SpatialKernels::Intersects(), as in SpatialJoinNode.
+//   Grid:             assign the rectangles to the cells of a uniform SpatialGrid they
+//                     overlap, plane sweep each cell, and only count a pair in its
+//                     reference cell, as in SpatialJoinNode.
+//   R-tree:           bulk load an R-tree over one set with Sort-Tile-Recursive
+//                     packing and query it with each rectangle of the other set.
+// Each iteration is a whole join, including the sorting or index building.
+//
+// The rectangles are generated in [0, DOMAIN_SIZE)^2 in three distributions:
+//   uniform:    centers uniformly distributed.
+//   clustered:  centers normally distributed around NUM_CLUSTERS random centers.
+//   skewed:     center coordinates DOMAIN_SIZE * u^2 for uniform u, so that the density
+//               grows towards the origin.
+// The sides are uniform in [0, 2 * DOMAIN_SIZE / sqrt(n)), so that a rectangle of a
+// uniform set intersects about 4 rectangles of the other set for any set size n.
+//
+// The set sizes run from 10^5 up to the optional command line argument, 10^6 by
+// default. Two sets of 10^8 rectangles take about 6.4GB. The UDA keeps all rectangles
+// in a single StringVal, whose length is limited to 2GB, so it is only run for sets of
+// up to MAX_UDA_RECTS rectangles. The first benchmark of each suite is the baseline.
+
+#define VALIDATE 1
+
+const double DOMAIN_SIZE = 1000000;
+const int NUM_CLUSTERS = 100;
+const int NUM_UDA_PARTIALS = 4;
+const int64_t MAX_UDA_RECTS = 10 * 1000 * 1000;
+
+// Number of entries of an R-tree node.
+const int RTREE_FANOUT = 16;
+
+// Average number of rectangles of one set per grid cell.
+const int RECTS_PER_CELL = 16;
+
+enum Distribution {
+  UNIFORM,
+  CLUSTERED,
+  SKEWED,
+};
+
+struct TestData {
+  vector<RectangleValue> r;
+  vector<RectangleValue> s;
+  int64_t result;
+};
+
+static double RandDouble() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+// Returns a normally distributed value with mean 0 and standard deviation 1, using the
+// Box-Muller transform.
+static double RandNormal() {
+  double u = 1 - RandDouble();
+  double v = RandDouble();
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static void GenerateRects(Distribution distribution, int64_t n,
+    vector<RectangleValue>* rects) {
+  vector<PointValue> clusters;
+  for (int i = 0; i < NUM_CLUSTERS; ++i) {
+    clusters.push_back(
+        PointValue(RandDouble() * DOMAIN_SIZE, RandDouble() * DOMAIN_SIZE));
+  }
+  double max_side = 2 * DOMAIN_SIZE / sqrt(static_cast<double>(n));
+  rects->resize(n);
+  for (int64_t i = 0; i < n; ++i) {
+    PointValue center;
+    switch (distribution) {
+      case UNIFORM:
+        center = PointValue(RandDouble() * DOMAIN_SIZE, RandDouble() * DOMAIN_SIZE);
+        break;
+      case CLUSTERED: {
+        const PointValue& cluster = clusters[rand() % NUM_CLUSTERS];
+        double sigma = DOMAIN_SIZE / NUM_CLUSTERS;
+        center = PointValue(cluster.x + RandNormal() * sigma,
+            cluster.y + RandNormal() * sigma);
+        break;
+      }
+      case SKEWED: {
+        double u = RandDouble();
+        double v = RandDouble();
+        center = PointValue(DOMAIN_SIZE * u * u, DOMAIN_SIZE * v * v);
+        break;
+      }
+    }
+    double width = RandDouble() * max_side;
+    double height = RandDouble() * max_side;
+    (*rects)[i] = RectangleValue(center.x - width / 2, center.y - height / 2,
+        center.x + width / 2, center.y + height / 2);
+  }
+}
+
+static bool X1Less(const RectangleValue& a, const RectangleValue& b) {
+  return a.x1 < b.x1;
+}
+
+void TestOverlappedUda(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  FunctionContext::TypeDesc return_type;
+  return_type.type = FunctionContext::TYPE_STRING;
+  vector<FunctionContext::TypeDesc> arg_types(2);
+  arg_types[0].type = FunctionContext::TYPE_RECTANGLE;
+  arg_types[1].type = FunctionContext::TYPE_INT;
+  for (int i = 0; i < batch_size; ++i) {
+    // The UDA never frees its intermediate buffers, so use a new context, which owns
+    // them, for every join.
+    FunctionContext* ctx = UdfTestHarness::CreateTestContext(return_type, arg_types);
+    StringVal partials[NUM_UDA_PARTIALS];
+    for (int j = 0; j < NUM_UDA_PARTIALS; ++j) {
+      OverlappedInit(ctx, &partials[j]);
+    }
+    for (int set = 1; set <= 2; ++set) {
+      const vector<RectangleValue>& rects = set == 1 ? data->r : data->s;
+      for (int64_t j = 0; j < rects.size(); ++j) {
+        const RectangleValue& r = rects[j];
+        OverlappedUpdate(ctx, RectangleVal(r.x1, r.y1, r.x2, r.y2), IntVal(set),
+            &partials[j % NUM_UDA_PARTIALS]);
+      }
+    }
+    StringVal merged;
+    OverlappedInit(ctx, &merged);
+    for (int j = 0; j < NUM_UDA_PARTIALS; ++j) {
+      OverlappedMerge(ctx, partials[j], &merged);
+    }
+    StringVal result = OverlappedFinalize(ctx, merged);
+    string count(reinterpret_cast<char*>(result.ptr), result.len);
+    data->result = strtoll(count.c_str(), NULL, 10);
+    UdfTestHarness::CloseContext(ctx);
+    delete ctx;
+  }
+}
+
+// Plane sweep of 'r' and 's', which are sorted on x1. Only pairs whose reference point
+// lies in cell 'cell' of 'grid' are counted, unless 'grid' is NULL.
+static int64_t Sweep(const vector<RectangleValue>& r, const vector<RectangleValue>& s,
+    const SpatialGrid* grid, int cell) {
+  int64_t count = 0;
+  int i = 0;
+  int j = 0;
+  while (i < r.size() && j < s.size()) {
+    if (r[i].x1 < s[j].x1) {
+      for (int k = j; k < s.size() && s[k].x1 < r[i].x2; ++k) {
+        if (!r[i].Intersects(s[k])) continue;
+        if (grid == NULL || grid->GetReferenceCell(r[i], s[k]) == cell) ++count;
+      }
+      ++i;
+    } else {
+      for (int k = i; k < r.size() && r[k].x1 < s[j].x2; ++k) {
+        if (!s[j].Intersects(r[k])) continue;
+        if (grid == NULL || grid->GetReferenceCell(r[k], s[j]) == cell) ++count;
+      }
+      ++j;
+    }
+  }
+  return count;
+}
+
+void TestSweep(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    vector<RectangleValue> r(data->r);
+    vector<RectangleValue> s(data->s);
+    sort(r.begin(), r.end(), X1Less);
+    sort(s.begin(), s.end(), X1Less);
+    data->result = Sweep(r, s, NULL, 0);
+  }
+}
+
+// The coordinates of sorted rectangles as separate columns, for SpatialKernels.
+struct RectColumns {
+  vector<double> x1;
+  vector<double> y1;
+  vector<double> x2;
+  vector<double> y2;
+
+  RectColumns(const vector<RectangleValue>& rects) {
+    for (int i = 0; i < rects.size(); ++i) {
+      x1.push_back(rects[i].x1);
+      y1.push_back(rects[i].y1);
+      x2.push_back(rects[i].x2);
+      y2.push_back(rects[i].y2);
+    }
+  }
+};
+
+// Counts the rectangles in [begin, n) of 'cols' with x1 < r.x2 that intersect 'r'.
+static int SweepBatched(const RectangleValue& r, const RectColumns& cols, int begin,
+    vector<int>* matches) {
+  int end = begin;
+  while (end < cols.x1.size() && cols.x1[end] < r.x2) ++end;
+  if (end == begin) return 0;
+  return SpatialKernels::Intersects(r, &cols.x1[begin], &cols.y1[begin],
+      &cols.x2[begin], &cols.y2[begin], end - begin, &(*matches)[0]);
+}
+
+void TestSweepBatched(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    vector<RectangleValue> r(data->r);
+    vector<RectangleValue> s(data->s);
+    sort(r.begin(), r.end(), X1Less);
+    sort(s.begin(), s.end(), X1Less);
+    RectColumns r_cols(r);
+    RectColumns s_cols(s);
+    vector<int> matches(max(r.size(), s.size()));
+    int64_t count = 0;
+    int ri = 0;
+    int si = 0;
+    while (ri < r.size() && si < s.size()) {
+      if (r[ri].x1 < s[si].x1) {
+        count += SweepBatched(r[ri++], s_cols, si, &matches);
+      } else {
+        count += SweepBatched(s[si++], r_cols, ri, &matches);
+      }
+    }
+    data->result = count;
+  }
+}
+
+// Appends each rectangle of 'rects' to the cells of 'grid' that it overlaps.
+static void AssignCells(const SpatialGrid& grid, const vector<RectangleValue>& rects,
+    vector<vector<RectangleValue> >* cells) {
+  vector<int> overlapped_cells;
+  for (int i = 0; i < rects.size(); ++i) {
+    overlapped_cells.clear();
+    grid.GetOverlappedCells(rects[i], &overlapped_cells);
+    for (int j = 0; j < overlapped_cells.size(); ++j) {
+      (*cells)[overlapped_cells[j]].push_back(rects[i]);
+    }
+  }
+}
+
+void TestGrid(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  TSpatialGrid tgrid;
+  tgrid.x1 = 0;
+  tgrid.y1 = 0;
+  tgrid.x2 = DOMAIN_SIZE;
+  tgrid.y2 = DOMAIN_SIZE;
+  double num_cells = data->r.size() / static_cast<double>(RECTS_PER_CELL);
+  tgrid.num_cols = max(1, static_cast<int>(sqrt(num_cells)));
+  tgrid.num_rows = tgrid.num_cols;
+  SpatialGrid grid(tgrid);
+  for (int i = 0; i < batch_size; ++i) {
+    vector<vector<RectangleValue> > r_cells(grid.num_cells());
+    vector<vector<RectangleValue> > s_cells(grid.num_cells());
+    AssignCells(grid, data->r, &r_cells);
+    AssignCells(grid, data->s, &s_cells);
+    int64_t count = 0;
+    for (int cell = 0; cell < grid.num_cells(); ++cell) {
+      sort(r_cells[cell].begin(), r_cells[cell].end(), X1Less);
+      sort(s_cells[cell].begin(), s_cells[cell].end(), X1Less);
+      count += Sweep(r_cells[cell], s_cells[cell], &grid, cell);
+    }
+    data->result = count;
+  }
+}
+
+// A read-only R-tree over a set of rectangles. The leaves are packed with
+// Sort-Tile-Recursive: the rectangles are sorted on the x coordinate of their center,
+// cut into vertical slices of about sqrt(#leaves) leaves each, and each slice is sorted
+// on y and cut into leaves of RTREE_FANOUT rectangles. The upper levels group
+// RTREE_FANOUT consecutive nodes of the level below.
+class RTree {
+ public:
+  RTree(const vector<RectangleValue>& rects) : rects_(rects) {
+    int64_t n = rects_.size();
+    sort(rects_.begin(), rects_.end(), CenterXLess);
+    int64_t num_leaves = (n + RTREE_FANOUT - 1) / RTREE_FANOUT;
+    int64_t slice_size =
+        RTREE_FANOUT * static_cast<int64_t>(ceil(sqrt(static_cast<double>(num_leaves))));
+    for (int64_t i = 0; i < n; i += slice_size) {
+      sort(rects_.begin() + i, rects_.begin() + min(n, i + slice_size), CenterYLess);
+    }
+
+    // Build the leaves, then each level above from the one below, until there is a
+    // single root. Node i of a level has the children [first_child, end_child) of the
+    // level below, or of rects_ for the leaves.
+    levels_.push_back(vector<Node>());
+    for (int64_t i = 0; i < n; i += RTREE_FANOUT) {
+      levels_.back().push_back(MakeNode(rects_, i, min(n, i + RTREE_FANOUT)));
+    }
+    while (levels_.back().size() > 1) {
+      const vector<Node>& children = levels_.back();
+      vector<Node> level;
+      for (int64_t i = 0; i < children.size(); i += RTREE_FANOUT) {
+        int64_t end = min<int64_t>(children.size(), i + RTREE_FANOUT);
+        Node node;
+        node.mbr = children[i].mbr;
+        node.first_child = i;
+        node.end_child = end;
+        for (int64_t j = i + 1; j < end; ++j) node.mbr.Expand(children[j].mbr);
+        level.push_back(node);
+      }
+      levels_.push_back(level);
+    }
+  }
+
+  // Returns the number of rectangles that intersect 'r'.
+  int64_t CountIntersecting(const RectangleValue& r) const {
+    if (rects_.empty()) return 0;
+    return CountIntersecting(r, levels_.size() - 1, 0);
+  }
+
+ private:
+  struct Node {
+    RectangleValue mbr;
+    int64_t first_child;
+    int64_t end_child;
+  };
+
+  static bool CenterXLess(const RectangleValue& a, const RectangleValue& b) {
+    return a.x1 + a.x2 < b.x1 + b.x2;
+  }
+
+  static bool CenterYLess(const RectangleValue& a, const RectangleValue& b) {
+    return a.y1 + a.y2 < b.y1 + b.y2;
+  }
+
+  static Node MakeNode(const vector<RectangleValue>& rects, int64_t begin, int64_t end) {
+    Node node;
+    node.mbr = rects[begin];
+    node.first_child = begin;
+    node.end_child = end;
+    for (int64_t i = begin + 1; i < end; ++i) node.mbr.Expand(rects[i]);
+    return node;
+  }
+
+  // A rectangle that intersects a child also intersects the node's MBR, which contains
+  // the child, so the MBR test doesn't lose any matches.
+  int64_t CountIntersecting(const RectangleValue& r, int level, int64_t idx) const {
+    const Node& node = levels_[level][idx];
+    if (!r.Intersects(node.mbr)) return 0;
+    int64_t count = 0;
+    for (int64_t i = node.first_child; i < node.end_child; ++i) {
+      if (level == 0) {
+        if (r.Intersects(rects_[i])) ++count;
+      } else {
+        count += CountIntersecting(r, level - 1, i);
+      }
+    }
+    return count;
+  }
+
+  vector<RectangleValue> rects_;
+
+  // levels_[0] are the leaves, levels_.back() has the root as its only node.
+  vector<vector<Node> > levels_;
+};
+
+void TestRTree(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    RTree tree(data->s);
+    int64_t count = 0;
+    for (int64_t j = 0; j < data->r.size(); ++j) {
+      count += tree.CountIntersecting(data->r[j]);
+    }
+    data->result = count;
+  }
+}
+
+int main(int argc, char **argv) {
+  CpuInfo::Init();
+  cout << Benchmark::GetMachineInfo() << endl;
+
+  int64_t max_rects = argc > 1 ? atoll(argv[1]) : 1000 * 1000;
+  const char* distribution_names[] = { "uniform", "clustered", "skewed" };
+  for (int64_t n = 100 * 1000; n <= max_rects; n *= 10) {
+    for (int distribution = UNIFORM; distribution <= SKEWED; ++distribution) {
+      TestData data;
+      srand(0);
+      GenerateRects(static_cast<Distribution>(distribution), n, &data.r);
+      GenerateRects(static_cast<Distribution>(distribution), n, &data.s);
+
+      bool run_uda = n <= MAX_UDA_RECTS;
+#if VALIDATE
+      TestSweep(1, &data);
+      int64_t expected = data.result;
+      if (run_uda) {
+        TestOverlappedUda(1, &data);
+        CHECK_EQ(data.result, expected);
+      }
+      TestSweepBatched(1, &data);
+      CHECK_EQ(data.result, expected);
+      TestGrid(1, &data);
+      CHECK_EQ(data.result, expected);
+      TestRTree(1, &data);
+      CHECK_EQ(data.result, expected);
+#endif
+
+      stringstream name;
+      name << distribution_names[distribution] << " n=" << n;
+      Benchmark suite(name.str(), 1);
+      if (run_uda) suite.AddBenchmark("Overlapped UDA", TestOverlappedUda, &data);
+      suite.AddBenchmark("Sweep", TestSweep, &data);
+      suite.AddBenchmark("Sweep (batched)", TestSweepBatched, &data);
+      suite.AddBenchmark("Grid", TestGrid, &data);
+      suite.AddBenchmark("R-tree", TestRTree, &data);
+      cout << suite.Measure() << endl;
+    }
+  }
+  return 0;
+}
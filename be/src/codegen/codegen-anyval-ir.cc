@@ -44,6 +44,18 @@ bool TimestampValueEq(const TimestampVal& x, const TimestampValue& y) {
   return tv == y;
 }
 
+// Used by CodegenAnyVal::Compare()
+
+int StringValCompare(const StringVal& x, const StringVal& y) {
+  return StringValue::FromStringVal(x).Compare(StringValue::FromStringVal(y));
+}
+
+int TimestampValCompare(const TimestampVal& x, const TimestampVal& y) {
+  TimestampValue tx = TimestampValue::FromTimestampVal(x);
+  TimestampValue ty = TimestampValue::FromTimestampVal(y);
+  return tx > ty ? 1 : (tx < ty ? -1 : 0);
+}
+
 #else
 #error "This file should only be used for cross compiling to IR."
 #endif
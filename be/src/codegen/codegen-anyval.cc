@@ -29,6 +29,8 @@ const char* CodegenAnyVal::LLVM_DOUBLEVAL_NAME    = "struct.impala_udf::DoubleVa
 const char* CodegenAnyVal::LLVM_STRINGVAL_NAME    = "struct.impala_udf::StringVal";
 const char* CodegenAnyVal::LLVM_TIMESTAMPVAL_NAME = "struct.impala_udf::TimestampVal";
 const char* CodegenAnyVal::LLVM_DECIMALVAL_NAME   = "struct.impala_udf::DecimalVal";
+const char* CodegenAnyVal::LLVM_POINTVAL_NAME     = "struct.impala_udf::PointVal";
+const char* CodegenAnyVal::LLVM_RECTANGLEVAL_NAME = "struct.impala_udf::RectangleVal";
 
 Type* CodegenAnyVal::GetLoweredType(LlvmCodeGen* cg, const ColumnType& type) {
   switch(type.type) {
@@ -55,6 +57,12 @@ Type* CodegenAnyVal::GetLoweredType(LlvmCodeGen* cg, const ColumnType& type) {
     case TYPE_DECIMAL: // %"struct.impala_udf::DecimalVal" (isn't lowered)
                        // = { {i8}, [15 x i8], {i128} }
       return cg->GetType(LLVM_DECIMALVAL_NAME);
+    case TYPE_POINT: // %"struct.impala_udf::PointVal" (isn't lowered)
+                     // = { {i8}, double, double }
+      return cg->GetType(LLVM_POINTVAL_NAME);
+    case TYPE_RECTANGLE: // %"struct.impala_udf::RectangleVal" (isn't lowered)
+                         // = { {i8}, double, double, double, double }
+      return cg->GetType(LLVM_RECTANGLEVAL_NAME);
     default:
       DCHECK(false) << "Unsupported type: " << type;
       return NULL;
@@ -100,6 +108,12 @@ Type* CodegenAnyVal::GetUnloweredType(LlvmCodeGen* cg, const ColumnType& type) {
     case TYPE_DECIMAL:
       result = cg->GetType(LLVM_DECIMALVAL_NAME);
       break;
+    case TYPE_POINT:
+      result = cg->GetType(LLVM_POINTVAL_NAME);
+      break;
+    case TYPE_RECTANGLE:
+      result = cg->GetType(LLVM_RECTANGLEVAL_NAME);
+      break;
     default:
       DCHECK(false) << "Unsupported type: " << type;
       return NULL;
@@ -116,14 +130,16 @@ Value* CodegenAnyVal::CreateCall(
     LlvmCodeGen* cg, LlvmCodeGen::LlvmBuilder* builder, Function* fn,
     ArrayRef<Value*> args, const char* name, Value* result_ptr) {
   if (fn->getReturnType()->isVoidTy()) {
-    // Void return type indicates that this function returns a DecimalVal via the first
-    // argument (which should be a DecimalVal*).
+    // Void return type indicates that this function returns a DecimalVal, PointVal or
+    // RectangleVal via the first argument (which should be a pointer to that type).
     Function::arg_iterator ret_arg = fn->arg_begin();
     DCHECK(ret_arg->getType()->isPointerTy());
     Type* ret_type = ret_arg->getType()->getPointerElementType();
-    DCHECK_EQ(ret_type, cg->GetType(LLVM_DECIMALVAL_NAME));
+    DCHECK(ret_type == cg->GetType(LLVM_DECIMALVAL_NAME) ||
+           ret_type == cg->GetType(LLVM_POINTVAL_NAME) ||
+           ret_type == cg->GetType(LLVM_RECTANGLEVAL_NAME));
 
-    // We need to pass a DecimalVal pointer to 'fn' that will be populated with the result
+    // We need to pass a *Val pointer to 'fn' that will be populated with the result
     // value. Use 'result_ptr' if specified, otherwise alloca one.
     Value* ret_ptr = (result_ptr == NULL) ?
                      cg->CreateEntryBlockAlloca(*builder, ret_type, name) : result_ptr;
@@ -176,7 +192,9 @@ Value* CodegenAnyVal::GetIsNull(const char* name) {
       DCHECK(is_null_i8->getType() == codegen_->tinyint_type());
       return builder_->CreateTrunc(is_null_i8, codegen_->boolean_type(), name);
     }
-    case TYPE_DECIMAL: {
+    case TYPE_DECIMAL:
+    case TYPE_POINT:
+    case TYPE_RECTANGLE: {
       // Lowered type is of the form { {i8}, ... }
       uint32_t idxs[] = {0, 0};
       Value* is_null_i8 = builder_->CreateExtractValue(value_, idxs);
@@ -215,9 +233,10 @@ void CodegenAnyVal::SetIsNull(Value* is_null) {
       value_ = builder_->CreateInsertValue(value_, is_null_ext, 0, name_);
       break;
     }
-    case TYPE_DECIMAL: {
-      // Lowered type is of form { {i8}, [15 x i8], {i128} }. Set the i8 value to
-      // 'is_null'.
+    case TYPE_DECIMAL:
+    case TYPE_POINT:
+    case TYPE_RECTANGLE: {
+      // Lowered type is of form { {i8}, ... }. Set the i8 value to 'is_null'.
       Value* is_null_ext =
           builder_->CreateZExt(is_null, codegen_->tinyint_type(), "is_null_ext");
       // Index into the {i8} struct as well as the outer struct.
@@ -441,6 +460,23 @@ void CodegenAnyVal::SetDate(Value* date) {
   value_ = builder_->CreateInsertValue(value_, v, 0, name_);
 }
 
+Value* CodegenAnyVal::GetCoord(int idx) {
+  // Lowered type is of the form { {i8}, double, ... }. The coordinates follow the
+  // AnyVal struct.
+  DCHECK(type_.IsSpatialType());
+  DCHECK_GE(idx, 0);
+  DCHECK_LT(idx, type_.GetByteSize() / sizeof(double));
+  return builder_->CreateExtractValue(value_, idx + 1);
+}
+
+void CodegenAnyVal::SetCoord(int idx, Value* coord) {
+  DCHECK(type_.IsSpatialType());
+  DCHECK_GE(idx, 0);
+  DCHECK_LT(idx, type_.GetByteSize() / sizeof(double));
+  DCHECK(coord->getType()->isDoubleTy());
+  value_ = builder_->CreateInsertValue(value_, coord, idx + 1, name_);
+}
+
 Value* CodegenAnyVal::GetUnloweredPtr() {
   Value* value_ptr = codegen_->CreateEntryBlockAlloca(*builder_, value_->getType());
   builder_->CreateStore(value_, value_ptr);
@@ -486,6 +522,15 @@ void CodegenAnyVal::SetFromRawValue(Value* raw_val) {
       SetDate(date);
       break;
     }
+    case TYPE_POINT:
+    case TYPE_RECTANGLE: {
+      // Convert [n x double] to the coordinates of the PointVal/RectangleVal
+      int num_coords = type_.GetByteSize() / sizeof(double);
+      for (int i = 0; i < num_coords; ++i) {
+        SetCoord(i, builder_->CreateExtractValue(raw_val, i, "coord"));
+      }
+      break;
+    }
     case TYPE_BOOLEAN:
     case TYPE_TINYINT:
     case TYPE_SMALLINT:
@@ -525,6 +570,15 @@ Value* CodegenAnyVal::ToNativeValue() {
       raw_val = builder_->CreateInsertValue(raw_val, GetDate(), date_idxs);
       break;
     }
+    case TYPE_POINT:
+    case TYPE_RECTANGLE: {
+      // Convert PointVal/RectangleVal to [n x double]
+      int num_coords = type_.GetByteSize() / sizeof(double);
+      for (int i = 0; i < num_coords; ++i) {
+        raw_val = builder_->CreateInsertValue(raw_val, GetCoord(i), i);
+      }
+      break;
+    }
     case TYPE_BOOLEAN:
     case TYPE_TINYINT:
     case TYPE_SMALLINT:
@@ -571,12 +625,103 @@ Value* CodegenAnyVal::Eq(CodegenAnyVal* other) {
       return builder_->CreateCall2(
           eq_fn, GetUnloweredPtr(), other->GetUnloweredPtr(), "eq");
     }
+    case TYPE_POINT:
+    case TYPE_RECTANGLE: {
+      // Compare the coordinates pairwise and AND the results together.
+      int num_coords = type_.GetByteSize() / sizeof(double);
+      Value* result = builder_->CreateFCmpOEQ(GetCoord(0), other->GetCoord(0), "eq");
+      for (int i = 1; i < num_coords; ++i) {
+        Value* coord_eq = builder_->CreateFCmpOEQ(GetCoord(i), other->GetCoord(i));
+        result = builder_->CreateAnd(result, coord_eq, "eq");
+      }
+      return result;
+    }
     default:
       DCHECK(false) << "NYI: " << type_.DebugString();
       return NULL;
   }
 }
 
+bool CodegenAnyVal::SupportsCompare(const ColumnType& type) {
+  switch (type.type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_DECIMAL:
+    case TYPE_STRING:
+    case TYPE_TIMESTAMP:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Example output for ints:
+// %gt = icmp sgt i32 %x, %y
+// %lt = icmp slt i32 %x, %y
+// %0 = select i1 %lt, i32 -1, i32 0
+// %result = select i1 %gt, i32 1, i32 %0
+Value* CodegenAnyVal::Compare(CodegenAnyVal* other, const char* name) {
+  DCHECK_EQ(type_, other->type_);
+  Value* one = codegen_->GetIntConstant(TYPE_INT, 1);
+  Value* minus_one = codegen_->GetIntConstant(TYPE_INT, -1);
+  Value* zero = codegen_->GetIntConstant(TYPE_INT, 0);
+  Value* x = NULL;
+  Value* y = NULL;
+  if (type_.type != TYPE_STRING && type_.type != TYPE_TIMESTAMP) {
+    x = GetVal();
+    y = other->GetVal();
+  }
+  Value* gt;
+  Value* lt;
+  switch (type_.type) {
+    case TYPE_BOOLEAN:
+      gt = builder_->CreateICmpUGT(x, y, "gt");
+      lt = builder_->CreateICmpULT(x, y, "lt");
+      break;
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_DECIMAL:
+      gt = builder_->CreateICmpSGT(x, y, "gt");
+      lt = builder_->CreateICmpSLT(x, y, "lt");
+      break;
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE: {
+      // NaNs are equal to each other and less than all other values.
+      Value* result = builder_->CreateSelect(builder_->CreateFCmpOGT(x, y, "gt"), one,
+          builder_->CreateSelect(builder_->CreateFCmpOLT(x, y, "lt"), minus_one, zero));
+      Value* x_nan = builder_->CreateFCmpUNO(x, x, "x_nan");
+      Value* y_nan = builder_->CreateFCmpUNO(y, y, "y_nan");
+      return builder_->CreateSelect(x_nan,
+          builder_->CreateSelect(y_nan, zero, minus_one),
+          builder_->CreateSelect(y_nan, one, result), name);
+    }
+    case TYPE_STRING: {
+      Function* cmp_fn =
+          codegen_->GetFunction(IRFunction::CODEGEN_ANYVAL_STRING_VAL_COMPARE);
+      return builder_->CreateCall2(
+          cmp_fn, GetUnloweredPtr(), other->GetUnloweredPtr(), name);
+    }
+    case TYPE_TIMESTAMP: {
+      Function* cmp_fn =
+          codegen_->GetFunction(IRFunction::CODEGEN_ANYVAL_TIMESTAMP_VAL_COMPARE);
+      return builder_->CreateCall2(
+          cmp_fn, GetUnloweredPtr(), other->GetUnloweredPtr(), name);
+    }
+    default:
+      DCHECK(!SupportsCompare(type_));
+      return NULL;
+  }
+  return builder_->CreateSelect(gt, one, builder_->CreateSelect(lt, minus_one, zero),
+      name);
+}
+
 Value* CodegenAnyVal::EqToNativePtr(Value* native_ptr) {
   Value* val = NULL;
   if (type_.type != TYPE_STRING) {
@@ -604,6 +749,18 @@ Value* CodegenAnyVal::EqToNativePtr(Value* native_ptr) {
           codegen_->GetFunction(IRFunction::CODEGEN_ANYVAL_TIMESTAMP_VALUE_EQ);
       return builder_->CreateCall2(eq_fn, GetUnloweredPtr(), native_ptr, "cmp_raw");
     }
+    case TYPE_POINT:
+    case TYPE_RECTANGLE: {
+      // 'val' is [n x double]. Compare it with our coordinates pairwise.
+      int num_coords = type_.GetByteSize() / sizeof(double);
+      Value* result = codegen_->true_value();
+      for (int i = 0; i < num_coords; ++i) {
+        Value* native_coord = builder_->CreateExtractValue(val, i);
+        Value* coord_eq = builder_->CreateFCmpOEQ(GetCoord(i), native_coord);
+        result = builder_->CreateAnd(result, coord_eq, "cmp_raw");
+      }
+      return result;
+    }
     default:
       DCHECK(false) << "NYI: " << type_.DebugString();
       return NULL;
@@ -641,18 +798,22 @@ Value* CodegenAnyVal::GetNullVal(LlvmCodeGen* codegen, const ColumnType& type) {
 Value* CodegenAnyVal::GetNullVal(LlvmCodeGen* codegen, Type* val_type) {
   if (val_type->isStructTy()) {
     StructType* struct_type = cast<StructType>(val_type);
-    if (struct_type->getNumElements() == 3) {
-      DCHECK_EQ(val_type, codegen->GetType(LLVM_DECIMALVAL_NAME));
-      // Return the struct { {1}, 0, 0 } (the 'is_null' byte, i.e. the first value's first
-      // byte, is set to 1, the other bytes don't matter)
+    if (struct_type->getElementType(0)->isStructTy()) {
+      // Unlowered DecimalVal, PointVal or RectangleVal.
+      DCHECK(val_type == codegen->GetType(LLVM_DECIMALVAL_NAME) ||
+             val_type == codegen->GetType(LLVM_POINTVAL_NAME) ||
+             val_type == codegen->GetType(LLVM_RECTANGLEVAL_NAME));
+      // Return the struct { {1}, 0, ... } (the 'is_null' byte, i.e. the first value's
+      // first byte, is set to 1, the other bytes don't matter)
       StructType* anyval_struct_type = cast<StructType>(struct_type->getElementType(0));
       Type* is_null_type = anyval_struct_type->getElementType(0);
-      Value* null_anyval =
-          ConstantStruct::get(anyval_struct_type, ConstantInt::get(is_null_type, 1));
-      Type* type2 = struct_type->getElementType(1);
-      Type* type3 = struct_type->getElementType(2);
-      return ConstantStruct::get(struct_type, null_anyval, Constant::getNullValue(type2),
-                                 Constant::getNullValue(type3), NULL);
+      vector<Constant*> elements;
+      elements.push_back(
+          ConstantStruct::get(anyval_struct_type, ConstantInt::get(is_null_type, 1)));
+      for (int i = 1; i < struct_type->getNumElements(); ++i) {
+        elements.push_back(Constant::getNullValue(struct_type->getElementType(i)));
+      }
+      return ConstantStruct::get(struct_type, elements);
     }
     // Return the struct { 1, 0 } (the 'is_null' byte, i.e. the first value's first byte,
     // is set to 1, the other bytes don't matter)
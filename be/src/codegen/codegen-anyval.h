@@ -46,6 +46,8 @@ namespace impala {
 // TYPE_DOUBLE/DoubleVal: { i8, double }
 // TYPE_STRING/StringVal: { i64, i8* }
 // TYPE_TIMESTAMP/TimestampVal: { i64, i64 }
+// TYPE_POINT/PointVal: not lowered (returned via sret)
+// TYPE_RECTANGLE/RectangleVal: not lowered (returned via sret)
 //
 // TODO:
 // - unit tests
@@ -61,10 +63,13 @@ class CodegenAnyVal {
   static const char* LLVM_STRINGVAL_NAME;
   static const char* LLVM_TIMESTAMPVAL_NAME;
   static const char* LLVM_DECIMALVAL_NAME;
+  static const char* LLVM_POINTVAL_NAME;
+  static const char* LLVM_RECTANGLEVAL_NAME;
 
   // Creates a call to 'fn', which should return a (lowered) *Val, and returns the result.
   // This abstracts over the x64 calling convention, in particular for functions returning
-  // a DecimalVal, which pass the return value as an output argument.
+  // a DecimalVal, PointVal or RectangleVal, which pass the return value as an output
+  // argument.
   //
   // If 'result_ptr' is non-NULL, it should be a pointer to the lowered return type of
   // 'fn' (e.g. if 'fn' returns a BooleanVal, 'result_ptr' should have type i16*). The
@@ -137,8 +142,8 @@ class CodegenAnyVal {
   // Gets the 'is_null' field of the *Val.
   llvm::Value* GetIsNull(const char* name = "is_null");
 
-  // Get the 'val' field of the *Val. Do not call if this represents a StringVal or
-  // TimestampVal. If this represents a DecimalVal, returns 'val4', 'val8', or 'val16'
+  // Get the 'val' field of the *Val. Do not call if this represents a StringVal,
+  // TimestampVal, PointVal or RectangleVal. If this represents a DecimalVal, returns 'val4', 'val8', or 'val16'
   // depending on the precision of 'type_'.  The returned value will have variable name
   // 'name'.
   llvm::Value* GetVal(const char* name = "val");
@@ -176,6 +181,11 @@ class CodegenAnyVal {
   void SetDate(llvm::Value* date);
   void SetTimeOfDay(llvm::Value* time_of_day);
 
+  // Getter and setter for the coordinates of PointVals (x, y) and RectangleVals
+  // (x1, y1, x2, y2). 'idx' is the index of the coordinate in that order.
+  llvm::Value* GetCoord(int idx);
+  void SetCoord(int idx, llvm::Value* coord);
+
   // Allocas and stores this value in an unlowered pointer, and returns the pointer. This
   // *Val should be non-null.
   llvm::Value* GetUnloweredPtr();
@@ -201,6 +211,14 @@ class CodegenAnyVal {
   // Returns the i1 result of this == other. this and other must be non-null.
   llvm::Value* Eq(CodegenAnyVal* other);
 
+  // Returns an i32 that is negative if this < other, positive if this > other and 0 if
+  // they are equal, with the same order as RawValue::Compare(). this and other must be
+  // non-null. Returns NULL if the type is not supported, see SupportsCompare().
+  llvm::Value* Compare(CodegenAnyVal* other, const char* name = "result");
+
+  // Returns true if Compare() supports values of 'type'.
+  static bool SupportsCompare(const ColumnType& type);
+
   // Compares this *Val to the value of 'native_ptr'. 'native_ptr' should be a pointer to
   // a native type, StringValue, or TimestampValue. This *Val should match 'native_ptr's
   // type (e.g. if this is an IntVal, 'native_ptr' should have type i32*). Returns the i1
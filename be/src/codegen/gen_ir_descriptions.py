@@ -53,6 +53,8 @@ ir_functions = [
   ["CODEGEN_ANYVAL_STRING_VALUE_EQ", "StringValueEq"],
   ["CODEGEN_ANYVAL_TIMESTAMP_VAL_EQ", "TimestampValEq"],
   ["CODEGEN_ANYVAL_TIMESTAMP_VALUE_EQ", "TimestampValueEq"],
+  ["CODEGEN_ANYVAL_STRING_VAL_COMPARE", "StringValCompare"],
+  ["CODEGEN_ANYVAL_TIMESTAMP_VAL_COMPARE", "TimestampValCompare"],
   ["EXPR_GET_BOOLEAN_VAL", "4Expr13GetBooleanVal"],
   ["EXPR_GET_TINYINT_VAL", "4Expr13GetTinyIntVal"],
   ["EXPR_GET_SMALLINT_VAL", "4Expr14GetSmallIntVal"],
@@ -63,6 +65,8 @@ ir_functions = [
   ["EXPR_GET_STRING_VAL", "4Expr12GetStringVal"],
   ["EXPR_GET_TIMESTAMP_VAL", "4Expr15GetTimestampVal"],
   ["EXPR_GET_DECIMAL_VAL", "4Expr13GetDecimalVal"],
+  ["EXPR_GET_POINT_VAL", "4Expr11GetPointVal"],
+  ["EXPR_GET_RECTANGLE_VAL", "4Expr15GetRectangleVal"],
   ["HASH_CRC", "IrCrcHash"],
   ["HASH_FNV", "IrFnvHash"],
   ["HASH_MURMUR", "IrMurmurHash"],
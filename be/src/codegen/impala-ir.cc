@@ -37,6 +37,7 @@
 #include "exprs/is-null-predicate.cc"
 #include "exprs/math-functions.cc"
 #include "exprs/operators.cc"
+#include "exprs/spatial-functions.cc"
 #include "exprs/string-functions.cc"
 #include "exprs/udf-builtins.cc"
 #include "exprs/utility-functions.cc"
@@ -321,6 +321,11 @@ Type* LlvmCodeGen::GetType(const ColumnType& type) {
       return timestamp_val_type_;
     case TYPE_DECIMAL:
       return Type::getIntNTy(context(), type.GetByteSize() * 8);
+    case TYPE_POINT:
+    case TYPE_RECTANGLE:
+      // PointValue/RectangleValue are packed doubles.
+      return ArrayType::get(Type::getDoubleTy(context()),
+          type.GetByteSize() / sizeof(double));
     default:
       DCHECK(false) << "Invalid type: " << type;
       return NULL;
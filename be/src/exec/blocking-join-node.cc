@@ -17,8 +17,11 @@
 #include <sstream>
 
 #include "exprs/expr.h"
+#include "exprs/expr-context.h"
+#include "exprs/slot-ref.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
+#include "util/bloom-filter.h"
 #include "util/debug-util.h"
 #include "util/runtime-profile.h"
 
@@ -38,7 +41,8 @@ BlockingJoinNode::BlockingJoinNode(const string& node_name, const TJoinOp::type
     join_op_(join_op),
     eos_(false),
     probe_side_eos_(false),
-    can_add_probe_filters_(false) {
+    can_add_probe_filters_(false),
+    is_partitioned_(false) {
 }
 
 Status BlockingJoinNode::Init(const TPlanNode& tnode) {
@@ -49,6 +53,7 @@ Status BlockingJoinNode::Init(const TPlanNode& tnode) {
 BlockingJoinNode::~BlockingJoinNode() {
   // probe_batch_ must be cleaned up in Close() to ensure proper resource freeing.
   DCHECK(probe_batch_ == NULL);
+  DCHECK(probe_filters_.empty());
 }
 
 Status BlockingJoinNode::Prepare(RuntimeState* state) {
@@ -93,6 +98,7 @@ void BlockingJoinNode::Close(RuntimeState* state) {
   if (is_closed()) return;
   if (build_pool_.get() != NULL) build_pool_->FreeAll();
   probe_batch_.reset();
+  ReleaseProbeFilters(state);
   ExecNode::Close(state);
 }
 
@@ -206,3 +212,69 @@ void BlockingJoinNode::CreateOutputRow(TupleRow* out, TupleRow* probe, TupleRow*
     memcpy(out_ptr + probe_tuple_row_size_, build, build_tuple_row_size_);
   }
 }
+
+bool BlockingJoinNode::AllocateProbeFilters(RuntimeState* state,
+    const vector<ExprContext*>& probe_expr_ctxs, int64_t num_build_rows) {
+  DCHECK(probe_filters_.empty());
+  // A partitioned join's filters are merged at the coordinator, where they have to hold
+  // the build values of all instances.
+  int64_t ndv = num_build_rows;
+  if (is_partitioned_) ndv *= state->fragment_ctx().num_fragment_instances;
+  probe_filters_.resize(probe_expr_ctxs.size(),
+      make_pair(-1, static_cast<BloomFilter*>(NULL)));
+  for (int i = 0; i < probe_expr_ctxs.size(); ++i) {
+    if (!probe_expr_ctxs[i]->root()->is_slotref()) continue;
+    probe_filters_[i].first =
+        reinterpret_cast<SlotRef*>(probe_expr_ctxs[i]->root())->slot_id();
+    probe_filters_[i].second = state->CreateBloomFilter(ndv);
+    if (probe_filters_[i].second == NULL) {
+      VLOG(2) << "Disabling probe filter push down because build side is too large: "
+              << num_build_rows;
+      ReleaseProbeFilters(state);
+      return false;
+    }
+  }
+  return true;
+}
+
+void BlockingJoinNode::ReleaseProbeFilters(RuntimeState* state) {
+  for (int i = 0; i < probe_filters_.size(); ++i) {
+    state->ReleaseBloomFilter(probe_filters_[i].second);
+  }
+  probe_filters_.clear();
+}
+
+void BlockingJoinNode::PublishProbeFilters(RuntimeState* state,
+    const vector<ExprContext*>& probe_expr_ctxs) {
+  DCHECK(can_add_probe_filters_);
+  DCHECK(probe_filters_.empty() || probe_filters_.size() == probe_expr_ctxs.size());
+  vector<ExecNode*> scan_nodes;
+  child(0)->CollectNodes(TPlanNodeType::HDFS_SCAN_NODE, &scan_nodes);
+  for (int i = 0; i < probe_expr_ctxs.size(); ++i) {
+    if (!probe_expr_ctxs[i]->root()->is_slotref()) continue;
+    SlotId slot = reinterpret_cast<SlotRef*>(probe_expr_ctxs[i]->root())->slot_id();
+    BloomFilter* filter = probe_filters_.empty() ? NULL : probe_filters_[i].second;
+    if (!probe_filters_.empty()) probe_filters_[i].second = NULL;
+
+    TupleId tuple_id = state->desc_tbl().GetSlotDescriptor(slot)->parent();
+    bool is_local = false;
+    for (int j = 0; j < scan_nodes.size(); ++j) {
+      if (scan_nodes[j]->row_desc().GetTupleIdx(tuple_id) != RowDescriptor::INVALID_IDX) {
+        is_local = true;
+        break;
+      }
+    }
+    if (is_local) {
+      // The scan is below this join in the same fragment instance and only sees the
+      // rows of this instance's build side.
+      if (filter != NULL) {
+        VLOG(2) << "Runtime filter added on slot: " << slot;
+        state->AddBloomFilter(slot, filter);
+      }
+    } else {
+      state->SendBloomFilter(id(), slot, filter);
+      state->ReleaseBloomFilter(filter);
+    }
+  }
+  probe_filters_.clear();
+}
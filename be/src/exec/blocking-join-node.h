@@ -27,6 +27,7 @@
 
 namespace impala {
 
+class BloomFilter;
 class MemPool;
 class RowBatch;
 class TupleRow;
@@ -88,6 +89,15 @@ class BlockingJoinNode : public ExecNode {
   // the entire build side.
   bool can_add_probe_filters_;
 
+  // True if the build and probe rows are hash partitioned between the instances of this
+  // node's fragment, so each instance only sees its share of the build rows.
+  bool is_partitioned_;
+
+  // Runtime filters on the probe side slots built from the build rows, one per eq join
+  // conjunct. The filter of a conjunct whose probe expr is not a slot ref is NULL.
+  // Owned until published by PublishProbeFilters().
+  std::vector<std::pair<SlotId, BloomFilter*> > probe_filters_;
+
   RuntimeProfile::Counter* build_timer_;   // time to prepare build side
   RuntimeProfile::Counter* probe_timer_;   // time to process the probe (left child) batch
   RuntimeProfile::Counter* build_row_counter_;   // num build rows
@@ -125,6 +135,24 @@ class BlockingJoinNode : public ExecNode {
   // This is replaced by codegen.
   void CreateOutputRow(TupleRow* out_row, TupleRow* probe_row, TupleRow* build_row);
 
+  // Creates probe_filters_ for the probe exprs 'probe_expr_ctxs' that are slot refs,
+  // sized for 'num_build_rows' rows of this instance. Returns false and creates no
+  // filters if any of them would be too large.
+  bool AllocateProbeFilters(RuntimeState* state,
+      const std::vector<ExprContext*>& probe_expr_ctxs, int64_t num_build_rows);
+
+  // Frees probe_filters_, e.g. if not all build rows could be inserted into them.
+  void ReleaseProbeFilters(RuntimeState* state);
+
+  // Hands the filters on the slot refs in 'probe_expr_ctxs' to the scans that produce
+  // their slots. A slot whose filter was released is published as disabled so that
+  // the coordinator does not wait for it. A filter on a slot scanned within this
+  // fragment instance is added to 'state' directly, others are sent to the coordinator,
+  // which merges the filters of all instances of this node. Must be called once after
+  // the build side is constructed if can_add_probe_filters_ is set.
+  void PublishProbeFilters(RuntimeState* state,
+      const std::vector<ExprContext*>& probe_expr_ctxs);
+
  private:
   // Supervises ConstructBuildSide in a separate thread, and returns its status in the
   // promise parameter.
@@ -33,10 +33,12 @@
 #include "exec/hash-join-node.h"
 #include "exec/hdfs-scan-node.h"
 #include "exec/hbase-scan-node.h"
+#include "exec/knn-node.h"
 #include "exec/select-node.h"
 #include "exec/partitioned-aggregation-node.h"
 #include "exec/partitioned-hash-join-node.h"
 #include "exec/sort-node.h"
+#include "exec/spatial-join-node.h"
 #include "exec/topn-node.h"
 #include "exec/union-node.h"
 #include "runtime/descriptors.h"
@@ -54,6 +56,8 @@ using namespace boost;
 // TODO: remove when we remove hash-join-node.cc and aggregation-node.cc
 DEFINE_bool(enable_partitioned_hash_join, true, "Enable partitioned hash join");
 DEFINE_bool(enable_partitioned_aggregation, true, "Enable partitioned hash agg");
+DEFINE_bool(enable_vectorized_exprs, true, "Evaluate supported conjuncts and aggregate "
+    "inputs a column at a time over batches of rows, see VectorizedExpr");
 
 namespace impala {
 
@@ -279,6 +283,12 @@ Status ExecNode::CreateNode(ObjectPool* pool, const TPlanNode& tnode,
     case TPlanNodeType::CROSS_JOIN_NODE:
       *node = pool->Add(new CrossJoinNode(pool, tnode, descs));
       break;
+    case TPlanNodeType::SPATIAL_JOIN_NODE:
+      *node = pool->Add(new SpatialJoinNode(pool, tnode, descs));
+      break;
+    case TPlanNodeType::KNN_NODE:
+      *node = pool->Add(new KnnNode(pool, tnode, descs));
+      break;
     case TPlanNodeType::EMPTY_SET_NODE:
       *node = pool->Add(new EmptySetNode(pool, tnode, descs));
       break;
@@ -56,6 +56,7 @@ HashJoinNode::HashJoinNode(
     (join_op_ == TJoinOp::RIGHT_OUTER_JOIN || join_op_ == TJoinOp::FULL_OUTER_JOIN);
   can_add_probe_filters_ = tnode.hash_join_node.add_probe_filters;
   can_add_probe_filters_ &= FLAGS_enable_probe_side_filtering;
+  is_partitioned_ = tnode.hash_join_node.is_partitioned;
 }
 
 Status HashJoinNode::Init(const TPlanNode& tnode) {
@@ -179,19 +180,14 @@ Status HashJoinNode::ConstructBuildSide(RuntimeState* state) {
     if (eos) break;
   }
 
-  // We've finished constructing the build side. Set the bitmap of the build side values
-  // so that the probe side can use this as an additional predicate.
-  // We only do this if the build side is sufficiently small.
-  // TODO: Better heuristic? Currently we simply compare the size of the HT with a
-  // constant value.
+  // We've finished constructing the build side. Build the runtime filters of the build
+  // side values so that the probe side can use them as an additional predicate.
   if (can_add_probe_filters_) {
-    if (hash_tbl_->size() < state->slot_filter_bitmap_size()) {
+    if (AllocateProbeFilters(state, probe_expr_ctxs_, hash_tbl_->size())) {
       AddRuntimeExecOption("Build-Side Filter Pushed Down");
-      hash_tbl_->AddBitmapFilters();
-    } else {
-      VLOG(2) << "Disabling probe filter push down because build table is too large: "
-              << hash_tbl_->size();
+      hash_tbl_->UpdateProbeFilters(probe_filters_);
     }
+    PublishProbeFilters(state, probe_expr_ctxs_);
   }
   return Status::OK;
 }
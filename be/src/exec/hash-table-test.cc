@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
@@ -84,8 +85,8 @@ class HashTableTest : public testing::Test {
 
   // Wrapper to call private methods on HashTable
   // TODO: understand google testing, there must be a more natural way to do this
-  void ResizeTable(HashTable* table, int64_t new_size) {
-    table->ResizeBuckets(new_size);
+  bool ResizeTable(HashTable* table, int64_t new_size) {
+    return table->ResizeBuckets(new_size);
   }
 
   // Do a full table scan on table.  All values should be between [min,max).  If
@@ -288,6 +289,102 @@ TEST_F(HashTableTest, ScanTest) {
   mem_pool_.FreeAll();
 }
 
+// This tests the open addressing layout, starting with a single bucket so that the
+// table is resized repeatedly. Rows with equal keys share a bucket.
+TEST_F(HashTableTest, OpenAddressingTest) {
+  HashTable hash_table(&mem_pool_, 1, true);
+  HashTableCtx ht_ctx(build_expr_ctxs_, probe_expr_ctxs_, false, false, 1, 0, 1);
+  EXPECT_TRUE(hash_table.open_addressing());
+
+  // Add 1 row with val 1, 2 with val 2, etc
+  const int max_val = 100;
+  uint32_t hash = 0;
+  int num_rows = 0;
+  for (int val = 1; val <= max_val; ++val) {
+    for (int i = 0; i < val; ++i) {
+      TupleRow* row = CreateTupleRow(val);
+      ASSERT_TRUE(ht_ctx.EvalAndHashBuild(row, &hash));
+      ASSERT_TRUE(hash_table.Insert(&ht_ctx, row->GetTuple(0), hash));
+      ++num_rows;
+    }
+  }
+  EXPECT_EQ(hash_table.size(), num_rows);
+  EXPECT_LT(hash_table.load_factor(), 1);
+  EXPECT_FALSE(ResizeTable(&hash_table, 64));
+
+  for (int val = 0; val <= max_val + 10; ++val) {
+    TupleRow* probe_row = CreateTupleRow(val);
+    ASSERT_TRUE(ht_ctx.EvalAndHashProbe(probe_row, &hash));
+    HashTable::Iterator iter = hash_table.Find(&ht_ctx, hash);
+    int num_matches = 0;
+    while (!iter.AtEnd()) {
+      ValidateMatch(probe_row, iter.GetRow());
+      ++num_matches;
+      iter.Next<true>(&ht_ctx);
+    }
+    EXPECT_EQ(num_matches, val <= max_val ? val : 0) << val;
+  }
+
+  // A full scan returns every row once.
+  int num_scanned = 0;
+  for (HashTable::Iterator iter = hash_table.Begin(&ht_ctx); !iter.AtEnd();
+      iter.Next<false>(&ht_ctx)) {
+    ++num_scanned;
+  }
+  EXPECT_EQ(num_scanned, num_rows);
+
+  hash_table.Close();
+  ht_ctx.Close();
+  mem_pool_.FreeAll();
+}
+
+// This tests probing with a group of rows hashed and cached up front.
+TEST_F(HashTableTest, RowCacheTest) {
+  HashTable hash_table(&mem_pool_);
+  HashTableCtx ht_ctx(build_expr_ctxs_, probe_expr_ctxs_, false, false, 1, 0, 1);
+
+  uint32_t hash = 0;
+  for (int val = 0; val < 100; ++val) {
+    TupleRow* row = CreateTupleRow(val);
+    if (!ht_ctx.EvalAndHashBuild(row, &hash)) continue;
+    hash_table.Insert(&ht_ctx, row->GetTuple(0), hash);
+  }
+
+  // Probe with 0 to 199 in groups of ROW_CACHE_SIZE, so that the rows are restored in
+  // a different order than they were evaluated in.
+  const int num_probe_rows = 200;
+  vector<TupleRow*> probe_rows;
+  for (int val = 0; val < num_probe_rows; ++val) {
+    probe_rows.push_back(CreateTupleRow(val));
+  }
+  int num_found = 0;
+  for (int begin = 0; begin < num_probe_rows; begin += HashTableCtx::ROW_CACHE_SIZE) {
+    int end = min(num_probe_rows, begin + HashTableCtx::ROW_CACHE_SIZE);
+    for (int i = begin; i < end; ++i) {
+      bool is_valid = ht_ctx.EvalAndHashProbe(probe_rows[i], &hash);
+      EXPECT_TRUE(is_valid);
+      ht_ctx.CacheCurrentRow(i - begin, is_valid, hash);
+      hash_table.PrefetchBucket<true>(hash);
+    }
+    for (int i = end - 1; i >= begin; --i) {
+      ASSERT_TRUE(ht_ctx.RestoreCachedRow(i - begin, &hash));
+      HashTable::Iterator iter = hash_table.Find(&ht_ctx, hash);
+      if (i < 100) {
+        ASSERT_TRUE(iter != hash_table.End());
+        ValidateMatch(probe_rows[i], iter.GetRow());
+        ++num_found;
+      } else {
+        EXPECT_TRUE(iter == hash_table.End());
+      }
+    }
+  }
+  EXPECT_EQ(num_found, 100);
+
+  hash_table.Close();
+  ht_ctx.Close();
+  mem_pool_.FreeAll();
+}
+
 // This test continues adding to the hash table to trigger the resize code paths
 TEST_F(HashTableTest, GrowTableTest) {
   int num_to_add = 4;
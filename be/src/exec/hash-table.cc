@@ -24,6 +24,7 @@
 #include "runtime/raw-value.h"
 #include "runtime/runtime-state.h"
 #include "runtime/string-value.inline.h"
+#include "util/bloom-filter.h"
 #include "util/debug-util.h"
 #include "util/impalad-metrics.h"
 
@@ -31,6 +32,8 @@ using namespace impala;
 using namespace llvm;
 using namespace std;
 
+const int HashTableCtx::ROW_CACHE_SIZE;
+
 const char* HashTableCtx::LLVM_CLASS_NAME = "class.impala::HashTableCtx";
 
 // Page sizes used only for BE test. For non-testing, we use the io buffer size.
@@ -62,6 +65,9 @@ HashTableCtx::HashTableCtx(const vector<ExprContext*>& build_expr_ctxs,
   expr_values_buffer_ = new uint8_t[results_buffer_size_];
   memset(expr_values_buffer_, 0, sizeof(uint8_t) * results_buffer_size_);
   expr_value_null_bits_ = new uint8_t[build_expr_ctxs.size()];
+  cached_values_ = new uint8_t[ROW_CACHE_SIZE * results_buffer_size_];
+  cached_null_bits_ = new uint8_t[ROW_CACHE_SIZE * build_expr_ctxs.size()];
+  memset(cached_is_valid_, 0, sizeof(cached_is_valid_));
 
   // Populate the seeds to use for all the levels. TODO: revisit how we generate these.
   DCHECK_GE(max_levels, 0);
@@ -82,6 +88,10 @@ void HashTableCtx::Close() {
   DCHECK_NOTNULL(expr_value_null_bits_);
   delete[] expr_value_null_bits_;
   expr_value_null_bits_ = NULL;
+  delete[] cached_values_;
+  cached_values_ = NULL;
+  delete[] cached_null_bits_;
+  cached_null_bits_ = NULL;
   free(row_);
   row_ = NULL;
 }
@@ -166,6 +176,7 @@ HashTable::HashTable(RuntimeState* state, BufferedBlockMgr::Client* client,
     data_page_pool_(NULL),
     num_build_tuples_(num_build_tuples),
     stores_tuples_(num_build_tuples == 1),
+    open_addressing_(state->query_options().hash_table_open_addressing),
     num_filled_buckets_(0),
     num_nodes_(0),
     next_node_(NULL),
@@ -178,13 +189,14 @@ HashTable::HashTable(RuntimeState* state, BufferedBlockMgr::Client* client,
   if (!stores_tuples_) DCHECK_NOTNULL(stream);
 }
 
-HashTable::HashTable(MemPool* pool, int num_buckets)
+HashTable::HashTable(MemPool* pool, int num_buckets, bool open_addressing)
   : state_(NULL),
     block_mgr_client_(NULL),
     tuple_stream_(NULL),
     data_page_pool_(pool),
     num_build_tuples_(1),
     stores_tuples_(true),
+    open_addressing_(open_addressing),
     num_filled_buckets_(0),
     num_nodes_(0),
     next_node_(NULL),
@@ -230,22 +242,18 @@ int64_t HashTable::byte_size() const {
 }
 
 void HashTable::UpdateProbeFilters(HashTableCtx* ht_ctx,
-    vector<pair<SlotId, Bitmap*> >& bitmaps) {
+    vector<pair<SlotId, BloomFilter*> >& filters) {
   DCHECK_NOTNULL(ht_ctx);
-  // For the bitmap filters, always use the initial seed. The other parts of the plan
-  // tree (e.g. the scan node) relies on this.
-  uint32_t seed = ht_ctx->seeds_[0];
-
-  // Walk the build table and update the bitmap for each probe side slot.
+  // Walk the build table and update the filter for each probe side slot.
   HashTable::Iterator iter = Begin(ht_ctx);
   while (iter != End()) {
     TupleRow* row = iter.GetRow();
     for (int i = 0; i < ht_ctx->build_expr_ctxs_.size(); ++i) {
-      if (bitmaps[i].second == NULL) continue;
+      if (filters[i].second == NULL) continue;
       void* e = ht_ctx->build_expr_ctxs_[i]->GetValue(row);
-      uint32_t h =
-          RawValue::GetHashValue(e, ht_ctx->build_expr_ctxs_[i]->root()->type(), seed);
-      bitmaps[i].second->Set<true>(h, true);
+      uint32_t h = RawValue::GetHashValue(e, ht_ctx->build_expr_ctxs_[i]->root()->type(),
+          RuntimeState::RUNTIME_FILTER_HASH_SEED);
+      filters[i].second->Insert(h);
     }
     iter.Next<false>(ht_ctx);
   }
@@ -256,6 +264,7 @@ bool HashTable::ResizeBuckets(int64_t num_buckets) {
       << "num_buckets=" << num_buckets << " must be a power of 2";
   VLOG(2) << "Resizing hash table from "
           << num_buckets_ << " to " << num_buckets << " buckets.";
+  if (open_addressing_) return ResizeOpenAddressingBuckets(num_buckets);
 
   int64_t old_num_buckets = num_buckets_;
   // All memory that can grow proportional to the input should come from the block mgrs
@@ -279,7 +288,7 @@ bool HashTable::ResizeBuckets(int64_t num_buckets) {
     Bucket* bucket = &buckets_[i];
     Bucket* sister_bucket = &buckets_[i + old_num_buckets];
     Node* last_node = NULL;
-    Node* node = bucket->node;
+    Node* node = bucket->node();
 
     while (node != NULL) {
       Node* next = node->next;
@@ -311,6 +320,37 @@ bool HashTable::ResizeBuckets(int64_t num_buckets) {
   return true;
 }
 
+bool HashTable::ResizeOpenAddressingBuckets(int64_t num_buckets) {
+  if (num_buckets <= num_filled_buckets_) return false;
+  // Both bucket arrays are needed while rehashing.
+  int64_t buckets_byte_size = num_buckets * sizeof(Bucket);
+  if (block_mgr_client_ != NULL &&
+      !state_->block_mgr()->ConsumeMemory(block_mgr_client_, buckets_byte_size)) {
+    return false;
+  }
+  Bucket* buckets = reinterpret_cast<Bucket*>(malloc(buckets_byte_size));
+  memset(buckets, 0, buckets_byte_size);
+  for (int64_t i = 0; i < num_buckets_; ++i) {
+    Node* node = buckets_[i].node();
+    if (node == NULL) continue;
+    // The chains in different buckets have different keys, so this only needs to find
+    // an empty bucket.
+    int64_t bucket_idx = node->hash & (num_buckets - 1);
+    while (buckets[bucket_idx].node() != NULL) {
+      bucket_idx = (bucket_idx + 1) & (num_buckets - 1);
+    }
+    buckets[bucket_idx] = buckets_[i];
+  }
+  free(buckets_);
+  if (block_mgr_client_ != NULL) {
+    state_->block_mgr()->ReleaseMemory(block_mgr_client_, num_buckets_ * sizeof(Bucket));
+  }
+  buckets_ = buckets;
+  num_buckets_ = num_buckets;
+  num_buckets_till_resize_ = MAX_BUCKET_OCCUPANCY_FRACTION * num_buckets_;
+  return true;
+}
+
 bool HashTable::GrowNodeArray() {
   int64_t buffer_size = 0;
   if (block_mgr_client_ != NULL) {
@@ -340,10 +380,11 @@ string HashTable::DebugString(bool skip_empty, bool show_match,
   stringstream ss;
   ss << endl;
   for (int i = 0; i < num_buckets_; ++i) {
-    Node* node = buckets_[i].node;
+    Node* node = buckets_[i].node();
     bool first = true;
     if (skip_empty && node == NULL) continue;
     ss << i << ": ";
+    if (open_addressing_ && node != NULL) ss << "[tag=" << buckets_[i].tag() << "] ";
     while (node != NULL) {
       if (!first) ss << ",";
       if (stores_tuples_) {
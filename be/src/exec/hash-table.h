@@ -26,7 +26,7 @@
 #include "runtime/buffered-tuple-stream.inline.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/tuple-row.h"
-#include "util/bitmap.h"
+#include "util/bit-util.h"
 #include "util/hash-util.h"
 
 namespace llvm {
@@ -35,6 +35,7 @@ namespace llvm {
 
 namespace impala {
 
+class BloomFilter;
 class Expr;
 class ExprContext;
 class LlvmCodeGen;
@@ -75,13 +76,24 @@ class HashTable;
 // power of 2. This allows us to determine if a node needs to move by simply checking a
 // single bit, and further allows us to initially hash nodes using a bitmask.
 //
-// TODO: this is not a fancy hash table in terms of memory access patterns (cuckoo-hashing
-// or something that spills to disk). We will likely want to invest more time into this.
+// With the HASH_TABLE_OPEN_ADDRESSING query option, the buckets are instead used with
+// open addressing and linear probing: rows with equal keys are chained in a single
+// bucket, and rows with different keys that map to the same bucket go to the next
+// empty one. Each bucket also holds a tag of the upper hash bits in the unused upper
+// bits of its node pointer, so a probe passes over non-matching buckets without
+// touching their nodes, and consecutive probes stay within the same cache line(s) of
+// the bucket array instead of following a chain of nodes through memory. The nodes
+// still live in the block mgr's data pages, so memory accounting and spilling work
+// the same way in both modes.
+//
 // TODO: hash-join and aggregation have very different access patterns.  Joins insert
 // all the rows and then calls scan to find them.  Aggregation interleaves Find() and
 // Inserts().  We can want to optimize joins more heavily for Inserts() (in particular
 // growing).
-// TODO: batched interface for inserts and finds.
+// Callers that process a batch of rows can evaluate and hash a group of rows up front
+// (see HashTableCtx::CacheCurrentRow()), prefetch their buckets with
+// HashTable::PrefetchBucket() and only then do the Find()/Insert() calls, so that the
+// cache misses on the buckets overlap instead of being taken one row at a time.
 // TODO: do we need to check mem limit exceeded so often. Check once per batch?
 
 // Control block for a hash table.  This class contains the logic as well as the variables
@@ -146,6 +158,22 @@ class HashTableCtx {
   // supports it (see hash-util.h).
   llvm::Function* CodegenHashCurrentRow(RuntimeState* state, bool use_murmur);
 
+  // Saves the expr values of the row evaluated last, along with its hash and the
+  // result of EvalAndHashBuild()/EvalAndHashProbe(), in slot 'idx' of the row cache.
+  // 0 <= idx < ROW_CACHE_SIZE. If 'is_valid' is false, only that is saved.
+  void IR_ALWAYS_INLINE CacheCurrentRow(int idx, bool is_valid, uint32_t hash);
+
+  // Restores the row saved in slot 'idx' as the current row, so it can be passed to
+  // Find()/Insert() as if it had just been evaluated. Returns the saved result of
+  // EvalAndHash*() and, if that is true, sets 'hash'.
+  // The cached values of var-len exprs point into the memory of the input row or
+  // the exprs' local allocations, so a row must be restored before either is freed.
+  bool IR_ALWAYS_INLINE RestoreCachedRow(int idx, uint32_t* hash);
+
+  // Number of rows the row cache holds. Large enough for the bucket prefetches of a
+  // group to be in flight together, small enough for the cached values to stay in L1.
+  static const int ROW_CACHE_SIZE = 64;
+
   static const char* LLVM_CLASS_NAME;
 
  private:
@@ -240,6 +268,14 @@ class HashTableCtx {
   // not change once allocated.
   uint8_t* expr_value_null_bits_;
 
+  // Row cache for CacheCurrentRow()/RestoreCachedRow(). Slot i holds the expr values
+  // at cached_values_ + i * results_buffer_size_ and the null bits at
+  // cached_null_bits_ + i * build_expr_ctxs_.size().
+  uint8_t* cached_values_;
+  uint8_t* cached_null_bits_;
+  uint32_t cached_hashes_[ROW_CACHE_SIZE];
+  bool cached_is_valid_[ROW_CACHE_SIZE];
+
   // Scratch buffer to generate rows on the fly.
   TupleRow* row_;
 
@@ -256,6 +292,11 @@ class HashTable {
  public:
   class Iterator;
 
+  // Maximum number of upper hash bits that callers may use to partition rows between
+  // hash tables, like PartitionedHashJoinNode and PartitionedAggregationNode do. All
+  // rows of such a table share these bits, so open addressing tags don't use them.
+  static const int MAX_PARTITIONING_BITS = 2;
+
   // Create a hash table.
   //  - client: block mgr client to allocate data pages from.
   //  - num_build_tuples: number of Tuples in the build tuple row.
@@ -263,13 +304,15 @@ class HashTable {
   //    hash table. Can be NULL if the rows contain only a single tuple, in which
   //    the 'tuple_stream' is unused.
   //  - num_buckets: number of buckets that the hash table should be initialized to.
+  // The table uses open addressing if the query option HASH_TABLE_OPEN_ADDRESSING
+  // is set.
   HashTable(RuntimeState* state, BufferedBlockMgr::Client* client,
       int num_build_tuples, BufferedTupleStream* tuple_stream = NULL,
       int64_t num_buckets = 1024);
 
   // Ctor used only for testing. Memory is allocated from the pool instead of the
   // block mgr.
-  HashTable(MemPool* pool, int num_buckets = 1024);
+  HashTable(MemPool* pool, int num_buckets = 1024, bool open_addressing = false);
 
   // Allocates the initial bucket structure. Returns false if OOM.
   bool Init();
@@ -327,12 +370,20 @@ class HashTable {
   // Returns HashTable::End() if there is no match.
   Iterator IR_ALWAYS_INLINE Find(HashTableCtx* ht_ctx, uint32_t hash);
 
+  // Issues a prefetch for the bucket that a row with 'hash' maps to. This is only a
+  // hint: the table may still be resized before the row is looked up. READ_ONLY should
+  // be false if the row might be inserted.
+  template<bool READ_ONLY>
+  void IR_ALWAYS_INLINE PrefetchBucket(uint32_t hash);
+
   // Returns number of elements in the hash table
   int64_t size() const { return num_nodes_; }
 
   // Returns the number of buckets
   int64_t num_buckets() const { return num_buckets_; }
 
+  bool open_addressing() const { return open_addressing_; }
+
   // Returns the load factor (the number of non-empty buckets)
   float load_factor() const {
     return num_filled_buckets_ / static_cast<float>(num_buckets_);
@@ -355,12 +406,12 @@ class HashTable {
   // Returns the number of bytes allocated to the hash table
   int64_t byte_size() const;
 
-  // Can be called after all insert calls to update the bitmap filters for the probe
-  // side values. The bitmap filters are similar to Bloom filters in that they have no
-  // false negatives but they will have false positives.
+  // Can be called after all insert calls to insert the build side values into the
+  // runtime filters for the probe side, one per build expr (NULL if there is none).
+  // Values are hashed with RuntimeState::RUNTIME_FILTER_HASH_SEED.
   // These filters are not added to the runtime state.
   void UpdateProbeFilters(HashTableCtx* ht_ctx,
-      std::vector<std::pair<SlotId, Bitmap*> >& bitmaps);
+      std::vector<std::pair<SlotId, BloomFilter*> >& filters);
 
   // Returns an iterator at the beginning of the hash table.  Advancing this iterator
   // will traverse all elements.
@@ -481,25 +532,59 @@ class HashTable {
     };
   };
 
+  // A bucket points to the first node of its chain. With open addressing, the upper
+  // 16 bits of 'data' also hold the tag of the chain's hash (see HashTag()). Chaining
+  // leaves them 0. User-space pointers fit in the lower 48 bits on x86_64.
   struct Bucket {
-    Node* node;
-    Bucket() : node(NULL) { }
+    uint64_t data;
+
+    Bucket() : data(0) { }
+
+    Node* node() const { return reinterpret_cast<Node*>(data & NODE_MASK); }
+    uint16_t tag() const { return data >> TAG_SHIFT; }
+
+    void Set(Node* node, uint16_t tag) {
+      DCHECK((reinterpret_cast<uint64_t>(node) & ~NODE_MASK) == 0) << node;
+      data = reinterpret_cast<uint64_t>(node) | (static_cast<uint64_t>(tag) << TAG_SHIFT);
+    }
+
+    static const int TAG_SHIFT = 48;
+    static const uint64_t NODE_MASK = (1ULL << TAG_SHIFT) - 1;
   };
 
+  // Returns the tag stored in an open addressing bucket for 'hash'. The lower bits
+  // of the hash pick the bucket and the top MAX_PARTITIONING_BITS pick the partition,
+  // so the tag is taken from the 16 bits below the latter. They only overlap the
+  // bucket bits in tables of more than 2^14 buckets.
+  static uint16_t HashTag(uint32_t hash) {
+    return hash >> (16 - MAX_PARTITIONING_BITS);
+  }
+
   // Returns the next non-empty bucket and updates idx to be the index of that bucket.
   // If there are no more buckets, returns NULL and sets idx to -1
   Bucket* NextBucket(int64_t* bucket_idx);
 
-  // Resize the hash table to 'num_buckets'. Returns false on OOM.
+  // Resize the hash table to 'num_buckets'. Returns false on OOM, or with open
+  // addressing, if 'num_buckets' is too small to leave a bucket empty.
   bool ResizeBuckets(int64_t num_buckets);
 
+  // ResizeBuckets() for open addressing. The rows are rehashed into a new bucket array.
+  bool ResizeOpenAddressingBuckets(int64_t num_buckets);
+
+  // Probes the open addressing buckets for the last row evaluated in 'ht_ctx', which
+  // hashes to 'hash'. Returns the index of the bucket holding the rows with an equal
+  // key and sets 'found' to true, or returns the index of the empty bucket that ends
+  // the probe sequence and sets 'found' to false.
+  int64_t IR_ALWAYS_INLINE Probe(HashTableCtx* ht_ctx, uint32_t hash, bool* found);
+
   // Insert row into the hash table. Returns the node that was inserted. Returns NULL
   // if there was not enough memory.
   Node* IR_ALWAYS_INLINE InsertImpl(HashTableCtx* ht_ctx, uint32_t hash);
 
   // Chains the node at 'node_idx' to 'bucket'.  Nodes in a bucket are chained
   // as a linked list; this places the new node at the beginning of the list.
-  void AddToBucket(Bucket* bucket, Node* node);
+  // 'tag' is stored in the bucket (0 unless open addressing is used).
+  void AddToBucket(Bucket* bucket, Node* node, uint16_t tag);
 
   // Moves a node from one bucket to another. 'previous_node' refers to the
   // node (if any) that's chained before this node in from_bucket's linked list.
@@ -544,6 +629,9 @@ class HashTable {
   // TODO: ..or with template-ization
   const bool stores_tuples_;
 
+  // If true, the buckets use open addressing instead of chaining.
+  const bool open_addressing_;
+
   // Number of non-empty buckets.  Used to determine when to grow and rehash
   int64_t num_filled_buckets_;
 
@@ -34,13 +34,51 @@ inline bool HashTableCtx::EvalAndHashProbe(TupleRow* row, uint32_t* hash) {
   return true;
 }
 
+inline void HashTableCtx::CacheCurrentRow(int idx, bool is_valid, uint32_t hash) {
+  DCHECK_GE(idx, 0);
+  DCHECK_LT(idx, ROW_CACHE_SIZE);
+  cached_is_valid_[idx] = is_valid;
+  if (!is_valid) return;
+  cached_hashes_[idx] = hash;
+  int num_exprs = build_expr_ctxs_.size();
+  memcpy(cached_values_ + idx * results_buffer_size_, expr_values_buffer_,
+      results_buffer_size_);
+  memcpy(cached_null_bits_ + idx * num_exprs, expr_value_null_bits_, num_exprs);
+}
+
+inline bool HashTableCtx::RestoreCachedRow(int idx, uint32_t* hash) {
+  DCHECK_GE(idx, 0);
+  DCHECK_LT(idx, ROW_CACHE_SIZE);
+  if (!cached_is_valid_[idx]) return false;
+  *hash = cached_hashes_[idx];
+  int num_exprs = build_expr_ctxs_.size();
+  memcpy(expr_values_buffer_, cached_values_ + idx * results_buffer_size_,
+      results_buffer_size_);
+  memcpy(expr_value_null_bits_, cached_null_bits_ + idx * num_exprs, num_exprs);
+  return true;
+}
+
+template<bool READ_ONLY>
+inline void HashTable::PrefetchBucket(uint32_t hash) {
+  DCHECK_NE(num_buckets_, 0);
+  // The last argument asks for the line to be kept in all cache levels, since it is
+  // needed again shortly.
+  __builtin_prefetch(&buckets_[hash & (num_buckets_ - 1)], READ_ONLY ? 0 : 1, 3);
+}
+
 inline HashTable::Iterator HashTable::Find(HashTableCtx* ht_ctx, uint32_t hash) {
   DCHECK_NOTNULL(ht_ctx);
   DCHECK_NE(num_buckets_, 0);
   DCHECK_EQ(hash, ht_ctx->HashCurrentRow());
+  if (open_addressing_) {
+    bool found;
+    int64_t bucket_idx = Probe(ht_ctx, hash, &found);
+    if (!found) return End();
+    return Iterator(this, ht_ctx, bucket_idx, buckets_[bucket_idx].node(), hash);
+  }
   int64_t bucket_idx = hash & (num_buckets_ - 1);
   Bucket* bucket = &buckets_[bucket_idx];
-  Node* node = bucket->node;
+  Node* node = bucket->node();
   while (node != NULL) {
     if (node->hash == hash && ht_ctx->Equals(GetRow(node, ht_ctx->row_))) {
       return Iterator(this, ht_ctx, bucket_idx, node, hash);
@@ -50,11 +88,32 @@ inline HashTable::Iterator HashTable::Find(HashTableCtx* ht_ctx, uint32_t hash)
   return End();
 }
 
+inline int64_t HashTable::Probe(HashTableCtx* ht_ctx, uint32_t hash, bool* found) {
+  DCHECK(open_addressing_);
+  DCHECK_LT(num_filled_buckets_, num_buckets_);
+  uint16_t tag = HashTag(hash);
+  int64_t bucket_idx = hash & (num_buckets_ - 1);
+  while (true) {
+    const Bucket& bucket = buckets_[bucket_idx];
+    Node* node = bucket.node();
+    if (node == NULL) {
+      *found = false;
+      return bucket_idx;
+    }
+    if (bucket.tag() == tag && node->hash == hash &&
+        ht_ctx->Equals(GetRow(node, ht_ctx->row_))) {
+      *found = true;
+      return bucket_idx;
+    }
+    bucket_idx = (bucket_idx + 1) & (num_buckets_ - 1);
+  }
+}
+
 inline HashTable::Iterator HashTable::Begin(HashTableCtx* ctx) {
   DCHECK_NE(num_buckets_, 0);
   int64_t bucket_idx = -1;
   Bucket* bucket = NextBucket(&bucket_idx);
-  if (bucket != NULL) return Iterator(this, ctx, bucket_idx, bucket->node, 0);
+  if (bucket != NULL) return Iterator(this, ctx, bucket_idx, bucket->node(), 0);
   return End();
 }
 
@@ -62,7 +121,7 @@ inline HashTable::Iterator HashTable::FirstUnmatched(HashTableCtx* ctx) {
   int64_t bucket_idx = -1;
   Bucket* bucket = NextBucket(&bucket_idx);
   while (bucket != NULL) {
-    Node* node = bucket->node;
+    Node* node = bucket->node();
     while (node != NULL && node->matched) {
       node = node->next;
     }
@@ -79,7 +138,7 @@ inline HashTable::Iterator HashTable::FirstUnmatched(HashTableCtx* ctx) {
 inline HashTable::Bucket* HashTable::NextBucket(int64_t* bucket_idx) {
   ++*bucket_idx;
   for (; *bucket_idx < num_buckets_; ++*bucket_idx) {
-    if (buckets_[*bucket_idx].node != NULL) return &buckets_[*bucket_idx];
+    if (buckets_[*bucket_idx].node() != NULL) return &buckets_[*bucket_idx];
   }
   *bucket_idx = -1;
   return NULL;
@@ -88,7 +147,9 @@ inline HashTable::Bucket* HashTable::NextBucket(int64_t* bucket_idx) {
 inline HashTable::Node* HashTable::InsertImpl(HashTableCtx* ht_ctx, uint32_t hash) {
   DCHECK_NOTNULL(ht_ctx);
   DCHECK_NE(num_buckets_, 0);
-  if (UNLIKELY(num_filled_buckets_ > num_buckets_till_resize_)) {
+  // With open addressing, a bucket must always stay empty to end the probes.
+  if (UNLIKELY(num_filled_buckets_ > num_buckets_till_resize_ ||
+      (open_addressing_ && num_filled_buckets_ + 1 >= num_buckets_))) {
     // TODO: next prime instead of double?
     if (!ResizeBuckets(num_buckets_ * 2)) return NULL;
   }
@@ -96,20 +157,27 @@ inline HashTable::Node* HashTable::InsertImpl(HashTableCtx* ht_ctx, uint32_t has
     if (!GrowNodeArray()) return NULL;
   }
   DCHECK_EQ(hash, ht_ctx->HashCurrentRow());
-  int64_t bucket_idx = hash & (num_buckets_ - 1);
   next_node_->hash = hash;
   next_node_->matched = false;
-  AddToBucket(&buckets_[bucket_idx], next_node_);
+  if (open_addressing_) {
+    // Rows with equal keys are chained in the same bucket.
+    bool found;
+    int64_t bucket_idx = Probe(ht_ctx, hash, &found);
+    AddToBucket(&buckets_[bucket_idx], next_node_, HashTag(hash));
+  } else {
+    int64_t bucket_idx = hash & (num_buckets_ - 1);
+    AddToBucket(&buckets_[bucket_idx], next_node_, 0);
+  }
   DCHECK_GT(node_remaining_current_page_, 0);
   --node_remaining_current_page_;
   ++num_nodes_;
   return next_node_++;
 }
 
-inline void HashTable::AddToBucket(Bucket* bucket, Node* node) {
-  num_filled_buckets_ += (bucket->node == NULL);
-  node->next = bucket->node;
-  bucket->node = node;
+inline void HashTable::AddToBucket(Bucket* bucket, Node* node, uint16_t tag) {
+  num_filled_buckets_ += (bucket->node() == NULL);
+  node->next = bucket->node();
+  bucket->Set(node, tag);
 }
 
 inline void HashTable::MoveNode(Bucket* from_bucket, Bucket* to_bucket,
@@ -118,10 +186,11 @@ inline void HashTable::MoveNode(Bucket* from_bucket, Bucket* to_bucket,
     previous_node->next = node->next;
   } else {
     // Update bucket directly
-    from_bucket->node = node->next;
+    DCHECK(!open_addressing_);
+    from_bucket->Set(node->next, 0);
     num_filled_buckets_ -= (node->next == NULL);
   }
-  AddToBucket(to_bucket, node);
+  AddToBucket(to_bucket, node, 0);
 }
 
 template<bool check_match>
@@ -134,6 +203,12 @@ inline void HashTable::Iterator::Next(HashTableCtx* ht_ctx) {
   // bucket needs to be scanned. 'expr_values_buffer_' contains the results
   // for the current probe row.
   if (check_match) {
+    if (table_->open_addressing_) {
+      // All the rows chained in an open addressing bucket have equal keys.
+      node_ = node_->next;
+      if (node_ == NULL) *this = table_->End();
+      return;
+    }
     // TODO: this should prefetch the next node
     Node* node = node_->next;
     while (node != NULL) {
@@ -158,7 +233,7 @@ inline void HashTable::Iterator::Next(HashTableCtx* ht_ctx) {
       bucket_idx_ = -1;
       node_ = NULL;
     } else {
-      node_ = bucket->node;
+      node_ = bucket->node();
     }
   }
 }
@@ -177,7 +252,7 @@ inline bool HashTable::Iterator::NextUnmatched() {
         node_ = NULL;
         return false;
       } else {
-        node_ = bucket->node;
+        node_ = bucket->node();
         if (node_ != NULL && !node_->matched) return true;
       }
     } else {
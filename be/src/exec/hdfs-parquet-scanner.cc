@@ -13,8 +13,10 @@
 // limitations under the License.
 
 #include "exec/hdfs-parquet-scanner.h"
+#include <algorithm>
 
 #include <boost/algorithm/string.hpp>
+#include <cmath>
 #include <gutil/strings/substitute.h>
 #include <limits> // for std::numeric_limits
 
@@ -23,6 +25,10 @@
 #include "exec/scanner-context.inline.h"
 #include "exec/read-write-util.h"
 #include "exprs/expr.h"
+#include "exprs/expr-context.h"
+#include "exprs/slot-ref.h"
+#include "exprs/vectorized-expr.h"
+#include "runtime/column-batch.h"
 #include "runtime/descriptors.h"
 #include "runtime/runtime-state.h"
 #include "runtime/mem-pool.h"
@@ -31,8 +37,8 @@
 #include "runtime/tuple-row.h"
 #include "runtime/tuple.h"
 #include "runtime/string-value.h"
-#include "util/bitmap.h"
 #include "util/bit-util.h"
+#include "util/bloom-filter.h"
 #include "util/decompress.h"
 #include "util/debug-util.h"
 #include "util/dict-encoding.h"
@@ -46,6 +52,8 @@ using namespace boost::algorithm;
 using namespace impala;
 using namespace strings;
 
+DECLARE_bool(enable_vectorized_exprs);
+
 Status HdfsParquetScanner::IssueInitialRanges(HdfsScanNode* scan_node,
     const std::vector<HdfsFileDesc*>& files) {
   vector<DiskIoMgr::ScanRange*> footer_ranges;
@@ -93,6 +101,10 @@ HdfsParquetScanner::HdfsParquetScanner(HdfsScanNode* scan_node, RuntimeState* st
     : HdfsScanner(scan_node, state),
       metadata_range_(NULL),
       dictionary_pool_(new MemPool(scan_node->mem_tracker())),
+      num_row_groups_skipped_counter_(NULL),
+      num_pages_skipped_counter_(NULL),
+      num_dict_filtered_rows_counter_(NULL),
+      num_topn_filtered_rows_counter_(NULL),
       assemble_rows_timer_(scan_node_->materialize_tuple_timer()) {
   assemble_rows_timer_.Stop();
 }
@@ -121,6 +133,10 @@ class HdfsParquetScanner::BaseColumnReader {
     metadata_ = metadata;
     dict_decoder_base_ = NULL;
     num_values_read_ = 0;
+    skip_current_page_ = false;
+    page_header_buffered_ = false;
+    dict_filter_.clear();
+    dict_filter_rejects_all_ = false;
     if (metadata_->codec != parquet::CompressionCodec::UNCOMPRESSED) {
       RETURN_IF_ERROR(Codec::CreateDecompressor(
           NULL, false, PARQUET_TO_IMPALA_CODEC[metadata_->codec], &decompressor_));
@@ -131,6 +147,8 @@ class HdfsParquetScanner::BaseColumnReader {
   // Called once when the scanner is complete for final cleanup.
   void Close() {
     if (decompressor_.get() != NULL) decompressor_->Close();
+    COUNTER_ADD(parent_->num_dict_filtered_rows_counter_, dict_filter_rows_rejected_);
+    COUNTER_ADD(parent_->num_topn_filtered_rows_counter_, topn_filter_rows_rejected_);
   }
 
   int64_t total_len() const { return metadata_->total_compressed_size; }
@@ -154,9 +172,27 @@ class HdfsParquetScanner::BaseColumnReader {
   // are currently dense so we'll need to figure out something there.
   bool ReadValue(MemPool* pool, Tuple* tuple, bool* conjuncts_failed);
 
-  // TODO: Some encodings might benefit a lot from a SkipValues(int num_rows) if
-  // we know this row can be skipped. This could be very useful with stats and big
-  // sections can be skipped. Implement that when we can benefit from it.
+  // Reads the next 'num_rows' values into 'column' at indexes [0, num_rows).
+  // rows_failed[i] has the same meaning as *conjuncts_failed in ReadValue() for row i.
+  // Returns the number of values read, which is less than 'num_rows' in the cases
+  // ReadValue() returns false.
+  int ReadValueBatch(MemPool* pool, int num_rows, ColumnVector* column,
+      bool* rows_failed);
+
+  // Skips the next 'num_rows' values without decoding them, or decoding only what is
+  // needed to find the next value. Returns the number of values skipped, which is less
+  // than 'num_rows' in the cases ReadValue() returns false.
+  int SkipValues(int num_rows);
+
+  // Sets the conjuncts on this column that are evaluated against page statistics.
+  void set_min_max_conjuncts(const vector<const MinMaxConjunct*>& conjuncts) {
+    min_max_conjuncts_ = conjuncts;
+  }
+
+  // Sets the conjuncts on this column that are evaluated once per dictionary entry.
+  void set_dict_filter_conjuncts(const vector<ExprContext*>& conjuncts) {
+    dict_filter_conjuncts_ = conjuncts;
+  }
 
  protected:
   friend class HdfsParquetScanner;
@@ -181,6 +217,10 @@ class HdfsParquetScanner::BaseColumnReader {
   // Header for current data page.
   parquet::PageHeader current_page_header_;
 
+  // True if current_page_header_ was read by ReadDictionaryPage() but the page itself
+  // was not. ReadDataPage() then starts from this header instead of reading the next.
+  bool page_header_buffered_;
+
   // Num values remaining in the current data page
   int num_buffered_values_;
 
@@ -198,18 +238,47 @@ class HdfsParquetScanner::BaseColumnReader {
   // The number of values seen so far. Updated per data page.
   int64_t num_values_read_;
 
-  // Cache of the bitmap_filter_ (if any) for this slot.
-  const Bitmap* bitmap_filter_;
-  // Cache of hash_seed_ to use with bitmap_filter_.
-  uint32_t hash_seed_;
+  // Conjuncts on this column that can be evaluated against page statistics.
+  vector<const MinMaxConjunct*> min_max_conjuncts_;
+
+  // True if the statistics of the current data page showed that none of its values
+  // can pass min_max_conjuncts_. The page's data is not read and its rows fail the
+  // conjuncts.
+  bool skip_current_page_;
+
+  // Conjuncts that only reference this column. When a dictionary page is read, they are
+  // evaluated for each entry into the bitmap dict_filter_, and the values of dictionary
+  // encoded pages whose entry fails them fail the conjuncts without being decoded.
+  vector<ExprContext*> dict_filter_conjuncts_;
+  vector<bool> dict_filter_;
+
+  // True if no dictionary entry and no NULL passes dict_filter_conjuncts_, so none of
+  // the rows of a dictionary encoded page can pass. Such pages are skipped.
+  bool dict_filter_rejects_all_;
+
+  // Number of values rejected by dict_filter_.
+  int64_t dict_filter_rows_rejected_;
+
+  // Copy of the filter of the TopNNode above the scan on this column, if any. Like
+  // runtime filters, it is looked up again for each data page since it tightens as the
+  // TopNNode sees more rows.
+  TopNFilter topn_filter_;
+  int64_t topn_filter_rows_rejected_;
 
-  // Bitmap filters are optional (i.e. they can be ignored and the results will be
+  // Cache of the runtime filter (if any) for this slot. Filters can be published by
+  // joins in other fragments after the scan started, so this is looked up again for
+  // each data page until one is found.
+  const BloomFilter* runtime_filter_;
+
+  // Runtime filters are optional (i.e. they can be ignored and the results will be
   // correct). Keep track of stats to determine if the filter is not effective. If
-  // the number of rows filtered out is too low, this is not worth the cost.
+  // the number of rows filtered out is too low, this is not worth the cost and the
+  // filter is disabled for the rest of the column.
   // TODO: this should be cost based taking into account how much we save when we
   // filter a row.
+  bool runtime_filter_disabled_;
   int64_t rows_returned_;
-  int64_t bitmap_filter_rows_rejected_;
+  int64_t runtime_filter_rows_rejected_;
 
   BaseColumnReader(HdfsParquetScanner* parent, const SlotDescriptor* desc, int file_idx)
     : parent_(parent),
@@ -220,18 +289,57 @@ class HdfsParquetScanner::BaseColumnReader {
       stream_(NULL),
       decompressed_data_pool_(new MemPool(parent->scan_node_->mem_tracker())),
       num_buffered_values_(0),
-      num_values_read_(0) {
-    RuntimeState* state = parent_->scan_node_->runtime_state();
-    bitmap_filter_ = state->GetBitmapFilter(desc_->id());
-    hash_seed_ = state->fragment_hash_seed();
+      num_values_read_(0),
+      skip_current_page_(false),
+      page_header_buffered_(false),
+      dict_filter_rejects_all_(false),
+      dict_filter_rows_rejected_(0),
+      topn_filter_rows_rejected_(0) {
+    runtime_filter_ = NULL;
+    runtime_filter_disabled_ = false;
     rows_returned_ = 0;
-    bitmap_filter_rows_rejected_ = 0;
+    runtime_filter_rows_rejected_ = 0;
+  }
+
+  // Looks up runtime_filter_ if it has not been found yet, and disables it if it does
+  // not reject enough rows. Called for each data page.
+  void UpdateRuntimeFilter() {
+    if (runtime_filter_disabled_) return;
+    if (runtime_filter_ == NULL) {
+      runtime_filter_ =
+          parent_->scan_node_->runtime_state()->GetBloomFilter(desc_->id());
+      // Only count the rows the filter was applied to.
+      rows_returned_ = 0;
+      runtime_filter_rows_rejected_ = 0;
+      return;
+    }
+    // TODO: how to pick the selectivity?
+    if (rows_returned_ > 10000 && runtime_filter_rows_rejected_ < rows_returned_ * .1) {
+      runtime_filter_ = NULL;
+      runtime_filter_disabled_ = true;
+    }
   }
 
   // Read the next data page.  If a dictionary page is encountered, that will
   // be read and this function will continue reading for the next data page.
   Status ReadDataPage();
 
+  // Reads the dictionary page at the start of the column chunk, if there is one, and
+  // evaluates dict_filter_conjuncts_ on it. No data page is read, so this can decide
+  // whether the row group is needed at all. Must be called before ReadDataPage().
+  Status ReadDictionaryPage();
+
+  // Reads the header of the next page into current_page_header_ and skips past it.
+  Status ReadPageHeader();
+
+  // Reads the body of the dictionary page whose header is in current_page_header_ and
+  // creates the dictionary decoder.
+  Status ReadDictionary();
+
+  // Reads the next data page if all values of the current one were read. Returns false
+  // if there are no more values or the page could not be read.
+  bool NextDataPageIfNeeded();
+
   // Returns the definition level for the next value
   // Returns -1 if there was a error parsing it.
   int ReadDefinitionLevel();
@@ -240,6 +348,21 @@ class HdfsParquetScanner::BaseColumnReader {
   // and set dict_decoder_base_.
   virtual void CreateDictionaryDecoder(uint8_t* values, int size) = 0;
 
+  // Writes the dictionary entry at 'index' into *slot using pool if necessary.
+  // Subclass must implement this.
+  virtual void WriteDictEntry(int index, void* slot, MemPool* pool) = 0;
+
+  // Evaluates dict_filter_conjuncts_ for each entry of the dictionary just read.
+  void EvalDictFilter();
+
+  // Sets *conjuncts_failed if topn_filter_ rejects 'value', which is NULL for a NULL
+  // value.
+  void EvalTopNFilter(const void* value, bool* conjuncts_failed) {
+    if (*conjuncts_failed || !topn_filter_.Rejects(value)) return;
+    *conjuncts_failed = true;
+    ++topn_filter_rows_rejected_;
+  }
+
   // Initializes the reader with the data contents. This is the content for
   // the entire decompressed data page. Decoders can initialize state from
   // here.
@@ -250,6 +373,11 @@ class HdfsParquetScanner::BaseColumnReader {
   // Subclass must implement this.
   // TODO: we need to remove this with codegen.
   virtual bool ReadSlot(void* slot, MemPool* pool, bool* conjuncts_failed) = 0;
+
+  // Skips the next 'num_values' non-null values of the current data page. Returns
+  // false if there was an error.
+  // Subclass must implement this.
+  virtual bool SkipSlots(int num_values) = 0;
 };
 
 // Per column type reader.
@@ -275,6 +403,16 @@ class HdfsParquetScanner::ColumnReader : public HdfsParquetScanner::BaseColumnRe
     dict_decoder_base_ = dict_decoder_.get();
   }
 
+  virtual void WriteDictEntry(int index, void* slot, MemPool* pool) {
+    if (needs_conversion_) {
+      T val;
+      dict_decoder_->GetEntry(index, &val);
+      ConvertSlot(&val, slot, pool);
+    } else {
+      dict_decoder_->GetEntry(index, reinterpret_cast<T*>(slot));
+    }
+  }
+
   virtual Status InitDataPage(uint8_t* data, int size) {
     if (current_page_header_.data_page_header.encoding ==
           parquet::Encoding::PLAIN_DICTIONARY) {
@@ -284,13 +422,7 @@ class HdfsParquetScanner::ColumnReader : public HdfsParquetScanner::BaseColumnRe
       dict_decoder_->SetData(data, size);
     }
 
-    // Check if we should disable the bitmap filter. We'll do this if the filter
-    // is not removing a lot of rows.
-    // TODO: how to pick the selectivity?
-    if (bitmap_filter_ != NULL && rows_returned_ > 10000 &&
-        bitmap_filter_rows_rejected_ < rows_returned_ * .1) {
-      bitmap_filter_ = NULL;
-    }
+    UpdateRuntimeFilter();
     return Status::OK;
   }
 
@@ -303,7 +435,23 @@ class HdfsParquetScanner::ColumnReader : public HdfsParquetScanner::BaseColumnRe
     T val;
     T* val_ptr = needs_conversion_ ? &val : reinterpret_cast<T*>(slot);
     if (page_encoding == parquet::Encoding::PLAIN_DICTIONARY) {
-      result = dict_decoder_->GetValue(val_ptr);
+      if (dict_filter_.empty()) {
+        result = dict_decoder_->GetValue(val_ptr);
+        if (!result) SetDictDecodeError();
+      } else {
+        int index;
+        if (!dict_decoder_->GetIndex(&index)) {
+          SetDictDecodeError();
+          return false;
+        }
+        if (!dict_filter_[index]) {
+          // The value does not need to be written since the row is not returned.
+          *conjuncts_failed = true;
+          ++dict_filter_rows_rejected_;
+          return true;
+        }
+        dict_decoder_->GetEntry(index, val_ptr);
+      }
     } else {
       DCHECK(page_encoding == parquet::Encoding::PLAIN);
       data_ += ParquetPlainEncoder::Decode<T>(data_, fixed_len_size_, val_ptr);
@@ -313,15 +461,33 @@ class HdfsParquetScanner::ColumnReader : public HdfsParquetScanner::BaseColumnRe
     } else if (needs_compaction) {
       CopySlot(reinterpret_cast<T*>(slot), pool);
     }
+    EvalTopNFilter(slot, conjuncts_failed);
     ++rows_returned_;
-    if (!*conjuncts_failed && bitmap_filter_ != NULL) {
-      uint32_t h = RawValue::GetHashValue(slot, desc_->type(), hash_seed_);
-      *conjuncts_failed = !bitmap_filter_->Get<true>(h);
-      ++bitmap_filter_rows_rejected_;
+    if (!*conjuncts_failed && runtime_filter_ != NULL) {
+      uint32_t h = RawValue::GetHashValue(slot, desc_->type(),
+          RuntimeState::RUNTIME_FILTER_HASH_SEED);
+      *conjuncts_failed = !runtime_filter_->Find(h);
+      if (*conjuncts_failed) ++runtime_filter_rows_rejected_;
     }
     return result;
   }
 
+  virtual bool SkipSlots(int num_values) {
+    if (current_page_header_.data_page_header.encoding ==
+          parquet::Encoding::PLAIN_DICTIONARY) {
+      bool valid = dict_decoder_->SkipValues(num_values);
+      if (!valid) SetDictDecodeError();
+      return valid;
+    }
+    DCHECK(current_page_header_.data_page_header.encoding == parquet::Encoding::PLAIN);
+    // Plain values are still parsed to find the next one, but not copied or converted.
+    T val;
+    for (int i = 0; i < num_values; ++i) {
+      data_ += ParquetPlainEncoder::Decode<T>(data_, fixed_len_size_, &val);
+    }
+    return true;
+  }
+
  private:
   void CopySlot(T* slot, MemPool* pool) {
     // no-op for non-string columns.
@@ -332,6 +498,10 @@ class HdfsParquetScanner::ColumnReader : public HdfsParquetScanner::BaseColumnRe
     DCHECK(false);
   }
 
+  void SetDictDecodeError() {
+    parent_->parse_status_ = Status("Invalid dictionary encoded column.");
+  }
+
   scoped_ptr<DictDecoder<T> > dict_decoder_;
 
   // true decoded values must be converted before being written to an output tuple
@@ -384,6 +554,10 @@ class HdfsParquetScanner::BoolColumnReader : public HdfsParquetScanner::BaseColu
                   << "have gotten this far.";
   }
 
+  virtual void WriteDictEntry(int index, void* slot, MemPool* pool) {
+    DCHECK(false);
+  }
+
   virtual Status InitDataPage(uint8_t* data, int size) {
     // Initialize bool decoder
     bool_values_ = BitReader(data, size);
@@ -393,6 +567,13 @@ class HdfsParquetScanner::BoolColumnReader : public HdfsParquetScanner::BaseColu
   virtual bool ReadSlot(void* slot, MemPool* pool, bool* conjuncts_failed)  {
     bool valid = bool_values_.GetValue(1, reinterpret_cast<bool*>(slot));
     if (!valid) parent_->parse_status_ = Status("Invalid bool column.");
+    EvalTopNFilter(slot, conjuncts_failed);
+    return valid;
+  }
+
+  virtual bool SkipSlots(int num_values) {
+    bool valid = bool_values_.SkipValues(1, num_values);
+    if (!valid) parent_->parse_status_ = Status("Invalid bool column.");
     return valid;
   }
 
@@ -406,6 +587,25 @@ Status HdfsParquetScanner::Prepare(ScannerContext* context) {
   RETURN_IF_ERROR(HdfsScanner::Prepare(context));
   num_cols_counter_ =
       ADD_COUNTER(scan_node_->runtime_profile(), "NumColumns", TCounterType::UNIT);
+  num_row_groups_skipped_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumRowGroupsSkipped", TCounterType::UNIT);
+  num_pages_skipped_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumPagesSkipped", TCounterType::UNIT);
+  num_dict_filtered_rows_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumDictFilteredRows", TCounterType::UNIT);
+  num_topn_filtered_rows_counter_ = ADD_COUNTER(
+      scan_node_->runtime_profile(), "NumTopNFilteredRows", TCounterType::UNIT);
+  InitMinMaxConjuncts();
+
+  if (FLAGS_enable_vectorized_exprs && !conjunct_ctxs_.empty()) {
+    column_batch_.reset(new ColumnBatch(state_->batch_size()));
+    if (VectorizedExpr::Create(state_->obj_pool(), state_, conjunct_ctxs_,
+        scan_node_->row_desc(), column_batch_.get(), &vectorized_conjuncts_)) {
+      rows_failed_.reset(new bool[column_batch_->capacity()]);
+    } else {
+      column_batch_.reset();
+    }
+  }
 
   scan_node_->IncNumScannersCodegenDisabled();
   return Status::OK;
@@ -494,10 +694,131 @@ static bool RequiresSkippedDictionaryHeaderCheck(
   return v.VersionEq(1,1,0) || (v.VersionEq(1,2,0) && v.is_impala_internal);
 }
 
-Status HdfsParquetScanner::BaseColumnReader::ReadDataPage() {
+Status HdfsParquetScanner::BaseColumnReader::ReadPageHeader() {
   Status status;
   uint8_t* buffer;
-  int num_bytes;
+  int64_t buffer_size;
+  RETURN_IF_ERROR(stream_->GetBuffer(true, &buffer, &buffer_size));
+  int num_bytes = min(buffer_size, static_cast<int64_t>(MAX_PAGE_HEADER_SIZE));
+  if (num_bytes == 0) {
+    DCHECK(stream_->eosr());
+    stringstream ss;
+    ss << "Column metadata states there are " << metadata_->num_values
+       << " values, but only read " << num_values_read_ << " values from column "
+       << (desc_->col_pos() - parent_->scan_node_->num_partition_keys());
+    if (parent_->scan_node_->runtime_state()->abort_on_error()) {
+      return Status(ss.str());
+    } else {
+      parent_->scan_node_->runtime_state()->LogError(ss.str());
+    }
+  }
+
+  // We don't know the actual header size until the thrift object is deserialized.
+  uint32_t header_size = num_bytes;
+  status = DeserializeThriftMsg(
+      buffer, &header_size, true, &current_page_header_, true);
+  if (!status.ok()) {
+    if (header_size >= MAX_PAGE_HEADER_SIZE) {
+      status.AddErrorMsg("ParquetScanner: Could not deserialize page header.");
+      return status;
+    }
+    // Stitch the header bytes that are split across buffers.
+    uint8_t header_buffer[MAX_PAGE_HEADER_SIZE];
+    int32_t header_first_part = header_size;
+    memcpy(header_buffer, buffer, header_first_part);
+
+    if (!stream_->SkipBytes(header_first_part, &status)) return status;
+    RETURN_IF_ERROR(stream_->GetBuffer(true, &buffer, &buffer_size));
+    num_bytes = min(buffer_size, static_cast<int64_t>(MAX_PAGE_HEADER_SIZE));
+    if (num_bytes == 0) return status;
+    uint32_t header_second_part = ::min(num_bytes,
+                                        MAX_PAGE_HEADER_SIZE - header_first_part);
+    memcpy(header_buffer + header_first_part, buffer, header_second_part);
+    header_size = MAX_PAGE_HEADER_SIZE;
+    status =
+        DeserializeThriftMsg(header_buffer, &header_size, true, &current_page_header_);
+
+    if (!status.ok()) {
+      status.AddErrorMsg("ParquetScanner: Could not deserialize page header");
+      return status;
+    }
+    DCHECK_GT(header_size, header_first_part);
+    header_size = header_size - header_first_part;
+  }
+  if (!stream_->SkipBytes(header_size, &status)) return status;
+  return Status::OK;
+}
+
+Status HdfsParquetScanner::BaseColumnReader::ReadDictionary() {
+  Status status;
+  int data_size = current_page_header_.compressed_page_size;
+  int uncompressed_size = current_page_header_.uncompressed_page_size;
+
+  if (dict_decoder_base_ != NULL) {
+    return Status("Column chunk should not contain two dictionary pages.");
+  }
+  if (desc_->type().type == TYPE_BOOLEAN) {
+    return Status("Unexpected dictionary page. Dictionary page is not"
+        " supported for booleans.");
+  }
+  const parquet::DictionaryPageHeader* dict_header = NULL;
+  if (current_page_header_.__isset.dictionary_page_header) {
+    dict_header = &current_page_header_.dictionary_page_header;
+  } else {
+    if (!RequiresSkippedDictionaryHeaderCheck(parent_->file_version_)) {
+      return Status("Dictionary page does not have dictionary header set.");
+    }
+  }
+  if (dict_header != NULL &&
+      dict_header->encoding != parquet::Encoding::PLAIN &&
+      dict_header->encoding != parquet::Encoding::PLAIN_DICTIONARY) {
+    return Status("Only PLAIN and PLAIN_DICTIONARY encodings are supported "
+        "for dictionary pages.");
+  }
+
+  if (!stream_->ReadBytes(data_size, &data_, &status)) return status;
+
+  uint8_t* dict_values = NULL;
+  if (decompressor_.get() != NULL) {
+    dict_values = parent_->dictionary_pool_->Allocate(uncompressed_size);
+    RETURN_IF_ERROR(decompressor_->ProcessBlock32(true, data_size, data_,
+        &uncompressed_size, &dict_values));
+    VLOG_FILE << "Decompressed " << data_size << " to " << uncompressed_size;
+    data_size = uncompressed_size;
+  } else {
+    DCHECK_EQ(data_size, current_page_header_.uncompressed_page_size);
+    // Copy dictionary from io buffer (which will be recycled as we read
+    // more data) to a new buffer
+    dict_values = parent_->dictionary_pool_->Allocate(data_size);
+    memcpy(dict_values, data_, data_size);
+  }
+
+  CreateDictionaryDecoder(dict_values, data_size);
+  if (dict_header != NULL &&
+      dict_header->num_values != dict_decoder_base_->num_entries()) {
+    return Status(Substitute(
+        "Invalid dictionary. Expected $0 entries but data contained $1 entries",
+        dict_header->num_values, dict_decoder_base_->num_entries()));
+  }
+  if (!dict_filter_conjuncts_.empty()) EvalDictFilter();
+  return Status::OK;
+}
+
+Status HdfsParquetScanner::BaseColumnReader::ReadDictionaryPage() {
+  DCHECK_EQ(num_values_read_, 0);
+  DCHECK(!page_header_buffered_);
+  if (metadata_->num_values == 0) return Status::OK;
+  RETURN_IF_ERROR(ReadPageHeader());
+  if (current_page_header_.type != parquet::PageType::DICTIONARY_PAGE) {
+    // Leave the page for ReadDataPage().
+    page_header_buffered_ = true;
+    return Status::OK;
+  }
+  return ReadDictionary();
+}
+
+Status HdfsParquetScanner::BaseColumnReader::ReadDataPage() {
+  Status status;
 
   // We're about to move to the next data page.  The previous data page is
   // now complete, pass along the memory allocated for it.
@@ -514,106 +835,17 @@ Status HdfsParquetScanner::BaseColumnReader::ReadDataPage() {
       break;
     }
 
-    int64_t buffer_size;
-    RETURN_IF_ERROR(stream_->GetBuffer(true, &buffer, &buffer_size));
-    num_bytes = min(buffer_size, static_cast<int64_t>(MAX_PAGE_HEADER_SIZE));
-    if (num_bytes == 0) {
-      DCHECK(stream_->eosr());
-      stringstream ss;
-      ss << "Column metadata states there are " << metadata_->num_values
-         << " values, but only read " << num_values_read_ << " values from column "
-         << (desc_->col_pos() - parent_->scan_node_->num_partition_keys());
-      if (parent_->scan_node_->runtime_state()->abort_on_error()) {
-        return Status(ss.str());
-      } else {
-        parent_->scan_node_->runtime_state()->LogError(ss.str());
-      }
-    }
-
-    // We don't know the actual header size until the thrift object is deserialized.
-    uint32_t header_size = num_bytes;
-    status = DeserializeThriftMsg(
-        buffer, &header_size, true, &current_page_header_, true);
-    if (!status.ok()) {
-      if (header_size >= MAX_PAGE_HEADER_SIZE) {
-        status.AddErrorMsg("ParquetScanner: Could not deserialize page header.");
-        return status;
-      }
-      // Stitch the header bytes that are split across buffers.
-      uint8_t header_buffer[MAX_PAGE_HEADER_SIZE];
-      int32_t header_first_part = header_size;
-      memcpy(header_buffer, buffer, header_first_part);
-
-      if (!stream_->SkipBytes(header_first_part, &status)) return status;
-      RETURN_IF_ERROR(stream_->GetBuffer(true, &buffer, &buffer_size));
-      num_bytes = min(buffer_size, static_cast<int64_t>(MAX_PAGE_HEADER_SIZE));
-      if (num_bytes == 0) return status;
-      uint32_t header_second_part = ::min(num_bytes,
-                                          MAX_PAGE_HEADER_SIZE - header_first_part);
-      memcpy(header_buffer + header_first_part, buffer, header_second_part);
-      header_size = MAX_PAGE_HEADER_SIZE;
-      status =
-          DeserializeThriftMsg(header_buffer, &header_size, true, &current_page_header_);
-
-      if (!status.ok()) {
-        status.AddErrorMsg("ParquetScanner: Could not deserialize page header");
-        return status;
-      }
-      DCHECK_GT(header_size, header_first_part);
-      header_size = header_size - header_first_part;
+    if (page_header_buffered_) {
+      page_header_buffered_ = false;
+    } else {
+      RETURN_IF_ERROR(ReadPageHeader());
     }
-    if (!stream_->SkipBytes(header_size, &status)) return status;
 
     int data_size = current_page_header_.compressed_page_size;
     int uncompressed_size = current_page_header_.uncompressed_page_size;
 
     if (current_page_header_.type == parquet::PageType::DICTIONARY_PAGE) {
-      if (dict_decoder_base_ != NULL) {
-        return Status("Column chunk should not contain two dictionary pages.");
-      }
-      if (desc_->type().type == TYPE_BOOLEAN) {
-        return Status("Unexpected dictionary page. Dictionary page is not"
-            " supported for booleans.");
-      }
-      const parquet::DictionaryPageHeader* dict_header = NULL;
-      if (current_page_header_.__isset.dictionary_page_header) {
-        dict_header = &current_page_header_.dictionary_page_header;
-      } else {
-        if (!RequiresSkippedDictionaryHeaderCheck(parent_->file_version_)) {
-          return Status("Dictionary page does not have dictionary header set.");
-        }
-      }
-      if (dict_header != NULL &&
-          dict_header->encoding != parquet::Encoding::PLAIN &&
-          dict_header->encoding != parquet::Encoding::PLAIN_DICTIONARY) {
-        return Status("Only PLAIN and PLAIN_DICTIONARY encodings are supported "
-            "for dictionary pages.");
-      }
-
-      if (!stream_->ReadBytes(data_size, &data_, &status)) return status;
-
-      uint8_t* dict_values = NULL;
-      if (decompressor_.get() != NULL) {
-        dict_values = parent_->dictionary_pool_->Allocate(uncompressed_size);
-        RETURN_IF_ERROR(decompressor_->ProcessBlock32(true, data_size, data_,
-            &uncompressed_size, &dict_values));
-        VLOG_FILE << "Decompressed " << data_size << " to " << uncompressed_size;
-        data_size = uncompressed_size;
-      } else {
-        DCHECK_EQ(data_size, current_page_header_.uncompressed_page_size);
-        // Copy dictionary from io buffer (which will be recycled as we read
-        // more data) to a new buffer
-        dict_values = parent_->dictionary_pool_->Allocate(data_size);
-        memcpy(dict_values, data_, data_size);
-      }
-
-      CreateDictionaryDecoder(dict_values, data_size);
-      if (dict_header != NULL &&
-          dict_header->num_values != dict_decoder_base_->num_entries()) {
-        return Status(Substitute(
-            "Invalid dictionary. Expected $0 entries but data contained $1 entries",
-            dict_header->num_values, dict_decoder_base_->num_entries()));
-      }
+      RETURN_IF_ERROR(ReadDictionary());
       // Done with dictionary page, read next page
       continue;
     }
@@ -624,10 +856,25 @@ Status HdfsParquetScanner::BaseColumnReader::ReadDataPage() {
       continue;
     }
 
-    // Read Data Page
-    if (!stream_->ReadBytes(data_size, &data_, &status)) return status;
     num_buffered_values_ = current_page_header_.data_page_header.num_values;
     num_values_read_ += num_buffered_values_;
+    parent_->scan_node_->GetTopNFilter(desc_->id(), &topn_filter_);
+
+    skip_current_page_ = (dict_filter_rejects_all_ &&
+        current_page_header_.data_page_header.encoding ==
+            parquet::Encoding::PLAIN_DICTIONARY) ||
+        (!min_max_conjuncts_.empty() &&
+        current_page_header_.data_page_header.__isset.statistics &&
+        parent_->StatisticsRejectAll(min_max_conjuncts_,
+            current_page_header_.data_page_header.statistics, num_buffered_values_));
+    if (skip_current_page_) {
+      COUNTER_ADD(parent_->num_pages_skipped_counter_, 1);
+      if (!stream_->SkipBytes(data_size, &status)) return status;
+      break;
+    }
+
+    // Read Data Page
+    if (!stream_->ReadBytes(data_size, &data_, &status)) return status;
 
     if (decompressor_.get() != NULL) {
       SCOPED_TIMER(parent_->decompress_timer_);
@@ -679,6 +926,32 @@ Status HdfsParquetScanner::BaseColumnReader::ReadDataPage() {
   return Status::OK;
 }
 
+void HdfsParquetScanner::BaseColumnReader::EvalDictFilter() {
+  MemPool* pool = parent_->dictionary_pool_.get();
+  uint8_t* tuple_mem = pool->Allocate(parent_->tuple_byte_size_);
+  memset(tuple_mem, 0, parent_->tuple_byte_size_);
+  Tuple* tuple = reinterpret_cast<Tuple*>(tuple_mem);
+  int row_size = parent_->scan_node_->row_desc().GetRowSize();
+  TupleRow* row = reinterpret_cast<TupleRow*>(pool->Allocate(row_size));
+  memset(row, 0, row_size);
+  row->SetTuple(parent_->scan_node_->tuple_idx(), tuple);
+
+  ExprContext* const* ctxs = &dict_filter_conjuncts_[0];
+  int num_ctxs = dict_filter_conjuncts_.size();
+  int num_entries = dict_decoder_base_->num_entries();
+  void* slot = tuple->GetSlot(desc_->tuple_offset());
+  dict_filter_.resize(num_entries);
+  bool any_passes = false;
+  for (int i = 0; i < num_entries; ++i) {
+    WriteDictEntry(i, slot, pool);
+    dict_filter_[i] = ExecNode::EvalConjuncts(ctxs, num_ctxs, row);
+    any_passes |= dict_filter_[i];
+  }
+  tuple->SetNull(desc_->null_indicator_offset());
+  any_passes |= ExecNode::EvalConjuncts(ctxs, num_ctxs, row);
+  dict_filter_rejects_all_ = !any_passes;
+}
+
 // TODO More codegen here as well.
 inline int HdfsParquetScanner::BaseColumnReader::ReadDefinitionLevel() {
   if (field_repetition_type_ == parquet::FieldRepetitionType::REQUIRED) {
@@ -704,8 +977,7 @@ inline int HdfsParquetScanner::BaseColumnReader::ReadDefinitionLevel() {
   return definition_level;
 }
 
-inline bool HdfsParquetScanner::BaseColumnReader::ReadValue(
-    MemPool* pool, Tuple* tuple, bool* conjuncts_failed) {
+inline bool HdfsParquetScanner::BaseColumnReader::NextDataPageIfNeeded() {
   if (num_buffered_values_ == 0) {
     parent_->assemble_rows_timer_.Stop();
     parent_->parse_status_ = ReadDataPage();
@@ -715,14 +987,25 @@ inline bool HdfsParquetScanner::BaseColumnReader::ReadValue(
     if (num_buffered_values_ == 0 || !parent_->parse_status_.ok()) return false;
     parent_->assemble_rows_timer_.Start();
   }
+  return true;
+}
+
+inline bool HdfsParquetScanner::BaseColumnReader::ReadValue(
+    MemPool* pool, Tuple* tuple, bool* conjuncts_failed) {
+  if (!NextDataPageIfNeeded()) return false;
 
   --num_buffered_values_;
+  if (skip_current_page_) {
+    *conjuncts_failed = true;
+    return true;
+  }
   int definition_level = ReadDefinitionLevel();
   if (definition_level < 0) return false;
 
   if (definition_level == 0) {
     // Null value
     tuple->SetNull(desc_->null_indicator_offset());
+    EvalTopNFilter(NULL, conjuncts_failed);
     return true;
   }
 
@@ -730,6 +1013,54 @@ inline bool HdfsParquetScanner::BaseColumnReader::ReadValue(
   return ReadSlot(tuple->GetSlot(desc_->tuple_offset()), pool, conjuncts_failed);
 }
 
+int HdfsParquetScanner::BaseColumnReader::ReadValueBatch(MemPool* pool, int num_rows,
+    ColumnVector* column, bool* rows_failed) {
+  bool* nulls = column->nulls();
+  for (int i = 0; i < num_rows; ++i) {
+    if (!NextDataPageIfNeeded()) return i;
+    --num_buffered_values_;
+    if (skip_current_page_) {
+      rows_failed[i] = true;
+      nulls[i] = true;
+      continue;
+    }
+    int definition_level = ReadDefinitionLevel();
+    if (definition_level < 0) return i;
+    nulls[i] = definition_level == 0;
+    if (nulls[i]) {
+      EvalTopNFilter(NULL, &rows_failed[i]);
+      continue;
+    }
+    DCHECK_EQ(definition_level, 1);
+    if (!ReadSlot(column->GetSlot(i), pool, &rows_failed[i])) return i;
+  }
+  return num_rows;
+}
+
+int HdfsParquetScanner::BaseColumnReader::SkipValues(int num_rows) {
+  int num_skipped = 0;
+  while (num_skipped < num_rows) {
+    if (!NextDataPageIfNeeded()) return num_skipped;
+    int num_values = min(num_rows - num_skipped, num_buffered_values_);
+    if (!skip_current_page_) {
+      // Only the non-null values are stored in the data.
+      int num_non_null = num_values;
+      if (field_repetition_type_ != parquet::FieldRepetitionType::REQUIRED) {
+        num_non_null = 0;
+        for (int i = 0; i < num_values; ++i) {
+          int definition_level = ReadDefinitionLevel();
+          if (definition_level < 0) return num_skipped;
+          num_non_null += definition_level;
+        }
+      }
+      if (num_non_null > 0 && !SkipSlots(num_non_null)) return num_skipped;
+    }
+    num_buffered_values_ -= num_values;
+    num_skipped += num_values;
+  }
+  return num_rows;
+}
+
 Status HdfsParquetScanner::ProcessSplit() {
   HdfsFileDesc* file_desc = scan_node_->GetFileDesc(stream_->filename());
   DCHECK(file_desc != NULL);
@@ -758,7 +1089,9 @@ Status HdfsParquetScanner::ProcessSplit() {
     // Commit the rows to flush the row batch from the previous row group
     CommitRows(0);
 
-    RETURN_IF_ERROR(InitColumns(i));
+    bool skip_row_group;
+    RETURN_IF_ERROR(InitColumns(i, &skip_row_group));
+    if (skip_row_group) continue;
     RETURN_IF_ERROR(AssembleRows(i));
   }
 
@@ -785,40 +1118,36 @@ Status HdfsParquetScanner::AssembleRows(int row_group_idx) {
     int64_t num_rows = std::min(expected_rows_to_read, row_mem_limit);
 
     int num_to_commit = 0;
-    if (num_column_readers > 0) {
+    if (column_batch_.get() != NULL) {
+      num_rows = min<int64_t>(num_rows, column_batch_->capacity());
+      int ended_reader = -1;
+      int num_assembled = AssembleRowsVectorized(
+          pool, num_rows, tuple, row, &num_to_commit, &ended_reader);
+      if (ended_reader >= 0) {
+        return ColumnEnded(row_group_idx, ended_reader, rows_read, num_assembled,
+            num_to_commit);
+      }
+    } else if (!filter_readers_.empty() && !other_readers_.empty()) {
+      int ended_reader = -1;
+      int num_assembled = AssembleRowsLateMaterialized(
+          pool, num_rows, tuple, row, &num_to_commit, &ended_reader);
+      if (ended_reader >= 0) {
+        return ColumnEnded(row_group_idx, ended_reader, rows_read, num_assembled,
+            num_to_commit);
+      }
+    } else if (num_column_readers > 0) {
       for (int i = 0; i < num_rows; ++i) {
         bool conjuncts_failed = false;
         InitTuple(template_tuple_, tuple);
         for (int c = 0; c < num_column_readers; ++c) {
           if (!column_readers_[c]->ReadValue(pool, tuple, &conjuncts_failed)) {
-            assemble_rows_timer_.Stop();
             // This column is complete and has no more data.  This indicates
             // we are done with this row group.
             // For correctly formed files, this should be the first column we
             // are reading.
             DCHECK(c == 0 || !parse_status_.ok())
               << "c=" << c << " " << parse_status_.GetErrorMsg();;
-            COUNTER_ADD(scan_node_->rows_read_counter(), i);
-            RETURN_IF_ERROR(CommitRows(num_to_commit));
-
-            // If we reach this point, it means that we reached the end of file for
-            // this column. Test if the expected number of rows from metadata matches
-            // the actual number of rows in the file.
-            rows_read += i;
-            if (rows_read != expected_rows_in_group) {
-              HdfsParquetScanner::BaseColumnReader* reader = column_readers_[c];
-              DCHECK(reader->stream_ != NULL);
-              stringstream ss;
-              ss << "Metadata states that in group " << reader->stream_->filename()
-                 << "[" << row_group_idx << "] there are " << expected_rows_in_group
-                 << " rows, but only " << rows_read << " rows were read.";
-              if (scan_node_->runtime_state()->abort_on_error()) {
-                return Status(ss.str());
-              } else {
-                scan_node_->runtime_state()->LogError(ss.str());
-              }
-            }
-            return parse_status_;
+            return ColumnEnded(row_group_idx, c, rows_read, i, num_to_commit);
           }
         }
         if (conjuncts_failed) continue;
@@ -887,6 +1216,153 @@ Status HdfsParquetScanner::AssembleRows(int row_group_idx) {
   return parse_status_;
 }
 
+int HdfsParquetScanner::AssembleRowsVectorized(MemPool* pool, int num_rows,
+    Tuple* tuple, TupleRow* row, int* num_to_commit, int* ended_reader) {
+  DCHECK_LE(num_rows, column_batch_->capacity());
+  bool* rows_failed = rows_failed_.get();
+  memset(rows_failed, 0, num_rows);
+
+  // Decode the columns of the conjuncts. All columns have the same number of values,
+  // so if one ends early the others are only read up to the same row.
+  for (int c = 0; c < filter_readers_.size(); ++c) {
+    BaseColumnReader* reader = column_readers_[filter_readers_[c]];
+    int num_read = reader->ReadValueBatch(pool, num_rows, filter_columns_[c],
+        rows_failed);
+    if (num_read < num_rows) {
+      DCHECK(c == 0 || !parse_status_.ok())
+        << "c=" << c << " " << parse_status_.GetErrorMsg();
+      num_rows = num_read;
+      *ended_reader = filter_readers_[c];
+    }
+  }
+
+  // Evaluate the conjuncts over the rows that were not rejected while decoding.
+  column_batch_->Reset(num_rows);
+  int* selection = column_batch_->selection();
+  int num_selected = 0;
+  for (int i = 0; i < num_rows; ++i) {
+    selection[num_selected] = i;
+    num_selected += !rows_failed[i];
+  }
+  column_batch_->set_num_selected(num_selected);
+  VectorizedExpr::EvalConjuncts(vectorized_conjuncts_, column_batch_.get());
+  num_selected = column_batch_->num_selected();
+
+  // Materialize the rows that passed. The other columns are only decoded for them, and
+  // skipped for the runs of rows in between.
+  int row_idx = 0;
+  for (int s = 0; s < num_selected; ++s) {
+    int selected_row = selection[s];
+    if (!SkipOtherColumns(selected_row - row_idx, ended_reader)) return row_idx;
+    row_idx = selected_row;
+
+    InitTuple(template_tuple_, tuple);
+    bool conjuncts_failed = false;
+    for (int c = 0; c < other_readers_.size(); ++c) {
+      BaseColumnReader* reader = column_readers_[other_readers_[c]];
+      if (!reader->ReadValue(pool, tuple, &conjuncts_failed)) {
+        *ended_reader = other_readers_[c];
+        return row_idx;
+      }
+    }
+    ++row_idx;
+    // Runtime filters on the other columns can still reject the row.
+    if (conjuncts_failed) continue;
+    for (int c = 0; c < filter_columns_.size(); ++c) {
+      filter_columns_[c]->Scatter(selected_row, tuple);
+    }
+    row->SetTuple(scan_node_->tuple_idx(), tuple);
+    row = next_row(row);
+    tuple = next_tuple(tuple);
+    ++*num_to_commit;
+  }
+  if (!SkipOtherColumns(num_rows - row_idx, ended_reader)) return row_idx;
+  return num_rows;
+}
+
+int HdfsParquetScanner::AssembleRowsLateMaterialized(MemPool* pool, int num_rows,
+    Tuple* tuple, TupleRow* row, int* num_to_commit, int* ended_reader) {
+  // The number of rows that failed since the other columns were last read.
+  int num_to_skip = 0;
+  for (int i = 0; i < num_rows; ++i) {
+    bool conjuncts_failed = false;
+    InitTuple(template_tuple_, tuple);
+    for (int c = 0; c < filter_readers_.size(); ++c) {
+      BaseColumnReader* reader = column_readers_[filter_readers_[c]];
+      if (!reader->ReadValue(pool, tuple, &conjuncts_failed)) {
+        DCHECK(c == 0 || !parse_status_.ok())
+          << "c=" << c << " " << parse_status_.GetErrorMsg();
+        *ended_reader = filter_readers_[c];
+        return i;
+      }
+    }
+    if (!conjuncts_failed) {
+      // The slots of the other columns are not set yet, but the conjuncts do not
+      // reference them.
+      row->SetTuple(scan_node_->tuple_idx(), tuple);
+      conjuncts_failed = !EvalConjuncts(row);
+    }
+    if (conjuncts_failed) {
+      ++num_to_skip;
+      continue;
+    }
+
+    if (!SkipOtherColumns(num_to_skip, ended_reader)) return i;
+    num_to_skip = 0;
+    for (int c = 0; c < other_readers_.size(); ++c) {
+      BaseColumnReader* reader = column_readers_[other_readers_[c]];
+      if (!reader->ReadValue(pool, tuple, &conjuncts_failed)) {
+        *ended_reader = other_readers_[c];
+        return i;
+      }
+    }
+    if (conjuncts_failed) continue;
+    row = next_row(row);
+    tuple = next_tuple(tuple);
+    ++*num_to_commit;
+  }
+  if (!SkipOtherColumns(num_to_skip, ended_reader)) return num_rows - num_to_skip;
+  return num_rows;
+}
+
+bool HdfsParquetScanner::SkipOtherColumns(int num_rows, int* ended_reader) {
+  if (num_rows == 0) return true;
+  for (int c = 0; c < other_readers_.size(); ++c) {
+    if (column_readers_[other_readers_[c]]->SkipValues(num_rows) < num_rows) {
+      *ended_reader = other_readers_[c];
+      return false;
+    }
+  }
+  return true;
+}
+
+Status HdfsParquetScanner::ColumnEnded(int row_group_idx, int c, int64_t rows_read,
+    int num_rows, int num_to_commit) {
+  assemble_rows_timer_.Stop();
+  COUNTER_ADD(scan_node_->rows_read_counter(), num_rows);
+  RETURN_IF_ERROR(CommitRows(num_to_commit));
+
+  // If we reach this point, it means that we reached the end of file for
+  // this column. Test if the expected number of rows from metadata matches
+  // the actual number of rows in the file.
+  int64_t expected_rows_in_group = file_metadata_.row_groups[row_group_idx].num_rows;
+  rows_read += num_rows;
+  if (rows_read != expected_rows_in_group) {
+    HdfsParquetScanner::BaseColumnReader* reader = column_readers_[c];
+    DCHECK(reader->stream_ != NULL);
+    stringstream ss;
+    ss << "Metadata states that in group " << reader->stream_->filename()
+       << "[" << row_group_idx << "] there are " << expected_rows_in_group
+       << " rows, but only " << rows_read << " rows were read.";
+    if (scan_node_->runtime_state()->abort_on_error()) {
+      return Status(ss.str());
+    } else {
+      scan_node_->runtime_state()->LogError(ss.str());
+    }
+  }
+  return parse_status_;
+}
+
 Status HdfsParquetScanner::ProcessFooter(bool* eosr) {
   *eosr = false;
 
@@ -1032,19 +1508,122 @@ Status HdfsParquetScanner::CreateColumnReaders() {
       continue;
     }
 
-    column_readers_.push_back(CreateReader(slot_desc, col_idx));
+    BaseColumnReader* reader = CreateReader(slot_desc, col_idx);
+    vector<const MinMaxConjunct*> conjuncts;
+    for (int j = 0; j < min_max_conjuncts_.size(); ++j) {
+      if (min_max_conjuncts_[j]->slot_desc == slot_desc) {
+        conjuncts.push_back(min_max_conjuncts_[j]);
+      }
+    }
+    reader->set_min_max_conjuncts(conjuncts);
+    if (slot_desc->type().type != TYPE_BOOLEAN) {
+      vector<ExprContext*> dict_filter_conjuncts;
+      GetDictFilterConjuncts(slot_desc->id(), &dict_filter_conjuncts);
+      reader->set_dict_filter_conjuncts(dict_filter_conjuncts);
+    }
+    column_readers_.push_back(reader);
+  }
+
+  if (!conjunct_ctxs_.empty()) {
+    vector<SlotId> conjunct_slot_ids;
+    for (int i = 0; i < conjunct_ctxs_.size(); ++i) {
+      conjunct_ctxs_[i]->root()->GetSlotIds(&conjunct_slot_ids);
+    }
+    for (int i = 0; i < column_readers_.size(); ++i) {
+      SlotId slot_id = column_readers_[i]->slot_desc()->id();
+      if (find(conjunct_slot_ids.begin(), conjunct_slot_ids.end(), slot_id) !=
+          conjunct_slot_ids.end()) {
+        filter_readers_.push_back(i);
+      } else {
+        other_readers_.push_back(i);
+      }
+    }
+  }
+
+  if (column_batch_.get() != NULL) {
+    for (int i = 0; i < filter_readers_.size(); ++i) {
+      ColumnVector* column = column_batch_->GetColumn(
+          column_readers_[filter_readers_[i]]->slot_desc()->id());
+      if (column != NULL) filter_columns_.push_back(column);
+    }
+    // The conjuncts can only be evaluated on the decoded columns if all of their
+    // slots are read from the file, rather than e.g. set in the template tuple.
+    if (filter_columns_.size() != filter_readers_.size() ||
+        filter_columns_.size() != column_batch_->columns().size()) {
+      column_batch_.reset();
+      filter_columns_.clear();
+    }
   }
   return Status::OK;
 }
 
-Status HdfsParquetScanner::InitColumns(int row_group_idx) {
+// Builtins whose result can differ between calls with the same arguments, or that have
+// side effects, so their conjuncts cannot be evaluated once per dictionary entry.
+static const char* NONDETERMINISTIC_BUILTINS[] = { "rand", "sleep" };
+
+// Returns true if 'expr' only calls builtins that are not in NONDETERMINISTIC_BUILTINS.
+// UDFs and UDAs are treated as non-deterministic since nothing is known about them.
+static bool IsDeterministic(Expr* expr) {
+  const TFunction& fn = expr->fn();
+  if (!fn.name.function_name.empty()) {
+    if (fn.binary_type != TFunctionBinaryType::BUILTIN) return false;
+    if (fn.__isset.aggregate_fn) return false;
+    for (int i = 0; i < sizeof(NONDETERMINISTIC_BUILTINS) / sizeof(char*); ++i) {
+      if (fn.name.function_name == NONDETERMINISTIC_BUILTINS[i]) return false;
+    }
+  }
+  for (int i = 0; i < expr->children().size(); ++i) {
+    if (!IsDeterministic(expr->GetChild(i))) return false;
+  }
+  return true;
+}
+
+void HdfsParquetScanner::GetDictFilterConjuncts(SlotId slot_id,
+    vector<ExprContext*>* ctxs) {
+  for (int i = 0; i < conjunct_ctxs_.size(); ++i) {
+    vector<SlotId> slot_ids;
+    conjunct_ctxs_[i]->root()->GetSlotIds(&slot_ids);
+    if (slot_ids.empty()) continue;
+    bool only_slot = true;
+    for (int j = 0; j < slot_ids.size(); ++j) only_slot &= slot_ids[j] == slot_id;
+    if (only_slot && IsDeterministic(conjunct_ctxs_[i]->root())) {
+      ctxs->push_back(conjunct_ctxs_[i]);
+    }
+  }
+}
+
+// Returns true if all data pages of the column chunk 'metadata' are dictionary encoded,
+// i.e. the dictionary holds all its values.
+static bool IsDictionaryEncoded(const parquet::ColumnMetaData& metadata) {
+  if (!metadata.__isset.dictionary_page_offset) return false;
+  for (int i = 0; i < metadata.encodings.size(); ++i) {
+    if (metadata.encodings[i] == parquet::Encoding::PLAIN) return false;
+  }
+  return true;
+}
+
+Status HdfsParquetScanner::InitColumns(int row_group_idx, bool* skip_row_group) {
   parquet::RowGroup& row_group = file_metadata_.row_groups[row_group_idx];
+  *skip_row_group = false;
+
+  for (int i = 0; i < column_readers_.size(); ++i) {
+    int file_col_idx = column_readers_[i]->file_idx();
+    RETURN_IF_ERROR(ValidateColumn(column_readers_[i]->desc_, file_col_idx));
+    const parquet::ColumnMetaData& metadata = row_group.columns[file_col_idx].meta_data;
+    if (!column_readers_[i]->min_max_conjuncts_.empty() &&
+        metadata.__isset.statistics &&
+        StatisticsRejectAll(column_readers_[i]->min_max_conjuncts_,
+            metadata.statistics, metadata.num_values)) {
+      COUNTER_ADD(num_row_groups_skipped_counter_, 1);
+      *skip_row_group = true;
+      return Status::OK;
+    }
+  }
 
   // All the scan ranges (one for each col).
   vector<DiskIoMgr::ScanRange*> col_ranges;
 
   for (int i = 0; i < column_readers_.size(); ++i) {
-    const SlotDescriptor* slot_desc = column_readers_[i]->desc_;
     int file_col_idx = column_readers_[i]->file_idx();
 
     const parquet::SchemaElement& schema_element =
@@ -1052,8 +1631,6 @@ Status HdfsParquetScanner::InitColumns(int row_group_idx) {
     const parquet::ColumnChunk& col_chunk = row_group.columns[file_col_idx];
     int64_t col_start = col_chunk.meta_data.data_page_offset;
 
-    RETURN_IF_ERROR(ValidateColumn(slot_desc, file_col_idx));
-
     // If there is a dictionary page, the file format requires it to come before
     // any data pages.  We need to start reading the column from the data page.
     if (col_chunk.meta_data.__isset.dictionary_page_offset) {
@@ -1113,6 +1690,20 @@ Status HdfsParquetScanner::InitColumns(int row_group_idx) {
   RETURN_IF_ERROR(scan_node_->runtime_state()->io_mgr()->AddScanRanges(
       scan_node_->reader_context(), col_ranges, true));
 
+  // Read the dictionaries of the columns with dictionary filters. If no entry of one
+  // of them passes the conjuncts and all its data pages are dictionary encoded, no row
+  // of the row group can pass.
+  for (int i = 0; i < column_readers_.size(); ++i) {
+    BaseColumnReader* reader = column_readers_[i];
+    if (reader->dict_filter_conjuncts_.empty()) continue;
+    if (!IsDictionaryEncoded(*reader->metadata_)) continue;
+    RETURN_IF_ERROR(reader->ReadDictionaryPage());
+    if (reader->dict_filter_rejects_all_) {
+      COUNTER_ADD(num_row_groups_skipped_counter_, 1);
+      *skip_row_group = true;
+      return Status::OK;
+    }
+  }
   return Status::OK;
 }
 
@@ -1336,3 +1927,242 @@ Status HdfsParquetScanner::ValidateColumn(const SlotDescriptor* slot_desc, int c
   return Status::OK;
 }
 
+
+// Returns a pointer to the field of 'value' that holds values of 'type', or NULL if
+// statistics are not evaluated for the type. CHAR is left out because the file holds
+// unpadded values while slots hold padded ones.
+static void* GetExprValueSlot(const ColumnType& type, ExprValue* value) {
+  switch (type.type) {
+    case TYPE_TINYINT: return &value->tinyint_val;
+    case TYPE_SMALLINT: return &value->smallint_val;
+    case TYPE_INT: return &value->int_val;
+    case TYPE_BIGINT: return &value->bigint_val;
+    case TYPE_FLOAT: return &value->float_val;
+    case TYPE_DOUBLE: return &value->double_val;
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      return &value->string_val;
+    case TYPE_TIMESTAMP: return &value->timestamp_val;
+    case TYPE_DECIMAL:
+      switch (type.GetByteSize()) {
+        case 4: return &value->decimal4_val;
+        case 8: return &value->decimal8_val;
+        case 16: return &value->decimal16_val;
+      }
+      DCHECK(false);
+      return NULL;
+    default:
+      return NULL;
+  }
+}
+
+// Decodes the min or max value 'encoded' of a parquet::Statistics into the field of
+// 'value' for 'type' and returns a pointer to it. Returns NULL if 'encoded' is not a
+// valid value of the type, or if it is a NaN. String values point into 'encoded'.
+static void* DecodeStatisticsValue(const string& encoded, const ColumnType& type,
+    ExprValue* value) {
+  void* slot = GetExprValueSlot(type, value);
+  DCHECK(slot != NULL);
+  uint8_t* data = reinterpret_cast<uint8_t*>(const_cast<char*>(encoded.data()));
+  int len = encoded.size();
+  switch (type.type) {
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      // VARCHAR values are truncated to the column's length when they are read. Since
+      // truncation preserves the order of the values, it can be applied to the min and
+      // max as well.
+      if (type.type == TYPE_VARCHAR) len = min(len, type.len);
+      value->string_val = StringValue(reinterpret_cast<char*>(data), len);
+      return slot;
+    case TYPE_DECIMAL: {
+      int fixed_len_size = ParquetPlainEncoder::DecimalSize(type);
+      if (len != fixed_len_size) return NULL;
+      switch (type.GetByteSize()) {
+        case 4:
+          ParquetPlainEncoder::Decode(data, fixed_len_size, &value->decimal4_val);
+          break;
+        case 8:
+          ParquetPlainEncoder::Decode(data, fixed_len_size, &value->decimal8_val);
+          break;
+        case 16:
+          ParquetPlainEncoder::Decode(data, fixed_len_size, &value->decimal16_val);
+          break;
+      }
+      return slot;
+    }
+    default:
+      break;
+  }
+  if (len != ParquetPlainEncoder::ByteSize(type)) return NULL;
+  switch (type.type) {
+    case TYPE_TINYINT:
+      ParquetPlainEncoder::Decode(data, -1, &value->tinyint_val);
+      break;
+    case TYPE_SMALLINT:
+      ParquetPlainEncoder::Decode(data, -1, &value->smallint_val);
+      break;
+    case TYPE_INT:
+      ParquetPlainEncoder::Decode(data, -1, &value->int_val);
+      break;
+    case TYPE_BIGINT:
+      ParquetPlainEncoder::Decode(data, -1, &value->bigint_val);
+      break;
+    case TYPE_FLOAT:
+      ParquetPlainEncoder::Decode(data, -1, &value->float_val);
+      if (isnan(value->float_val)) return NULL;
+      break;
+    case TYPE_DOUBLE:
+      ParquetPlainEncoder::Decode(data, -1, &value->double_val);
+      if (isnan(value->double_val)) return NULL;
+      break;
+    case TYPE_TIMESTAMP:
+      ParquetPlainEncoder::Decode(data, -1, &value->timestamp_val);
+      break;
+    default:
+      DCHECK(false);
+      return NULL;
+  }
+  return slot;
+}
+
+void HdfsParquetScanner::InitMinMaxConjuncts() {
+  const vector<SlotDescriptor*>& slots = scan_node_->materialized_slots();
+  for (int i = 0; i < conjunct_ctxs_.size(); ++i) {
+    Expr* root = conjunct_ctxs_[i]->root();
+    if (root->GetNumChildren() != 2) continue;
+    MinMaxConjunct::Op op;
+    const string& fn_name = root->fn_name();
+    if (fn_name == "eq") {
+      op = MinMaxConjunct::EQ;
+    } else if (fn_name == "lt") {
+      op = MinMaxConjunct::LT;
+    } else if (fn_name == "le") {
+      op = MinMaxConjunct::LE;
+    } else if (fn_name == "gt") {
+      op = MinMaxConjunct::GT;
+    } else if (fn_name == "ge") {
+      op = MinMaxConjunct::GE;
+    } else {
+      continue;
+    }
+
+    // Put the slot on the left-hand side.
+    Expr* slot_ref = root->GetChild(0);
+    Expr* constant = root->GetChild(1);
+    if (!slot_ref->is_slotref()) {
+      std::swap(slot_ref, constant);
+      if (op == MinMaxConjunct::LT) {
+        op = MinMaxConjunct::GT;
+      } else if (op == MinMaxConjunct::LE) {
+        op = MinMaxConjunct::GE;
+      } else if (op == MinMaxConjunct::GT) {
+        op = MinMaxConjunct::LT;
+      } else if (op == MinMaxConjunct::GE) {
+        op = MinMaxConjunct::LE;
+      }
+    }
+    // Literals are the only leaves that are neither slot refs nor function calls. Other
+    // constant exprs, e.g. rand(), may not return the same value for every row.
+    if (!slot_ref->is_slotref() || constant->is_slotref() ||
+        constant->GetNumChildren() != 0 || !constant->fn_name().empty()) {
+      continue;
+    }
+
+    const SlotDescriptor* slot_desc = NULL;
+    SlotId slot_id = static_cast<SlotRef*>(slot_ref)->slot_id();
+    for (int j = 0; j < slots.size(); ++j) {
+      if (slots[j]->id() == slot_id) slot_desc = slots[j];
+    }
+    if (slot_desc == NULL || !(constant->type() == slot_desc->type())) continue;
+
+    ExprValue scratch;
+    if (GetExprValueSlot(slot_desc->type(), &scratch) == NULL) continue;
+    void* value = conjunct_ctxs_[i]->GetValue(constant, NULL);
+    // Comparisons with NULL or NaN are never true, which is left to the conjuncts.
+    if (value == NULL) continue;
+    if (slot_desc->type().type == TYPE_FLOAT && isnan(*reinterpret_cast<float*>(value))) {
+      continue;
+    }
+    if (slot_desc->type().type == TYPE_DOUBLE &&
+        isnan(*reinterpret_cast<double*>(value))) {
+      continue;
+    }
+
+    MinMaxConjunct* conjunct =
+        scan_node_->runtime_state()->obj_pool()->Add(new MinMaxConjunct());
+    conjunct->slot_desc = slot_desc;
+    conjunct->op = op;
+    conjunct->value_ptr = GetExprValueSlot(slot_desc->type(), &conjunct->value);
+    if (slot_desc->type().IsStringType()) {
+      const StringValue* sv = reinterpret_cast<StringValue*>(value);
+      conjunct->value.GetStringData().assign(sv->ptr, sv->len);
+      conjunct->value.string_val = StringValue(
+          const_cast<char*>(conjunct->value.GetStringData().data()), sv->len);
+    } else {
+      memcpy(conjunct->value_ptr, value, slot_desc->type().GetByteSize());
+    }
+    min_max_conjuncts_.push_back(conjunct);
+  }
+}
+
+bool HdfsParquetScanner::StatisticsRejectAll(
+    const vector<const MinMaxConjunct*>& conjuncts, const parquet::Statistics& stats,
+    int64_t num_values) const {
+  DCHECK(!conjuncts.empty());
+  // NULLs fail every comparison.
+  if (stats.__isset.null_count && stats.null_count == num_values) return true;
+
+  const ColumnType& type = conjuncts[0]->slot_desc->type();
+  const string* encoded_min;
+  const string* encoded_max;
+  if (stats.__isset.min_value && stats.__isset.max_value) {
+    // Parquet leaves the order of INT96 timestamps undefined, so only Impala's are used.
+    if (type.type == TYPE_TIMESTAMP && file_version_.application != "impala") {
+      return false;
+    }
+    encoded_min = &stats.min_value;
+    encoded_max = &stats.max_value;
+  } else if (stats.__isset.min && stats.__isset.max) {
+    // Writers of the deprecated min and max ordered binary values as signed bytes, so
+    // they are only used for the types that are stored as ints and floats.
+    if (type.IsStringType() || type.type == TYPE_DECIMAL ||
+        type.type == TYPE_TIMESTAMP) {
+      return false;
+    }
+    encoded_min = &stats.min;
+    encoded_max = &stats.max;
+  } else {
+    return false;
+  }
+  ExprValue min_value;
+  ExprValue max_value;
+  void* min = DecodeStatisticsValue(*encoded_min, type, &min_value);
+  void* max = DecodeStatisticsValue(*encoded_max, type, &max_value);
+  if (min == NULL || max == NULL) return false;
+
+  for (int i = 0; i < conjuncts.size(); ++i) {
+    DCHECK(conjuncts[i]->slot_desc->type() == type);
+    const void* value = conjuncts[i]->value_ptr;
+    switch (conjuncts[i]->op) {
+      case MinMaxConjunct::EQ:
+        if (RawValue::Compare(value, min, type) < 0 ||
+            RawValue::Compare(value, max, type) > 0) {
+          return true;
+        }
+        break;
+      case MinMaxConjunct::LT:
+        if (RawValue::Compare(min, value, type) >= 0) return true;
+        break;
+      case MinMaxConjunct::LE:
+        if (RawValue::Compare(min, value, type) > 0) return true;
+        break;
+      case MinMaxConjunct::GT:
+        if (RawValue::Compare(max, value, type) <= 0) return true;
+        break;
+      case MinMaxConjunct::GE:
+        if (RawValue::Compare(max, value, type) < 0) return true;
+        break;
+    }
+  }
+  return false;
+}
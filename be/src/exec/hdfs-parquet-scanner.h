@@ -16,12 +16,18 @@
 #ifndef IMPALA_EXEC_HDFS_PARQUET_SCANNER_H
 #define IMPALA_EXEC_HDFS_PARQUET_SCANNER_H
 
+#include <boost/scoped_array.hpp>
+
 #include "exec/hdfs-scanner.h"
 #include "exec/parquet-common.h"
+#include "exprs/expr-value.h"
 
 namespace impala {
 
+class ColumnBatch;
+class ColumnVector;
 struct HdfsFileDesc;
+class VectorizedExpr;
 
 // This scanner parses Parquet files located in HDFS, and writes the
 // content as tuples in the Impala in-memory representation of data, e.g.
@@ -40,6 +46,19 @@ struct HdfsFileDesc;
 // Like the other scanners, each parquet scanner object is one to one with a
 // ScannerContext. Unlike the other scanners though, the context will have multiple
 // streams, one for each column.
+//
+// Conjuncts of the form '<slot> <op> <literal>' are also evaluated against the min/max
+// statistics of the column chunks and data pages. Row groups that cannot contain a
+// matching row are skipped before their columns are read, and data pages that cannot
+// contain a matching value are skipped without being decompressed; their rows fail the
+// conjuncts like rows rejected by a bitmap filter.
+//
+// Columns are materialized late: the columns referenced by the conjuncts are read
+// first and the conjuncts evaluated, and the other columns are only decoded for the
+// rows that pass. Their values for the other rows are skipped, a run at a time for
+// RLE/dictionary encoded pages. If all conjuncts can be vectorized (see
+// VectorizedExpr), the conjunct columns are decoded a batch of rows at a time into a
+// ColumnBatch and the conjuncts evaluated over it.
 class HdfsParquetScanner : public HdfsScanner {
  public:
   HdfsParquetScanner(HdfsScanNode* scan_node, RuntimeState* state);
@@ -127,11 +146,95 @@ class HdfsParquetScanner : public HdfsScanner {
   // Number of cols that need to be read.
   RuntimeProfile::Counter* num_cols_counter_;
 
+  // Number of row groups and data pages skipped because of their statistics or
+  // because none of their dictionary entries pass the conjuncts.
+  RuntimeProfile::Counter* num_row_groups_skipped_counter_;
+  RuntimeProfile::Counter* num_pages_skipped_counter_;
+
+  // Number of rows rejected by the dictionary filters of the column readers.
+  RuntimeProfile::Counter* num_dict_filtered_rows_counter_;
+
+  // Number of rows rejected by the filter of a TopNNode above the scan.
+  RuntimeProfile::Counter* num_topn_filtered_rows_counter_;
+
+  // A conjunct '<slot> <op> <constant>' that can be evaluated against the min and max
+  // statistics of the slot's column.
+  struct MinMaxConjunct {
+    enum Op { EQ, LT, LE, GT, GE };
+
+    const SlotDescriptor* slot_desc;
+
+    // The comparison, with the slot on the left-hand side.
+    Op op;
+
+    // The constant. 'value_ptr' points to the field of 'value' for the slot's type.
+    ExprValue value;
+    void* value_ptr;
+  };
+
+  // Conjuncts in conjunct_ctxs_ that can be evaluated against statistics. Owned by the
+  // runtime state's object pool.
+  std::vector<const MinMaxConjunct*> min_max_conjuncts_;
+
+  // Populates min_max_conjuncts_ from conjunct_ctxs_.
+  void InitMinMaxConjuncts();
+
+  // Returns true if the statistics 'stats' of a column chunk or data page with
+  // 'num_values' values show that none of its rows can pass all of 'conjuncts', which
+  // must all be on the same column. Statistics that can't be trusted are ignored.
+  bool StatisticsRejectAll(const std::vector<const MinMaxConjunct*>& conjuncts,
+      const parquet::Statistics& stats, int64_t num_values) const;
+
+  // The indexes in column_readers_ of the readers of the columns referenced by the
+  // conjuncts, and of the other readers. Both are empty if there are no conjuncts.
+  std::vector<int> filter_readers_;
+  std::vector<int> other_readers_;
+
+  // Returns the conjuncts in conjunct_ctxs_ that only reference the slot 'slot_id' and
+  // can be evaluated once per dictionary entry of its column, rather than per row.
+  void GetDictFilterConjuncts(SlotId slot_id, std::vector<ExprContext*>* ctxs);
+
+  // Set if all conjuncts are vectorized and the columns they reference are read from
+  // this file. column_batch_ holds the values of those columns, which the readers
+  // filter_readers_ decode into filter_columns_. NULL otherwise.
+  boost::scoped_ptr<ColumnBatch> column_batch_;
+  std::vector<VectorizedExpr*> vectorized_conjuncts_;
+  std::vector<ColumnVector*> filter_columns_;
+
+  // For each row of column_batch_, true if it was rejected while its columns were
+  // decoded, e.g. by a runtime filter.
+  boost::scoped_array<bool> rows_failed_;
+
   // Reads data from all the columns (in parallel) and assembles rows into the context
   // object.
   // Returns when the entire row group is complete or an error occurred.
   Status AssembleRows(int row_group_idx);
 
+  // Assembles the next 'num_rows' rows of the current row group into 'tuple' and 'row'
+  // like AssembleRows(), with the conjuncts evaluated by vectorized_conjuncts_. Returns
+  // the number of rows read and the number that passed in *num_to_commit. If a column
+  // has no more values, fewer rows are read and *ended_reader is set to the index of
+  // its reader.
+  int AssembleRowsVectorized(MemPool* pool, int num_rows, Tuple* tuple, TupleRow* row,
+      int* num_to_commit, int* ended_reader);
+
+  // Same as AssembleRowsVectorized(), but reads the conjunct columns and evaluates the
+  // conjuncts a row at a time.
+  int AssembleRowsLateMaterialized(MemPool* pool, int num_rows, Tuple* tuple,
+      TupleRow* row, int* num_to_commit, int* ended_reader);
+
+  // Skips the next 'num_rows' values of the readers other_readers_. Returns false and
+  // sets *ended_reader if one of them has fewer values.
+  bool SkipOtherColumns(int num_rows, int* ended_reader);
+
+  // Called when column reader 'c' has no more values after 'num_rows' rows of the
+  // current batch, of which the first 'num_to_commit' tuples passed the conjuncts.
+  // Commits them and checks that the 'rows_read' rows read from row group
+  // 'row_group_idx' before the batch, plus 'num_rows', match its metadata. Returns
+  // parse_status_ or the error.
+  Status ColumnEnded(int row_group_idx, int c, int64_t rows_read, int num_rows,
+      int num_to_commit);
+
   // Process the file footer and parse file_metadata_.  This should be called with the
   // last FOOTER_SIZE bytes in context_.
   // *eosr is a return value.  If true, the scan range is complete (e.g. select count(*))
@@ -151,7 +254,9 @@ class HdfsParquetScanner : public HdfsScanner {
 
   // Walks file_metadata_ and initiates reading the materialized columns.  This
   // initializes column_readers_ and issues the reads for the columns.
-  Status InitColumns(int row_group_idx);
+  // If the row group's statistics show that no row can pass the conjuncts, nothing is
+  // read and *skip_row_group is set to true.
+  Status InitColumns(int row_group_idx, bool* skip_row_group);
 
   // Validates the file metadata
   Status ValidateFileMetadata();
@@ -32,6 +32,7 @@
 #include "util/rle-encoding.h"
 #include "rpc/thrift-util.h"
 
+#include <cmath>
 #include <sstream>
 
 #include "gen-cpp/ImpalaService_types.h"
@@ -57,6 +58,17 @@ using namespace apache::thrift;
 // TODO: more complicated heuristic?
 static const int MAX_DICTIONARY_ENTRIES = (1 << 16) - 1;
 
+// Statistics: every data page header and every column chunk's metadata carry a
+// parquet::Statistics with the null count and, unless all values are NULL, the
+// min_value and max_value. The scanner uses them to skip row groups and pages that
+// cannot pass the scan's conjuncts. NaNs are left out of the min and max since they fail
+// every comparison anyway.
+// The scanner reads page headers of at most MAX_PAGE_HEADER_SIZE (100) bytes, so string
+// min and max values longer than this are left out of page headers. Column chunks allow
+// longer ones, since they only go to the footer.
+static const int MAX_PAGE_STATS_VALUE_SIZE = 24;
+static const int MAX_ROW_GROUP_STATS_VALUE_SIZE = 1024;
+
 // Class that encapsulates all the state for writing a single column.  This contains
 // all the buffered pages as well as the metadata (e.g. byte sizes, num values, etc).
 // This is intended to be created once per writer per column and reused across
@@ -94,6 +106,8 @@ class HdfsParquetTableWriter::BaseColumnWriter {
       codec_(codec), current_page_(NULL), num_values_(0),
       total_compressed_byte_size_(0),
       total_uncompressed_byte_size_(0),
+      row_group_null_count_(0),
+      has_plain_values_(false),
       dict_encoder_base_(NULL),
       def_levels_(NULL) {
     Codec::CreateCompressor(NULL, false, codec, &compressor_);
@@ -124,6 +138,13 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   Status Flush(int64_t* file_pos, int64_t* first_data_page,
       int64_t* first_dictionary_page);
 
+  // Fills in 'stats' for all values added since the last Reset(). Must be called
+  // after Flush().
+  void GetRowGroupStats(parquet::Statistics* stats) const {
+    stats->__set_null_count(row_group_null_count_);
+    GetRowGroupMinMax(stats);
+  }
+
   // Resets all the data accumulated for this column.  Memory can now be reused for
   // the next row group
   // Any data for previous row groups must be reset (e.g. dictionaries).
@@ -133,6 +154,8 @@ class HdfsParquetTableWriter::BaseColumnWriter {
     current_page_ = NULL;
     num_values_ = 0;
     total_compressed_byte_size_ = 0;
+    row_group_null_count_ = 0;
+    has_plain_values_ = false;
     current_encoding_ = Encoding::PLAIN;
   }
 
@@ -165,6 +188,14 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   // Encodes out all data for the current page and updates the metadata.
   virtual void FinalizeCurrentPage();
 
+  // Sets the min and max of 'stats' to those of the current page and folds them into
+  // the row group's min and max. Implemented in the subclass; the default leaves them
+  // unset.
+  virtual void FinalizePageMinMax(parquet::Statistics* stats) { }
+
+  // Sets the min and max of 'stats' to those of the current row group.
+  virtual void GetRowGroupMinMax(parquet::Statistics* stats) const { }
+
   // Update current_page_ to a new page, reusing pages allocated if possible.
   void NewPage();
 
@@ -189,6 +220,10 @@ class HdfsParquetTableWriter::BaseColumnWriter {
 
     // Number of non-null values
     int num_non_null;
+
+    // Number of NULLs. Unlike num_non_null, this doesn't count a value that didn't fit
+    // on the page.
+    int num_nulls;
   };
 
   HdfsParquetTableWriter* parent_;
@@ -211,6 +246,13 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   int64_t total_uncompressed_byte_size_;
   Encoding::type current_encoding_;
 
+  // Number of NULLs in the finalized pages of the current row group.
+  int64_t row_group_null_count_;
+
+  // True if a finalized page of the current row group has PLAIN encoded values. If not,
+  // the dictionary holds all values of the row group.
+  bool has_plain_values_;
+
   // Created and set by the base class.
   DictEncoderBase* dict_encoder_base_;
 
@@ -226,6 +268,98 @@ class HdfsParquetTableWriter::BaseColumnWriter {
   int values_buffer_len_;
 };
 
+// Running min and max of the values written to a page or a row group.
+template<typename T>
+class ColumnStats {
+ public:
+  ColumnStats() : has_values_(false) { }
+
+  void Update(const T& v) {
+    if (IsNaN(v)) return;
+    if (!has_values_) {
+      SetMin(v);
+      SetMax(v);
+      has_values_ = true;
+    } else if (v < min_) {
+      SetMin(v);
+    } else if (max_ < v) {
+      SetMax(v);
+    }
+  }
+
+  void Merge(const ColumnStats<T>& other) {
+    if (!other.has_values_) return;
+    Update(other.min_);
+    Update(other.max_);
+  }
+
+  void Reset() { has_values_ = false; }
+
+  // Sets the min_value and max_value of 'stats', PLAIN encoded with 'fixed_len_size'
+  // (see ParquetPlainEncoder::Encode()). Strings are stored without their length
+  // prefix. The deprecated min and max are left unset, since their order is undefined
+  // for strings. Leaves all of them unset if no values were seen or if either encoded
+  // value is longer than 'max_value_size'.
+  void ToThrift(int fixed_len_size, int max_value_size,
+      parquet::Statistics* stats) const {
+    stats->__isset.min_value = false;
+    stats->__isset.max_value = false;
+    if (!has_values_) return;
+    Encode(min_, fixed_len_size, &stats->min_value);
+    Encode(max_, fixed_len_size, &stats->max_value);
+    if (stats->min_value.size() > static_cast<size_t>(max_value_size) ||
+        stats->max_value.size() > static_cast<size_t>(max_value_size)) {
+      stats->min_value.clear();
+      stats->max_value.clear();
+      return;
+    }
+    stats->__isset.min_value = true;
+    stats->__isset.max_value = true;
+  }
+
+ private:
+  static bool IsNaN(const T& v) { return false; }
+
+  static void Encode(const T& v, int fixed_len_size, string* out) {
+    out->resize(fixed_len_size);
+    ParquetPlainEncoder::Encode(
+        reinterpret_cast<uint8_t*>(&(*out)[0]), fixed_len_size, v);
+  }
+
+  void SetMin(const T& v) { min_ = v; }
+  void SetMax(const T& v) { max_ = v; }
+
+  bool has_values_;
+  T min_;
+  T max_;
+
+  // Copies of the string data of min_ and max_, which must outlive the row batch the
+  // values came from. Only used for StringValue.
+  string min_buffer_;
+  string max_buffer_;
+};
+
+template<> bool ColumnStats<float>::IsNaN(const float& v) { return isnan(v); }
+template<> bool ColumnStats<double>::IsNaN(const double& v) { return isnan(v); }
+
+template<>
+void ColumnStats<StringValue>::Encode(const StringValue& v, int fixed_len_size,
+    string* out) {
+  out->assign(v.ptr, v.len);
+}
+
+template<>
+void ColumnStats<StringValue>::SetMin(const StringValue& v) {
+  min_buffer_.assign(v.ptr, v.len);
+  min_ = StringValue(const_cast<char*>(min_buffer_.data()), v.len);
+}
+
+template<>
+void ColumnStats<StringValue>::SetMax(const StringValue& v) {
+  max_buffer_.assign(v.ptr, v.len);
+  max_ = StringValue(const_cast<char*>(max_buffer_.data()), v.len);
+}
+
 // Per type column writer.
 template<typename T>
 class HdfsParquetTableWriter::ColumnWriter :
@@ -246,6 +380,8 @@ class HdfsParquetTableWriter::ColumnWriter :
     dict_encoder_.reset(
         new DictEncoder<T>(parent_->per_file_mem_pool_.get(), encoded_value_size_));
     dict_encoder_base_ = dict_encoder_.get();
+    page_stats_.Reset();
+    row_group_stats_.Reset();
   }
 
  protected:
@@ -283,9 +419,22 @@ class HdfsParquetTableWriter::ColumnWriter :
       // TODO: support other encodings here
       DCHECK(false);
     }
+    // Only values that went on the page count in its stats. A value that didn't fit is
+    // encoded again on the next page.
+    page_stats_.Update(*CastValue(value));
     return true;
   }
 
+  virtual void FinalizePageMinMax(parquet::Statistics* stats) {
+    page_stats_.ToThrift(encoded_value_size_, MAX_PAGE_STATS_VALUE_SIZE, stats);
+    row_group_stats_.Merge(page_stats_);
+    page_stats_.Reset();
+  }
+
+  virtual void GetRowGroupMinMax(parquet::Statistics* stats) const {
+    row_group_stats_.ToThrift(encoded_value_size_, MAX_ROW_GROUP_STATS_VALUE_SIZE, stats);
+  }
+
  private:
   // The period, in # of rows, to check the estimated dictionary page size against
   // the data page size. We want to start a new data page when the estimated size
@@ -308,6 +457,11 @@ class HdfsParquetTableWriter::ColumnWriter :
   // Temporary string value to hold CHAR(N)
   StringValue temp_;
 
+  // Min and max of the values of the current page and of the finalized pages of the
+  // current row group.
+  ColumnStats<T> page_stats_;
+  ColumnStats<T> row_group_stats_;
+
   // Converts a slot pointer to a raw value suitable for encoding
   inline T* CastValue(void* value) {
     return reinterpret_cast<T*>(value);
@@ -397,6 +551,7 @@ inline Status HdfsParquetTableWriter::BaseColumnWriter::AppendRow(TupleRow* row)
     FinalizeCurrentPage();
     NewPage();
   }
+  if (value == NULL) ++current_page_->num_nulls;
   ++current_page_->header.data_page_header.num_values;
   return Status::OK;
 }
@@ -522,6 +677,15 @@ void HdfsParquetTableWriter::BaseColumnWriter::FinalizeCurrentPage() {
 
   PageHeader& header = current_page_->header;
   header.data_page_header.encoding = current_encoding_;
+  if (current_encoding_ == Encoding::PLAIN && current_page_->num_non_null > 0) {
+    has_plain_values_ = true;
+  }
+
+  parquet::Statistics& stats = header.data_page_header.statistics;
+  stats.__set_null_count(current_page_->num_nulls);
+  FinalizePageMinMax(&stats);
+  header.data_page_header.__isset.statistics = true;
+  row_group_null_count_ += current_page_->num_nulls;
 
   // Compute size of definition bits
   def_levels_->Flush();
@@ -603,6 +767,7 @@ void HdfsParquetTableWriter::BaseColumnWriter::NewPage() {
   }
   current_page_->finalized = false;
   current_page_->num_non_null = 0;
+  current_page_->num_nulls = 0;
 }
 
 HdfsParquetTableWriter::HdfsParquetTableWriter(HdfsTableSink* parent, RuntimeState* state,
@@ -717,6 +882,21 @@ Status HdfsParquetTableWriter::Init() {
     columns_[i]->Reset();
   }
   RETURN_IF_ERROR(CreateSchema());
+
+  const vector<int32_t>& spatial_index_cols = parent_->spatial_index_cols();
+  if (!spatial_index_cols.empty()) {
+    DCHECK_EQ(spatial_index_cols.size(), 2);
+    int num_clustering_cols = table_desc_->num_clustering_cols();
+    int x_idx = spatial_index_cols[0] - num_clustering_cols;
+    int y_idx = spatial_index_cols[1] - num_clustering_cols;
+    if (x_idx < 0 || x_idx >= columns_.size() || y_idx < 0 || y_idx >= columns_.size() ||
+        output_expr_ctxs_[x_idx]->root()->type().type != TYPE_DOUBLE ||
+        output_expr_ctxs_[y_idx]->root()->type().type != TYPE_DOUBLE) {
+      return Status("Spatial index columns must be non-partition DOUBLE columns.");
+    }
+    spatial_index_.reset(new HdfsSpatialIndexBuilder(spatial_index_cols,
+        output_expr_ctxs_[x_idx], output_expr_ctxs_[y_idx]));
+  }
   return Status::OK;
 }
 
@@ -764,8 +944,8 @@ Status HdfsParquetTableWriter::AddRowGroup() {
     // Add all encodings that were used in this file.  Currently we use PLAIN and
     // PLAIN_DICTIONARY for data values and RLE for the definition levels.
     metadata.encodings.push_back(Encoding::RLE);
-    // Columns are initially dictionary encoded
-    // TODO: we might not have PLAIN encoding in this case
+    // Columns are initially dictionary encoded. PLAIN is removed when the row group is
+    // flushed if no values fell back to it.
     metadata.encodings.push_back(Encoding::PLAIN_DICTIONARY);
     metadata.encodings.push_back(Encoding::PLAIN);
     metadata.path_in_schema.push_back(table_desc_->col_names()[i + num_clustering_cols]);
@@ -839,6 +1019,7 @@ Status HdfsParquetTableWriter::InitNewFile() {
   file_size_estimate_ = 0;
 
   file_metadata_.row_groups.clear();
+  if (spatial_index_.get() != NULL) spatial_index_->Reset();
   RETURN_IF_ERROR(AddRowGroup());
   RETURN_IF_ERROR(WriteFileHeader());
 
@@ -863,6 +1044,7 @@ Status HdfsParquetTableWriter::AppendRowBatch(RowBatch* batch,
     for (int j = 0; j < columns_.size(); ++j) {
       RETURN_IF_ERROR(columns_[j]->AppendRow(current_row));
     }
+    if (spatial_index_.get() != NULL) spatial_index_->AddRow(current_row);
     ++row_idx_;
     ++row_count_;
     ++output_->num_rows;
@@ -914,6 +1096,7 @@ Status HdfsParquetTableWriter::WriteFileHeader() {
 Status HdfsParquetTableWriter::FlushCurrentRowGroup() {
   if (current_row_group_ == NULL) return Status::OK;
 
+  int64_t row_group_start = file_pos_;
   int num_clustering_cols = table_desc_->num_clustering_cols();
   for (int i = 0; i < columns_.size(); ++i) {
     int64_t data_page_offset, dict_page_offset;
@@ -928,6 +1111,18 @@ Status HdfsParquetTableWriter::FlushCurrentRowGroup() {
     }
 
     current_row_group_->columns[i].meta_data.num_values = columns_[i]->num_values();
+    if (!columns_[i]->has_plain_values_) {
+      // Readers can rely on the dictionary to hold all values, e.g. to skip the row
+      // group if none of them pass a predicate.
+      vector<Encoding::type>& encodings =
+          current_row_group_->columns[i].meta_data.encodings;
+      encodings.erase(remove(encodings.begin(), encodings.end(), Encoding::PLAIN),
+          encodings.end());
+    }
+    if (columns_[i]->num_values() > 0) {
+      columns_[i]->GetRowGroupStats(&current_row_group_->columns[i].meta_data.statistics);
+      current_row_group_->columns[i].meta_data.__isset.statistics = true;
+    }
     current_row_group_->columns[i].meta_data.total_uncompressed_size =
         columns_[i]->total_uncompressed_size();
     current_row_group_->columns[i].meta_data.total_compressed_size =
@@ -956,6 +1151,9 @@ Status HdfsParquetTableWriter::FlushCurrentRowGroup() {
     columns_[i]->Reset();
   }
 
+  if (spatial_index_.get() != NULL) {
+    spatial_index_->FinishBlock(row_group_start, file_pos_ - row_group_start);
+  }
   current_row_group_ = NULL;
   return Status::OK;
 }
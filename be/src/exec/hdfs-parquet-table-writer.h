@@ -24,6 +24,7 @@
 
 #include "util/compress.h"
 #include "runtime/descriptors.h"
+#include "exec/hdfs-spatial-index.h"
 #include "exec/hdfs-table-writer.h"
 #include "exec/parquet-common.h"
 
@@ -78,6 +79,10 @@ class HdfsParquetTableWriter : public HdfsTableWriter {
 
   virtual std::string file_extension() const { return "parq"; }
 
+  virtual const TSpatialIndex* spatial_index() const {
+    return spatial_index_.get() == NULL ? NULL : &spatial_index_->index();
+  }
+
  private:
   // Default data page size. In bytes.
   static const int DATA_PAGE_SIZE = 64 * 1024;
@@ -175,6 +180,10 @@ class HdfsParquetTableWriter : public HdfsTableWriter {
 
   // For each column, the on disk size written.
   TParquetInsertStats parquet_stats_;
+
+  // Builds the spatial index of the current file, with one entry per row group. NULL
+  // if the table has no spatial index.
+  boost::scoped_ptr<HdfsSpatialIndexBuilder> spatial_index_;
 };
 
 }
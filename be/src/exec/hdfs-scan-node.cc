@@ -17,10 +17,12 @@
 #include "exec/hdfs-text-scanner.h"
 #include "exec/hdfs-lzo-text-scanner.h"
 #include "exec/hdfs-sequence-scanner.h"
+#include "exec/hdfs-spatial-index.h"
 #include "exec/hdfs-rcfile-scanner.h"
 #include "exec/hdfs-avro-scanner.h"
 #include "exec/hdfs-parquet-scanner.h"
 
+#include <limits>
 #include <sstream>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
@@ -39,6 +41,7 @@
 #include "runtime/raw-value.h"
 #include "runtime/row-batch.h"
 #include "util/bit-util.h"
+#include "util/bloom-filter.h"
 #include "util/container-util.h"
 #include "util/debug-util.h"
 #include "util/disk-info.h"
@@ -87,6 +90,7 @@ HdfsScanNode::HdfsScanNode(ObjectPool* pool, const TPlanNode& tnode,
       scanner_thread_bytes_required_(0),
       num_partition_keys_(0),
       disks_accessed_bitmap_(TCounterType::UNIT, 0),
+      knn_distance_bound_(numeric_limits<double>::infinity()),
       done_(false),
       all_ranges_started_(false),
       counters_running_(false),
@@ -112,6 +116,12 @@ Status HdfsScanNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos
     // been generated (e.g. probe side bitmap filters).
     // TODO: we could do dynamic partition pruning here as well.
     initial_ranges_issued_ = true;
+    if (thrift_plan_node_->hdfs_scan_node.__isset.spatial_filter) {
+      RETURN_IF_ERROR(PruneRangesWithSpatialIndex());
+    }
+    if (thrift_plan_node_->hdfs_scan_node.__isset.knn_filter) {
+      RETURN_IF_ERROR(OrderRangesByKnnDistance());
+    }
     // Issue initial ranges for all file types.
     RETURN_IF_ERROR(HdfsTextScanner::IssueInitialRanges(this,
         per_type_files_[THdfsFileFormat::TEXT]));
@@ -390,6 +400,7 @@ Status HdfsScanNode::Prepare(RuntimeState* state) {
       file_descs_[native_file_path] = file_desc;
       file_desc->file_length = split.file_length;
       file_desc->file_compression = split.file_compression;
+      if (split.__isset.file_mtime) file_desc->mtime = split.file_mtime;
 
       if (partition_desc == NULL) {
         stringstream ss;
@@ -473,6 +484,8 @@ Status HdfsScanNode::Prepare(RuntimeState* state) {
   PrintHdfsSplitStats(per_volume_stats, &str);
   runtime_profile()->AddInfoString(HDFS_SPLIT_STATS_DESC, str.str());
 
+  RETURN_IF_ERROR(ReadSpatialIndexes());
+
   // Initialize conjunct exprs
   RETURN_IF_ERROR(Expr::CreateExprTrees(
       runtime_state_->obj_pool(), thrift_plan_node_->conjuncts, &conjunct_ctxs_));
@@ -584,6 +597,12 @@ Status HdfsScanNode::Open(RuntimeState* state) {
       TCounterType::BYTES);
   bytes_read_dn_cache_ = ADD_COUNTER(runtime_profile(), "BytesReadDataNodeCache",
       TCounterType::BYTES);
+  num_spatially_pruned_ranges_ = ADD_COUNTER(runtime_profile(),
+      "RangesPrunedBySpatialIndex", TCounterType::UNIT);
+  num_knn_pruned_ranges_ = ADD_COUNTER(runtime_profile(),
+      "RangesPrunedByKnnDistance", TCounterType::UNIT);
+  num_runtime_filter_pruned_ranges_ = ADD_COUNTER(runtime_profile(),
+      "RangesPrunedByRuntimeFilters", TCounterType::UNIT);
 
   max_compressed_text_file_length_ = runtime_profile()->AddHighWaterMarkCounter(
       "MaxCompressedTextFileLength", TCounterType::BYTES);
@@ -676,6 +695,188 @@ Status HdfsScanNode::AddDiskIoRanges(const HdfsFileDesc* desc) {
   return Status::OK;
 }
 
+Status HdfsScanNode::PruneRangesWithSpatialIndex() {
+  const THdfsSpatialFilter& filter = thrift_plan_node_->hdfs_scan_node.spatial_filter;
+  RectangleValue window = FromTRectangle(filter.window);
+  for (FileFormatsMap::iterator it = per_type_files_.begin();
+      it != per_type_files_.end(); ++it) {
+    THdfsFileFormat::type file_format = it->first;
+    vector<HdfsFileDesc*> unpruned_files;
+    BOOST_FOREACH(HdfsFileDesc* file, it->second) {
+      const TSpatialIndex* index = GetSpatialIndex(file, filter.index_cols);
+      if (index == NULL) {
+        unpruned_files.push_back(file);
+        continue;
+      }
+
+      // Parquet scanners read the whole file from its first split, so those files are
+      // only pruned as a whole. Splits of other formats are kept if a block of rows that
+      // overlaps the window starts in them.
+      bool file_overlaps = false;
+      vector<DiskIoMgr::ScanRange*> unpruned_splits;
+      BOOST_FOREACH(DiskIoMgr::ScanRange* split, file->splits) {
+        bool split_overlaps = false;
+        for (int i = 0; i < index->entries.size(); ++i) {
+          const TSpatialIndexEntry& entry = index->entries[i];
+          if (!FromTRectangle(entry.mbr).Overlaps(window)) continue;
+          file_overlaps = true;
+          if (entry.offset < split->offset() + split->len() &&
+              split->offset() < entry.offset + entry.length) {
+            split_overlaps = true;
+            break;
+          }
+        }
+        if (split_overlaps || file_format == THdfsFileFormat::PARQUET) {
+          unpruned_splits.push_back(split);
+        }
+      }
+      if (!file_overlaps) unpruned_splits.clear();
+
+      int num_pruned = file->splits.size() - unpruned_splits.size();
+      for (int i = 0; i < num_pruned; ++i) {
+        RangeComplete(file_format, file->file_compression);
+      }
+      COUNTER_ADD(num_spatially_pruned_ranges_, num_pruned);
+      file->splits.swap(unpruned_splits);
+      if (file->splits.empty()) {
+        MarkFileDescIssued(file);
+      } else {
+        unpruned_files.push_back(file);
+      }
+    }
+    it->second.swap(unpruned_files);
+  }
+  return Status::OK;
+}
+
+// Orders files by their minimum distance to the query point.
+struct KnnDistanceLess {
+  KnnDistanceLess(const map<string, double>& distances) : distances(distances) { }
+
+  double Distance(const HdfsFileDesc* file) const {
+    map<string, double>::const_iterator it = distances.find(file->filename);
+    return it == distances.end() ? 0 : it->second;
+  }
+
+  bool operator()(const HdfsFileDesc* a, const HdfsFileDesc* b) const {
+    return Distance(a) < Distance(b);
+  }
+
+  const map<string, double>& distances;
+};
+
+Status HdfsScanNode::OrderRangesByKnnDistance() {
+  const THdfsKnnFilter& filter = thrift_plan_node_->hdfs_scan_node.knn_filter;
+  PointValue query(filter.query_x, filter.query_y);
+  for (FileFormatsMap::iterator it = per_type_files_.begin();
+      it != per_type_files_.end(); ++it) {
+    BOOST_FOREACH(HdfsFileDesc* file, it->second) {
+      const TSpatialIndex* index = GetSpatialIndex(file, filter.index_cols);
+      if (index == NULL) continue;
+      // A file without indexed points only has rows with a NULL or NaN coordinate,
+      // which the KnnNode treats as infinitely far away.
+      double distance = numeric_limits<double>::infinity();
+      if (!index->entries.empty()) {
+        distance = FromTRectangle(index->mbr).MinDistance(query);
+      }
+      knn_min_distances_[file->filename] = distance;
+    }
+    stable_sort(it->second.begin(), it->second.end(),
+        KnnDistanceLess(knn_min_distances_));
+  }
+  return Status::OK;
+}
+
+Status HdfsScanNode::ReadSpatialIndexes() {
+  const THdfsScanNode& hdfs_scan_node = thrift_plan_node_->hdfs_scan_node;
+  if (!hdfs_scan_node.__isset.spatial_filter && !hdfs_scan_node.__isset.knn_filter) {
+    return Status::OK;
+  }
+  num_stale_spatial_indexes_ = ADD_COUNTER(runtime_profile(), "StaleSpatialIndexes",
+      TCounterType::UNIT);
+  for (FileDescMap::iterator it = file_descs_.begin(); it != file_descs_.end(); ++it) {
+    const HdfsFileDesc* file = it->second;
+    TSpatialIndex* index = runtime_state_->obj_pool()->Add(new TSpatialIndex());
+    bool found = false;
+    RETURN_IF_ERROR(ReadSpatialIndex(hdfs_connection_,
+        SpatialIndexFileName(file->filename), index, &found));
+    // A data file that was replaced after its sidecar was written, e.g. by a Hive
+    // INSERT OVERWRITE, has different contents than the sidecar describes. Sidecars
+    // that don't record their data file are treated the same way.
+    if (found && (!index->__isset.data_file_length || !index->__isset.data_file_mtime ||
+        index->data_file_length != file->file_length || file->mtime < 0 ||
+        index->data_file_mtime != file->mtime / 1000)) {
+      VLOG_FILE << "Ignoring stale spatial index of " << file->filename;
+      COUNTER_ADD(num_stale_spatial_indexes_, 1);
+      found = false;
+    }
+    spatial_indexes_[file->filename] = found ? index : NULL;
+  }
+  return Status::OK;
+}
+
+const TSpatialIndex* HdfsScanNode::GetSpatialIndex(const HdfsFileDesc* file,
+    const vector<int32_t>& index_cols) {
+  map<string, TSpatialIndex*>::const_iterator it = spatial_indexes_.find(file->filename);
+  if (it == spatial_indexes_.end() || it->second == NULL) return NULL;
+  if (it->second->index_cols != index_cols) return NULL;
+  return it->second;
+}
+
+bool HdfsScanNode::IsPrunedByKnnBound(const DiskIoMgr::ScanRange* scan_range,
+    THdfsFileFormat::type file_format) {
+  if (knn_min_distances_.empty()) return false;
+  if (file_format != THdfsFileFormat::TEXT && file_format != THdfsFileFormat::PARQUET) {
+    return false;
+  }
+  map<string, double>::const_iterator it = knn_min_distances_.find(scan_range->file());
+  if (it == knn_min_distances_.end()) return false;
+  ScopedSpinLock l(&knn_bound_lock_);
+  return it->second > knn_distance_bound_;
+}
+
+bool HdfsScanNode::IsPrunedByRuntimeFilters(HdfsPartitionDescriptor* partition) {
+  THdfsFileFormat::type file_format = partition->file_format();
+  if (file_format != THdfsFileFormat::TEXT && file_format != THdfsFileFormat::PARQUET) {
+    return false;
+  }
+  for (int i = 0; i < partition_key_slots_.size(); ++i) {
+    const SlotDescriptor* slot_desc = partition_key_slots_[i];
+    const BloomFilter* filter = runtime_state_->GetBloomFilter(slot_desc->id());
+    if (filter == NULL) continue;
+    void* value;
+    {
+      // See InitTemplateTuple().
+      unique_lock<mutex> l(lock_);
+      value = partition->partition_key_value_ctxs()[slot_desc->col_pos()]->GetValue(NULL);
+    }
+    // NULL keys are conservatively never pruned.
+    if (value == NULL) continue;
+    uint32_t hash = RawValue::GetHashValue(value, slot_desc->type(),
+        RuntimeState::RUNTIME_FILTER_HASH_SEED);
+    if (!filter->Find(hash)) return true;
+  }
+  return false;
+}
+
+void HdfsScanNode::SetKnnDistanceBound(double bound) {
+  ScopedSpinLock l(&knn_bound_lock_);
+  knn_distance_bound_ = min(knn_distance_bound_, bound);
+}
+
+void HdfsScanNode::SetTopNFilter(SlotId slot, const TopNFilter& filter) {
+  ScopedSpinLock l(&topn_filters_lock_);
+  topn_filters_[slot] = filter;
+}
+
+bool HdfsScanNode::GetTopNFilter(SlotId slot, TopNFilter* filter) {
+  ScopedSpinLock l(&topn_filters_lock_);
+  map<SlotId, TopNFilter>::const_iterator it = topn_filters_.find(slot);
+  if (it == topn_filters_.end()) return false;
+  *filter = it->second;
+  return true;
+}
+
 void HdfsScanNode::MarkFileDescIssued(const HdfsFileDesc* desc) {
   DCHECK_GT(num_unqueued_files_, 0);
   --num_unqueued_files_;
@@ -823,6 +1024,33 @@ void HdfsScanNode::ScannerThread() {
       HdfsPartitionDescriptor* partition = hdfs_table_->GetPartition(partition_id);
       DCHECK(partition != NULL);
 
+      if (IsPrunedByKnnBound(scan_range, partition->file_format())) {
+        // None of the range's rows can be among the k nearest ones. Release its buffers
+        // and count it as complete without creating a scanner.
+        scan_range->Cancel(Status::CANCELLED);
+        RangeComplete(partition->file_format(),
+            GetFileDesc(scan_range->file())->file_compression);
+        COUNTER_ADD(num_knn_pruned_ranges_, 1);
+        if (progress_.done()) {
+          SetDone();
+          break;
+        }
+        continue;
+      }
+
+      if (IsPrunedByRuntimeFilters(partition)) {
+        // A join above this scan can't match any of the partition's rows.
+        scan_range->Cancel(Status::CANCELLED);
+        RangeComplete(partition->file_format(),
+            GetFileDesc(scan_range->file())->file_compression);
+        COUNTER_ADD(num_runtime_filter_pruned_ranges_, 1);
+        if (progress_.done()) {
+          SetDone();
+          break;
+        }
+        continue;
+      }
+
       ScannerContext* context = runtime_state_->obj_pool()->Add(
           new ScannerContext(runtime_state_, this, partition, scan_range));
       Status scanner_status;
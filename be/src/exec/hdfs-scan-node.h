@@ -29,6 +29,7 @@
 
 #include "exec/scan-node.h"
 #include "exec/scanner-context.h"
+#include "exec/topn-filter.h"
 #include "runtime/descriptors.h"
 #include "runtime/disk-io-mgr.h"
 #include "runtime/string-buffer.h"
@@ -59,10 +60,14 @@ struct HdfsFileDesc {
 
   THdfsCompression::type file_compression;
 
+  // Last modification time of the file in milliseconds, or -1 if unknown.
+  int64_t mtime;
+
   // Splits (i.e. raw byte ranges) for this file, assigned to this scan node.
   std::vector<DiskIoMgr::ScanRange*> splits;
   HdfsFileDesc(const std::string& filename)
-    : filename(filename), file_length(0), file_compression(THdfsCompression::NONE) {
+    : filename(filename), file_length(0), file_compression(THdfsCompression::NONE),
+      mtime(-1) {
   }
 };
 
@@ -234,6 +239,19 @@ class HdfsScanNode : public ScanNode {
   void RangeComplete(const THdfsFileFormat::type& file_type,
       const std::vector<THdfsCompression::type>& compression_type);
 
+  // Called by the KnnNode that this scan feeds (see THdfsKnnFilter) with the distance of
+  // its current k-th nearest row. Files whose indexed points are all farther away than
+  // 'bound' from the query point are skipped from then on. Thread safe.
+  void SetKnnDistanceBound(double bound);
+
+  // Called by a TopNNode that this scan feeds with its current filter on the values of
+  // 'slot', which replaces the previous one. Thread safe.
+  void SetTopNFilter(SlotId slot, const TopNFilter& filter);
+
+  // Copies the current TopN filter on 'slot' into *filter. Returns false if there is
+  // none. Thread safe.
+  bool GetTopNFilter(SlotId slot, TopNFilter* filter);
+
   // Utility function to compute the order in which to materialize slots to allow  for
   // computing conjuncts as slots get materialized (on partial tuples).
   // 'order' will contain for each slot, the first conjunct it is associated with.
@@ -400,6 +418,41 @@ class HdfsScanNode : public ScanNode {
   // Total number of bytes read from data node cache
   RuntimeProfile::Counter* bytes_read_dn_cache_;
 
+  // Number of splits that were skipped because of their spatial index.
+  RuntimeProfile::Counter* num_spatially_pruned_ranges_;
+
+  // Number of scan ranges that were skipped because they were farther from the knn
+  // filter's query point than the current k-th nearest row.
+  RuntimeProfile::Counter* num_knn_pruned_ranges_;
+
+  // Number of scan ranges that were skipped because their partition key values were
+  // rejected by a runtime filter.
+  RuntimeProfile::Counter* num_runtime_filter_pruned_ranges_;
+
+  // Spatial index sidecars of the files in file_descs_, read in Prepare() if the scan
+  // has a spatial or knn filter. NULL if the file has no sidecar or the sidecar is
+  // stale.
+  std::map<std::string, TSpatialIndex*> spatial_indexes_;
+
+  // Number of sidecars that were ignored because their data file was replaced after
+  // they were written.
+  RuntimeProfile::Counter* num_stale_spatial_indexes_;
+
+  // Minimum distance from the knn filter's query point to the indexed points of each
+  // file that has a spatial index. Set before the initial ranges are issued and
+  // read-only afterwards.
+  std::map<std::string, double> knn_min_distances_;
+
+  // Current k-th nearest distance of the KnnNode and the lock protecting it. Ranges of
+  // files whose minimum distance exceeds it are skipped. Infinite until the KnnNode has
+  // seen k rows.
+  SpinLock knn_bound_lock_;
+  double knn_distance_bound_;
+
+  // Filters set by SetTopNFilter() and the lock protecting them.
+  SpinLock topn_filters_lock_;
+  std::map<SlotId, TopNFilter> topn_filters_;
+
   // Lock protects access between scanner thread and main query thread (the one calling
   // GetNext()) for all fields below.  If this lock and any other locks needs to be taken
   // together, this lock must be taken first.
@@ -468,6 +521,41 @@ class HdfsScanNode : public ScanNode {
   // Checks for eos conditions and returns batches from materialized_row_batches_.
   Status GetNextInternal(RuntimeState* state, RowBatch* row_batch, bool* eos);
 
+  // Reads the spatial index sidecars of the files in file_descs_ into spatial_indexes_.
+  // A sidecar is only used if the length and modification time of its data file still
+  // match those it was written for.
+  Status ReadSpatialIndexes();
+
+  // Removes the splits, and files, in per_type_files_ that have no indexed point
+  // inside the spatial filter's window.
+  // The removed splits are marked complete. Files without a matching sidecar are
+  // scanned in full. Called before the initial ranges are issued.
+  Status PruneRangesWithSpatialIndex();
+
+  // Records the minimum distance of the files in per_type_files_ to the knn filter's
+  // query point in knn_min_distances_, and sorts the files of each format by that
+  // distance, so that the nearest files are scanned first. Files without a matching
+  // sidecar are scanned first. Called before the initial ranges are issued.
+  Status OrderRangesByKnnDistance();
+
+  // Returns the spatial index sidecar of 'file', or NULL if the file has no usable
+  // sidecar or its index is on other columns than 'index_cols'.
+  const TSpatialIndex* GetSpatialIndex(const HdfsFileDesc* file,
+      const std::vector<int32_t>& index_cols);
+
+  // Returns true if 'scan_range', returned by the IoMgr, can be skipped because its
+  // file can't contain a row nearer than knn_distance_bound_. Only ranges of Parquet
+  // and text files are skipped: those are processed end to end by a single scanner,
+  // while other formats issue further ranges from their header range.
+  bool IsPrunedByKnnBound(const DiskIoMgr::ScanRange* scan_range,
+      THdfsFileFormat::type file_format);
+
+  // Returns true if 'scan_range' of 'partition', returned by the IoMgr, can be skipped
+  // because one of the partition's key values is rejected by the runtime filter on its
+  // slot. Filters published after the scan started prune the ranges returned after
+  // they arrive. Like IsPrunedByKnnBound(), only skips ranges of Parquet and text files.
+  bool IsPrunedByRuntimeFilters(HdfsPartitionDescriptor* partition);
+
   // sets done_ to true and triggers threads to cleanup. Cannot be calld with
   // any locks taken. Calling it repeatedly ignores subsequent calls.
   void SetDone();
@@ -0,0 +1,134 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exec/hdfs-spatial-index.h"
+
+#include <cmath>
+#include <fcntl.h>
+#include <sstream>
+
+#include "exprs/expr-context.h"
+#include "rpc/thrift-util.h"
+#include "util/hdfs-util.h"
+
+using namespace impala;
+using namespace std;
+
+HdfsSpatialIndexBuilder::HdfsSpatialIndexBuilder(const vector<int32_t>& index_cols,
+    ExprContext* x_expr_ctx, ExprContext* y_expr_ctx)
+  : x_expr_ctx_(x_expr_ctx),
+    y_expr_ctx_(y_expr_ctx),
+    block_has_points_(false) {
+  DCHECK_EQ(index_cols.size(), 2);
+  index_.index_cols = index_cols;
+  Reset();
+}
+
+void HdfsSpatialIndexBuilder::Reset() {
+  block_has_points_ = false;
+  index_.mbr = ToTRectangle(RectangleValue());
+  index_.entries.clear();
+}
+
+void HdfsSpatialIndexBuilder::AddRow(TupleRow* row) {
+  void* x = x_expr_ctx_->GetValue(row);
+  if (x == NULL) return;
+  void* y = y_expr_ctx_->GetValue(row);
+  if (y == NULL) return;
+  PointValue p(*reinterpret_cast<double*>(x), *reinterpret_cast<double*>(y));
+  if (isnan(p.x) || isnan(p.y)) return;
+
+  RectangleValue point_mbr(p.x, p.y, p.x, p.y);
+  if (block_has_points_) {
+    block_mbr_.Expand(point_mbr);
+  } else {
+    block_mbr_ = point_mbr;
+    block_has_points_ = true;
+  }
+}
+
+void HdfsSpatialIndexBuilder::FinishBlock(int64_t offset, int64_t length) {
+  if (!block_has_points_) return;
+  if (index_.entries.empty()) {
+    index_.mbr = ToTRectangle(block_mbr_);
+  } else {
+    RectangleValue file_mbr = FromTRectangle(index_.mbr);
+    file_mbr.Expand(block_mbr_);
+    index_.mbr = ToTRectangle(file_mbr);
+  }
+  TSpatialIndexEntry entry;
+  entry.offset = offset;
+  entry.length = length;
+  entry.mbr = ToTRectangle(block_mbr_);
+  index_.entries.push_back(entry);
+  block_has_points_ = false;
+}
+
+string impala::SpatialIndexFileName(const string& data_file) {
+  size_t slash = data_file.find_last_of('/');
+  if (slash == string::npos) return "." + data_file + ".mbr";
+  return data_file.substr(0, slash + 1) + "." + data_file.substr(slash + 1) + ".mbr";
+}
+
+Status impala::WriteSpatialIndex(hdfsFS connection, const string& path,
+    const TSpatialIndex& index) {
+  ThriftSerializer serializer(true);
+  uint32_t len = 0;
+  uint8_t* buffer = NULL;
+  RETURN_IF_ERROR(
+      serializer.Serialize(const_cast<TSpatialIndex*>(&index), &len, &buffer));
+
+  hdfsFile file = hdfsOpenFile(connection, path.c_str(), O_WRONLY, 0, 0, 0);
+  if (file == NULL) {
+    return Status(GetHdfsErrorMsg("Failed to open HDFS file for writing: ", path));
+  }
+  Status status;
+  if (hdfsWrite(connection, file, buffer, len) != len) {
+    status = Status(GetHdfsErrorMsg("Failed to write spatial index: ", path));
+  }
+  if (hdfsCloseFile(connection, file) != 0 && status.ok()) {
+    status = Status(GetHdfsErrorMsg("Failed to close HDFS file: ", path));
+  }
+  return status;
+}
+
+Status impala::ReadSpatialIndex(hdfsFS connection, const string& path,
+    TSpatialIndex* index, bool* found) {
+  *found = hdfsExists(connection, path.c_str()) == 0;
+  if (!*found) return Status::OK;
+
+  int64_t file_size;
+  RETURN_IF_ERROR(GetFileSize(connection, path.c_str(), &file_size));
+  if (file_size == 0) return Status("Empty spatial index file: " + path);
+  vector<uint8_t> buffer(file_size);
+  hdfsFile file = hdfsOpenFile(connection, path.c_str(), O_RDONLY, 0, 0, 0);
+  if (file == NULL) {
+    return Status(GetHdfsErrorMsg("Failed to open HDFS file for reading: ", path));
+  }
+  Status status;
+  int64_t bytes_read = 0;
+  while (bytes_read < file_size) {
+    tSize ret = hdfsRead(connection, file, &buffer[bytes_read], file_size - bytes_read);
+    if (ret <= 0) {
+      status = Status(GetHdfsErrorMsg("Failed to read spatial index: ", path));
+      break;
+    }
+    bytes_read += ret;
+  }
+  hdfsCloseFile(connection, file);
+  RETURN_IF_ERROR(status);
+
+  uint32_t len = file_size;
+  return DeserializeThriftMsg(&buffer[0], &len, true, index);
+}
@@ -0,0 +1,100 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_EXEC_HDFS_SPATIAL_INDEX_H
+#define IMPALA_EXEC_HDFS_SPATIAL_INDEX_H
+
+#include <hdfs.h>
+#include <string>
+#include <vector>
+
+#include "common/status.h"
+#include "runtime/spatial-value.h"
+
+#include "gen-cpp/Types_types.h"  // for TSpatialIndex
+
+namespace impala {
+
+class ExprContext;
+class TupleRow;
+
+// Spatial index sidecars let scans skip data files and splits that can't contain rows
+// in a query window. The sidecar of a data file is a hidden file in the same directory
+// (see SpatialIndexFileName()), so it is ignored when the table's files are listed. It
+// contains a serialized TSpatialIndex: the MBR of the (x, y) points of each block of
+// rows and of the whole file.
+//
+// Builds the TSpatialIndex of the data file that a table writer is producing. The x and
+// y coordinates are the values of two DOUBLE output exprs.
+class HdfsSpatialIndexBuilder {
+ public:
+  // 'index_cols' are the table column positions of the x and y columns.
+  HdfsSpatialIndexBuilder(const std::vector<int32_t>& index_cols,
+      ExprContext* x_expr_ctx, ExprContext* y_expr_ctx);
+
+  // Starts the index of a new file.
+  void Reset();
+
+  // Adds the point of 'row' to the current block. Rows with a NULL or NaN coordinate
+  // can't satisfy a range predicate and are not indexed.
+  void AddRow(TupleRow* row);
+
+  // Ends the current block, whose rows start in the byte range [offset, offset + length)
+  // of the file. Blocks without indexed points are not recorded.
+  void FinishBlock(int64_t offset, int64_t length);
+
+  const TSpatialIndex& index() const { return index_; }
+
+ private:
+  ExprContext* x_expr_ctx_;
+  ExprContext* y_expr_ctx_;
+
+  // MBR of the points added since the last FinishBlock(). Only valid if
+  // block_has_points_ is true.
+  RectangleValue block_mbr_;
+  bool block_has_points_;
+
+  TSpatialIndex index_;
+};
+
+// Returns the path of the spatial index sidecar of 'data_file'.
+std::string SpatialIndexFileName(const std::string& data_file);
+
+// Writes 'index' to the file 'path'.
+Status WriteSpatialIndex(hdfsFS connection, const std::string& path,
+    const TSpatialIndex& index);
+
+// Reads the spatial index at 'path' into 'index'. Sets 'found' to false if there is no
+// such file.
+Status ReadSpatialIndex(hdfsFS connection, const std::string& path,
+    TSpatialIndex* index, bool* found);
+
+// Conversions between TRectangle and RectangleValue.
+inline RectangleValue FromTRectangle(const TRectangle& r) {
+  return RectangleValue(r.x1, r.y1, r.x2, r.y2);
+}
+
+inline TRectangle ToTRectangle(const RectangleValue& r) {
+  TRectangle result;
+  result.x1 = r.x1;
+  result.y1 = r.y1;
+  result.x2 = r.x2;
+  result.y2 = r.y2;
+  return result;
+}
+
+}
+
+#endif
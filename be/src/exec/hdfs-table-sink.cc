@@ -18,6 +18,7 @@
 #include "exec/hdfs-avro-table-writer.h"
 #include "exec/hdfs-parquet-table-writer.h"
 #include "exec/exec-node.h"
+#include "exec/hdfs-spatial-index.h"
 #include "gen-cpp/ImpalaInternalService_constants.h"
 #include "util/hdfs-util.h"
 #include "exprs/expr.h"
@@ -59,6 +60,9 @@ HdfsTableSink::HdfsTableSink(const RowDescriptor& row_desc,
        partition_key_texprs_(tsink.table_sink.hdfs_table_sink.partition_key_exprs),
        overwrite_(tsink.table_sink.hdfs_table_sink.overwrite) {
   DCHECK(tsink.__isset.table_sink);
+  if (tsink.table_sink.hdfs_table_sink.__isset.spatial_index_cols) {
+    spatial_index_cols_ = tsink.table_sink.hdfs_table_sink.spatial_index_cols;
+  }
 }
 
 OutputPartition::OutputPartition()
@@ -556,6 +560,29 @@ Status HdfsTableSink::FinalizePartitionFile(RuntimeState* state,
   DataSink::MergeInsertStats(partition->writer->stats(), &it->second.stats);
 
   ClosePartitionFile(state, partition);
+  return WriteSpatialIndexFile(state, partition);
+}
+
+Status HdfsTableSink::WriteSpatialIndexFile(RuntimeState* state,
+    OutputPartition* partition) {
+  if (partition->writer->spatial_index() == NULL) return Status::OK;
+  TSpatialIndex index = *partition->writer->spatial_index();
+  // Renaming the file to its final destination keeps both.
+  const char* file_name = partition->current_file_name.c_str();
+  time_t mtime;
+  RETURN_IF_ERROR(GetFileSize(hdfs_connection_, file_name, &index.data_file_length));
+  RETURN_IF_ERROR(GetLastModificationTime(hdfs_connection_, file_name, &mtime));
+  index.__isset.data_file_length = true;
+  index.__set_data_file_mtime(mtime);
+  string tmp_index_file_name = SpatialIndexFileName(partition->current_file_name);
+  RETURN_IF_ERROR(WriteSpatialIndex(hdfs_connection_, tmp_index_file_name, index));
+
+  // The sidecar goes next to the file's final destination.
+  FileMoveMap::const_iterator dest =
+      state->hdfs_files_to_move()->find(partition->current_file_name);
+  DCHECK(dest != state->hdfs_files_to_move()->end());
+  (*state->hdfs_files_to_move())[tmp_index_file_name] =
+      SpatialIndexFileName(dest->second);
   return Status::OK;
 }
 
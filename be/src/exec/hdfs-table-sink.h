@@ -154,6 +154,10 @@ class HdfsTableSink : public DataSink {
   RuntimeProfile::Counter* hdfs_write_timer() { return hdfs_write_timer_; }
   RuntimeProfile::Counter* compress_timer() { return compress_timer_; }
 
+  // Table column positions of the x and y columns of the table's spatial index, or
+  // empty if no spatial index sidecars should be written.
+  const std::vector<int32_t>& spatial_index_cols() const { return spatial_index_cols_; }
+
   std::string DebugString() const;
 
  private:
@@ -201,6 +205,12 @@ class HdfsTableSink : public DataSink {
   // the partition by calling ClosePartitionFile()
   Status FinalizePartitionFile(RuntimeState* state, OutputPartition* partition);
 
+  // Writes the spatial index sidecar of the current file of 'partition', if its writer
+  // built one. The sidecar is moved to its final location along with the file. Must be
+  // called after the file is closed, since the sidecar records its final length and
+  // modification time.
+  Status WriteSpatialIndexFile(RuntimeState* state, OutputPartition* partition);
+
   // Closes the hdfs file for this partition as well as the writer.
   void ClosePartitionFile(RuntimeState* state, OutputPartition* partition);
 
@@ -239,6 +249,9 @@ class HdfsTableSink : public DataSink {
   // Indicates whether the existing partitions should be overwritten.
   bool overwrite_;
 
+  // See spatial_index_cols().
+  std::vector<int32_t> spatial_index_cols_;
+
   // The directory in which to write intermediate results. Set to
   // <hdfs_table_base_dir>/.impala_insert_staging/ during Prepare()
   std::string staging_dir_;
@@ -92,6 +92,10 @@ class HdfsTableWriter {
   // Returns the file extension for this writer.
   virtual std::string file_extension() const = 0;
 
+  // Returns the spatial index of the file that was last finalized, or NULL if this
+  // writer doesn't build spatial indexes or the table has none.
+  virtual const TSpatialIndex* spatial_index() const { return NULL; }
+
  protected:
   // Size to buffer output before calling Write() (which calls hdfsWrite), in bytes
   // to minimize the overhead of Write()
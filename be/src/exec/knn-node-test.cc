@@ -0,0 +1,281 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <gtest/gtest.h>
+
+#include "common/init.h"
+#include "common/object-pool.h"
+#include "exec/knn-node.h"
+#include "exprs/expr-context.h"
+#include "exprs/slot-ref.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/runtime-state.h"
+#include "runtime/string-value.h"
+#include "runtime/tuple-row.h"
+#include "testutil/desc-tbl-builder.h"
+#include "util/test-info.h"
+
+using namespace boost;
+using namespace impala;
+using namespace std;
+
+namespace impala {
+
+static const double NaN = numeric_limits<double>::quiet_NaN();
+static const double INF = numeric_limits<double>::infinity();
+
+// Tests KnnHeap, which selects the k nearest rows for KnnNode, on rows of
+// (x DOUBLE, y DOUBLE, s STRING) and the query point (0, 0).
+class KnnNodeTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    state_.reset(new RuntimeState(TPlanFragmentInstanceCtx(), "", NULL));
+    DescriptorTblBuilder builder(&pool_);
+    builder.DeclareTuple() << TYPE_DOUBLE << TYPE_DOUBLE << TYPE_STRING;
+    DescriptorTbl* desc_tbl = builder.Build();
+    state_->set_desc_tbl(desc_tbl);
+    tuple_desc_ = desc_tbl->GetTupleDescriptor(0);
+    row_desc_.reset(new RowDescriptor(tuple_desc_, false));
+    input_pool_.reset(new MemPool(&tracker_));
+
+    const vector<SlotDescriptor*>& slots = tuple_desc_->slots();
+    x_expr_ctx_ = pool_.Add(new ExprContext(pool_.Add(new SlotRef(slots[0]))));
+    y_expr_ctx_ = pool_.Add(new ExprContext(pool_.Add(new SlotRef(slots[1]))));
+    ASSERT_TRUE(x_expr_ctx_->Prepare(state_.get(), *row_desc_).ok());
+    ASSERT_TRUE(y_expr_ctx_->Prepare(state_.get(), *row_desc_).ok());
+    ASSERT_TRUE(x_expr_ctx_->Open(state_.get()).ok());
+    ASSERT_TRUE(y_expr_ctx_->Open(state_.get()).ok());
+  }
+
+  virtual void TearDown() {
+    x_expr_ctx_->Close(state_.get());
+    y_expr_ctx_->Close(state_.get());
+    input_pool_->FreeAll();
+    state_.reset();
+  }
+
+  // Returns a heap of the 'k' nearest rows to (0, 0), charged to heap_tracker_.
+  KnnHeap* CreateHeap(int64_t k) {
+    return pool_.Add(new KnnHeap(k, PointValue(0, 0), x_expr_ctx_, y_expr_ctx_,
+        row_desc_->tuple_descriptors(), &heap_tracker_));
+  }
+
+  // Returns a row with the point (x, y), or NULL coordinates if 'x' or 'y' is NULL, and
+  // the string 's'. The row is allocated from input_pool_.
+  TupleRow* CreateRow(const double* x, const double* y, const string& s) {
+    const vector<SlotDescriptor*>& slots = tuple_desc_->slots();
+    Tuple* tuple = Tuple::Create(tuple_desc_->byte_size(), input_pool_.get());
+    if (x == NULL) {
+      tuple->SetNull(slots[0]->null_indicator_offset());
+    } else {
+      *reinterpret_cast<double*>(tuple->GetSlot(slots[0]->tuple_offset())) = *x;
+    }
+    if (y == NULL) {
+      tuple->SetNull(slots[1]->null_indicator_offset());
+    } else {
+      *reinterpret_cast<double*>(tuple->GetSlot(slots[1]->tuple_offset())) = *y;
+    }
+    char* str = reinterpret_cast<char*>(input_pool_->Allocate(s.size()));
+    memcpy(str, s.data(), s.size());
+    *reinterpret_cast<StringValue*>(tuple->GetSlot(slots[2]->tuple_offset())) =
+        StringValue(str, s.size());
+    TupleRow* row = reinterpret_cast<TupleRow*>(input_pool_->Allocate(sizeof(Tuple*)));
+    row->SetTuple(0, tuple);
+    return row;
+  }
+
+  TupleRow* CreateRow(double x, double y, const string& s) {
+    return CreateRow(&x, &y, s);
+  }
+
+  static string GetString(TupleRow* row, const SlotDescriptor* slot) {
+    StringValue* value = reinterpret_cast<StringValue*>(
+        row->GetTuple(0)->GetSlot(slot->tuple_offset()));
+    return value->DebugString();
+  }
+
+  ObjectPool pool_;
+  MemTracker tracker_;
+  MemTracker heap_tracker_;
+  scoped_ptr<RuntimeState> state_;
+  TupleDescriptor* tuple_desc_;
+  scoped_ptr<RowDescriptor> row_desc_;
+  scoped_ptr<MemPool> input_pool_;
+  ExprContext* x_expr_ctx_;
+  ExprContext* y_expr_ctx_;
+};
+
+// Inserts random points and checks that the k nearest are returned, in order, for
+// values of k below, at and above the number of rows.
+TEST_F(KnnNodeTest, KSelection) {
+  const int NUM_ROWS = 1000;
+  srand(0);
+  vector<TupleRow*> rows;
+  vector<double> distances;
+  for (int i = 0; i < NUM_ROWS; ++i) {
+    double x = rand() % 2001 - 1000;
+    double y = rand() % 2001 - 1000;
+    stringstream s;
+    s << i;
+    rows.push_back(CreateRow(x, y, s.str()));
+    distances.push_back(sqrt(x * x + y * y));
+  }
+  vector<double> sorted_distances = distances;
+  sort(sorted_distances.begin(), sorted_distances.end());
+
+  const SlotDescriptor* s_slot = tuple_desc_->slots()[2];
+  int64_t ks[] = { 1, 10, 999, 1000, 2000 };
+  for (int i = 0; i < sizeof(ks) / sizeof(ks[0]); ++i) {
+    int64_t k = ks[i];
+    KnnHeap* heap = CreateHeap(k);
+    for (int j = 0; j < NUM_ROWS; ++j) {
+      EXPECT_TRUE(heap->Insert(rows[j]));
+      if (j + 1 >= k) {
+        ASSERT_TRUE(heap->is_full());
+      } else {
+        EXPECT_FALSE(heap->is_full());
+      }
+    }
+    vector<KnnHeap::Neighbour> result;
+    heap->PopSortedRows(&result);
+    ASSERT_EQ(result.size(), min<int64_t>(k, NUM_ROWS));
+    for (int j = 0; j < result.size(); ++j) {
+      EXPECT_EQ(result[j].distance, sorted_distances[j]) << "k=" << k << " row " << j;
+      // The row is a copy of the input row at that distance.
+      int input_idx = atoi(GetString(result[j].row, s_slot).c_str());
+      EXPECT_EQ(distances[input_idx], result[j].distance);
+      EXPECT_NE(rows[input_idx], result[j].row);
+    }
+    heap->Close();
+    EXPECT_EQ(heap_tracker_.consumption(), 0);
+  }
+}
+
+// Of rows at the same distance, the ones inserted first are kept, and the k-th
+// distance is the distance of the tie.
+TEST_F(KnnNodeTest, Ties) {
+  KnnHeap* heap = CreateHeap(3);
+  EXPECT_TRUE(heap->Insert(CreateRow(5, 0, "a")));
+  EXPECT_TRUE(heap->Insert(CreateRow(0, 5, "b")));
+  EXPECT_TRUE(heap->Insert(CreateRow(-3, -4, "c")));
+  EXPECT_EQ(heap->kth_distance(), 5);
+  EXPECT_TRUE(heap->Insert(CreateRow(4, -3, "d")));
+  EXPECT_TRUE(heap->Insert(CreateRow(1, 0, "e")));
+  EXPECT_EQ(heap->kth_distance(), 5);
+
+  vector<KnnHeap::Neighbour> result;
+  heap->PopSortedRows(&result);
+  ASSERT_EQ(result.size(), 3);
+  const SlotDescriptor* s_slot = tuple_desc_->slots()[2];
+  EXPECT_EQ(GetString(result[0].row, s_slot), "e");
+  EXPECT_EQ(result[1].distance, 5);
+  EXPECT_EQ(result[2].distance, 5);
+  // One of "a", "b" and "c" was replaced by "e", but never by "d".
+  for (int i = 1; i < 3; ++i) EXPECT_NE(GetString(result[i].row, s_slot), "d");
+  heap->Close();
+}
+
+// Rows with a NULL or NaN coordinate are infinitely far away: they are returned after
+// all rows with a point, and only if there are fewer than k of those.
+TEST_F(KnnNodeTest, NullAndNaN) {
+  double one = 1;
+  vector<TupleRow*> rows;
+  rows.push_back(CreateRow(NULL, &one, "null x"));
+  rows.push_back(CreateRow(&one, NULL, "null y"));
+  rows.push_back(CreateRow(NaN, 1, "nan x"));
+  rows.push_back(CreateRow(1, NaN, "nan y"));
+  rows.push_back(CreateRow(INF, 1, "inf x"));
+  rows.push_back(CreateRow(3, 4, "near"));
+  rows.push_back(CreateRow(30, 40, "far"));
+  const SlotDescriptor* s_slot = tuple_desc_->slots()[2];
+
+  // k is larger than the number of rows with a point.
+  KnnHeap* heap = CreateHeap(4);
+  int num_without_point = 0;
+  for (int i = 0; i < rows.size(); ++i) {
+    if (!heap->Insert(rows[i])) ++num_without_point;
+  }
+  EXPECT_EQ(num_without_point, 4);
+  EXPECT_EQ(heap->kth_distance(), INF);
+  vector<KnnHeap::Neighbour> result;
+  heap->PopSortedRows(&result);
+  ASSERT_EQ(result.size(), 4);
+  EXPECT_EQ(GetString(result[0].row, s_slot), "near");
+  EXPECT_EQ(result[0].distance, 5);
+  EXPECT_EQ(GetString(result[1].row, s_slot), "far");
+  EXPECT_EQ(result[1].distance, 50);
+  EXPECT_EQ(result[2].distance, INF);
+  EXPECT_EQ(result[3].distance, INF);
+  heap->Close();
+
+  // k is smaller: only rows with a finite distance are returned, even though the rows
+  // without a point were inserted first.
+  heap = CreateHeap(2);
+  for (int i = 0; i < rows.size(); ++i) heap->Insert(rows[i]);
+  EXPECT_EQ(heap->kth_distance(), 50);
+  heap->PopSortedRows(&result);
+  ASSERT_EQ(result.size(), 2);
+  EXPECT_EQ(GetString(result[0].row, s_slot), "near");
+  EXPECT_EQ(GetString(result[1].row, s_slot), "far");
+  heap->Close();
+}
+
+// Each nearer row replaces the top and copies its string into new memory. The heap's
+// memory stays bounded by compacting, and the strings survive the compactions.
+TEST_F(KnnNodeTest, Compaction) {
+  const int K = 10;
+  const int NUM_ROWS = 10000;
+  const string PADDING(100, 'x');
+  KnnHeap* heap = CreateHeap(K);
+  int64_t max_consumption = 0;
+  for (int i = NUM_ROWS; i > 0; --i) {
+    stringstream s;
+    s << i << PADDING;
+    EXPECT_TRUE(heap->Insert(CreateRow(i, 0, s.str())));
+    max_consumption = max(max_consumption, heap_tracker_.consumption());
+  }
+  // Without compaction the string data of all rows would be kept.
+  EXPECT_LT(max_consumption, NUM_ROWS * PADDING.size() / 10);
+
+  vector<KnnHeap::Neighbour> result;
+  heap->PopSortedRows(&result);
+  ASSERT_EQ(result.size(), K);
+  const SlotDescriptor* s_slot = tuple_desc_->slots()[2];
+  for (int i = 0; i < K; ++i) {
+    stringstream s;
+    s << i + 1 << PADDING;
+    EXPECT_EQ(result[i].distance, i + 1);
+    EXPECT_EQ(GetString(result[i].row, s_slot), s.str());
+  }
+  heap->Close();
+  EXPECT_EQ(heap_tracker_.consumption(), 0);
+}
+
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  InitCommonRuntime(argc, argv, false, TestInfo::BE_TEST);
+  return RUN_ALL_TESTS();
+}
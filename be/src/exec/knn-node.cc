@@ -0,0 +1,225 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exec/knn-node.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include "exec/hdfs-scan-node.h"
+#include "exprs/expr.h"
+#include "exprs/expr-context.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem-pool.h"
+#include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
+#include "runtime/tuple-row.h"
+#include "util/debug-util.h"
+#include "util/runtime-profile.h"
+
+#include "gen-cpp/PlanNodes_types.h"
+
+using namespace impala;
+using namespace std;
+
+KnnHeap::KnnHeap(int64_t k, const PointValue& query_point, ExprContext* x_expr_ctx,
+    ExprContext* y_expr_ctx, const vector<TupleDescriptor*>& tuple_descs,
+    MemTracker* mem_tracker)
+  : k_(k),
+    query_point_(query_point),
+    x_expr_ctx_(x_expr_ctx),
+    y_expr_ctx_(y_expr_ctx),
+    tuple_descs_(tuple_descs),
+    mem_tracker_(mem_tracker),
+    pool_(new MemPool(mem_tracker)),
+    compacted_bytes_(0) {
+}
+
+KnnHeap::~KnnHeap() {
+  DCHECK_EQ(pool_->total_allocated_bytes(), 0);
+}
+
+bool KnnHeap::Insert(TupleRow* input_row) {
+  DCHECK_GT(k_, 0);
+  void* x = x_expr_ctx_->GetValue(input_row);
+  void* y = y_expr_ctx_->GetValue(input_row);
+  double distance = numeric_limits<double>::quiet_NaN();
+  if (x != NULL && y != NULL) {
+    double dx = *reinterpret_cast<double*>(x) - query_point_.x;
+    double dy = *reinterpret_cast<double*>(y) - query_point_.y;
+    distance = sqrt(dx * dx + dy * dy);
+  }
+  // Rows without a point are farther away than all other rows, like NULL distances
+  // in an ascending ORDER BY, so they are only returned if there are fewer than k
+  // rows with a point.
+  bool has_point = !isnan(distance);
+  if (!has_point) distance = numeric_limits<double>::infinity();
+
+  if (heap_.size() < k_) {
+    heap_.push_back(Neighbour(distance, input_row->DeepCopy(tuple_descs_, pool_.get())));
+    push_heap(heap_.begin(), heap_.end());
+    if (is_full()) compacted_bytes_ = pool_->total_allocated_bytes();
+  } else if (distance < heap_.front().distance) {
+    pop_heap(heap_.begin(), heap_.end());
+    Neighbour& replaced = heap_.back();
+    input_row->DeepCopy(replaced.row, tuple_descs_, pool_.get(), true);
+    replaced.distance = distance;
+    push_heap(heap_.begin(), heap_.end());
+    // Only string data is newly allocated, so rows without strings never compact.
+    if (pool_->total_allocated_bytes() > 2 * compacted_bytes_) Compact();
+  }
+  return has_point;
+}
+
+void KnnHeap::Compact() {
+  boost::scoped_ptr<MemPool> new_pool(new MemPool(mem_tracker_));
+  for (int i = 0; i < heap_.size(); ++i) {
+    heap_[i].row = heap_[i].row->DeepCopy(tuple_descs_, new_pool.get());
+  }
+  pool_->FreeAll();
+  pool_.swap(new_pool);
+  compacted_bytes_ = pool_->total_allocated_bytes();
+}
+
+void KnnHeap::PopSortedRows(vector<Neighbour>* rows) {
+  sort_heap(heap_.begin(), heap_.end());
+  rows->swap(heap_);
+  heap_.clear();
+}
+
+void KnnHeap::Close() {
+  heap_.clear();
+  pool_->FreeAll();
+}
+
+KnnNode::KnnNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs)
+  : ExecNode(pool, tnode, descs),
+    x_expr_ctx_(NULL),
+    y_expr_ctx_(NULL),
+    query_point_(tnode.knn_node.query_x, tnode.knn_node.query_y),
+    pruned_scan_node_id_(tnode.knn_node.__isset.pruned_scan_node_id ?
+        tnode.knn_node.pruned_scan_node_id : -1),
+    pruned_scan_node_(NULL),
+    rows_without_point_counter_(NULL) {
+}
+
+Status KnnNode::Init(const TPlanNode& tnode) {
+  RETURN_IF_ERROR(ExecNode::Init(tnode));
+  DCHECK(tnode.__isset.knn_node);
+  RETURN_IF_ERROR(Expr::CreateExprTree(pool_, tnode.knn_node.x_expr, &x_expr_ctx_));
+  RETURN_IF_ERROR(Expr::CreateExprTree(pool_, tnode.knn_node.y_expr, &y_expr_ctx_));
+  DCHECK_GE(limit_, 0) << "KnnNode requires a limit.";
+  DCHECK_EQ(conjunct_ctxs_.size(), 0)
+      << "KnnNode should never have predicates to evaluate.";
+  return Status::OK;
+}
+
+Status KnnNode::Prepare(RuntimeState* state) {
+  SCOPED_TIMER(runtime_profile_->total_time_counter());
+  RETURN_IF_ERROR(ExecNode::Prepare(state));
+  RETURN_IF_ERROR(x_expr_ctx_->Prepare(state, child(0)->row_desc()));
+  RETURN_IF_ERROR(y_expr_ctx_->Prepare(state, child(0)->row_desc()));
+  DCHECK_EQ(x_expr_ctx_->root()->type().type, TYPE_DOUBLE);
+  DCHECK_EQ(y_expr_ctx_->root()->type().type, TYPE_DOUBLE);
+  state->AddExprCtxToFree(x_expr_ctx_);
+  state->AddExprCtxToFree(y_expr_ctx_);
+  heap_.reset(new KnnHeap(limit_, query_point_, x_expr_ctx_, y_expr_ctx_,
+      child(0)->row_desc().tuple_descriptors(), mem_tracker()));
+
+  if (pruned_scan_node_id_ != -1) {
+    vector<ExecNode*> scan_nodes;
+    child(0)->CollectNodes(TPlanNodeType::HDFS_SCAN_NODE, &scan_nodes);
+    for (int i = 0; i < scan_nodes.size(); ++i) {
+      if (scan_nodes[i]->id() != pruned_scan_node_id_) continue;
+      pruned_scan_node_ = static_cast<HdfsScanNode*>(scan_nodes[i]);
+    }
+    DCHECK(pruned_scan_node_ != NULL);
+  }
+
+  rows_without_point_counter_ =
+      ADD_COUNTER(runtime_profile(), "RowsWithoutPoint", TCounterType::UNIT);
+  return Status::OK;
+}
+
+Status KnnNode::Open(RuntimeState* state) {
+  SCOPED_TIMER(runtime_profile_->total_time_counter());
+  RETURN_IF_ERROR(ExecNode::Open(state));
+  RETURN_IF_CANCELLED(state);
+  RETURN_IF_ERROR(state->QueryMaintenance());
+  RETURN_IF_ERROR(x_expr_ctx_->Open(state));
+  RETURN_IF_ERROR(y_expr_ctx_->Open(state));
+
+  RETURN_IF_ERROR(child(0)->Open(state));
+
+  // Limit of 0, no need to fetch anything from children.
+  if (limit_ != 0) {
+    RowBatch batch(child(0)->row_desc(), state->batch_size(), mem_tracker());
+    bool eos;
+    do {
+      batch.Reset();
+      RETURN_IF_ERROR(child(0)->GetNext(state, &batch, &eos));
+      for (int i = 0; i < batch.num_rows(); ++i) {
+        if (!heap_->Insert(batch.GetRow(i))) COUNTER_ADD(rows_without_point_counter_, 1);
+      }
+      if (pruned_scan_node_ != NULL && heap_->is_full()) {
+        pruned_scan_node_->SetKnnDistanceBound(heap_->kth_distance());
+      }
+      RETURN_IF_CANCELLED(state);
+      RETURN_IF_ERROR(state->QueryMaintenance());
+    } while (!eos);
+  }
+  DCHECK_LE(heap_->size(), limit_);
+  heap_->PopSortedRows(&sorted_rows_);
+  get_next_iter_ = sorted_rows_.begin();
+  child(0)->Close(state);
+  return Status::OK;
+}
+
+Status KnnNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
+  SCOPED_TIMER(runtime_profile_->total_time_counter());
+  RETURN_IF_ERROR(ExecDebugAction(TExecNodePhase::GETNEXT, state));
+  RETURN_IF_CANCELLED(state);
+  RETURN_IF_ERROR(state->QueryMaintenance());
+  while (!row_batch->AtCapacity() && get_next_iter_ != sorted_rows_.end()) {
+    int row_idx = row_batch->AddRow();
+    TupleRow* dst_row = row_batch->GetRow(row_idx);
+    row_batch->CopyRow(get_next_iter_->row, dst_row);
+    ++get_next_iter_;
+    row_batch->CommitLastRow();
+    ++num_rows_returned_;
+    COUNTER_SET(rows_returned_counter_, num_rows_returned_);
+  }
+  *eos = get_next_iter_ == sorted_rows_.end();
+  return Status::OK;
+}
+
+void KnnNode::Close(RuntimeState* state) {
+  if (is_closed()) return;
+  sorted_rows_.clear();
+  if (heap_.get() != NULL) heap_->Close();
+  if (x_expr_ctx_ != NULL) x_expr_ctx_->Close(state);
+  if (y_expr_ctx_ != NULL) y_expr_ctx_->Close(state);
+  ExecNode::Close(state);
+}
+
+void KnnNode::DebugString(int indentation_level, stringstream* out) const {
+  *out << string(indentation_level * 2, ' ');
+  *out << "KnnNode(x=" << x_expr_ctx_->root()->DebugString()
+       << " y=" << y_expr_ctx_->root()->DebugString()
+       << " query=" << query_point_;
+  ExecNode::DebugString(indentation_level, out);
+  *out << ")";
+}
@@ -0,0 +1,158 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_EXEC_KNN_NODE_H
+#define IMPALA_EXEC_KNN_NODE_H
+
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+
+#include "exec/exec-node.h"
+#include "runtime/spatial-value.h"
+
+namespace impala {
+
+class ExprContext;
+class HdfsScanNode;
+class MemPool;
+class MemTracker;
+class RuntimeState;
+class TupleDescriptor;
+class TupleRow;
+
+// The k rows nearest to a constant query point among the rows passed to Insert(). The
+// rows are kept in a bounded max-heap on distance, so once it holds k rows, the distance
+// of its top is the k-th nearest distance seen so far. Rows with a NULL or NaN
+// coordinate are treated as infinitely far away. Of rows at the same distance, the
+// ones inserted first are kept.
+//
+// Inserted rows are deep copied into a pool owned by the heap. A row that replaces the
+// top reuses its tuple memory, but its string data is copied to new memory. Once more
+// than half of the pool is such garbage, the rows in the heap are copied to a new pool.
+class KnnHeap {
+ public:
+  // A row in the heap and its distance to the query point.
+  struct Neighbour {
+    double distance;
+    TupleRow* row;
+
+    Neighbour(double distance, TupleRow* row) : distance(distance), row(row) { }
+
+    // Orders the heap so that the farthest row is on top.
+    bool operator<(const Neighbour& other) const { return distance < other.distance; }
+  };
+
+  // 'x_expr_ctx' and 'y_expr_ctx' are the DOUBLE coordinate exprs, evaluated over rows
+  // with the tuples 'tuple_descs'. The pool's memory is charged to 'mem_tracker'.
+  KnnHeap(int64_t k, const PointValue& query_point, ExprContext* x_expr_ctx,
+      ExprContext* y_expr_ctx, const std::vector<TupleDescriptor*>& tuple_descs,
+      MemTracker* mem_tracker);
+  ~KnnHeap();
+
+  // Inserts a deep copy of 'row' if it is among the k nearest rows seen so far. Returns
+  // false if the row has a NULL or NaN coordinate.
+  bool Insert(TupleRow* row);
+
+  int64_t size() const { return heap_.size(); }
+  bool is_full() const { return heap_.size() == k_; }
+
+  // Returns the k-th nearest distance seen so far. Only valid if is_full().
+  double kth_distance() const {
+    DCHECK(is_full());
+    return heap_.front().distance;
+  }
+
+  // Empties the heap into 'rows' in order of increasing distance. The rows stay valid
+  // until Close() is called.
+  void PopSortedRows(std::vector<Neighbour>* rows);
+
+  // Frees the memory of all rows.
+  void Close();
+
+ private:
+  // Copies the rows of the heap into a new pool and frees the old one.
+  void Compact();
+
+  const int64_t k_;
+  const PointValue query_point_;
+  ExprContext* x_expr_ctx_;
+  ExprContext* y_expr_ctx_;
+  const std::vector<TupleDescriptor*>& tuple_descs_;
+  MemTracker* mem_tracker_;
+
+  // Max-heap on distance, maintained with std::push_heap() and std::pop_heap().
+  std::vector<Neighbour> heap_;
+
+  // Stores everything referenced by heap_.
+  boost::scoped_ptr<MemPool> pool_;
+
+  // Bytes allocated from pool_ when the heap was last compacted, or when it first held
+  // k rows. 0 before then.
+  int64_t compacted_bytes_;
+};
+
+// Node for k-nearest-neighbour queries: returns the 'limit' input rows whose (x, y)
+// coordinates are nearest to a constant query point, ordered by increasing distance.
+// Rows with a NULL or NaN coordinate are treated as infinitely far away.
+// This is a TopN on the distance, but the distance is computed here from the
+// coordinate exprs instead of being materialized as a sort tuple slot, and the rows
+// keep the child's row layout. The planner places a KnnNode below the TopN of an
+// "ORDER BY st_distance(...) LIMIT k" query, in every fragment that feeds the TopN, so
+// that the TopN only sorts k rows per fragment.
+//
+// The rows are kept in a bounded max-heap on distance. Once it holds k rows, the
+// distance of its top is the k-th nearest distance seen so far. If the plan names a
+// scan node in this fragment (TKnnNode.pruned_scan_node_id), that distance is passed
+// to the scan after each input batch, so that it skips files whose spatial index shows
+// that they can't contain a nearer row.
+class KnnNode : public ExecNode {
+ public:
+  KnnNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs);
+
+  virtual Status Init(const TPlanNode& tnode);
+  virtual Status Prepare(RuntimeState* state);
+  virtual Status Open(RuntimeState* state);
+  virtual Status GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos);
+  virtual void Close(RuntimeState* state);
+
+ protected:
+  virtual void DebugString(int indentation_level, std::stringstream* out) const;
+
+ private:
+  // Coordinate exprs, evaluated over the child's rows.
+  ExprContext* x_expr_ctx_;
+  ExprContext* y_expr_ctx_;
+
+  const PointValue query_point_;
+
+  // The scan node that the current k-th nearest distance is passed to, and its id. NULL
+  // and -1 if the plan doesn't name one.
+  const int pruned_scan_node_id_;
+  HdfsScanNode* pruned_scan_node_;
+
+  // The 'limit_' nearest rows. Created in Prepare().
+  boost::scoped_ptr<KnnHeap> heap_;
+
+  // After computing the k nearest rows in heap_, they are popped into this vector.
+  std::vector<KnnHeap::Neighbour> sorted_rows_;
+  std::vector<KnnHeap::Neighbour>::iterator get_next_iter_;
+
+  // Number of input rows that had a NULL or NaN coordinate.
+  RuntimeProfile::Counter* rows_without_point_counter_;
+};
+
+}
+
+#endif
@@ -23,6 +23,7 @@
 #include "runtime/raw-value.h"
 #include "runtime/runtime-state.h"
 #include "runtime/string-value.inline.h"
+#include "util/bloom-filter.h"
 #include "util/debug-util.h"
 #include "util/impalad-metrics.h"
 
@@ -115,42 +116,21 @@ bool OldHashTable::EvalRow(
   return has_null;
 }
 
-void OldHashTable::AddBitmapFilters() {
-  DCHECK_EQ(build_expr_ctxs_.size(), probe_expr_ctxs_.size());
-  vector<pair<SlotId, Bitmap*> > bitmaps;
-  bitmaps.resize(probe_expr_ctxs_.size());
-  for (int i = 0; i < build_expr_ctxs_.size(); ++i) {
-    if (probe_expr_ctxs_[i]->root()->is_slotref()) {
-      bitmaps[i].first =
-          reinterpret_cast<SlotRef*>(probe_expr_ctxs_[i]->root())->slot_id();
-      bitmaps[i].second = new Bitmap(state_->slot_filter_bitmap_size());
-    } else {
-      bitmaps[i].second = NULL;
-    }
-  }
-
-  // Walk the build table and generate a bitmap for each probe side slot.
+void OldHashTable::UpdateProbeFilters(vector<pair<SlotId, BloomFilter*> >& filters) {
+  DCHECK_EQ(build_expr_ctxs_.size(), filters.size());
+  // Walk the build table and update the filter for each probe side slot.
   OldHashTable::Iterator iter = Begin();
   while (iter != End()) {
     TupleRow* row = iter.GetRow();
     for (int i = 0; i < build_expr_ctxs_.size(); ++i) {
-      if (bitmaps[i].second == NULL) continue;
+      if (filters[i].second == NULL) continue;
       void* e = build_expr_ctxs_[i]->GetValue(row);
-      uint32_t h =
-          RawValue::GetHashValue(e, build_expr_ctxs_[i]->root()->type(), initial_seed_);
-      bitmaps[i].second->Set<true>(h, true);
+      uint32_t h = RawValue::GetHashValue(e, build_expr_ctxs_[i]->root()->type(),
+          RuntimeState::RUNTIME_FILTER_HASH_SEED);
+      filters[i].second->Insert(h);
     }
     iter.Next<false>();
   }
-
-  // Add all the bitmaps to the runtime state.
-  bool acquired_ownership = false;
-  for (int i = 0; i < bitmaps.size(); ++i) {
-    if (bitmaps[i].second == NULL) continue;
-    state_->AddBitmapFilter(bitmaps[i].first, bitmaps[i].second, &acquired_ownership);
-    VLOG(2) << "Bitmap filter added on slot: " << bitmaps[i].first;
-    if (!acquired_ownership) delete bitmaps[i].second;
-  }
 }
 
 // Helper function to store a value into the results buffer if the expr
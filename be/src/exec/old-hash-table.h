@@ -19,9 +19,9 @@
 #include <vector>
 #include <boost/cstdint.hpp>
 #include "codegen/impala-ir.h"
+#include "common/global-types.h"
 #include "common/logging.h"
 #include "runtime/mem-pool.h"
-#include "util/bitmap.h"
 #include "util/hash-util.h"
 #include "util/runtime-profile.h"
 
@@ -31,6 +31,7 @@ namespace llvm {
 
 namespace impala {
 
+class BloomFilter;
 class Expr;
 class ExprContext;
 class LlvmCodeGen;
@@ -203,13 +204,11 @@ class OldHashTable {
     return expr_value_null_bits_[expr_idx];
   }
 
-  // Can be called after all insert calls to add bitmap filters for the probe
-  // side values.
-  // For each probe_expr_ that is a slot ref, generate a bitmap filter on that slot.
-  // These filters are added to the runtime state.
-  // The bitmap filter is similar to a Bloom filter in that has no false negatives
-  // but will have false positives.
-  void AddBitmapFilters();
+  // Can be called after all insert calls to insert the build side values into the
+  // runtime filters for the probe side, one per build expr (NULL if there is none).
+  // Values are hashed with RuntimeState::RUNTIME_FILTER_HASH_SEED.
+  // These filters are not added to the runtime state.
+  void UpdateProbeFilters(std::vector<std::pair<SlotId, BloomFilter*> >& filters);
 
   // Returns an iterator at the beginning of the hash table.  Advancing this iterator
   // will traverse all elements.
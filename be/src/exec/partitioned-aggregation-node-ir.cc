@@ -20,6 +20,7 @@
 #include "runtime/tuple-row.h"
 
 using namespace impala;
+using namespace std;
 
 Status PartitionedAggregationNode::ProcessBatchNoGrouping(
     RowBatch* batch, HashTableCtx* ht_ctx) {
@@ -33,14 +34,30 @@ template<bool AGGREGATED_ROWS>
 Status PartitionedAggregationNode::ProcessBatch(RowBatch* batch, HashTableCtx* ht_ctx) {
   DCHECK(!hash_partitions_.empty());
 
+  // Rows [cache_begin, cache_end) have been evaluated and hashed into ht_ctx's row cache
+  // and their buckets prefetched.
+  int cache_begin = 0;
+  int cache_end = 0;
   for (int i = 0; i < batch->num_rows(); ++i) {
+    if (i == cache_end) {
+      // Hash the next group of rows up front so that their bucket lookups overlap.
+      cache_begin = i;
+      cache_end = min(batch->num_rows(), cache_begin + HashTableCtx::ROW_CACHE_SIZE);
+      for (int j = cache_begin; j < cache_end; ++j) {
+        uint32_t hash;
+        bool is_valid = AGGREGATED_ROWS ?
+            ht_ctx->EvalAndHashBuild(batch->GetRow(j), &hash) :
+            ht_ctx->EvalAndHashProbe(batch->GetRow(j), &hash);
+        ht_ctx->CacheCurrentRow(j - cache_begin, is_valid, hash);
+        if (!is_valid) continue;
+        Partition* partition = hash_partitions_[hash >> (32 - NUM_PARTITIONING_BITS)];
+        if (!partition->is_spilled()) partition->hash_tbl->PrefetchBucket<false>(hash);
+      }
+    }
+
     TupleRow* row = batch->GetRow(i);
     uint32_t hash = 0;
-    if (AGGREGATED_ROWS) {
-      if (!ht_ctx->EvalAndHashBuild(row, &hash)) continue;
-    } else {
-      if (!ht_ctx->EvalAndHashProbe(row, &hash)) continue;
-    }
+    if (!ht_ctx->RestoreCachedRow(i - cache_begin, &hash)) continue;
 
     // To process this row, we first see if it can be aggregated or inserted into this
     // partition's hash table. If we need to insert it and that fails, due to OOM, we
@@ -26,7 +26,9 @@
 #include "exprs/expr.h"
 #include "exprs/expr-context.h"
 #include "exprs/slot-ref.h"
+#include "exprs/vectorized-expr.h"
 #include "runtime/buffered-tuple-stream.inline.h"
+#include "runtime/column-batch.h"
 #include "runtime/descriptors.h"
 #include "runtime/mem-pool.h"
 #include "runtime/raw-value.h"
@@ -48,6 +50,8 @@ using namespace llvm;
 using namespace std;
 using namespace strings;
 
+DECLARE_bool(enable_vectorized_exprs);
+
 namespace impala {
 
 const char* PartitionedAggregationNode::LLVM_CLASS_NAME =
@@ -75,6 +79,7 @@ PartitionedAggregationNode::PartitionedAggregationNode(
     num_row_repartitioned_(NULL),
     num_repartitions_(NULL) {
   DCHECK_EQ(PARTITION_FANOUT, 1 << NUM_PARTITIONING_BITS);
+  DCHECK_LE(NUM_PARTITIONING_BITS, HashTable::MAX_PARTITIONING_BITS);
 }
 
 Status PartitionedAggregationNode::Init(const TPlanNode& tnode) {
@@ -156,6 +161,7 @@ Status PartitionedAggregationNode::Prepare(RuntimeState* state) {
   RETURN_IF_ERROR(Expr::Prepare(build_expr_ctxs_, state, *intermediate_row_desc_));
   state->AddExprCtxsToFree(build_expr_ctxs_);
 
+  vector<SlotDescriptor*> intermediate_slot_descs;
   int j = probe_expr_ctxs_.size();
   for (int i = 0; i < aggregate_evaluators_.size(); ++i, ++j) {
     // skip non-materialized slots; we don't have evaluators instantiated for those
@@ -172,6 +178,7 @@ Status PartitionedAggregationNode::Prepare(RuntimeState* state) {
         intermediate_slot_desc, output_slot_desc, agg_fn_pool_.get(), &agg_fn_ctx));
     agg_fn_ctxs_.push_back(agg_fn_ctx);
     state->obj_pool()->Add(agg_fn_ctx);
+    intermediate_slot_descs.push_back(intermediate_slot_desc);
     needs_serialize_ |= aggregate_evaluators_[i]->SupportsSerialize();
   }
 
@@ -181,6 +188,9 @@ Status PartitionedAggregationNode::Prepare(RuntimeState* state) {
     singleton_output_tuple_ =
         ConstructIntermediateTuple(agg_fn_ctxs_, mem_pool_.get(), NULL);
     singleton_output_tuple_returned_ = false;
+    if (FLAGS_enable_vectorized_exprs && singleton_output_tuple_ != NULL) {
+      PrepareVectorizedAggregation(state, intermediate_slot_descs);
+    }
   } else {
     ht_ctx_.reset(new HashTableCtx(build_expr_ctxs_, probe_expr_ctxs_, true, true,
         state->fragment_hash_seed(), MAX_PARTITION_DEPTH, 1));
@@ -189,7 +199,7 @@ Status PartitionedAggregationNode::Prepare(RuntimeState* state) {
     RETURN_IF_ERROR(CreateHashPartitions(0));
   }
 
-  if (state->codegen_enabled()) {
+  if (state->codegen_enabled() && agg_input_batch_.get() == NULL) {
     LlvmCodeGen* codegen;
     RETURN_IF_ERROR(state->GetCodegen(&codegen));
     Function* codegen_process_row_batch_fn = CodegenProcessBatch();
@@ -238,7 +248,9 @@ Status PartitionedAggregationNode::Open(RuntimeState* state) {
     }
 
     SCOPED_TIMER(build_timer_);
-    if (process_row_batch_fn_ != NULL) {
+    if (agg_input_batch_.get() != NULL) {
+      ProcessBatchNoGroupingVectorized(&batch);
+    } else if (process_row_batch_fn_ != NULL) {
       RETURN_IF_ERROR(process_row_batch_fn_(this, &batch, ht_ctx_.get()));
     } else if (probe_expr_ctxs_.empty()) {
       RETURN_IF_ERROR(ProcessBatchNoGrouping(&batch));
@@ -635,6 +647,192 @@ void PartitionedAggregationNode::UpdateTuple(FunctionContext** agg_fn_ctxs,
   }
 }
 
+void PartitionedAggregationNode::PrepareVectorizedAggregation(RuntimeState* state,
+    const vector<SlotDescriptor*>& intermediate_slot_descs) {
+  DCHECK(probe_expr_ctxs_.empty());
+  scoped_ptr<ColumnBatch> batch(new ColumnBatch(state->batch_size()));
+  for (int i = 0; i < aggregate_evaluators_.size(); ++i) {
+    AggFnEvaluator* evaluator = aggregate_evaluators_[i];
+    if (!evaluator->is_builtin() || evaluator->is_merge()) return;
+    const ColumnType& slot_type = intermediate_slot_descs[i]->type();
+    VectorizedExpr* input = NULL;
+    if (!evaluator->is_count_star()) {
+      if (evaluator->input_expr_ctxs().size() != 1) return;
+      input = VectorizedExpr::Create(pool_, state, evaluator->input_expr_ctxs()[0],
+          child(0)->row_desc(), batch.get());
+      if (input == NULL) return;
+    }
+    switch (evaluator->agg_op()) {
+      case AggFnEvaluator::COUNT:
+        if (slot_type.type != TYPE_BIGINT) return;
+        break;
+      case AggFnEvaluator::SUM:
+        // Integers are summed as BIGINT and floating point values as DOUBLE.
+        switch (input->type().type) {
+          case TYPE_TINYINT:
+          case TYPE_SMALLINT:
+          case TYPE_INT:
+          case TYPE_BIGINT:
+            if (slot_type.type != TYPE_BIGINT) return;
+            break;
+          case TYPE_FLOAT:
+          case TYPE_DOUBLE:
+            if (slot_type.type != TYPE_DOUBLE) return;
+            break;
+          default:
+            return;
+        }
+        break;
+      case AggFnEvaluator::MIN:
+      case AggFnEvaluator::MAX:
+        // String min/max copy their result into memory of the function context.
+        if (input->type() != slot_type || slot_type.IsStringType()) return;
+        break;
+      default:
+        return;
+    }
+    vectorized_agg_inputs_.push_back(input);
+    vectorized_agg_slots_.push_back(intermediate_slot_descs[i]);
+  }
+  agg_input_batch_.swap(batch);
+  AddRuntimeExecOption("Vectorized Aggregation");
+}
+
+// Adds the number of non-null values of 'input' to the BIGINT 'slot' of 'tuple'.
+static void CountColumn(ColumnVector* input, int num_rows, Tuple* tuple,
+    const SlotDescriptor* slot) {
+  const bool* nulls = input->nulls();
+  int64_t count = 0;
+  for (int i = 0; i < num_rows; ++i) count += !nulls[i];
+  *reinterpret_cast<int64_t*>(tuple->GetSlot(slot->tuple_offset())) += count;
+}
+
+// Adds the sum of the non-null values of 'input' to 'slot' of 'tuple', which is NULL
+// until the first non-null value.
+template <typename SRC, typename DST>
+static void SumColumn(ColumnVector* input, int num_rows, Tuple* tuple,
+    const SlotDescriptor* slot) {
+  const SRC* values = input->values<SRC>();
+  const bool* nulls = input->nulls();
+  bool is_null = tuple->IsNull(slot->null_indicator_offset());
+  DST* dst = reinterpret_cast<DST*>(tuple->GetSlot(slot->tuple_offset()));
+  // Add the values in row order so that floating point sums are the same as with
+  // AggregateFunctions::SumUpdate().
+  DST sum = is_null ? 0 : *dst;
+  for (int i = 0; i < num_rows; ++i) {
+    if (nulls[i]) continue;
+    sum += values[i];
+    is_null = false;
+  }
+  if (is_null) return;
+  tuple->SetNotNull(slot->null_indicator_offset());
+  *dst = sum;
+}
+
+// Updates the min (or max, if !IS_MIN) in 'slot' of 'tuple' with the non-null values
+// of 'input', with the same comparisons as AggregateFunctions::Min() and Max().
+template <typename T, bool IS_MIN>
+static void MinMaxColumn(ColumnVector* input, int num_rows, Tuple* tuple,
+    const SlotDescriptor* slot) {
+  const T* values = input->values<T>();
+  const bool* nulls = input->nulls();
+  bool is_null = tuple->IsNull(slot->null_indicator_offset());
+  T* dst = reinterpret_cast<T*>(tuple->GetSlot(slot->tuple_offset()));
+  T result = *dst;
+  for (int i = 0; i < num_rows; ++i) {
+    if (nulls[i]) continue;
+    if (is_null || (IS_MIN ? values[i] < result : values[i] > result)) {
+      result = values[i];
+      is_null = false;
+    }
+  }
+  if (is_null) return;
+  tuple->SetNotNull(slot->null_indicator_offset());
+  *dst = result;
+}
+
+template <bool IS_MIN>
+static void MinMaxColumn(ColumnVector* input, int num_rows, Tuple* tuple,
+    const SlotDescriptor* slot) {
+  switch (input->type().type) {
+    case TYPE_BOOLEAN:
+      MinMaxColumn<bool, IS_MIN>(input, num_rows, tuple, slot);
+      break;
+    case TYPE_TINYINT:
+      MinMaxColumn<int8_t, IS_MIN>(input, num_rows, tuple, slot);
+      break;
+    case TYPE_SMALLINT:
+      MinMaxColumn<int16_t, IS_MIN>(input, num_rows, tuple, slot);
+      break;
+    case TYPE_INT:
+      MinMaxColumn<int32_t, IS_MIN>(input, num_rows, tuple, slot);
+      break;
+    case TYPE_BIGINT:
+      MinMaxColumn<int64_t, IS_MIN>(input, num_rows, tuple, slot);
+      break;
+    case TYPE_FLOAT:
+      MinMaxColumn<float, IS_MIN>(input, num_rows, tuple, slot);
+      break;
+    case TYPE_DOUBLE:
+      MinMaxColumn<double, IS_MIN>(input, num_rows, tuple, slot);
+      break;
+    default:
+      DCHECK(false) << input->type();
+  }
+}
+
+void PartitionedAggregationNode::ProcessBatchNoGroupingVectorized(RowBatch* batch) {
+  agg_input_batch_->Gather(batch);
+  const int num_rows = batch->num_rows();
+  Tuple* tuple = singleton_output_tuple_;
+  for (int i = 0; i < aggregate_evaluators_.size(); ++i) {
+    const SlotDescriptor* slot = vectorized_agg_slots_[i];
+    if (vectorized_agg_inputs_[i] == NULL) {
+      // count(*)
+      *reinterpret_cast<int64_t*>(tuple->GetSlot(slot->tuple_offset())) += num_rows;
+      continue;
+    }
+    ColumnVector* input = vectorized_agg_inputs_[i]->Eval(agg_input_batch_.get());
+    switch (aggregate_evaluators_[i]->agg_op()) {
+      case AggFnEvaluator::COUNT:
+        CountColumn(input, num_rows, tuple, slot);
+        break;
+      case AggFnEvaluator::SUM:
+        switch (input->type().type) {
+          case TYPE_TINYINT:
+            SumColumn<int8_t, int64_t>(input, num_rows, tuple, slot);
+            break;
+          case TYPE_SMALLINT:
+            SumColumn<int16_t, int64_t>(input, num_rows, tuple, slot);
+            break;
+          case TYPE_INT:
+            SumColumn<int32_t, int64_t>(input, num_rows, tuple, slot);
+            break;
+          case TYPE_BIGINT:
+            SumColumn<int64_t, int64_t>(input, num_rows, tuple, slot);
+            break;
+          case TYPE_FLOAT:
+            SumColumn<float, double>(input, num_rows, tuple, slot);
+            break;
+          case TYPE_DOUBLE:
+            SumColumn<double, double>(input, num_rows, tuple, slot);
+            break;
+          default:
+            DCHECK(false) << input->type();
+        }
+        break;
+      case AggFnEvaluator::MIN:
+        MinMaxColumn<true>(input, num_rows, tuple, slot);
+        break;
+      case AggFnEvaluator::MAX:
+        MinMaxColumn<false>(input, num_rows, tuple, slot);
+        break;
+      default:
+        DCHECK(false);
+    }
+  }
+}
+
 Tuple* PartitionedAggregationNode::FinalizeTuple(
     const vector<FunctionContext*>& agg_fn_ctxs, Tuple* tuple, MemPool* pool) {
   DCHECK(tuple != NULL || aggregate_evaluators_.empty()) << tuple;
@@ -1290,7 +1488,8 @@ Function* PartitionedAggregationNode::CodegenProcessBatch() {
 
     process_batch_fn = codegen->ReplaceCallSites(process_batch_fn, true,
         equals_fn, "Equals", &replaced);
-    DCHECK_EQ(replaced, 1);
+    // Two in Find() (chained and open addressing) and one in each Insert().
+    DCHECK_EQ(replaced, 4);
   }
 
   process_batch_fn = codegen->ReplaceCallSites(process_batch_fn, false,
@@ -34,6 +34,7 @@ namespace llvm {
 namespace impala {
 
 class AggFnEvaluator;
+class ColumnBatch;
 class LlvmCodeGen;
 class RowBatch;
 class RuntimeState;
@@ -41,6 +42,7 @@ struct StringValue;
 class Tuple;
 class TupleDescriptor;
 class SlotDescriptor;
+class VectorizedExpr;
 
 // Node for doing partitioned hash aggregation.
 // This node consumes the input (which can be from the child(0) or a spilled partition).
@@ -76,7 +78,6 @@ class SlotDescriptor;
 // some number of rows (from likely going to disk).
 // TODO: consider allowing to spill the hash table structure in addition to the rows.
 // TODO: do we want to insert a buffer before probing into the partition's hash table.
-// TODO: use a prefetch/batched probe interface.
 // TODO: return rows from the aggregated_row_stream rather than the HT.
 // TODO: spill the HT as well
 // TODO: think about spilling heuristic.
@@ -189,6 +190,16 @@ class PartitionedAggregationNode : public ExecNode {
   // Jitted ProcessRowBatch function pointer.  Null if codegen is disabled.
   ProcessRowBatchFn process_row_batch_fn_;
 
+  // Set if there is no grouping and all aggregate functions are builtin count(), sum(),
+  // min() or max() over inputs that VectorizedExpr supports. Each input batch is then
+  // gathered into agg_input_batch_ and aggregated a column at a time by
+  // ProcessBatchNoGroupingVectorized(), which takes precedence over codegen.
+  // vectorized_agg_inputs_ has the input of each evaluator, NULL for count(*), and
+  // vectorized_agg_slots_ its slot in singleton_output_tuple_.
+  boost::scoped_ptr<ColumnBatch> agg_input_batch_;
+  std::vector<VectorizedExpr*> vectorized_agg_inputs_;
+  std::vector<SlotDescriptor*> vectorized_agg_slots_;
+
   // Time spent processing the child rows
   RuntimeProfile::Counter* build_timer_;
 
@@ -325,6 +336,14 @@ class PartitionedAggregationNode : public ExecNode {
   // ProcessBatch() for codegen. This function is replaced by codegen.
   Status ProcessBatchNoGrouping(RowBatch* batch, HashTableCtx* ht_ctx = NULL);
 
+  // Sets up agg_input_batch_ if the aggregation can be vectorized, see above.
+  // 'intermediate_slot_descs' are the slots of aggregate_evaluators_.
+  void PrepareVectorizedAggregation(RuntimeState* state,
+      const std::vector<SlotDescriptor*>& intermediate_slot_descs);
+
+  // Same as ProcessBatchNoGrouping() using vectorized_agg_inputs_.
+  void ProcessBatchNoGroupingVectorized(RowBatch* batch);
+
   // Processes a batch of rows. This is the core function of the algorithm. We partition
   // the rows into hash_partitions_, spilling as necessary.
   // If AGGREGATED_ROWS is true, it means that the rows in the batch are already
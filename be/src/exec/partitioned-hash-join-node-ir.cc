@@ -48,6 +48,12 @@ int PartitionedHashJoinNode::ProcessProbeBatch(
   int max_rows = out_batch->capacity() - out_batch->num_rows();
   int num_rows_added = 0;
 
+  // Probe rows [cache_begin, cache_end) have been evaluated and hashed into ht_ctx's row
+  // cache and their buckets prefetched. The cache is not kept across calls since the
+  // cached var-len values may point to expr allocations freed by QueryMaintenance().
+  int cache_begin = probe_batch_pos_;
+  int cache_end = probe_batch_pos_;
+
   while (probe_batch_pos_ >= 0) {
     if (current_probe_row_ != NULL) {
       while (!hash_tbl_iterator_.AtEnd()) {
@@ -134,11 +140,26 @@ next_row:
       goto end;
     }
 
+    if (probe_batch_pos_ == cache_end) {
+      // Hash the next group of rows up front so that their bucket lookups overlap.
+      cache_begin = probe_batch_pos_;
+      cache_end =
+          min(probe_batch_->num_rows(), cache_begin + HashTableCtx::ROW_CACHE_SIZE);
+      for (int i = cache_begin; i < cache_end; ++i) {
+        uint32_t hash;
+        bool is_valid = ht_ctx->EvalAndHashProbe(probe_batch_->GetRow(i), &hash);
+        ht_ctx->CacheCurrentRow(i - cache_begin, is_valid, hash);
+        if (!is_valid) continue;
+        HashTable* hash_tbl = hash_tbls_[hash >> (32 - NUM_PARTITIONING_BITS)];
+        if (hash_tbl != NULL) hash_tbl->PrefetchBucket<true>(hash);
+      }
+    }
+
     // Establish current_probe_row_ and find its corresponding partition.
-    current_probe_row_ = probe_batch_->GetRow(probe_batch_pos_++);
+    current_probe_row_ = probe_batch_->GetRow(probe_batch_pos_);
     matched_probe_ = false;
     uint32_t hash;
-    if (!ht_ctx->EvalAndHashProbe(current_probe_row_, &hash)) {
+    if (!ht_ctx->RestoreCachedRow(probe_batch_pos_++ - cache_begin, &hash)) {
       if (join_op_ == TJoinOp::NULL_AWARE_LEFT_ANTI_JOIN) {
         // For NAAJ, we need to treat NULLs on the probe carefully. The logic is:
         // 1. No build rows -> Return this row.
@@ -55,9 +55,11 @@ PartitionedHashJoinNode::PartitionedHashJoinNode(
     non_empty_build_(false),
     null_probe_rows_(NULL),
     null_probe_output_idx_(-1) {
+  DCHECK_LE(NUM_PARTITIONING_BITS, HashTable::MAX_PARTITIONING_BITS);
   memset(hash_tbls_, 0, sizeof(hash_tbls_));
   can_add_probe_filters_ = tnode.hash_join_node.add_probe_filters;
   can_add_probe_filters_ &= FLAGS_enable_phj_probe_side_filtering;
+  is_partitioned_ = tnode.hash_join_node.is_partitioned;
 }
 
 Status PartitionedHashJoinNode::Init(const TPlanNode& tnode) {
@@ -330,12 +332,9 @@ Status PartitionedHashJoinNode::Partition::BuildHashTableInternal(
   is_spilled_ = false;
   COUNTER_ADD(parent_->num_hash_buckets_, hash_tbl_->num_buckets());
 
-  // TODO: We build the filters after we constructed the hash table.  This is what the
-  // old (HashJoinNode) code was doing.  We can do better, because now we know a priori
-  // whether we are going to add probe filter or not. For example, we can be building
-  // the filters while we are streaming the rows from the batch, and not at the end after
-  // the HT has been built.
-  if (AddProbeFilters) {
+  // TODO: We build the filters after we constructed the hash table. We could be building
+  // them while we are streaming the rows from the batch instead.
+  if (AddProbeFilters && !parent_->probe_filters_.empty()) {
     DCHECK_EQ(level_, 0) << "Should not add filters if repartitioning";
     hash_tbl_->UpdateProbeFilters(ctx, parent_->probe_filters_);
   }
@@ -351,50 +350,6 @@ not_built:
   return Status::OK;
 }
 
-bool PartitionedHashJoinNode::AllocateProbeFilters(RuntimeState* state) {
-  if (!can_add_probe_filters_) return false;
-  DCHECK_NOTNULL(ht_ctx_.get());
-  DCHECK_EQ(build_expr_ctxs_.size(), probe_expr_ctxs_.size());
-  probe_filters_.resize(probe_expr_ctxs_.size());
-  for (int i = 0; i < build_expr_ctxs_.size(); ++i) {
-    if (probe_expr_ctxs_[i]->root()->is_slotref()) {
-      probe_filters_[i].first =
-          reinterpret_cast<SlotRef*>(probe_expr_ctxs_[i]->root())->slot_id();
-      probe_filters_[i].second = new Bitmap(state->slot_filter_bitmap_size());
-    } else {
-      probe_filters_[i].second = NULL;
-    }
-  }
-  return true;
-}
-
-bool PartitionedHashJoinNode::AttachProbeFilters(RuntimeState* state) {
-  if (can_add_probe_filters_) {
-    // Add all the bitmaps to the runtime state.
-    bool acquired_ownership = false;
-    for (int i = 0; i < probe_filters_.size(); ++i) {
-      if (probe_filters_[i].second == NULL) continue;
-      state->AddBitmapFilter(probe_filters_[i].first, probe_filters_[i].second,
-                             &acquired_ownership);
-      VLOG(2) << "Bitmap filter added on slot: " << probe_filters_[i].first;
-      if (!acquired_ownership) {
-        delete probe_filters_[i].second;
-        probe_filters_[i].second = NULL;
-      }
-    }
-    return true;
-  } else {
-    // Make sure there are no memory leaks.
-    for (int i = 0; i < probe_filters_.size(); ++i) {
-      if (probe_filters_[i].second != NULL) {
-        delete probe_filters_[i].second;
-        probe_filters_[i].second = NULL;
-      }
-    }
-    return false;
-  }
-}
-
 // TODO: can we do better with the spilling heuristic.
 Status PartitionedHashJoinNode::SpillPartition() {
   int64_t max_freed_mem = 0;
@@ -434,13 +389,12 @@ Status PartitionedHashJoinNode::ConstructBuildSide(RuntimeState* state) {
   RETURN_IF_ERROR(Expr::Open(build_expr_ctxs_, state));
   RETURN_IF_ERROR(Expr::Open(probe_expr_ctxs_, state));
   RETURN_IF_ERROR(Expr::Open(other_join_conjunct_ctxs_, state));
-  AllocateProbeFilters(state);
 
   // Do a full scan of child(1) and partition the rows.
   RETURN_IF_ERROR(child(1)->Open(state));
   RETURN_IF_ERROR(ProcessBuildInput(state, 0));
 
-  AttachProbeFilters(state);
+  if (can_add_probe_filters_) PublishProbeFilters(state, probe_expr_ctxs_);
   UpdateState(PROCESSING_PROBE);
   return Status::OK;
 }
@@ -978,26 +932,19 @@ Status PartitionedHashJoinNode::OutputNullAwareProbeRows(RuntimeState* state,
 Status PartitionedHashJoinNode::BuildHashTables(RuntimeState* state) {
   DCHECK_EQ(hash_partitions_.size(), PARTITION_FANOUT);
 
-  // Decide whether probe filters will be built.
+  // Decide whether probe filters will be built. They are only built over the build
+  // input from child(1), and only if all of it gets into hash tables: the rows of a
+  // spilled partition would be missing from the filters.
   if (input_partition_ == NULL && can_add_probe_filters_) {
-    // TODO: Should we just give up in case we have any spilled partition?
-    uint64_t num_build_rows = 0;
+    bool any_spilled = false;
+    int64_t num_build_rows = 0;
     BOOST_FOREACH(Partition* partition, hash_partitions_) {
-      const uint64_t partition_num_rows = partition->build_rows()->num_rows();
-      num_build_rows += partition_num_rows;
+      num_build_rows += partition->build_rows()->num_rows();
+      any_spilled |= partition->is_spilled();
     }
-    // TODO: Using this simple heuristic where we compare the number of build rows
-    // to the size of the slot filter bitmap. This is essentially not a Bloom filter
-    // but a 1-1 filter, and probably it is missing oportunities. Should revisit.
-    can_add_probe_filters_ = (num_build_rows < state->slot_filter_bitmap_size());
-    if (can_add_probe_filters_) {
+    if (!any_spilled && AllocateProbeFilters(state, probe_expr_ctxs_, num_build_rows)) {
       AddRuntimeExecOption("Build-Side Filter Pushed Down");
-    } else {
-      VLOG(2) << "Disabling probe filter push down because build side is too large: "
-              << num_build_rows;
     }
-  } else {
-    can_add_probe_filters_ = false;
   }
 
   // First loop over the partitions and build hash tables for the partitions that
@@ -1012,7 +959,8 @@ Status PartitionedHashJoinNode::BuildHashTables(RuntimeState* state) {
     bool built = false;
     if (!partition->is_spilled()) {
       DCHECK(partition->build_rows()->is_pinned());
-      RETURN_IF_ERROR(partition->BuildHashTable(state, &built, can_add_probe_filters_));
+      RETURN_IF_ERROR(
+          partition->BuildHashTable(state, &built, !probe_filters_.empty()));
     }
 
     if (built) {
@@ -1020,6 +968,8 @@ Status PartitionedHashJoinNode::BuildHashTables(RuntimeState* state) {
       // the probe stream anymore.
       partition->probe_rows()->Close();
     } else {
+      // The rows of this partition are missing from the probe filters.
+      ReleaseProbeFilters(state);
       RETURN_IF_ERROR(partition->Spill(true));
       DCHECK(partition->probe_rows()->has_write_block());
     }
@@ -1467,8 +1417,9 @@ bool PartitionedHashJoinNode::CodegenProcessProbeBatch(
 
   process_probe_batch_fn = codegen->ReplaceCallSites(process_probe_batch_fn, true,
       equals_fn, "Equals", &replaced);
-  // Depends on join_op_
-  DCHECK(replaced == 2 || replaced == 3 || replaced == 4) << replaced;
+  // Depends on join_op_: one in each of the chained and open addressing paths of Find()
+  // and one in each chained HashTable::Iterator::Next<true>().
+  DCHECK(replaced == 3 || replaced == 4 || replaced == 5) << replaced;
 
   // process_probe_batch_fn_level0 uses CRC hash if available,
   // process_probe_batch_fn uses murmur
@@ -229,13 +229,6 @@ class PartitionedHashJoinNode : public BlockingJoinNode {
   // Prepares for probing the next batch.
   void ResetForProbe();
 
-  // For each 'probe_expr_' in 'ht_ctx' that is a slot ref, allocate a bitmap filter on
-  // that slot. Returns false if it should not add probe filters.
-  bool AllocateProbeFilters(RuntimeState* state);
-
-  // Attach the probe filters to runtime state.
-  bool AttachProbeFilters(RuntimeState* state);
-
   // Codegen function to create output row. Assumes that the probe row is non-NULL.
   llvm::Function* CodegenCreateOutputRow(LlvmCodeGen* codegen);
 
@@ -426,10 +419,6 @@ class PartitionedHashJoinNode : public BlockingJoinNode {
   // rows of the partition that it is in the front.
   std::list<Partition*> output_build_partitions_;
 
-  // Used for concentrating the existence bits from all the partitions, used by the
-  // probe-side filter optimization.
-  std::vector<std::pair<SlotId, Bitmap*> > probe_filters_;
-
   // Partition used if null_aware_ is set. This partition is always processed at the end
   // after all build and probe rows are processed. Rows are added to this partition along
   // the way.
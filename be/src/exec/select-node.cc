@@ -14,11 +14,15 @@
 
 #include "exec/select-node.h"
 #include "exprs/expr.h"
+#include "exprs/vectorized-expr.h"
+#include "runtime/column-batch.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/raw-value.h"
 #include "gen-cpp/PlanNodes_types.h"
 
+DECLARE_bool(enable_vectorized_exprs);
+
 using namespace std;
 
 namespace impala {
@@ -28,7 +32,8 @@ SelectNode::SelectNode(
     : ExecNode(pool, tnode, descs),
       child_row_batch_(NULL),
       child_row_idx_(0),
-      child_eos_(false) {
+      child_eos_(false),
+      selection_idx_(0) {
 }
 
 Status SelectNode::Prepare(RuntimeState* state) {
@@ -41,6 +46,14 @@ Status SelectNode::Prepare(RuntimeState* state) {
 Status SelectNode::Open(RuntimeState* state) {
   RETURN_IF_ERROR(ExecNode::Open(state));
   RETURN_IF_ERROR(child(0)->Open(state));
+  if (FLAGS_enable_vectorized_exprs && !conjunct_ctxs_.empty() &&
+      column_batch_.get() == NULL) {
+    column_batch_.reset(new ColumnBatch(state->batch_size()));
+    if (!VectorizedExpr::Create(pool_, state, conjunct_ctxs_, row_desc(),
+        column_batch_.get(), &vectorized_conjuncts_)) {
+      column_batch_.reset();
+    }
+  }
   return Status::OK;
 }
 
@@ -65,9 +78,16 @@ Status SelectNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos)
       child_row_batch_->Reset();
       RETURN_IF_ERROR(child(0)->GetNext(state, child_row_batch_.get(), &child_eos_));
       child_row_idx_ = 0;
+      if (column_batch_.get() != NULL) {
+        column_batch_->Gather(child_row_batch_.get());
+        VectorizedExpr::EvalConjuncts(vectorized_conjuncts_, column_batch_.get());
+        selection_idx_ = 0;
+      }
     }
 
-    if (CopyRows(row_batch)) {
+    bool return_batch = column_batch_.get() != NULL ?
+        CopySelectedRows(row_batch) : CopyRows(row_batch);
+    if (return_batch) {
       *eos = ReachedLimit()
           || (child_row_idx_ == child_row_batch_->num_rows() && child_eos_);
       return Status::OK;
@@ -103,9 +123,31 @@ bool SelectNode::CopyRows(RowBatch* output_batch) {
   return output_batch->AtCapacity();
 }
 
+bool SelectNode::CopySelectedRows(RowBatch* output_batch) {
+  const int* selection = column_batch_->selection();
+  for (; selection_idx_ < column_batch_->num_selected(); ++selection_idx_) {
+    // Keep child_row_idx_ short of the end of the batch until all rows are copied.
+    child_row_idx_ = selection[selection_idx_];
+    int dst_row_idx = output_batch->AddRow();
+    if (dst_row_idx == RowBatch::INVALID_ROW_INDEX) return true;
+    output_batch->CopyRow(child_row_batch_->GetRow(child_row_idx_),
+        output_batch->GetRow(dst_row_idx));
+    output_batch->CommitLastRow();
+    ++num_rows_returned_;
+    COUNTER_SET(rows_returned_counter_, num_rows_returned_);
+    if (ReachedLimit()) {
+      ++selection_idx_;
+      return true;
+    }
+  }
+  child_row_idx_ = child_row_batch_->num_rows();
+  return output_batch->AtCapacity();
+}
+
 void SelectNode::Close(RuntimeState* state) {
   if (is_closed()) return;
   child_row_batch_.reset();
+  column_batch_.reset();
   ExecNode::Close(state);
 }
 
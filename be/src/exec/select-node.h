@@ -24,8 +24,10 @@
 
 namespace impala {
 
+class ColumnBatch;
 class Tuple;
 class TupleRow;
+class VectorizedExpr;
 
 // Node that evaluates conjuncts and enforces a limit but otherwise passes along
 // the rows pulled from its child unchanged.
@@ -48,10 +50,22 @@ class SelectNode : public ExecNode {
   // true if last GetNext() call on child signalled eos
   bool child_eos_;
 
+  // If all conjuncts can be vectorized, each child batch is gathered into
+  // column_batch_ and filtered with vectorized_conjuncts_ before its rows are copied.
+  // NULL otherwise.
+  boost::scoped_ptr<ColumnBatch> column_batch_;
+  std::vector<VectorizedExpr*> vectorized_conjuncts_;
+
+  // index of the next row to copy in the selection of column_batch_
+  int selection_idx_;
+
   // Copy rows from child_row_batch_ for which conjuncts_ evaluate to true to
   // output_batch, up to limit_.
   // Return true if limit was hit or output_batch should be returned, otherwise false.
   bool CopyRows(RowBatch* output_batch);
+
+  // Same as CopyRows() for the rows selected by vectorized_conjuncts_.
+  bool CopySelectedRows(RowBatch* output_batch);
 };
 
 }
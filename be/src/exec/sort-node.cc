@@ -13,11 +13,13 @@
 // limitations under the License.
 
 #include "exec/sort-node.h"
+#include "codegen/llvm-codegen.h"
 #include "exec/sort-exec-exprs.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/sorted-run-merger.h"
 
+using namespace llvm;
 using namespace std;
 
 namespace impala {
@@ -25,7 +27,8 @@ namespace impala {
 SortNode::SortNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs)
   : ExecNode(pool, tnode, descs),
     offset_(tnode.sort_node.__isset.offset ? tnode.sort_node.offset : 0),
-    num_rows_skipped_(0) {
+    num_rows_skipped_(0),
+    materialize_exprs_fn_(NULL) {
 }
 
 SortNode::~SortNode() {
@@ -43,6 +46,25 @@ Status SortNode::Prepare(RuntimeState* state) {
   SCOPED_TIMER(runtime_profile_->total_time_counter());
   RETURN_IF_ERROR(ExecNode::Prepare(state));
   RETURN_IF_ERROR(sort_exec_exprs_.Prepare(state, child(0)->row_desc(), row_descriptor_));
+  less_than_.reset(new TupleRowComparator(
+      sort_exec_exprs_.lhs_ordering_expr_ctxs(),
+      sort_exec_exprs_.rhs_ordering_expr_ctxs(), is_asc_order_, nulls_first_));
+
+  if (state->codegen_enabled()) {
+    LlvmCodeGen* codegen;
+    RETURN_IF_ERROR(state->GetCodegen(&codegen));
+    bool codegend_compare = less_than_->Codegen(state);
+    Function* materialize_exprs_fn = Tuple::CodegenMaterializeExprs(state,
+        *row_descriptor_.tuple_descriptors()[0],
+        sort_exec_exprs_.sort_tuple_slot_expr_ctxs());
+    if (materialize_exprs_fn != NULL) {
+      codegen->AddFunctionToJit(materialize_exprs_fn,
+          reinterpret_cast<void**>(&materialize_exprs_fn_));
+    }
+    if (codegend_compare || materialize_exprs_fn != NULL) {
+      AddRuntimeExecOption("Codegen Enabled");
+    }
+  }
   return Status::OK;
 }
 
@@ -54,12 +76,9 @@ Status SortNode::Open(RuntimeState* state) {
   RETURN_IF_ERROR(state->QueryMaintenance());
   RETURN_IF_ERROR(child(0)->Open(state));
 
-  TupleRowComparator less_than(
-      sort_exec_exprs_.lhs_ordering_expr_ctxs(), sort_exec_exprs_.rhs_ordering_expr_ctxs(),
-      is_asc_order_, nulls_first_);
   sorter_.reset(new Sorter(
-      less_than, sort_exec_exprs_.sort_tuple_slot_expr_ctxs(),
-      &row_descriptor_, mem_tracker(), runtime_profile(), state));
+      *less_than_, sort_exec_exprs_.sort_tuple_slot_expr_ctxs(),
+      &row_descriptor_, mem_tracker(), runtime_profile(), state, materialize_exprs_fn_));
 
   // The child has been opened and the sorter created. Sort the input.
   // The final merge is done on-demand as rows are requested in GetNext().
@@ -65,6 +65,13 @@ class SortNode : public ExecNode {
   SortExecExprs sort_exec_exprs_;
   std::vector<bool> is_asc_order_;
   std::vector<bool> nulls_first_;
+
+  // Comparator of the sort tuples, created and codegen'd in Prepare().
+  boost::scoped_ptr<TupleRowComparator> less_than_;
+
+  // Codegen'd materialization of the sort tuples, passed to the sorter. NULL if
+  // codegen is disabled or failed.
+  Tuple::MaterializeExprsFn materialize_exprs_fn_;
 };
 
 }
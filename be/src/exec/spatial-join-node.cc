@@ -0,0 +1,614 @@
+// Copyright 2013 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exec/spatial-join-node.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "exprs/expr.h"
+#include "exprs/expr-context.h"
+#include "runtime/buffered-tuple-stream.inline.h"
+#include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
+#include "util/debug-util.h"
+#include "util/runtime-profile.h"
+#include "util/spatial-kernels.h"
+
+#include "gen-cpp/PlanNodes_types.h"
+
+using namespace boost;
+using namespace impala;
+using namespace std;
+
+SpatialJoinNode::SpatialJoinNode(
+    ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs)
+  : BlockingJoinNode("SpatialJoinNode", TJoinOp::INNER_JOIN, pool, tnode, descs),
+    state_(NULL),
+    probe_expr_ctx_(NULL),
+    build_expr_ctx_(NULL),
+    grid_(tnode.spatial_join_node.grid),
+    is_partitioned_(tnode.spatial_join_node.is_partitioned),
+    instance_idx_(0),
+    num_instances_(1),
+    num_owned_cells_(0),
+    block_mgr_client_(NULL),
+    input_partition_(NULL),
+    build_entries_idx_(0),
+    probe_entries_idx_(0),
+    entries_mem_(0),
+    pending_pairs_idx_(0),
+    replicated_row_counter_(NULL),
+    candidate_pair_counter_(NULL),
+    partitions_created_(NULL),
+    num_spilled_partitions_(NULL),
+    num_repartitions_(NULL),
+    max_partition_level_(NULL) {
+}
+
+Status SpatialJoinNode::Init(const TPlanNode& tnode) {
+  RETURN_IF_ERROR(BlockingJoinNode::Init(tnode));
+  DCHECK(tnode.__isset.spatial_join_node);
+  RETURN_IF_ERROR(Expr::CreateExprTree(
+      pool_, tnode.spatial_join_node.probe_expr, &probe_expr_ctx_));
+  RETURN_IF_ERROR(Expr::CreateExprTree(
+      pool_, tnode.spatial_join_node.build_expr, &build_expr_ctx_));
+  return Status::OK;
+}
+
+Status SpatialJoinNode::Prepare(RuntimeState* state) {
+  SCOPED_TIMER(runtime_profile_->total_time_counter());
+  RETURN_IF_ERROR(BlockingJoinNode::Prepare(state));
+  state_ = state;
+
+  // The MBR exprs are evaluated in the context of the rows produced by our left and
+  // right children, respectively.
+  RETURN_IF_ERROR(probe_expr_ctx_->Prepare(state, child(0)->row_desc()));
+  RETURN_IF_ERROR(build_expr_ctx_->Prepare(state, child(1)->row_desc()));
+  DCHECK_EQ(probe_expr_ctx_->root()->type().type, TYPE_RECTANGLE);
+  DCHECK_EQ(build_expr_ctx_->root()->type().type, TYPE_RECTANGLE);
+
+  if (is_partitioned_) {
+    instance_idx_ = state->fragment_ctx().fragment_instance_idx;
+    num_instances_ = state->fragment_ctx().num_fragment_instances;
+  }
+  DCHECK_GT(num_instances_, 0);
+  DCHECK_LT(instance_idx_, num_instances_);
+  num_owned_cells_ =
+      (grid_.num_cells() - instance_idx_ + num_instances_ - 1) / num_instances_;
+
+  // We need two output buffers per partition (one for build and one for probe) and
+  // one additional buffer for each stream of the input partition while repartitioning.
+  int num_reserved_buffers = PARTITION_FANOUT * 2 + 2;
+  RETURN_IF_ERROR(state->block_mgr()->RegisterClient(
+      num_reserved_buffers, mem_tracker(), state, &block_mgr_client_));
+
+  replicated_row_counter_ =
+      ADD_COUNTER(runtime_profile(), "ReplicatedRows", TCounterType::UNIT);
+  candidate_pair_counter_ =
+      ADD_COUNTER(runtime_profile(), "CandidatePairs", TCounterType::UNIT);
+  partitions_created_ =
+      ADD_COUNTER(runtime_profile(), "PartitionsCreated", TCounterType::UNIT);
+  max_partition_level_ = runtime_profile()->AddHighWaterMarkCounter(
+      "MaxPartitionLevel", TCounterType::UNIT);
+  num_repartitions_ =
+      ADD_COUNTER(runtime_profile(), "NumRepartitions", TCounterType::UNIT);
+  num_spilled_partitions_ =
+      ADD_COUNTER(runtime_profile(), "SpilledPartitions", TCounterType::UNIT);
+  return Status::OK;
+}
+
+void SpatialJoinNode::Close(RuntimeState* state) {
+  if (is_closed()) return;
+  for (int i = 0; i < partitions_.size(); ++i) partitions_[i]->Close(NULL);
+  partitions_.clear();
+  for (list<Partition*>::iterator it = partitions_to_join_.begin();
+      it != partitions_to_join_.end(); ++it) {
+    (*it)->Close(NULL);
+  }
+  partitions_to_join_.clear();
+  if (input_partition_ != NULL) input_partition_->Close(NULL);
+  build_rows_batch_.reset();
+  probe_rows_batch_.reset();
+  ReleaseEntries();
+  pending_pairs_.clear();
+  if (block_mgr_client_ != NULL) {
+    state->block_mgr()->ClearReservations(block_mgr_client_);
+  }
+  if (probe_expr_ctx_ != NULL) probe_expr_ctx_->Close(state);
+  if (build_expr_ctx_ != NULL) build_expr_ctx_->Close(state);
+  BlockingJoinNode::Close(state);
+}
+
+SpatialJoinNode::Partition::Partition(RuntimeState* state, SpatialJoinNode* parent,
+    int level, int64_t id)
+  : parent_(parent),
+    is_closed_(false),
+    is_spilled_(false),
+    level_(level),
+    id_(id),
+    build_rows_(state->obj_pool()->Add(new BufferedTupleStream(
+        state, parent_->child(1)->row_desc(), state->block_mgr(),
+        parent_->block_mgr_client_))),
+    probe_rows_(state->obj_pool()->Add(new BufferedTupleStream(
+        state, parent_->child(0)->row_desc(), state->block_mgr(),
+        parent_->block_mgr_client_))) {
+}
+
+SpatialJoinNode::Partition::~Partition() {
+  DCHECK(is_closed());
+}
+
+bool SpatialJoinNode::Partition::ContainsCell(int cell_id) const {
+  return parent_->CellKey(cell_id) % PartitionModulus(level_ + 1) == id_;
+}
+
+Status SpatialJoinNode::Partition::Spill(bool unpin_all) {
+  if (!is_spilled_) {
+    COUNTER_ADD(parent_->num_spilled_partitions_, 1);
+    if (parent_->num_spilled_partitions_->value() == 1) {
+      parent_->AddRuntimeExecOption("Spilled");
+    }
+  }
+  is_spilled_ = true;
+  RETURN_IF_ERROR(build_rows_->UnpinStream(unpin_all));
+  return probe_rows_->UnpinStream(unpin_all);
+}
+
+void SpatialJoinNode::Partition::Close(RowBatch* batch) {
+  if (is_closed()) return;
+  is_closed_ = true;
+  if (batch == NULL) {
+    build_rows_->Close();
+    probe_rows_->Close();
+  } else {
+    batch->AddTupleStream(build_rows_);
+    batch->AddTupleStream(probe_rows_);
+  }
+  build_rows_ = NULL;
+  probe_rows_ = NULL;
+}
+
+int64_t SpatialJoinNode::PartitionModulus(int level) {
+  int64_t modulus = 1;
+  for (int i = 0; i < level; ++i) modulus *= PARTITION_FANOUT;
+  return modulus;
+}
+
+Status SpatialJoinNode::ConstructBuildSide(RuntimeState* state) {
+  RETURN_IF_ERROR(build_expr_ctx_->Open(state));
+  RETURN_IF_ERROR(probe_expr_ctx_->Open(state));
+
+  // Do a full scan of child(1) and partition the rows.
+  RETURN_IF_ERROR(child(1)->Open(state));
+  RETURN_IF_ERROR(CreatePartitions(0, 0));
+  return ConsumeChild(state, 1, NULL, false);
+}
+
+Status SpatialJoinNode::InitGetNext(TupleRow* first_probe_row) {
+  // The sweep needs all probe rows of a cell, so consume the rest of the left child.
+  // BlockingJoinNode::Open() already fetched the first batch into probe_batch_.
+  if (first_probe_row != NULL) {
+    RETURN_IF_ERROR(ConsumeChild(state_, 0, probe_batch_.get(), probe_side_eos_));
+    probe_side_eos_ = true;
+  }
+  return QueuePartitions();
+}
+
+Status SpatialJoinNode::ConsumeChild(RuntimeState* state, int child_idx,
+    RowBatch* first_batch, bool eos) {
+  bool is_build = child_idx == 1;
+  RuntimeProfile::Counter* timer = is_build ? build_timer_ : probe_timer_;
+  if (first_batch != NULL) {
+    SCOPED_TIMER(timer);
+    RETURN_IF_ERROR(PartitionBatch(first_batch, is_build));
+    first_batch->Reset();
+  }
+  RowBatch batch(child(child_idx)->row_desc(), state->batch_size(), mem_tracker());
+  while (!eos) {
+    RETURN_IF_CANCELLED(state);
+    RETURN_IF_ERROR(state->QueryMaintenance());
+    RETURN_IF_ERROR(child(child_idx)->GetNext(state, &batch, &eos));
+    COUNTER_ADD(is_build ? build_row_counter_ : probe_row_counter_, batch.num_rows());
+    SCOPED_TIMER(timer);
+    RETURN_IF_ERROR(PartitionBatch(&batch, is_build));
+    batch.Reset();
+  }
+  return Status::OK;
+}
+
+Status SpatialJoinNode::CreatePartitions(int level, int64_t parent_id) {
+  DCHECK(partitions_.empty());
+  if (level > 0 && PartitionModulus(level) >= num_owned_cells_) {
+    // The partition that needs to be split holds a single cell.
+    Status status = Status::MEM_LIMIT_EXCEEDED;
+    status.AddErrorMsg("Cannot perform spatial join. The rows of a single grid cell do"
+        " not fit in memory. This could mean the grid is too coarse or the memory limit"
+        " is set too low.");
+    state_->SetMemLimitExceeded();
+    return status;
+  }
+
+  for (int i = 0; i < PARTITION_FANOUT; ++i) {
+    partitions_.push_back(pool_->Add(new Partition(state_, this, level,
+        parent_id + i * PartitionModulus(level))));
+    RETURN_IF_ERROR(partitions_[i]->build_rows()->Init(runtime_profile()));
+    RETURN_IF_ERROR(partitions_[i]->probe_rows()->Init(runtime_profile()));
+  }
+  COUNTER_ADD(partitions_created_, PARTITION_FANOUT);
+  COUNTER_SET(max_partition_level_, level);
+  return Status::OK;
+}
+
+Status SpatialJoinNode::PartitionBatch(RowBatch* batch, bool is_build) {
+  DCHECK_EQ(partitions_.size(), PARTITION_FANOUT);
+  ExprContext* mbr_expr_ctx = is_build ? build_expr_ctx_ : probe_expr_ctx_;
+  // The partitions split the cells with key % modulus == parent_id.
+  int level = partitions_[0]->level();
+  int64_t modulus = PartitionModulus(level);
+  int64_t parent_id = partitions_[0]->id();
+  for (int i = 0; i < batch->num_rows(); ++i) {
+    TupleRow* row = batch->GetRow(i);
+    void* value = mbr_expr_ctx->GetValue(row);
+    if (value == NULL) continue;
+    const RectangleValue& mbr = *reinterpret_cast<RectangleValue*>(value);
+
+    overlapped_cells_.clear();
+    grid_.GetOverlappedCells(mbr, &overlapped_cells_);
+    if (level == 0 && overlapped_cells_.size() > 1) {
+      COUNTER_ADD(replicated_row_counter_, 1);
+    }
+    // Bitmap of the partitions the row was appended to.
+    uint32_t appended = 0;
+    for (int j = 0; j < overlapped_cells_.size(); ++j) {
+      int cell_id = overlapped_cells_[j];
+      if (!IsOwnedCell(cell_id)) continue;
+      int64_t key = CellKey(cell_id);
+      if (key % modulus != parent_id) continue;
+      int partition_idx = (key / modulus) % PARTITION_FANOUT;
+      if (appended & (1 << partition_idx)) continue;
+      appended |= 1 << partition_idx;
+      Partition* partition = partitions_[partition_idx];
+      RETURN_IF_ERROR(AppendRow(
+          is_build ? partition->build_rows() : partition->probe_rows(), row));
+    }
+  }
+  mbr_expr_ctx->FreeLocalAllocations();
+  return Status::OK;
+}
+
+Status SpatialJoinNode::AppendRow(BufferedTupleStream* stream, TupleRow* row) {
+  if (LIKELY(stream->AddRow(row))) return Status::OK;
+  RETURN_IF_ERROR(stream->status());
+  // We ran out of memory. Pick a partition to spill.
+  RETURN_IF_ERROR(SpillPartition());
+  if (!stream->AddRow(row)) {
+    RETURN_IF_ERROR(stream->status());
+    return Status("Could not spill row.");
+  }
+  return Status::OK;
+}
+
+Status SpatialJoinNode::SpillPartition() {
+  int64_t max_freed_mem = 0;
+  int partition_idx = -1;
+
+  // Iterate over the partitions and pick the largest partition to spill.
+  for (int i = 0; i < partitions_.size(); ++i) {
+    if (partitions_[i]->is_closed()) continue;
+    if (partitions_[i]->is_spilled()) continue;
+    int64_t mem = partitions_[i]->build_rows()->bytes_in_mem(false) +
+        partitions_[i]->probe_rows()->bytes_in_mem(false);
+    if (mem > max_freed_mem) {
+      max_freed_mem = mem;
+      partition_idx = i;
+    }
+  }
+
+  if (partition_idx == -1) {
+    // Could not find a partition to spill. This means the mem limit was just too
+    // low to put a buffer in front of each partition.
+    Status status = Status::MEM_LIMIT_EXCEEDED;
+    status.AddErrorMsg("Mem limit is too low to perform spatial join. We do not "
+        "have enough memory to maintain a buffer per partition.");
+    return status;
+  }
+  VLOG(2) << "Spilling partition: " << partition_idx << endl << ExecNode::DebugString();
+  return partitions_[partition_idx]->Spill(false);
+}
+
+Status SpatialJoinNode::QueuePartitions() {
+  for (int i = 0; i < partitions_.size(); ++i) {
+    Partition* partition = partitions_[i];
+    if (partition->build_rows()->num_rows() == 0 ||
+        partition->probe_rows()->num_rows() == 0) {
+      // The partition can't produce any results.
+      partition->Close(NULL);
+    } else if (partition->is_spilled()) {
+      // No more rows will be appended, so release the write buffers.
+      RETURN_IF_ERROR(partition->Spill(true));
+      partitions_to_join_.push_back(partition);
+    } else {
+      partitions_to_join_.push_front(partition);
+    }
+  }
+  partitions_.clear();
+  return Status::OK;
+}
+
+Status SpatialJoinNode::RepartitionInput(RuntimeState* state) {
+  DCHECK(input_partition_ != NULL);
+  COUNTER_ADD(num_repartitions_, 1);
+  RETURN_IF_ERROR(
+      CreatePartitions(input_partition_->level() + 1, input_partition_->id()));
+
+  for (int child_idx = 1; child_idx >= 0; --child_idx) {
+    bool is_build = child_idx == 1;
+    BufferedTupleStream* input =
+        is_build ? input_partition_->build_rows() : input_partition_->probe_rows();
+    RETURN_IF_ERROR(input->PrepareForRead());
+    RowBatch batch(child(child_idx)->row_desc(), state->batch_size(), mem_tracker());
+    bool eos = false;
+    while (!eos) {
+      RETURN_IF_CANCELLED(state);
+      RETURN_IF_ERROR(state->QueryMaintenance());
+      RETURN_IF_ERROR(input->GetNext(&batch, &eos));
+      RETURN_IF_ERROR(PartitionBatch(&batch, is_build));
+      batch.Reset();
+    }
+  }
+  input_partition_->Close(NULL);
+  input_partition_ = NULL;
+  return QueuePartitions();
+}
+
+Status SpatialJoinNode::PrepareNextPartition(RuntimeState* state) {
+  DCHECK(input_partition_ == NULL);
+  while (!partitions_to_join_.empty()) {
+    input_partition_ = partitions_to_join_.front();
+    partitions_to_join_.pop_front();
+
+    // Both sides of the partition must fit in memory at the same time.
+    bool got_rows = false;
+    RETURN_IF_ERROR(input_partition_->build_rows()->GetRows(&build_rows_batch_,
+        &got_rows));
+    if (got_rows) {
+      RETURN_IF_ERROR(input_partition_->probe_rows()->GetRows(&probe_rows_batch_,
+          &got_rows));
+      if (!got_rows) {
+        build_rows_batch_.reset();
+        RETURN_IF_ERROR(input_partition_->build_rows()->UnpinStream(true));
+      } else if (!BuildEntries()) {
+        // The rows fit but the entries on top of them don't.
+        got_rows = false;
+        build_rows_batch_.reset();
+        probe_rows_batch_.reset();
+        RETURN_IF_ERROR(input_partition_->build_rows()->UnpinStream(true));
+        RETURN_IF_ERROR(input_partition_->probe_rows()->UnpinStream(true));
+      }
+    }
+    if (got_rows) break;
+    RETURN_IF_ERROR(RepartitionInput(state));
+  }
+  return Status::OK;
+}
+
+bool SpatialJoinNode::BuildEntries() {
+  ReleaseEntries();
+  AddBatchToEntries(build_rows_batch_.get(), build_expr_ctx_, &build_entries_);
+  AddBatchToEntries(probe_rows_batch_.get(), probe_expr_ctx_, &probe_entries_);
+  // Each entry is stored once as an Entry and once in the MBR columns.
+  int64_t entries_mem =
+      (build_entries_.capacity() + probe_entries_.capacity()) * sizeof(Entry) +
+      (build_entries_.size() + probe_entries_.size()) * 4 * sizeof(double);
+  if (!state_->block_mgr()->ConsumeMemory(block_mgr_client_, entries_mem)) {
+    ReleaseEntries();
+    return false;
+  }
+  entries_mem_ = entries_mem;
+  sort(build_entries_.begin(), build_entries_.end());
+  sort(probe_entries_.begin(), probe_entries_.end());
+  build_mbrs_.Init(build_entries_);
+  probe_mbrs_.Init(probe_entries_);
+  build_entries_idx_ = 0;
+  probe_entries_idx_ = 0;
+  return true;
+}
+
+void SpatialJoinNode::ReleaseEntries() {
+  vector<Entry>().swap(build_entries_);
+  vector<Entry>().swap(probe_entries_);
+  build_mbrs_.Clear();
+  probe_mbrs_.Clear();
+  if (entries_mem_ > 0) {
+    state_->block_mgr()->ReleaseMemory(block_mgr_client_, entries_mem_);
+    entries_mem_ = 0;
+  }
+}
+
+void SpatialJoinNode::MbrColumns::Init(const vector<Entry>& entries) {
+  Clear();
+  x1.reserve(entries.size());
+  y1.reserve(entries.size());
+  x2.reserve(entries.size());
+  y2.reserve(entries.size());
+  for (int i = 0; i < entries.size(); ++i) {
+    x1.push_back(entries[i].mbr.x1);
+    y1.push_back(entries[i].mbr.y1);
+    x2.push_back(entries[i].mbr.x2);
+    y2.push_back(entries[i].mbr.y2);
+  }
+}
+
+void SpatialJoinNode::MbrColumns::Clear() {
+  vector<double>().swap(x1);
+  vector<double>().swap(y1);
+  vector<double>().swap(x2);
+  vector<double>().swap(y2);
+}
+
+void SpatialJoinNode::AddBatchToEntries(RowBatch* batch, ExprContext* mbr_expr_ctx,
+    vector<Entry>* entries) {
+  for (int i = 0; i < batch->num_rows(); ++i) {
+    TupleRow* row = batch->GetRow(i);
+    void* value = mbr_expr_ctx->GetValue(row);
+    if (value == NULL) continue;
+    const RectangleValue& mbr = *reinterpret_cast<RectangleValue*>(value);
+
+    overlapped_cells_.clear();
+    grid_.GetOverlappedCells(mbr, &overlapped_cells_);
+    for (int j = 0; j < overlapped_cells_.size(); ++j) {
+      int cell_id = overlapped_cells_[j];
+      if (!IsOwnedCell(cell_id) || !input_partition_->ContainsCell(cell_id)) continue;
+      entries->push_back(Entry(cell_id, mbr, row));
+    }
+  }
+  mbr_expr_ctx->FreeLocalAllocations();
+}
+
+Status SpatialJoinNode::GetNext(RuntimeState* state, RowBatch* out_batch, bool* eos) {
+  RETURN_IF_ERROR(ExecDebugAction(TExecNodePhase::GETNEXT, state));
+  SCOPED_TIMER(runtime_profile_->total_time_counter());
+  if (ReachedLimit() || eos_) {
+    *eos = true;
+    return Status::OK;
+  }
+
+  ScopedTimer<MonotonicStopWatch> timer(probe_timer_);
+  while (true) {
+    RETURN_IF_CANCELLED(state);
+    RETURN_IF_ERROR(state->QueryMaintenance());
+
+    OutputPendingPairs(out_batch);
+    if (ReachedLimit()) {
+      if (input_partition_ != NULL) {
+        input_partition_->Close(out_batch);
+        input_partition_ = NULL;
+      }
+      *eos = eos_ = true;
+      break;
+    }
+    if (out_batch->AtCapacity()) break;
+
+    // All pairs of the previous cell were output, move on to the next cell.
+    DCHECK_EQ(pending_pairs_idx_, pending_pairs_.size());
+    pending_pairs_.clear();
+    pending_pairs_idx_ = 0;
+    if (input_partition_ != NULL && JoinNextCell(&pending_pairs_)) continue;
+
+    if (input_partition_ != NULL) {
+      // The rows returned so far reference the partition's streams, so pass them on
+      // with this batch.
+      build_rows_batch_.reset();
+      probe_rows_batch_.reset();
+      ReleaseEntries();
+      input_partition_->Close(out_batch);
+      input_partition_ = NULL;
+    }
+    RETURN_IF_ERROR(PrepareNextPartition(state));
+    if (input_partition_ == NULL) {
+      *eos = eos_ = true;
+      break;
+    }
+  }
+  COUNTER_SET(rows_returned_counter_, num_rows_returned_);
+  return Status::OK;
+}
+
+bool SpatialJoinNode::JoinNextCell(RowPairs* pairs) {
+  while (build_entries_idx_ < build_entries_.size() &&
+      probe_entries_idx_ < probe_entries_.size()) {
+    int build = build_entries_idx_;
+    int probe = probe_entries_idx_;
+    int cell_id = min(build_entries_[build].cell, probe_entries_[probe].cell);
+    int build_end = build;
+    while (build_end < build_entries_.size() &&
+        build_entries_[build_end].cell == cell_id) {
+      ++build_end;
+    }
+    int probe_end = probe;
+    while (probe_end < probe_entries_.size() &&
+        probe_entries_[probe_end].cell == cell_id) {
+      ++probe_end;
+    }
+    build_entries_idx_ = build_end;
+    probe_entries_idx_ = probe_end;
+    // Skip cells that only have entries from one side.
+    if (build == build_end || probe == probe_end) continue;
+
+    // Plane sweep: repeatedly take the entry with the smallest x1 from either side and
+    // check it against the entries of the other side that start before it ends.
+    while (probe != probe_end && build != build_end) {
+      if (probe_entries_[probe] < build_entries_[build]) {
+        SweepEntry(cell_id, probe_entries_[probe], build_entries_, build_mbrs_, build,
+            build_end, true, pairs);
+        ++probe;
+      } else {
+        SweepEntry(cell_id, build_entries_[build], probe_entries_, probe_mbrs_, probe,
+            probe_end, false, pairs);
+        ++build;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+void SpatialJoinNode::SweepEntry(int cell_id, const Entry& r,
+    const vector<Entry>& entries, const MbrColumns& mbrs, int begin, int end,
+    bool r_is_probe, RowPairs* pairs) {
+  // The entries are sorted on x1, so only the ones that start before 'r' ends can
+  // intersect it.
+  end = lower_bound(mbrs.x1.begin() + begin, mbrs.x1.begin() + end, r.mbr.x2) -
+      mbrs.x1.begin();
+  if (begin >= end) return;
+  if (sweep_matches_.size() < end - begin) sweep_matches_.resize(end - begin);
+  int num_matches = SpatialKernels::Intersects(r.mbr, &mbrs.x1[begin], &mbrs.y1[begin],
+      &mbrs.x2[begin], &mbrs.y2[begin], end - begin, &sweep_matches_[0]);
+  COUNTER_ADD(candidate_pair_counter_, num_matches);
+  for (int i = 0; i < num_matches; ++i) {
+    const Entry& s = entries[begin + sweep_matches_[i]];
+    // Only the cell containing the reference point reports the pair.
+    if (grid_.GetReferenceCell(r.mbr, s.mbr) != cell_id) continue;
+    if (r_is_probe) {
+      pairs->push_back(make_pair(r.row, s.row));
+    } else {
+      pairs->push_back(make_pair(s.row, r.row));
+    }
+  }
+}
+
+void SpatialJoinNode::OutputPendingPairs(RowBatch* out_batch) {
+  ExprContext* const* ctxs = &conjunct_ctxs_[0];
+  int num_ctxs = conjunct_ctxs_.size();
+  while (pending_pairs_idx_ < pending_pairs_.size() && !out_batch->AtCapacity() &&
+      !ReachedLimit()) {
+    const pair<TupleRow*, TupleRow*>& p = pending_pairs_[pending_pairs_idx_++];
+    int row_idx = out_batch->AddRow();
+    DCHECK(row_idx != RowBatch::INVALID_ROW_INDEX);
+    TupleRow* out_row = out_batch->GetRow(row_idx);
+    CreateOutputRow(out_row, p.first, p.second);
+    if (!EvalConjuncts(ctxs, num_ctxs, out_row)) continue;
+    out_batch->CommitLastRow();
+    ++num_rows_returned_;
+  }
+}
+
+void SpatialJoinNode::AddToDebugString(int indent, stringstream* out) const {
+  *out << " probe_expr=" << probe_expr_ctx_->root()->DebugString()
+       << " build_expr=" << build_expr_ctx_->root()->DebugString()
+       << " num_cells=" << grid_.num_cells()
+       << " is_partitioned=" << (is_partitioned_ ? "true" : "false")
+       << " partitions_to_join=" << partitions_to_join_.size();
+}
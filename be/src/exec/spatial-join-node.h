@@ -0,0 +1,291 @@
+// Copyright 2013 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_EXEC_SPATIAL_JOIN_NODE_H
+#define IMPALA_EXEC_SPATIAL_JOIN_NODE_H
+
+#include <boost/scoped_ptr.hpp>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "exec/blocking-join-node.h"
+#include "runtime/buffered-block-mgr.h"
+#include "runtime/spatial-grid.h"
+#include "runtime/spatial-value.h"
+
+#include "gen-cpp/PlanNodes_types.h"
+
+namespace impala {
+
+class BufferedTupleStream;
+class ExprContext;
+class RowBatch;
+class TupleRow;
+
+// Node for inner joins on MBR intersection, i.e. rows from the left and right child
+// are joined if the RECTANGLEs computed by probe_expr and build_expr intersect.
+//
+// The plane is split into the cells of a uniform grid (TSpatialJoinNode.grid). In a
+// distributed plan both children are exchanges that are spatially partitioned on that
+// grid, so each fragment instance only sees the rows overlapping the cells it owns. A
+// pair of rows that overlaps several cells is found in each of them, but it is only
+// returned from the cell containing its reference point (see
+// SpatialGrid::GetReferenceCell()), so there are no duplicates.
+//
+// The owned cells are divided into PARTITION_FANOUT partitions and each input row is
+// appended to the BufferedTupleStreams of every partition that owns one of the cells
+// its MBR overlaps. The build side is consumed in ConstructBuildSide() and the probe
+// side in InitGetNext(), both called from BlockingJoinNode::Open(). If we run out of
+// memory while appending, the largest in-memory partition is spilled, as in the
+// PartitionedHashJoinNode. GetNext() then joins one partition at a time: its streams
+// are pinned, the rows are sorted on (cell, x1) and each cell is joined with a plane
+// sweep. A spilled partition that doesn't fit in memory when it is pinned is
+// repartitioned into PARTITION_FANOUT partitions of its cells. This fails if the
+// partition consists of a single cell.
+class SpatialJoinNode : public BlockingJoinNode {
+ public:
+  SpatialJoinNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs);
+
+  virtual Status Init(const TPlanNode& tnode);
+  virtual Status Prepare(RuntimeState* state);
+  virtual Status GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos);
+  virtual void Close(RuntimeState* state);
+
+ protected:
+  virtual Status InitGetNext(TupleRow* first_probe_row);
+  virtual Status ConstructBuildSide(RuntimeState* state);
+  virtual void AddToDebugString(int indentation_level, std::stringstream* out) const;
+
+ private:
+  // Number of partitions the owned cells are split into at each level.
+  static const int PARTITION_FANOUT = 4;
+
+  // A set of owned cells and the rows of both inputs that overlap one of them.
+  // Owned cells are numbered densely by their key, cell_id / num_instances_. A
+  // partition at 'level' holds the cells whose key satisfies
+  // key % PARTITION_FANOUT^(level + 1) == id.
+  class Partition {
+   public:
+    Partition(RuntimeState* state, SpatialJoinNode* parent, int level, int64_t id);
+    ~Partition();
+
+    BufferedTupleStream* build_rows() { return build_rows_; }
+    BufferedTupleStream* probe_rows() { return probe_rows_; }
+    int level() const { return level_; }
+    int64_t id() const { return id_; }
+    bool is_closed() const { return is_closed_; }
+    bool is_spilled() const { return is_spilled_; }
+
+    // Returns true if this partition holds cell 'cell_id'.
+    bool ContainsCell(int cell_id) const;
+
+    // Unpins the streams of this partition. If 'unpin_all' is true, the write blocks
+    // are unpinned as well, which is done once no more rows will be appended.
+    Status Spill(bool unpin_all);
+
+    // Closes the partition. If 'batch' is not NULL, the streams are attached to it,
+    // since the rows returned in 'batch' and earlier batches reference them.
+    void Close(RowBatch* batch);
+
+   private:
+    SpatialJoinNode* parent_;
+    bool is_closed_;
+    bool is_spilled_;
+    int level_;
+    int64_t id_;
+
+    // Owned by the RuntimeState's object pool.
+    BufferedTupleStream* build_rows_;
+    BufferedTupleStream* probe_rows_;
+  };
+
+  // A row of either input together with its MBR and one of the cells it overlaps.
+  struct Entry {
+    int cell;
+    RectangleValue mbr;
+    TupleRow* row;
+
+    Entry(int cell, const RectangleValue& mbr, TupleRow* row)
+      : cell(cell), mbr(mbr), row(row) { }
+
+    // Groups the entries by cell, and orders each cell's entries for the plane sweep.
+    bool operator<(const Entry& other) const {
+      if (cell != other.cell) return cell < other.cell;
+      return mbr.x1 < other.mbr.x1;
+    }
+  };
+
+  // The MBRs of a vector of entries as separate coordinate columns, the layout the
+  // SpatialKernels batch predicates read.
+  struct MbrColumns {
+    std::vector<double> x1;
+    std::vector<double> y1;
+    std::vector<double> x2;
+    std::vector<double> y2;
+
+    void Init(const std::vector<Entry>& entries);
+
+    // Frees the columns.
+    void Clear();
+  };
+
+  // (probe row, build row) pairs of the current cell that still need to be output.
+  typedef std::vector<std::pair<TupleRow*, TupleRow*> > RowPairs;
+
+  // Returns true if this fragment instance joins cell 'cell_id'.
+  bool IsOwnedCell(int cell_id) const {
+    return cell_id % num_instances_ == instance_idx_;
+  }
+
+  // Returns the key of owned cell 'cell_id'.
+  int CellKey(int cell_id) const { return cell_id / num_instances_; }
+
+  // Returns PARTITION_FANOUT^level.
+  static int64_t PartitionModulus(int level);
+
+  // Reads all batches from 'child' and appends each row to partitions_. 'first_batch'
+  // is an already fetched batch that should be added first, or NULL.
+  Status ConsumeChild(RuntimeState* state, int child_idx, RowBatch* first_batch,
+      bool eos);
+
+  // Creates PARTITION_FANOUT partitions at 'level' in partitions_, which split the
+  // cells of partition 'parent_id' at the level above.
+  Status CreatePartitions(int level, int64_t parent_id);
+
+  // Appends each row of 'batch' to the partitions in partitions_ that hold one of the
+  // owned cells its MBR overlaps. Rows with a NULL MBR can't match and are dropped.
+  Status PartitionBatch(RowBatch* batch, bool is_build);
+
+  // Appends 'row' to 'stream', spilling a partition if we run out of memory.
+  Status AppendRow(BufferedTupleStream* stream, TupleRow* row);
+
+  // Spills the largest partition in partitions_ that is not yet spilled.
+  Status SpillPartition();
+
+  // Moves partitions_, which are fully populated, to partitions_to_join_. Partitions
+  // that can't produce results are closed and spilled partitions are fully unpinned.
+  Status QueuePartitions();
+
+  // Repartitions input_partition_, which doesn't fit in memory, and queues the new
+  // partitions.
+  Status RepartitionInput(RuntimeState* state);
+
+  // Takes the next partition from partitions_to_join_ and brings its rows into memory,
+  // repartitioning it if necessary. Sets input_partition_ to NULL if there are no more
+  // partitions.
+  Status PrepareNextPartition(RuntimeState* state);
+
+  // Builds the sorted entries and MBR columns of both sides of input_partition_ from
+  // build_rows_batch_ and probe_rows_batch_. Their memory is charged to
+  // block_mgr_client_, like the buckets of a hash table. Returns false, with nothing
+  // charged, if the memory is not available.
+  bool BuildEntries();
+
+  // Frees the entries and MBR columns and releases their memory.
+  void ReleaseEntries();
+
+  // Appends an entry to 'entries' for each cell of input_partition_ that the MBR of
+  // each row in 'batch' overlaps.
+  void AddBatchToEntries(RowBatch* batch, ExprContext* mbr_expr_ctx,
+      std::vector<Entry>* entries);
+
+  // Plane sweeps the next cell of input_partition_ that has entries from both sides,
+  // appending the intersecting pairs whose reference point lies in this cell to
+  // 'pairs'. Returns false if there are no cells left.
+  bool JoinNextCell(RowPairs* pairs);
+
+  // Appends the pairs from the plane sweep starting at 'r', which is the entry with the
+  // smallest x1 among the remaining entries, against the entries in [begin, end) of the
+  // other side, 'entries' with MBRs 'mbrs'. The candidates are tested with
+  // SpatialKernels::Intersects(). 'r_is_probe' indicates which side 'r' is from.
+  void SweepEntry(int cell_id, const Entry& r, const std::vector<Entry>& entries,
+      const MbrColumns& mbrs, int begin, int end, bool r_is_probe, RowPairs* pairs);
+
+  // Writes rows from pending_pairs_ into 'out_batch', evaluating the conjuncts, until
+  // the batch is full, the limit is reached or there are no more pairs.
+  void OutputPendingPairs(RowBatch* out_batch);
+
+  RuntimeState* state_;
+
+  ExprContext* probe_expr_ctx_;
+  ExprContext* build_expr_ctx_;
+
+  SpatialGrid grid_;
+  bool is_partitioned_;
+
+  // Cell ownership of this fragment instance. If the inputs are not partitioned, the
+  // node owns all cells.
+  int instance_idx_;
+  int num_instances_;
+  int num_owned_cells_;
+
+  // Client of the block mgr for the partitions' streams.
+  BufferedBlockMgr::Client* block_mgr_client_;
+
+  // The partitions that rows are currently appended to, either from the children or
+  // from a repartitioned input_partition_.
+  std::vector<Partition*> partitions_;
+
+  // Fully populated partitions that still need to be joined. In-memory partitions are
+  // at the front.
+  std::list<Partition*> partitions_to_join_;
+
+  // The partition that is currently joined, and the rows of its streams.
+  Partition* input_partition_;
+  boost::scoped_ptr<RowBatch> build_rows_batch_;
+  boost::scoped_ptr<RowBatch> probe_rows_batch_;
+
+  // The entries of input_partition_, sorted by cell and x1, and the index of the first
+  // entry that has not been swept yet on each side.
+  std::vector<Entry> build_entries_;
+  std::vector<Entry> probe_entries_;
+  int build_entries_idx_;
+  int probe_entries_idx_;
+
+  // The MBRs of build_entries_ and probe_entries_.
+  MbrColumns build_mbrs_;
+  MbrColumns probe_mbrs_;
+
+  // Bytes of the entries and MBR columns charged to block_mgr_client_.
+  int64_t entries_mem_;
+
+  // Scratch buffer for the indexes of the intersecting entries in SweepEntry().
+  std::vector<int> sweep_matches_;
+
+  // Output pairs of the last joined cell and the index of the next one to output.
+  RowPairs pending_pairs_;
+  int pending_pairs_idx_;
+
+  // Scratch buffer for SpatialGrid::GetOverlappedCells().
+  std::vector<int> overlapped_cells_;
+
+  // Number of rows that were added to more than one cell.
+  RuntimeProfile::Counter* replicated_row_counter_;
+
+  // Number of candidate pairs that passed the MBR test, including pairs that are
+  // dropped because they belong to a different cell.
+  RuntimeProfile::Counter* candidate_pair_counter_;
+
+  RuntimeProfile::Counter* partitions_created_;
+  RuntimeProfile::Counter* num_spilled_partitions_;
+  RuntimeProfile::Counter* num_repartitions_;
+  RuntimeProfile::HighWaterMarkCounter* max_partition_level_;
+};
+
+}
+
+#endif
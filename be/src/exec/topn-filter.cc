@@ -0,0 +1,58 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exec/topn-filter.h"
+
+#include "common/logging.h"
+
+using namespace impala;
+using namespace std;
+
+TopNFilter::TopNFilter(const ColumnType& type, bool is_asc, bool nulls_first)
+  : type_(type),
+    is_asc_(is_asc),
+    nulls_first_(nulls_first),
+    has_cutoff_(false) {
+  DCHECK(IsSupportedType(type));
+}
+
+bool TopNFilter::IsSupportedType(const ColumnType& type) {
+  switch (type.type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_TIMESTAMP:
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+    case TYPE_DECIMAL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void TopNFilter::SetCutoff(const void* value) {
+  DCHECK(value != NULL);
+  if (type_.IsVarLen()) {
+    const StringValue* sv = reinterpret_cast<const StringValue*>(value);
+    cutoff_.assign(sv->ptr, sv->len);
+  } else {
+    cutoff_.assign(reinterpret_cast<const char*>(value), type_.GetByteSize());
+  }
+  has_cutoff_ = true;
+}
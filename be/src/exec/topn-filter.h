@@ -0,0 +1,75 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_EXEC_TOPN_FILTER_H
+#define IMPALA_EXEC_TOPN_FILTER_H
+
+#include <string>
+
+#include "runtime/raw-value.h"
+#include "runtime/string-value.inline.h"
+#include "runtime/types.h"
+
+namespace impala {
+
+// Filter on the values of the first ordering expr of a TopNNode, pushed down to the
+// scan that produces them. Once the TopNNode holds N rows, the first ordering value of
+// its N-th row is the cutoff: a row whose value sorts after the cutoff can't make it
+// into the top N, and can be dropped by the scan. Values equal to the cutoff are kept
+// since the other ordering exprs decide between them.
+// A filter is a value: it is copied between the TopNNode and the scanner threads.
+class TopNFilter {
+ public:
+  // Creates a filter that rejects no values.
+  TopNFilter() : is_asc_(true), nulls_first_(false), has_cutoff_(false) { }
+
+  // Creates a filter without cutoff for values of 'type', in the given order.
+  TopNFilter(const ColumnType& type, bool is_asc, bool nulls_first);
+
+  // Returns true if filters on values of 'type' are supported.
+  static bool IsSupportedType(const ColumnType& type);
+
+  // Sets the cutoff to the non-NULL 'value'. String data is copied.
+  void SetCutoff(const void* value);
+
+  // Returns true if 'value', which is NULL for a NULL value, sorts after the cutoff.
+  bool Rejects(const void* value) const {
+    if (!has_cutoff_) return false;
+    if (value == NULL) return !nulls_first_;
+    int cmp;
+    if (type_.IsVarLen()) {
+      StringValue cutoff(const_cast<char*>(cutoff_.data()), cutoff_.size());
+      cmp = reinterpret_cast<const StringValue*>(value)->Compare(cutoff);
+    } else {
+      cmp = RawValue::Compare(value, cutoff_.data(), type_);
+    }
+    return is_asc_ ? cmp > 0 : cmp < 0;
+  }
+
+  bool has_cutoff() const { return has_cutoff_; }
+
+ private:
+  ColumnType type_;
+  bool is_asc_;
+  bool nulls_first_;
+  bool has_cutoff_;
+
+  // The bytes of the cutoff value's slot, or the string data of var-len values.
+  std::string cutoff_;
+};
+
+}
+
+#endif
@@ -16,12 +16,16 @@
 
 #include <sstream>
 
+#include "exec/hdfs-scan-node.h"
 #include "exprs/expr.h"
+#include "exprs/expr-context.h"
+#include "exprs/slot-ref.h"
 #include "runtime/descriptors.h"
 #include "runtime/mem-pool.h"
 #include "runtime/raw-value.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
+#include "runtime/sorter.h"
 #include "runtime/tuple.h"
 #include "runtime/tuple-row.h"
 #include "util/debug-util.h"
@@ -33,10 +37,20 @@
 using namespace impala;
 using namespace std;
 
+DEFINE_int64(max_in_memory_topn_rows, 100000, "TopN nodes with a larger LIMIT + OFFSET "
+    "keep their rows in a sorter that can spill to disk rather than in memory.");
+
 TopNNode::TopNNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs)
   : ExecNode(pool, tnode, descs),
     offset_(tnode.sort_node.__isset.offset ? tnode.sort_node.offset : 0),
-    num_rows_skipped_(0) {
+    num_rows_skipped_(0),
+    use_sorter_(false),
+    num_sorter_rows_(0),
+    cutoff_tuple_(NULL),
+    filter_scan_node_(NULL),
+    filter_slot_id_(-1),
+    filter_slot_desc_(NULL),
+    num_compactions_counter_(NULL) {
 }
 
 Status TopNNode::Init(const TPlanNode& tnode) {
@@ -60,6 +74,27 @@ Status TopNNode::Prepare(RuntimeState* state) {
   // Allocate memory for a temporary tuple.
   tmp_tuple_ = reinterpret_cast<Tuple*>(
       tuple_pool_->Allocate(materialized_tuple_desc_->byte_size()));
+  tuple_row_less_than_.reset(new TupleRowComparator(
+      sort_exec_exprs_.lhs_ordering_expr_ctxs(),
+      sort_exec_exprs_.rhs_ordering_expr_ctxs(), is_asc_order_, nulls_first_));
+  if (state->codegen_enabled() && tuple_row_less_than_->Codegen(state)) {
+    AddRuntimeExecOption("Codegen Enabled");
+  }
+
+  use_sorter_ = limit_ + offset_ > FLAGS_max_in_memory_topn_rows;
+  if (use_sorter_) {
+    const vector<SlotDescriptor*>& slots = materialized_tuple_desc_->slots();
+    for (int i = 0; i < slots.size(); ++i) {
+      if (!slots[i]->is_materialized()) continue;
+      materialized_tuple_expr_ctxs_.push_back(
+          pool_->Add(new ExprContext(pool_->Add(new SlotRef(slots[i])))));
+    }
+    RETURN_IF_ERROR(Expr::Prepare(materialized_tuple_expr_ctxs_, state, row_descriptor_));
+    cutoff_pool_.reset(new MemPool(mem_tracker()));
+    num_compactions_counter_ =
+        ADD_COUNTER(runtime_profile(), "NumCompactions", TCounterType::UNIT);
+  }
+  InitTopNFilter(state);
   return Status::OK;
 }
 
@@ -70,12 +105,14 @@ Status TopNNode::Open(RuntimeState* state) {
   RETURN_IF_ERROR(state->QueryMaintenance());
   RETURN_IF_ERROR(sort_exec_exprs_.Open(state));
 
-  tuple_row_less_than_.reset(new TupleRowComparator(
-      sort_exec_exprs_.lhs_ordering_expr_ctxs(), sort_exec_exprs_.rhs_ordering_expr_ctxs(),
-      is_asc_order_, nulls_first_));
-  priority_queue_.reset(
-      new priority_queue<Tuple*, vector<Tuple*>, TupleRowComparator>(
-          *tuple_row_less_than_));
+  if (use_sorter_) {
+    RETURN_IF_ERROR(Expr::Open(materialized_tuple_expr_ctxs_, state));
+    sorter_.reset(CreateSorter(state));
+  } else {
+    priority_queue_.reset(
+        new priority_queue<Tuple*, vector<Tuple*>, TupleRowComparator>(
+            *tuple_row_less_than_));
+  }
 
   RETURN_IF_ERROR(child(0)->Open(state));
 
@@ -86,15 +123,26 @@ Status TopNNode::Open(RuntimeState* state) {
     do {
       batch.Reset();
       RETURN_IF_ERROR(child(0)->GetNext(state, &batch, &eos));
-      for (int i = 0; i < batch.num_rows(); ++i) {
-        InsertTupleRow(batch.GetRow(i));
+      if (use_sorter_) {
+        RETURN_IF_ERROR(AddBatchToSorter(state, &batch));
+      } else {
+        for (int i = 0; i < batch.num_rows(); ++i) {
+          InsertTupleRow(batch.GetRow(i));
+        }
+        if (priority_queue_->size() == limit_ + offset_) {
+          PublishTopNFilter(priority_queue_->top());
+        }
       }
       RETURN_IF_CANCELLED(state);
       RETURN_IF_ERROR(state->QueryMaintenance());
     } while (!eos);
   }
-  DCHECK_LE(priority_queue_->size(), limit_ + offset_);
-  PrepareForOutput();
+  if (use_sorter_) {
+    RETURN_IF_ERROR(sorter_->InputDone());
+  } else {
+    DCHECK_LE(priority_queue_->size(), limit_ + offset_);
+    PrepareForOutput();
+  }
   child(0)->Close(state);
   return Status::OK;
 }
@@ -104,6 +152,36 @@ Status TopNNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
   RETURN_IF_ERROR(ExecDebugAction(TExecNodePhase::GETNEXT, state));
   RETURN_IF_CANCELLED(state);
   RETURN_IF_ERROR(state->QueryMaintenance());
+  if (use_sorter_) {
+    // Same as SortNode::GetNext(). The sorter may hold more than LIMIT + OFFSET rows.
+    if (ReachedLimit()) {
+      *eos = true;
+      return Status::OK;
+    }
+    *eos = false;
+    DCHECK_EQ(row_batch->num_rows(), 0);
+    RETURN_IF_ERROR(sorter_->GetNext(row_batch, eos));
+    while (num_rows_skipped_ < offset_) {
+      num_rows_skipped_ += row_batch->num_rows();
+      // Throw away rows in the output batch until the offset is skipped.
+      int rows_to_keep = num_rows_skipped_ - offset_;
+      if (rows_to_keep > 0) {
+        row_batch->CopyRows(0, row_batch->num_rows() - rows_to_keep, rows_to_keep);
+        row_batch->set_num_rows(rows_to_keep);
+      } else {
+        row_batch->set_num_rows(0);
+      }
+      if (rows_to_keep > 0 || *eos) break;
+      RETURN_IF_ERROR(sorter_->GetNext(row_batch, eos));
+    }
+    num_rows_returned_ += row_batch->num_rows();
+    if (ReachedLimit()) {
+      row_batch->set_num_rows(row_batch->num_rows() - (num_rows_returned_ - limit_));
+      *eos = true;
+    }
+    COUNTER_SET(rows_returned_counter_, num_rows_returned_);
+    return Status::OK;
+  }
   while (!row_batch->AtCapacity() && (get_next_iter_ != sorted_top_n_.end())) {
     if (num_rows_skipped_ < offset_) {
       ++get_next_iter_;
@@ -126,7 +204,10 @@ Status TopNNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos) {
 
 void TopNNode::Close(RuntimeState* state) {
   if (is_closed()) return;
+  sorter_.reset();
   if (tuple_pool_.get() != NULL) tuple_pool_->FreeAll();
+  if (cutoff_pool_.get() != NULL) cutoff_pool_->FreeAll();
+  Expr::Close(materialized_tuple_expr_ctxs_, state);
   sort_exec_exprs_.Close(state);
   ExecNode::Close(state);
 }
@@ -172,6 +253,110 @@ void TopNNode::PrepareForOutput() {
   get_next_iter_ = sorted_top_n_.begin();
 }
 
+Sorter* TopNNode::CreateSorter(RuntimeState* state) {
+  return new Sorter(*tuple_row_less_than_, materialized_tuple_expr_ctxs_,
+      &row_descriptor_, mem_tracker(), runtime_profile(), state);
+}
+
+Status TopNNode::AddBatchToSorter(RuntimeState* state, RowBatch* batch) {
+  RowBatch sorter_batch(row_descriptor_, state->batch_size(), mem_tracker());
+  for (int i = 0; i < batch->num_rows(); ++i) {
+    tmp_tuple_->MaterializeExprs<false>(batch->GetRow(i), *materialized_tuple_desc_,
+        sort_exec_exprs_.sort_tuple_slot_expr_ctxs(), NULL);
+    if (cutoff_tuple_ != NULL && !(*tuple_row_less_than_)(tmp_tuple_, cutoff_tuple_)) {
+      continue;
+    }
+    // tmp_tuple_ is reused for the next row and its string data points into 'batch', so
+    // the row is deep copied into the pool of sorter_batch.
+    int row_idx = sorter_batch.AddRow();
+    TupleRow* row = sorter_batch.GetRow(row_idx);
+    row->SetTuple(0, tmp_tuple_->DeepCopy(*materialized_tuple_desc_,
+        sorter_batch.tuple_data_pool()));
+    sorter_batch.CommitLastRow();
+  }
+  RETURN_IF_ERROR(sorter_->AddBatch(&sorter_batch));
+  num_sorter_rows_ += sorter_batch.num_rows();
+  if (num_sorter_rows_ >= 2 * (limit_ + offset_)) RETURN_IF_ERROR(CompactSorter(state));
+  return Status::OK;
+}
+
+Status TopNNode::CompactSorter(RuntimeState* state) {
+  COUNTER_ADD(num_compactions_counter_, 1);
+  // Create the new sorter before InputDone() so that its first blocks are pinned before
+  // sorter_ sets up its final merge (see the header comment).
+  boost::scoped_ptr<Sorter> new_sorter(CreateSorter(state));
+  RETURN_IF_ERROR(sorter_->InputDone());
+  RowBatch batch(row_descriptor_, state->batch_size(), mem_tracker());
+  int64_t num_rows_to_keep = limit_ + offset_;
+  num_sorter_rows_ = 0;
+  bool eos = false;
+  while (!eos && num_sorter_rows_ < num_rows_to_keep) {
+    batch.Reset();
+    RETURN_IF_ERROR(sorter_->GetNext(&batch, &eos));
+    if (num_sorter_rows_ + batch.num_rows() >= num_rows_to_keep) {
+      batch.set_num_rows(num_rows_to_keep - num_sorter_rows_);
+      // The row batch is only valid until the next call to GetNext(), so copy the cutoff.
+      if (cutoff_tuple_ == NULL) {
+        cutoff_tuple_ = reinterpret_cast<Tuple*>(
+            tuple_pool_->Allocate(materialized_tuple_desc_->byte_size()));
+      }
+      cutoff_pool_->Clear();
+      batch.GetRow(batch.num_rows() - 1)->GetTuple(0)->DeepCopy(
+          cutoff_tuple_, *materialized_tuple_desc_, cutoff_pool_.get());
+    }
+    RETURN_IF_ERROR(new_sorter->AddBatch(&batch));
+    num_sorter_rows_ += batch.num_rows();
+  }
+  DCHECK_EQ(num_sorter_rows_, num_rows_to_keep);
+  sorter_.swap(new_sorter);
+  // Release the blocks and the reservation of the old sorter right away.
+  new_sorter.reset();
+  PublishTopNFilter(cutoff_tuple_);
+  return Status::OK;
+}
+
+void TopNNode::InitTopNFilter(RuntimeState* state) {
+  if (sort_exec_exprs_.lhs_ordering_expr_ctxs().empty()) return;
+  Expr* ordering_expr = sort_exec_exprs_.lhs_ordering_expr_ctxs()[0]->root();
+  if (!ordering_expr->is_slotref()) return;
+  SlotId slot_id = static_cast<SlotRef*>(ordering_expr)->slot_id();
+
+  // Other nodes in between could turn a row dropped by the scan into a different row
+  // (e.g. the NULL-extended row of an outer join), so only a direct child is filtered.
+  if (child(0)->type() != TPlanNodeType::HDFS_SCAN_NODE) return;
+  HdfsScanNode* scan_node = static_cast<HdfsScanNode*>(child(0));
+
+  // Find the expr that the ordering slot is materialized from.
+  const vector<SlotDescriptor*>& slots = materialized_tuple_desc_->slots();
+  int expr_idx = 0;
+  for (int i = 0; i < slots.size(); ++i) {
+    if (!slots[i]->is_materialized()) continue;
+    if (slots[i]->id() == slot_id) {
+      Expr* slot_expr = sort_exec_exprs_.sort_tuple_slot_expr_ctxs()[expr_idx]->root();
+      if (!slot_expr->is_slotref()) return;
+      SlotDescriptor* scan_slot = state->desc_tbl().GetSlotDescriptor(
+          static_cast<SlotRef*>(slot_expr)->slot_id());
+      if (scan_slot == NULL || scan_slot->parent() != scan_node->tuple_desc()->id()) {
+        return;
+      }
+      if (!TopNFilter::IsSupportedType(slots[i]->type())) return;
+      filter_scan_node_ = scan_node;
+      filter_slot_id_ = scan_slot->id();
+      filter_slot_desc_ = slots[i];
+      return;
+    }
+    ++expr_idx;
+  }
+}
+
+void TopNNode::PublishTopNFilter(Tuple* cutoff) {
+  if (filter_scan_node_ == NULL) return;
+  if (cutoff->IsNull(filter_slot_desc_->null_indicator_offset())) return;
+  TopNFilter filter(filter_slot_desc_->type(), is_asc_order_[0], nulls_first_[0]);
+  filter.SetCutoff(cutoff->GetSlot(filter_slot_desc_->tuple_offset()));
+  filter_scan_node_->SetTopNFilter(filter_slot_id_, filter);
+}
+
 void TopNNode::DebugString(int indentation_level, stringstream* out) const {
   *out << string(indentation_level * 2, ' ');
   *out << "TopNNode("
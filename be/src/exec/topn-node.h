@@ -21,20 +21,30 @@
 
 #include "exec/exec-node.h"
 #include "exec/sort-exec-exprs.h"
+#include "exec/topn-filter.h"
 #include "runtime/descriptors.h"  // for TupleId
 #include "util/tuple-row-compare.h"
 
 namespace impala {
 
+class HdfsScanNode;
 class MemPool;
 class RuntimeState;
+class Sorter;
 class Tuple;
 
-// Node for in-memory TopN (ORDER BY ... LIMIT)
-// This handles the case where the result fits in memory.
+// Node for TopN (ORDER BY ... LIMIT)
 // This node will materialize its input rows into a new tuple using the expressions
 // in sort_tuple_slot_exprs_ in its sort_exec_exprs_ member.
-// TopN is implemented by storing rows in a priority queue.
+// If LIMIT + OFFSET is at most FLAGS_max_in_memory_topn_rows, TopN is implemented by
+// storing rows in a priority queue. Otherwise the rows are added to a Sorter, which
+// spills sorted runs to disk through the block mgr. Whenever the sorter holds twice as
+// many rows as needed it is compacted: the rows are sorted and only the first
+// LIMIT + OFFSET ones are kept in a new sorter. The last row kept is the cutoff; input
+// rows that don't sort before it are dropped right away.
+// In both cases, if the first ordering expr is a slot of the scan that is the child of
+// this node, the current cutoff value of that expr is pushed down to
+// the scan as a TopNFilter so that it can drop rows that can't make it into the TopN.
 class TopNNode : public ExecNode {
  public:
   TopNNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs);
@@ -59,6 +69,31 @@ class TopNNode : public ExecNode {
   // Flatten and reverse the priority queue.
   void PrepareForOutput();
 
+  // Creates a sorter for the materialized tuples, which are copied by
+  // materialized_tuple_expr_ctxs_.
+  Sorter* CreateSorter(RuntimeState* state);
+
+  // Adds the rows of 'batch' that sort before cutoff_tuple_ to sorter_, and compacts
+  // sorter_ if it holds at least twice LIMIT + OFFSET rows.
+  Status AddBatchToSorter(RuntimeState* state, RowBatch* batch);
+
+  // Replaces sorter_ with a sorter that holds its first LIMIT + OFFSET rows, and sets
+  // cutoff_tuple_ to the last of them. The rows are streamed from the final merge of the
+  // old sorter into the new one, so both are alive until the compaction is done: the
+  // peak is the reservations of both sorters (2 * Sorter::MinBuffersRequired() blocks)
+  // plus the blocks pinned by the merge. The new sorter is created first so that the old
+  // one sees its pinned blocks as taken when it decides whether its final run can stay
+  // in memory for the merge.
+  Status CompactSorter(RuntimeState* state);
+
+  // Finds the scan that the filter on the first ordering expr can be pushed down to, if
+  // any, and sets filter_scan_node_, filter_slot_id_ and filter_slot_desc_.
+  void InitTopNFilter(RuntimeState* state);
+
+  // Pushes down 'cutoff', the current last tuple of the TopN, as the filter of
+  // filter_scan_node_.
+  void PublishTopNFilter(Tuple* cutoff);
+
   // Number of rows to skip.
   int64_t offset_;
   int64_t num_rows_skipped_;
@@ -91,6 +126,34 @@ class TopNNode : public ExecNode {
   // materialize input tuples if necessary. After materialization, tmp_tuple_ may be
   // copied into the the tuple pool and inserted into the priority queue.
   Tuple* tmp_tuple_;
+
+  // True if the rows are kept in sorter_ rather than in priority_queue_.
+  bool use_sorter_;
+
+  // Slot refs that copy the slots of the materialized tuple, used by the sorters to copy
+  // the rows of sorted runs and of the batches of AddBatchToSorter().
+  std::vector<ExprContext*> materialized_tuple_expr_ctxs_;
+
+  // Holds the TopN candidates if use_sorter_ is true.
+  boost::scoped_ptr<Sorter> sorter_;
+
+  // Number of rows added to sorter_.
+  int64_t num_sorter_rows_;
+
+  // Last tuple kept by the latest compaction of sorter_, or NULL if there was none. The
+  // fixed-length part is allocated from tuple_pool_ by the first compaction, the var-len
+  // data is in cutoff_pool_.
+  Tuple* cutoff_tuple_;
+  boost::scoped_ptr<MemPool> cutoff_pool_;
+
+  // Scan that the TopNFilter is pushed down to, or NULL if it can't be pushed down.
+  HdfsScanNode* filter_scan_node_;
+  // The slot of filter_scan_node_ that the first ordering expr evaluates to.
+  SlotId filter_slot_id_;
+  // The slot of the materialized tuple that holds the first ordering value.
+  SlotDescriptor* filter_slot_desc_;
+
+  RuntimeProfile::Counter* num_compactions_counter_;
 };
 
 };
@@ -274,6 +274,14 @@ inline void AggFnEvaluator::SetDstSlot(FunctionContext* ctx, const AnyVal* src,
       *reinterpret_cast<TimestampValue*>(slot) = TimestampValue::FromTimestampVal(
           *reinterpret_cast<const TimestampVal*>(src));
       return;
+    case TYPE_POINT:
+      *reinterpret_cast<PointValue*>(slot) =
+          PointValue::FromPointVal(*reinterpret_cast<const PointVal*>(src));
+      return;
+    case TYPE_RECTANGLE:
+      *reinterpret_cast<RectangleValue*>(slot) =
+          RectangleValue::FromRectangleVal(*reinterpret_cast<const RectangleVal*>(src));
+      return;
     case TYPE_DECIMAL:
       switch (dst_slot_desc->type().GetByteSize()) {
         case 4:
@@ -494,6 +502,18 @@ void AggFnEvaluator::SerializeOrFinalize(FunctionContext* agg_fn_ctx, Tuple* src
       SetDstSlot(agg_fn_ctx, &v, dst_slot_desc, dst);
       break;
     }
+    case TYPE_POINT: {
+      typedef PointVal(*Fn)(FunctionContext*, AnyVal*);
+      PointVal v = reinterpret_cast<Fn>(fn)(agg_fn_ctx, staging_intermediate_val_);
+      SetDstSlot(agg_fn_ctx, &v, dst_slot_desc, dst);
+      break;
+    }
+    case TYPE_RECTANGLE: {
+      typedef RectangleVal(*Fn)(FunctionContext*, AnyVal*);
+      RectangleVal v = reinterpret_cast<Fn>(fn)(agg_fn_ctx, staging_intermediate_val_);
+      SetDstSlot(agg_fn_ctx, &v, dst_slot_desc, dst);
+      break;
+    }
     default:
       DCHECK(false) << "NYI";
   }
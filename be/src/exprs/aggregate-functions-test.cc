@@ -166,6 +166,98 @@ TEST(HistogramTest, TestString) {
   EXPECT_TRUE(test.Execute(input, StringVal(&expected[0]))) << test.GetErrorMsg();
 }
 
+// Wrappers that match the function signatures expected by the test harness.
+void RectangleValInitNull(FunctionContext* ctx, RectangleVal* dst) {
+  AggregateFunctions::InitNull(ctx, dst);
+}
+
+RectangleVal RectangleValIdentity(FunctionContext*, const RectangleVal& val) {
+  return val;
+}
+
+const StringVal StringValSerialize(FunctionContext* ctx, const StringVal& src) {
+  return AggregateFunctions::StringValSerializeOrFinalize(ctx, src);
+}
+
+// Returns true if the counts in the st_quadtree_sketch() result 'actual' add up to
+// 'expected_count'.
+bool CheckQuadtreeSketchCount(const StringVal& actual, const StringVal& expected_count) {
+  string result(reinterpret_cast<char*>(actual.ptr), actual.len);
+  int64_t count = 0;
+  // Each count follows a ':' and ends at the next ',' or the end of the string.
+  for (size_t pos = result.find(':'); pos != string::npos; pos = result.find(':', pos)) {
+    size_t end = result.find(',', pos);
+    if (end == string::npos) end = result.size();
+    count += lexical_cast<int64_t>(result.substr(pos + 1, end - pos - 1));
+    pos = end;
+  }
+  string expected_str(reinterpret_cast<char*>(expected_count.ptr), expected_count.len);
+  return count == lexical_cast<int64_t>(expected_str);
+}
+
+TEST(SpatialTest, Extent) {
+  UdaTestHarness<RectangleVal, RectangleVal, PointVal> test(
+      RectangleValInitNull, AggregateFunctions::PointExtentUpdate,
+      AggregateFunctions::ExtentUpdate, NULL, RectangleValIdentity);
+  vector<PointVal> input;
+  for (int i = 0; i < 1000; ++i) input.push_back(PointVal(i % 10, -i));
+  input.push_back(PointVal::null());
+  EXPECT_TRUE(test.Execute(input, RectangleVal(0, -999, 9, 0))) << test.GetErrorMsg();
+
+  // No non-NULL input.
+  vector<PointVal> nulls(10, PointVal::null());
+  EXPECT_TRUE(test.Execute(nulls, RectangleVal::null())) << test.GetErrorMsg();
+}
+
+TEST(SpatialTest, GridHistogram) {
+  UdaTestHarness4<StringVal, StringVal, PointVal, RectangleVal, IntVal, IntVal> test(
+      AggregateFunctions::GridHistogramInit, AggregateFunctions::GridHistogramUpdate,
+      AggregateFunctions::GridHistogramMerge,
+      StringValSerialize,
+      AggregateFunctions::GridHistogramFinalize);
+  vector<PointVal> points;
+  for (int i = 0; i < 1000; ++i) points.push_back(PointVal(i % 10, i / 100));
+  // A point outside of the bounds is counted in the nearest cell.
+  points.push_back(PointVal(100, -100));
+  vector<RectangleVal> bounds(points.size(), RectangleVal(0, 0, 10, 10));
+  vector<IntVal> num_cols(points.size(), IntVal(2));
+  vector<IntVal> num_rows(points.size(), IntVal(4));
+  // Rows are 2.5 wide, so y in {0, 1, 2} is in row 0, {3, 4} in row 1 etc.
+  EXPECT_TRUE(test.Execute(points, bounds, num_cols, num_rows,
+      StringVal("0:150, 1:151, 2:100, 3:100, 4:150, 5:150, 6:100, 7:100")))
+      << test.GetErrorMsg();
+
+  // Grids with no cells are rejected.
+  vector<IntVal> zero(points.size(), IntVal(0));
+  EXPECT_FALSE(test.Execute(points, bounds, zero, num_rows, StringVal::null()));
+}
+
+TEST(SpatialTest, QuadtreeSketch) {
+  UdaTestHarness2<StringVal, StringVal, PointVal, RectangleVal> test(
+      AggregateFunctions::QuadtreeSketchInit, AggregateFunctions::QuadtreeSketchUpdate,
+      AggregateFunctions::QuadtreeSketchMerge,
+      StringValSerialize,
+      AggregateFunctions::QuadtreeSketchFinalize);
+  // With bounds of 2^15, the cells at the initial level are unit squares.
+  RectangleVal bounds(0, 0, 32768, 32768);
+  vector<PointVal> points;
+  points.push_back(PointVal(1.5, 0.5));
+  points.push_back(PointVal(0.5, 0.5));
+  points.push_back(PointVal(0.25, 0.75));
+  points.push_back(PointVal(0.5, 1.5));
+  EXPECT_TRUE(test.Execute(points, vector<RectangleVal>(points.size(), bounds),
+      StringVal("RECTANGLE(0 0, 1 1):2, RECTANGLE(1 0, 2 1):1, RECTANGLE(0 1, 1 2):1")))
+      << test.GetErrorMsg();
+
+  // Too many distinct cells to keep at the initial level. The sketch is coarsened, but
+  // all points are still counted.
+  points.clear();
+  for (int i = 0; i < 10000; ++i) points.push_back(PointVal(i * 3 % 32768, i));
+  test.SetResultComparator(CheckQuadtreeSketchCount);
+  EXPECT_TRUE(test.Execute(points, vector<RectangleVal>(points.size(), bounds),
+      StringVal("10000"))) << test.GetErrorMsg();
+}
+
 int main(int argc, char** argv) {
   impala::InitGoogleLoggingSafe(argv[0]);
   impala::DecimalUtil::InitMaxUnscaledDecimal();
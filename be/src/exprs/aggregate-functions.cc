@@ -17,12 +17,15 @@
 #include <math.h>
 #include <sstream>
 #include <algorithm>
+#include <limits>
 
 #include <boost/random/ranlux.hpp>
 #include <boost/random/uniform_int.hpp>
 
 #include "common/logging.h"
 #include "runtime/decimal-value.h"
+#include "runtime/spatial-grid.h"
+#include "runtime/spatial-value.h"
 #include "runtime/string-value.h"
 #include "runtime/timestamp-value.h"
 #include "exprs/anyval-util.h"
@@ -1160,6 +1163,346 @@ DoubleVal AggregateFunctions::KnuthStddevPopFinalize(FunctionContext* ctx,
   return sqrt(ComputeKnuthVariance(*state, true));
 }
 
+void AggregateFunctions::ExtentUpdate(FunctionContext* ctx, const RectangleVal& src,
+    RectangleVal* dst) {
+  if (src.is_null) return;
+  if (dst->is_null) {
+    *dst = src;
+    return;
+  }
+  RectangleValue extent = RectangleValue::FromRectangleVal(*dst);
+  extent.Expand(RectangleValue::FromRectangleVal(src));
+  extent.ToRectangleVal(dst);
+}
+
+void AggregateFunctions::PointExtentUpdate(FunctionContext* ctx, const PointVal& src,
+    RectangleVal* dst) {
+  if (src.is_null) return;
+  ExtentUpdate(ctx, RectangleVal(src.x, src.y, src.x, src.y), dst);
+}
+
+// Returns the TSpatialGrid with 'num_cols' x 'num_rows' cells over 'bounds'.
+static TSpatialGrid MakeSpatialGrid(const RectangleValue& bounds, int num_cols,
+    int num_rows) {
+  TSpatialGrid grid;
+  grid.x1 = bounds.x1;
+  grid.y1 = bounds.y1;
+  grid.x2 = bounds.x2;
+  grid.y2 = bounds.y2;
+  grid.num_cols = num_cols;
+  grid.num_rows = num_rows;
+  return grid;
+}
+
+// Returns true if 'bounds' has a positive, finite width and height, i.e. it can be the
+// bounds of a SpatialGrid.
+static bool IsValidGridBounds(const RectangleValue& bounds) {
+  double width = bounds.x2 - bounds.x1;
+  double height = bounds.y2 - bounds.y1;
+  return width > 0 && height > 0 && width <= numeric_limits<double>::max() &&
+      height <= numeric_limits<double>::max();
+}
+
+// st_grid_histogram() intermediate state header. It is followed by
+// num_cols * num_rows int64_t counts, in cell id order.
+struct GridHistogramState {
+  RectangleValue bounds;
+  int32_t num_cols;
+  int32_t num_rows;
+
+  int num_cells() const { return num_cols * num_rows; }
+  int64_t* counts() { return reinterpret_cast<int64_t*>(this + 1); }
+};
+
+// Bounds the size of the st_grid_histogram() state to 128KB.
+static const int MAX_GRID_HISTOGRAM_CELLS = 16 * 1024;
+
+static int GridHistogramLen(int num_cells) {
+  return sizeof(GridHistogramState) + num_cells * sizeof(int64_t);
+}
+
+void AggregateFunctions::GridHistogramInit(FunctionContext* ctx, StringVal* dst) {
+  // The grid is only known once the first row arrives. Merge aggregations never see
+  // the arguments at all, so they take the grid from the first merged state.
+  *dst = StringVal();
+}
+
+void AggregateFunctions::GridHistogramUpdate(FunctionContext* ctx, const PointVal& src,
+    const RectangleVal& bounds, const IntVal& num_cols, const IntVal& num_rows,
+    StringVal* dst) {
+  if (src.is_null) return;
+  DCHECK(!dst->is_null);
+  if (dst->len == 0) {
+    if (bounds.is_null || num_cols.is_null || num_rows.is_null ||
+        !IsValidGridBounds(RectangleValue::FromRectangleVal(bounds)) ||
+        num_cols.val <= 0 || num_rows.val <= 0 ||
+        num_cols.val > MAX_GRID_HISTOGRAM_CELLS / num_rows.val) {
+      stringstream ss;
+      ss << "st_grid_histogram() requires non-empty bounds and a grid of between 1 and "
+         << MAX_GRID_HISTOGRAM_CELLS << " cells";
+      ctx->SetError(ss.str().c_str());
+      return;
+    }
+    int len = GridHistogramLen(num_cols.val * num_rows.val);
+    dst->ptr = ctx->Allocate(len);
+    dst->len = len;
+    memset(dst->ptr, 0, len);
+    GridHistogramState* state = reinterpret_cast<GridHistogramState*>(dst->ptr);
+    state->bounds = RectangleValue::FromRectangleVal(bounds);
+    state->num_cols = num_cols.val;
+    state->num_rows = num_rows.val;
+  }
+  GridHistogramState* state = reinterpret_cast<GridHistogramState*>(dst->ptr);
+  SpatialGrid grid(MakeSpatialGrid(state->bounds, state->num_cols, state->num_rows));
+  ++state->counts()[grid.GetCell(PointValue::FromPointVal(src))];
+}
+
+void AggregateFunctions::GridHistogramMerge(FunctionContext* ctx, const StringVal& src,
+    StringVal* dst) {
+  DCHECK(!src.is_null);
+  DCHECK(!dst->is_null);
+  if (src.len == 0) return;
+  if (dst->len == 0) {
+    dst->ptr = ctx->Allocate(src.len);
+    dst->len = src.len;
+    memcpy(dst->ptr, src.ptr, src.len);
+    return;
+  }
+  const GridHistogramState* src_state =
+      reinterpret_cast<const GridHistogramState*>(src.ptr);
+  GridHistogramState* dst_state = reinterpret_cast<GridHistogramState*>(dst->ptr);
+  if (src_state->bounds != dst_state->bounds ||
+      src_state->num_cols != dst_state->num_cols ||
+      src_state->num_rows != dst_state->num_rows) {
+    ctx->SetError("st_grid_histogram() requires the same grid for all rows");
+    return;
+  }
+  DCHECK_EQ(src.len, dst->len);
+  const int64_t* src_counts = reinterpret_cast<const int64_t*>(src_state + 1);
+  int64_t* dst_counts = dst_state->counts();
+  for (int i = 0; i < dst_state->num_cells(); ++i) dst_counts[i] += src_counts[i];
+}
+
+StringVal AggregateFunctions::GridHistogramFinalize(FunctionContext* ctx,
+    const StringVal& src) {
+  DCHECK(!src.is_null);
+  if (src.len == 0) return StringVal::null();
+  GridHistogramState* state = reinterpret_cast<GridHistogramState*>(src.ptr);
+  stringstream ss;
+  for (int i = 0; i < state->num_cells(); ++i) {
+    if (state->counts()[i] == 0) continue;
+    if (ss.tellp() > 0) ss << ", ";
+    ss << i << ":" << state->counts()[i];
+  }
+  ctx->Free(src.ptr);
+  const string& str = ss.str();
+  StringVal result(ctx, str.size());
+  memcpy(result.ptr, str.c_str(), str.size());
+  return result;
+}
+
+// st_quadtree_sketch() intermediate state. The cells are numbered at 'level', i.e. in
+// a 2^level x 2^level grid over 'bounds', by the Morton code (bit-interleaving) of
+// their column and row. All descendants of a cell have consecutive codes, and the
+// parent of the cell with code c is the cell c >> 2 at the level above, so reducing
+// the level keeps the entries sorted.
+struct QuadtreeSketchState {
+  struct Entry {
+    uint64_t code;
+    int64_t count;
+  };
+
+  // The maximum number of non-empty cells. Bounds the state to ~4KB.
+  static const int MAX_ENTRIES = 256;
+
+  // The initial level. Limited so the number of cells fits in SpatialGrid's int ids.
+  static const int MAX_LEVEL = 15;
+
+  RectangleValue bounds;
+  int32_t level;
+  int32_t num_entries;
+  Entry entries[MAX_ENTRIES];
+};
+
+// Interleaves the bits of 'col' and 'row', which are < 2^16.
+static uint64_t MortonCode(uint32_t col, uint32_t row) {
+  uint64_t code = 0;
+  for (int i = 0; i < 16; ++i) {
+    code |= static_cast<uint64_t>((col >> i) & 1) << (2 * i);
+    code |= static_cast<uint64_t>((row >> i) & 1) << (2 * i + 1);
+  }
+  return code;
+}
+
+// Inverse of MortonCode().
+static void DecodeMortonCode(uint64_t code, uint32_t* col, uint32_t* row) {
+  *col = 0;
+  *row = 0;
+  for (int i = 0; i < 16; ++i) {
+    *col |= static_cast<uint32_t>((code >> (2 * i)) & 1) << i;
+    *row |= static_cast<uint32_t>((code >> (2 * i + 1)) & 1) << i;
+  }
+}
+
+// Replaces the 'num_entries' sorted entries by the ones of their parent cells, which
+// combine the counts of up to four entries. Returns the new number of entries.
+static int ReduceQuadtreeLevel(QuadtreeSketchState::Entry* entries, int num_entries) {
+  int n = 0;
+  for (int i = 0; i < num_entries; ++i) {
+    uint64_t parent = entries[i].code >> 2;
+    if (n > 0 && entries[n - 1].code == parent) {
+      entries[n - 1].count += entries[i].count;
+    } else {
+      entries[n].code = parent;
+      entries[n].count = entries[i].count;
+      ++n;
+    }
+  }
+  return n;
+}
+
+// Returns the Morton code of the cell containing 'p' at the state's level.
+static uint64_t QuadtreeCell(const QuadtreeSketchState& state, const PointValue& p) {
+  int n = 1 << state.level;
+  SpatialGrid grid(MakeSpatialGrid(state.bounds, n, n));
+  int cell_id = grid.GetCell(p);
+  return MortonCode(cell_id % n, cell_id / n);
+}
+
+void AggregateFunctions::QuadtreeSketchInit(FunctionContext* ctx, StringVal* dst) {
+  // Like the grid histogram, the bounds are only known with the first row or state.
+  *dst = StringVal();
+}
+
+void AggregateFunctions::QuadtreeSketchUpdate(FunctionContext* ctx, const PointVal& src,
+    const RectangleVal& bounds, StringVal* dst) {
+  if (src.is_null) return;
+  DCHECK(!dst->is_null);
+  if (dst->len == 0) {
+    if (bounds.is_null || !IsValidGridBounds(RectangleValue::FromRectangleVal(bounds))) {
+      ctx->SetError("st_quadtree_sketch() requires non-empty bounds");
+      return;
+    }
+    dst->ptr = ctx->Allocate(sizeof(QuadtreeSketchState));
+    dst->len = sizeof(QuadtreeSketchState);
+    QuadtreeSketchState* state = reinterpret_cast<QuadtreeSketchState*>(dst->ptr);
+    state->bounds = RectangleValue::FromRectangleVal(bounds);
+    state->level = QuadtreeSketchState::MAX_LEVEL;
+    state->num_entries = 0;
+  }
+  DCHECK_EQ(dst->len, sizeof(QuadtreeSketchState));
+  QuadtreeSketchState* state = reinterpret_cast<QuadtreeSketchState*>(dst->ptr);
+  PointValue p = PointValue::FromPointVal(src);
+  while (true) {
+    uint64_t code = QuadtreeCell(*state, p);
+    QuadtreeSketchState::Entry* end = state->entries + state->num_entries;
+    QuadtreeSketchState::Entry* it = state->entries;
+    // Binary search for the first entry with a code >= 'code'.
+    for (int len = state->num_entries; len > 0;) {
+      int half = len / 2;
+      if (it[half].code < code) {
+        it += half + 1;
+        len -= half + 1;
+      } else {
+        len = half;
+      }
+    }
+    if (it != end && it->code == code) {
+      ++it->count;
+      return;
+    }
+    if (state->num_entries < QuadtreeSketchState::MAX_ENTRIES) {
+      memmove(it + 1, it, (end - it) * sizeof(QuadtreeSketchState::Entry));
+      it->code = code;
+      it->count = 1;
+      ++state->num_entries;
+      return;
+    }
+    // At level 0 there is a single cell, so we always find it above.
+    DCHECK_GT(state->level, 0);
+    state->num_entries = ReduceQuadtreeLevel(state->entries, state->num_entries);
+    --state->level;
+  }
+}
+
+void AggregateFunctions::QuadtreeSketchMerge(FunctionContext* ctx, const StringVal& src,
+    StringVal* dst) {
+  DCHECK(!src.is_null);
+  DCHECK(!dst->is_null);
+  if (src.len == 0) return;
+  DCHECK_EQ(src.len, sizeof(QuadtreeSketchState));
+  if (dst->len == 0) {
+    dst->ptr = ctx->Allocate(src.len);
+    dst->len = src.len;
+    memcpy(dst->ptr, src.ptr, src.len);
+    return;
+  }
+  DCHECK_EQ(dst->len, sizeof(QuadtreeSketchState));
+  QuadtreeSketchState src_state = *reinterpret_cast<const QuadtreeSketchState*>(src.ptr);
+  QuadtreeSketchState* dst_state = reinterpret_cast<QuadtreeSketchState*>(dst->ptr);
+  if (src_state.bounds != dst_state->bounds) {
+    ctx->SetError("st_quadtree_sketch() requires the same bounds for all rows");
+    return;
+  }
+
+  // Bring both sketches to the same level and merge their sorted entries.
+  while (src_state.level > dst_state->level) {
+    src_state.num_entries = ReduceQuadtreeLevel(src_state.entries, src_state.num_entries);
+    --src_state.level;
+  }
+  while (dst_state->level > src_state.level) {
+    dst_state->num_entries =
+        ReduceQuadtreeLevel(dst_state->entries, dst_state->num_entries);
+    --dst_state->level;
+  }
+  QuadtreeSketchState::Entry merged[2 * QuadtreeSketchState::MAX_ENTRIES];
+  int num_merged = 0;
+  int i = 0;
+  int j = 0;
+  while (i < src_state.num_entries || j < dst_state->num_entries) {
+    if (j == dst_state->num_entries || (i < src_state.num_entries &&
+        src_state.entries[i].code < dst_state->entries[j].code)) {
+      merged[num_merged++] = src_state.entries[i++];
+    } else if (i == src_state.num_entries ||
+        dst_state->entries[j].code < src_state.entries[i].code) {
+      merged[num_merged++] = dst_state->entries[j++];
+    } else {
+      merged[num_merged] = dst_state->entries[j++];
+      merged[num_merged++].count += src_state.entries[i++].count;
+    }
+  }
+  while (num_merged > QuadtreeSketchState::MAX_ENTRIES) {
+    num_merged = ReduceQuadtreeLevel(merged, num_merged);
+    --dst_state->level;
+  }
+  memcpy(dst_state->entries, merged, num_merged * sizeof(QuadtreeSketchState::Entry));
+  dst_state->num_entries = num_merged;
+}
+
+StringVal AggregateFunctions::QuadtreeSketchFinalize(FunctionContext* ctx,
+    const StringVal& src) {
+  DCHECK(!src.is_null);
+  if (src.len == 0) return StringVal::null();
+  DCHECK_EQ(src.len, sizeof(QuadtreeSketchState));
+  const QuadtreeSketchState* state =
+      reinterpret_cast<const QuadtreeSketchState*>(src.ptr);
+  int n = 1 << state->level;
+  SpatialGrid grid(MakeSpatialGrid(state->bounds, n, n));
+  stringstream ss;
+  for (int i = 0; i < state->num_entries; ++i) {
+    uint32_t col;
+    uint32_t row;
+    DecodeMortonCode(state->entries[i].code, &col, &row);
+    if (i > 0) ss << ", ";
+    ss << grid.GetCellBounds(row * n + col) << ":" << state->entries[i].count;
+  }
+  ctx->Free(src.ptr);
+  const string& str = ss.str();
+  StringVal result(ctx, str.size());
+  memcpy(result.ptr, str.c_str(), str.size());
+  return result;
+}
+
 struct RankState {
   int64_t rank;
   int64_t count;
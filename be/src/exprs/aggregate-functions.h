@@ -197,6 +197,38 @@ class AggregateFunctions {
   // Calculates the biased STDDEV, uses KnuthVar Init-Update-Merge functions
   static DoubleVal KnuthStddevPopFinalize(FunctionContext* context, const StringVal& val);
 
+  // Implementation of st_extent(): the MBR of all input rectangles or points. Uses
+  // InitNull() and ExtentUpdate() as the merge function.
+  static void ExtentUpdate(FunctionContext*, const RectangleVal& src, RectangleVal* dst);
+  static void PointExtentUpdate(FunctionContext*, const PointVal& src,
+      RectangleVal* dst);
+
+  // Implementation of st_grid_histogram(point, bounds, num_cols, num_rows): the number
+  // of points in each cell of a uniform grid over 'bounds' (see SpatialGrid). Points
+  // outside of 'bounds' are counted in the nearest edge cell. The intermediate state is
+  // the grid followed by one count per cell, so its size doesn't depend on the input
+  // and merging is a single pass over the cells. The result lists the non-empty cells
+  // as "<cell id>:<count>" pairs.
+  static void GridHistogramInit(FunctionContext*, StringVal* dst);
+  static void GridHistogramUpdate(FunctionContext*, const PointVal& src,
+      const RectangleVal& bounds, const IntVal& num_cols, const IntVal& num_rows,
+      StringVal* dst);
+  static void GridHistogramMerge(FunctionContext*, const StringVal& src, StringVal* dst);
+  static StringVal GridHistogramFinalize(FunctionContext*, const StringVal& src);
+
+  // Implementation of st_quadtree_sketch(point, bounds): an approximate spatial
+  // distribution of the points as a linear quadtree over 'bounds'. The state holds the
+  // counts of up to a fixed number of non-empty quadtree cells of one level, ordered by
+  // their Morton code. When a new cell doesn't fit, the level is reduced, i.e. every
+  // four sibling cells are combined. The result lists the cells as
+  // "RECTANGLE(x1 y1, x2 y2):<count>" pairs.
+  static void QuadtreeSketchInit(FunctionContext*, StringVal* dst);
+  static void QuadtreeSketchUpdate(FunctionContext*, const PointVal& src,
+      const RectangleVal& bounds, StringVal* dst);
+  static void QuadtreeSketchMerge(FunctionContext*, const StringVal& src,
+      StringVal* dst);
+  static StringVal QuadtreeSketchFinalize(FunctionContext*, const StringVal& src);
+
 
   // ----------------------------- Analytic Functions ---------------------------------
   // Analytic functions implement the UDA interface (except Merge(), Serialize()) and are
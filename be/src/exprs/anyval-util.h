@@ -16,6 +16,7 @@
 #ifndef IMPALA_EXPRS_ANYVAL_UTIL_H
 #define IMPALA_EXPRS_ANYVAL_UTIL_H
 
+#include "runtime/spatial-value.h"
 #include "runtime/timestamp-value.h"
 #include "udf/udf-internal.h"
 #include "util/hash-util.h"
@@ -68,6 +69,17 @@ class AnyValUtil {
     return tv.Hash(seed);
   }
 
+  static uint32_t Hash(const PointVal& v, const FunctionContext::TypeDesc&, int seed) {
+    PointValue pv = PointValue::FromPointVal(v);
+    return HashUtil::Hash(&pv, sizeof(pv), seed);
+  }
+
+  static uint32_t Hash(const RectangleVal& v, const FunctionContext::TypeDesc&,
+      int seed) {
+    RectangleValue rv = RectangleValue::FromRectangleVal(v);
+    return HashUtil::Hash(&rv, sizeof(rv), seed);
+  }
+
   static uint64_t Hash(const DecimalVal& v, const FunctionContext::TypeDesc& t,
       int64_t seed) {
     DCHECK_GT(t.precision, 0);
@@ -127,6 +139,18 @@ class AnyValUtil {
     return HashUtil::FnvHash64(&tv, 12, seed);
   }
 
+  static uint64_t Hash64(const PointVal& v, const FunctionContext::TypeDesc&,
+      int64_t seed) {
+    PointValue pv = PointValue::FromPointVal(v);
+    return HashUtil::FnvHash64(&pv, sizeof(pv), seed);
+  }
+
+  static uint64_t Hash64(const RectangleVal& v, const FunctionContext::TypeDesc&,
+      int64_t seed) {
+    RectangleValue rv = RectangleValue::FromRectangleVal(v);
+    return HashUtil::FnvHash64(&rv, sizeof(rv), seed);
+  }
+
   static uint64_t Hash64(const DecimalVal& v, const FunctionContext::TypeDesc& t,
       int64_t seed) {
     switch (ColumnType::GetDecimalByteSize(t.precision)) {
@@ -155,6 +179,8 @@ class AnyValUtil {
         return sizeof(StringVal);
       case TYPE_TIMESTAMP: return sizeof(TimestampVal);
       case TYPE_DECIMAL: return sizeof(DecimalVal);
+      case TYPE_POINT: return sizeof(PointVal);
+      case TYPE_RECTANGLE: return sizeof(RectangleVal);
       default:
         DCHECK(false) << t;
         return 0;
@@ -240,6 +266,14 @@ class AnyValUtil {
         reinterpret_cast<const TimestampValue*>(slot)->ToTimestampVal(
             reinterpret_cast<TimestampVal*>(dst));
         return;
+      case TYPE_POINT:
+        reinterpret_cast<const PointValue*>(slot)->ToPointVal(
+            reinterpret_cast<PointVal*>(dst));
+        return;
+      case TYPE_RECTANGLE:
+        reinterpret_cast<const RectangleValue*>(slot)->ToRectangleVal(
+            reinterpret_cast<RectangleVal*>(dst));
+        return;
       case TYPE_DECIMAL:
         switch (type.GetByteSize()) {
           case 4:
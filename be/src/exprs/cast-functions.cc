@@ -14,9 +14,11 @@
 
 #include "exprs/cast-functions.h"
 
+#include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include "exprs/anyval-util.h"
 #include "exprs/decimal-functions.h"
+#include "runtime/spatial-value.h"
 #include "runtime/timestamp-value.h"
 #include "util/string-parser.h"
 #include "string-functions.h"
@@ -158,6 +160,24 @@ StringVal CastFunctions::CastToStringVal(FunctionContext* ctx, const StringVal&
   return sv;
 }
 
+StringVal CastFunctions::CastToStringVal(FunctionContext* ctx, const PointVal& val) {
+  if (val.is_null) return StringVal::null();
+  ColumnType rtype = AnyValUtil::TypeDescToColumnType(ctx->GetReturnType());
+  StringVal sv = AnyValUtil::FromString(ctx,
+      lexical_cast<string>(PointValue::FromPointVal(val)));
+  AnyValUtil::TruncateIfNecessary(rtype, &sv);
+  return sv;
+}
+
+StringVal CastFunctions::CastToStringVal(FunctionContext* ctx, const RectangleVal& val) {
+  if (val.is_null) return StringVal::null();
+  ColumnType rtype = AnyValUtil::TypeDescToColumnType(ctx->GetReturnType());
+  StringVal sv = AnyValUtil::FromString(ctx,
+      lexical_cast<string>(RectangleValue::FromRectangleVal(val)));
+  AnyValUtil::TruncateIfNecessary(rtype, &sv);
+  return sv;
+}
+
 StringVal CastFunctions::CastToChar(FunctionContext* ctx, const StringVal& val) {
   if (val.is_null) return StringVal::null();
 
@@ -222,3 +242,28 @@ TimestampVal CastFunctions::CastToTimestampVal(FunctionContext* ctx,
   timestamp_value.ToTimestampVal(&result);
   return result;
 }
+
+// The keywords are matched case-insensitively, and whitespace is allowed around all
+// tokens. '%n' only gets assigned if the whole format matched.
+PointVal CastFunctions::CastToPointVal(FunctionContext* ctx, const StringVal& val) {
+  if (val.is_null) return PointVal::null();
+  string str = to_upper_copy(string(reinterpret_cast<char*>(val.ptr), val.len));
+  PointVal result;
+  int len = -1;
+  sscanf(str.c_str(), " POINT ( %lf %lf ) %n", &result.x, &result.y, &len);
+  if (len != str.size()) return PointVal::null();
+  return result;
+}
+
+RectangleVal CastFunctions::CastToRectangleVal(FunctionContext* ctx,
+    const StringVal& val) {
+  if (val.is_null) return RectangleVal::null();
+  string str = to_upper_copy(string(reinterpret_cast<char*>(val.ptr), val.len));
+  double x1, y1, x2, y2;
+  int len = -1;
+  sscanf(str.c_str(), " RECTANGLE ( %lf %lf , %lf %lf ) %n", &x1, &y1, &x2, &y2, &len);
+  if (len != str.size()) return RectangleVal::null();
+  RectangleVal result;
+  RectangleValue::FromCorners(x1, y1, x2, y2).ToRectangleVal(&result);
+  return result;
+}
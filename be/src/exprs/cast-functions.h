@@ -95,6 +95,8 @@ class CastFunctions {
   static StringVal CastToStringVal(FunctionContext* context, const DoubleVal& val);
   static StringVal CastToStringVal(FunctionContext* context, const TimestampVal& val);
   static StringVal CastToStringVal(FunctionContext* context, const StringVal& val);
+  static StringVal CastToStringVal(FunctionContext* context, const PointVal& val);
+  static StringVal CastToStringVal(FunctionContext* context, const RectangleVal& val);
 
   static StringVal CastToChar(FunctionContext* context, const StringVal& val);
 
@@ -106,6 +108,11 @@ class CastFunctions {
   static TimestampVal CastToTimestampVal(FunctionContext* context, const FloatVal& val);
   static TimestampVal CastToTimestampVal(FunctionContext* context, const DoubleVal& val);
   static TimestampVal CastToTimestampVal(FunctionContext* context, const StringVal& val);
+
+  // Parse the text form of the spatial types, "POINT(x y)" and
+  // "RECTANGLE(x1 y1, x2 y2)". Return NULL if 'val' is not in that form.
+  static PointVal CastToPointVal(FunctionContext* context, const StringVal& val);
+  static RectangleVal CastToRectangleVal(FunctionContext* context, const StringVal& val);
 };
 
 }
@@ -181,6 +181,8 @@ void ExprContext::GetValue(TupleRow* row, bool as_ascii, TColumnValue* col_val)
       col_val->__isset.string_val = true;
       break;
     case TYPE_TIMESTAMP:
+    case TYPE_POINT:
+    case TYPE_RECTANGLE:
       RawValue::PrintValue(
           value, root_->type_, root_->output_scale_, &col_val->string_val);
       col_val->__isset.string_val = true;
@@ -263,6 +265,18 @@ void* ExprContext::GetValue(Expr* e, TupleRow* row) {
       result_.timestamp_val = TimestampValue::FromTimestampVal(v);
       return &result_.timestamp_val;
     }
+    case TYPE_POINT: {
+      impala_udf::PointVal v = e->GetPointVal(this, row);
+      if (v.is_null) return NULL;
+      result_.point_val = PointValue::FromPointVal(v);
+      return &result_.point_val;
+    }
+    case TYPE_RECTANGLE: {
+      impala_udf::RectangleVal v = e->GetRectangleVal(this, row);
+      if (v.is_null) return NULL;
+      result_.rectangle_val = RectangleValue::FromRectangleVal(v);
+      return &result_.rectangle_val;
+    }
     case TYPE_DECIMAL: {
       DecimalVal v = e->GetDecimalVal(this, row);
       if (v.is_null) return NULL;
@@ -330,3 +344,9 @@ TimestampVal ExprContext::GetTimestampVal(TupleRow* row) {
 DecimalVal ExprContext::GetDecimalVal(TupleRow* row) {
   return root_->GetDecimalVal(this, row);
 }
+PointVal ExprContext::GetPointVal(TupleRow* row) {
+  return root_->GetPointVal(this, row);
+}
+RectangleVal ExprContext::GetRectangleVal(TupleRow* row) {
+  return root_->GetRectangleVal(this, row);
+}
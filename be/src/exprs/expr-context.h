@@ -78,6 +78,7 @@ class ExprContext {
   // TYPE_FLOAT/DOUBLE: doubleVal
   // TYPE_STRING: stringVal
   // TYPE_TIMESTAMP: stringVal
+  // TYPE_POINT/RECTANGLE: stringVal
   // Note: timestamp is converted to string via RawValue::PrintValue because HiveServer2
   // requires timestamp in a string format.
   void GetValue(TupleRow* row, bool as_ascii, TColumnValue* col_val);
@@ -117,6 +118,8 @@ class ExprContext {
   StringVal GetStringVal(TupleRow* row);
   TimestampVal GetTimestampVal(TupleRow* row);
   DecimalVal GetDecimalVal(TupleRow* row);
+  PointVal GetPointVal(TupleRow* row);
+  RectangleVal GetRectangleVal(TupleRow* row);
 
   // Frees all local allocations made by fn_contexts_. This can be called when result data
   // from this context is no longer needed.
@@ -128,8 +131,10 @@ class ExprContext {
  private:
   friend class Expr;
   // Users of private GetValue()
+  friend class HdfsParquetScanner;
   friend class HiveUdfCall;
   friend class ScalarFnCall;
+  friend class VectorizedConstant;
 
   // FunctionContexts for each registered expression. The FunctionContexts are created and
   // owned by this ExprContext.
@@ -26,7 +26,8 @@
 void dummy(impala_udf::FunctionContext*, impala_udf::BooleanVal*, impala_udf::TinyIntVal*,
            impala_udf::SmallIntVal*, impala_udf::IntVal*, impala_udf::BigIntVal*,
            impala_udf::FloatVal*, impala_udf::DoubleVal*, impala_udf::StringVal*,
-           impala_udf::TimestampVal*, impala_udf::DecimalVal*, ExprContext*) { }
+           impala_udf::TimestampVal*, impala_udf::DecimalVal*, impala_udf::PointVal*,
+           impala_udf::RectangleVal*, ExprContext*) { }
 #endif
 
 
@@ -70,3 +71,9 @@ TimestampVal Expr::GetTimestampVal(Expr* expr, ExprContext* context, TupleRow* r
 DecimalVal Expr::GetDecimalVal(Expr* expr, ExprContext* context, TupleRow* row) {
   return expr->GetDecimalVal(context, row);
 }
+PointVal Expr::GetPointVal(Expr* expr, ExprContext* context, TupleRow* row) {
+  return expr->GetPointVal(context, row);
+}
+RectangleVal Expr::GetRectangleVal(Expr* expr, ExprContext* context, TupleRow* row) {
+  return expr->GetRectangleVal(context, row);
+}
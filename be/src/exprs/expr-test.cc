@@ -4069,6 +4069,41 @@ TEST_F(ExprTest, DecimalOverflowCasts) {
       ColumnType::CreateDecimalType(29, 1));
 }
 
+TEST_F(ExprTest, SpatialFunctions) {
+  TestStringValue("cast(point(1, 2) as string)", "POINT(1 2)");
+  TestStringValue("cast(point(-1.5, 1e3) as string)", "POINT(-1.5 1000)");
+  // The corners of a rectangle may be given in any order.
+  TestStringValue("cast(rectangle(3, 2, 1, 4) as string)", "RECTANGLE(1 2, 3 4)");
+  TestIsNull("cast(point(NULL, 1) as string)", TYPE_STRING);
+  TestIsNull("cast(rectangle(0, 0, 1, NULL) as string)", TYPE_STRING);
+
+  TestStringValue("cast(cast('POINT(1.5 -2)' as point) as string)", "POINT(1.5 -2)");
+  TestStringValue("cast(cast(' point ( 1 2 ) ' as point) as string)", "POINT(1 2)");
+  TestStringValue("cast(cast('RECTANGLE(0 0, 1 1)' as rectangle) as string)",
+      "RECTANGLE(0 0, 1 1)");
+  TestIsNull("cast(cast('POINT(1)' as point) as string)", TYPE_STRING);
+  TestIsNull("cast(cast('POINT(1 2) x' as point) as string)", TYPE_STRING);
+  TestIsNull("cast(cast('RECTANGLE(0 0 1 1)' as rectangle) as string)", TYPE_STRING);
+
+  TestValue("st_contains(rectangle(0, 0, 2, 2), point(1, 1))", TYPE_BOOLEAN, true);
+  TestValue("st_contains(rectangle(0, 0, 2, 2), point(2, 1))", TYPE_BOOLEAN, false);
+  TestValue("st_contains(rectangle(0, 0, 2, 2), rectangle(0, 0, 1, 1))", TYPE_BOOLEAN,
+      true);
+  TestValue("st_intersects(rectangle(0, 0, 2, 2), rectangle(1, 1, 3, 3))", TYPE_BOOLEAN,
+      true);
+  TestValue("st_within(rectangle(0, 0, 2, 2), rectangle(1, 1, 3, 3))", TYPE_BOOLEAN,
+      false);
+  TestValue("st_dwithin(point(0, 0), point(3, 4), 5)", TYPE_BOOLEAN, true);
+  TestValue("st_distance(point(0, 0), point(3, 4))", TYPE_DOUBLE, 5.0);
+  TestValue("st_distance(point(-1, 2), point(-1, 2))", TYPE_DOUBLE, 0.0);
+  TestIsNull("st_distance(point(0, 0), NULL)", TYPE_DOUBLE);
+  TestValue("st_contains('POLYGON((0 0, 4 0, 4 4, 0 4, 0 0))', point(1, 1))",
+      TYPE_BOOLEAN, true);
+  TestIsNull("st_contains(rectangle(0, 0, 2, 2), NULL)", TYPE_BOOLEAN);
+  // A constant polygon that doesn't parse fails the query instead of hitting a DCHECK.
+  TestError("st_contains('POLYGON((0 0, 4 0', point(1, 1))");
+}
+
 TEST_F(ExprTest, UdfInterfaceBuiltins) {
   TestValue("udf_pi()", TYPE_DOUBLE, M_PI);
   TestValue("udf_abs(-1)", TYPE_DOUBLE, 1.0);
@@ -16,6 +16,7 @@
 #define IMPALA_EXPRS_EXPR_VALUE_H
 
 #include "runtime/decimal-value.h"
+#include "runtime/spatial-value.h"
 #include "runtime/string-value.h"
 #include "runtime/timestamp-value.h"
 
@@ -35,6 +36,8 @@ struct ExprValue {
   Decimal4Value decimal4_val;
   Decimal8Value decimal8_val;
   Decimal16Value decimal16_val;
+  PointValue point_val;
+  RectangleValue rectangle_val;
 
   ExprValue()
     : bool_val(false),
@@ -48,7 +51,9 @@ struct ExprValue {
       timestamp_val(),
       decimal4_val(),
       decimal8_val(),
-      decimal16_val() {
+      decimal16_val(),
+      point_val(),
+      rectangle_val() {
   }
 
   ExprValue(bool v): bool_val(v) {}
@@ -46,6 +46,7 @@
 #include "exprs/operators.h"
 #include "exprs/scalar-fn-call.h"
 #include "exprs/slot-ref.h"
+#include "exprs/spatial-functions.h"
 #include "exprs/string-functions.h"
 #include "exprs/timestamp-functions.h"
 #include "exprs/tuple-is-null-predicate.h"
@@ -440,6 +441,10 @@ Function* Expr::GetStaticGetValWrapper(ColumnType type, LlvmCodeGen* codegen) {
       return codegen->GetFunction(IRFunction::EXPR_GET_TIMESTAMP_VAL);
     case TYPE_DECIMAL:
       return codegen->GetFunction(IRFunction::EXPR_GET_DECIMAL_VAL);
+    case TYPE_POINT:
+      return codegen->GetFunction(IRFunction::EXPR_GET_POINT_VAL);
+    case TYPE_RECTANGLE:
+      return codegen->GetFunction(IRFunction::EXPR_GET_RECTANGLE_VAL);
     default:
       DCHECK(false) << "Invalid type: " << type.DebugString();
       return NULL;
@@ -475,6 +480,7 @@ void Expr::InitBuiltinsDummy() {
   LikePredicate::Like(NULL, StringVal::null(), StringVal::null());
   Operators::Add_IntVal_IntVal(NULL, IntVal::null(), IntVal::null());
   MathFunctions::Pi(NULL);
+  SpatialFunctions::MakePoint(NULL, DoubleVal::null(), DoubleVal::null());
   StringFunctions::Length(NULL, StringVal::null());
   TimestampFunctions::Year(NULL, TimestampVal::null());
   UdfBuiltins::Pi(NULL);
@@ -529,6 +535,14 @@ AnyVal* Expr::GetConstVal(ExprContext* context) {
       constant_val_.reset(new DecimalVal(GetDecimalVal(context, NULL)));
       break;
     }
+    case TYPE_POINT: {
+      constant_val_.reset(new PointVal(GetPointVal(context, NULL)));
+      break;
+    }
+    case TYPE_RECTANGLE: {
+      constant_val_.reset(new RectangleVal(GetRectangleVal(context, NULL)));
+      break;
+    }
     default:
       DCHECK(false) << "Type not implemented: " << type();
   }
@@ -603,3 +617,11 @@ DecimalVal Expr::GetDecimalVal(ExprContext* context, TupleRow* row) {
   DCHECK(false) << DebugString();
   return DecimalVal::null();
 }
+PointVal Expr::GetPointVal(ExprContext* context, TupleRow* row) {
+  DCHECK(false) << DebugString();
+  return PointVal::null();
+}
+RectangleVal Expr::GetRectangleVal(ExprContext* context, TupleRow* row) {
+  DCHECK(false) << DebugString();
+  return RectangleVal::null();
+}
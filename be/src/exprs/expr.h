@@ -131,6 +131,8 @@ class Expr {
   virtual StringVal GetStringVal(ExprContext* context, TupleRow*);
   virtual TimestampVal GetTimestampVal(ExprContext* context, TupleRow*);
   virtual DecimalVal GetDecimalVal(ExprContext* context, TupleRow*);
+  virtual PointVal GetPointVal(ExprContext* context, TupleRow*);
+  virtual RectangleVal GetRectangleVal(ExprContext* context, TupleRow*);
 
   // Get the number of digits after the decimal that should be displayed for this
   // value. Returns -1 if no scale has been specified (currently the scale is only set for
@@ -145,6 +147,12 @@ class Expr {
   const ColumnType& type() const { return type_; }
   bool is_slotref() const { return is_slotref_; }
 
+  // Name of the function this expr calls. Empty if it isn't a function call.
+  const std::string& fn_name() const { return fn_.name.function_name; }
+
+  // Function this expr calls. Its name is empty if it isn't a function call.
+  const TFunction& fn() const { return fn_; }
+
   const std::vector<Expr*>& children() const { return children_; }
 
   // Returns true if expr doesn't contain slotrefs, ie, can be evaluated
@@ -248,6 +256,7 @@ class Expr {
   friend class InPredicate;
   friend class FunctionCall;
   friend class ScalarFnCall;
+  friend class VectorizedExpr;
 
   Expr(const ColumnType& type, bool is_slotref = false);
   Expr(const TExprNode& node, bool is_slotref = false);
@@ -375,6 +384,8 @@ class Expr {
   static StringVal GetStringVal(Expr* expr, ExprContext* context, TupleRow* row);
   static TimestampVal GetTimestampVal(Expr* expr, ExprContext* context, TupleRow* row);
   static DecimalVal GetDecimalVal(Expr* expr, ExprContext* context, TupleRow* row);
+  static PointVal GetPointVal(Expr* expr, ExprContext* context, TupleRow* row);
+  static RectangleVal GetRectangleVal(Expr* expr, ExprContext* context, TupleRow* row);
 };
 
 }
@@ -76,6 +76,16 @@ DecimalVal NullLiteral::GetDecimalVal(ExprContext* context, TupleRow* row) {
   return DecimalVal::null();
 }
 
+PointVal NullLiteral::GetPointVal(ExprContext* context, TupleRow* row) {
+  DCHECK_EQ(type_.type, TYPE_POINT) << type_;
+  return PointVal::null();
+}
+
+RectangleVal NullLiteral::GetRectangleVal(ExprContext* context, TupleRow* row) {
+  DCHECK_EQ(type_.type, TYPE_RECTANGLE) << type_;
+  return RectangleVal::null();
+}
+
 // Generated IR for a bigint NULL literal:
 //
 // define { i8, i64 } @NullLiteral(i8* %context, %"class.impala::TupleRow"* %row) {
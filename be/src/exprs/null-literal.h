@@ -37,6 +37,8 @@ class NullLiteral: public Expr {
   virtual impala_udf::StringVal GetStringVal(ExprContext*, TupleRow*);
   virtual impala_udf::TimestampVal GetTimestampVal(ExprContext*, TupleRow*);
   virtual impala_udf::DecimalVal GetDecimalVal(ExprContext*, TupleRow*);
+  virtual impala_udf::PointVal GetPointVal(ExprContext*, TupleRow*);
+  virtual impala_udf::RectangleVal GetRectangleVal(ExprContext*, TupleRow*);
 
   virtual std::string DebugString() const;
 
@@ -493,6 +493,8 @@ typedef DoubleVal (*DoubleWrapper)(ExprContext*, TupleRow*);
 typedef StringVal (*StringWrapper)(ExprContext*, TupleRow*);
 typedef TimestampVal (*TimestampWrapper)(ExprContext*, TupleRow*);
 typedef DecimalVal (*DecimalWrapper)(ExprContext*, TupleRow*);
+typedef PointVal (*PointWrapper)(ExprContext*, TupleRow*);
+typedef RectangleVal (*RectangleWrapper)(ExprContext*, TupleRow*);
 
 #define INTERPRET_SCALAR_FN(RETURN_TYPE) \
   RETURN_TYPE ScalarFnCall::InterpretEval##RETURN_TYPE(\
@@ -536,6 +538,8 @@ INTERPRET_SCALAR_FN(DoubleVal);
 INTERPRET_SCALAR_FN(StringVal);
 INTERPRET_SCALAR_FN(TimestampVal);
 INTERPRET_SCALAR_FN(DecimalVal);
+INTERPRET_SCALAR_FN(PointVal);
+INTERPRET_SCALAR_FN(RectangleVal);
 
 // TODO: macroify this too?
 BooleanVal ScalarFnCall::GetBooleanVal(ExprContext* context, TupleRow* row) {
@@ -618,6 +622,22 @@ DecimalVal ScalarFnCall::GetDecimalVal(ExprContext* context, TupleRow* row) {
   return fn(context, row);
 }
 
+PointVal ScalarFnCall::GetPointVal(ExprContext* context, TupleRow* row) {
+  DCHECK_EQ(type_.type, TYPE_POINT);
+  DCHECK(context != NULL);
+  if (scalar_fn_wrapper_ == NULL) return InterpretEvalPointVal(context, row);
+  PointWrapper fn = reinterpret_cast<PointWrapper>(scalar_fn_wrapper_);
+  return fn(context, row);
+}
+
+RectangleVal ScalarFnCall::GetRectangleVal(ExprContext* context, TupleRow* row) {
+  DCHECK_EQ(type_.type, TYPE_RECTANGLE);
+  DCHECK(context != NULL);
+  if (scalar_fn_wrapper_ == NULL) return InterpretEvalRectangleVal(context, row);
+  RectangleWrapper fn = reinterpret_cast<RectangleWrapper>(scalar_fn_wrapper_);
+  return fn(context, row);
+}
+
 string ScalarFnCall::DebugString() const {
   stringstream out;
   out << "ScalarFnCall(udf_type=" << fn_.binary_type
@@ -71,6 +71,8 @@ class ScalarFnCall: public Expr {
   virtual StringVal GetStringVal(ExprContext* context, TupleRow*);
   virtual TimestampVal GetTimestampVal(ExprContext* context, TupleRow*);
   virtual DecimalVal GetDecimalVal(ExprContext* context, TupleRow*);
+  virtual PointVal GetPointVal(ExprContext* context, TupleRow*);
+  virtual RectangleVal GetRectangleVal(ExprContext* context, TupleRow*);
 
  private:
   // If this function has var args, children()[vararg_start_idx_] is the first vararg
@@ -120,6 +122,8 @@ class ScalarFnCall: public Expr {
   StringVal InterpretEvalStringVal(ExprContext* context, TupleRow* row);
   TimestampVal InterpretEvalTimestampVal(ExprContext* context, TupleRow* row);
   DecimalVal InterpretEvalDecimalVal(ExprContext* context, TupleRow* row);
+  PointVal InterpretEvalPointVal(ExprContext* context, TupleRow* row);
+  RectangleVal InterpretEvalRectangleVal(ExprContext* context, TupleRow* row);
 };
 
 }
@@ -156,6 +156,10 @@ Status SlotRef::GetCodegendComputeFn(RuntimeState* state, llvm::Function** fn) {
     *fn = NULL;
     return Status("Codegen for Char not supported.");
   }
+  if (type_.IsSpatialType()) {
+    // Spatial slots are read by the interpreted Get*Val() through the static wrapper.
+    return GetCodegendComputeFnWrapper(state, fn);
+  }
   if (ir_compute_fn_ != NULL) {
     *fn = ir_compute_fn_;
     return Status::OK;
@@ -459,4 +463,22 @@ DecimalVal SlotRef::GetDecimalVal(ExprContext* context, TupleRow* row) {
   }
 }
 
+PointVal SlotRef::GetPointVal(ExprContext* context, TupleRow* row) {
+  DCHECK_EQ(type_.type, TYPE_POINT);
+  Tuple* t = row->GetTuple(tuple_idx_);
+  if (t == NULL || t->IsNull(null_indicator_offset_)) return PointVal::null();
+  PointVal result;
+  reinterpret_cast<PointValue*>(t->GetSlot(slot_offset_))->ToPointVal(&result);
+  return result;
+}
+
+RectangleVal SlotRef::GetRectangleVal(ExprContext* context, TupleRow* row) {
+  DCHECK_EQ(type_.type, TYPE_RECTANGLE);
+  Tuple* t = row->GetTuple(tuple_idx_);
+  if (t == NULL || t->IsNull(null_indicator_offset_)) return RectangleVal::null();
+  RectangleVal result;
+  reinterpret_cast<RectangleValue*>(t->GetSlot(slot_offset_))->ToRectangleVal(&result);
+  return result;
+}
+
 }
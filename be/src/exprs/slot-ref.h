@@ -51,6 +51,8 @@ class SlotRef : public Expr {
   virtual impala_udf::StringVal GetStringVal(ExprContext* context, TupleRow*);
   virtual impala_udf::TimestampVal GetTimestampVal(ExprContext* context, TupleRow*);
   virtual impala_udf::DecimalVal GetDecimalVal(ExprContext* context, TupleRow*);
+  virtual impala_udf::PointVal GetPointVal(ExprContext* context, TupleRow*);
+  virtual impala_udf::RectangleVal GetRectangleVal(ExprContext* context, TupleRow*);
 
  protected:
   int tuple_idx_;  // within row
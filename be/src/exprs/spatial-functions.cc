@@ -0,0 +1,137 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exprs/spatial-functions.h"
+
+#include <cmath>
+
+#include "common/logging.h"
+#include "runtime/spatial-polygon.h"
+#include "runtime/spatial-value.h"
+
+using namespace std;
+
+namespace impala {
+
+PointVal SpatialFunctions::MakePoint(FunctionContext* ctx, const DoubleVal& x,
+    const DoubleVal& y) {
+  if (x.is_null || y.is_null) return PointVal::null();
+  return PointVal(x.val, y.val);
+}
+
+RectangleVal SpatialFunctions::MakeRectangle(FunctionContext* ctx, const DoubleVal& x1,
+    const DoubleVal& y1, const DoubleVal& x2, const DoubleVal& y2) {
+  if (x1.is_null || y1.is_null || x2.is_null || y2.is_null) return RectangleVal::null();
+  RectangleVal result;
+  RectangleValue::FromCorners(x1.val, y1.val, x2.val, y2.val).ToRectangleVal(&result);
+  return result;
+}
+
+BooleanVal SpatialFunctions::Intersects(FunctionContext* ctx, const RectangleVal& r,
+    const RectangleVal& s) {
+  if (r.is_null || s.is_null) return BooleanVal::null();
+  return BooleanVal(RectangleValue::FromRectangleVal(r).Intersects(
+      RectangleValue::FromRectangleVal(s)));
+}
+
+BooleanVal SpatialFunctions::ContainsPoint(FunctionContext* ctx, const RectangleVal& r,
+    const PointVal& p) {
+  if (r.is_null || p.is_null) return BooleanVal::null();
+  return BooleanVal(RectangleValue::FromRectangleVal(r).Contains(
+      PointValue::FromPointVal(p)));
+}
+
+BooleanVal SpatialFunctions::Contains(FunctionContext* ctx, const RectangleVal& r,
+    const RectangleVal& s) {
+  if (r.is_null || s.is_null) return BooleanVal::null();
+  return BooleanVal(RectangleValue::FromRectangleVal(r).Contains(
+      RectangleValue::FromRectangleVal(s)));
+}
+
+void SpatialFunctions::PolygonContainsPrepare(FunctionContext* ctx,
+    FunctionContext::FunctionStateScope scope) {
+  if (scope != FunctionContext::FRAGMENT_LOCAL) return;
+  if (!ctx->IsArgConstant(0)) return;
+  DCHECK_EQ(ctx->GetArgType(0)->type, FunctionContext::TYPE_STRING);
+  StringVal* wkt = reinterpret_cast<StringVal*>(ctx->GetConstantArg(0));
+  if (wkt->is_null) return;
+
+  // The prepared polygon is only read by PolygonContainsPoint(), so all threads of the
+  // fragment can share it.
+  string error_str;
+  SpatialPolygon* polygon = new SpatialPolygon();
+  if (!polygon->ParseWkt(reinterpret_cast<char*>(wkt->ptr), wkt->len, &error_str)) {
+    delete polygon;
+    ctx->SetError(error_str.c_str());
+    return;
+  }
+  polygon->Prepare();
+  ctx->SetFunctionState(scope, polygon);
+}
+
+void SpatialFunctions::PolygonContainsClose(FunctionContext* ctx,
+    FunctionContext::FunctionStateScope scope) {
+  if (scope != FunctionContext::FRAGMENT_LOCAL) return;
+  SpatialPolygon* polygon =
+      reinterpret_cast<SpatialPolygon*>(ctx->GetFunctionState(scope));
+  delete polygon;
+}
+
+BooleanVal SpatialFunctions::PolygonContainsPoint(FunctionContext* ctx,
+    const StringVal& wkt, const PointVal& p) {
+  if (wkt.is_null || p.is_null) return BooleanVal::null();
+  const SpatialPolygon* polygon = reinterpret_cast<SpatialPolygon*>(
+      ctx->GetFunctionState(FunctionContext::FRAGMENT_LOCAL));
+  if (polygon == NULL) {
+    // A constant polygon that failed to parse was already reported by the prepare
+    // function.
+    if (ctx->IsArgConstant(0)) return BooleanVal::null();
+    // Building the index costs more than testing every edge once, so a polygon that
+    // differs per row is left unprepared.
+    SpatialPolygon local_polygon;
+    string error_str;
+    if (!local_polygon.ParseWkt(reinterpret_cast<char*>(wkt.ptr), wkt.len, &error_str)) {
+      ctx->AddWarning(error_str.c_str());
+      return BooleanVal::null();
+    }
+    return BooleanVal(local_polygon.Contains(PointValue::FromPointVal(p)));
+  }
+  return BooleanVal(polygon->Contains(PointValue::FromPointVal(p)));
+}
+
+BooleanVal SpatialFunctions::Within(FunctionContext* ctx, const RectangleVal& r,
+    const RectangleVal& s) {
+  return Contains(ctx, s, r);
+}
+
+BooleanVal SpatialFunctions::DWithin(FunctionContext* ctx, const PointVal& p,
+    const PointVal& q, const DoubleVal& distance) {
+  if (p.is_null || q.is_null || distance.is_null) return BooleanVal::null();
+  // Compare the squared distance, like SpatialKernels::DWithin(), so both agree on
+  // points at exactly 'distance'.
+  if (!(distance.val >= 0)) return BooleanVal(false);
+  double dx = q.x - p.x;
+  double dy = q.y - p.y;
+  return BooleanVal(dx * dx + dy * dy <= distance.val * distance.val);
+}
+
+DoubleVal SpatialFunctions::Distance(FunctionContext* ctx, const PointVal& p,
+    const PointVal& q) {
+  if (p.is_null || q.is_null) return DoubleVal::null();
+  double dx = p.x - q.x;
+  double dy = p.y - q.y;
+  return DoubleVal(sqrt(dx * dx + dy * dy));
+}
+
+}
@@ -0,0 +1,78 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPALA_EXPRS_SPATIAL_FUNCTIONS_H
+#define IMPALA_EXPRS_SPATIAL_FUNCTIONS_H
+
+#include "udf/udf.h"
+
+using namespace impala_udf;
+
+namespace impala {
+
+// Builtin spatial predicates on POINT and RECTANGLE values. They have the same
+// semantics as the RectangleValue functions and the batch kernels in SpatialKernels,
+// which operators use to evaluate them over many values at once. All of them return
+// NULL if any argument is NULL.
+class SpatialFunctions {
+ public:
+  // Implementation of point(). Returns the point (x, y).
+  static PointVal MakePoint(FunctionContext* ctx, const DoubleVal& x, const DoubleVal& y);
+
+  // Implementation of rectangle(). Returns the rectangle with the opposite corners
+  // (x1, y1) and (x2, y2), which may be given in any order.
+  static RectangleVal MakeRectangle(FunctionContext* ctx, const DoubleVal& x1,
+      const DoubleVal& y1, const DoubleVal& x2, const DoubleVal& y2);
+
+  // Implementation of st_intersects(). Returns true if the interiors of 'r' and 's'
+  // overlap.
+  static BooleanVal Intersects(FunctionContext* ctx, const RectangleVal& r,
+      const RectangleVal& s);
+
+  // Implementations of st_contains(). Returns true if 'p' lies inside 'r', where the
+  // upper edges of 'r' are exclusive, or if 's' lies entirely inside 'r'.
+  static BooleanVal ContainsPoint(FunctionContext* ctx, const RectangleVal& r,
+      const PointVal& p);
+  static BooleanVal Contains(FunctionContext* ctx, const RectangleVal& r,
+      const RectangleVal& s);
+
+  // Implementation of st_contains() on a polygon, given as WKT text, and a point. See
+  // SpatialPolygon for the semantics. If 'wkt' is constant, PolygonContainsPrepare()
+  // parses it and builds its index once per fragment, so that each call costs
+  // O(log #edges). Otherwise every call parses 'wkt' and tests all of its edges.
+  // Invalid WKT is an error if constant and a warning and NULL result otherwise.
+  static BooleanVal PolygonContainsPoint(FunctionContext* ctx, const StringVal& wkt,
+      const PointVal& p);
+  static void PolygonContainsPrepare(FunctionContext* ctx,
+      FunctionContext::FunctionStateScope scope);
+  static void PolygonContainsClose(FunctionContext* ctx,
+      FunctionContext::FunctionStateScope scope);
+
+  // Implementation of st_within(). Returns true if 'r' lies entirely inside 's'.
+  static BooleanVal Within(FunctionContext* ctx, const RectangleVal& r,
+      const RectangleVal& s);
+
+  // Implementation of st_dwithin(). Returns true if the euclidean distance between 'p'
+  // and 'q' is at most 'distance'.
+  static BooleanVal DWithin(FunctionContext* ctx, const PointVal& p, const PointVal& q,
+      const DoubleVal& distance);
+
+  // Implementation of st_distance(). Returns the euclidean distance between 'p' and
+  // 'q', computed the same way as by KnnNode.
+  static DoubleVal Distance(FunctionContext* ctx, const PointVal& p, const PointVal& q);
+};
+
+}
+
+#endif
@@ -0,0 +1,395 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <string.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <gtest/gtest.h>
+
+#include "common/init.h"
+#include "common/object-pool.h"
+#include "exprs/expr.h"
+#include "exprs/expr-context.h"
+#include "exprs/vectorized-expr.h"
+#include "runtime/column-batch.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/raw-value.h"
+#include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
+#include "runtime/string-value.h"
+#include "runtime/tuple-row.h"
+#include "testutil/desc-tbl-builder.h"
+#include "util/test-info.h"
+
+#include "gen-cpp/Exprs_types.h"
+
+using namespace boost;
+using namespace impala;
+using namespace std;
+
+namespace impala {
+
+// The types with a vectorized implementation. The test tuple has two slots of each,
+// so that binary operators can be applied to two different columns.
+static const PrimitiveType TYPES[] = {
+  TYPE_BOOLEAN, TYPE_TINYINT, TYPE_SMALLINT, TYPE_INT, TYPE_BIGINT, TYPE_FLOAT,
+  TYPE_DOUBLE, TYPE_STRING
+};
+static const int NUM_TYPES = sizeof(TYPES) / sizeof(TYPES[0]);
+static const int NUM_ROWS = 72;
+
+static const char* STRINGS[] = { "", "a", "ab", "b" };
+
+// Tests that VectorizedExpr returns the same results as the row-at-a-time path of the
+// exprs, for each supported operator and type, including NULL operands.
+class VectorizedExprTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    state_.reset(new RuntimeState(TPlanFragmentInstanceCtx(), "", NULL));
+    DescriptorTblBuilder builder(&pool_);
+    TupleDescBuilder& tuple_builder = builder.DeclareTuple();
+    for (int i = 0; i < NUM_TYPES; ++i) tuple_builder << TYPES[i] << TYPES[i];
+    DescriptorTbl* desc_tbl = builder.Build();
+    state_->set_desc_tbl(desc_tbl);
+    TupleDescriptor* tuple_desc = desc_tbl->GetTupleDescriptor(0);
+    slots_ = tuple_desc->slots();
+    row_desc_.reset(new RowDescriptor(tuple_desc, false));
+
+    batch_.reset(new RowBatch(*row_desc_, NUM_ROWS, &tracker_));
+    for (int row = 0; row < NUM_ROWS; ++row) {
+      Tuple* tuple = Tuple::Create(tuple_desc->byte_size(), batch_->tuple_data_pool());
+      for (int i = 0; i < slots_.size(); ++i) SetSlot(tuple, i, row);
+      int idx = batch_->AddRow();
+      batch_->GetRow(idx)->SetTuple(0, tuple);
+      batch_->CommitLastRow();
+    }
+  }
+
+  virtual void TearDown() {
+    batch_.reset();
+    state_.reset();
+  }
+
+  // Sets the value of the slot 'slot_idx' of the row 'row'. The first and second slot
+  // of a type are NULL in different rows, and some rows have both NULL. The numbers
+  // include 0 and negative values, and their products don't overflow.
+  void SetSlot(Tuple* tuple, int slot_idx, int row) {
+    const SlotDescriptor* slot = slots_[slot_idx];
+    bool first = slot_idx % 2 == 0;
+    if ((first ? row % 3 : (row / 3) % 3) == 0) {
+      tuple->SetNull(slot->null_indicator_offset());
+      return;
+    }
+    int v = (first ? row : row * 7 / 2) % 5 - 2;
+    void* dst = tuple->GetSlot(slot->tuple_offset());
+    switch (slot->type().type) {
+      case TYPE_BOOLEAN:
+        *reinterpret_cast<bool*>(dst) = (first ? row : row / 2) % 2 == 0;
+        break;
+      case TYPE_TINYINT: *reinterpret_cast<int8_t*>(dst) = v; break;
+      case TYPE_SMALLINT: *reinterpret_cast<int16_t*>(dst) = v * 61; break;
+      case TYPE_INT: *reinterpret_cast<int32_t*>(dst) = v * 10007; break;
+      case TYPE_BIGINT: *reinterpret_cast<int64_t*>(dst) = v * 1500000001LL; break;
+      case TYPE_FLOAT: *reinterpret_cast<float*>(dst) = v * 1.25f; break;
+      case TYPE_DOUBLE: *reinterpret_cast<double*>(dst) = v * 0.75; break;
+      case TYPE_STRING: {
+        const char* s = STRINGS[(first ? row : row / 4) % 4];
+        *reinterpret_cast<StringValue*>(dst) =
+            StringValue(const_cast<char*>(s), strlen(s));
+        break;
+      }
+      default:
+        DCHECK(false) << slot->type();
+    }
+  }
+
+  // Returns the index of the first or second slot of 'type'.
+  int SlotIdx(PrimitiveType type, bool first) {
+    for (int i = 0; i < NUM_TYPES; ++i) {
+      if (TYPES[i] == type) return 2 * i + (first ? 0 : 1);
+    }
+    DCHECK(false) << type;
+    return -1;
+  }
+
+  // Returns the name of the AnyVal subclass of 'type', e.g. IntVal.
+  static string ValName(PrimitiveType type) {
+    switch (type) {
+      case TYPE_BOOLEAN: return "BooleanVal";
+      case TYPE_TINYINT: return "TinyIntVal";
+      case TYPE_SMALLINT: return "SmallIntVal";
+      case TYPE_INT: return "IntVal";
+      case TYPE_BIGINT: return "BigIntVal";
+      case TYPE_FLOAT: return "FloatVal";
+      case TYPE_DOUBLE: return "DoubleVal";
+      case TYPE_STRING: return "StringVal";
+      default:
+        DCHECK(false) << type;
+        return "";
+    }
+  }
+
+  // Returns the symbol of Operators::<op>_<val>_<val>(), the builtin of a binary
+  // operator on 'type'.
+  static string OperatorSymbol(const string& op, PrimitiveType type) {
+    string val = ValName(type);
+    string fn = op + "_" + val + "_" + val;
+    stringstream ss;
+    ss << "_ZN6impala9Operators" << fn.size() << fn
+       << "EPN10impala_udf15FunctionContextERKNS1_" << val.size() << val << "ES6_";
+    return ss.str();
+  }
+
+  // Returns the symbol of CastFunctions::CastTo<to val>(), the builtin of a cast.
+  static string CastSymbol(PrimitiveType to, PrimitiveType from) {
+    string fn = "CastTo" + ValName(to);
+    string val = ValName(from);
+    stringstream ss;
+    ss << "_ZN6impala13CastFunctions" << fn.size() << fn
+       << "EPN10impala_udf15FunctionContextERKNS1_" << val.size() << val << "E";
+    return ss.str();
+  }
+
+  TExprNode SlotRefNode(int slot_idx) {
+    TExprNode node;
+    node.node_type = TExprNodeType::SLOT_REF;
+    node.type = slots_[slot_idx]->type().ToThrift();
+    node.num_children = 0;
+    TSlotRef slot_ref;
+    slot_ref.slot_id = slots_[slot_idx]->id();
+    node.__set_slot_ref(slot_ref);
+    return node;
+  }
+
+  static TExprNode IntLiteralNode(PrimitiveType type, int64_t value) {
+    TExprNode node;
+    node.node_type = TExprNodeType::INT_LITERAL;
+    node.type = ColumnType(type).ToThrift();
+    node.num_children = 0;
+    TIntLiteral int_literal;
+    int_literal.value = value;
+    node.__set_int_literal(int_literal);
+    return node;
+  }
+
+  // Returns a call of the builtin 'name' with 'num_children' arguments of 'arg_type'.
+  static TExprNode FnNode(TExprNodeType::type node_type, const string& name,
+      const string& symbol, PrimitiveType ret_type, PrimitiveType arg_type,
+      int num_children) {
+    TExprNode node;
+    node.node_type = node_type;
+    node.type = ColumnType(ret_type).ToThrift();
+    node.num_children = num_children;
+    TFunction fn;
+    fn.name.function_name = name;
+    fn.binary_type = TFunctionBinaryType::BUILTIN;
+    fn.arg_types.resize(num_children, ColumnType(arg_type).ToThrift());
+    fn.ret_type = node.type;
+    fn.has_var_args = false;
+    fn.__set_scalar_fn(TScalarFunction());
+    fn.scalar_fn.symbol = symbol;
+    node.__set_fn(fn);
+    return node;
+  }
+
+  // Returns '<lhs> <op> <rhs>' for the operators with a builtin in Operators.
+  static TExpr BinaryOp(const string& op, PrimitiveType ret_type,
+      PrimitiveType arg_type, const TExpr& lhs, const TExpr& rhs) {
+    TExpr expr;
+    expr.nodes.push_back(FnNode(TExprNodeType::FUNCTION_CALL, op,
+        OperatorSymbol(Capitalize(op), arg_type),
+        ret_type, arg_type, 2));
+    expr.nodes.insert(expr.nodes.end(), lhs.nodes.begin(), lhs.nodes.end());
+    expr.nodes.insert(expr.nodes.end(), rhs.nodes.begin(), rhs.nodes.end());
+    return expr;
+  }
+
+  // Returns 'lhs AND rhs' or 'lhs OR rhs'.
+  static TExpr Compound(const string& op, const TExpr& lhs, const TExpr& rhs) {
+    TExpr expr;
+    expr.nodes.push_back(
+        FnNode(TExprNodeType::COMPOUND_PRED, op, "", TYPE_BOOLEAN, TYPE_BOOLEAN, 2));
+    expr.nodes.insert(expr.nodes.end(), lhs.nodes.begin(), lhs.nodes.end());
+    expr.nodes.insert(expr.nodes.end(), rhs.nodes.begin(), rhs.nodes.end());
+    return expr;
+  }
+
+  static TExpr Not(const TExpr& child) {
+    TExpr expr;
+    expr.nodes.push_back(FnNode(TExprNodeType::COMPOUND_PRED, "not",
+        "_ZN6impala17CompoundPredicate3NotEPN10impala_udf15FunctionContextERKNS1_"
+        "10BooleanValE", TYPE_BOOLEAN, TYPE_BOOLEAN, 1));
+    expr.nodes.insert(expr.nodes.end(), child.nodes.begin(), child.nodes.end());
+    return expr;
+  }
+
+  static TExpr Cast(PrimitiveType to, PrimitiveType from, const TExpr& child) {
+    TExpr expr;
+    string name = "castTo" + TypeToString(to);
+    expr.nodes.push_back(FnNode(TExprNodeType::FUNCTION_CALL, name,
+        CastSymbol(to, from), to, from, 1));
+    expr.nodes.insert(expr.nodes.end(), child.nodes.begin(), child.nodes.end());
+    return expr;
+  }
+
+  TExpr Slot(PrimitiveType type, bool first) {
+    TExpr expr;
+    expr.nodes.push_back(SlotRefNode(SlotIdx(type, first)));
+    return expr;
+  }
+
+  static string Capitalize(const string& s) {
+    string result = s;
+    result[0] = toupper(result[0]);
+    return result;
+  }
+
+  // Evaluates 'texpr' over the rows of batch_ with both paths and checks that the
+  // results are identical. For predicates, also checks that filtering the column batch
+  // selects exactly the rows for which the row-at-a-time result is true.
+  void TestExpr(const TExpr& texpr) {
+    ExprContext* ctx;
+    ASSERT_TRUE(Expr::CreateExprTree(&pool_, texpr, &ctx).ok());
+    Status status = ctx->Prepare(state_.get(), *row_desc_, &tracker_);
+    ASSERT_TRUE(status.ok()) << status.GetErrorMsg();
+    ASSERT_TRUE(ctx->Open(state_.get()).ok());
+    const string expr_str = ctx->root()->DebugString();
+
+    ColumnBatch column_batch(NUM_ROWS);
+    VectorizedExpr* vexpr =
+        VectorizedExpr::Create(&pool_, state_.get(), ctx, *row_desc_, &column_batch);
+    ASSERT_TRUE(vexpr != NULL) << "not vectorized: " << expr_str;
+    const ColumnType& type = ctx->root()->type();
+
+    column_batch.Gather(batch_.get());
+    ColumnVector* result = vexpr->Eval(&column_batch);
+    for (int i = 0; i < NUM_ROWS; ++i) {
+      void* expected = ctx->GetValue(batch_->GetRow(i));
+      void* actual = result->GetValue(i);
+      if (expected == NULL || actual == NULL) {
+        EXPECT_TRUE(expected == actual) << expr_str << " row " << i;
+      } else if (type.type == TYPE_DOUBLE &&
+          isnan(*reinterpret_cast<double*>(expected))) {
+        EXPECT_TRUE(isnan(*reinterpret_cast<double*>(actual)))
+            << expr_str << " row " << i;
+      } else {
+        EXPECT_TRUE(RawValue::Eq(expected, actual, type)) << expr_str << " row " << i;
+      }
+    }
+
+    if (type.type == TYPE_BOOLEAN) {
+      column_batch.Gather(batch_.get());
+      vexpr->Filter(&column_batch);
+      int num_selected = 0;
+      for (int i = 0; i < NUM_ROWS; ++i) {
+        void* value = ctx->GetValue(batch_->GetRow(i));
+        if (value == NULL || !*reinterpret_cast<bool*>(value)) continue;
+        ASSERT_LT(num_selected, column_batch.num_selected()) << expr_str;
+        EXPECT_EQ(i, column_batch.selection()[num_selected]) << expr_str;
+        ++num_selected;
+      }
+      EXPECT_EQ(num_selected, column_batch.num_selected()) << expr_str;
+    }
+    ctx->Close(state_.get());
+  }
+
+  ObjectPool pool_;
+  MemTracker tracker_;
+  scoped_ptr<RuntimeState> state_;
+  scoped_ptr<RowDescriptor> row_desc_;
+  scoped_ptr<RowBatch> batch_;
+  vector<SlotDescriptor*> slots_;
+};
+
+TEST_F(VectorizedExprTest, SlotRefs) {
+  for (int i = 0; i < NUM_TYPES; ++i) {
+    TestExpr(Slot(TYPES[i], true));
+    TestExpr(Slot(TYPES[i], false));
+  }
+}
+
+TEST_F(VectorizedExprTest, Comparisons) {
+  const char* ops[] = { "eq", "ne", "lt", "le", "gt", "ge" };
+  for (int i = 0; i < NUM_TYPES; ++i) {
+    for (int j = 0; j < 6; ++j) {
+      TestExpr(BinaryOp(ops[j], TYPE_BOOLEAN, TYPES[i], Slot(TYPES[i], true),
+          Slot(TYPES[i], false)));
+    }
+  }
+}
+
+TEST_F(VectorizedExprTest, Arithmetic) {
+  const char* ops[] = { "add", "subtract", "multiply" };
+  for (int i = 0; i < NUM_TYPES; ++i) {
+    PrimitiveType type = TYPES[i];
+    if (type == TYPE_BOOLEAN || type == TYPE_STRING) continue;
+    for (int j = 0; j < 3; ++j) {
+      TestExpr(BinaryOp(ops[j], type, type, Slot(type, true), Slot(type, false)));
+    }
+  }
+  // The divisor is 0 in some rows, which gives infinity or NaN.
+  TestExpr(BinaryOp("divide", TYPE_DOUBLE, TYPE_DOUBLE, Slot(TYPE_DOUBLE, true),
+      Slot(TYPE_DOUBLE, false)));
+  TestExpr(BinaryOp("divide", TYPE_DOUBLE, TYPE_DOUBLE, Slot(TYPE_DOUBLE, true),
+      Slot(TYPE_DOUBLE, true)));
+}
+
+TEST_F(VectorizedExprTest, Casts) {
+  for (int i = 0; i < NUM_TYPES; ++i) {
+    PrimitiveType from = TYPES[i];
+    if (from == TYPE_BOOLEAN || from == TYPE_STRING) continue;
+    for (int j = 0; j < NUM_TYPES; ++j) {
+      PrimitiveType to = TYPES[j];
+      if (to == from || to == TYPE_STRING) continue;
+      TestExpr(Cast(to, from, Slot(from, true)));
+    }
+  }
+}
+
+TEST_F(VectorizedExprTest, Constants) {
+  TExpr literal;
+  literal.nodes.push_back(IntLiteralNode(TYPE_INT, 10007));
+  TestExpr(BinaryOp("add", TYPE_INT, TYPE_INT, Slot(TYPE_INT, true), literal));
+  TestExpr(BinaryOp("lt", TYPE_BOOLEAN, TYPE_INT, literal, Slot(TYPE_INT, false)));
+}
+
+TEST_F(VectorizedExprTest, CompoundPredicates) {
+  // Both operands are NULL in some rows, and each is NULL while the other is true or
+  // false in others.
+  TExpr b1 = Slot(TYPE_BOOLEAN, true);
+  TExpr b2 = Slot(TYPE_BOOLEAN, false);
+  TestExpr(Compound("and", b1, b2));
+  TestExpr(Compound("or", b1, b2));
+  TestExpr(Not(b1));
+  TestExpr(Not(Compound("and", b1, b2)));
+
+  TExpr lt = BinaryOp("lt", TYPE_BOOLEAN, TYPE_INT, Slot(TYPE_INT, true),
+      Slot(TYPE_INT, false));
+  TExpr ne = BinaryOp("ne", TYPE_BOOLEAN, TYPE_STRING, Slot(TYPE_STRING, true),
+      Slot(TYPE_STRING, false));
+  TestExpr(Compound("or", Compound("and", lt, ne), Not(b2)));
+  TestExpr(Compound("and", Compound("or", lt, b1), Compound("or", ne, Not(b2))));
+}
+
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  InitCommonRuntime(argc, argv, false, TestInfo::BE_TEST);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,458 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exprs/vectorized-expr.h"
+
+#include <string>
+#include <boost/algorithm/string.hpp>
+
+#include "common/object-pool.h"
+#include "exprs/compound-predicates.h"
+#include "exprs/expr.h"
+#include "exprs/expr-context.h"
+#include "exprs/slot-ref.h"
+#include "runtime/descriptors.h"
+#include "runtime/runtime-state.h"
+#include "runtime/string-value.inline.h"
+
+#include "gen-cpp/Types_types.h"
+
+using namespace boost;
+using namespace boost::algorithm;
+using namespace impala;
+using namespace std;
+
+namespace impala {
+
+// The values of the selected rows of a slot, read from the batch.
+class VectorizedSlotRef : public VectorizedExpr {
+ public:
+  VectorizedSlotRef(ColumnVector* column)
+    : VectorizedExpr(column->type()), column_(column) { }
+
+  virtual ColumnVector* Eval(ColumnBatch* batch) { return column_; }
+
+ private:
+  ColumnVector* column_;
+};
+
+// A constant subtree, evaluated once with the row-at-a-time path on the first call
+// to Eval().
+class VectorizedConstant : public VectorizedExpr {
+ public:
+  VectorizedConstant(ExprContext* ctx, Expr* expr, int capacity)
+    : VectorizedExpr(expr->type()), ctx_(ctx), expr_(expr),
+      result_(expr->type(), capacity), evaluated_(false) { }
+
+  virtual ColumnVector* Eval(ColumnBatch* batch) {
+    if (!evaluated_) {
+      void* value = ctx_->GetValue(expr_, NULL);
+      if (value != NULL && type_.IsStringType()) {
+        // The result may live in memory owned by 'ctx_' that is freed before this expr,
+        // so keep a copy of the string data.
+        const StringValue* sv = reinterpret_cast<const StringValue*>(value);
+        data_.assign(sv->ptr, sv->len);
+        string_value_ = StringValue(const_cast<char*>(data_.data()), data_.size());
+        value = &string_value_;
+      }
+      result_.Fill(value);
+      evaluated_ = true;
+    }
+    return &result_;
+  }
+
+ private:
+  ExprContext* ctx_;
+  Expr* expr_;
+  ColumnVector result_;
+  bool evaluated_;
+  string data_;
+  StringValue string_value_;
+};
+
+// Base class of the nodes that compute a new value for each selected row.
+class VectorizedFunction : public VectorizedExpr {
+ public:
+  VectorizedFunction(const ColumnType& type, int capacity)
+    : VectorizedExpr(type), result_(type, capacity) { }
+
+ protected:
+  ColumnVector result_;
+};
+
+template <typename FROM, typename TO>
+class VectorizedCast : public VectorizedFunction {
+ public:
+  VectorizedCast(const ColumnType& type, VectorizedExpr* child, int capacity)
+    : VectorizedFunction(type, capacity), child_(child) { }
+
+  virtual ColumnVector* Eval(ColumnBatch* batch) {
+    ColumnVector* in = child_->Eval(batch);
+    const FROM* in_values = in->values<FROM>();
+    const bool* in_nulls = in->nulls();
+    TO* values = result_.values<TO>();
+    bool* nulls = result_.nulls();
+    const int* selection = batch->selection();
+    for (int j = 0; j < batch->num_selected(); ++j) {
+      int i = selection[j];
+      nulls[i] = in_nulls[i];
+      if (!nulls[i]) values[i] = static_cast<TO>(in_values[i]);
+    }
+    return &result_;
+  }
+
+ private:
+  VectorizedExpr* child_;
+};
+
+// Computes OP::Apply() of the values of the children, or NULL if either is NULL. Null
+// values are not passed to OP, since e.g. their StringValues are not valid.
+template <typename T, typename RESULT, typename OP>
+class VectorizedBinaryOp : public VectorizedFunction {
+ public:
+  VectorizedBinaryOp(const ColumnType& type, VectorizedExpr* left,
+      VectorizedExpr* right, int capacity)
+    : VectorizedFunction(type, capacity), left_(left), right_(right) { }
+
+  virtual ColumnVector* Eval(ColumnBatch* batch) {
+    ColumnVector* left = left_->Eval(batch);
+    ColumnVector* right = right_->Eval(batch);
+    const T* left_values = left->values<T>();
+    const T* right_values = right->values<T>();
+    const bool* left_nulls = left->nulls();
+    const bool* right_nulls = right->nulls();
+    RESULT* values = result_.values<RESULT>();
+    bool* nulls = result_.nulls();
+    const int* selection = batch->selection();
+    for (int j = 0; j < batch->num_selected(); ++j) {
+      int i = selection[j];
+      nulls[i] = left_nulls[i] | right_nulls[i];
+      if (!nulls[i]) values[i] = OP::Apply(left_values[i], right_values[i]);
+    }
+    return &result_;
+  }
+
+ private:
+  VectorizedExpr* left_;
+  VectorizedExpr* right_;
+};
+
+struct AddOp {
+  template <typename T> static T Apply(T a, T b) { return a + b; }
+};
+struct SubtractOp {
+  template <typename T> static T Apply(T a, T b) { return a - b; }
+};
+struct MultiplyOp {
+  template <typename T> static T Apply(T a, T b) { return a * b; }
+};
+struct DivideOp {
+  template <typename T> static T Apply(T a, T b) { return a / b; }
+};
+struct EqOp {
+  template <typename T> static bool Apply(const T& a, const T& b) { return a == b; }
+};
+struct NeOp {
+  template <typename T> static bool Apply(const T& a, const T& b) { return a != b; }
+};
+struct LtOp {
+  template <typename T> static bool Apply(const T& a, const T& b) { return a < b; }
+};
+struct LeOp {
+  template <typename T> static bool Apply(const T& a, const T& b) { return a <= b; }
+};
+struct GtOp {
+  template <typename T> static bool Apply(const T& a, const T& b) { return a > b; }
+};
+struct GeOp {
+  template <typename T> static bool Apply(const T& a, const T& b) { return a >= b; }
+};
+
+// AND and OR with SQL's three-valued logic, e.g. false AND NULL is false.
+template <bool IS_AND>
+class VectorizedCompoundPredicate : public VectorizedFunction {
+ public:
+  VectorizedCompoundPredicate(VectorizedExpr* left, VectorizedExpr* right, int capacity)
+    : VectorizedFunction(TYPE_BOOLEAN, capacity), left_(left), right_(right) { }
+
+  virtual ColumnVector* Eval(ColumnBatch* batch) {
+    ColumnVector* left = left_->Eval(batch);
+    ColumnVector* right = right_->Eval(batch);
+    const bool* left_values = left->values<bool>();
+    const bool* right_values = right->values<bool>();
+    const bool* left_nulls = left->nulls();
+    const bool* right_nulls = right->nulls();
+    bool* values = result_.values<bool>();
+    bool* nulls = result_.nulls();
+    const int* selection = batch->selection();
+    for (int j = 0; j < batch->num_selected(); ++j) {
+      int i = selection[j];
+      // The value that decides the result regardless of the other operand.
+      bool left_decides = !left_nulls[i] && left_values[i] != IS_AND;
+      bool right_decides = !right_nulls[i] && right_values[i] != IS_AND;
+      if (left_decides || right_decides) {
+        nulls[i] = false;
+        values[i] = !IS_AND;
+      } else {
+        nulls[i] = left_nulls[i] | right_nulls[i];
+        values[i] = IS_AND;
+      }
+    }
+    return &result_;
+  }
+
+  // A conjunction filters with each operand in turn, so that the right operand is only
+  // evaluated over the rows that pass the left one.
+  virtual void Filter(ColumnBatch* batch) {
+    if (!IS_AND) {
+      VectorizedExpr::Filter(batch);
+      return;
+    }
+    left_->Filter(batch);
+    if (batch->num_selected() > 0) right_->Filter(batch);
+  }
+
+ private:
+  VectorizedExpr* left_;
+  VectorizedExpr* right_;
+};
+
+class VectorizedNot : public VectorizedFunction {
+ public:
+  VectorizedNot(VectorizedExpr* child, int capacity)
+    : VectorizedFunction(TYPE_BOOLEAN, capacity), child_(child) { }
+
+  virtual ColumnVector* Eval(ColumnBatch* batch) {
+    ColumnVector* in = child_->Eval(batch);
+    const bool* in_values = in->values<bool>();
+    const bool* in_nulls = in->nulls();
+    bool* values = result_.values<bool>();
+    bool* nulls = result_.nulls();
+    const int* selection = batch->selection();
+    for (int j = 0; j < batch->num_selected(); ++j) {
+      int i = selection[j];
+      nulls[i] = in_nulls[i];
+      values[i] = !in_values[i];
+    }
+    return &result_;
+  }
+
+ private:
+  VectorizedExpr* child_;
+};
+
+}
+
+void VectorizedExpr::Filter(ColumnBatch* batch) {
+  DCHECK_EQ(type_.type, TYPE_BOOLEAN);
+  ColumnVector* result = Eval(batch);
+  const bool* values = result->values<bool>();
+  const bool* nulls = result->nulls();
+  int* selection = batch->selection();
+  int num_selected = 0;
+  for (int j = 0; j < batch->num_selected(); ++j) {
+    int i = selection[j];
+    selection[num_selected] = i;
+    num_selected += !nulls[i] & values[i];
+  }
+  batch->set_num_selected(num_selected);
+}
+
+VectorizedExpr* VectorizedExpr::Create(ObjectPool* pool, RuntimeState* state,
+    ExprContext* ctx, const RowDescriptor& row_desc, ColumnBatch* batch) {
+  return CreateNode(pool, state, ctx, ctx->root(), row_desc, batch);
+}
+
+bool VectorizedExpr::Create(ObjectPool* pool, RuntimeState* state,
+    const vector<ExprContext*>& ctxs, const RowDescriptor& row_desc,
+    ColumnBatch* batch, vector<VectorizedExpr*>* exprs) {
+  exprs->clear();
+  for (int i = 0; i < ctxs.size(); ++i) {
+    VectorizedExpr* expr = Create(pool, state, ctxs[i], row_desc, batch);
+    if (expr == NULL) {
+      exprs->clear();
+      return false;
+    }
+    exprs->push_back(expr);
+  }
+  return true;
+}
+
+namespace {
+
+// Returns a new node computing OP over children of type 'child_type'.
+template <typename OP>
+VectorizedExpr* CreateComparison(const ColumnType& child_type, VectorizedExpr* left,
+    VectorizedExpr* right, int capacity) {
+  ColumnType type(TYPE_BOOLEAN);
+  switch (child_type.type) {
+    case TYPE_BOOLEAN:
+      return new VectorizedBinaryOp<bool, bool, OP>(type, left, right, capacity);
+    case TYPE_TINYINT:
+      return new VectorizedBinaryOp<int8_t, bool, OP>(type, left, right, capacity);
+    case TYPE_SMALLINT:
+      return new VectorizedBinaryOp<int16_t, bool, OP>(type, left, right, capacity);
+    case TYPE_INT:
+      return new VectorizedBinaryOp<int32_t, bool, OP>(type, left, right, capacity);
+    case TYPE_BIGINT:
+      return new VectorizedBinaryOp<int64_t, bool, OP>(type, left, right, capacity);
+    case TYPE_FLOAT:
+      return new VectorizedBinaryOp<float, bool, OP>(type, left, right, capacity);
+    case TYPE_DOUBLE:
+      return new VectorizedBinaryOp<double, bool, OP>(type, left, right, capacity);
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      return new VectorizedBinaryOp<StringValue, bool, OP>(type, left, right, capacity);
+    default:
+      return NULL;
+  }
+}
+
+template <typename OP>
+VectorizedExpr* CreateArithmetic(const ColumnType& type, VectorizedExpr* left,
+    VectorizedExpr* right, int capacity) {
+  switch (type.type) {
+    case TYPE_TINYINT:
+      return new VectorizedBinaryOp<int8_t, int8_t, OP>(type, left, right, capacity);
+    case TYPE_SMALLINT:
+      return new VectorizedBinaryOp<int16_t, int16_t, OP>(type, left, right, capacity);
+    case TYPE_INT:
+      return new VectorizedBinaryOp<int32_t, int32_t, OP>(type, left, right, capacity);
+    case TYPE_BIGINT:
+      return new VectorizedBinaryOp<int64_t, int64_t, OP>(type, left, right, capacity);
+    case TYPE_FLOAT:
+      return new VectorizedBinaryOp<float, float, OP>(type, left, right, capacity);
+    case TYPE_DOUBLE:
+      return new VectorizedBinaryOp<double, double, OP>(type, left, right, capacity);
+    default:
+      return NULL;
+  }
+}
+
+template <typename FROM>
+VectorizedExpr* CreateCastFrom(const ColumnType& type, VectorizedExpr* child,
+    int capacity) {
+  switch (type.type) {
+    case TYPE_BOOLEAN:
+      return new VectorizedCast<FROM, bool>(type, child, capacity);
+    case TYPE_TINYINT:
+      return new VectorizedCast<FROM, int8_t>(type, child, capacity);
+    case TYPE_SMALLINT:
+      return new VectorizedCast<FROM, int16_t>(type, child, capacity);
+    case TYPE_INT:
+      return new VectorizedCast<FROM, int32_t>(type, child, capacity);
+    case TYPE_BIGINT:
+      return new VectorizedCast<FROM, int64_t>(type, child, capacity);
+    case TYPE_FLOAT:
+      return new VectorizedCast<FROM, float>(type, child, capacity);
+    case TYPE_DOUBLE:
+      return new VectorizedCast<FROM, double>(type, child, capacity);
+    default:
+      return NULL;
+  }
+}
+
+// Casts between the numeric types and from them to BOOLEAN, which match the builtin
+// cast functions.
+VectorizedExpr* CreateCast(const ColumnType& type, VectorizedExpr* child,
+    int capacity) {
+  if (type.type == child->type().type) return child;
+  switch (child->type().type) {
+    case TYPE_TINYINT: return CreateCastFrom<int8_t>(type, child, capacity);
+    case TYPE_SMALLINT: return CreateCastFrom<int16_t>(type, child, capacity);
+    case TYPE_INT: return CreateCastFrom<int32_t>(type, child, capacity);
+    case TYPE_BIGINT: return CreateCastFrom<int64_t>(type, child, capacity);
+    case TYPE_FLOAT: return CreateCastFrom<float>(type, child, capacity);
+    case TYPE_DOUBLE: return CreateCastFrom<double>(type, child, capacity);
+    default: return NULL;
+  }
+}
+
+}
+
+VectorizedExpr* VectorizedExpr::CreateNode(ObjectPool* pool, RuntimeState* state,
+    ExprContext* ctx, Expr* expr, const RowDescriptor& row_desc, ColumnBatch* batch) {
+  const ColumnType& type = expr->type();
+  if (!ColumnVector::IsSupportedType(type)) return NULL;
+  const int capacity = batch->capacity();
+
+  if (expr->is_slotref()) {
+    const SlotRef* slot_ref = static_cast<const SlotRef*>(expr);
+    const SlotDescriptor* slot_desc =
+        state->desc_tbl().GetSlotDescriptor(slot_ref->slot_id());
+    if (slot_desc == NULL || slot_desc->type() != type) return NULL;
+    int tuple_idx = row_desc.GetTupleIdx(slot_desc->parent());
+    if (tuple_idx == RowDescriptor::INVALID_IDX) return NULL;
+    return pool->Add(new VectorizedSlotRef(batch->AddColumn(slot_desc, tuple_idx)));
+  }
+  if (expr->IsConstant()) return pool->Add(new VectorizedConstant(ctx, expr, capacity));
+
+  vector<VectorizedExpr*> children;
+  for (int i = 0; i < expr->GetNumChildren(); ++i) {
+    VectorizedExpr* child =
+        CreateNode(pool, state, ctx, expr->GetChild(i), row_desc, batch);
+    if (child == NULL) return NULL;
+    children.push_back(child);
+  }
+
+  VectorizedExpr* result = NULL;
+  if (dynamic_cast<AndPredicate*>(expr) != NULL) {
+    result = new VectorizedCompoundPredicate<true>(children[0], children[1], capacity);
+  } else if (dynamic_cast<OrPredicate*>(expr) != NULL) {
+    result = new VectorizedCompoundPredicate<false>(children[0], children[1], capacity);
+  } else if (expr->fn_.binary_type != TFunctionBinaryType::BUILTIN) {
+    // Only builtins have known semantics.
+    return NULL;
+  } else {
+    const string fn_name = to_lower_copy(expr->fn_name());
+    if (fn_name == "not" && children.size() == 1) {
+      result = new VectorizedNot(children[0], capacity);
+    } else if (starts_with(fn_name, "castto") && children.size() == 1) {
+      result = CreateCast(type, children[0], capacity);
+      // A no-op cast is its child.
+      if (result == children[0]) return result;
+    } else if (children.size() == 2 && children[0]->type() == children[1]->type()) {
+      VectorizedExpr* left = children[0];
+      VectorizedExpr* right = children[1];
+      const ColumnType& child_type = left->type();
+      if (type.type == TYPE_BOOLEAN) {
+        if (fn_name == "eq") {
+          result = CreateComparison<EqOp>(child_type, left, right, capacity);
+        } else if (fn_name == "ne") {
+          result = CreateComparison<NeOp>(child_type, left, right, capacity);
+        } else if (fn_name == "lt") {
+          result = CreateComparison<LtOp>(child_type, left, right, capacity);
+        } else if (fn_name == "le") {
+          result = CreateComparison<LeOp>(child_type, left, right, capacity);
+        } else if (fn_name == "gt") {
+          result = CreateComparison<GtOp>(child_type, left, right, capacity);
+        } else if (fn_name == "ge") {
+          result = CreateComparison<GeOp>(child_type, left, right, capacity);
+        }
+      } else if (child_type == type) {
+        if (fn_name == "add") {
+          result = CreateArithmetic<AddOp>(type, left, right, capacity);
+        } else if (fn_name == "subtract") {
+          result = CreateArithmetic<SubtractOp>(type, left, right, capacity);
+        } else if (fn_name == "multiply") {
+          result = CreateArithmetic<MultiplyOp>(type, left, right, capacity);
+        } else if (fn_name == "divide" && type.type == TYPE_DOUBLE) {
+          // Integer division is int_divide(), which returns NULL for a zero divisor.
+          result = CreateArithmetic<DivideOp>(type, left, right, capacity);
+        }
+      }
+    }
+  }
+  return result == NULL ? NULL : pool->Add(result);
+}
@@ -0,0 +1,87 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_EXPRS_VECTORIZED_EXPR_H
+#define IMPALA_EXPRS_VECTORIZED_EXPR_H
+
+#include <vector>
+
+#include "runtime/column-batch.h"
+#include "runtime/types.h"
+
+namespace impala {
+
+class Expr;
+class ExprContext;
+class ObjectPool;
+class RowDescriptor;
+class RuntimeState;
+
+// An expr tree that is evaluated a column at a time over the selected rows of a
+// ColumnBatch, rather than a row at a time like Expr. Each node runs one tight loop per
+// batch over the column vectors of its children, which avoids the virtual call per row
+// and node of the interpreted path and lets the compiler vectorize the loops.
+// Only a subset of exprs is supported: slot refs, constant subtrees, numeric casts,
+// arithmetic, comparisons of numeric, bool and string values, and AND/OR/NOT, all over
+// the types supported by ColumnVector. The results are the same as the row-at-a-time
+// path's, including the handling of NULLs.
+class VectorizedExpr {
+ public:
+  virtual ~VectorizedExpr() { }
+
+  // Creates the vectorized form of the expr tree of 'ctx', or returns NULL if the tree
+  // contains unsupported exprs. The slots the tree references are added to 'batch',
+  // which the tree must always be evaluated over. The nodes are owned by 'pool'.
+  // 'ctx' must have been opened before the tree is evaluated.
+  static VectorizedExpr* Create(ObjectPool* pool, RuntimeState* state,
+      ExprContext* ctx, const RowDescriptor& row_desc, ColumnBatch* batch);
+
+  // Creates the vectorized form of each of 'ctxs' in 'exprs'. Returns false if any of
+  // them is not supported, in which case 'exprs' is cleared.
+  static bool Create(ObjectPool* pool, RuntimeState* state,
+      const std::vector<ExprContext*>& ctxs, const RowDescriptor& row_desc,
+      ColumnBatch* batch, std::vector<VectorizedExpr*>* exprs);
+
+  // Evaluates the expr over the selected rows of 'batch'. The result of the row at
+  // index i of the batch is at index i of the returned vector, which is owned by this
+  // expr (or by 'batch' for slot refs) and valid until the next call.
+  virtual ColumnVector* Eval(ColumnBatch* batch) = 0;
+
+  // Narrows the selection of 'batch' to the rows for which this boolean expr is true.
+  virtual void Filter(ColumnBatch* batch);
+
+  // Narrows the selection of 'batch' to the rows for which all 'conjuncts' are true.
+  static void EvalConjuncts(const std::vector<VectorizedExpr*>& conjuncts,
+      ColumnBatch* batch) {
+    for (int i = 0; i < conjuncts.size() && batch->num_selected() > 0; ++i) {
+      conjuncts[i]->Filter(batch);
+    }
+  }
+
+  const ColumnType& type() const { return type_; }
+
+ protected:
+  VectorizedExpr(const ColumnType& type) : type_(type) { }
+
+  const ColumnType type_;
+
+ private:
+  static VectorizedExpr* CreateNode(ObjectPool* pool, RuntimeState* state,
+      ExprContext* ctx, Expr* expr, const RowDescriptor& row_desc, ColumnBatch* batch);
+};
+
+}
+
+#endif
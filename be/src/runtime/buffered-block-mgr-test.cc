@@ -45,7 +45,12 @@ using namespace std;
 // FLAGS_scratch_dirs + TmpFileMgr::TMP_SUB_DIR_NAME.
 const string SCRATCH_DIR = "/tmp/impala-scratch";
 
+// Bytes queued to a scratch device to make it look busy.
+const int64_t BUSY_DEVICE_BYTES = 1L << 40;
+
 DECLARE_bool(disk_spill_encryption);
+DECLARE_string(disk_spill_compression_codec);
+DECLARE_int32(scratch_device_blacklist_timeout_s);
 
 namespace impala {
 
@@ -61,6 +66,9 @@ class BufferedBlockMgrTest : public ::testing::Test {
     exec_env_->disk_io_mgr()->Init(io_mgr_tracker_.get());
     runtime_state_.reset(
         new RuntimeState(TPlanFragmentInstanceCtx(), "", exec_env_.get()));
+    // Resets the state of the scratch device, so that no test sees the load or the
+    // blacklisting left behind by another.
+    InitTmpFileMgr(1);
   }
 
   virtual void TearDown() {
@@ -110,6 +118,43 @@ class BufferedBlockMgrTest : public ::testing::Test {
     }
   }
 
+  // Creates 'num_devices' scratch devices, which all are on the disk of /tmp. The first
+  // one is the default SCRATCH_DIR.
+  void InitTmpFileMgr(int num_devices) {
+    vector<string> tmp_dirs(1, "/tmp");
+    for (int i = 1; i < num_devices; ++i) {
+      stringstream tmp_dir;
+      tmp_dir << "/tmp/buffered-block-mgr-test-scratch" << i;
+      create_directories(tmp_dir.str());
+      tmp_dirs.push_back(tmp_dir.str());
+    }
+    Status status = TmpFileMgr::InitCustom(tmp_dirs, false);
+    ASSERT_TRUE(status.ok()) << status.GetErrorMsg();
+    ASSERT_EQ(TmpFileMgr::num_tmp_devices(), num_devices);
+    scratch_dirs_.clear();
+    for (int i = 0; i < num_devices; ++i) {
+      scratch_dirs_.push_back(tmp_dirs[i] + "/impala-scratch");
+    }
+  }
+
+  static int NumFiles(const string& dir) {
+    int num_files = 0;
+    for (directory_iterator it(dir); it != directory_iterator(); ++it) ++num_files;
+    return num_files;
+  }
+
+  // Waits until 'num_writes' writes were issued by the block manager and none is
+  // outstanding anymore.
+  static void WaitForWrites(BufferedBlockMgr* block_mgr, int num_writes) {
+    RuntimeProfile::Counter* writes_issued =
+        block_mgr->profile()->GetCounter("BlockWritesIssued");
+    RuntimeProfile::Counter* writes_outstanding =
+        block_mgr->profile()->GetCounter("BlockWritesOutstanding");
+    while (writes_issued->value() < num_writes || writes_outstanding->value() > 0) {
+      SleepForMs(10);
+    }
+  }
+
   shared_ptr<BufferedBlockMgr> CreateMgr(int max_buffers) {
     shared_ptr<BufferedBlockMgr> mgr;
     BufferedBlockMgr::Create(runtime_state_.get(),
@@ -137,7 +182,8 @@ class BufferedBlockMgrTest : public ::testing::Test {
 
   // Test that randomly issues GetFreeBlock(), Pin(), Unpin(), Delete() and Close()
   // calls. All calls made are legal - error conditions are not expected until the
-  // first call to Close().  This is called 2 times with encryption+integrity on/off
+  // first call to Close().  This is called with encryption+integrity and compression
+  // on/off
   void TestRandomInternal() {
     const int num_buffers = 10;
     const int num_iterations = 100000;
@@ -262,6 +308,9 @@ class BufferedBlockMgrTest : public ::testing::Test {
   scoped_ptr<RuntimeState> runtime_state_;
   scoped_ptr<MemTracker> block_mgr_parent_tracker_;
   scoped_ptr<MemTracker> io_mgr_tracker_;
+
+  // The directories of the scratch devices created by InitTmpFileMgr().
+  vector<string> scratch_dirs_;
 };
 
 TEST_F(BufferedBlockMgrTest, GetNewBlock) {
@@ -471,6 +520,242 @@ TEST_F(BufferedBlockMgrTest, Eviction) {
   EXPECT_TRUE(block_mgr_parent_tracker_->consumption() == 0);
 }
 
+// Test that spilled blocks are compressed and read back correctly, including blocks
+// whose data no longer compresses when they are written again.
+TEST_F(BufferedBlockMgrTest, Compression) {
+  FLAGS_disk_spill_encryption = false;
+  FLAGS_disk_spill_compression_codec = "lz4";
+  int max_num_buffers = 2;
+  int num_blocks = 4;
+  shared_ptr<BufferedBlockMgr> block_mgr = CreateMgr(max_num_buffers);
+  BufferedBlockMgr::Client* client;
+  Status status = block_mgr->RegisterClient(0, NULL, runtime_state_.get(), &client);
+  EXPECT_TRUE(status.ok());
+  RuntimeProfile* profile = block_mgr->profile();
+  RuntimeProfile::Counter* uncompressed_bytes_written =
+      profile->GetCounter("UncompressedBytesWritten");
+  RuntimeProfile::Counter* bytes_written = profile->GetCounter("BytesWritten");
+
+  // Fill the blocks with compressible data and unpin them.
+  vector<BufferedBlockMgr::Block*> blocks;
+  for (int i = 0; i < num_blocks; ++i) {
+    BufferedBlockMgr::Block* block;
+    status = block_mgr->GetNewBlock(client, NULL, &block);
+    EXPECT_TRUE(status.ok());
+    ASSERT_TRUE(block != NULL);
+    uint8_t* data = block->Allocate<uint8_t>(block_size_);
+    for (int j = 0; j < block_size_; ++j) data[j] = (i + j / 16) % 7;
+    blocks.push_back(block);
+    EXPECT_TRUE(block->Unpin().ok());
+  }
+
+  // Make the first block incompressible.
+  bool pinned;
+  EXPECT_TRUE(blocks[0]->Pin(&pinned).ok());
+  EXPECT_TRUE(pinned);
+  for (int j = 0; j < block_size_; ++j) blocks[0]->buffer()[j] = rand();
+  vector<uint8_t> random_data(blocks[0]->buffer(), blocks[0]->buffer() + block_size_);
+  EXPECT_TRUE(blocks[0]->Unpin().ok());
+
+  // Pin the blocks in turn, which evicts the others.
+  for (int k = 0; k < 2; ++k) {
+    for (int i = 0; i < num_blocks; ++i) {
+      EXPECT_TRUE(blocks[i]->Pin(&pinned).ok());
+      EXPECT_TRUE(pinned);
+      EXPECT_EQ(blocks[i]->valid_data_len(), block_size_);
+      for (int j = 0; j < block_size_; ++j) {
+        uint8_t expected = i == 0 ? random_data[j] : (i + j / 16) % 7;
+        ASSERT_EQ(blocks[i]->buffer()[j], expected) << i << " " << j;
+      }
+      EXPECT_TRUE(blocks[i]->Unpin().ok());
+    }
+  }
+  EXPECT_GT(uncompressed_bytes_written->value(), 0);
+  EXPECT_LT(bytes_written->value(), uncompressed_bytes_written->value());
+
+  block_mgr.reset();
+  EXPECT_TRUE(block_mgr_parent_tracker_->consumption() == 0);
+}
+
+// Test that compressed blocks are written to extents of their compressed length, and
+// that a block that outgrows its extent leaves it to other blocks.
+TEST_F(BufferedBlockMgrTest, CompressedExtents) {
+  FLAGS_disk_spill_encryption = false;
+  FLAGS_disk_spill_compression_codec = "lz4";
+  int max_num_buffers = 2;
+  shared_ptr<BufferedBlockMgr> block_mgr = CreateMgr(max_num_buffers);
+  BufferedBlockMgr::Client* client;
+  Status status = block_mgr->RegisterClient(0, NULL, runtime_state_.get(), &client);
+  EXPECT_TRUE(status.ok());
+  RuntimeProfile::Counter* bytes_written =
+      block_mgr->profile()->GetCounter("BytesWritten");
+  RuntimeProfile::Counter* scratch_bytes =
+      block_mgr->profile()->GetCounter("ScratchBytesAllocated");
+
+  // Both blocks hold the same compressible data.
+  vector<BufferedBlockMgr::Block*> blocks;
+  for (int i = 0; i < max_num_buffers; ++i) {
+    BufferedBlockMgr::Block* block;
+    status = block_mgr->GetNewBlock(client, NULL, &block);
+    EXPECT_TRUE(status.ok());
+    ASSERT_TRUE(block != NULL);
+    uint8_t* data = block->Allocate<uint8_t>(block_size_);
+    for (int j = 0; j < block_size_; ++j) data[j] = (j / 16) % 7;
+    blocks.push_back(block);
+  }
+
+  // No buffer is free, so unpinning a block writes it.
+  EXPECT_TRUE(blocks[0]->Unpin().ok());
+  WaitForWrites(block_mgr.get(), 1);
+  int64_t compressed_len = bytes_written->value();
+  EXPECT_GT(compressed_len, 0);
+  EXPECT_LT(compressed_len, block_size_);
+  EXPECT_EQ(scratch_bytes->value(), compressed_len);
+
+  // The first block no longer compresses. It needs a new extent.
+  bool pinned;
+  EXPECT_TRUE(blocks[0]->Pin(&pinned).ok());
+  EXPECT_TRUE(pinned);
+  for (int j = 0; j < block_size_; ++j) blocks[0]->buffer()[j] = rand();
+  vector<uint8_t> random_data(blocks[0]->buffer(), blocks[0]->buffer() + block_size_);
+  EXPECT_TRUE(blocks[0]->Unpin().ok());
+  WaitForWrites(block_mgr.get(), 2);
+  EXPECT_EQ(scratch_bytes->value(), compressed_len + block_size_);
+
+  // The second block is written to the extent the first one left.
+  EXPECT_TRUE(blocks[1]->Unpin().ok());
+  WaitForWrites(block_mgr.get(), 3);
+  EXPECT_EQ(bytes_written->value(), 2 * compressed_len + block_size_);
+  EXPECT_EQ(scratch_bytes->value(), compressed_len + block_size_);
+
+  // Take the buffers of both blocks, then read them back.
+  vector<BufferedBlockMgr::Block*> new_blocks;
+  AllocateBlocks(block_mgr.get(), client, max_num_buffers, &new_blocks);
+  for (int i = 0; i < max_num_buffers; ++i) {
+    EXPECT_TRUE(new_blocks[i]->Delete().ok());
+  }
+  for (int i = 0; i < max_num_buffers; ++i) {
+    EXPECT_TRUE(blocks[i]->Pin(&pinned).ok());
+    EXPECT_TRUE(pinned);
+    EXPECT_EQ(blocks[i]->valid_data_len(), block_size_);
+    for (int j = 0; j < block_size_; ++j) {
+      uint8_t expected = i == 0 ? random_data[j] : (j / 16) % 7;
+      ASSERT_EQ(blocks[i]->buffer()[j], expected) << i << " " << j;
+    }
+  }
+
+  block_mgr.reset();
+  EXPECT_TRUE(block_mgr_parent_tracker_->consumption() == 0);
+}
+
+// Test that blocks are not spilled to a blacklisted scratch device, and are again once
+// the device's blacklisting times out.
+TEST_F(BufferedBlockMgrTest, BlacklistedScratchDevice) {
+  int32_t blacklist_timeout_s = FLAGS_scratch_device_blacklist_timeout_s;
+  for (int i = 0; i < 2; ++i) {
+    // The second time, the device is blacklisted with a timeout that has already
+    // expired, rather than waiting for the first one to.
+    FLAGS_scratch_device_blacklist_timeout_s = i == 0 ? 3600 : 0;
+    TmpFileMgr::BlacklistDevice(0, Status("Blacklisted by test"));
+    EXPECT_EQ(TmpFileMgr::IsBlacklisted(0), i == 0);
+
+    int max_num_buffers = 2;
+    shared_ptr<BufferedBlockMgr> block_mgr = CreateMgr(max_num_buffers);
+    BufferedBlockMgr::Client* client;
+    Status status = block_mgr->RegisterClient(0, NULL, runtime_state_.get(), &client);
+    EXPECT_TRUE(status.ok());
+    vector<BufferedBlockMgr::Block*> blocks;
+    AllocateBlocks(block_mgr.get(), client, max_num_buffers, &blocks);
+    // Unpinning a block starts writing it.
+    status = blocks[0]->Unpin();
+    EXPECT_EQ(status.ok(), i == 1);
+    block_mgr.reset();
+    EXPECT_TRUE(block_mgr_parent_tracker_->consumption() == 0);
+  }
+  FLAGS_scratch_device_blacklist_timeout_s = blacklist_timeout_s;
+}
+
+// Test that blocks are spilled to the scratch device that is expected to write them
+// first, i.e. not to one that has a long write queue.
+TEST_F(BufferedBlockMgrTest, LeastLoadedScratchDevice) {
+  InitTmpFileMgr(2);
+  for (int busy_device = 0; busy_device < 2; ++busy_device) {
+    TmpFileMgr::WriteStarted(busy_device, BUSY_DEVICE_BYTES);
+    int max_num_buffers = 4;
+    shared_ptr<BufferedBlockMgr> block_mgr = CreateMgr(max_num_buffers);
+    BufferedBlockMgr::Client* client;
+    Status status = block_mgr->RegisterClient(0, NULL, runtime_state_.get(), &client);
+    EXPECT_TRUE(status.ok());
+    vector<BufferedBlockMgr::Block*> blocks;
+    AllocateBlocks(block_mgr.get(), client, max_num_buffers, &blocks);
+    for (int i = 0; i < max_num_buffers; ++i) {
+      EXPECT_TRUE(blocks[i]->Unpin().ok());
+    }
+    WaitForWrites(block_mgr.get(), max_num_buffers);
+    // Scratch files are created when the first block is placed on their device.
+    EXPECT_EQ(NumFiles(scratch_dirs_[busy_device]), 0);
+    EXPECT_EQ(NumFiles(scratch_dirs_[1 - busy_device]), 1);
+
+    bool pinned;
+    for (int i = 0; i < max_num_buffers; ++i) {
+      EXPECT_TRUE(blocks[i]->Pin(&pinned).ok());
+      EXPECT_TRUE(pinned);
+      ValidateBlock(blocks[i], i);
+    }
+    block_mgr.reset();
+    EXPECT_TRUE(block_mgr_parent_tracker_->consumption() == 0);
+    TmpFileMgr::WriteFinished(busy_device, BUSY_DEVICE_BYTES, 0);
+  }
+}
+
+// Test that a block whose write fails is written to another scratch device rather than
+// cancelling the query, and that the device the write failed on is blacklisted.
+TEST_F(BufferedBlockMgrTest, WriteErrorRetry) {
+  InitTmpFileMgr(2);
+  // Make device 1 look busy so that blocks are placed on device 0 while it is usable.
+  TmpFileMgr::WriteStarted(1, BUSY_DEVICE_BYTES);
+  int max_num_buffers = 2;
+  shared_ptr<BufferedBlockMgr> block_mgr = CreateMgr(max_num_buffers);
+  BufferedBlockMgr::Client* client;
+  Status status = block_mgr->RegisterClient(0, NULL, runtime_state_.get(), &client);
+  EXPECT_TRUE(status.ok());
+  vector<BufferedBlockMgr::Block*> blocks;
+  AllocateBlocks(block_mgr.get(), client, max_num_buffers, &blocks);
+
+  // Spilling the first block creates the scratch file on device 0, with room for the
+  // second block.
+  EXPECT_TRUE(blocks[0]->Unpin().ok());
+  WaitForWrites(block_mgr.get(), 1);
+  EXPECT_EQ(NumFiles(scratch_dirs_[0]), 1);
+  EXPECT_EQ(NumFiles(scratch_dirs_[1]), 0);
+
+  // Remove the file, so that writing the second block to device 0 fails. It is written
+  // again to device 1.
+  for (directory_iterator it(scratch_dirs_[0]); it != directory_iterator(); ++it) {
+    remove_all(it->path());
+  }
+  EXPECT_TRUE(blocks[1]->Unpin().ok());
+  WaitForWrites(block_mgr.get(), 3);
+  EXPECT_TRUE(TmpFileMgr::IsBlacklisted(0));
+  EXPECT_FALSE(TmpFileMgr::IsBlacklisted(1));
+  EXPECT_EQ(NumFiles(scratch_dirs_[1]), 1);
+
+  // Take the buffers of both blocks and read the second block back from device 1.
+  AllocateBlocks(block_mgr.get(), client, max_num_buffers, &blocks);
+  EXPECT_TRUE(blocks[2]->Unpin().ok());
+  bool pinned;
+  status = blocks[1]->Pin(&pinned);
+  EXPECT_TRUE(status.ok()) << status.GetErrorMsg();
+  EXPECT_TRUE(pinned);
+  ValidateBlock(blocks[1], 1);
+
+  // The block manager was not cancelled.
+  EXPECT_TRUE(blocks[0]->Delete().ok());
+  EXPECT_TRUE(blocks[1]->Unpin().ok());
+  block_mgr.reset();
+  EXPECT_TRUE(block_mgr_parent_tracker_->consumption() == 0);
+}
+
 // Test deletion and reuse of blocks.
 TEST_F(BufferedBlockMgrTest, Deletion) {
   int max_num_buffers = 5;
@@ -791,11 +1076,27 @@ TEST_F(BufferedBlockMgrTest, ClientOversubscription) {
 
 TEST_F(BufferedBlockMgrTest, Random_plain) {
   FLAGS_disk_spill_encryption = false;
+  FLAGS_disk_spill_compression_codec = "none";
   TestRandomInternal();
 }
 
 TEST_F(BufferedBlockMgrTest, Random_integ_enc) {
   FLAGS_disk_spill_encryption = true;
+  FLAGS_disk_spill_compression_codec = "none";
+  TestRandomInternal();
+}
+
+TEST_F(BufferedBlockMgrTest, Random_compressed) {
+  FLAGS_disk_spill_encryption = false;
+  FLAGS_disk_spill_compression_codec = "lz4";
+  TestRandomInternal();
+  FLAGS_disk_spill_compression_codec = "snappy";
+  TestRandomInternal();
+}
+
+TEST_F(BufferedBlockMgrTest, Random_compressed_integ_enc) {
+  FLAGS_disk_spill_encryption = true;
+  FLAGS_disk_spill_compression_codec = "lz4";
   TestRandomInternal();
 }
 
@@ -805,7 +1106,6 @@ int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   impala::InitCommonRuntime(argc, argv, true);
   impala::InitFeSupport();
-  impala::TmpFileMgr::Init();
   impala::LlvmCodeGen::InitializeLlvm();
   return RUN_ALL_TESTS();
 }
@@ -17,12 +17,14 @@
 #include "runtime/mem-pool.h"
 #include "runtime/buffered-block-mgr.h"
 #include "runtime/tmp-file-mgr.h"
+#include "util/codec.h"
 #include "util/runtime-profile.h"
 #include "util/disk-info.h"
 #include "util/filesystem-util.h"
 #include "util/impalad-metrics.h"
 #include "util/uid-util.h"
 #include <gutil/strings/substitute.h>
+#include <boost/algorithm/string.hpp>
 
 #include <openssl/rand.h>
 #include <openssl/evp.h>
@@ -35,6 +37,9 @@ using namespace strings;   // for Substitute
 
 DEFINE_bool(disk_spill_encryption, false, "Set this to encrypt and perform an integrity "
     "check on all data spilled to disk during a query");
+DEFINE_string(disk_spill_compression_codec, "lz4", "Codec to compress data spilled to "
+    "disk during a query with: lz4, snappy or none. Blocks that do not compress are "
+    "written uncompressed.");
 
 namespace impala {
 
@@ -110,7 +115,13 @@ BufferedBlockMgr::Block::Block(BufferedBlockMgr* block_mgr)
     block_mgr_(block_mgr),
     client_(NULL),
     write_range_(NULL),
-    valid_data_len_(0) {
+    tmp_file_(NULL),
+    disk_extent_len_(0),
+    valid_data_len_(0),
+    write_len_(0),
+    write_prepared_(false),
+    compressed_write_buffer_len_(0),
+    is_compressed_(false) {
 }
 
 Status BufferedBlockMgr::Block::Pin(bool* pinned, Block* release_block, bool unpin) {
@@ -438,6 +449,7 @@ BufferedBlockMgr::~BufferedBlockMgr() {
     file.Remove();
   }
   tmp_files_.clear();
+  free_extents_.clear();
 
   // Free memory resources.
   BOOST_FOREACH(BufferDescriptor* buffer, all_io_buffers_) {
@@ -461,8 +473,18 @@ BufferedBlockMgr::BufferedBlockMgr(RuntimeState* state, int64_t block_size)
     io_mgr_(state->io_mgr()),
     is_cancelled_(false),
     encryption_(FLAGS_disk_spill_encryption),
-    check_integrity_(FLAGS_disk_spill_encryption) {
+    check_integrity_(FLAGS_disk_spill_encryption),
+    compression_type_(THdfsCompression::NONE) {
   state->io_mgr()->RegisterContext(NULL, &io_request_context_);
+  string codec = to_lower_copy(FLAGS_disk_spill_compression_codec);
+  if (codec == "lz4") {
+    compression_type_ = THdfsCompression::LZ4;
+  } else if (codec == "snappy") {
+    compression_type_ = THdfsCompression::SNAPPY;
+  } else if (codec != "none" && !codec.empty()) {
+    LOG(WARNING) << "Unknown --disk_spill_compression_codec '"
+                 << FLAGS_disk_spill_compression_codec << "', spilling uncompressed";
+  }
   if (encryption_) {
     static bool openssl_loaded = false;
     if (!openssl_loaded) {
@@ -546,32 +568,52 @@ Status BufferedBlockMgr::PinBlock(Block* block, bool* pinned, Block* release_blo
   // Read the block from disk if it was not in memory.
   DCHECK(block->write_range_ != NULL) << block->DebugString() << endl << release_block;
   SCOPED_TIMER(disk_read_timer_);
+  int64_t disk_len = block->write_range_->len();
+  if (!block->is_compressed_) {
+    RETURN_IF_ERROR(ReadBlockData(block, block->buffer(), disk_len));
+  } else {
+    // Compressed data is read into a temporary buffer and decompressed into buffer().
+    // The block cannot be read without the buffer, so it is charged to mem_tracker_
+    // even if that exceeds the limit.
+    mem_tracker_->Consume(disk_len);
+    uint8_t* compressed = new uint8_t[disk_len];
+    Status status = ReadBlockData(block, compressed, disk_len);
+    // Decompression comes last, because the data was compressed before being encrypted
+    if (status.ok()) status = Decompress(block, compressed, disk_len);
+    delete[] compressed;
+    mem_tracker_->Release(disk_len);
+    RETURN_IF_ERROR(status);
+  }
+
+  return DeleteOrUnpin(release_block, unpin);
+}
+
+Status BufferedBlockMgr::ReadBlockData(Block* block, uint8_t* buffer, int64_t len) {
   // Create a ScanRange to perform the read.
   DiskIoMgr::ScanRange* scan_range =
       obj_pool_.Add(new DiskIoMgr::ScanRange());
-  scan_range->Reset(block->write_range_->file(), block->write_range_->len(),
+  scan_range->Reset(block->write_range_->file(), len,
       block->write_range_->offset(), block->write_range_->disk_id(), false, block);
   vector<DiskIoMgr::ScanRange*> ranges(1, scan_range);
   RETURN_IF_ERROR(io_mgr_->AddScanRanges(io_request_context_, ranges, true));
 
-  // Read from the io mgr buffer into the block's assigned buffer.
+  // Read from the io mgr buffer into 'buffer'.
   int64_t offset = 0;
   DiskIoMgr::BufferDescriptor* io_mgr_buffer;
   do {
     RETURN_IF_ERROR(scan_range->GetNext(&io_mgr_buffer));
-    memcpy(block->buffer() + offset, io_mgr_buffer->buffer(), io_mgr_buffer->len());
+    memcpy(buffer + offset, io_mgr_buffer->buffer(), io_mgr_buffer->len());
     offset += io_mgr_buffer->len();
     io_mgr_buffer->Return();
   } while (!io_mgr_buffer->eosr());
-  DCHECK_EQ(offset, block->write_range_->len());
+  DCHECK_EQ(offset, len);
 
   // Verify integrity first, because the hash was generated from encrypted data
-  if (check_integrity_) RETURN_IF_ERROR(VerifyHash(block));
+  if (check_integrity_) RETURN_IF_ERROR(VerifyHash(block, buffer, len));
 
   // Decryption is done in-place, since the buffer can't be accessed by anyone else
-  if (encryption_) RETURN_IF_ERROR(Decrypt(block));
-
-  return DeleteOrUnpin(release_block, unpin);
+  if (encryption_) RETURN_IF_ERROR(Decrypt(block, buffer, len));
+  return Status::OK;
 }
 
 Status BufferedBlockMgr::UnpinBlock(Block* block) {
@@ -618,40 +660,18 @@ Status BufferedBlockMgr::WriteUnpinnedBlock(Block* block) {
   DCHECK(!block->in_write_) << block->DebugString();
 
   if (block->write_range_ == NULL) {
-    // First time the block is being persisted. Find the next physical file in
-    // round-robin order and create a write range for it.
-    TmpFileMgr::File& tmp_file = tmp_files_[next_block_index_];
-    next_block_index_ = (next_block_index_ + 1) % tmp_files_.size();
-    int64_t file_offset;
-    RETURN_IF_ERROR(tmp_file.AllocateSpace(max_block_size_, &file_offset));
-    int disk_id = tmp_file.disk_id();
-    if (disk_id < 0) {
-      // Assign a valid disk id to the write range if the tmp file was not assigned one.
-      static unsigned int next_disk_id = 0;
-      disk_id = (++next_disk_id) % io_mgr_->num_disks();
-    }
-    disk_id %= io_mgr_->num_disks();
-    DiskIoMgr::WriteRange::WriteDoneCallback callback =
-        bind(mem_fn(&BufferedBlockMgr::WriteComplete), this, block, _1);
-    block->write_range_ = obj_pool_.Add(new DiskIoMgr::WriteRange(
-        tmp_file.path(), file_offset, disk_id, callback));
+    // First time the block is being persisted.
+    RETURN_IF_ERROR(AllocateScratchSpace(block));
   }
 
-  uint8_t* outbuf = NULL;
-  if (encryption_) {
-    // The block->buffer() could be accessed during the write path, so we have to
-    // make a copy of it while writing.
-    RETURN_IF_ERROR(Encrypt(block, &outbuf));
-  } else {
-    outbuf = block->buffer();
-  }
-
-  if (check_integrity_) SetHash(block);
-
-  block->write_range_->SetData(outbuf, block->valid_data_len_);
+  // The data is compressed, encrypted and hashed by PrepareWrite() on the disk thread.
+  block->write_range_->SetData(block->buffer(), block->valid_data_len_);
+  block->write_len_ = block->valid_data_len_;
+  block->write_prepared_ = false;
 
   // Issue write through DiskIoMgr.
   RETURN_IF_ERROR(io_mgr_->AddWriteRange(io_request_context_, block->write_range_));
+  TmpFileMgr::WriteStarted(block->tmp_file_->device_id(), block->write_len_);
   block->in_write_ = true;
   DCHECK(block->Validate()) << endl << block->DebugString();
   outstanding_writes_counter_->Add(1);
@@ -664,9 +684,115 @@ Status BufferedBlockMgr::WriteUnpinnedBlock(Block* block) {
   return Status::OK;
 }
 
+Status BufferedBlockMgr::PrepareWrite(Block* block) {
+  const uint8_t* data = block->write_range_->data();
+  int64_t len = block->write_range_->len();
+  COUNTER_ADD(uncompressed_bytes_written_counter_, len);
+
+  block->is_compressed_ = false;
+  if (compression_type_ != THdfsCompression::NONE) {
+    RETURN_IF_ERROR(Compress(block, &data, &len));
+  }
+
+  if (encryption_) {
+    // The block->buffer() could be accessed during the write path, so we have to
+    // make a copy of it while writing.
+    uint8_t* encrypted;
+    RETURN_IF_ERROR(Encrypt(block, data, len, &encrypted));
+    data = encrypted;
+  }
+
+  if (check_integrity_) SetHash(block, data, len);
+
+  block->write_range_->SetData(data, len);
+  block->write_prepared_ = true;
+  if (len > block->disk_extent_len_) RETURN_IF_ERROR(AllocateExtent(block, len));
+  COUNTER_ADD(bytes_written_counter_, len);
+  return Status::OK;
+}
+
+Status BufferedBlockMgr::AllocateScratchSpace(Block* block) {
+  // The data is at most this long, and shorter if it compresses.
+  int64_t len = block->valid_data_len_;
+  TmpFileMgr::File* tmp_file = NULL;
+  while (tmp_file == NULL) {
+    // Find the usable file whose device is expected to write the block first. Start at
+    // next_block_index_ so that equally loaded devices are used round-robin.
+    int best_idx = -1;
+    double best_time = 0;
+    for (int i = 0; i < tmp_files_.size(); ++i) {
+      int idx = (next_block_index_ + i) % tmp_files_.size();
+      int device_id = tmp_files_[idx].device_id();
+      if (TmpFileMgr::IsBlacklisted(device_id)) continue;
+      double write_time = TmpFileMgr::EstimatedWriteTime(device_id, len);
+      if (best_idx == -1 || write_time < best_time) {
+        best_idx = idx;
+        best_time = write_time;
+      }
+    }
+    if (best_idx == -1) {
+      return Status("Could not spill: all scratch directories are blacklisted");
+    }
+    next_block_index_ = (best_idx + 1) % tmp_files_.size();
+    Status status;
+    {
+      lock_guard<mutex> l(scratch_lock_);
+      status = tmp_files_[best_idx].Create();
+    }
+    if (status.ok()) {
+      tmp_file = &tmp_files_[best_idx];
+    } else {
+      TmpFileMgr::BlacklistDevice(tmp_files_[best_idx].device_id(), status);
+    }
+  }
+  int disk_id = tmp_file->disk_id();
+  if (disk_id < 0) {
+    // Assign a valid disk id to the write range if the tmp file was not assigned one.
+    static unsigned int next_disk_id = 0;
+    disk_id = (++next_disk_id) % io_mgr_->num_disks();
+  }
+  disk_id %= io_mgr_->num_disks();
+  DiskIoMgr::WriteRange::WriteDoneCallback callback =
+      bind(mem_fn(&BufferedBlockMgr::WriteComplete), this, block, _1);
+  block->write_range_ = obj_pool_.Add(new DiskIoMgr::WriteRange(
+      tmp_file->path(), 0, disk_id, callback));
+  block->write_range_->SetPrepareCallback(
+      bind(mem_fn(&BufferedBlockMgr::PrepareWrite), this, block));
+  block->tmp_file_ = tmp_file;
+  block->disk_extent_len_ = 0;
+  return Status::OK;
+}
+
+Status BufferedBlockMgr::AllocateExtent(Block* block, int64_t len) {
+  DCHECK_GT(len, block->disk_extent_len_);
+  lock_guard<mutex> l(scratch_lock_);
+  FreeExtents& free_extents = free_extents_[block->tmp_file_];
+  int64_t file_offset;
+  int64_t extent_len;
+  FreeExtents::iterator it = free_extents.lower_bound(len);
+  if (it != free_extents.end()) {
+    extent_len = it->first;
+    file_offset = it->second;
+    free_extents.erase(it);
+  } else {
+    RETURN_IF_ERROR(block->tmp_file_->AllocateSpace(len, &file_offset));
+    extent_len = len;
+    COUNTER_ADD(scratch_bytes_allocated_counter_, len);
+  }
+  if (block->disk_extent_len_ > 0) {
+    free_extents.insert(
+        make_pair(block->disk_extent_len_, block->write_range_->offset()));
+  }
+  block->write_range_->SetOffset(file_offset);
+  block->disk_extent_len_ = extent_len;
+  return Status::OK;
+}
+
 void BufferedBlockMgr::WriteComplete(Block* block, const Status& write_status) {
   outstanding_writes_counter_->Add(-1);
   lock_guard<mutex> lock(lock_);
+  TmpFileMgr::WriteFinished(block->tmp_file_->device_id(), block->write_len_,
+      write_status.ok() ? block->write_range_->write_time_ns() : 0);
   DCHECK(Validate()) << endl << DebugInternal();
   DCHECK(block->in_write_) << "WriteComplete() for block not in write."
                            << endl << block->DebugString();
@@ -680,10 +806,30 @@ void BufferedBlockMgr::WriteComplete(Block* block, const Status& write_status) {
     // hang around needlessly.
     EncryptDone(block);
   }
+  CompressDone(block);
   if (is_cancelled_) return;
+  Status status = write_status;
+  if (!status.ok() && !status.IsCancelled() && block->write_prepared_) {
+    // Stop using the device. The block's data is still in its buffer, so it is only lost
+    // if it cannot be written to another device.
+    TmpFileMgr::BlacklistDevice(block->tmp_file_->device_id(), status);
+    block->write_range_ = NULL;
+    block->tmp_file_ = NULL;
+    block->disk_extent_len_ = 0;
+    if (block->is_pinned_ || block->is_deleted_) {
+      // The block does not need to be written anymore.
+      status = Status::OK;
+    } else {
+      status = WriteUnpinnedBlock(block);
+      if (status.ok()) {
+        if (!block->client_local_) ++num_outstanding_writes_;
+        return;
+      }
+    }
+  }
   // Check for an error. Set cancelled and wake up waiting threads if an error occurred.
-  if (!write_status.ok()) {
-    block->client_->state_->LogError(write_status);
+  if (!status.ok()) {
+    block->client_->state_->LogError(status);
     is_cancelled_ = true;
     if (block->client_local_) {
       block->write_complete_cv_.notify_one();
@@ -1057,6 +1203,13 @@ void BufferedBlockMgr::Init(RuntimeProfile* parent_profile,
   buffer_wait_timer_ = ADD_TIMER(profile_.get(), "TotalBufferWaitTime");
   encryption_timer_ = ADD_TIMER(profile_.get(), "TotalEncryptionTime");
   integrity_check_timer_ = ADD_TIMER(profile_.get(), "TotalIntegrityCheckTime");
+  compression_timer_ = ADD_TIMER(profile_.get(), "TotalCompressionTime");
+  uncompressed_bytes_written_counter_ =
+      ADD_COUNTER(profile_.get(), "UncompressedBytesWritten", TCounterType::BYTES);
+  bytes_written_counter_ =
+      ADD_COUNTER(profile_.get(), "BytesWritten", TCounterType::BYTES);
+  scratch_bytes_allocated_counter_ =
+      ADD_COUNTER(profile_.get(), "ScratchBytesAllocated", TCounterType::BYTES);
 
   // Create a new mem_tracker and allocate buffers.
   mem_tracker_.reset(new MemTracker(
@@ -1079,11 +1232,69 @@ static Status OpenSSLErr(const string& msg) {
   return Status(Substitute("Openssl Error: $0", errstream.str()));
 }
 
-Status BufferedBlockMgr::Encrypt(Block* block, uint8_t** outbuf) {
-  DCHECK(encryption_);
+Status BufferedBlockMgr::Compress(Block* block, const uint8_t** data, int64_t* len) {
+  DCHECK_NE(compression_type_, THdfsCompression::NONE);
+  DCHECK(*data);
+  DCHECK(block->compressed_write_buffer_.get() == NULL);
+  if (*len == 0) return Status::OK;
+  SCOPED_TIMER(compression_timer_);
+
+  // Several disk threads may compress at the same time, so each uses its own compressor.
+  scoped_ptr<Codec> compressor;
+  RETURN_IF_ERROR(Codec::CreateCompressor(NULL, false, compression_type_, &compressor));
+  int64_t buffer_len = compressor->MaxOutputLen(*len);
+  // The buffer is charged even if that exceeds the limit, like the buffers that
+  // compressed blocks are read into. There is at most one per write in flight, and
+  // while they exist, fewer buffers can be allocated for blocks.
+  mem_tracker_->Consume(buffer_len);
+  block->compressed_write_buffer_.reset(new uint8_t[buffer_len]);
+  block->compressed_write_buffer_len_ = buffer_len;
+  uint8_t* compressed = block->compressed_write_buffer_.get();
+  int64_t compressed_len = buffer_len;
+  Status status = compressor->ProcessBlock(true, *len, *data, &compressed_len,
+      &compressed);
+  compressor->Close();
+  RETURN_IF_ERROR(status);
+  if (compressed_len >= *len) {
+    CompressDone(block);
+    return Status::OK;
+  }
+  block->is_compressed_ = true;
+  *data = compressed;
+  *len = compressed_len;
+  return Status::OK;
+}
+
+void BufferedBlockMgr::CompressDone(Block* block) {
+  if (block->compressed_write_buffer_.get() == NULL) return;
+  block->compressed_write_buffer_.reset();
+  mem_tracker_->Release(block->compressed_write_buffer_len_);
+  block->compressed_write_buffer_len_ = 0;
+}
+
+Status BufferedBlockMgr::Decompress(Block* block, const uint8_t* data, int64_t len) {
+  DCHECK(block->is_compressed_);
   DCHECK(block->buffer());
-  DCHECK(!block->is_pinned_);
-  DCHECK(!block->in_write_);
+  SCOPED_TIMER(compression_timer_);
+  scoped_ptr<Codec> decompressor;
+  RETURN_IF_ERROR(Codec::CreateDecompressor(NULL, false, compression_type_,
+      &decompressor));
+  int64_t uncompressed_len = block->valid_data_len_;
+  uint8_t* output = block->buffer();
+  Status status = decompressor->ProcessBlock(true, len, data, &uncompressed_len,
+      &output);
+  decompressor->Close();
+  RETURN_IF_ERROR(status);
+  if (uncompressed_len != block->valid_data_len_) {
+    return Status("Block decompression failure");
+  }
+  return Status::OK;
+}
+
+Status BufferedBlockMgr::Encrypt(Block* block, const uint8_t* data, int64_t len,
+    uint8_t** outbuf) {
+  DCHECK(encryption_);
+  DCHECK(data);
   DCHECK(outbuf);
   SCOPED_TIMER(encryption_timer_);
 
@@ -1092,10 +1303,10 @@ Status BufferedBlockMgr::Encrypt(Block* block, uint8_t** outbuf) {
   // writes of the same Block.
   RAND_bytes(block->key_, sizeof(block->key_));
   RAND_bytes(block->iv_, sizeof(block->iv_));
-  block->encrypted_write_buffer_.reset(new uint8_t[block->valid_data_len_]);
+  block->encrypted_write_buffer_.reset(new uint8_t[len]);
 
   EVP_CIPHER_CTX ctx;
-  int len = static_cast<int>(block->valid_data_len_);
+  int data_len = static_cast<int>(len);
 
   // Create and initialize the context for encryption
   EVP_CIPHER_CTX_init(&ctx);
@@ -1108,22 +1319,23 @@ Status BufferedBlockMgr::Encrypt(Block* block, uint8_t** outbuf) {
     return OpenSSLErr("EVP_EncryptInit_ex failure");
   }
 
-  // Encrypt block->buffer() into the new encrypted_write_buffer_
-  if (EVP_EncryptUpdate(&ctx, block->encrypted_write_buffer_.get(), &len,
-        block->buffer(), len) != 1) {
+  // Encrypt data into the new encrypted_write_buffer_
+  if (EVP_EncryptUpdate(&ctx, block->encrypted_write_buffer_.get(), &data_len,
+        data, data_len) != 1) {
     return OpenSSLErr("EVP_EncryptUpdate failure");
   }
 
   // This is safe because we're using CFB mode without padding.
-  DCHECK_EQ(len, block->valid_data_len_);
+  DCHECK_EQ(data_len, len);
 
   // Finalize encryption.
-  if (1 != EVP_EncryptFinal_ex(&ctx, block->encrypted_write_buffer_.get() + len, &len)) {
+  if (1 != EVP_EncryptFinal_ex(&ctx, block->encrypted_write_buffer_.get() + data_len,
+        &data_len)) {
     return OpenSSLErr("EVP_EncryptFinal failure");
   }
 
   // Again safe due to CFB with no padding
-  DCHECK_EQ(len, 0);
+  DCHECK_EQ(data_len, 0);
 
   *outbuf = block->encrypted_write_buffer_.get();
   return Status::OK;
@@ -1135,13 +1347,13 @@ void BufferedBlockMgr::EncryptDone(Block* block) {
   block->encrypted_write_buffer_.reset();
 }
 
-Status BufferedBlockMgr::Decrypt(Block* block) {
+Status BufferedBlockMgr::Decrypt(Block* block, uint8_t* data, int64_t len) {
   DCHECK(encryption_);
-  DCHECK(block->buffer());
+  DCHECK(data);
   SCOPED_TIMER(encryption_timer_);
 
   EVP_CIPHER_CTX ctx;
-  int len = static_cast<int>(block->valid_data_len_);
+  int data_len = static_cast<int>(len);
 
   // Create and initialize the context for encryption
   EVP_CIPHER_CTX_init(&ctx);
@@ -1152,46 +1364,39 @@ Status BufferedBlockMgr::Decrypt(Block* block) {
     return OpenSSLErr("EVP_DecryptInit_ex failure");
   }
 
-  // Decrypt block->buffer() in-place.  Safe because no one is accessing it.
-  if (EVP_DecryptUpdate(&ctx, block->buffer(), &len, block->buffer(), len) != 1) {
+  // Decrypt data in-place.  Safe because no one is accessing it.
+  if (EVP_DecryptUpdate(&ctx, data, &data_len, data, data_len) != 1) {
     return OpenSSLErr("EVP_DecryptUpdate failure");
   }
 
   // This is safe because we're using CFB mode without padding.
-  DCHECK_EQ(len, block->valid_data_len_);
+  DCHECK_EQ(data_len, len);
 
   // Finalize decryption.
-  if (1 != EVP_DecryptFinal_ex(&ctx, block->buffer() + len, &len)) {
+  if (1 != EVP_DecryptFinal_ex(&ctx, data + data_len, &data_len)) {
     return OpenSSLErr("EVP_DecryptFinal failure");
   }
 
   // Again safe due to CFB with no padding
-  DCHECK_EQ(len, 0);
+  DCHECK_EQ(data_len, 0);
 
   return Status::OK;
 }
 
-void BufferedBlockMgr::SetHash(Block* block) {
+void BufferedBlockMgr::SetHash(Block* block, const uint8_t* data, int64_t len) {
   DCHECK(check_integrity_);
+  DCHECK(data);
   SCOPED_TIMER(integrity_check_timer_);
-  uint8_t* data = NULL;
-  if (encryption_) {
-    DCHECK(block->encrypted_write_buffer_.get());
-    data = block->encrypted_write_buffer_.get();
-  } else {
-    DCHECK(block->buffer());
-    data = block->buffer();
-  }
   // Explicitly ignore the return value from SHA256(); it can't fail.
-  (void) SHA256(data, block->valid_data_len_, block->hash_);
+  (void) SHA256(data, len, block->hash_);
 }
 
-Status BufferedBlockMgr::VerifyHash(Block* block) {
+Status BufferedBlockMgr::VerifyHash(Block* block, const uint8_t* data, int64_t len) {
   DCHECK(check_integrity_);
-  DCHECK(block->buffer());
+  DCHECK(data);
   SCOPED_TIMER(integrity_check_timer_);
   uint8_t test_hash[SHA256_DIGEST_LENGTH];
-  (void) SHA256(block->buffer(), block->valid_data_len_, test_hash);
+  (void) SHA256(data, len, test_hash);
   if (memcmp(test_hash, block->hash_, SHA256_DIGEST_LENGTH) != 0) {
     return Status("Block verification failure");
   }
@@ -15,10 +15,12 @@
 #ifndef IMPALA_RUNTIME_BUFFERED_BLOCK_MGR
 #define IMPALA_RUNTIME_BUFFERED_BLOCK_MGR
 
+#include <map>
 #include <boost/shared_ptr.hpp>
 
 #include "runtime/disk-io-mgr.h"
 #include "runtime/tmp-file-mgr.h"
+#include "gen-cpp/CatalogObjects_types.h"  // for THdfsCompression
 
 #include <openssl/aes.h>
 #include <openssl/sha.h>
@@ -45,7 +47,11 @@ class RuntimeState;
 // When the number of free buffers falls below 'block_write_threshold', unpinned blocks
 // are persisted in Last-In_First-Out order. (It is assumed that unpinned blocks are
 // re-read in FIFO order). TmpFileMgr is used to obtain file handles to write to within
-// the tmp directories configured for Impala.
+// the tmp directories configured for Impala. Each block is written to the tmp device
+// expected to finish writing it first, given the bytes queued to each device by all
+// queries and how fast it has been writing. Devices on which writes fail or that run
+// out of space are blacklisted by TmpFileMgr for a while, and writes that failed are
+// retried on another device.
 //
 // It is expected to have one BufferedBlockMgr per query. All allocations that can grow
 // proportional to input size and might need to spill to disk should allocate from the
@@ -202,15 +208,45 @@ class BufferedBlockMgr {
 
     // WriteRange object representing the on-disk location used to persist a block.
     // Is created the first time a block is persisted, and retained until the block
-    // object is destroyed. The file location and offset in write_range_ are valid
-    // throughout the lifetime of this object, but the data and length in the
-    // write_range_ are only valid while the block is being written.
+    // object is destroyed. The file location and disk in write_range_ are valid
+    // throughout the lifetime of this object. The offset is that of the block's extent
+    // (see disk_extent_len_) and the length that of the data last written, but the data
+    // in the write_range_ is only valid while the block is being written.
     // write_range_ instance is owned by the block manager.
     DiskIoMgr::WriteRange* write_range_;
 
+    // The tmp file write_range_ is in. Set along with write_range_.
+    TmpFileMgr::File* tmp_file_;
+
+    // Length of the extent of tmp_file_ at write_range_'s offset, 0 if the block has not
+    // been written yet. The extent is sized to the data when it is first written, and is
+    // kept, like write_range_, when the block is deleted and reused. It is replaced by
+    // AllocateExtent() when the block's data no longer fits into it.
+    int64_t disk_extent_len_;
+
     // Length of valid (i.e. allocated) data within the block.
     int64_t valid_data_len_;
 
+    // Length of the data of the write in flight before it was compressed. The write is
+    // accounted by it in TmpFileMgr.
+    int64_t write_len_;
+
+    // True once PrepareWrite() has prepared the data of the write in flight, before it
+    // allocates the extent to write it to. If a write fails before that, the failure is
+    // not the device's.
+    bool write_prepared_;
+
+    // If compression is on, in the write path we allocate a new buffer to hold the
+    // compressed data while it's being written to disk. It is charged to the block
+    // manager's mem_tracker_. The read path decompresses from a temporary buffer into
+    // buffer().
+    boost::scoped_array<uint8_t> compressed_write_buffer_;
+    int64_t compressed_write_buffer_len_;
+
+    // True if the data last written to disk was compressed. Blocks whose data does not
+    // compress are written uncompressed.
+    bool is_compressed_;
+
     // If encryption_ is on, in the write path we allocate a new buffer to hold
     // encrypted data while it's being written to disk.  The read path, having no
     // references to the data, can be decrypted in place.
@@ -414,11 +450,36 @@ class BufferedBlockMgr {
   // Issues the write for this block to the io mgr.
   Status WriteUnpinnedBlock(Block* block);
 
+  // Compresses, encrypts and hashes the data of the block's write range, as configured,
+  // and replaces it with the result, then makes sure the block has an extent that the
+  // result fits into. Called by the disk thread right before the block is written,
+  // without lock_, so that the block manager is not blocked meanwhile. Nothing else
+  // accesses these parts of the block while it is being written.
+  Status PrepareWrite(Block* block);
+
+  // Picks the tmp file whose device is expected to finish writing 'block' first and
+  // creates a new write range for it. The block's extent in the file is allocated when
+  // its data is written, once the length of the compressed data is known. Devices that
+  // are blacklisted are skipped, and devices on which the file cannot be created are
+  // blacklisted. Returns an error if no device is left.
+  Status AllocateScratchSpace(Block* block);
+
+  // Replaces the extent of 'block', which is too short for 'len' bytes, by the shortest
+  // free extent of its tmp file that is long enough, or else by a new extent of 'len'
+  // bytes at the end of the file. The old extent, if any, is added to the free extents.
+  // Takes scratch_lock_.
+  Status AllocateExtent(Block* block, int64_t len);
+
+  // Reads the 'len' bytes that the block was last written as into 'buffer', then
+  // verifies and decrypts them.
+  Status ReadBlockData(Block* block, uint8_t* buffer, int64_t len);
+
   // Callback used by DiskIoMgr to indicate a block write has completed.
-  // write_status is the status of the write. is_cancelled_ is set to true if
-  // write_status is not Status::OK. Returns the block's buffer to the free buffers
-  // list if it is no longer pinned. Returns the block itself to the free blocks list
-  // if it has been deleted.
+  // write_status is the status of the write. If the write failed, the device is
+  // blacklisted and the block is written again to another one if it is still unpinned.
+  // is_cancelled_ is set to true if that is not possible. Returns the block's buffer to
+  // the free buffers list if it is no longer pinned. Returns the block itself to the
+  // free blocks list if it has been deleted.
   void WriteComplete(Block* block, const Status& write_status);
 
   // Return a deleted block to the list of free blocks. Assumes the block's buffer has
@@ -491,11 +552,23 @@ class BufferedBlockMgr {
   std::list<BufferDescriptor*> all_io_buffers_;
 
   // Temporary physical file handle, (one per tmp device) to which blocks may be written.
-  // Blocks are round-robined across these files.
+  // Blocks are placed on the file whose device is expected to write them first,
+  // skipping blacklisted devices (see AllocateScratchSpace()).
   boost::ptr_vector<TmpFileMgr::File> tmp_files_;
 
-  // Index into tmp_files_ denoting the file to which the next block to be persisted
-  // will be written.
+  // Protects free_extents_ and the allocation of space in tmp_files_, which happens on
+  // the disk threads without lock_. Taken after lock_ if both are needed.
+  boost::mutex scratch_lock_;
+
+  // The extents of each tmp file that blocks no longer use, as a map from their length
+  // to their offset. Extents vary in length because blocks are compressed. They are
+  // given to blocks whose data outgrew their own extent, and are lost when the file's
+  // device is blacklisted.
+  typedef std::multimap<int64_t, int64_t> FreeExtents;
+  std::map<const TmpFileMgr::File*, FreeExtents> free_extents_;
+
+  // Index into tmp_files_ of the file that is considered first for the next block to be
+  // persisted. Advanced past the chosen file so that ties are broken round-robin.
   int next_block_index_;
 
   // DiskIoMgr handles to read and write blocks.
@@ -541,6 +614,17 @@ class BufferedBlockMgr {
   // Time spent in disk spill integrity generation and checking
   RuntimeProfile::Counter* integrity_check_timer_;
 
+  // Time spent in disk spill compression and decompression
+  RuntimeProfile::Counter* compression_timer_;
+
+  // Bytes of blocks written to disk, before and after compression.
+  RuntimeProfile::Counter* uncompressed_bytes_written_counter_;
+  RuntimeProfile::Counter* bytes_written_counter_;
+
+  // Bytes of the extents allocated in the tmp files. Free extents that are reused are
+  // not counted again.
+  RuntimeProfile::Counter* scratch_bytes_allocated_counter_;
+
   // Protects query_to_block_mgrs_
   static boost::mutex static_block_mgrs_lock_;
 
@@ -552,21 +636,35 @@ class BufferedBlockMgr {
       BlockMgrsMap;
   static BlockMgrsMap query_to_block_mgrs_;
 
-  // Takes the data in buffer(), allocates encrypted_write_buffer_, and returns
-  // a pointer to the encrypted data in outbuf.
-  Status Encrypt(Block* block, uint8_t** outbuf);
+  // Takes the '*len' bytes at '*data', allocates compressed_write_buffer_ and, if they
+  // compress, returns the compressed data in 'data' and 'len'. Otherwise releases the
+  // buffer and leaves them unchanged.
+  Status Compress(Block* block, const uint8_t** data, int64_t* len);
+
+  // Deallocates the temporary buffer allocated in Compress(), if any.
+  void CompressDone(Block* block);
+
+  // Decompresses 'len' bytes of compressed data at 'data' into buffer()
+  Status Decompress(Block* block, const uint8_t* data, int64_t len);
+
+  // Takes 'len' bytes of data at 'data' (the contents of buffer() or the compressed
+  // data), allocates encrypted_write_buffer_, and returns a pointer to the encrypted
+  // data in outbuf.
+  Status Encrypt(Block* block, const uint8_t* data, int64_t len, uint8_t** outbuf);
 
   // Deallocates temporary buffer alloced in Encrypt()
   void EncryptDone(Block* block);
 
-  // Decrypts the contents of buffer() in place
-  Status Decrypt(Block* block);
+  // Decrypts 'len' bytes at 'data' in place
+  Status Decrypt(Block* block, uint8_t* data, int64_t len);
 
-  // Takes a cryptographic hash of the data and sets hash_ with it.
-  void SetHash(Block* block);
+  // Takes a cryptographic hash of the 'len' bytes written at 'data' and sets hash_
+  // with it.
+  void SetHash(Block* block, const uint8_t* data, int64_t len);
 
-  // Verifies that the contents of buffer() match those that were set by SetHash()
-  Status VerifyHash(Block* block);
+  // Verifies that the 'len' bytes read at 'data' match those that were set by
+  // SetHash()
+  Status VerifyHash(Block* block, const uint8_t* data, int64_t len);
 
   // Set to true if --disk_spill_encryption is true.  When true, blocks will be encrypted
   // before being written to disk.
@@ -578,6 +676,10 @@ class BufferedBlockMgr {
   // will have an integrity check (SHA-256) performed after being read from disk.
   const bool check_integrity_;
 
+  // Codec that blocks are compressed with before being written to disk, set by
+  // --disk_spill_compression_codec. NONE if compression is off.
+  THdfsCompression::type compression_type_;
+
 }; // class BufferedBlockMgr
 
 } // namespace impala.
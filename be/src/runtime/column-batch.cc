@@ -0,0 +1,124 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/column-batch.h"
+
+#include <string.h>
+
+#include "runtime/row-batch.h"
+#include "runtime/tuple-row.h"
+
+using namespace impala;
+using namespace std;
+
+ColumnVector::ColumnVector(const ColumnType& type, int capacity)
+  : type_(type),
+    slot_desc_(NULL),
+    tuple_idx_(-1),
+    capacity_(capacity),
+    slot_size_(type.GetSlotSize()),
+    values_(new uint8_t[capacity * slot_size_]),
+    nulls_(new bool[capacity]) {
+  DCHECK(IsSupportedType(type));
+}
+
+ColumnVector::ColumnVector(const SlotDescriptor* slot_desc, int tuple_idx, int capacity)
+  : type_(slot_desc->type()),
+    slot_desc_(slot_desc),
+    tuple_idx_(tuple_idx),
+    capacity_(capacity),
+    slot_size_(type_.GetSlotSize()),
+    values_(new uint8_t[capacity * slot_size_]),
+    nulls_(new bool[capacity]) {
+  DCHECK(IsSupportedType(type_));
+}
+
+bool ColumnVector::IsSupportedType(const ColumnType& type) {
+  switch (type.type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void ColumnVector::Fill(const void* value) {
+  if (value == NULL) {
+    memset(nulls_.get(), true, capacity_);
+    return;
+  }
+  memset(nulls_.get(), false, capacity_);
+  uint8_t* dst = values_.get();
+  for (int i = 0; i < capacity_; ++i, dst += slot_size_) memcpy(dst, value, slot_size_);
+}
+
+void ColumnVector::Gather(RowBatch* batch, int num_rows) {
+  DCHECK(slot_desc_ != NULL);
+  DCHECK_LE(num_rows, capacity_);
+  const NullIndicatorOffset& null_offset = slot_desc_->null_indicator_offset();
+  const int slot_offset = slot_desc_->tuple_offset();
+  uint8_t* dst = values_.get();
+  for (int i = 0; i < num_rows; ++i, dst += slot_size_) {
+    Tuple* tuple = batch->GetRow(i)->GetTuple(tuple_idx_);
+    nulls_[i] = tuple == NULL || tuple->IsNull(null_offset);
+    if (!nulls_[i]) memcpy(dst, tuple->GetSlot(slot_offset), slot_size_);
+  }
+}
+
+ColumnBatch::ColumnBatch(int capacity)
+  : capacity_(capacity),
+    num_rows_(0),
+    num_selected_(0),
+    selection_(new int[capacity]) {
+}
+
+ColumnBatch::~ColumnBatch() {
+  for (int i = 0; i < columns_.size(); ++i) delete columns_[i];
+}
+
+ColumnVector* ColumnBatch::AddColumn(const SlotDescriptor* slot_desc, int tuple_idx) {
+  ColumnVector* column = GetColumn(slot_desc->id());
+  if (column != NULL) return column;
+  column = new ColumnVector(slot_desc, tuple_idx, capacity_);
+  columns_.push_back(column);
+  return column;
+}
+
+ColumnVector* ColumnBatch::GetColumn(SlotId slot_id) const {
+  // Batches have only a handful of columns.
+  for (int i = 0; i < columns_.size(); ++i) {
+    if (columns_[i]->slot_desc()->id() == slot_id) return columns_[i];
+  }
+  return NULL;
+}
+
+void ColumnBatch::Reset(int num_rows) {
+  DCHECK_LE(num_rows, capacity_);
+  num_rows_ = num_rows;
+  num_selected_ = num_rows;
+  for (int i = 0; i < num_rows; ++i) selection_[i] = i;
+}
+
+void ColumnBatch::Gather(RowBatch* batch) {
+  Reset(batch->num_rows());
+  for (int i = 0; i < columns_.size(); ++i) columns_[i]->Gather(batch, num_rows_);
+}
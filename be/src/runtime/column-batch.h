@@ -0,0 +1,142 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_RUNTIME_COLUMN_BATCH_H
+#define IMPALA_RUNTIME_COLUMN_BATCH_H
+
+#include <vector>
+#include <boost/scoped_array.hpp>
+
+#include "common/logging.h"
+#include "runtime/descriptors.h"
+#include "runtime/tuple.h"
+#include "runtime/types.h"
+
+namespace impala {
+
+class RowBatch;
+
+// A vector of up to 'capacity' values of a single type, stored contiguously in the
+// same representation as in a tuple slot (e.g. StringValue for strings), with a
+// separate null indicator per value.
+// A column vector either holds the values of a slot (see ColumnBatch) or the
+// intermediate results of a VectorizedExpr.
+class ColumnVector {
+ public:
+  // Creates a vector for the intermediate results of type 'type'.
+  ColumnVector(const ColumnType& type, int capacity);
+
+  // Creates a vector for the values of the slot 'slot_desc' of the tuple at 'tuple_idx'
+  // in the rows of a RowBatch.
+  ColumnVector(const SlotDescriptor* slot_desc, int tuple_idx, int capacity);
+
+  // Returns true if values of 'type' can be stored in a column vector. Only types with
+  // a fixed-size slot that are cheap to copy are supported.
+  static bool IsSupportedType(const ColumnType& type);
+
+  const ColumnType& type() const { return type_; }
+  int capacity() const { return capacity_; }
+
+  // The slot this vector holds the values of, or NULL for intermediate results.
+  const SlotDescriptor* slot_desc() const { return slot_desc_; }
+
+  template <typename T> T* values() { return reinterpret_cast<T*>(values_.get()); }
+  bool* nulls() { return nulls_.get(); }
+
+  // Returns the memory of the i-th value, in the format of a tuple slot.
+  void* GetSlot(int i) { return values_.get() + i * slot_size_; }
+
+  // Returns the i-th value, or NULL if it is null.
+  void* GetValue(int i) { return nulls_[i] ? NULL : GetSlot(i); }
+
+  // Sets all 'capacity' values to 'value', which is NULL for a null value. String data
+  // is not copied.
+  void Fill(const void* value);
+
+  // Copies the slot of the first 'num_rows' rows of 'batch' into this vector, which
+  // must be a slot vector. A row whose tuple is NULL has a null value. String data is
+  // not copied.
+  void Gather(RowBatch* batch, int num_rows);
+
+  // Writes the i-th value into the slot of 'tuple', which must be of the tuple of
+  // slot_desc(). String data is not copied.
+  void Scatter(int i, Tuple* tuple) {
+    DCHECK(slot_desc_ != NULL);
+    if (nulls_[i]) {
+      tuple->SetNull(slot_desc_->null_indicator_offset());
+    } else {
+      memcpy(tuple->GetSlot(slot_desc_->tuple_offset()), GetSlot(i), slot_size_);
+    }
+  }
+
+ private:
+  const ColumnType type_;
+  const SlotDescriptor* slot_desc_;
+  const int tuple_idx_;
+  const int capacity_;
+  const int slot_size_;
+  boost::scoped_array<uint8_t> values_;
+  boost::scoped_array<bool> nulls_;
+};
+
+// A batch of up to 'capacity' rows in columnar form: one ColumnVector per slot that is
+// accessed, and a selection vector with the indexes of the rows that have not been
+// filtered out, in increasing order. VectorizedExprs evaluate predicates over the
+// selected rows of a column batch and narrow the selection to the rows that pass.
+// Exec nodes still exchange RowBatches. A column batch is either filled directly (e.g.
+// by a scanner that decodes the columns of the rows before materializing their tuples)
+// or gathered from the rows of a RowBatch.
+class ColumnBatch {
+ public:
+  explicit ColumnBatch(int capacity);
+  ~ColumnBatch();
+
+  // Returns the vector of the slot 'slot_desc' of the tuple at 'tuple_idx' in the rows
+  // of the batch, and adds it if the slot has none yet. The slot's type must be
+  // supported, see ColumnVector::IsSupportedType().
+  ColumnVector* AddColumn(const SlotDescriptor* slot_desc, int tuple_idx);
+
+  // Returns the vector of the slot 'slot_id', or NULL if the slot has none.
+  ColumnVector* GetColumn(SlotId slot_id) const;
+
+  const std::vector<ColumnVector*>& columns() const { return columns_; }
+  int capacity() const { return capacity_; }
+  int num_rows() const { return num_rows_; }
+
+  int num_selected() const { return num_selected_; }
+  int* selection() { return selection_.get(); }
+  void set_num_selected(int num_selected) {
+    DCHECK_LE(num_selected, num_selected_);
+    num_selected_ = num_selected;
+  }
+
+  // Sets the number of rows in the batch and selects all of them. The column values
+  // must be filled in by the caller.
+  void Reset(int num_rows);
+
+  // Fills all columns from the rows of 'batch' and selects all of them.
+  void Gather(RowBatch* batch);
+
+ private:
+  const int capacity_;
+  int num_rows_;
+  int num_selected_;
+  std::vector<ColumnVector*> columns_;
+  boost::scoped_array<int> selection_;
+};
+
+}
+
+#endif
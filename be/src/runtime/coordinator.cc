@@ -14,6 +14,7 @@
 
 #include "runtime/coordinator.h"
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <thrift/protocol/TDebugProtocol.h>
@@ -48,6 +49,7 @@
 #include "statestore/scheduler.h"
 #include "exec/data-sink.h"
 #include "exec/scan-node.h"
+#include "util/bloom-filter.h"
 #include "util/debug-util.h"
 #include "util/hdfs-util.h"
 #include "util/hdfs-bulk-ops.h"
@@ -238,6 +240,7 @@ Coordinator::Coordinator(ExecEnv* exec_env, RuntimeProfile::EventSequence* event
 }
 
 Coordinator::~Coordinator() {
+  filter_publish_threads_.JoinAll();
   query_mem_tracker_.reset();
 }
 
@@ -364,6 +367,7 @@ Status Coordinator::Exec(QuerySchedule& schedule, vector<ExprContext*>* output_e
 
   // Initialize the execution profile structures.
   InitExecProfile(request);
+  InitFilterRouting(request);
 
   DebugOptions debug_options;
   ProcessQueryOptions(schedule.query_options(), &debug_options);
@@ -1296,6 +1300,163 @@ Status Coordinator::UpdateFragmentExecStatus(const TReportExecStatusParams& para
   return Status::OK;
 }
 
+void Coordinator::InitFilterRouting(const TQueryExecRequest& request) {
+  unordered_map<TupleId, vector<int> > tuple_scan_fragment_idxs;
+  for (int i = 0; i < request.fragments.size(); ++i) {
+    if (!request.fragments[i].__isset.plan) continue;
+    const TPlan& plan = request.fragments[i].plan;
+    for (int j = 0; j < plan.nodes.size(); ++j) {
+      node_fragment_idxs_[plan.nodes[j].node_id] = i;
+      if (plan.nodes[j].node_type == TPlanNodeType::HDFS_SCAN_NODE) {
+        tuple_scan_fragment_idxs[plan.nodes[j].hdfs_scan_node.tuple_id].push_back(i);
+      }
+    }
+  }
+  BOOST_FOREACH(const TSlotDescriptor& slot, desc_tbl_.slotDescriptors) {
+    unordered_map<TupleId, vector<int> >::const_iterator it =
+        tuple_scan_fragment_idxs.find(slot.parent);
+    if (it == tuple_scan_fragment_idxs.end()) continue;
+    slot_scan_fragment_idxs_[slot.id] = it->second;
+  }
+}
+
+Status Coordinator::UpdateFilter(const TUpdateFilterParams& params) {
+  unordered_map<PlanNodeId, int>::const_iterator fragment =
+      node_fragment_idxs_.find(params.node_id);
+  if (fragment == node_fragment_idxs_.end()) {
+    return Status(TStatusCode::INTERNAL_ERROR, "unknown plan node id");
+  }
+  Status filter_status;
+  if (params.__isset.bloom_filter) {
+    filter_status = BloomFilter::ValidateThrift(params.bloom_filter);
+  }
+  shared_ptr<BloomFilter> filter_to_publish;
+  {
+    lock_guard<mutex> l(filter_lock_);
+    pair<PlanNodeId, SlotId> key(params.node_id, params.slot_id);
+    FilterStateMap::iterator it = filters_.find(key);
+    if (it == filters_.end()) {
+      FilterState state;
+      // The coordinator fragment has a single instance and no entry in
+      // backend_exec_states_.
+      state.pending_count = fragment->second == 0 && executor_.get() != NULL ?
+          1 : fragment_profiles_[fragment->second].num_instances;
+      state.disabled = false;
+      it = filters_.insert(make_pair(key, state)).first;
+    }
+    FilterState* state = &it->second;
+    if (state->pending_count == 0) {
+      return Status(TStatusCode::INTERNAL_ERROR, "duplicate runtime filter");
+    }
+    --state->pending_count;
+    // Without this instance's filter, the union would reject some of its build rows.
+    if (!params.__isset.bloom_filter || !filter_status.ok()) {
+      state->disabled = true;
+      state->filter.reset();
+    } else if (!state->disabled) {
+      shared_ptr<BloomFilter> filter(new BloomFilter(params.bloom_filter));
+      // The instances of a partitioned join size their filters from their own share
+      // of the build rows, so their sizes can differ. Keep the union at the smallest.
+      if (state->filter.get() != NULL) {
+        if (filter->log_num_buckets() <= state->filter->log_num_buckets()) {
+          filter->Or(*state->filter);
+        } else {
+          state->filter->Or(*filter);
+          filter = state->filter;
+        }
+      }
+      state->filter = filter;
+    }
+    if (state->pending_count > 0 || state->disabled) return filter_status;
+    filter_to_publish.swap(state->filter);
+    DCHECK(filter_to_publish.get() != NULL);
+    VLOG_QUERY << "Publishing runtime filter of node " << params.node_id << " on slot "
+               << params.slot_id << " for query_id=" << query_id_ << ": "
+               << filter_to_publish->size_in_bytes() << " bytes";
+    // Publishing makes an rpc to every instance that scans the slot. Don't hold up the
+    // rpc from the instance that sent the last filter, which waits for our reply.
+    stringstream ss;
+    ss << "publish-filter-" << params.node_id << "-" << params.slot_id;
+    filter_publish_threads_.AddThread(new Thread("coordinator", ss.str(),
+        &Coordinator::PublishFilter, this, params.slot_id, filter_to_publish));
+  }
+  return Status::OK;
+}
+
+void Coordinator::PublishFilter(SlotId slot, shared_ptr<BloomFilter> filter) {
+  unordered_map<SlotId, vector<int> >::const_iterator fragment_idxs =
+      slot_scan_fragment_idxs_.find(slot);
+  if (fragment_idxs == slot_scan_fragment_idxs_.end()) return;
+  const vector<int>& targets = fragment_idxs->second;
+
+  TPublishFilterParams params;
+  params.protocol_version = ImpalaInternalServiceVersion::V1;
+  params.__set_slot_id(slot);
+  filter->ToThrift(&params.bloom_filter);
+  params.__isset.bloom_filter = true;
+
+  vector<BackendExecState*> exec_states;
+  {
+    // Wait for Exec() to start all fragments.
+    lock_guard<mutex> l(lock_);
+    if (!query_status_.ok()) return;
+    if (executor_.get() != NULL &&
+        find(targets.begin(), targets.end(), 0) != targets.end()) {
+      Status status =
+          executor_->runtime_state()->PublishBloomFilter(slot, params.bloom_filter);
+      DCHECK(status.ok()) << status.GetErrorMsg();
+    }
+    for (int i = 0; i < backend_exec_states_.size(); ++i) {
+      BackendExecState* exec_state = backend_exec_states_[i];
+      if (exec_state == NULL) continue;
+      if (find(targets.begin(), targets.end(), exec_state->fragment_idx) ==
+          targets.end()) {
+        continue;
+      }
+      lock_guard<mutex> l2(exec_state->lock);
+      if (!exec_state->initiated || exec_state->done) continue;
+      exec_states.push_back(exec_state);
+    }
+  }
+  if (exec_states.empty()) return;
+
+  // Filters are an optimization: failed rpcs are logged in PublishFilterToBackend() but
+  // don't fail the query.
+  ParallelExecutor::Exec(
+      bind<Status>(mem_fn(&Coordinator::PublishFilterToBackend), this, &params, _1),
+      reinterpret_cast<void**>(&exec_states[0]), exec_states.size());
+}
+
+Status Coordinator::PublishFilterToBackend(const TPublishFilterParams* params,
+    void* exec_state_arg) {
+  BackendExecState* exec_state = reinterpret_cast<BackendExecState*>(exec_state_arg);
+  TPublishFilterParams instance_params = *params;
+  instance_params.__set_dest_fragment_instance_id(exec_state->fragment_instance_id);
+
+  Status status;
+  ImpalaInternalServiceConnection backend_client(
+      exec_env_->impalad_client_cache(), exec_state->backend_address, &status);
+  RETURN_IF_ERROR(status);
+  TPublishFilterResult res;
+  try {
+    try {
+      backend_client->PublishFilter(res, instance_params);
+    } catch (const TException& e) {
+      VLOG_RPC << "Retrying PublishFilter: " << e.what();
+      RETURN_IF_ERROR(backend_client.Reopen());
+      backend_client->PublishFilter(res, instance_params);
+    }
+  } catch (const TException& e) {
+    stringstream msg;
+    msg << "PublishFilter rpc query_id=" << query_id_
+        << " instance_id=" << exec_state->fragment_instance_id
+        << " failed: " << e.what();
+    VLOG_QUERY << msg.str();
+    return Status(msg.str());
+  }
+  return Status(res.status);
+}
+
 const RowDescriptor& Coordinator::row_desc() const {
   DCHECK(executor_.get() != NULL);
   return executor_->row_desc();
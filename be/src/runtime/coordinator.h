@@ -16,6 +16,7 @@
 #ifndef IMPALA_RUNTIME_COORDINATOR_H
 #define IMPALA_RUNTIME_COORDINATOR_H
 
+#include <map>
 #include <vector>
 #include <string>
 #include <boost/scoped_ptr.hpp>
@@ -36,6 +37,7 @@
 #include "common/global-types.h"
 #include "util/progress-updater.h"
 #include "util/runtime-profile.h"
+#include "util/thread.h"
 #include "runtime/runtime-state.h"
 #include "statestore/simple-scheduler.h"
 #include "gen-cpp/Types_types.h"
@@ -43,6 +45,7 @@
 
 namespace impala {
 
+class BloomFilter;
 class DataStreamMgr;
 class DataSink;
 class RowBatch;
@@ -57,6 +60,8 @@ class ExecEnv;
 class TUpdateCatalogRequest;
 class TQueryExecRequest;
 class TReportExecStatusParams;
+class TUpdateFilterParams;
+class TPublishFilterParams;
 class TRowBatch;
 class TPlanExecRequest;
 class TRuntimeProfileTree;
@@ -136,6 +141,13 @@ class Coordinator {
   // to CancelInternal().
   Status UpdateFragmentExecStatus(const TReportExecStatusParams& params);
 
+  // Merges the runtime filter sent by one instance of a join (see
+  // RuntimeState::SendBloomFilter()) into the filter of that join on the slot. Once all
+  // instances of the join's fragment have sent theirs, publishes the union to all
+  // instances of the fragments that scan the slot. If an instance could not build its
+  // filter, nothing is published. Thread safe.
+  Status UpdateFilter(const TUpdateFilterParams& params);
+
   // only valid *after* calling Exec(), and may return NULL if there is no executor
   RuntimeState* runtime_state();
   const RowDescriptor& row_desc() const;
@@ -338,6 +350,35 @@ class Coordinator {
   // Total time spent in finalization (typically 0 except for INSERT into hdfs tables)
   RuntimeProfile::Counter* finalization_timer_;
 
+  // Runtime filter of a join on one of its probe side slots, merged from the filters
+  // sent by the instances of the join's fragment.
+  struct FilterState {
+    // Number of instances whose filter has not arrived yet.
+    int pending_count;
+
+    // Union of the filters that have arrived. NULL once it has been published or if
+    // the filter is disabled.
+    boost::shared_ptr<BloomFilter> filter;
+
+    // True if an instance could not build its filter.
+    bool disabled;
+  };
+
+  // Runtime filters by join node id and slot id.
+  typedef std::map<std::pair<PlanNodeId, SlotId>, FilterState> FilterStateMap;
+  FilterStateMap filters_;
+
+  // Protects filters_ and filter_publish_threads_. Never held while acquiring lock_.
+  boost::mutex filter_lock_;
+
+  // One thread per published filter, running PublishFilter(). Joined in the destructor.
+  ThreadGroup filter_publish_threads_;
+
+  // The fragment of each plan node, and the fragments that scan the tuple of each slot
+  // with an HDFS scan node, by fragment idx. Set in Exec() and read-only afterwards.
+  boost::unordered_map<PlanNodeId, int> node_fragment_idxs_;
+  boost::unordered_map<SlotId, std::vector<int> > slot_scan_fragment_idxs_;
+
   // Fill in rpc_params based on parameters.
   void SetExecPlanFragmentParams(QuerySchedule& schedule,
       int backend_num, const TPlanFragment& fragment,
@@ -353,6 +394,19 @@ class Coordinator {
   // always be an instance of BackendExecState.
   Status ExecRemoteFragment(void* exec_state);
 
+  // Initializes node_fragment_idxs_ and slot_scan_fragment_idxs_ from the plan.
+  void InitFilterRouting(const TQueryExecRequest& request);
+
+  // Sends the runtime filter 'filter' on 'slot' to all instances of the fragments that
+  // scan 'slot'. Instances of fragments that have not been started or have finished
+  // are skipped.
+  void PublishFilter(SlotId slot, boost::shared_ptr<BloomFilter> filter);
+
+  // Wrapper for the PublishFilter() rpc to the fragment instance of 'exec_state',
+  // called in parallel from multiple threads. 'params' is copied and completed with the
+  // instance's id.
+  Status PublishFilterToBackend(const TPublishFilterParams* params, void* exec_state);
+
   // Determine fragment number, given fragment id.
   int GetFragmentNum(const TUniqueId& fragment_id);
 
@@ -84,7 +84,8 @@ shared_ptr<DataStreamRecvr> DataStreamMgr::FindRecvr(
 
 Status DataStreamMgr::AddData(
     const TUniqueId& fragment_instance_id, PlanNodeId dest_node_id,
-    const TRowBatch& thrift_batch, int sender_id) {
+    const TRowBatch& thrift_batch, int sender_id, int64_t* wait_time_ns) {
+  if (wait_time_ns != NULL) *wait_time_ns = 0;
   VLOG_ROW << "AddData(): fragment_instance_id=" << fragment_instance_id
            << " node=" << dest_node_id
            << " size=" << RowBatch::GetBatchSize(thrift_batch);
@@ -100,7 +101,25 @@ Status DataStreamMgr::AddData(
     // errors from receiver-initiated teardowns.
     return Status::OK;
   }
-  recvr->AddBatch(thrift_batch, sender_id);
+  int64_t recvr_wait_time_ns = recvr->AddBatch(thrift_batch, sender_id);
+  if (wait_time_ns != NULL) *wait_time_ns = recvr_wait_time_ns;
+  return Status::OK;
+}
+
+Status DataStreamMgr::AddData(
+    const TUniqueId& fragment_instance_id, PlanNodeId dest_node_id,
+    RowBatch* batch, int sender_id) {
+  VLOG_ROW << "AddData(): fragment_instance_id=" << fragment_instance_id
+           << " node=" << dest_node_id
+           << " #rows=" << batch->num_rows();
+  shared_ptr<DataStreamRecvr> recvr =
+      FindRecvr(fragment_instance_id, dest_node_id);
+  if (recvr == NULL) {
+    // See the comment in AddData() above.
+    batch->Reset();
+    return Status::OK;
+  }
+  recvr->AddBatch(batch, sender_id);
   return Status::OK;
 }
 
@@ -77,9 +77,18 @@ class DataStreamMgr {
   // row_batch.
   // TODO: enforce per-sender quotas (something like 200% of buffer_size/#senders),
   // so that a single sender can't flood the buffer and stall everybody else.
+  // If 'wait_time_ns' is non-NULL, it is set to the time in ns that the call blocked
+  // on the full buffer.
   // Returns OK if successful, error status otherwise.
   Status AddData(const TUniqueId& fragment_instance_id, PlanNodeId dest_node_id,
-                 const TRowBatch& thrift_batch, int sender_id);
+                 const TRowBatch& thrift_batch, int sender_id,
+                 int64_t* wait_time_ns = NULL);
+
+  // Same as above for a sender in this process: the rows of 'batch' and the resources
+  // that back them are handed to the recvr without serializing them, and 'batch' is
+  // reset. All of the tuple data referenced by 'batch' must be owned by it.
+  Status AddData(const TUniqueId& fragment_instance_id, PlanNodeId dest_node_id,
+                 RowBatch* batch, int sender_id);
 
   // Notifies the recvr associated with the fragment/node id that the specified
   // sender has closed.
@@ -20,6 +20,7 @@
 #include "runtime/row-batch.h"
 #include "runtime/sorted-run-merger.h"
 #include "util/runtime-profile.h"
+#include "util/stopwatch.h"
 #include "util/periodic-counter-updater.h"
 
 using namespace std;
@@ -46,7 +47,15 @@ class DataStreamRecvr::SenderQueue {
   // blocks if this will make the stream exceed its buffer limit.
   // If the total size of the batches in this queue would exceed the allowed buffer size,
   // the queue is considered full and the call blocks until a batch is dequeued.
-  void AddBatch(const TRowBatch& batch);
+  // The batch is deserialized without holding lock_, so that the batches of several
+  // senders can be deserialized at the same time and the consumer is not blocked.
+  // Returns the time in ns that the call blocked on the full buffer.
+  int64_t AddBatch(const TRowBatch& batch);
+
+  // Adds the rows of 'batch', which comes from a sender in this process, to this sender
+  // queue, taking over the resources of 'batch' with
+  // RowBatch::TransferResourceOwnership(), and resets 'batch'. Blocks like the above.
+  void AddBatch(RowBatch* batch);
 
   // Decrement the number of remaining senders for this queue and signal eos ("new data")
   // if the count drops to 0. The number of senders will be 1 for a merging
@@ -83,6 +92,10 @@ class DataStreamRecvr::SenderQueue {
   // signal removal of data by stream consumer
   condition_variable data_removal__cv_;
 
+  // number of batches that are being deserialized by AddBatch() and will be added to
+  // batch_queue_. Their sizes are already included in recvr_->num_buffered_bytes_.
+  int num_pending_batches_;
+
   // queue of (batch length, batch) pairs.  The SenderQueue block owns memory to
   // these batches. They are handed off to the caller via GetBatch.
   typedef list<pair<int, RowBatch*> > RowBatchQueue;
@@ -95,6 +108,10 @@ class DataStreamRecvr::SenderQueue {
 
   // Set to true when the first batch has been received
   bool received_first_batch_;
+
+  // Waits until a batch of 'batch_size' bytes fits into the buffer or the stream is
+  // cancelled. 'lock' must hold lock_. Returns the time in ns that it waited.
+  int64_t WaitForSpace(unique_lock<mutex>* lock, int batch_size);
 };
 
 DataStreamRecvr::SenderQueue::SenderQueue(DataStreamRecvr* parent_recvr, int num_senders,
@@ -102,6 +119,7 @@ DataStreamRecvr::SenderQueue::SenderQueue(DataStreamRecvr* parent_recvr, int num
   : recvr_(parent_recvr),
     is_cancelled_(false),
     num_remaining_senders_(num_senders),
+    num_pending_batches_(0),
     received_first_batch_(false) {
 }
 
@@ -140,22 +158,89 @@ Status DataStreamRecvr::SenderQueue::GetBatch(RowBatch** next_batch) {
   return Status::OK;
 }
 
-void DataStreamRecvr::SenderQueue::AddBatch(const TRowBatch& thrift_batch) {
+int64_t DataStreamRecvr::SenderQueue::AddBatch(const TRowBatch& thrift_batch) {
   unique_lock<mutex> l(lock_);
-  if (is_cancelled_) return;
+  if (is_cancelled_) return 0;
 
   int batch_size = RowBatch::GetBatchSize(thrift_batch);
   COUNTER_ADD(recvr_->bytes_received_counter_, batch_size);
   DCHECK_GT(num_remaining_senders_, 0);
 
+  int64_t wait_time_ns = WaitForSpace(&l, batch_size);
+  if (is_cancelled_) return wait_time_ns;
+
+  // Reserve the space of the batch before deserializing it outside of lock_.
+  recvr_->num_buffered_bytes_ += batch_size;
+  ++num_pending_batches_;
+  RowBatch* batch = NULL;
+  l.unlock();
+  {
+    SCOPED_TIMER(recvr_->deserialize_row_batch_timer_);
+    // Note: if this function makes a row batch, the batch *must* be added
+    // to batch_queue_. It is not valid to create the row batch and destroy
+    // it in this thread.
+    batch = new RowBatch(recvr_->row_desc(), thrift_batch, recvr_->mem_tracker());
+  }
+  l.lock();
+
+  // The batch is queued even if the stream got cancelled in the meantime; Close()
+  // deletes it.
+  VLOG_ROW << "added #rows=" << batch->num_rows()
+           << " batch_size=" << batch_size << "\n";
+  batch_queue_.push_back(make_pair(batch_size, batch));
+  --num_pending_batches_;
+  // Close() may be waiting for the pending batches as well as the consumer.
+  data_arrival_cv_.notify_all();
+  return wait_time_ns;
+}
+
+void DataStreamRecvr::SenderQueue::AddBatch(RowBatch* src) {
+  unique_lock<mutex> l(lock_);
+  if (is_cancelled_ || src->num_rows() == 0) {
+    src->Reset();
+    return;
+  }
+
+  // The row pointers are allocated from the tuple data pool as well. The io buffers and
+  // tuple streams are handed over with the batch and stay buffered as long as it does.
+  int batch_size = src->TransferableBytes();
+  COUNTER_ADD(recvr_->bytes_received_counter_, batch_size);
+  DCHECK_GT(num_remaining_senders_, 0);
+  WaitForSpace(&l, batch_size);
+  if (is_cancelled_) {
+    src->Reset();
+    return;
+  }
+
+  // Only the row pointers are copied; the tuple data stays where it is.
+  RowBatch* batch = new RowBatch(recvr_->row_desc(), src->num_rows(),
+      recvr_->mem_tracker());
+  batch->AddRows(src->num_rows());
+  for (int i = 0; i < src->num_rows(); ++i) {
+    batch->CopyRow(src->GetRow(i), batch->GetRow(i));
+  }
+  batch->CommitRows(src->num_rows());
+  src->TransferResourceOwnership(batch);
+  VLOG_ROW << "added local #rows=" << batch->num_rows()
+           << " batch_size=" << batch_size << "\n";
+  batch_queue_.push_back(make_pair(batch_size, batch));
+  recvr_->num_buffered_bytes_ += batch_size;
+  data_arrival_cv_.notify_all();
+}
+
+int64_t DataStreamRecvr::SenderQueue::WaitForSpace(unique_lock<mutex>* lock,
+    int batch_size) {
+  MonotonicStopWatch wait_watch;
+  wait_watch.Start();
   // if there's something in the queue and this batch will push us over the
   // buffer limit we need to wait until the batch gets drained.
-  // Note: It's important that we enqueue thrift_batch regardless of buffer limit if
+  // Note: It's important that we enqueue a batch regardless of buffer limit if
   // the queue is currently empty. In the case of a merging receiver, batches are
   // received from a specific queue based on data order, and the pipeline will stall
   // if the merger is waiting for data from an empty queue that cannot be filled because
-  // the limit has been reached.
-  while (!batch_queue_.empty() && recvr_->ExceedsLimit(batch_size) && !is_cancelled_) {
+  // the limit has been reached. Batches that are being deserialized count as queued.
+  while ((!batch_queue_.empty() || num_pending_batches_ > 0)
+      && recvr_->ExceedsLimit(batch_size) && !is_cancelled_) {
     SCOPED_TIMER(recvr_->buffer_full_total_timer_);
     VLOG_ROW << " wait removal: empty=" << (batch_queue_.empty() ? 1 : 0)
              << " #buffered=" << recvr_->num_buffered_bytes_
@@ -169,10 +254,10 @@ void DataStreamRecvr::SenderQueue::AddBatch(const TRowBatch& thrift_batch) {
       try_mutex::scoped_try_lock timer_lock(recvr_->buffer_wall_timer_lock_);
       if (timer_lock) {
         SCOPED_TIMER(recvr_->buffer_full_wall_timer_);
-        data_removal__cv_.wait(l);
+        data_removal__cv_.wait(*lock);
         got_timer_lock = true;
       } else {
-        data_removal__cv_.wait(l);
+        data_removal__cv_.wait(*lock);
         got_timer_lock = false;
       }
     }
@@ -193,22 +278,7 @@ void DataStreamRecvr::SenderQueue::AddBatch(const TRowBatch& thrift_batch) {
     // practice, this time is small relative to the total wait time.
     if (got_timer_lock) data_removal__cv_.notify_one();
   }
-
-  if (!is_cancelled_) {
-    RowBatch* batch = NULL;
-    {
-      SCOPED_TIMER(recvr_->deserialize_row_batch_timer_);
-      // Note: if this function makes a row batch, the batch *must* be added
-      // to batch_queue_. It is not valid to create the row batch and destroy
-      // it in this thread.
-      batch = new RowBatch(recvr_->row_desc(), thrift_batch, recvr_->mem_tracker());
-    }
-    VLOG_ROW << "added #rows=" << batch->num_rows()
-             << " batch_size=" << batch_size << "\n";
-    batch_queue_.push_back(make_pair(batch_size, batch));
-    recvr_->num_buffered_bytes_ += batch_size;
-    data_arrival_cv_.notify_one();
-  }
+  return wait_watch.ElapsedTime();
 }
 
 void DataStreamRecvr::SenderQueue::DecrementSenders() {
@@ -240,6 +310,11 @@ void DataStreamRecvr::SenderQueue::Cancel() {
 }
 
 void DataStreamRecvr::SenderQueue::Close() {
+  {
+    // Wait for the batches that are being deserialized to be queued.
+    unique_lock<mutex> l(lock_);
+    while (num_pending_batches_ > 0) data_arrival_cv_.wait(l);
+  }
   // Delete any batches queued in batch_queue_
   for (RowBatchQueue::iterator it = batch_queue_.begin();
       it != batch_queue_.end(); ++it) {
@@ -314,10 +389,16 @@ Status DataStreamRecvr::GetNext(RowBatch* output_batch, bool* eos) {
   return merger_->GetNext(output_batch, eos);
 }
 
-void DataStreamRecvr::AddBatch(const TRowBatch& thrift_batch, int sender_id) {
+int64_t DataStreamRecvr::AddBatch(const TRowBatch& thrift_batch, int sender_id) {
+  int use_sender_id = is_merging_ ? sender_id : 0;
+  // Add all batches to the same queue if is_merging_ is false.
+  return sender_queues_[use_sender_id]->AddBatch(thrift_batch);
+}
+
+void DataStreamRecvr::AddBatch(RowBatch* batch, int sender_id) {
   int use_sender_id = is_merging_ ? sender_id : 0;
   // Add all batches to the same queue if is_merging_ is false.
-  sender_queues_[use_sender_id]->AddBatch(thrift_batch);
+  sender_queues_[use_sender_id]->AddBatch(batch);
 }
 
 void DataStreamRecvr::RemoveSender(int sender_id) {
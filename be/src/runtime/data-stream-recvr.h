@@ -100,8 +100,12 @@ class DataStreamRecvr {
       RuntimeProfile* profile);
 
   // Add a new batch of rows to the appropriate sender queue, blocking if the queue is
-  // full. Called from DataStreamMgr.
-  void AddBatch(const TRowBatch& thrift_batch, int sender_id);
+  // full. Called from DataStreamMgr. Returns the time in ns that it blocked.
+  int64_t AddBatch(const TRowBatch& thrift_batch, int sender_id);
+
+  // Same as above for a batch from a sender in this process. The rows and resources of
+  // 'batch' are transferred to a new batch in the queue, and 'batch' is reset.
+  void AddBatch(RowBatch* batch, int sender_id);
 
   // Indicate that a particular sender is done. Delegated to the appropriate
   // sender queue. Called from DataStreamMgr.
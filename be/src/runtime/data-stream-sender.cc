@@ -21,15 +21,19 @@
 #include "common/logging.h"
 #include "exprs/expr.h"
 #include "exprs/expr-context.h"
+#include "runtime/data-stream-mgr.h"
 #include "runtime/descriptors.h"
+#include "runtime/exec-env.h"
 #include "runtime/tuple-row.h"
 #include "runtime/row-batch.h"
 #include "runtime/raw-value.h"
 #include "runtime/runtime-state.h"
+#include "runtime/spatial-grid.h"
 #include "runtime/client-cache.h"
 #include "runtime/mem-tracker.h"
 #include "util/debug-util.h"
 #include "util/network-util.h"
+#include "util/stopwatch.h"
 #include "rpc/thrift-client.h"
 #include "rpc/thrift-util.h"
 
@@ -43,15 +47,33 @@ using namespace apache::thrift;
 using namespace apache::thrift::protocol;
 using namespace apache::thrift::transport;
 
+DEFINE_int32(datastream_sender_max_batches_in_flight, 4, "Maximum number of serialized "
+    "row batches that each channel of a data stream sender may have queued or in flight "
+    "at any time. The sender serializes the next batches while earlier ones are being "
+    "sent, and blocks once this many are outstanding.");
+DEFINE_bool(adaptive_exchange_compression, true, "If true, data stream senders choose "
+    "the codec of each row batch from none, LZ4 and Snappy, based on the compression "
+    "ratio and speed measured for the data and the throughput measured for the link. "
+    "If false, all row batches are compressed with LZ4.");
+
 namespace impala {
 
 // A channel sends data asynchronously via calls to TransmitData
 // to a single destination ipaddress/node.
 // It has a fixed-capacity buffer and allows the caller either to add rows to
 // that buffer individually (AddRow()), or circumvent the buffer altogether and send
-// TRowBatches directly (SendBatch()). Either way, there can only be one in-flight RPC
-// at any one time (ie, sending will block if the most recent rpc hasn't finished,
-// which allows the receiver node to throttle the sender by withholding acks).
+// TRowBatches directly (SendBatch()).
+// Batches are sent in order by a single rpc thread. Up to
+// FLAGS_datastream_sender_max_batches_in_flight of them can be queued or in flight, so
+// that the caller can serialize the next batches while the rpcs of the earlier ones are
+// under way. Each batch takes up one of these credits until its rpc finishes; once all
+// are taken, sending blocks until a credit is returned, which allows the receiver node
+// to throttle the sender by withholding acks. Batches serialized by the channel itself
+// go into a ring of TRowBatches that is reused, so that their buffers are allocated
+// only once.
+// If the destination runs in this impalad, the channel bypasses thrift altogether: rows
+// are always copied into batch_, which is handed to the local DataStreamMgr together
+// with the memory that backs it once it is full.
 // *Not* thread-safe.
 class DataStreamSender::Channel {
  public:
@@ -70,9 +92,12 @@ class DataStreamSender::Channel {
       fragment_instance_id_(fragment_instance_id),
       dest_node_id_(dest_node_id),
       num_data_bytes_sent_(0),
-      rpc_thread_("DataStreamSender", "SenderThread", 1, 1,
+      thrift_batches_(max(FLAGS_datastream_sender_max_batches_in_flight, 1)),
+      next_thrift_batch_idx_(0),
+      local_stream_mgr_(NULL),
+      rpc_thread_("DataStreamSender", "SenderThread", 1, thrift_batches_.size(),
           bind<void>(mem_fn(&Channel::TransmitData), this, _1, _2)),
-      rpc_in_flight_(false) {
+      num_rpcs_in_flight_(0) {
   }
 
   // Initialize channel.
@@ -84,24 +109,41 @@ class DataStreamSender::Channel {
   // Returns error status if any of the preceding rpcs failed, OK otherwise.
   Status AddRow(TupleRow* row);
 
-  // Asynchronously sends a row batch.
-  // Returns the status of the most recently finished TransmitData
-  // rpc (or OK if there wasn't one that hasn't been reported yet).
+  // Copies all rows of 'batch' with AddRow().
+  Status AddRows(RowBatch* batch);
+
+  // Asynchronously sends a row batch, which must not be modified until the rpc has
+  // finished, see WaitForCredit(). The caller must have a credit.
+  // Returns the error of a failed TransmitData rpc, if any has failed so far.
   Status SendBatch(TRowBatch* batch);
 
-  // Return status of last TransmitData rpc (initiated by the most recent call
-  // to either SendBatch() or SendCurrentBatch()).
+  // Serializes 'batch' into the next TRowBatch of the channel's ring and sends it.
+  // Blocks until there is a credit.
+  Status SendRowBatch(RowBatch* batch);
+
+  // Waits for all TransmitData rpcs to finish and returns the error of the first one
+  // that failed, or OK.
   Status GetSendStatus();
 
-  // Waits for the rpc thread pool to finish the current rpc.
+  // Waits for the rpc thread pool to finish all queued rpcs.
   void WaitForRpc();
 
+  // Waits until fewer than max_batches_in_flight() rpcs are queued or in flight. Once
+  // this returns, the batch sent max_batches_in_flight() calls to SendBatch() ago has
+  // been sent, since rpcs finish in order.
+  void WaitForCredit();
+
+  int max_batches_in_flight() const { return thrift_batches_.size(); }
+
+  // Returns true if the receiver runs in this impalad, in which case only AddRow()
+  // and AddRows() may be used to send rows.
+  bool is_local() const { return local_stream_mgr_ != NULL; }
+
   // Flush buffered rows and close channel.
   // Logs errors if any of the preceding rpcs failed.
   void Close(RuntimeState* state);
 
   int64_t num_data_bytes_sent() const { return num_data_bytes_sent_; }
-  TRowBatch* thrift_batch() { return &thrift_batch_; }
 
  private:
   DataStreamSender* parent_;
@@ -119,30 +161,51 @@ class DataStreamSender::Channel {
 
   // we're accumulating rows into this batch
   scoped_ptr<RowBatch> batch_;
-  TRowBatch thrift_batch_;
+
+  // Ring of batches serialized by SendRowBatch(), one per credit. A batch is reused
+  // once the rpcs of the max_batches_in_flight() - 1 batches sent after it have been
+  // started, by which time its own rpc has finished.
+  vector<TRowBatch> thrift_batches_;
+  int next_thrift_batch_idx_;
+
+  // Set if the destination runs in this impalad.
+  DataStreamMgr* local_stream_mgr_;
+
+  // Chooses the codec of the batches in thrift_batches_.
+  ExchangeCodecSelector codec_selector_;
 
   // We want to reuse the rpc thread to prevent creating a thread per rowbatch.
-  // TODO: currently we only have one batch in flight, but we should buffer more
-  // batches. This is a bit tricky since the channels share the outgoing batch
-  // pointer we need some mechanism to coordinate when the batch is all done.
   // TODO: if the order of row batches does not matter, we can consider increasing
   // the number of threads.
   ThreadPool<TRowBatch*> rpc_thread_; // sender thread.
-  condition_variable rpc_done_cv_;   // signaled when rpc_in_flight_ is set to true.
-  mutex rpc_thread_lock_; // Lock with rpc_done_cv_ protecting rpc_in_flight_
-  bool rpc_in_flight_;  // true if the rpc_thread_ is busy sending.
+  condition_variable rpc_done_cv_;   // signaled when num_rpcs_in_flight_ is decremented.
+  // Lock with rpc_done_cv_ protecting num_rpcs_in_flight_ and rpc_status_.
+  mutex rpc_thread_lock_;
+  int num_rpcs_in_flight_;  // number of batches queued or being sent by rpc_thread_.
 
-  Status rpc_status_;  // status of most recently finished TransmitData rpc
+  // Status of the first failed TransmitData rpc, or OK. Once an rpc failed, the
+  // batches queued after it are dropped.
+  Status rpc_status_;
 
-  // Serialize batch_ into thrift_batch_ and send via SendBatch().
-  // Returns SendBatch() status.
+  // Sends batch_ via SendRowBatch(), or hands it to local_stream_mgr_ if the receiver
+  // is local, and resets it.
   Status SendCurrentBatch();
 
-  // Synchronously call TransmitData() on a client from client_cache_ and update
-  // rpc_status_ based on return value (or set to error if RPC failed).
+  // Returns true if 'batch' is in thrift_batches_, i.e. is not shared with other
+  // channels.
+  bool IsOwnBatch(const TRowBatch* batch) const {
+    return batch >= &thrift_batches_.front() && batch <= &thrift_batches_.back();
+  }
+
+  // Sends 'batch' with a synchronous call to TransmitData() on a client from
+  // client_cache_, updates rpc_status_ if it failed and returns the credit.
   // Called from a thread from the rpc_thread_ pool.
-  void TransmitData(int thread_id, const TRowBatch*);
-  void TransmitDataHelper(const TRowBatch*);
+  void TransmitData(int thread_id, TRowBatch* batch);
+
+  // Sends 'params' and sets 'receiver_wait_time_ns' to the time the receiver reported
+  // to have blocked on its full buffer, or to 0 if it didn't report it.
+  Status TransmitDataHelper(const TTransmitDataParams& params,
+      int64_t* receiver_wait_time_ns);
 
   Status CloseInternal();
 };
@@ -152,39 +215,49 @@ Status DataStreamSender::Channel::Init(RuntimeState* state) {
   // TODO: figure out how to size batch_
   int capacity = max(1, buffer_size_ / max(row_desc_.GetRowSize(), 1));
   batch_.reset(new RowBatch(row_desc_, capacity, parent_->mem_tracker_.get()));
+  if (address_ == state->exec_env()->backend_address()) {
+    local_stream_mgr_ = state->exec_env()->stream_mgr();
+  }
   return Status::OK;
 }
 
 Status DataStreamSender::Channel::SendBatch(TRowBatch* batch) {
   VLOG_ROW << "Channel::SendBatch() instance_id=" << fragment_instance_id_
            << " dest_node=" << dest_node_id_ << " #rows=" << batch->num_rows;
-  // return if the previous batch saw an error
-  RETURN_IF_ERROR(GetSendStatus());
   {
     unique_lock<mutex> l(rpc_thread_lock_);
-    rpc_in_flight_ = true;
+    // return if a previous batch saw an error
+    if (!rpc_status_.ok()) return rpc_status_;
+    DCHECK_LT(num_rpcs_in_flight_, max_batches_in_flight());
+    ++num_rpcs_in_flight_;
   }
   if (!rpc_thread_.Offer(batch)) {
-    unique_lock<mutex> l(rpc_thread_lock_);
-    rpc_in_flight_ = false;
+    {
+      unique_lock<mutex> l(rpc_thread_lock_);
+      --num_rpcs_in_flight_;
+    }
+    rpc_done_cv_.notify_all();
   }
   return Status::OK;
 }
 
-void DataStreamSender::Channel::TransmitData(int thread_id, const TRowBatch* batch) {
-  DCHECK(rpc_in_flight_);
-  TransmitDataHelper(batch);
+Status DataStreamSender::Channel::SendRowBatch(RowBatch* batch) {
+  WaitForCredit();
+  TRowBatch* thrift_batch = &thrift_batches_[next_thrift_batch_idx_];
+  next_thrift_batch_idx_ = (next_thrift_batch_idx_ + 1) % thrift_batches_.size();
+  parent_->SerializeBatch(batch, thrift_batch, &codec_selector_);
+  return SendBatch(thrift_batch);
+}
 
+void DataStreamSender::Channel::TransmitData(int thread_id, TRowBatch* batch) {
+  DCHECK(batch != NULL);
+  Status status;
   {
     unique_lock<mutex> l(rpc_thread_lock_);
-    rpc_in_flight_ = false;
+    DCHECK_GT(num_rpcs_in_flight_, 0);
+    status = rpc_status_;
   }
-  rpc_done_cv_.notify_one();
-}
-
-void DataStreamSender::Channel::TransmitDataHelper(const TRowBatch* batch) {
-  DCHECK(batch != NULL);
-  try {
+  if (status.ok()) {
     VLOG_ROW << "Channel::TransmitData() instance_id=" << fragment_instance_id_
              << " dest_node=" << dest_node_id_
              << " #rows=" << batch->num_rows;
@@ -192,12 +265,50 @@ void DataStreamSender::Channel::TransmitDataHelper(const TRowBatch* batch) {
     params.protocol_version = ImpalaInternalServiceVersion::V1;
     params.__set_dest_fragment_instance_id(fragment_instance_id_);
     params.__set_dest_node_id(dest_node_id_);
-    params.__set_row_batch(*batch);  // yet another copy
     params.__set_eos(false);
     params.__set_sender_id(parent_->sender_id_);
+    // The channel's own batches are moved into the params rather than copied, and
+    // moved back afterwards so that their buffers are reused. Batches shared with other
+    // channels may be read by their rpc threads at the same time, so they are copied.
+    bool own_batch = IsOwnBatch(batch);
+    if (own_batch) {
+      std::swap(params.row_batch, *batch);
+      params.__isset.row_batch = true;
+    } else {
+      params.__set_row_batch(*batch);
+    }
+    MonotonicStopWatch transmit_watch;
+    transmit_watch.Start();
+    int64_t receiver_wait_time_ns;
+    status = TransmitDataHelper(params, &receiver_wait_time_ns);
+    if (status.ok()) {
+      // The time the receiver was back-pressured by its consumer doesn't depend on the
+      // codec, so it is not part of the transmit cost.
+      int64_t transmit_time_ns =
+          max<int64_t>(0, transmit_watch.ElapsedTime() - receiver_wait_time_ns);
+      ExchangeCodecSelector* codec_selector =
+          own_batch ? &codec_selector_ : &parent_->broadcast_codec_selector_;
+      codec_selector->UpdateTransmit(RowBatch::GetBatchSize(params.row_batch),
+          transmit_time_ns);
+    }
+    if (own_batch) std::swap(params.row_batch, *batch);
+  }
 
-    ImpalaInternalServiceConnection client(client_cache_, address_, &rpc_status_);
-    if (!rpc_status_.ok()) return;
+  {
+    unique_lock<mutex> l(rpc_thread_lock_);
+    if (rpc_status_.ok()) rpc_status_ = status;
+    --num_rpcs_in_flight_;
+  }
+  rpc_done_cv_.notify_all();
+}
+
+Status DataStreamSender::Channel::TransmitDataHelper(const TTransmitDataParams& params,
+    int64_t* receiver_wait_time_ns) {
+  *receiver_wait_time_ns = 0;
+  try {
+    Status status;
+    ImpalaInternalServiceConnection client(client_cache_, address_, &status);
+    RETURN_IF_ERROR(status);
 
     TTransmitDataResult res;
     {
@@ -206,33 +317,38 @@ void DataStreamSender::Channel::TransmitDataHelper(const TRowBatch* batch) {
         client->TransmitData(res, params);
       } catch (const TException& e) {
         VLOG_RPC << "Retrying TransmitData: " << e.what();
-        rpc_status_ = client.Reopen();
-        if (!rpc_status_.ok()) {
-          return;
-        }
+        RETURN_IF_ERROR(client.Reopen());
         client->TransmitData(res, params);
       }
     }
 
-    if (res.status.status_code != TStatusCode::OK) {
-      rpc_status_ = res.status;
-    } else {
-      num_data_bytes_sent_ += RowBatch::GetBatchSize(*batch);
-      VLOG_ROW << "incremented #data_bytes_sent="
-               << num_data_bytes_sent_;
+    if (res.status.status_code != TStatusCode::OK) return res.status;
+    if (res.__isset.receiver_wait_time_ns) {
+      *receiver_wait_time_ns = res.receiver_wait_time_ns;
     }
+    num_data_bytes_sent_ += RowBatch::GetBatchSize(params.row_batch);
+    VLOG_ROW << "incremented #data_bytes_sent="
+             << num_data_bytes_sent_;
   } catch (TException& e) {
     stringstream msg;
     msg << "TransmitData() to " << address_ << " failed:\n" << e.what();
-    rpc_status_ = Status(msg.str());
-    return;
+    return Status(msg.str());
   }
+  return Status::OK;
 }
 
 void DataStreamSender::Channel::WaitForRpc() {
   SCOPED_TIMER(parent_->state_->total_network_send_timer());
   unique_lock<mutex> l(rpc_thread_lock_);
-  while (rpc_in_flight_) {
+  while (num_rpcs_in_flight_ > 0) {
+    rpc_done_cv_.wait(l);
+  }
+}
+
+void DataStreamSender::Channel::WaitForCredit() {
+  SCOPED_TIMER(parent_->state_->total_network_send_timer());
+  unique_lock<mutex> l(rpc_thread_lock_);
+  while (num_rpcs_in_flight_ >= max_batches_in_flight()) {
     rpc_done_cv_.wait(l);
   }
 }
@@ -240,8 +356,7 @@ void DataStreamSender::Channel::WaitForRpc() {
 Status DataStreamSender::Channel::AddRow(TupleRow* row) {
   int row_num = batch_->AddRow();
   if (row_num == RowBatch::INVALID_ROW_INDEX) {
-    // batch_ is full, let's send it; but first wait for an ongoing
-    // transmission to finish before modifying thrift_batch_
+    // batch_ is full, let's send it
     RETURN_IF_ERROR(SendCurrentBatch());
     row_num = batch_->AddRow();
     DCHECK_NE(row_num, RowBatch::INVALID_ROW_INDEX);
@@ -262,16 +377,26 @@ Status DataStreamSender::Channel::AddRow(TupleRow* row) {
   return Status::OK;
 }
 
-Status DataStreamSender::Channel::SendCurrentBatch() {
-  // make sure there's no in-flight TransmitData() call that might still want to
-  // access thrift_batch_
-  WaitForRpc();
-  parent_->SerializeBatch(batch_.get(), &thrift_batch_);
-  batch_->Reset();
-  RETURN_IF_ERROR(SendBatch(&thrift_batch_));
+Status DataStreamSender::Channel::AddRows(RowBatch* batch) {
+  for (int i = 0; i < batch->num_rows(); ++i) {
+    RETURN_IF_ERROR(AddRow(batch->GetRow(i)));
+  }
   return Status::OK;
 }
 
+Status DataStreamSender::Channel::SendCurrentBatch() {
+  if (!is_local()) {
+    Status status = SendRowBatch(batch_.get());
+    batch_->Reset();
+    return status;
+  }
+  COUNTER_ADD(parent_->local_bytes_sent_counter_, batch_->TransferableBytes());
+  // Blocks while the receiver's buffer is full, like TransmitData() does.
+  SCOPED_TIMER(parent_->state_->total_network_send_timer());
+  return local_stream_mgr_->AddData(fragment_instance_id_, dest_node_id_, batch_.get(),
+      parent_->sender_id_);
+}
+
 Status DataStreamSender::Channel::GetSendStatus() {
   WaitForRpc();
   if (!rpc_status_.ok()) {
@@ -289,6 +414,10 @@ Status DataStreamSender::Channel::CloseInternal() {
     // flush
     RETURN_IF_ERROR(SendCurrentBatch());
   }
+  if (is_local()) {
+    return local_stream_mgr_->CloseSender(fragment_instance_id_, dest_node_id_,
+        parent_->sender_id_);
+  }
   // if the last transmitted batch resulted in a error, return that error
   RETURN_IF_ERROR(GetSendStatus());
   Status status;
@@ -338,19 +467,23 @@ DataStreamSender::DataStreamSender(ObjectPool* pool, int sender_id,
     pool_(pool),
     row_desc_(row_desc),
     current_channel_idx_(0),
+    num_spatial_rows_(0),
     closed_(false),
-    current_thrift_batch_(&thrift_batch1_),
+    next_thrift_batch_idx_(0),
     profile_(NULL),
     serialize_batch_timer_(NULL),
     thrift_transmit_timer_(NULL),
     bytes_sent_counter_(NULL),
+    replicated_rows_counter_(NULL),
     dest_node_id_(sink.dest_node_id) {
   DCHECK_GT(destinations.size(), 0);
   DCHECK(sink.output_partition.type == TPartitionType::UNPARTITIONED
       || sink.output_partition.type == TPartitionType::HASH_PARTITIONED
-      || sink.output_partition.type == TPartitionType::RANDOM);
+      || sink.output_partition.type == TPartitionType::RANDOM
+      || sink.output_partition.type == TPartitionType::SPATIAL_PARTITIONED);
   broadcast_ = sink.output_partition.type == TPartitionType::UNPARTITIONED;
   random_ = sink.output_partition.type == TPartitionType::RANDOM;
+  spatial_ = sink.output_partition.type == TPartitionType::SPATIAL_PARTITIONED;
   // TODO: use something like google3's linked_ptr here (scoped_ptr isn't copyable)
   for (int i = 0; i < destinations.size(); ++i) {
     channels_.push_back(
@@ -365,13 +498,20 @@ DataStreamSender::DataStreamSender(ObjectPool* pool, int sender_id,
     random_shuffle(channels_.begin(), channels_.end());
   }
 
-  if (sink.output_partition.type == TPartitionType::HASH_PARTITIONED) {
+  if (sink.output_partition.type == TPartitionType::HASH_PARTITIONED || spatial_) {
     // TODO: move this to Init()? would need to save 'sink' somewhere
     Status status =
         Expr::CreateExprTrees(pool, sink.output_partition.partition_exprs,
                               &partition_expr_ctxs_);
     DCHECK(status.ok());
   }
+
+  if (spatial_) {
+    DCHECK(sink.output_partition.__isset.spatial_grid);
+    DCHECK_EQ(partition_expr_ctxs_.size(), 1);
+    spatial_grid_.reset(new SpatialGrid(sink.output_partition.spatial_grid));
+    last_row_sent_.resize(channels_.size(), -1);
+  }
 }
 
 DataStreamSender::~DataStreamSender() {
@@ -410,9 +550,26 @@ Status DataStreamSender::Prepare(RuntimeState* state) {
       profile()->AddDerivedCounter("OverallThroughput", TCounterType::BYTES_PER_SECOND,
            bind<int64_t>(&RuntimeProfile::UnitsPerSecond, bytes_sent_counter_,
                          profile()->total_time_counter()));
+  if (spatial_) {
+    replicated_rows_counter_ = ADD_COUNTER(profile(), "ReplicatedRows", TCounterType::UNIT);
+  }
+
+  lz4_batches_counter_ =
+      ADD_COUNTER(profile(), "Lz4CompressedBatches", TCounterType::UNIT);
+  snappy_batches_counter_ =
+      ADD_COUNTER(profile(), "SnappyCompressedBatches", TCounterType::UNIT);
+  local_bytes_sent_counter_ =
+      ADD_COUNTER(profile(), "LocalBytesSent", TCounterType::BYTES);
 
+  bool has_remote_channels = false;
   for (int i = 0; i < channels_.size(); ++i) {
     RETURN_IF_ERROR(channels_[i]->Init(state));
+    has_remote_channels |= !channels_[i]->is_local();
+  }
+  // No batches are serialized for broadcasting if all receivers are local. A single
+  // channel serializes into its own ring.
+  if (broadcast_ && channels_.size() > 1 && has_remote_channels) {
+    thrift_batches_.resize(channels_[0]->max_batches_in_flight());
   }
   return Status::OK;
 }
@@ -424,25 +581,43 @@ Status DataStreamSender::Open(RuntimeState* state) {
 Status DataStreamSender::Send(RuntimeState* state, RowBatch* batch, bool eos) {
   SCOPED_TIMER(profile_->total_time_counter());
   DCHECK(!closed_);
-  if (broadcast_ || channels_.size() == 1) {
-    // current_thrift_batch_ is *not* the one that was written by the last call
-    // to Serialize()
-    SerializeBatch(batch, current_thrift_batch_, channels_.size());
-    // SendBatch() will block if there are still in-flight rpcs (and those will
-    // reference the previously written thrift batch)
+  if (broadcast_ && channels_.size() > 1) {
+    // Local channels copy the rows, the remote ones share a single serialized batch.
+    int num_remote_channels = 0;
     for (int i = 0; i < channels_.size(); ++i) {
-      RETURN_IF_ERROR(channels_[i]->SendBatch(current_thrift_batch_));
+      if (channels_[i]->is_local()) {
+        RETURN_IF_ERROR(channels_[i]->AddRows(batch));
+      } else {
+        ++num_remote_channels;
+      }
+    }
+    if (num_remote_channels == 0) return Status::OK;
+    // The batches are sent in order by every channel, so once each channel has a
+    // credit, the batch that was serialized into the next thrift batch of the ring has
+    // been sent by all of them.
+    for (int i = 0; i < channels_.size(); ++i) {
+      if (!channels_[i]->is_local()) channels_[i]->WaitForCredit();
+    }
+    TRowBatch* thrift_batch = &thrift_batches_[next_thrift_batch_idx_];
+    next_thrift_batch_idx_ = (next_thrift_batch_idx_ + 1) % thrift_batches_.size();
+    SerializeBatch(batch, thrift_batch, &broadcast_codec_selector_, num_remote_channels);
+    for (int i = 0; i < channels_.size(); ++i) {
+      if (!channels_[i]->is_local()) {
+        RETURN_IF_ERROR(channels_[i]->SendBatch(thrift_batch));
+      }
+    }
+  } else if (random_ || channels_.size() == 1) {
+    // Round-robin batches among channels. A single channel sends the whole batch, which
+    // it serializes into its own ring so that the rpc can move rather than copy it.
+    Channel* channel = channels_[current_channel_idx_];
+    if (channel->is_local()) {
+      RETURN_IF_ERROR(channel->AddRows(batch));
+    } else {
+      RETURN_IF_ERROR(channel->SendRowBatch(batch));
     }
-    current_thrift_batch_ =
-        (current_thrift_batch_ == &thrift_batch1_ ? &thrift_batch2_ : &thrift_batch1_);
-  } else if (random_) {
-    // Round-robin batches among channels. Wait for the current channel to finish its
-    // rpc before overwriting its batch.
-    Channel* current_channel = channels_[current_channel_idx_];
-    current_channel->WaitForRpc();
-    SerializeBatch(batch, current_channel->thrift_batch());
-    current_channel->SendBatch(current_channel->thrift_batch());
     current_channel_idx_ = (current_channel_idx_ + 1) % channels_.size();
+  } else if (spatial_) {
+    RETURN_IF_ERROR(SpatialPartitionBatch(batch));
   } else {
     // hash-partition batch's rows across channels
     int num_channels = channels_.size();
@@ -466,6 +641,42 @@ Status DataStreamSender::Send(RuntimeState* state, RowBatch* batch, bool eos) {
   return Status::OK;
 }
 
+Status DataStreamSender::SpatialPartitionBatch(RowBatch* batch) {
+  ExprContext* ctx = partition_expr_ctxs_[0];
+  PrimitiveType type = ctx->root()->type().type;
+  DCHECK(type == TYPE_RECTANGLE || type == TYPE_POINT) << type;
+  int num_channels = channels_.size();
+  for (int i = 0; i < batch->num_rows(); ++i) {
+    TupleRow* row = batch->GetRow(i);
+    void* value = ctx->GetValue(row);
+    if (value == NULL) {
+      RETURN_IF_ERROR(channels_[0]->AddRow(row));
+      continue;
+    }
+    if (type == TYPE_POINT) {
+      int cell_id = spatial_grid_->GetCell(*reinterpret_cast<PointValue*>(value));
+      RETURN_IF_ERROR(channels_[cell_id % num_channels]->AddRow(row));
+      continue;
+    }
+
+    overlapped_cells_.clear();
+    spatial_grid_->GetOverlappedCells(
+        *reinterpret_cast<RectangleValue*>(value), &overlapped_cells_);
+    DCHECK(!overlapped_cells_.empty());
+    ++num_spatial_rows_;
+    int num_sent = 0;
+    for (int j = 0; j < overlapped_cells_.size(); ++j) {
+      int channel_idx = overlapped_cells_[j] % num_channels;
+      if (last_row_sent_[channel_idx] == num_spatial_rows_) continue;
+      last_row_sent_[channel_idx] = num_spatial_rows_;
+      RETURN_IF_ERROR(channels_[channel_idx]->AddRow(row));
+      ++num_sent;
+    }
+    if (num_sent > 1) COUNTER_ADD(replicated_rows_counter_, 1);
+  }
+  return Status::OK;
+}
+
 void DataStreamSender::Close(RuntimeState* state) {
   if (closed_) return;
   for (int i = 0; i < channels_.size(); ++i) {
@@ -475,14 +686,27 @@ void DataStreamSender::Close(RuntimeState* state) {
   closed_ = true;
 }
 
-void DataStreamSender::SerializeBatch(RowBatch* src, TRowBatch* dest, int num_receivers) {
+void DataStreamSender::SerializeBatch(RowBatch* src, TRowBatch* dest,
+    ExchangeCodecSelector* codec_selector, int num_receivers) {
   VLOG_ROW << "serializing " << src->num_rows() << " rows";
+  THdfsCompression::type codec = FLAGS_adaptive_exchange_compression ?
+      codec_selector->Choose() : THdfsCompression::LZ4;
   {
     SCOPED_TIMER(serialize_batch_timer_);
-    int uncompressed_bytes = src->Serialize(dest);
+    MonotonicStopWatch serialize_watch;
+    serialize_watch.Start();
+    int uncompressed_bytes = src->Serialize(dest, codec);
+    // Charge the codec for batches that did not compress, too.
+    codec_selector->UpdateSerialize(codec, dest->uncompressed_size,
+        dest->tuple_data.size(), serialize_watch.ElapsedTime());
     COUNTER_ADD(bytes_sent_counter_, RowBatch::GetBatchSize(*dest) * num_receivers);
     COUNTER_ADD(uncompressed_bytes_counter_, uncompressed_bytes * num_receivers);
   }
+  if (dest->compression_type == THdfsCompression::LZ4) {
+    COUNTER_ADD(lz4_batches_counter_, 1);
+  } else if (dest->compression_type == THdfsCompression::SNAPPY) {
+    COUNTER_ADD(snappy_batches_counter_, 1);
+  }
 }
 
 int64_t DataStreamSender::GetNumDataBytesSent() const {
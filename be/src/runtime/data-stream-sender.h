@@ -18,11 +18,13 @@
 
 #include <vector>
 #include <string>
+#include <boost/scoped_ptr.hpp>
 
 #include "exec/data-sink.h"
 #include "common/global-types.h"
 #include "common/object-pool.h"
 #include "common/status.h"
+#include "runtime/exchange-codec-selector.h"
 #include "util/runtime-profile.h"
 #include "gen-cpp/Results_types.h" // for TRowBatch
 
@@ -32,6 +34,7 @@ class Expr;
 class RowBatch;
 class RowDescriptor;
 class MemTracker;
+class SpatialGrid;
 class TDataStreamSink;
 class TNetworkAddress;
 class TPlanFragmentDestination;
@@ -52,7 +55,7 @@ class DataStreamSender : public DataSink {
   // and is specified in bytes.
   // The RowDescriptor must live until Close() is called.
   // NOTE: supported partition types are UNPARTITIONED (broadcast), HASH_PARTITIONED,
-  // and RANDOM.
+  // RANDOM and SPATIAL_PARTITIONED.
   DataStreamSender(ObjectPool* pool, int sender_id,
     const RowDescriptor& row_desc, const TDataStreamSink& sink,
     const std::vector<TPlanFragmentDestination>& destinations,
@@ -70,18 +73,20 @@ class DataStreamSender : public DataSink {
   // Send data in 'batch' to destination nodes according to partitioning
   // specification provided in c'tor.
   // Blocks until all rows in batch are placed in their appropriate outgoing
-  // buffers (ie, blocks if there are still in-flight rpcs from the last
-  // Send() call).
+  // buffers (ie, blocks if a channel already has the maximum number of batches in
+  // flight, see FLAGS_datastream_sender_max_batches_in_flight).
   virtual Status Send(RuntimeState* state, RowBatch* batch, bool eos);
 
   // Flush all buffered data and close all existing channels to destination
   // hosts. Further Send() calls are illegal after calling Close().
   virtual void Close(RuntimeState* state);
 
-  // Serializes the src batch into the dest thrift batch. Maintains metrics.
+  // Serializes the src batch into the dest thrift batch, compressing it with the codec
+  // chosen by 'codec_selector'. Maintains metrics.
   // num_receivers is the number of receivers this batch will be sent to. Only
   // used to maintain metrics.
-  void SerializeBatch(RowBatch* src, TRowBatch* dest, int num_receivers = 1);
+  void SerializeBatch(RowBatch* src, TRowBatch* dest,
+      ExchangeCodecSelector* codec_selector, int num_receivers = 1);
 
   // Return total number of bytes sent in TRowBatch.data. If batches are
   // broadcast to multiple receivers, they are counted once per receiver.
@@ -92,6 +97,9 @@ class DataStreamSender : public DataSink {
  private:
   class Channel;
 
+  // Adds the rows of 'batch' to the channels owning the cells they overlap.
+  Status SpatialPartitionBatch(RowBatch* batch);
+
   // Sender instance id, unique within a fragment.
   int sender_id_;
   RuntimeState* state_;
@@ -101,14 +109,32 @@ class DataStreamSender : public DataSink {
   bool random_; // if true, round-robins row batches among channels
   int current_channel_idx_; // index of current channel to send to if random_ == true
 
+  // If true, sends each row to the owners of all grid cells that the MBR of the single
+  // partition expr overlaps. Cell i is owned by destination i % <#destinations>, which
+  // is the fragment instance that SpatialJoinNode assigns the cell to. Rows with a NULL
+  // MBR go to the first destination.
+  bool spatial_;
+  boost::scoped_ptr<SpatialGrid> spatial_grid_;
+
+  // Used to send a row only once to each channel if several of the cells it overlaps
+  // have the same owner. last_row_sent_[i] is the value of num_spatial_rows_ when a row
+  // was last added to channels_[i]. Only used if spatial_ is true.
+  std::vector<int64_t> last_row_sent_;
+  int64_t num_spatial_rows_;
+  std::vector<int> overlapped_cells_;
+
   // If true, this sender has been closed. Not valid to call Send() anymore.
   bool closed_;
 
-  // serialized batches for broadcasting; we need two so we can write
-  // one while the other one is still being sent
-  TRowBatch thrift_batch1_;
-  TRowBatch thrift_batch2_;
-  TRowBatch* current_thrift_batch_;  // the next one to fill in Send()
+  // Ring of serialized batches for broadcasting to more than one channel, with one
+  // batch per credit of a channel so that Send() can serialize the next batch while the
+  // previous ones are still being sent. The buffers of the batches are reused.
+  std::vector<TRowBatch> thrift_batches_;
+
+  // Chooses the codec of the batches in thrift_batches_. Each channel has its own for
+  // the batches it serializes itself.
+  ExchangeCodecSelector broadcast_codec_selector_;
+  int next_thrift_batch_idx_;  // the next one to fill in Send()
 
   std::vector<ExprContext*> partition_expr_ctxs_;  // compute per-row partition values
   std::vector<Channel*> channels_;
@@ -118,6 +144,13 @@ class DataStreamSender : public DataSink {
   RuntimeProfile::Counter* thrift_transmit_timer_;
   RuntimeProfile::Counter* bytes_sent_counter_;
   RuntimeProfile::Counter* uncompressed_bytes_counter_;
+  // Number of batches whose tuple data was compressed with LZ4 and Snappy.
+  RuntimeProfile::Counter* lz4_batches_counter_;
+  RuntimeProfile::Counter* snappy_batches_counter_;
+  // Bytes of the batches handed to receivers in this impalad.
+  RuntimeProfile::Counter* local_bytes_sent_counter_;
+  // Number of rows sent to more than one channel. Only set if spatial_ is true.
+  RuntimeProfile::Counter* replicated_rows_counter_;
   boost::scoped_ptr<MemTracker> mem_tracker_;
 
   // Throughput per time spent in TransmitData
@@ -15,6 +15,7 @@
 #include <boost/thread/thread.hpp>
 #include <gtest/gtest.h>
 
+#include "common/atomic.h"
 #include "common/init.h"
 #include "common/logging.h"
 #include "common/status.h"
@@ -46,6 +47,8 @@
 #include "service/fe-support.h"
 
 #include <iostream>
+#include <map>
+#include <set>
 
 using namespace std;
 using namespace tr1;
@@ -57,12 +60,14 @@ using namespace apache::thrift::protocol;
 
 DEFINE_int32(port, 20001, "port on which to run Impala test backend");
 DECLARE_string(principal);
+DECLARE_int32(datastream_sender_max_batches_in_flight);
 
 namespace impala {
 
 class ImpalaTestBackend : public ImpalaInternalServiceIf {
  public:
-  ImpalaTestBackend(DataStreamMgr* stream_mgr): mgr_(stream_mgr) {}
+  ImpalaTestBackend(DataStreamMgr* stream_mgr)
+    : mgr_(stream_mgr), num_blocked_rpcs_(0) {}
   virtual ~ImpalaTestBackend() {}
 
   virtual void ExecPlanFragment(
@@ -76,17 +81,97 @@ class ImpalaTestBackend : public ImpalaInternalServiceIf {
 
   virtual void TransmitData(
       TTransmitDataResult& return_val, const TTransmitDataParams& params) {
+    // The tests' instance ids only differ in lo.
+    int64_t instance = params.dest_fragment_instance_id.lo;
     if (!params.eos) {
+      {
+        unique_lock<mutex> l(lock_);
+        int batch_idx = num_batches_[instance]++;
+        if (blocked_instances_.find(instance) != blocked_instances_.end()) {
+          ++num_blocked_rpcs_;
+          while (blocked_instances_.find(instance) != blocked_instances_.end()) {
+            unblocked_cv_.wait(l);
+          }
+          --num_blocked_rpcs_;
+        }
+        map<int64_t, int>::const_iterator it = num_ok_batches_.find(instance);
+        if (it != num_ok_batches_.end() && batch_idx >= it->second) {
+          Status("Injected TransmitData() failure").SetTStatus(&return_val);
+          return;
+        }
+      }
+      int64_t wait_time_ns;
       mgr_->AddData(params.dest_fragment_instance_id, params.dest_node_id,
-                    params.row_batch, params.sender_id).SetTStatus(&return_val);
+                    params.row_batch, params.sender_id, &wait_time_ns)
+          .SetTStatus(&return_val);
+      return_val.__set_receiver_wait_time_ns(wait_time_ns);
     } else {
+      {
+        lock_guard<mutex> l(lock_);
+        ++num_eos_[instance];
+      }
       mgr_->CloseSender(params.dest_fragment_instance_id, params.dest_node_id,
           params.sender_id).SetTStatus(&return_val);
     }
   }
 
+  // Makes TransmitData() of the batches for 'instance_id' wait until
+  // UnblockInstance() is called.
+  void BlockInstance(const TUniqueId& instance_id) {
+    lock_guard<mutex> l(lock_);
+    blocked_instances_.insert(instance_id.lo);
+  }
+
+  void UnblockInstance(const TUniqueId& instance_id) {
+    {
+      lock_guard<mutex> l(lock_);
+      blocked_instances_.erase(instance_id.lo);
+    }
+    unblocked_cv_.notify_all();
+  }
+
+  // Makes TransmitData() fail for the batches for 'instance_id' after the first
+  // 'num_ok_batches'.
+  void FailInstance(const TUniqueId& instance_id, int num_ok_batches) {
+    lock_guard<mutex> l(lock_);
+    num_ok_batches_[instance_id.lo] = num_ok_batches;
+  }
+
+  // Returns the number of TransmitData() rpcs with a batch for 'instance_id'.
+  int num_batches(const TUniqueId& instance_id) {
+    lock_guard<mutex> l(lock_);
+    return num_batches_[instance_id.lo];
+  }
+
+  // Returns the number of TransmitData() rpcs that closed the stream to 'instance_id'.
+  int num_eos(const TUniqueId& instance_id) {
+    lock_guard<mutex> l(lock_);
+    return num_eos_[instance_id.lo];
+  }
+
+  // Returns the number of TransmitData() rpcs waiting in BlockInstance().
+  int num_blocked_rpcs() {
+    lock_guard<mutex> l(lock_);
+    return num_blocked_rpcs_;
+  }
+
+  virtual void UpdateFilter(
+      TUpdateFilterResult& return_val, const TUpdateFilterParams& params) {}
+
+  virtual void PublishFilter(
+      TPublishFilterResult& return_val, const TPublishFilterParams& params) {}
+
  private:
   DataStreamMgr* mgr_;
+
+  // Protects the fields below.
+  mutex lock_;
+  condition_variable unblocked_cv_;
+  set<int64_t> blocked_instances_;
+  map<int64_t, int> num_ok_batches_;
+  map<int64_t, int> num_batches_;
+  map<int64_t, int> num_eos_;
+  int num_blocked_rpcs_;
 };
 
 class DataStreamTest : public testing::Test {
@@ -189,6 +274,7 @@ class DataStreamTest : public testing::Test {
 
   // receiving node
   DataStreamMgr* stream_mgr_;
+  ImpalaTestBackend* backend_;  // owned by server_
   ThriftServer* server_;
 
   // sending node(s)
@@ -201,8 +287,12 @@ class DataStreamTest : public testing::Test {
     thread* thread_handle;
     Status status;
     int num_bytes_sent;
+    // Bytes handed to receivers in this process, see LocalBytesSent.
+    int64_t num_local_bytes_sent;
+    // Number of Send() calls that returned.
+    AtomicInt<int> num_sends;
 
-    SenderInfo(): thread_handle(NULL), num_bytes_sent(0) {}
+    SenderInfo(): thread_handle(NULL), num_bytes_sent(0), num_local_bytes_sent(0) {}
   };
   vector<SenderInfo> sender_info_;
 
@@ -231,13 +321,19 @@ class DataStreamTest : public testing::Test {
   };
   vector<ReceiverInfo> receiver_info_;
 
-  // Create an instance id and add it to dest_
-  void GetNextInstanceId(TUniqueId* instance_id) {
+  // Create an instance id and add it to dest_. If 'is_local', the destination is the
+  // backend address of exec_env_, so that senders hand their batches to the
+  // DataStreamMgr of exec_env_ rather than sending them to the test backend.
+  void GetNextInstanceId(TUniqueId* instance_id, bool is_local = false) {
     dest_.push_back(TPlanFragmentDestination());
     TPlanFragmentDestination& dest = dest_.back();
     dest.fragment_instance_id = next_instance_id_;
-    dest.server.hostname = "127.0.0.1";
-    dest.server.port = FLAGS_port;
+    if (is_local) {
+      dest.server = exec_env_.backend_address();
+    } else {
+      dest.server.hostname = "127.0.0.1";
+      dest.server.port = FLAGS_port;
+    }
     *instance_id = next_instance_id_;
     ++next_instance_id_.lo;
   }
@@ -313,18 +409,21 @@ class DataStreamTest : public testing::Test {
     }
   }
 
-  // Start receiver (expecting given number of senders) in separate thread.
+  // Start receiver (expecting given number of senders) in separate thread. Local
+  // receivers are created in the DataStreamMgr of exec_env_, see GetNextInstanceId().
   void StartReceiver(TPartitionType::type stream_type, int num_senders, int receiver_num,
-                     int buffer_size, bool is_merging, TUniqueId* out_id = NULL) {
+                     int buffer_size, bool is_merging, TUniqueId* out_id = NULL,
+                     bool is_local = false) {
     VLOG_QUERY << "start receiver";
     RuntimeProfile* profile =
         obj_pool_.Add(new RuntimeProfile(&obj_pool_, "TestReceiver"));
     TUniqueId instance_id;
-    GetNextInstanceId(&instance_id);
+    GetNextInstanceId(&instance_id, is_local);
     receiver_info_.push_back(ReceiverInfo(stream_type, num_senders, receiver_num));
     ReceiverInfo& info = receiver_info_.back();
+    DataStreamMgr* stream_mgr = is_local ? exec_env_.stream_mgr() : stream_mgr_;
     info.stream_recvr =
-        stream_mgr_->CreateRecvr(&runtime_state_,
+        stream_mgr->CreateRecvr(&runtime_state_,
             *row_desc_, instance_id, DEST_NODE_ID, num_senders, buffer_size, profile,
             is_merging);
     if (!is_merging) {
@@ -414,7 +513,7 @@ class DataStreamTest : public testing::Test {
       }
     }
 
-    if (stream_type == TPartitionType::HASH_PARTITIONED) {
+    if (stream_type != TPartitionType::UNPARTITIONED) {
       EXPECT_EQ(NUM_BATCHES * BATCH_CAPACITY * num_senders, total);
 
       int k = 0;
@@ -427,16 +526,28 @@ class DataStreamTest : public testing::Test {
     }
   }
 
-  void CheckSenders() {
+  // Checks that the senders sent data over thrift if 'has_remote_receivers' and handed
+  // batches to receivers in this process if 'has_local_receivers', and nothing else.
+  void CheckSenders(bool has_remote_receivers = true, bool has_local_receivers = false) {
     for (int i = 0; i < sender_info_.size(); ++i) {
       EXPECT_TRUE(sender_info_[i].status.ok());
-      EXPECT_GT(sender_info_[i].num_bytes_sent, 0);
+      if (has_remote_receivers) {
+        EXPECT_GT(sender_info_[i].num_bytes_sent, 0);
+      } else {
+        EXPECT_EQ(sender_info_[i].num_bytes_sent, 0);
+      }
+      if (has_local_receivers) {
+        EXPECT_GT(sender_info_[i].num_local_bytes_sent, 0);
+      } else {
+        EXPECT_EQ(sender_info_[i].num_local_bytes_sent, 0);
+      }
     }
   }
 
   // Start backend in separate thread.
   void StartBackend() {
     shared_ptr<ImpalaTestBackend> handler(new ImpalaTestBackend(stream_mgr_));
+    backend_ = handler.get();
     shared_ptr<TProcessor> processor(new ImpalaInternalServiceProcessor(handler));
     server_ = new ThriftServer("DataStreamTest backend", processor, FLAGS_port, NULL);
     server_->Start();
@@ -485,29 +596,36 @@ class DataStreamTest : public testing::Test {
       GetNextBatch(batch.get(), &next_val);
       VLOG_QUERY << "sender " << sender_num << ": #rows=" << batch->num_rows();
       info.status = sender.Send(&state, batch.get(), false);
+      info.num_sends += 1;
       if (!info.status.ok()) break;
     }
     VLOG_QUERY << "closing sender" << sender_num;
     sender.Close(&state);
     info.num_bytes_sent = sender.GetNumDataBytesSent();
+    info.num_local_bytes_sent =
+        sender.profile()->GetCounter("LocalBytesSent")->value();
 
     batch->Reset();
   }
 
+  // The first 'num_local_receivers' receivers are in the same process as the senders.
   void TestStream(TPartitionType::type stream_type, int num_senders,
-                  int num_receivers, int buffer_size, bool is_merging) {
+                  int num_receivers, int buffer_size, bool is_merging,
+                  int num_local_receivers = 0) {
     VLOG_QUERY << "Testing stream=" << stream_type << " #senders=" << num_senders
                << " #receivers=" << num_receivers << " buffer_size=" << buffer_size
-               << " is_merging=" << is_merging;
+               << " is_merging=" << is_merging
+               << " #local_receivers=" << num_local_receivers;
     Reset();
     for (int i = 0; i < num_receivers; ++i) {
-      StartReceiver(stream_type, num_senders, i, buffer_size, is_merging);
+      StartReceiver(stream_type, num_senders, i, buffer_size, is_merging, NULL,
+          i < num_local_receivers);
     }
     for (int i = 0; i < num_senders; ++i) {
       StartSender(stream_type, buffer_size);
     }
     JoinSenders();
-    CheckSenders();
+    CheckSenders(num_local_receivers < num_receivers, num_local_receivers > 0);
     JoinReceivers();
     CheckReceivers(stream_type, num_senders);
   }
@@ -574,8 +692,173 @@ TEST_F(DataStreamTest, BasicTest) {
   }
 }
 
+TEST_F(DataStreamTest, LocalSender) {
+  // batches of senders in the same process are handed to the receiver without
+  // serializing them
+  TUniqueId instance_id;
+  StartReceiver(TPartitionType::UNPARTITIONED, 1, 0, 1024, false, &instance_id);
+  int next_val = 0;
+  for (int i = 0; i < NUM_BATCHES; ++i) {
+    scoped_ptr<RowBatch> batch(CreateRowBatch());
+    GetNextBatch(batch.get(), &next_val);
+    EXPECT_TRUE(stream_mgr_->AddData(instance_id, DEST_NODE_ID, batch.get(), 0).ok());
+    // the rows and their memory now belong to the receiver
+    EXPECT_EQ(batch->num_rows(), 0);
+  }
+  EXPECT_TRUE(stream_mgr_->CloseSender(instance_id, DEST_NODE_ID, 0).ok());
+  JoinReceivers();
+  CheckReceivers(TPartitionType::UNPARTITIONED, 1);
+}
+
+TEST_F(DataStreamTest, LocalReceivers) {
+  // DataStreamSenders hand their batches to receivers in the same process, for each
+  // partition type, with only local receivers and mixed with remote ones
+  TPartitionType::type stream_types[] =
+      {TPartitionType::UNPARTITIONED, TPartitionType::RANDOM,
+          TPartitionType::HASH_PARTITIONED};
+  int buffer_sizes[] = {1024, 1024 * 1024};
+  bool merging[] = {false, true};
+  for (int i = 0; i < sizeof(stream_types) / sizeof(*stream_types); ++i) {
+    for (int l = 0; l < sizeof(buffer_sizes) / sizeof(int); ++l) {
+      for (int m = 0; m < sizeof(merging) / sizeof(bool); ++m) {
+        TestStream(stream_types[i], 1, 1, buffer_sizes[l], merging[m], 1);
+        TestStream(stream_types[i], 4, 4, buffer_sizes[l], merging[m], 4);
+        TestStream(stream_types[i], 4, 4, buffer_sizes[l], merging[m], 2);
+      }
+    }
+  }
+}
+
+TEST_F(DataStreamTest, BatchesInFlight) {
+  // Send() returns while up to max_batches_in_flight batches of a channel are queued or
+  // being sent, and blocks once it runs out of credits
+  int32_t max_batches_in_flight = FLAGS_datastream_sender_max_batches_in_flight;
+  FLAGS_datastream_sender_max_batches_in_flight = 3;
+  TPartitionType::type stream_types[] =
+      {TPartitionType::UNPARTITIONED, TPartitionType::RANDOM};
+  for (int i = 0; i < sizeof(stream_types) / sizeof(*stream_types); ++i) {
+    Reset();
+    TUniqueId instance_id;
+    StartReceiver(stream_types[i], 1, 0, 1024 * 1024, false, &instance_id);
+    backend_->BlockInstance(instance_id);
+    StartSender(stream_types[i]);
+    for (int j = 0; j < 100 && (backend_->num_blocked_rpcs() < 1 ||
+        sender_info_[0].num_sends < 3); ++j) {
+      SleepForMs(100);
+    }
+    // The rpc of the first batch is under way and the next two are queued.
+    SleepForMs(500);
+    EXPECT_EQ(backend_->num_blocked_rpcs(), 1);
+    EXPECT_EQ(backend_->num_batches(instance_id), 1);
+    EXPECT_EQ(static_cast<int>(sender_info_[0].num_sends), 3);
+    backend_->UnblockInstance(instance_id);
+    JoinSenders();
+    CheckSenders();
+    EXPECT_EQ(static_cast<int>(sender_info_[0].num_sends), NUM_BATCHES);
+    EXPECT_EQ(backend_->num_batches(instance_id), NUM_BATCHES);
+    EXPECT_EQ(backend_->num_eos(instance_id), 1);
+    JoinReceivers();
+    CheckReceivers(stream_types[i], 1);
+  }
+  FLAGS_datastream_sender_max_batches_in_flight = max_batches_in_flight;
+}
+
+TEST_F(DataStreamTest, BroadcastRingReuse) {
+  // A slow channel holds up a broadcast before the batch that it is about to send is
+  // overwritten in the ring of serialized batches, while the other channel keeps
+  // sending
+  int32_t max_batches_in_flight = FLAGS_datastream_sender_max_batches_in_flight;
+  FLAGS_datastream_sender_max_batches_in_flight = 2;
+  TUniqueId slow_id, fast_id;
+  StartReceiver(TPartitionType::UNPARTITIONED, 1, 0, 1024 * 1024, false, &slow_id);
+  StartReceiver(TPartitionType::UNPARTITIONED, 1, 1, 1024 * 1024, false, &fast_id);
+  backend_->BlockInstance(slow_id);
+  StartSender(TPartitionType::UNPARTITIONED);
+  for (int j = 0; j < 100 && (backend_->num_blocked_rpcs() < 1 ||
+      backend_->num_batches(fast_id) < 2 || sender_info_[0].num_sends < 2); ++j) {
+    SleepForMs(100);
+  }
+  SleepForMs(500);
+  // Both batches of the ring are still to be sent by the slow channel.
+  EXPECT_EQ(backend_->num_batches(slow_id), 1);
+  EXPECT_EQ(backend_->num_batches(fast_id), 2);
+  EXPECT_EQ(static_cast<int>(sender_info_[0].num_sends), 2);
+  backend_->UnblockInstance(slow_id);
+  JoinSenders();
+  CheckSenders();
+  JoinReceivers();
+  CheckReceivers(TPartitionType::UNPARTITIONED, 1);
+  FLAGS_datastream_sender_max_batches_in_flight = max_batches_in_flight;
+}
+
+TEST_F(DataStreamTest, FailedRpc) {
+  // Once a TransmitData rpc failed, Send() and Close() return its error, and the
+  // batches queued after it are not sent
+  int32_t max_batches_in_flight = FLAGS_datastream_sender_max_batches_in_flight;
+  FLAGS_datastream_sender_max_batches_in_flight = 2;
+  TUniqueId instance_id;
+  GetNextInstanceId(&instance_id);
+  backend_->FailInstance(instance_id, 2);
+  RuntimeState state(TPlanFragmentInstanceCtx(), "", &exec_env_);
+  state.set_desc_tbl(desc_tbl_);
+  state.InitMemTrackers(TUniqueId(), NULL, -1);
+  DataStreamSender sender(&obj_pool_, 0, *row_desc_,
+      GetSink(TPartitionType::UNPARTITIONED), dest_, 1024);
+  EXPECT_TRUE(sender.Prepare(&state).ok());
+  EXPECT_TRUE(sender.Open(&state).ok());
+  scoped_ptr<RowBatch> batch(CreateRowBatch());
+  int next_val = 0;
+  int num_sends = 0;
+  Status status;
+  while (num_sends < NUM_BATCHES && status.ok()) {
+    GetNextBatch(batch.get(), &next_val);
+    status = sender.Send(&state, batch.get(), false);
+    ++num_sends;
+  }
+  // The third batch failed. At the latest, the Send() that waits for its credit
+  // returns the error.
+  EXPECT_FALSE(status.ok());
+  EXPECT_LE(num_sends, 5);
+  GetNextBatch(batch.get(), &next_val);
+  EXPECT_FALSE(sender.Send(&state, batch.get(), false).ok());
+  EXPECT_TRUE(state.ErrorLogIsEmpty());
+  sender.Close(&state);
+  EXPECT_FALSE(state.ErrorLogIsEmpty());
+  EXPECT_EQ(backend_->num_batches(instance_id), 3);
+  EXPECT_EQ(backend_->num_eos(instance_id), 0);
+  batch->Reset();
+  FLAGS_datastream_sender_max_batches_in_flight = max_batches_in_flight;
+}
+
+TEST_F(DataStreamTest, SerializeRoundTrip) {
+  // Batches serialized with each exchange codec are restored by the receiver's
+  // RowBatch(const TRowBatch&) constructor
+  THdfsCompression::type codecs[] =
+      {THdfsCompression::NONE, THdfsCompression::LZ4, THdfsCompression::SNAPPY};
+  scoped_ptr<RowBatch> batch(CreateRowBatch());
+  int next_val = 0;
+  GetNextBatch(batch.get(), &next_val);
+  for (int i = 0; i < sizeof(codecs) / sizeof(*codecs); ++i) {
+    TRowBatch thrift_batch;
+    batch->Serialize(&thrift_batch, codecs[i]);
+    // The small values compress well.
+    EXPECT_EQ(thrift_batch.compression_type, codecs[i]);
+    if (codecs[i] == THdfsCompression::NONE) {
+      EXPECT_EQ(thrift_batch.tuple_data.size(), thrift_batch.uncompressed_size);
+    } else {
+      EXPECT_LT(thrift_batch.tuple_data.size(), thrift_batch.uncompressed_size);
+    }
+    RowBatch output_batch(*row_desc_, thrift_batch, &tracker_);
+    ASSERT_EQ(output_batch.num_rows(), batch->num_rows());
+    for (int j = 0; j < batch->num_rows(); ++j) {
+      EXPECT_EQ(*static_cast<int64_t*>(output_batch.GetRow(j)->GetTuple(0)->GetSlot(0)),
+          *static_cast<int64_t*>(batch->GetRow(j)->GetTuple(0)->GetSlot(0)));
+    }
+  }
+  batch->Reset();
+}
+
 // TODO: more tests:
-// - test case for transmission error in last batch
 // - receivers getting created concurrently
 
 }
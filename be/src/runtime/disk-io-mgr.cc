@@ -188,7 +188,8 @@ void DiskIoMgr::BufferDescriptor::SetMemTracker(MemTracker* tracker) {
 }
 
 DiskIoMgr::WriteRange::WriteRange(const string& file, int64_t file_offset, int disk_id,
-    WriteDoneCallback callback) {
+    WriteDoneCallback callback)
+  : write_time_ns_(0) {
   file_ = file;
   offset_ = file_offset;
   disk_id_ = disk_id;
@@ -999,6 +1000,16 @@ void DiskIoMgr::ReadRange(DiskQueue* disk_queue, RequestContext* reader,
 }
 
 void DiskIoMgr::Write(RequestContext* writer_context, WriteRange* write_range) {
+  if (!write_range->prepare_callback_.empty()) {
+    Status prepare_status = write_range->prepare_callback_();
+    if (!prepare_status.ok()) {
+      write_range->write_time_ns_ = 0;
+      HandleWriteFinished(writer_context, write_range, prepare_status);
+      return;
+    }
+  }
+  MonotonicStopWatch write_timer;
+  write_timer.Start();
   FILE* file_handle = fopen(write_range->file(), "rb+");
   Status ret_status;
   if (file_handle == NULL) {
@@ -1014,6 +1025,7 @@ void DiskIoMgr::Write(RequestContext* writer_context, WriteRange* write_range) {
           write_range->file_));
     }
   }
+  write_range->write_time_ns_ = write_timer.ElapsedTime();
 
   HandleWriteFinished(writer_context, write_range, ret_status);
 }
@@ -429,6 +429,13 @@ class DiskIoMgr {
     // successfully added (i.e. AddWriteRange() succeeded). No locks are held while
     // the callback is invoked.
     typedef boost::function<void (const Status&)> WriteDoneCallback;
+
+    // This optional callback is invoked by the disk thread right before the data is
+    // written, with no locks held. It may transform the data, e.g. compress it, and
+    // replace it with SetData(). If it returns an error, nothing is written and the
+    // WriteDoneCallback is invoked with the error.
+    typedef boost::function<Status ()> PrepareCallback;
+
     WriteRange(const std::string& file, int64_t file_offset, int disk_id,
         WriteDoneCallback callback);
 
@@ -436,6 +443,20 @@ class DiskIoMgr {
     // File data can be over-written by calling SetData() and AddWriteRange().
     void SetData(const uint8_t* buffer, int64_t len);
 
+    // Changes the offset in the file that the data is written to. The prepare callback
+    // may call this, e.g. to place data whose length it changed.
+    void SetOffset(int64_t file_offset) { offset_ = file_offset; }
+
+    void SetPrepareCallback(const PrepareCallback& prepare_callback) {
+      prepare_callback_ = prepare_callback;
+    }
+
+    const uint8_t* data() const { return data_; }
+
+    // Time in ns the last write of this range took, including opening and closing the
+    // file but not the time it was queued for. Valid in the callback.
+    int64_t write_time_ns() const { return write_time_ns_; }
+
    private:
     friend class DiskIoMgr;
 
@@ -443,8 +464,13 @@ class DiskIoMgr {
     // to be written.
     const uint8_t* data_;
 
+    int64_t write_time_ns_;
+
     // Callback to invoke after the write is complete.
     WriteDoneCallback callback_;
+
+    // Callback to invoke before the data is written, if set.
+    PrepareCallback prepare_callback_;
   };
 
   // Create a DiskIoMgr object.
@@ -0,0 +1,125 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+
+#include <gtest/gtest.h>
+#include "runtime/exchange-codec-selector.h"
+
+using namespace std;
+
+namespace impala {
+
+static const int64_t BATCH_SIZE = 1024 * 1024;
+
+// Sends 'num_batches' batches with the codecs chosen by 'selector', compressing them
+// at the given ratios and speeds, over a link that takes 'transmit_ns_per_byte' plus
+// 'rpc_overhead_ns' per batch. Returns how often each codec was chosen.
+static map<THdfsCompression::type, int> SendBatches(ExchangeCodecSelector* selector,
+    int num_batches, double transmit_ns_per_byte, double rpc_overhead_ns = 0) {
+  map<THdfsCompression::type, int> num_chosen;
+  for (int i = 0; i < num_batches; ++i) {
+    THdfsCompression::type codec = selector->Choose();
+    ++num_chosen[codec];
+    double ratio = 1.0;
+    double serialize_ns_per_byte = 0.2;
+    if (codec == THdfsCompression::LZ4) {
+      ratio = 0.5;
+      serialize_ns_per_byte = 1.0;
+    } else if (codec == THdfsCompression::SNAPPY) {
+      ratio = 0.3;
+      serialize_ns_per_byte = 1.5;
+    }
+    selector->UpdateSerialize(codec, BATCH_SIZE, ratio * BATCH_SIZE,
+        serialize_ns_per_byte * BATCH_SIZE);
+    selector->UpdateTransmit(ratio * BATCH_SIZE,
+        rpc_overhead_ns + ratio * BATCH_SIZE * transmit_ns_per_byte);
+  }
+  return num_chosen;
+}
+
+TEST(ExchangeCodecSelectorTest, DefaultsToLz4) {
+  ExchangeCodecSelector selector;
+  EXPECT_EQ(selector.Choose(), THdfsCompression::LZ4);
+  selector.UpdateSerialize(THdfsCompression::LZ4, BATCH_SIZE, BATCH_SIZE / 2, 1000);
+  // The link has not been measured yet.
+  EXPECT_EQ(selector.Choose(), THdfsCompression::LZ4);
+  EXPECT_LT(selector.EstimatedCost(THdfsCompression::LZ4), 0);
+
+  // Once it has, the other codecs are measured.
+  selector.UpdateTransmit(BATCH_SIZE / 2, BATCH_SIZE);
+  EXPECT_GT(selector.EstimatedCost(THdfsCompression::LZ4), 0);
+  EXPECT_EQ(selector.Choose(), THdfsCompression::SNAPPY);
+  selector.UpdateSerialize(THdfsCompression::SNAPPY, BATCH_SIZE, BATCH_SIZE / 2, 1000);
+  EXPECT_EQ(selector.Choose(), THdfsCompression::NONE);
+}
+
+TEST(ExchangeCodecSelectorTest, SlowLink) {
+  // The best ratio wins.
+  ExchangeCodecSelector selector;
+  map<THdfsCompression::type, int> num_chosen = SendBatches(&selector, 100, 10.0);
+  EXPECT_GT(num_chosen[THdfsCompression::SNAPPY], 80);
+  EXPECT_LT(selector.EstimatedCost(THdfsCompression::SNAPPY),
+      selector.EstimatedCost(THdfsCompression::NONE));
+}
+
+TEST(ExchangeCodecSelectorTest, FastLink) {
+  // Compression does not pay off.
+  ExchangeCodecSelector selector;
+  map<THdfsCompression::type, int> num_chosen = SendBatches(&selector, 100, 0.1);
+  EXPECT_GT(num_chosen[THdfsCompression::NONE], 80);
+  // The other codecs are still probed now and then.
+  EXPECT_GT(num_chosen[THdfsCompression::LZ4], 1);
+  EXPECT_GT(num_chosen[THdfsCompression::SNAPPY], 1);
+}
+
+TEST(ExchangeCodecSelectorTest, RpcOverhead) {
+  // The fixed cost of an rpc, here 20 times the time to send the bytes of a batch,
+  // doesn't make the smaller compressed batches look slower to send per byte.
+  ExchangeCodecSelector selector;
+  map<THdfsCompression::type, int> num_chosen =
+      SendBatches(&selector, 100, 0.1, 2.0 * BATCH_SIZE);
+  EXPECT_GT(num_chosen[THdfsCompression::NONE], 80);
+  EXPECT_NEAR(selector.TransmitNsPerByte(), 0.1, 0.001);
+  EXPECT_NEAR(selector.TransmitOverheadNs(), 2.0 * BATCH_SIZE, 0.01 * BATCH_SIZE);
+
+  // Nor does it hide the per-byte cost of a slow link.
+  ExchangeCodecSelector slow_selector;
+  num_chosen = SendBatches(&slow_selector, 100, 10.0, 2.0 * BATCH_SIZE);
+  EXPECT_GT(num_chosen[THdfsCompression::SNAPPY], 80);
+  EXPECT_NEAR(slow_selector.TransmitNsPerByte(), 10.0, 0.01);
+}
+
+TEST(ExchangeCodecSelectorTest, SameSizeBatches) {
+  // The overhead can't be told apart from batches of a single size.
+  ExchangeCodecSelector selector;
+  for (int i = 0; i < 10; ++i) selector.UpdateTransmit(BATCH_SIZE, 1000 + BATCH_SIZE);
+  EXPECT_EQ(selector.TransmitOverheadNs(), 0);
+  EXPECT_NEAR(selector.TransmitNsPerByte(), 1.0 + 1000.0 / BATCH_SIZE, 1e-9);
+}
+
+TEST(ExchangeCodecSelectorTest, Adapts) {
+  // The link gets congested.
+  ExchangeCodecSelector selector;
+  SendBatches(&selector, 100, 0.1);
+  map<THdfsCompression::type, int> num_chosen = SendBatches(&selector, 200, 10.0);
+  EXPECT_GT(num_chosen[THdfsCompression::SNAPPY], 150);
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,126 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/exchange-codec-selector.h"
+
+#include "common/logging.h"
+
+using namespace std;
+
+namespace impala {
+
+// LZ4 comes first: it is used until the link has been measured.
+const THdfsCompression::type ExchangeCodecSelector::CODECS[] = {
+  THdfsCompression::LZ4, THdfsCompression::SNAPPY, THdfsCompression::NONE
+};
+
+const double ExchangeCodecSelector::ALPHA = 0.25;
+const double ExchangeCodecSelector::MIN_SIZE_DEVIATION = 0.1;
+
+ExchangeCodecSelector::ExchangeCodecSelector()
+  : num_batches_(0),
+    next_probe_idx_(0),
+    transmit_bytes_(-1),
+    transmit_ns_(-1),
+    transmit_bytes_sq_(-1),
+    transmit_bytes_ns_(-1),
+    transmit_ns_per_byte_(-1),
+    transmit_overhead_ns_(0) {
+  for (int i = 0; i < NUM_CODECS; ++i) {
+    stats_[i].serialize_ns_per_byte = -1;
+    stats_[i].ratio = -1;
+  }
+}
+
+int ExchangeCodecSelector::CodecIdx(THdfsCompression::type codec) {
+  for (int i = 0; i < NUM_CODECS; ++i) {
+    if (CODECS[i] == codec) return i;
+  }
+  DCHECK(false) << "Unsupported exchange codec: " << codec;
+  return 0;
+}
+
+double ExchangeCodecSelector::EstimatedCost(THdfsCompression::type codec) {
+  double transmit_ns_per_byte = TransmitNsPerByte();
+  const CodecStats& stats = stats_[CodecIdx(codec)];
+  if (transmit_ns_per_byte < 0 || stats.ratio < 0) return -1;
+  return stats.serialize_ns_per_byte + stats.ratio * transmit_ns_per_byte;
+}
+
+THdfsCompression::type ExchangeCodecSelector::Choose() {
+  ++num_batches_;
+  int best_idx = -1;
+  double best_cost = 0;
+  for (int i = 0; i < NUM_CODECS; ++i) {
+    double cost = EstimatedCost(CODECS[i]);
+    // Codecs are measured in order once the link has been, and LZ4 is used until then.
+    if (cost < 0) return CODECS[i];
+    if (best_idx == -1 || cost < best_cost) {
+      best_idx = i;
+      best_cost = cost;
+    }
+  }
+  if (num_batches_ % PROBE_INTERVAL == 0) {
+    if (next_probe_idx_ == best_idx) next_probe_idx_ = (next_probe_idx_ + 1) % NUM_CODECS;
+    int probe_idx = next_probe_idx_;
+    next_probe_idx_ = (next_probe_idx_ + 1) % NUM_CODECS;
+    return CODECS[probe_idx];
+  }
+  return CODECS[best_idx];
+}
+
+void ExchangeCodecSelector::UpdateSerialize(THdfsCompression::type codec,
+    int64_t uncompressed_bytes, int64_t serialized_bytes, int64_t time_ns) {
+  if (uncompressed_bytes <= 0) return;
+  CodecStats* stats = &stats_[CodecIdx(codec)];
+  Update(static_cast<double>(time_ns) / uncompressed_bytes,
+      &stats->serialize_ns_per_byte);
+  Update(static_cast<double>(serialized_bytes) / uncompressed_bytes, &stats->ratio);
+}
+
+void ExchangeCodecSelector::UpdateTransmit(int64_t bytes, int64_t time_ns) {
+  if (bytes <= 0) return;
+  double b = bytes;
+  double t = time_ns;
+  ScopedSpinLock l(&lock_);
+  Update(b, &transmit_bytes_);
+  Update(t, &transmit_ns_);
+  Update(b * b, &transmit_bytes_sq_);
+  Update(b * t, &transmit_bytes_ns_);
+  // Weighted least squares fit, with the weights of the moving averages.
+  double variance = transmit_bytes_sq_ - transmit_bytes_ * transmit_bytes_;
+  double covariance = transmit_bytes_ns_ - transmit_bytes_ * transmit_ns_;
+  double min_deviation = MIN_SIZE_DEVIATION * transmit_bytes_;
+  if (variance >= min_deviation * min_deviation && covariance > 0) {
+    transmit_ns_per_byte_ = covariance / variance;
+    transmit_overhead_ns_ = transmit_ns_ - transmit_ns_per_byte_ * transmit_bytes_;
+    if (transmit_overhead_ns_ >= 0) return;
+  }
+  // The sizes are too alike to tell the overhead apart, or the times don't grow with
+  // them. Charge all of the time to the bytes.
+  transmit_ns_per_byte_ = transmit_ns_ / transmit_bytes_;
+  transmit_overhead_ns_ = 0;
+}
+
+double ExchangeCodecSelector::TransmitNsPerByte() {
+  ScopedSpinLock l(&lock_);
+  return transmit_ns_per_byte_;
+}
+
+double ExchangeCodecSelector::TransmitOverheadNs() {
+  ScopedSpinLock l(&lock_);
+  return transmit_overhead_ns_;
+}
+
+}
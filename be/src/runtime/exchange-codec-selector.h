@@ -0,0 +1,118 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_RUNTIME_EXCHANGE_CODEC_SELECTOR_H
+#define IMPALA_RUNTIME_EXCHANGE_CODEC_SELECTOR_H
+
+#include "util/spinlock.h"
+
+#include "gen-cpp/CatalogObjects_types.h"  // for THdfsCompression
+
+namespace impala {
+
+// Picks the codec that exchange batches are compressed with, per batch, from NONE, LZ4
+// and SNAPPY. For each codec it keeps a moving average of the time it takes to
+// serialize a byte of uncompressed data and of the compression ratio, and for the link
+// the time it takes to transmit a byte. The codec with the lowest estimated time to
+// serialize and transmit a byte is chosen: on a slow link the best ratio wins, on a
+// fast one the cheapest codec. Each rpc also has a fixed overhead, which is separated
+// from the per-byte cost by fitting a line to the transmit times of batches of
+// different sizes. It is the same whatever the codec, so it is left out of the choice;
+// counted per byte, it would make the smaller compressed batches look slower to send.
+// The estimates of the other codecs are refreshed by compressing every
+// PROBE_INTERVAL-th batch with one of them instead, so that the choice follows changes
+// in the data and the load of the link.
+// Choose() and UpdateSerialize() are called by the thread that serializes the batches,
+// UpdateTransmit() by the threads that send them.
+class ExchangeCodecSelector {
+ public:
+  ExchangeCodecSelector();
+
+  // Returns the codec to compress the next batch with.
+  THdfsCompression::type Choose();
+
+  // Records that serializing a batch with 'uncompressed_bytes' of tuple data with
+  // 'codec' took 'time_ns' and produced 'serialized_bytes' of tuple data.
+  void UpdateSerialize(THdfsCompression::type codec, int64_t uncompressed_bytes,
+      int64_t serialized_bytes, int64_t time_ns);
+
+  // Records that transmitting 'bytes' took 'time_ns'. Thread-safe.
+  void UpdateTransmit(int64_t bytes, int64_t time_ns);
+
+  // Returns the estimated time in ns to transmit a byte, not counting the fixed
+  // overhead of an rpc, or -1 if no batch has been sent yet. Thread-safe.
+  double TransmitNsPerByte();
+
+  // Returns the estimated fixed overhead in ns of an rpc. It is 0 until batches of
+  // different sizes have been sent. Thread-safe.
+  double TransmitOverheadNs();
+
+  // Returns the estimated time in ns to serialize and transmit a byte of uncompressed
+  // tuple data with 'codec', or -1 if it has not been measured yet.
+  double EstimatedCost(THdfsCompression::type codec);
+
+ private:
+  static const int NUM_CODECS = 3;
+  static const THdfsCompression::type CODECS[NUM_CODECS];
+
+  // Every PROBE_INTERVAL-th batch is compressed with a codec other than the best one.
+  static const int PROBE_INTERVAL = 16;
+
+  // Weight of a new measurement in the moving averages.
+  static const double ALPHA;
+
+  // The transmit overhead is only estimated once the standard deviation of the sizes
+  // of the batches sent is at least this fraction of their mean.
+  static const double MIN_SIZE_DEVIATION;
+
+  struct CodecStats {
+    // Moving averages; -1 if the codec has not been measured yet.
+    double serialize_ns_per_byte;
+    double ratio;
+  };
+
+  static int CodecIdx(THdfsCompression::type codec);
+  static void Update(double value, double* avg) {
+    *avg = *avg < 0 ? value : *avg + ALPHA * (value - *avg);
+  }
+
+  CodecStats stats_[NUM_CODECS];
+
+  // Number of calls to Choose().
+  int64_t num_batches_;
+
+  // Index of the codec to probe next.
+  int next_probe_idx_;
+
+  // Protects the transmit stats below.
+  SpinLock lock_;
+
+  // Moving averages of the bytes b and the time t of the batches sent, and of b * b and
+  // b * t, from which the line t = overhead + b * ns_per_byte is fitted. -1 if no batch
+  // has been sent yet.
+  double transmit_bytes_;
+  double transmit_ns_;
+  double transmit_bytes_sq_;
+  double transmit_bytes_ns_;
+
+  // The fitted line, updated by UpdateTransmit(). transmit_ns_per_byte_ is -1 if no
+  // batch has been sent yet.
+  double transmit_ns_per_byte_;
+  double transmit_overhead_ns_;
+};
+
+}
+
+#endif
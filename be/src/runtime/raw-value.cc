@@ -66,6 +66,8 @@ void RawValue::PrintValueAsBytes(const void* value, const ColumnType& type,
       stream->write(StringValue::CharSlotToPtr(chars, type), type.len);
       break;
     case TYPE_DECIMAL:
+    case TYPE_POINT:
+    case TYPE_RECTANGLE:
       stream->write(chars, type.GetByteSize());
       break;
     default:
@@ -159,6 +161,12 @@ int RawValue::Compare(const void* v1, const void* v2, const ColumnType& type) {
       ts_value1 = reinterpret_cast<const TimestampValue*>(v1);
       ts_value2 = reinterpret_cast<const TimestampValue*>(v2);
       return *ts_value1 > *ts_value2 ? 1 : (*ts_value1 < *ts_value2 ? -1 : 0);
+    case TYPE_POINT:
+      return reinterpret_cast<const PointValue*>(v1)->Compare(
+          *reinterpret_cast<const PointValue*>(v2));
+    case TYPE_RECTANGLE:
+      return reinterpret_cast<const RectangleValue*>(v1)->Compare(
+          *reinterpret_cast<const RectangleValue*>(v2));
     case TYPE_CHAR: {
       const char* v1ptr = StringValue::CharSlotToPtr(v1, type);
       const char* v2ptr = StringValue::CharSlotToPtr(v2, type);
@@ -238,6 +246,13 @@ void RawValue::Write(const void* value, void* dst, const ColumnType& type,
       }
       break;
     }
+    case TYPE_POINT:
+      *reinterpret_cast<PointValue*>(dst) = *reinterpret_cast<const PointValue*>(value);
+      break;
+    case TYPE_RECTANGLE:
+      *reinterpret_cast<RectangleValue*>(dst) =
+          *reinterpret_cast<const RectangleValue*>(value);
+      break;
     case TYPE_DECIMAL:
       memcpy(dst, value, type.GetByteSize());
       break;
@@ -293,6 +308,13 @@ void RawValue::Write(const void* value, const ColumnType& type,
       *buf += dest->len;
       break;
     }
+    case TYPE_POINT:
+      *reinterpret_cast<PointValue*>(dst) = *reinterpret_cast<const PointValue*>(value);
+      break;
+    case TYPE_RECTANGLE:
+      *reinterpret_cast<RectangleValue*>(dst) =
+          *reinterpret_cast<const RectangleValue*>(value);
+      break;
     case TYPE_DECIMAL:
       memcpy(dst, value, type.GetByteSize());
       break;
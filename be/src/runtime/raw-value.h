@@ -22,6 +22,7 @@
 #include <math.h>
 
 #include "common/logging.h"
+#include "runtime/spatial-value.h"
 #include "runtime/string-value.inline.h"
 #include "runtime/timestamp-value.h"
 #include "runtime/types.h"
@@ -136,6 +137,12 @@ inline bool RawValue::Eq(const void* v1, const void* v2, const ColumnType& type)
     case TYPE_TIMESTAMP:
       return *reinterpret_cast<const TimestampValue*>(v1) ==
           *reinterpret_cast<const TimestampValue*>(v2);
+    case TYPE_POINT:
+      return *reinterpret_cast<const PointValue*>(v1) ==
+          *reinterpret_cast<const PointValue*>(v2);
+    case TYPE_RECTANGLE:
+      return *reinterpret_cast<const RectangleValue*>(v1) ==
+          *reinterpret_cast<const RectangleValue*>(v2);
     case TYPE_CHAR: {
       const char* v1ptr = StringValue::CharSlotToPtr(v1, type);
       const char* v2ptr = StringValue::CharSlotToPtr(v2, type);
@@ -187,6 +194,8 @@ inline uint32_t RawValue::GetHashValue(const void* v, const ColumnType& type,
     case TYPE_CHAR: return HashUtil::Hash(StringValue::CharSlotToPtr(v, type),
                                           type.len, seed);
     case TYPE_DECIMAL: return HashUtil::Hash(v, type.GetByteSize(), seed);
+    case TYPE_POINT: return HashUtil::Hash(v, sizeof(PointValue), seed);
+    case TYPE_RECTANGLE: return HashUtil::Hash(v, sizeof(RectangleValue), seed);
     default:
       DCHECK(false);
       return 0;
@@ -215,6 +224,9 @@ inline uint32_t RawValue::GetHashValueFnv(const void* v, const ColumnType& type,
     case TYPE_CHAR: return HashUtil::FnvHash64to32(StringValue::CharSlotToPtr(v, type),
                                                    type.len, seed);
     case TYPE_DECIMAL: return HashUtil::FnvHash64to32(v, type.GetByteSize(), seed);
+    case TYPE_POINT: return HashUtil::FnvHash64to32(v, sizeof(PointValue), seed);
+    case TYPE_RECTANGLE:
+      return HashUtil::FnvHash64to32(v, sizeof(RectangleValue), seed);
     default:
       DCHECK(false);
       return 0;
@@ -297,6 +309,12 @@ inline void RawValue::PrintValue(const void* value, const ColumnType& type, int
     case TYPE_CHAR:
       stream->write(StringValue::CharSlotToPtr(value, type), type.len);
       break;
+    case TYPE_POINT:
+      *stream << *reinterpret_cast<const PointValue*>(value);
+      break;
+    case TYPE_RECTANGLE:
+      *stream << *reinterpret_cast<const RectangleValue*>(value);
+      break;
     case TYPE_DECIMAL:
       switch (type.GetByteSize()) {
         case 4:
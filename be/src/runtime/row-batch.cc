@@ -143,7 +143,8 @@ RowBatch::~RowBatch() {
   }
 }
 
-int RowBatch::Serialize(TRowBatch* output_batch) {
+int RowBatch::Serialize(TRowBatch* output_batch,
+    THdfsCompression::type compression_type) {
   // why does Thrift not generate a Clear() function?
   output_batch->row_tuples.clear();
   output_batch->tuple_offsets.clear();
@@ -179,12 +180,11 @@ int RowBatch::Serialize(TRowBatch* output_batch) {
   }
   DCHECK_EQ(offset, size);
 
-  if (size > 0) {
+  if (size > 0 && compression_type != THdfsCompression::NONE) {
     // Try compressing tuple_data to compression_scratch_, swap if compressed data is
     // smaller
     scoped_ptr<Codec> compressor;
-    Status status = Codec::CreateCompressor(NULL, false, THdfsCompression::LZ4,
-                                            &compressor);
+    Status status = Codec::CreateCompressor(NULL, false, compression_type, &compressor);
     DCHECK(status.ok()) << status.GetErrorMsg();
 
     int64_t compressed_size = compressor->MaxOutputLen(size);
@@ -197,7 +197,7 @@ int RowBatch::Serialize(TRowBatch* output_batch) {
     if (LIKELY(compressed_size < size)) {
       compression_scratch_.resize(compressed_size);
       output_batch->tuple_data.swap(compression_scratch_);
-      output_batch->compression_type = THdfsCompression::LZ4;
+      output_batch->compression_type = compression_type;
     }
     VLOG_ROW << "uncompressed size: " << size << ", compressed size: " << compressed_size;
   }
@@ -260,6 +260,17 @@ void RowBatch::TransferResourceOwnership(RowBatch* dest) {
   Reset();
 }
 
+int64_t RowBatch::TransferableBytes() const {
+  int64_t result = tuple_data_pool_->total_allocated_bytes();
+  for (int i = 0; i < io_buffers_.size(); ++i) {
+    result += io_buffers_[i]->buffer_len();
+  }
+  for (int i = 0; i < tuple_streams_.size(); ++i) {
+    result += tuple_streams_[i]->byte_size();
+  }
+  return result;
+}
+
 int RowBatch::GetBatchSize(const TRowBatch& batch) {
   int result = batch.tuple_data.size();
   result += batch.row_tuples.size() * sizeof(TTupleId);
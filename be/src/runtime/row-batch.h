@@ -25,6 +25,7 @@
 #include "runtime/disk-io-mgr.h"
 #include "runtime/mem-pool.h"
 #include "runtime/mem-tracker.h"
+#include "gen-cpp/CatalogObjects_types.h"  // for THdfsCompression
 
 namespace impala {
 
@@ -160,6 +161,10 @@ class RowBatch {
   // pool and io buffers.
   void TransferResourceOwnership(RowBatch* dest);
 
+  // Returns the bytes of the resources that TransferResourceOwnership() would hand
+  // over: the tuple data pool, io buffers and tuple streams.
+  int64_t TransferableBytes() const;
+
   void CopyRow(TupleRow* src, TupleRow* dest) {
     memcpy(dest, src, num_tuples_per_row_ * sizeof(Tuple*));
   }
@@ -191,13 +196,15 @@ class RowBatch {
 
   // Create a serialized version of this row batch in output_batch, attaching all of the
   // data it references to output_batch.tuple_data. output_batch.tuple_data will be
-  // snappy-compressed unless the compressed data is larger than the uncompressed
-  // data. Use output_batch.is_compressed to determine whether tuple_data is compressed.
+  // compressed with 'compression_type' unless that is NONE or the compressed data is
+  // not smaller than the uncompressed data. Use output_batch.compression_type to
+  // determine whether tuple_data is compressed.
   // If an in-flight row is present in this row batch, it is ignored.
   // This function does not Reset().
   // Returns the uncompressed serialized size (this will be the true size of output_batch
   // if tuple_data is actually uncompressed).
-  int Serialize(TRowBatch* output_batch);
+  int Serialize(TRowBatch* output_batch,
+      THdfsCompression::type compression_type = THdfsCompression::LZ4);
 
   // Utility function: returns total size of batch.
   static int GetBatchSize(const TRowBatch& batch);
@@ -23,12 +23,13 @@
 #include "common/status.h"
 #include "exprs/expr.h"
 #include "runtime/buffered-block-mgr.h"
+#include "runtime/client-cache.h"
 #include "runtime/descriptors.h"
 #include "runtime/runtime-state.h"
 #include "runtime/timestamp-value.h"
 #include "runtime/data-stream-mgr.h"
 #include "runtime/data-stream-recvr.h"
-#include "util/bitmap.h"
+#include "util/bloom-filter.h"
 #include "util/cpu-info.h"
 #include "util/debug-util.h"
 #include "util/disk-info.h"
@@ -36,11 +37,18 @@
 #include "util/jni-util.h"
 #include "util/mem-info.h"
 
+#include "gen-cpp/ImpalaInternalService.h"
+
 #include <jni.h>
 #include <iostream>
 
 DECLARE_int32(max_errors);
 
+DEFINE_double(runtime_filter_fpp, 0.05, "False positive probability that runtime "
+    "filters, built by hash joins for the scans of their probe side, are sized for.");
+DEFINE_int64(max_runtime_filter_bytes, 16 * 1024 * 1024, "Maximum size in bytes of a "
+    "runtime filter. Joins whose build side would need a larger filter don't build one.");
+
 using namespace boost;
 using namespace llvm;
 using namespace std;
@@ -61,6 +69,8 @@ static const int64_t BLOCK_MGR_MEM_MIN_REMAINING = 100 * 1024 * 1024;
 
 namespace impala {
 
+const uint32_t RuntimeState::RUNTIME_FILTER_HASH_SEED;
+
 RuntimeState::RuntimeState(const TPlanFragmentInstanceCtx& fragment_instance_ctx,
     const string& cgroup, ExecEnv* exec_env)
   : obj_pool_(new ObjectPool()),
@@ -96,13 +106,10 @@ RuntimeState::RuntimeState(const TQueryCtx& query_ctx)
 RuntimeState::~RuntimeState() {
   block_mgr_.reset();
 
-  typedef boost::unordered_map<SlotId, Bitmap*>::iterator SlotBitmapIterator;
-  for (SlotBitmapIterator it = slot_bitmap_filters_.begin();
-       it != slot_bitmap_filters_.end(); ++it) {
-    if (it->second != NULL) {
-      delete it->second;
-      it->second = NULL;
-    }
+  typedef boost::unordered_map<SlotId, BloomFilter*>::iterator SlotFilterIterator;
+  for (SlotFilterIterator it = slot_bloom_filters_.begin();
+       it != slot_bloom_filters_.end(); ++it) {
+    ReleaseBloomFilter(it->second);
   }
 
   // query_mem_tracker_ must be valid as long as instance_mem_tracker_ is so
@@ -162,6 +169,8 @@ void RuntimeState::InitMemTrackers(const TUniqueId& query_id, const string* pool
 
   udf_mem_tracker_.reset(
       new MemTracker(-1, -1, "UDFs", instance_mem_tracker_.get()));
+  filter_mem_tracker_.reset(
+      new MemTracker(-1, -1, "Runtime Filters", instance_mem_tracker_.get()));
 }
 
 Status RuntimeState::CreateBlockMgr() {
@@ -298,21 +307,96 @@ Status RuntimeState::QueryMaintenance() {
   return query_status_;
 }
 
-void RuntimeState::AddBitmapFilter(SlotId slot, Bitmap* bitmap,
-    bool* acquired_ownership) {
-  *acquired_ownership = false;
-  if (bitmap != NULL) {
-    ScopedSpinLock l(&bitmap_lock_);
-    if (slot_bitmap_filters_.find(slot) != slot_bitmap_filters_.end()) {
-      Bitmap* existing_bitmap = slot_bitmap_filters_[slot];
-      DCHECK_NOTNULL(existing_bitmap);
-      existing_bitmap->And(bitmap);
-    } else {
-      // This is the first time we set the slot_bitmap_filters_[slot]. We avoid
-      // allocating a new bitmap by using the passed bitmap.
-      slot_bitmap_filters_[slot] = bitmap;
-      *acquired_ownership = true;
+BloomFilter* RuntimeState::CreateBloomFilter(int64_t ndv) {
+  DCHECK(filter_mem_tracker_.get() != NULL);
+  int log_num_buckets = BloomFilter::MinLogNumBuckets(ndv, FLAGS_runtime_filter_fpp);
+  int64_t bytes = BloomFilter::BytesForLogNumBuckets(log_num_buckets);
+  if (bytes > FLAGS_max_runtime_filter_bytes) return NULL;
+  if (!filter_mem_tracker_->TryConsume(bytes)) return NULL;
+  return new BloomFilter(log_num_buckets);
+}
+
+void RuntimeState::ReleaseBloomFilter(BloomFilter* filter) {
+  if (filter == NULL) return;
+  filter_mem_tracker_->Release(filter->size_in_bytes());
+  delete filter;
+}
+
+void RuntimeState::AddBloomFilter(SlotId slot, BloomFilter* filter) {
+  DCHECK(filter != NULL);
+  {
+    ScopedSpinLock l(&bloom_filter_lock_);
+    if (slot_bloom_filters_.find(slot) == slot_bloom_filters_.end()) {
+      slot_bloom_filters_[slot] = filter;
+      return;
+    }
+  }
+  // Another join on this slot, or the coordinator after the local join, got there first.
+  ReleaseBloomFilter(filter);
+}
+
+Status RuntimeState::PublishBloomFilter(SlotId slot, const TBloomFilter& filter) {
+  DCHECK(filter_mem_tracker_.get() != NULL);
+  RETURN_IF_ERROR(BloomFilter::ValidateThrift(filter));
+  if (!filter_mem_tracker_->TryConsume(
+      BloomFilter::BytesForLogNumBuckets(filter.log_num_buckets))) {
+    VLOG_QUERY << "Dropping runtime filter on slot " << slot
+               << ": memory limit exceeded";
+    return Status::OK;
+  }
+  AddBloomFilter(slot, new BloomFilter(filter));
+  return Status::OK;
+}
+
+const BloomFilter* RuntimeState::GetBloomFilter(SlotId slot) {
+  ScopedSpinLock l(&bloom_filter_lock_);
+  boost::unordered_map<SlotId, BloomFilter*>::const_iterator it =
+      slot_bloom_filters_.find(slot);
+  return it == slot_bloom_filters_.end() ? NULL : it->second;
+}
+
+void RuntimeState::SendBloomFilter(PlanNodeId node_id, SlotId slot,
+    const BloomFilter* filter) {
+  TUpdateFilterParams params;
+  params.protocol_version = ImpalaInternalServiceVersion::V1;
+  params.__set_query_id(query_id());
+  params.__set_node_id(node_id);
+  params.__set_slot_id(slot);
+  if (filter != NULL) {
+    filter->ToThrift(&params.bloom_filter);
+    params.__isset.bloom_filter = true;
+  }
+
+  const TNetworkAddress& coord_address = query_ctx().coord_address;
+  Status status;
+  ImpalaInternalServiceConnection coord(impalad_client_cache(), coord_address, &status);
+  if (!status.ok()) {
+    LOG(WARNING) << "Couldn't get a client for " << coord_address
+                 << " to send runtime filter: " << status.GetErrorMsg();
+    return;
+  }
+  TUpdateFilterResult res;
+  try {
+    try {
+      coord->UpdateFilter(res, params);
+    } catch (const apache::thrift::TException& e) {
+      VLOG_RPC << "Retrying UpdateFilter: " << e.what();
+      status = coord.Reopen();
+      if (!status.ok()) {
+        LOG(WARNING) << "UpdateFilter() to " << coord_address << " failed: "
+                     << status.GetErrorMsg();
+        return;
+      }
+      coord->UpdateFilter(res, params);
     }
+  } catch (const apache::thrift::TException& e) {
+    LOG(WARNING) << "UpdateFilter() to " << coord_address << " failed: " << e.what();
+    return;
+  }
+  Status rpc_status(res.status);
+  if (!rpc_status.ok()) {
+    VLOG_QUERY << "UpdateFilter() to " << coord_address << " failed: "
+               << rpc_status.GetErrorMsg();
   }
 }
 
@@ -41,7 +41,8 @@
 
 namespace impala {
 
-class Bitmap;
+class BloomFilter;
+class TBloomFilter;
 class BufferedBlockMgr;
 class DescriptorTbl;
 class ObjectPool;
@@ -155,26 +156,45 @@ class RuntimeState {
   // See comment on root_node_id_. We add one to prevent having a hash seed of 0.
   uint32_t fragment_hash_seed() const { return root_node_id_ + 1; }
 
-  // Size to use when building bitmap filters. This is a prime number which reduces
-  // collisions and the resulting bitmap is just under 4Kb.
-  // Having all bitmaps be the same size allows us to combine (i.e. AND) bitmaps.
-  uint32_t slot_filter_bitmap_size() const { return 32213; }
-
-  // Adds a bitmap filter on slot 'slot'. If hash(slot) % bitmap.Size() is false, this
-  // value can be filtered out. Multiple bitmap filters can be added to a single slot.
-  // If it is the first call to add a bitmap filter for the specific slot, indicated by
-  // 'acquired_ownership', then the passed bitmap should not be deleted by the caller.
-  // Thread safe.
-  void AddBitmapFilter(SlotId slot, Bitmap* bitmap, bool* acquired_ownership);
-
-  // Returns bitmap filter on 'slot'. Returns NULL if there are no bitmap filters on this
-  // slot.
-  // It is not safe to concurrently call AddBitmapFilter() and GetBitmapFilter().
-  // All calls to AddBitmapFilter() should happen before.
-  const Bitmap* GetBitmapFilter(SlotId slot) {
-    if (slot_bitmap_filters_.find(slot) == slot_bitmap_filters_.end()) return NULL;
-    return slot_bitmap_filters_[slot];
-  }
+  // Seed for hashing the values inserted into and looked up in runtime filters. Unlike
+  // fragment_hash_seed() it is the same in all fragments: a filter built by a join in
+  // one fragment is applied by the scans of others.
+  static const uint32_t RUNTIME_FILTER_HASH_SEED = 0x2f8a6c47;
+
+  // Creates a runtime filter for 'ndv' distinct build values, sized for a false
+  // positive probability of --runtime_filter_fpp, and charges its memory to this
+  // fragment instance. Returns NULL if that filter would be larger than
+  // --max_runtime_filter_bytes or its memory can't be charged. The caller owns the
+  // returned filter and must free it with ReleaseBloomFilter() or hand it to
+  // AddBloomFilter().
+  BloomFilter* CreateBloomFilter(int64_t ndv);
+
+  // Frees 'filter', which was returned by CreateBloomFilter(), and releases its memory.
+  void ReleaseBloomFilter(BloomFilter* filter);
+
+  // Adds the runtime filter 'filter' on slot 'slot', which was returned by
+  // CreateBloomFilter(), and takes ownership of it. A value of 'slot' whose hash (see
+  // RUNTIME_FILTER_HASH_SEED) is not found in the filter can be filtered out. Only the
+  // first filter added for a slot is kept, later ones are released. Thread safe.
+  void AddBloomFilter(SlotId slot, BloomFilter* filter);
+
+  // Adds the runtime filter on 'slot' published by the coordinator, like
+  // AddBloomFilter(). The filter is dropped if its memory can't be charged to this
+  // fragment instance. Returns an error if 'filter' is malformed. Thread safe.
+  Status PublishBloomFilter(SlotId slot, const TBloomFilter& filter);
+
+  // Returns the runtime filter on 'slot', or NULL if there is none. Filters can arrive
+  // from other fragments at any time during execution, so callers that got NULL should
+  // check again later, e.g. for the next scan range. The returned filter is valid for
+  // the lifetime of this state. Thread safe.
+  const BloomFilter* GetBloomFilter(SlotId slot);
+
+  // Sends the runtime filter on 'slot' built by the join 'node_id' of this fragment
+  // instance to the coordinator, which publishes the union of the filters of all
+  // instances to the fragment instances scanning 'slot'. A NULL 'filter' means that
+  // this instance could not build one, which disables the filter for the query.
+  // Errors are logged and otherwise ignored, since filters only prune rows.
+  void SendBloomFilter(PlanNodeId node_id, SlotId slot, const BloomFilter* filter);
 
   PartitionStatusMap* per_partition_status() { return &per_partition_status_; }
 
@@ -375,6 +395,9 @@ class RuntimeState {
   // Memory tracker for UDFs
   boost::scoped_ptr<MemTracker> udf_mem_tracker_;
 
+  // Memory tracker for the runtime filters created by and added to this instance.
+  boost::scoped_ptr<MemTracker> filter_mem_tracker_;
+
   // Query-wide resource manager for resource expansion etc. Not owned by us; owned by the
   // ResourceBroker instead.
   QueryResourceMgr* query_resource_mgr_;
@@ -390,18 +413,17 @@ class RuntimeState {
   // This is the node id of the root node for this plan fragment. This is used as the
   // hash seed and has two useful properties:
   // 1) It is the same for all exec nodes in a fragment, so the resulting hash values
-  // can be shared (i.e. for slot_bitmap_filters_).
+  // can be shared.
   // 2) It is different between different fragments, so we do not run into hash
   // collisions after data partitioning (across fragments). See IMPALA-219 for more
   // details.
   PlanNodeId root_node_id_;
 
-  // Lock protecting slot_bitmap_filters_
-  SpinLock bitmap_lock_;
+  // Lock protecting slot_bloom_filters_
+  SpinLock bloom_filter_lock_;
 
-  // Bitmap filter on the hash for 'SlotId'. If bitmap[hash(slot]] is unset, this
-  // value can be filtered out. These filters are generated during the query execution.
-  boost::unordered_map<SlotId, Bitmap*> slot_bitmap_filters_;
+  // Runtime filters on the hash of 'SlotId', see AddBloomFilter(). Owned.
+  boost::unordered_map<SlotId, BloomFilter*> slot_bloom_filters_;
 
   std::vector<ExprContext*> expr_ctxs_to_free_;
 
@@ -19,6 +19,7 @@
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
 #include "runtime/sorted-run-merger.h"
+#include "util/key-normalizer.inline.h"
 #include "util/runtime-profile.h"
 
 using namespace boost;
@@ -188,19 +189,25 @@ class Sorter::Run {
 }; // class Sorter::Run
 
 // Sorts a sequence of tuples from a run in place using a provided tuple comparator.
-// Quick sort is used for sequences of tuples larger that 16 elements, and
-// insertion sort is used for smaller sequences.
+// If the leading sort keys can be normalized (see KeyNormalizer), the tuples are sorted
+// on a NORMALIZED_KEY_LEN byte normalized prefix of their keys with memcmp(), and the
+// comparator is only called for tuples whose prefixes are equal. The normalized keys are
+// computed once per tuple, together with the tuple's index, in an array that is sorted
+// with std::sort(). The tuples are then moved into the sorted order in a single pass.
+// Otherwise, or if the memory for the array can't be reserved, quick sort is used for
+// sequences of tuples larger that 16 elements, and insertion sort is used for smaller
+// sequences.
 // The TupleSorter is initialized with a RuntimeState instance to check for
 // cancellation during an in-memory sort.
 class Sorter::TupleSorter {
  public:
   TupleSorter(const TupleRowComparator& less_than_comp, int64_t block_size,
-      int tuple_size, RuntimeState* state);
+      int tuple_size, MemTracker* mem_tracker, RuntimeState* state);
 
   ~TupleSorter();
 
-  // Performs a quicksort for tuples in 'run' followed by an insertion sort to
-  // finish smaller blocks.
+  // Sorts the tuples in 'run', on their normalized keys if possible, or else with a
+  // quicksort followed by an insertion sort to finish smaller blocks.
   // Returns early if stste_->is_cancelled() is true. No status
   // is returned - the caller must check for cancellation.
   void Sort(Run* run);
@@ -208,6 +215,20 @@ class Sorter::TupleSorter {
  private:
   static const int INSERTION_THRESHOLD = 16;
 
+  // Length of the normalized key prefix of each tuple. Fits two BIGINT keys, or a
+  // string key's first 23 characters, and makes NormalizedKeyEntry 32 bytes.
+  static const int NORMALIZED_KEY_LEN = 24;
+
+  // The normalized key prefix of the tuple at 'index' in the run.
+  struct NormalizedKeyEntry {
+    uint8_t key[NORMALIZED_KEY_LEN];
+    int64_t index;
+  };
+
+  // Orders NormalizedKeyEntries on their keys, and entries with equal keys on their
+  // tuples with less_than_comp_, unless normalized_keys_are_complete_.
+  class NormalizedKeyLess;
+
   // Helper class used to iterate over tuples in a run during quick sort and insertion
   // sort.
   class TupleIterator {
@@ -293,6 +314,17 @@ class Sorter::TupleSorter {
   // Tuple comparator that returns true if lhs < rhs.
   const TupleRowComparator less_than_comp_;
 
+  // Normalizes the leading sort keys that KeyNormalizer supports. NULL if the first
+  // sort key is not supported.
+  boost::scoped_ptr<KeyNormalizer> key_normalizer_;
+
+  // True if the normalized keys always hold all sort keys in full, i.e. tuples with
+  // equal normalized keys have equal sort keys.
+  bool normalized_keys_are_complete_;
+
+  // Tracks the memory of the normalized key array. Not owned.
+  MemTracker* const mem_tracker_;
+
   // Runtime state instance to check for cancellation. Not owned.
   RuntimeState* const state_;
 
@@ -305,6 +337,20 @@ class Sorter::TupleSorter {
   uint8_t* temp_tuple_buffer_;
   uint8_t* swap_buffer_;
 
+  // Returns the tuple at 'index' in run_.
+  uint8_t* GetTuple(int64_t index) const {
+    return run_->fixed_len_blocks_[index / block_capacity_]->buffer() +
+        (index % block_capacity_) * tuple_size_;
+  }
+
+  // Sorts run_ on the normalized keys of its tuples. Returns false, without modifying
+  // run_, if the memory for the normalized keys is not available.
+  bool SortNormalized();
+
+  // Moves the tuples of run_ so that position i holds the tuple that was at
+  // (*entries)[i].index. Overwrites the indexes.
+  void Permute(std::vector<NormalizedKeyEntry>* entries);
+
   // Perform an insertion sort for rows in the range [first, last) in a run.
   void InsertionSort(const TupleIterator& first, const TupleIterator& last);
 
@@ -397,8 +443,15 @@ Status Sorter::Run::AddBatch(RowBatch* batch, int start_index, int* num_processe
       TupleRow* input_row = batch->GetRow(cur_input_index);
       Tuple* new_tuple = cur_fixed_len_block->Allocate<Tuple>(sort_tuple_size_);
       if (materialize_slots_) {
-        new_tuple->MaterializeExprs<has_var_len_data>(input_row, *sort_tuple_desc_,
-            sorter_->sort_tuple_slot_expr_ctxs_, NULL, &var_values, &total_var_len);
+        if (sorter_->materialize_exprs_fn_ != NULL) {
+          sorter_->materialize_exprs_fn_(new_tuple, input_row);
+          if (has_var_len_data) {
+            CollectNonNullVarSlots(new_tuple, &var_values, &total_var_len);
+          }
+        } else {
+          new_tuple->MaterializeExprs<has_var_len_data>(input_row, *sort_tuple_desc_,
+              sorter_->sort_tuple_slot_expr_ctxs_, NULL, &var_values, &total_var_len);
+        }
         if (total_var_len > sorter_->block_mgr_->max_block_size()) {
           return Status(TStatusCode::INTERNAL_ERROR, Substitute(
               "Variable length data in a single tuple larger than block size $0 > $1",
@@ -737,16 +790,40 @@ void Sorter::Run::CopyVarLenDataConvertOffset(char* dest, int64_t offset,
 }
 
 // Sorter::TupleSorter methods.
+class Sorter::TupleSorter::NormalizedKeyLess {
+ public:
+  NormalizedKeyLess(const TupleSorter* sorter) : sorter_(sorter) { }
+
+  bool operator()(const NormalizedKeyEntry& lhs, const NormalizedKeyEntry& rhs) const {
+    int result = memcmp(lhs.key, rhs.key, NORMALIZED_KEY_LEN);
+    if (result != 0) return result < 0;
+    if (sorter_->normalized_keys_are_complete_) return false;
+    Tuple* lhs_tuple = reinterpret_cast<Tuple*>(sorter_->GetTuple(lhs.index));
+    Tuple* rhs_tuple = reinterpret_cast<Tuple*>(sorter_->GetTuple(rhs.index));
+    return sorter_->less_than_comp_(lhs_tuple, rhs_tuple);
+  }
+
+ private:
+  const TupleSorter* sorter_;
+};
+
 Sorter::TupleSorter::TupleSorter(const TupleRowComparator& comp, int64_t block_size,
-    int tuple_size, RuntimeState* state)
+    int tuple_size, MemTracker* mem_tracker, RuntimeState* state)
   : tuple_size_(tuple_size),
     block_capacity_(block_size / tuple_size),
     last_tuple_block_offset_(tuple_size * ((block_size / tuple_size) - 1)),
     less_than_comp_(comp),
+    normalized_keys_are_complete_(true),
+    mem_tracker_(mem_tracker),
     state_(state) {
   temp_tuple_buffer_ = new uint8_t[tuple_size];
   temp_tuple_row_ = reinterpret_cast<TupleRow*>(&temp_tuple_buffer_);
   swap_buffer_ = new uint8_t[tuple_size];
+
+  // Normalize the longest prefix of the sort keys that KeyNormalizer supports. Keys
+  // that don't fit in the normalized key are compared with less_than_comp_.
+  key_normalizer_.reset(KeyNormalizer::Create(comp, NORMALIZED_KEY_LEN,
+      &normalized_keys_are_complete_));
 }
 
 Sorter::TupleSorter::~TupleSorter() {
@@ -756,10 +833,52 @@ Sorter::TupleSorter::~TupleSorter() {
 
 void Sorter::TupleSorter::Sort(Run* run) {
   run_ = run;
-  SortHelper(TupleIterator(this, 0), TupleIterator(this, run_->num_tuples_));
+  if (key_normalizer_.get() == NULL || run_->num_tuples_ <= INSERTION_THRESHOLD ||
+      !SortNormalized()) {
+    SortHelper(TupleIterator(this, 0), TupleIterator(this, run_->num_tuples_));
+  }
   run->is_sorted_ = true;
 }
 
+bool Sorter::TupleSorter::SortNormalized() {
+  int64_t num_tuples = run_->num_tuples_;
+  int64_t mem_needed = num_tuples * sizeof(NormalizedKeyEntry);
+  if (!mem_tracker_->TryConsume(mem_needed)) return false;
+  vector<NormalizedKeyEntry> entries(num_tuples);
+  for (int64_t i = 0; i < num_tuples; ++i) {
+    uint8_t* tuple = GetTuple(i);
+    key_normalizer_->NormalizeKey(reinterpret_cast<TupleRow*>(&tuple), entries[i].key);
+    entries[i].index = i;
+  }
+  sort(entries.begin(), entries.end(), NormalizedKeyLess(this));
+  if (LIKELY(!state_->is_cancelled())) Permute(&entries);
+  entries.clear();
+  mem_tracker_->Release(mem_needed);
+  return true;
+}
+
+void Sorter::TupleSorter::Permute(vector<NormalizedKeyEntry>* entries) {
+  // Follow each cycle of the permutation, starting at position i: the tuple at i is
+  // saved in temp_tuple_buffer_, and each position of the cycle is filled from the
+  // next one, whose tuple has then been moved and can be overwritten. Positions that
+  // hold their final tuple are marked by setting their index to themselves.
+  for (int64_t i = 0; i < entries->size(); ++i) {
+    if ((*entries)[i].index == i) continue;
+    memcpy(temp_tuple_buffer_, GetTuple(i), tuple_size_);
+    int64_t dst = i;
+    while (true) {
+      int64_t src = (*entries)[dst].index;
+      (*entries)[dst].index = dst;
+      if (src == i) {
+        memcpy(GetTuple(dst), temp_tuple_buffer_, tuple_size_);
+        break;
+      }
+      memcpy(GetTuple(dst), GetTuple(src), tuple_size_);
+      dst = src;
+    }
+  }
+}
+
 // Sort the sequence of tuples from [first, last).
 // Begin with a sorted sequence of size 1 [first, first+1).
 // During each pass of the outermost loop, add the next tuple (at position 'i') to
@@ -851,18 +970,20 @@ inline void Sorter::TupleSorter::Swap(uint8_t* left, uint8_t* right) {
 Sorter::Sorter(const TupleRowComparator& compare_less_than,
     const vector<ExprContext*>& slot_materialize_expr_ctxs,
     RowDescriptor* output_row_desc, MemTracker* mem_tracker,
-    RuntimeProfile* profile, RuntimeState* state)
+    RuntimeProfile* profile, RuntimeState* state,
+    Tuple::MaterializeExprsFn materialize_exprs_fn)
   : state_(state),
     compare_less_than_(compare_less_than),
     block_mgr_(state->block_mgr()),
     output_row_desc_(output_row_desc),
     sort_tuple_slot_expr_ctxs_(slot_materialize_expr_ctxs),
+    materialize_exprs_fn_(materialize_exprs_fn),
     mem_tracker_(mem_tracker),
     profile_(profile) {
   TupleDescriptor* sort_tuple_desc = output_row_desc->tuple_descriptors()[0];
   has_var_len_slots_ = sort_tuple_desc->string_slots().size() > 0;
   in_mem_tuple_sorter_.reset(new TupleSorter(compare_less_than,
-      block_mgr_->max_block_size(), sort_tuple_desc->byte_size(), state));
+      block_mgr_->max_block_size(), sort_tuple_desc->byte_size(), mem_tracker, state));
 
   initial_runs_counter_ = ADD_COUNTER(profile_, "InitialRunsCreated", TCounterType::UNIT);
   num_merges_counter_ = ADD_COUNTER(profile_, "TotalMergesPerformed", TCounterType::UNIT);
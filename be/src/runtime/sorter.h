@@ -52,8 +52,10 @@ class RowBatch;
 // When the blocks containing tuples in a run are unpinned, the var-len slot pointers are
 // converted to offsets from the start of the first var-len data block. When a block is
 // read back, these offsets are converted back to pointers.
-// The in-memory sorter sorts the fixed-length tuples in-place. The output rows have the
-// same schema as the materialized sort tuples.
+// The in-memory sorter sorts the fixed-length tuples in-place. Where the sort keys
+// allow, it sorts on memcmp()-able normalized key prefixes (see KeyNormalizer) and only
+// evaluates the comparator on ties. The output rows have the same schema as the
+// materialized sort tuples.
 //
 // After the input is consumed, the sorter is left with one or more sorted runs. The
 // client calls GetNext(output_batch) to retrieve batches of sorted rows. If there are
@@ -85,10 +87,13 @@ class Sorter {
   // compare_less_than is a comparator for the sort tuples (returns true if lhs < rhs).
   // merge_batch_size_ is the size of the batches created to provide rows to the merger
   // and retrieve rows from an intermediate merger.
+  // If non-NULL, materialize_exprs_fn is the codegen'd version of materializing the
+  // sort tuple with sort_tuple_slot_exprs, see Tuple::CodegenMaterializeExprs().
   Sorter(const TupleRowComparator& compare_less_than,
       const std::vector<ExprContext*>& sort_tuple_slot_expr_ctxs,
       RowDescriptor* output_row_desc, MemTracker* mem_tracker,
-      RuntimeProfile* profile, RuntimeState* state);
+      RuntimeProfile* profile, RuntimeState* state,
+      Tuple::MaterializeExprsFn materialize_exprs_fn = NULL);
 
   ~Sorter();
 
@@ -174,6 +179,10 @@ class Sorter {
   // tuple.
   std::vector<ExprContext*> sort_tuple_slot_expr_ctxs_;
 
+  // Codegen'd function that materializes the sort tuple, or NULL if the exprs in
+  // sort_tuple_slot_expr_ctxs_ are evaluated by the interpreter.
+  Tuple::MaterializeExprsFn materialize_exprs_fn_;
+
   // Mem tracker for batches created during merge. Not owned by Sorter.
   MemTracker* mem_tracker_;
 
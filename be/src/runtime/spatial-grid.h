@@ -0,0 +1,113 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_RUNTIME_SPATIAL_GRID_H
+#define IMPALA_RUNTIME_SPATIAL_GRID_H
+
+#include <algorithm>
+#include <vector>
+
+#include "common/logging.h"
+#include "runtime/spatial-value.h"
+
+#include "gen-cpp/Types_types.h"  // for TSpatialGrid
+
+namespace impala {
+
+// A uniform grid over the plane, used to split spatial inputs into cells that can be
+// joined or aggregated independently. Cells are numbered in row-major order, i.e.
+// cell_id = row * num_cols + col. Coordinates outside of the grid's bounds are clamped
+// to the nearest edge cell, so every point belongs to exactly one cell.
+//
+// All spatial operators that exchange or compare cell ids (the spatial partitioner in
+// DataStreamSender and SpatialJoinNode) must map coordinates to cells with this class so
+// they agree on cell boundaries.
+class SpatialGrid {
+ public:
+  SpatialGrid(const TSpatialGrid& grid)
+    : bounds_(grid.x1, grid.y1, grid.x2, grid.y2),
+      num_cols_(grid.num_cols),
+      num_rows_(grid.num_rows),
+      cell_width_((grid.x2 - grid.x1) / grid.num_cols),
+      cell_height_((grid.y2 - grid.y1) / grid.num_rows) {
+    DCHECK_GT(num_cols_, 0);
+    DCHECK_GT(num_rows_, 0);
+    DCHECK_GT(cell_width_, 0);
+    DCHECK_GT(cell_height_, 0);
+  }
+
+  int num_cells() const { return num_cols_ * num_rows_; }
+  int num_cols() const { return num_cols_; }
+  int num_rows() const { return num_rows_; }
+
+  // Returns the id of the cell containing 'p'.
+  int GetCell(const PointValue& p) const {
+    return GetRow(p.y) * num_cols_ + GetCol(p.x);
+  }
+
+  // Appends the ids of all cells that 'r' overlaps to 'cells', in ascending order.
+  void GetOverlappedCells(const RectangleValue& r, std::vector<int>* cells) const {
+    int col1 = GetCol(r.x1);
+    int col2 = GetCol(r.x2);
+    int row1 = GetRow(r.y1);
+    int row2 = GetRow(r.y2);
+    for (int row = row1; row <= row2; ++row) {
+      for (int col = col1; col <= col2; ++col) {
+        cells->push_back(row * num_cols_ + col);
+      }
+    }
+  }
+
+  // Returns the id of the cell that owns the result pair (r, s) under the reference
+  // point method: the cell containing the lower-left corner of r and s's intersection.
+  // Both r and s overlap that cell, so a pair that is found in several cells is only
+  // reported once.
+  int GetReferenceCell(const RectangleValue& r, const RectangleValue& s) const {
+    return GetCell(PointValue(std::max(r.x1, s.x1), std::max(r.y1, s.y1)));
+  }
+
+  // Returns the bounds of cell 'cell_id'.
+  RectangleValue GetCellBounds(int cell_id) const {
+    DCHECK_GE(cell_id, 0);
+    DCHECK_LT(cell_id, num_cells());
+    int col = cell_id % num_cols_;
+    int row = cell_id / num_cols_;
+    return RectangleValue(bounds_.x1 + col * cell_width_, bounds_.y1 + row * cell_height_,
+        bounds_.x1 + (col + 1) * cell_width_, bounds_.y1 + (row + 1) * cell_height_);
+  }
+
+ private:
+  int GetCol(double x) const { return Clamp((x - bounds_.x1) / cell_width_, num_cols_); }
+  int GetRow(double y) const { return Clamp((y - bounds_.y1) / cell_height_, num_rows_); }
+
+  // Converts the fractional cell index 'idx' to an index in [0, n). Checks the range
+  // before converting to int, since the conversion is undefined for out-of-range values.
+  // NaN coordinates map to cell 0.
+  static int Clamp(double idx, int n) {
+    if (!(idx >= 0)) return 0;
+    if (idx >= n) return n - 1;
+    return static_cast<int>(idx);
+  }
+
+  RectangleValue bounds_;
+  int num_cols_;
+  int num_rows_;
+  double cell_width_;
+  double cell_height_;
+};
+
+}
+
+#endif
@@ -0,0 +1,112 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "runtime/spatial-polygon.h"
+
+using namespace std;
+
+namespace impala {
+
+static bool Parse(const string& wkt, SpatialPolygon* polygon) {
+  string error;
+  return polygon->ParseWkt(wkt.c_str(), wkt.size(), &error);
+}
+
+TEST(SpatialPolygonTest, Parse) {
+  SpatialPolygon polygon;
+  EXPECT_TRUE(Parse("POLYGON ((0 0, 10 0, 10 10, 0 10, 0 0))", &polygon));
+  EXPECT_EQ(polygon.num_edges(), 2);
+  EXPECT_EQ(polygon.mbr(), RectangleValue(0, 0, 10, 10));
+  EXPECT_TRUE(Parse("  polygon((0 0,1 0,0 1),(0.1 0.1, 0.2 0.1, 0.1 0.2)) ", &polygon));
+  EXPECT_EQ(polygon.num_edges(), 4);
+  EXPECT_TRUE(Parse("POLYGON ((-1e3 -1e3, 1e3 -1e3, 0 1e3))", &polygon));
+
+  EXPECT_FALSE(Parse("", &polygon));
+  EXPECT_FALSE(Parse("POINT (0 0)", &polygon));
+  EXPECT_FALSE(Parse("POLYGON (0 0, 1 0, 0 1)", &polygon));
+  EXPECT_FALSE(Parse("POLYGON ((0 0, 1 0, 0 1)", &polygon));
+  EXPECT_FALSE(Parse("POLYGON ((0 0, 1 0, 0 1)) x", &polygon));
+  EXPECT_FALSE(Parse("POLYGON ((0 0, 1 0, 0 0))", &polygon));
+  EXPECT_FALSE(Parse("POLYGON ((0 0, 1, 0 1))", &polygon));
+  EXPECT_FALSE(Parse("POLYGON ((0 0, nan 0, 0 1))", &polygon));
+}
+
+TEST(SpatialPolygonTest, Edges) {
+  // A square with a square hole. Lower and left edges are inclusive, upper and right
+  // edges exclusive, for the outer ring as well as for the hole.
+  SpatialPolygon polygon;
+  ASSERT_TRUE(Parse("POLYGON ((0 0, 10 0, 10 10, 0 10), (4 4, 6 4, 6 6, 4 6))",
+      &polygon));
+  polygon.Prepare();
+  ASSERT_TRUE(polygon.is_prepared());
+  EXPECT_TRUE(polygon.Contains(PointValue(1, 1)));
+  EXPECT_TRUE(polygon.Contains(PointValue(0, 0)));
+  EXPECT_TRUE(polygon.Contains(PointValue(0, 5)));
+  EXPECT_FALSE(polygon.Contains(PointValue(10, 5)));
+  EXPECT_FALSE(polygon.Contains(PointValue(5, 10)));
+  EXPECT_FALSE(polygon.Contains(PointValue(5, 5)));
+  EXPECT_FALSE(polygon.Contains(PointValue(4, 5)));
+  EXPECT_TRUE(polygon.Contains(PointValue(6, 5)));
+  EXPECT_FALSE(polygon.Contains(PointValue(-1, 5)));
+  EXPECT_FALSE(polygon.Contains(PointValue(NAN, 5)));
+  EXPECT_FALSE(polygon.Contains(PointValue(5, NAN)));
+}
+
+// Checks that the slab index gives the same answers as testing every edge, on random
+// star-shaped polygons with many vertices at shared y coordinates.
+TEST(SpatialPolygonTest, PreparedMatchesBruteForce) {
+  srand(0);
+  for (int iter = 0; iter < 20; ++iter) {
+    int num_vertices = 3 + rand() % 200;
+    stringstream wkt;
+    wkt << "POLYGON ((";
+    for (int i = 0; i < num_vertices; ++i) {
+      double angle = 2 * M_PI * i / num_vertices;
+      double radius = 10 + rand() % 90;
+      if (i > 0) wkt << ", ";
+      wkt << round(radius * cos(angle)) << " " << round(radius * sin(angle));
+    }
+    wkt << "), (-2 -2, 2 -2, 2 2, -2 2))";
+    SpatialPolygon prepared;
+    SpatialPolygon unprepared;
+    ASSERT_TRUE(Parse(wkt.str(), &prepared)) << wkt.str();
+    ASSERT_TRUE(Parse(wkt.str(), &unprepared));
+    prepared.Prepare();
+    ASSERT_TRUE(prepared.is_prepared());
+    ASSERT_FALSE(unprepared.is_prepared());
+    for (int i = 0; i < 2000; ++i) {
+      // Integer coordinates hit vertices and edges, the others fall in between.
+      PointValue p(rand() % 220 - 110, rand() % 220 - 110);
+      if (i % 2 == 0) {
+        p.x += rand() / static_cast<double>(RAND_MAX);
+        p.y += rand() / static_cast<double>(RAND_MAX);
+      }
+      EXPECT_EQ(unprepared.Contains(p), prepared.Contains(p))
+          << wkt.str() << " " << p;
+    }
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,233 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/spatial-polygon.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <limits>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "common/logging.h"
+
+using namespace impala;
+using namespace std;
+
+struct SpatialPolygon::EdgeLess {
+  EdgeLess(const vector<Edge>& edges, double y) : edges(edges), y(y) { }
+
+  bool operator()(int a, int b) const { return edges[a].XAt(y) < edges[b].XAt(y); }
+
+  const vector<Edge>& edges;
+  double y;
+};
+
+SpatialPolygon::SpatialPolygon()
+  : mbr_(numeric_limits<double>::infinity(), numeric_limits<double>::infinity(),
+        -numeric_limits<double>::infinity(), -numeric_limits<double>::infinity()),
+    is_prepared_(false) {
+}
+
+// Recursive-descent parser for the WKT polygon grammar:
+//   polygon := 'POLYGON' '(' ring (',' ring)* ')'
+//   ring := '(' point (',' point)* ')'
+//   point := number number
+class WktParser {
+ public:
+  WktParser(const char* wkt, int len) : text_(wkt, len), pos_(text_.c_str()) { }
+
+  bool ConsumeKeyword(const char* keyword) {
+    SkipSpaces();
+    int len = strlen(keyword);
+    if (strncasecmp(pos_, keyword, len) != 0) return false;
+    pos_ += len;
+    return true;
+  }
+
+  bool Consume(char c) {
+    SkipSpaces();
+    if (*pos_ != c) return false;
+    ++pos_;
+    return true;
+  }
+
+  bool ParseNumber(double* value) {
+    SkipSpaces();
+    char* end;
+    *value = strtod(pos_, &end);
+    if (end == pos_) return false;
+    pos_ = end;
+    return true;
+  }
+
+  bool AtEnd() {
+    SkipSpaces();
+    return *pos_ == '\0';
+  }
+
+  // Returns the offset of the current position, for error messages.
+  int offset() const { return pos_ - text_.c_str(); }
+
+ private:
+  void SkipSpaces() {
+    while (isspace(*pos_)) ++pos_;
+  }
+
+  // NUL-terminated copy of the text, since strtod() needs one.
+  const string text_;
+  const char* pos_;
+};
+
+bool SpatialPolygon::ParseWkt(const char* wkt, int len, string* error) {
+  *this = SpatialPolygon();
+  WktParser parser(wkt, len);
+  if (!parser.ConsumeKeyword("POLYGON") || !parser.Consume('(')) {
+    *error = "Expected 'POLYGON ((...))'";
+    return false;
+  }
+  do {
+    if (!parser.Consume('(')) break;
+    vector<PointValue> ring;
+    do {
+      PointValue p;
+      if (!parser.ParseNumber(&p.x) || !parser.ParseNumber(&p.y)) break;
+      if (!(p.x == p.x) || !(p.y == p.y)) {
+        *error = "Polygon coordinates must not be NaN";
+        return false;
+      }
+      ring.push_back(p);
+    } while (parser.Consume(','));
+    if (!parser.Consume(')')) break;
+    if (ring.size() > 1 && ring.front() == ring.back()) ring.pop_back();
+    if (ring.size() < 3) {
+      *error = "Polygon rings must have at least 3 distinct vertices";
+      return false;
+    }
+    for (int i = 0; i < ring.size(); ++i) {
+      const PointValue& a = ring[i];
+      const PointValue& b = ring[(i + 1) % ring.size()];
+      mbr_.Expand(RectangleValue(a.x, a.y, a.x, a.y));
+      // Horizontal edges are never crossed by a horizontal ray.
+      if (a.y == b.y) continue;
+      Edge e;
+      if (a.y < b.y) {
+        e.x1 = a.x; e.y1 = a.y; e.x2 = b.x; e.y2 = b.y;
+      } else {
+        e.x1 = b.x; e.y1 = b.y; e.x2 = a.x; e.y2 = a.y;
+      }
+      edges_.push_back(e);
+    }
+    if (parser.Consume(')')) {
+      if (parser.AtEnd()) return true;
+      break;
+    }
+  } while (parser.Consume(','));
+  stringstream ss;
+  ss << "Invalid polygon at offset " << parser.offset();
+  *error = ss.str();
+  return false;
+}
+
+void SpatialPolygon::Prepare() {
+  slab_ys_.clear();
+  slab_offsets_.clear();
+  slab_edges_.clear();
+  is_prepared_ = false;
+  for (int i = 0; i < edges_.size(); ++i) {
+    slab_ys_.push_back(edges_[i].y1);
+    slab_ys_.push_back(edges_[i].y2);
+  }
+  sort(slab_ys_.begin(), slab_ys_.end());
+  slab_ys_.erase(unique(slab_ys_.begin(), slab_ys_.end()), slab_ys_.end());
+  if (slab_ys_.size() < 2) return;
+  int num_slabs = slab_ys_.size() - 1;
+
+  // Edge i spans the slabs first_slab[i] to last_slab[i] - 1. Count the entries per
+  // slab first, so that slab_edges_ can be filled in place.
+  vector<int> first_slab(edges_.size());
+  vector<int> last_slab(edges_.size());
+  slab_offsets_.resize(num_slabs + 1, 0);
+  int64_t num_entries = 0;
+  for (int i = 0; i < edges_.size(); ++i) {
+    first_slab[i] =
+        lower_bound(slab_ys_.begin(), slab_ys_.end(), edges_[i].y1) - slab_ys_.begin();
+    last_slab[i] =
+        lower_bound(slab_ys_.begin(), slab_ys_.end(), edges_[i].y2) - slab_ys_.begin();
+    num_entries += last_slab[i] - first_slab[i];
+    if (num_entries > MAX_SLAB_EDGES) {
+      slab_ys_.clear();
+      slab_offsets_.clear();
+      return;
+    }
+    for (int slab = first_slab[i]; slab < last_slab[i]; ++slab) {
+      ++slab_offsets_[slab + 1];
+    }
+  }
+  for (int slab = 0; slab < num_slabs; ++slab) {
+    slab_offsets_[slab + 1] += slab_offsets_[slab];
+  }
+  slab_edges_.resize(num_entries);
+  vector<int> fill_offsets(slab_offsets_.begin(), slab_offsets_.end() - 1);
+  for (int i = 0; i < edges_.size(); ++i) {
+    for (int slab = first_slab[i]; slab < last_slab[i]; ++slab) {
+      slab_edges_[fill_offsets[slab]++] = i;
+    }
+  }
+
+  // Within a slab the edges don't cross, so their order at the middle of the slab is
+  // their order at every y in it.
+  for (int slab = 0; slab < num_slabs; ++slab) {
+    double mid_y = (slab_ys_[slab] + slab_ys_[slab + 1]) / 2;
+    sort(slab_edges_.begin() + slab_offsets_[slab],
+        slab_edges_.begin() + slab_offsets_[slab + 1], EdgeLess(edges_, mid_y));
+  }
+  is_prepared_ = true;
+}
+
+bool SpatialPolygon::Contains(const PointValue& p) const {
+  // This also rejects NaN coordinates.
+  if (!(p.x >= mbr_.x1 && p.x < mbr_.x2 && p.y >= mbr_.y1 && p.y < mbr_.y2)) {
+    return false;
+  }
+  if (!is_prepared_) return ContainsBruteForce(p);
+
+  int slab = upper_bound(slab_ys_.begin(), slab_ys_.end(), p.y) - slab_ys_.begin() - 1;
+  DCHECK_GE(slab, 0);
+  DCHECK_LT(slab + 1, static_cast<int>(slab_ys_.size()));
+  // Count the edges at or left of p.x: they are a prefix of the slab's edges.
+  int lo = slab_offsets_[slab];
+  int hi = slab_offsets_[slab + 1];
+  int begin = lo;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (edges_[slab_edges_[mid]].XAt(p.y) <= p.x) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo - begin) & 1;
+}
+
+bool SpatialPolygon::ContainsBruteForce(const PointValue& p) const {
+  int num_crossings = 0;
+  for (int i = 0; i < edges_.size(); ++i) {
+    const Edge& e = edges_[i];
+    if (e.y1 <= p.y && p.y < e.y2 && e.XAt(p.y) <= p.x) ++num_crossings;
+  }
+  return num_crossings & 1;
+}
@@ -0,0 +1,97 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_RUNTIME_SPATIAL_POLYGON_H
+#define IMPALA_RUNTIME_SPATIAL_POLYGON_H
+
+#include <string>
+#include <vector>
+
+#include "runtime/spatial-value.h"
+
+namespace impala {
+
+// A polygon given by one or more rings (an outer boundary and holes), for repeated
+// point-in-polygon tests against the same polygon. A point is inside if a ray from it
+// crosses the rings an odd number of times, so holes and overlapping rings follow the
+// even-odd rule. Like RectangleValue::Contains(), the lower and left edges are
+// inclusive and the upper and right edges exclusive.
+//
+// Prepare() builds a slab index: the plane is cut into horizontal slabs at the distinct
+// y coordinates of the vertices, and each slab lists the edges that span it, ordered by
+// x. Edges of a simple polygon don't cross inside a slab, so Contains() finds the slab
+// and the number of edges left of the point with two binary searches, i.e. in
+// O(log #edges) instead of testing every edge.
+class SpatialPolygon {
+ public:
+  SpatialPolygon();
+
+  // Parses the WKT text 'wkt' of 'len' bytes, e.g.
+  // "POLYGON ((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 4 2, 4 4, 2 2))". The keyword is case
+  // insensitive and rings don't need to be closed explicitly. Returns false and sets
+  // 'error' if the text is not a valid polygon.
+  bool ParseWkt(const char* wkt, int len, std::string* error);
+
+  // Builds the slab index. The index is skipped, and Contains() tests every edge, if it
+  // would have more than MAX_SLAB_EDGES entries.
+  void Prepare();
+
+  // Returns true if 'p' lies inside the polygon. NaN coordinates are never inside.
+  bool Contains(const PointValue& p) const;
+
+  const RectangleValue& mbr() const { return mbr_; }
+  int num_edges() const { return edges_.size(); }
+  bool is_prepared() const { return is_prepared_; }
+
+  // Maximum total number of edge entries of all slabs. An edge is listed in every slab
+  // it spans, so the index of a polygon with many long edges can grow quadratically.
+  static const int MAX_SLAB_EDGES = 1024 * 1024;
+
+ private:
+  // A non-horizontal edge, oriented so that y1 < y2.
+  struct Edge {
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+
+    // Returns the x coordinate of the edge at 'y'.
+    double XAt(double y) const { return x1 + (y - y1) * (x2 - x1) / (y2 - y1); }
+  };
+
+  // Orders the edges of a slab by their x coordinate at 'y'.
+  struct EdgeLess;
+
+  // Contains() without the index.
+  bool ContainsBruteForce(const PointValue& p) const;
+
+  std::vector<Edge> edges_;
+  RectangleValue mbr_;
+
+  // Distinct y coordinates of the vertices in ascending order. Slab i is
+  // [slab_ys_[i], slab_ys_[i + 1]).
+  std::vector<double> slab_ys_;
+
+  // The edges spanning slab i, ordered by x, are
+  // slab_edges_[slab_offsets_[i]] to slab_edges_[slab_offsets_[i + 1] - 1].
+  std::vector<int> slab_offsets_;
+  std::vector<int> slab_edges_;
+
+  bool is_prepared_;
+};
+
+}
+
+#endif
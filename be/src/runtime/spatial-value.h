@@ -0,0 +1,157 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_RUNTIME_SPATIAL_VALUE_H
+#define IMPALA_RUNTIME_SPATIAL_VALUE_H
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+#include "udf/udf.h"
+
+namespace impala {
+
+// The format of a POINT-typed slot: two packed doubles (16 bytes).
+struct PointValue {
+  double x;
+  double y;
+
+  PointValue() : x(0), y(0) {}
+  PointValue(double x, double y) : x(x), y(y) {}
+
+  bool operator==(const PointValue& other) const {
+    return x == other.x && y == other.y;
+  }
+  bool operator!=(const PointValue& other) const { return !(*this == other); }
+
+  // Orders points by x and then by y.
+  int Compare(const PointValue& other) const {
+    if (x != other.x) return x < other.x ? -1 : 1;
+    if (y != other.y) return y < other.y ? -1 : 1;
+    return 0;
+  }
+
+  void ToPointVal(impala_udf::PointVal* pv) const {
+    pv->is_null = false;
+    pv->x = x;
+    pv->y = y;
+  }
+
+  static PointValue FromPointVal(const impala_udf::PointVal& pv) {
+    return PointValue(pv.x, pv.y);
+  }
+};
+
+// The format of a RECTANGLE-typed slot: four packed doubles (32 bytes). (x1, y1) is the
+// lower-left and (x2, y2) the upper-right corner.
+struct RectangleValue {
+  double x1;
+  double y1;
+  double x2;
+  double y2;
+
+  RectangleValue() : x1(0), y1(0), x2(0), y2(0) {}
+  RectangleValue(double x1, double y1, double x2, double y2)
+    : x1(x1), y1(y1), x2(x2), y2(y2) {}
+
+  bool operator==(const RectangleValue& other) const {
+    return x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2 == other.y2;
+  }
+  bool operator!=(const RectangleValue& other) const { return !(*this == other); }
+
+  // Orders rectangles lexicographically on (x1, y1, x2, y2). Sorting on x1 first is
+  // what the plane-sweep join kernels expect.
+  int Compare(const RectangleValue& other) const {
+    if (x1 != other.x1) return x1 < other.x1 ? -1 : 1;
+    if (y1 != other.y1) return y1 < other.y1 ? -1 : 1;
+    if (x2 != other.x2) return x2 < other.x2 ? -1 : 1;
+    if (y2 != other.y2) return y2 < other.y2 ? -1 : 1;
+    return 0;
+  }
+
+  // Returns true if the interiors of this and 'other' overlap. Rectangles that only
+  // share an edge do not intersect.
+  bool Intersects(const RectangleValue& other) const {
+    return other.x2 > x1 && x2 > other.x1 && other.y2 > y1 && y2 > other.y1;
+  }
+
+  // Returns true if this and 'other' have at least one point in common, including points
+  // on their edges. Unlike Intersects(), this holds for degenerate rectangles, e.g. the
+  // MBR of a single point, so it is the right test for pruning with MBRs.
+  bool Overlaps(const RectangleValue& other) const {
+    return other.x2 >= x1 && x2 >= other.x1 && other.y2 >= y1 && y2 >= other.y1;
+  }
+
+  // Returns true if 'p' lies inside this rectangle. The lower edges are inclusive and
+  // the upper edges exclusive, so a point on a shared edge belongs to exactly one of two
+  // adjacent rectangles.
+  bool Contains(const PointValue& p) const {
+    return p.x >= x1 && p.x < x2 && p.y >= y1 && p.y < y2;
+  }
+
+  // Returns true if 'other' lies entirely inside this rectangle.
+  bool Contains(const RectangleValue& other) const {
+    return other.x1 >= x1 && other.x2 <= x2 && other.y1 >= y1 && other.y2 <= y2;
+  }
+
+  // Returns the distance from 'p' to the closest point of this rectangle, or 0 if 'p'
+  // lies inside it.
+  double MinDistance(const PointValue& p) const {
+    double dx = std::max(std::max(x1 - p.x, p.x - x2), 0.0);
+    double dy = std::max(std::max(y1 - p.y, p.y - y2), 0.0);
+    return std::sqrt(dx * dx + dy * dy);
+  }
+
+  // Grows this rectangle to cover 'other'.
+  void Expand(const RectangleValue& other) {
+    x1 = std::min(x1, other.x1);
+    y1 = std::min(y1, other.y1);
+    x2 = std::max(x2, other.x2);
+    y2 = std::max(y2, other.y2);
+  }
+
+  void ToRectangleVal(impala_udf::RectangleVal* rv) const {
+    rv->is_null = false;
+    rv->x1 = x1;
+    rv->y1 = y1;
+    rv->x2 = x2;
+    rv->y2 = y2;
+  }
+
+  static RectangleValue FromRectangleVal(const impala_udf::RectangleVal& rv) {
+    return RectangleValue(rv.x1, rv.y1, rv.x2, rv.y2);
+  }
+
+  // Returns the rectangle with the opposite corners (x1, y1) and (x2, y2), which may be
+  // given in any order.
+  static RectangleValue FromCorners(double x1, double y1, double x2, double y2) {
+    return RectangleValue(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2),
+        std::max(y1, y2));
+  }
+};
+
+// Prints as "POINT(x y)" / "RECTANGLE(x1 y1, x2 y2)".
+inline std::ostream& operator<<(std::ostream& os, const PointValue& p) {
+  return os << "POINT(" << p.x << " " << p.y << ")";
+}
+
+inline std::ostream& operator<<(std::ostream& os, const RectangleValue& r) {
+  return os << "RECTANGLE(" << r.x1 << " " << r.y1 << ", " << r.x2 << " " << r.y2 << ")";
+}
+
+}
+
+#endif
@@ -47,7 +47,9 @@ static inline int StringCompare(const char* s1, int n1, const char* s2, int n2,
                                      xmm1, SSEUtil::CHARS_PER_128_BIT_REGISTER,
                                      SSEUtil::STRCMP_MODE);
       if (chars_match != SSEUtil::CHARS_PER_128_BIT_REGISTER) {
-        return s1[chars_match] - s2[chars_match];
+        // Compare the characters as unsigned, like strncmp() below.
+        return static_cast<uint8_t>(s1[chars_match]) -
+            static_cast<uint8_t>(s2[chars_match]);
       }
       len -= SSEUtil::CHARS_PER_128_BIT_REGISTER;
       s1 += SSEUtil::CHARS_PER_128_BIT_REGISTER;
@@ -25,8 +25,11 @@
 #include "util/debug-util.h"
 #include "util/disk-info.h"
 #include "util/filesystem-util.h"
+#include "util/time.h"
 
 DEFINE_string(scratch_dirs, "/tmp", "Writable scratch directories");
+DEFINE_int32(scratch_device_blacklist_timeout_s, 60, "Number of seconds a scratch "
+    "device on which a write failed or that ran out of space is not written to.");
 
 using namespace boost;
 using namespace boost::filesystem;
@@ -38,26 +41,36 @@ namespace impala {
 
 const string TMP_SUB_DIR_NAME = "impala-scratch";
 const uint64_t AVAILABLE_SPACE_THRESHOLD_MB = 1024;
+// Weight of a new measurement in the moving average of a device's write time.
+static const double WRITE_TIME_ALPHA = 0.25;
 bool TmpFileMgr::initialized_;
 vector<string> TmpFileMgr::tmp_dirs_;
+vector<TmpFileMgr::DeviceState> TmpFileMgr::device_states_;
+SpinLock TmpFileMgr::device_states_lock_;
 
 Status TmpFileMgr::Init() {
   DCHECK(!initialized_);
   string tmp_dirs_spec = FLAGS_scratch_dirs;
   vector<string> all_tmp_dirs;
   split(all_tmp_dirs, tmp_dirs_spec, is_any_of(","), token_compress_on);
+  return InitCustom(all_tmp_dirs, true);
+}
+
+Status TmpFileMgr::InitCustom(const vector<string>& tmp_dirs,
+    bool one_dir_per_device) {
+  tmp_dirs_.clear();
   vector<bool> is_tmp_dir_on_disk(DiskInfo::num_disks(), false);
 
   // For each tmp directory, find the disk it is on,
   // so additional tmp directories on the same disk can be skipped.
-  for (int i = 0; i < all_tmp_dirs.size(); ++i) {
-    path tmp_path(trim_right_copy_if(all_tmp_dirs[i], is_any_of("/")));
+  for (int i = 0; i < tmp_dirs.size(); ++i) {
+    path tmp_path(trim_right_copy_if(tmp_dirs[i], is_any_of("/")));
     // tmp_path must be a writable directory.
     RETURN_IF_ERROR(FileSystemUtil::VerifyIsDirectory(tmp_path.string()));
     // Find the disk id of tmp_path. Add the scratch directory if there isn't another
     // directory on the same disk (or if we don't know which disk it is on).
     int disk_id = DiskInfo::disk_id(tmp_path.c_str());
-    if (disk_id < 0 || !is_tmp_dir_on_disk[disk_id]) {
+    if (!one_dir_per_device || disk_id < 0 || !is_tmp_dir_on_disk[disk_id]) {
       uint64_t available_space;
       RETURN_IF_ERROR(FileSystemUtil::GetSpaceAvailable(tmp_path.string(),
           &available_space));
@@ -72,6 +85,7 @@ Status TmpFileMgr::Init() {
     }
   }
   initialized_ = true;
+  device_states_.assign(tmp_dirs_.size(), DeviceState());
   Status status = FileSystemUtil::CreateDirectories(tmp_dirs_);
   if (status.ok()) {
     LOG (INFO) << "Created the following scratch dirs:" << JoinStrings(tmp_dirs_, " ");
@@ -96,30 +110,99 @@ Status TmpFileMgr::GetFile(int tmp_device_id, const TUniqueId& query_id,
   path new_file_path(tmp_dirs_[tmp_device_id]);
   new_file_path /= file_name.str();
 
-  *new_file = new File(new_file_path.string());
+  *new_file = new File(new_file_path.string(), tmp_device_id);
   return Status::OK;
 }
 
-TmpFileMgr::File::File(const string& path)
+void TmpFileMgr::WriteStarted(int tmp_device_id, int64_t len) {
+  DCHECK_LT(tmp_device_id, device_states_.size());
+  ScopedSpinLock l(&device_states_lock_);
+  device_states_[tmp_device_id].queued_bytes += len;
+}
+
+void TmpFileMgr::WriteFinished(int tmp_device_id, int64_t len, int64_t write_time_ns) {
+  DCHECK_LT(tmp_device_id, device_states_.size());
+  ScopedSpinLock l(&device_states_lock_);
+  DeviceState* state = &device_states_[tmp_device_id];
+  state->queued_bytes -= len;
+  DCHECK_GE(state->queued_bytes, 0);
+  if (write_time_ns <= 0 || len <= 0) return;
+  double ns_per_byte = static_cast<double>(write_time_ns) / len;
+  if (state->write_ns_per_byte < 0) {
+    state->write_ns_per_byte = ns_per_byte;
+  } else {
+    state->write_ns_per_byte +=
+        WRITE_TIME_ALPHA * (ns_per_byte - state->write_ns_per_byte);
+  }
+}
+
+double TmpFileMgr::EstimatedWriteTime(int tmp_device_id, int64_t len) {
+  DCHECK_LT(tmp_device_id, device_states_.size());
+  ScopedSpinLock l(&device_states_lock_);
+  double ns_per_byte = device_states_[tmp_device_id].write_ns_per_byte;
+  if (ns_per_byte < 0) {
+    // Assume that a device that has not been written to yet is as fast as the fastest
+    // one that has, so that it is tried.
+    for (int i = 0; i < device_states_.size(); ++i) {
+      double other = device_states_[i].write_ns_per_byte;
+      if (other >= 0 && (ns_per_byte < 0 || other < ns_per_byte)) ns_per_byte = other;
+    }
+    if (ns_per_byte < 0) ns_per_byte = 1;
+  }
+  return (device_states_[tmp_device_id].queued_bytes + len) * ns_per_byte;
+}
+
+void TmpFileMgr::BlacklistDevice(int tmp_device_id, const Status& reason) {
+  DCHECK_LT(tmp_device_id, device_states_.size());
+  LOG(WARNING) << "Blacklisting scratch directory " << tmp_dirs_[tmp_device_id]
+               << " for " << FLAGS_scratch_device_blacklist_timeout_s << "s: "
+               << reason.GetErrorMsg();
+  int64_t until_ms = ms_since_epoch() + FLAGS_scratch_device_blacklist_timeout_s * 1000L;
+  ScopedSpinLock l(&device_states_lock_);
+  device_states_[tmp_device_id].blacklisted_until_ms = until_ms;
+}
+
+bool TmpFileMgr::IsBlacklisted(int tmp_device_id) {
+  DCHECK_LT(tmp_device_id, device_states_.size());
+  int64_t now_ms = ms_since_epoch();
+  ScopedSpinLock l(&device_states_lock_);
+  return device_states_[tmp_device_id].blacklisted_until_ms > now_ms;
+}
+
+TmpFileMgr::File::File(const string& path, int device_id)
   : path_(path),
+    device_id_(device_id),
     current_offset_(0),
-    current_size_(0) {
+    current_size_(0),
+    created_(false) {
+}
+
+Status TmpFileMgr::File::Create() {
+  if (created_) return Status::OK;
+  RETURN_IF_ERROR(FileSystemUtil::CreateFile(path_));
+  disk_id_ = DiskInfo::disk_id(path_.c_str());
+  created_ = true;
+  return Status::OK;
 }
 
 Status TmpFileMgr::File::AllocateSpace(int64_t write_size, int64_t* offset) {
   DCHECK_GT(write_size, 0);
   DCHECK_GE(current_size_, current_offset_);
+  RETURN_IF_ERROR(Create());
   *offset = current_offset_;
 
-  if (current_size_ == 0) {
-    // First call to AllocateSpace. Create the file.
-    RETURN_IF_ERROR(FileSystemUtil::CreateFile(path_));
-    disk_id_ = DiskInfo::disk_id(path_.c_str());
-  }
-
   current_offset_ += write_size;
   if (current_offset_ > current_size_) {
     int64_t trunc_len = current_offset_ + write_size;
+    // Fail rather than let the writes to the grown file fail if the device is full.
+    uint64_t available_space;
+    RETURN_IF_ERROR(FileSystemUtil::GetSpaceAvailable(
+        tmp_dirs_[device_id_], &available_space));
+    if (available_space < trunc_len - current_size_) {
+      current_offset_ -= write_size;
+      return Status(Substitute("Scratch directory $0 has only $1 bytes available",
+          tmp_dirs_[device_id_], available_space));
+    }
     RETURN_IF_ERROR(FileSystemUtil::ResizeFile(path_, trunc_len));
     current_size_ = trunc_len;
   }
@@ -129,7 +212,7 @@ Status TmpFileMgr::File::AllocateSpace(int64_t write_size, int64_t* offset) {
 }
 
 Status TmpFileMgr::File::Remove() {
-  if (current_size_ > 0) FileSystemUtil::RemovePaths(vector<string>(1, path_));
+  if (created_) FileSystemUtil::RemovePaths(vector<string>(1, path_));
   return Status::OK;
 }
 
@@ -17,6 +17,7 @@
 
 #include <common/status.h>
 #include "gen-cpp/Types_types.h"  // for TUniqueId
+#include "util/spinlock.h"
 
 namespace impala {
 
@@ -25,6 +26,12 @@ namespace impala {
 //
 // TmpFileMgr::GetFile() is used to return a TmpFileMgr::File handle with a unique
 // filename on a specified temp file device - the client owns the handle.
+//
+// TmpFileMgr also keeps the load and health of each device, which are shared by all
+// queries spilling to it: the bytes queued to be written to the device, a moving average
+// of the time the device takes to write a byte, and whether the device is blacklisted
+// because a write to it failed or it ran out of space. Blacklisted devices are retried
+// after --scratch_device_blacklist_timeout_s.
 class TmpFileMgr {
  public:
   // TmpFileMgr::File is a handle to a physical file in a temporary directory. Clients
@@ -32,9 +39,13 @@ class TmpFileMgr {
   // Creation of the file is deferred until the first call to AllocateSpace().
   class File {
    public:
+    // Creates the physical file, if it was not created yet. disk_id() is valid after
+    // the file is created.
+    Status Create();
+
     // Allocates 'write_size' bytes in this file for a new block of data.
     // The file size is increased by a call to truncate() if necessary.
-    // The physical file is created on the first call to AllocateSpace().
+    // The physical file is created on the first call to Create() or AllocateSpace().
     Status AllocateSpace(int64_t write_size, int64_t* offset);
 
     // Delete the physical file on disk, if one was created.
@@ -43,6 +54,7 @@ class TmpFileMgr {
 
     const std::string& path() const { return path_; }
     int disk_id() const { return disk_id_; }
+    int device_id() const { return device_id_; }
 
    private:
     friend class TmpFileMgr;
@@ -55,11 +67,14 @@ class TmpFileMgr {
     // directory. A warning is issued if available space is less than this threshold.
     const static uint64_t AVAILABLE_SPACE_THRESHOLD_MB;
 
-    File(const std::string& path);
+    File(const std::string& path, int device_id);
 
     // Path of the physical file in the filesystem.
     std::string path_;
 
+    // The tmp device the file is on.
+    int device_id_;
+
     // The id of the disk on which the physical file lies.
     int disk_id_;
 
@@ -69,12 +84,22 @@ class TmpFileMgr {
     // Current file size. Modified by AllocateSpace(). Is always >= current offset.
     // Size is 0 before the file is created.
     int64_t current_size_;
+
+    // True once the physical file was created.
+    bool created_;
   };
 
   // Creates the tmp directories configured by CM. If multiple directories are specified
   // per disk, only one is created and used. Must be called after DiskInfo::Init().
   static Status Init();
 
+  // Same as Init() for the directories 'tmp_dirs'. If 'one_dir_per_device' is false,
+  // all of them are used, even those on the same disk. Tests may call this again to
+  // replace the directories and reset the state of the devices, when no files are in
+  // use.
+  static Status InitCustom(const std::vector<std::string>& tmp_dirs,
+      bool one_dir_per_device);
+
   // Return a new File handle with a unique path for a fragment instance. The file path
   // is within the (single) tmp directory on the specified device id. The caller owns
   // the returned handle and is responsible for deleting it. The file is not created -
@@ -86,11 +111,48 @@ class TmpFileMgr {
   // of tmp directories created.
   static int num_tmp_devices() { return tmp_dirs_.size(); }
 
+  // Records that a write of 'len' bytes to the device was queued.
+  static void WriteStarted(int tmp_device_id, int64_t len);
+
+  // Records that a write of 'len' bytes to the device finished. 'write_time_ns' is the
+  // time the device took to write it, or 0 if the write did not succeed.
+  static void WriteFinished(int tmp_device_id, int64_t len, int64_t write_time_ns);
+
+  // Returns the estimated time in ns until a write of 'len' bytes queued to the device
+  // now would finish, based on the bytes already queued to it.
+  static double EstimatedWriteTime(int tmp_device_id, int64_t len);
+
+  // Stops placing new data on the device for --scratch_device_blacklist_timeout_s.
+  // 'reason' is logged.
+  static void BlacklistDevice(int tmp_device_id, const Status& reason);
+
+  // Returns true if the device is blacklisted.
+  static bool IsBlacklisted(int tmp_device_id);
+
  private:
+  struct DeviceState {
+    // Bytes of the writes queued to the device that have not finished yet.
+    int64_t queued_bytes;
+
+    // Moving average of the time to write a byte; -1 if no write has finished yet.
+    double write_ns_per_byte;
+
+    // Time in ms since the epoch until which the device is blacklisted.
+    int64_t blacklisted_until_ms;
+
+    DeviceState() : queued_bytes(0), write_ns_per_byte(-1), blacklisted_until_ms(0) { }
+  };
+
   static bool initialized_;
 
   // The created tmp directories, atmost one per device.
   static std::vector<std::string> tmp_dirs_;
+
+  // The state of each device, indexed like tmp_dirs_.
+  static std::vector<DeviceState> device_states_;
+
+  // Protects device_states_.
+  static SpinLock device_states_lock_;
 };
 
 }
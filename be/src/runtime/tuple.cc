@@ -16,15 +16,19 @@
 
 #include <vector>
 
+#include "codegen/codegen-anyval.h"
+#include "codegen/llvm-codegen.h"
 #include "exprs/expr.h"
 #include "exprs/expr-context.h"
 #include "runtime/descriptors.h"
 #include "runtime/mem-pool.h"
 #include "runtime/raw-value.h"
+#include "runtime/runtime-state.h"
 #include "runtime/tuple-row.h"
 #include "runtime/string-value.h"
 #include "util/debug-util.h"
 
+using namespace llvm;
 using namespace std;
 
 namespace impala {
@@ -118,4 +122,118 @@ template void Tuple::MaterializeExprs<false>(TupleRow* row, const TupleDescripto
 template void Tuple::MaterializeExprs<true>(TupleRow* row, const TupleDescriptor& desc,
     const vector<ExprContext*>& materialize_expr_ctxs, MemPool* pool,
     vector<StringValue*>* non_null_var_values, int* total_var_len);
+
+// Slots are addressed by their byte offsets in the tuple, so the IR doesn't depend on
+// the llvm struct of the tuple. For a nullable int slot at offset 4, the IR is:
+// define void @MaterializeExprs(i8* %tuple, %"class.impala::TupleRow"* %row) {
+// entry:
+//   %null_byte_ptr = getelementptr i8* %tuple, i32 0
+//   store i8 0, i8* %null_byte_ptr
+//   %value = call i64 @GetSlotRef(%"class.impala::ExprContext"* inttoptr
+//       (i64 140226381340800 to %"class.impala::ExprContext"*), ... %row)
+//   ...
+//   br i1 %is_null, label %null, label %not_null
+// null:
+//   %null_byte = load i8* %null_byte_ptr
+//   %null_bit_set = or i8 %null_byte, 1
+//   store i8 %null_bit_set, i8* %null_byte_ptr
+//   br label %continue
+// not_null:
+//   %slot = getelementptr i8* %tuple, i32 4
+//   %slot_ptr = bitcast i8* %slot to i32*
+//   store i32 %val, i32* %slot_ptr
+//   br label %continue
+// continue:
+//   ret void
+// }
+Function* Tuple::CodegenMaterializeExprs(RuntimeState* state,
+    const TupleDescriptor& desc, const vector<ExprContext*>& materialize_expr_ctxs) {
+  LlvmCodeGen* codegen;
+  if (!state->GetCodegen(&codegen).ok()) return NULL;
+  for (int i = 0; i < desc.slots().size(); ++i) {
+    SlotDescriptor* slot_desc = desc.slots()[i];
+    if (!slot_desc->is_materialized()) continue;
+    switch (slot_desc->type().type) {
+      case TYPE_BOOLEAN:
+      case TYPE_TINYINT:
+      case TYPE_SMALLINT:
+      case TYPE_INT:
+      case TYPE_BIGINT:
+      case TYPE_FLOAT:
+      case TYPE_DOUBLE:
+      case TYPE_DECIMAL:
+      case TYPE_STRING:
+      case TYPE_VARCHAR:
+      case TYPE_TIMESTAMP:
+        break;
+      default:
+        return NULL;
+    }
+  }
+
+  LlvmCodeGen::FnPrototype prototype(codegen, "MaterializeExprs", codegen->void_type());
+  prototype.AddArgument(LlvmCodeGen::NamedVariable("tuple", codegen->ptr_type()));
+  prototype.AddArgument(LlvmCodeGen::NamedVariable(
+      "row", codegen->GetPtrType(TupleRow::LLVM_CLASS_NAME)));
+
+  LLVMContext& context = codegen->context();
+  LlvmCodeGen::LlvmBuilder builder(context);
+  Value* args[2];
+  Function* fn = prototype.GeneratePrototype(&builder, args);
+  Value* tuple = args[0];
+  Value* row = args[1];
+
+  Value* zero_byte = ConstantInt::get(codegen->GetType(TYPE_TINYINT), 0);
+  for (int i = 0; i < desc.num_null_bytes(); ++i) {
+    builder.CreateStore(zero_byte, builder.CreateConstGEP1_32(tuple, i, "null_byte_ptr"));
+  }
+
+  int mat_expr_index = 0;
+  for (int i = 0; i < desc.slots().size(); ++i) {
+    SlotDescriptor* slot_desc = desc.slots()[i];
+    if (!slot_desc->is_materialized()) continue;
+    ExprContext* ctx = materialize_expr_ctxs[mat_expr_index++];
+    DCHECK(slot_desc->type() == ctx->root()->type());
+    Function* expr_fn;
+    Status status = ctx->root()->GetCodegendComputeFn(state, &expr_fn);
+    if (!status.ok()) {
+      VLOG_QUERY << "Could not codegen MaterializeExprs: " << status.GetErrorMsg();
+      return NULL;
+    }
+    Value* ctx_arg = codegen->CastPtrToLlvmPtr(
+        codegen->GetPtrType(ExprContext::LLVM_CLASS_NAME), ctx);
+    Value* expr_fn_args[] = { ctx_arg, row };
+    CodegenAnyVal value = CodegenAnyVal::CreateCallWrapped(codegen, &builder,
+        slot_desc->type(), expr_fn, expr_fn_args, "value");
+
+    BasicBlock* null_block = BasicBlock::Create(context, "null", fn);
+    BasicBlock* not_null_block = BasicBlock::Create(context, "not_null", fn);
+    BasicBlock* continue_block = BasicBlock::Create(context, "continue", fn);
+    builder.CreateCondBr(value.GetIsNull(), null_block, not_null_block);
+
+    builder.SetInsertPoint(null_block);
+    const NullIndicatorOffset& null_offset = slot_desc->null_indicator_offset();
+    if (null_offset.bit_mask != 0) {
+      Value* null_byte_ptr =
+          builder.CreateConstGEP1_32(tuple, null_offset.byte_offset, "null_byte_ptr");
+      Value* null_byte = builder.CreateLoad(null_byte_ptr, "null_byte");
+      builder.CreateStore(builder.CreateOr(null_byte,
+          ConstantInt::get(codegen->GetType(TYPE_TINYINT), null_offset.bit_mask),
+          "null_bit_set"), null_byte_ptr);
+    }
+    builder.CreateBr(continue_block);
+
+    builder.SetInsertPoint(not_null_block);
+    Value* slot = builder.CreateConstGEP1_32(tuple, slot_desc->tuple_offset(), "slot");
+    value.ToNativePtr(builder.CreateBitCast(
+        slot, codegen->GetPtrType(slot_desc->type()), "slot_ptr"));
+    builder.CreateBr(continue_block);
+
+    builder.SetInsertPoint(continue_block);
+  }
+  DCHECK_EQ(mat_expr_index, materialize_expr_ctxs.size());
+  builder.CreateRetVoid();
+
+  return codegen->FinalizeFunction(fn);
+}
 }
@@ -22,8 +22,13 @@
 #include "runtime/descriptors.h"
 #include "runtime/mem-pool.h"
 
+namespace llvm {
+  class Function;
+}
+
 namespace impala {
 
+class RuntimeState;
 struct StringValue;
 class TupleDescriptor;
 class TupleRow;
@@ -96,6 +101,16 @@ class Tuple {
       std::vector<StringValue*>* non_null_var_len_values = NULL,
       int* total_var_len = NULL);
 
+  // Signature of the function generated by CodegenMaterializeExprs().
+  typedef void (*MaterializeExprsFn)(Tuple* tuple, TupleRow* row);
+
+  // Codegens MaterializeExprs() for a tuple of 'desc' and the exprs of
+  // 'materialize_expr_ctxs', with a NULL pool: string slots point to the data returned
+  // by the exprs. Returns NULL if some slot type is not supported.
+  static llvm::Function* CodegenMaterializeExprs(RuntimeState* state,
+      const TupleDescriptor& desc,
+      const std::vector<ExprContext*>& materialize_expr_ctxs);
+
   // Turn null indicator bit on. For non-nullable slots, the mask will be 0 and
   // this is a no-op (but we don't have to branch to check is slots are nulalble).
   void SetNull(const NullIndicatorOffset& offset) {
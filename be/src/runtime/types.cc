@@ -40,6 +40,8 @@ PrimitiveType ThriftToType(TPrimitiveType::type ttype) {
     case TPrimitiveType::BINARY: return TYPE_BINARY;
     case TPrimitiveType::DECIMAL: return TYPE_DECIMAL;
     case TPrimitiveType::CHAR: return TYPE_CHAR;
+    case TPrimitiveType::POINT: return TYPE_POINT;
+    case TPrimitiveType::RECTANGLE: return TYPE_RECTANGLE;
     default: return INVALID_TYPE;
   }
 }
@@ -63,6 +65,8 @@ TPrimitiveType::type ToThrift(PrimitiveType ptype) {
     case TYPE_BINARY: return TPrimitiveType::BINARY;
     case TYPE_DECIMAL: return TPrimitiveType::DECIMAL;
     case TYPE_CHAR: return TPrimitiveType::CHAR;
+    case TYPE_POINT: return TPrimitiveType::POINT;
+    case TYPE_RECTANGLE: return TPrimitiveType::RECTANGLE;
     default: return TPrimitiveType::INVALID_TYPE;
   }
 }
@@ -86,6 +90,8 @@ string TypeToString(PrimitiveType t) {
     case TYPE_BINARY: return "BINARY";
     case TYPE_DECIMAL: return "DECIMAL";
     case TYPE_CHAR: return "CHAR";
+    case TYPE_POINT: return "POINT";
+    case TYPE_RECTANGLE: return "RECTANGLE";
   };
   return "";
 }
@@ -110,6 +116,8 @@ string TypeToOdbcString(PrimitiveType t) {
     case TYPE_BINARY: return "binary";
     case TYPE_DECIMAL: return "decimal";
     case TYPE_CHAR: return "char";
+    case TYPE_POINT: return "point";
+    case TYPE_RECTANGLE: return "rectangle";
   };
   return "unknown";
 }
@@ -133,6 +141,9 @@ TTypeId::type TypeToHiveServer2Type(PrimitiveType t) {
     case TYPE_DECIMAL: return TTypeId::DECIMAL_TYPE;
     // TODO: update when hs2 has char(n)
     case TYPE_CHAR: return TTypeId::STRING_TYPE;
+    // Spatial values are returned to clients in their text form.
+    case TYPE_POINT: return TTypeId::STRING_TYPE;
+    case TYPE_RECTANGLE: return TTypeId::STRING_TYPE;
     default:
       // HiveServer2 does not have a type for invalid, date and datetime.
       DCHECK(false) << "bad TypeToTValueType() type: " << TypeToString(t);
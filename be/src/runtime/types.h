@@ -45,7 +45,11 @@ enum PrimitiveType {
   // parsed from scan nodes. It can be returned from exprs and must be consumable
   // by exprs.
   TYPE_CHAR,
-  TYPE_VARCHAR
+  TYPE_VARCHAR,
+
+  // Fixed-width spatial types, stored as packed doubles (see runtime/spatial-value.h).
+  TYPE_POINT,
+  TYPE_RECTANGLE
 };
 
 PrimitiveType ThriftToType(TPrimitiveType::type ttype);
@@ -164,6 +168,10 @@ struct ColumnType {
     return type == TYPE_STRING || type == TYPE_VARCHAR || type == TYPE_CHAR;
   }
 
+  inline bool IsSpatialType() const {
+    return type == TYPE_POINT || type == TYPE_RECTANGLE;
+  }
+
   inline bool IsVarLen() const {
     return type == TYPE_STRING || type == TYPE_VARCHAR ||
         (type == TYPE_CHAR && len > MAX_CHAR_INLINE_LENGTH);
@@ -195,6 +203,10 @@ struct ColumnType {
         return 16;
       case TYPE_DECIMAL:
         return GetDecimalByteSize(precision);
+      case TYPE_POINT:
+        return 16;
+      case TYPE_RECTANGLE:
+        return 32;
       case TYPE_DATE:
       case INVALID_TYPE:
       default:
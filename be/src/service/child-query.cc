@@ -147,6 +147,7 @@ void ChildQuery::SetQueryOptions(const TQueryOptions& parent_options,
   SET_QUERY_OPTION(max_block_mgr_memory, MAX_BLOCK_MGR_MEMORY);
   SET_QUERY_OPTION(appx_count_distinct, APPX_COUNT_DISTINCT);
   SET_QUERY_OPTION(disable_unsafe_spills, DISABLE_UNSAFE_SPILLS);
+  SET_QUERY_OPTION(hash_table_open_addressing, HASH_TABLE_OPEN_ADDRESSING);
 }
 
 void ChildQuery::Cancel() {
@@ -50,6 +50,13 @@ void ImpalaServer::FragmentExecState::Exec() {
   executor_.Close();
 }
 
+Status ImpalaServer::FragmentExecState::PublishFilter(SlotId slot,
+    const TBloomFilter& filter) {
+  RuntimeState* runtime_state = executor_.runtime_state();
+  DCHECK(runtime_state != NULL);
+  return runtime_state->PublishBloomFilter(slot, filter);
+}
+
 // There can only be one of these callbacks in-flight at any moment, because
 // it is only invoked from the executor's reporting thread.
 // Also, the reported status will always reflect the most recent execution status,
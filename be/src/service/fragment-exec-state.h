@@ -51,6 +51,10 @@ class ImpalaServer::FragmentExecState {
   // Main loop of plan fragment execution. Blocks until execution finishes.
   void Exec();
 
+  // Adds the runtime filter 'filter' on 'slot', published by the coordinator, to the
+  // fragment's runtime state. Returns an error if 'filter' is malformed.
+  Status PublishFilter(SlotId slot, const TBloomFilter& filter);
+
   const TUniqueId& query_id() const {
     return fragment_instance_ctx_.query_ctx.query_id;
   }
@@ -77,6 +77,8 @@ void impala::TColumnValueToHS2TColumn(const TColumnValue& col_val,
     case TPrimitiveType::CHAR:
     case TPrimitiveType::VARCHAR:
     case TPrimitiveType::DECIMAL:
+    case TPrimitiveType::POINT:
+    case TPrimitiveType::RECTANGLE:
       is_null = !col_val.__isset.string_val;
       column->stringVal.values.push_back(col_val.string_val);
       nulls = &column->stringVal.nulls;
@@ -138,6 +140,15 @@ void impala::ExprValueToHS2TColumn(const void* value, const TColumnType& type,
       }
       nulls = &column->stringVal.nulls;
       break;
+    case TPrimitiveType::POINT:
+    case TPrimitiveType::RECTANGLE:
+      column->stringVal.values.push_back("");
+      if (value != NULL) {
+        RawValue::PrintValue(value, ThriftToType(type.types[0].scalar_type.type), -1,
+            &(column->stringVal.values.back()));
+      }
+      nulls = &column->stringVal.nulls;
+      break;
     case TPrimitiveType::NULL_TYPE:
     case TPrimitiveType::STRING:
     case TPrimitiveType::VARCHAR:
@@ -236,6 +247,8 @@ void impala::TColumnValueToHS2TColumnValue(const TColumnValue& col_val,
     case TPrimitiveType::TIMESTAMP:
     case TPrimitiveType::VARCHAR:
     case TPrimitiveType::CHAR:
+    case TPrimitiveType::POINT:
+    case TPrimitiveType::RECTANGLE:
       // HiveServer2 requires timestamp to be presented as string. Note that the .thrift
       // spec says it should be a BIGINT; AFAICT Hive ignores that and produces a string.
       hs2_col_val->__isset.stringVal = true;
@@ -329,6 +342,16 @@ void impala::ExprValueToHS2TColumnValue(const void* value, const TColumnType& ty
         RawValue::PrintValue(value, TYPE_TIMESTAMP, -1, &(hs2_col_val->stringVal.value));
       }
       break;
+    case TPrimitiveType::POINT:
+    case TPrimitiveType::RECTANGLE:
+      // Spatial values are presented in their text form.
+      hs2_col_val->__isset.stringVal = true;
+      hs2_col_val->stringVal.__isset.value = not_null;
+      if (not_null) {
+        RawValue::PrintValue(value, ThriftToType(type.types[0].scalar_type.type), -1,
+            &(hs2_col_val->stringVal.value));
+      }
+      break;
     case TPrimitiveType::DECIMAL: {
       // HiveServer2 requires decimal to be presented as string.
       hs2_col_val->__isset.stringVal = true;
@@ -1019,6 +1019,10 @@ Status ImpalaServer::SetQueryOptions(const string& key, const string& value,
             iequals(value, "true") || iequals(value, "1"));
         break;
       }
+      case TImpalaQueryOptions::HASH_TABLE_OPEN_ADDRESSING:
+        query_options->__set_hash_table_open_addressing(
+            iequals(value, "true") || iequals(value, "1"));
+        break;
       default:
         // We hit this DCHECK(false) if we forgot to add the corresponding entry here
         // when we add a new query option.
@@ -1106,10 +1110,12 @@ void ImpalaServer::TransmitData(
   // TODO: fix Thrift so we can simply take ownership of thrift_batch instead
   // of having to copy its data
   if (params.row_batch.num_rows > 0) {
+    int64_t wait_time_ns;
     Status status = exec_env_->stream_mgr()->AddData(
         params.dest_fragment_instance_id, params.dest_node_id, params.row_batch,
-        params.sender_id);
+        params.sender_id, &wait_time_ns);
     status.SetTStatus(&return_val);
+    return_val.__set_receiver_wait_time_ns(wait_time_ns);
     if (!status.ok()) {
       // should we close the channel here as well?
       return;
@@ -1123,6 +1129,40 @@ void ImpalaServer::TransmitData(
   }
 }
 
+void ImpalaServer::UpdateFilter(
+    TUpdateFilterResult& return_val, const TUpdateFilterParams& params) {
+  VLOG_QUERY << "UpdateFilter(): query_id=" << params.query_id
+             << " node_id=" << params.node_id << " slot_id=" << params.slot_id;
+  shared_ptr<QueryExecState> exec_state = GetQueryExecState(params.query_id, false);
+  // As for ReportExecStatus(), the query may have been closed or cancelled in the
+  // meantime. The filter is simply dropped then.
+  if (exec_state.get() == NULL || exec_state->coord() == NULL) {
+    stringstream str;
+    str << "unknown query id: " << params.query_id;
+    Status status(TStatusCode::INTERNAL_ERROR, str.str());
+    status.SetTStatus(&return_val);
+    return;
+  }
+  exec_state->coord()->UpdateFilter(params).SetTStatus(&return_val);
+}
+
+void ImpalaServer::PublishFilter(
+    TPublishFilterResult& return_val, const TPublishFilterParams& params) {
+  VLOG_QUERY << "PublishFilter(): instance_id=" << params.dest_fragment_instance_id
+             << " slot_id=" << params.slot_id;
+  shared_ptr<FragmentExecState> exec_state =
+      GetFragmentExecState(params.dest_fragment_instance_id);
+  if (exec_state.get() == NULL) {
+    // The fragment instance may have finished before the filter arrived.
+    stringstream str;
+    str << "unknown fragment id: " << params.dest_fragment_instance_id;
+    Status status(TStatusCode::INTERNAL_ERROR, str.str());
+    status.SetTStatus(&return_val);
+    return;
+  }
+  exec_state->PublishFilter(params.slot_id, params.bloom_filter).SetTStatus(&return_val);
+}
+
 Status ImpalaServer::StartPlanFragmentExecution(
     const TExecPlanFragmentParams& exec_params) {
   if (!exec_params.fragment.__isset.output_sink) {
@@ -1313,6 +1353,9 @@ void ImpalaServer::TQueryOptionsToMap(const TQueryOptions& query_option,
       case TImpalaQueryOptions::DISABLE_UNSAFE_SPILLS:
         val << query_option.disable_unsafe_spills;
         break;
+      case TImpalaQueryOptions::HASH_TABLE_OPEN_ADDRESSING:
+        val << query_option.hash_table_open_addressing;
+        break;
       default:
         // We hit this DCHECK(false) if we forgot to add the corresponding entry here
         // when we add a new query option.
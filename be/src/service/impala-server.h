@@ -63,6 +63,10 @@ class TCancelPlanFragmentArgs;
 class TCancelPlanFragmentResult;
 class TTransmitDataArgs;
 class TTransmitDataResult;
+class TUpdateFilterParams;
+class TUpdateFilterResult;
+class TPublishFilterParams;
+class TPublishFilterResult;
 class TNetworkAddress;
 class TClientRequest;
 class TExecRequest;
@@ -216,6 +220,10 @@ class ImpalaServer : public ImpalaServiceIf, public ImpalaHiveServer2ServiceIf,
       TCancelPlanFragmentResult& return_val, const TCancelPlanFragmentParams& params);
   virtual void TransmitData(
       TTransmitDataResult& return_val, const TTransmitDataParams& params);
+  virtual void UpdateFilter(
+      TUpdateFilterResult& return_val, const TUpdateFilterParams& params);
+  virtual void PublishFilter(
+      TPublishFilterResult& return_val, const TPublishFilterParams& params);
 
   // Generates a unique id for this query and sets it in the given query context.
   // Prepares the given query context by populating fields required for evaluating
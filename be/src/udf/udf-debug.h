@@ -37,6 +37,22 @@ inline std::string DebugString(const StringVal& val) {
   return std::string(reinterpret_cast<const char*>(val.ptr), val.len);
 }
 
+template<>
+inline std::string DebugString(const PointVal& val) {
+  if (val.is_null) return "NULL";
+  std::stringstream ss;
+  ss << "POINT(" << val.x << " " << val.y << ")";
+  return ss.str();
+}
+
+template<>
+inline std::string DebugString(const RectangleVal& val) {
+  if (val.is_null) return "NULL";
+  std::stringstream ss;
+  ss << "RECTANGLE(" << val.x1 << " " << val.y1 << ", " << val.x2 << " " << val.y2 << ")";
+  return ss.str();
+}
+
 }
 
 #endif
@@ -39,6 +39,8 @@ struct IntVal;
 struct BigIntVal;
 struct StringVal;
 struct TimestampVal;
+struct PointVal;
+struct RectangleVal;
 
 // A FunctionContext is passed to every UDF/UDA and is the interface for the UDF to the
 // rest of the system. It contains APIs to examine the system state, report errors and
@@ -64,7 +66,9 @@ class FunctionContext {
     TYPE_STRING,
     TYPE_FIXED_BUFFER,
     TYPE_DECIMAL,
-    TYPE_VARCHAR
+    TYPE_VARCHAR,
+    TYPE_POINT,
+    TYPE_RECTANGLE
   };
 
   struct TypeDesc {
@@ -600,6 +604,52 @@ struct DecimalVal : public impala_udf::AnyVal {
   }
 };
 
+// A 2D point. Stored in tuples as two packed doubles (16 bytes).
+struct PointVal : public AnyVal {
+  double x;
+  double y;
+
+  PointVal(double x = 0, double y = 0) : x(x), y(y) { }
+
+  static PointVal null() {
+    PointVal result;
+    result.is_null = true;
+    return result;
+  }
+
+  bool operator==(const PointVal& other) const {
+    if (is_null && other.is_null) return true;
+    if (is_null || other.is_null) return false;
+    return x == other.x && y == other.y;
+  }
+  bool operator!=(const PointVal& other) const { return !(*this == other); }
+};
+
+// An axis-aligned rectangle given by its lower-left (x1, y1) and upper-right (x2, y2)
+// corners. Stored in tuples as four packed doubles (32 bytes).
+struct RectangleVal : public AnyVal {
+  double x1;
+  double y1;
+  double x2;
+  double y2;
+
+  RectangleVal(double x1 = 0, double y1 = 0, double x2 = 0, double y2 = 0)
+    : x1(x1), y1(y1), x2(x2), y2(y2) { }
+
+  static RectangleVal null() {
+    RectangleVal result;
+    result.is_null = true;
+    return result;
+  }
+
+  bool operator==(const RectangleVal& other) const {
+    if (is_null && other.is_null) return true;
+    if (is_null || other.is_null) return false;
+    return x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2 == other.y2;
+  }
+  bool operator!=(const RectangleVal& other) const { return !(*this == other); }
+};
+
 typedef uint8_t* BufferVal;
 
 }
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <iostream>
+#include <sstream>
 
 #include <udf/uda-test-harness.h>
 #include "uda-sample.h"
@@ -88,11 +89,43 @@ bool TestStringConcat() {
   return true;
 }
 
+bool TestOverlapped() {
+  UdaTestHarness2<StringVal, StringVal, RectangleVal, IntVal> test(
+      OverlappedInit, OverlappedUpdate, OverlappedMerge, OverlappedSerialize,
+      OverlappedFinalize);
+
+  // A 10x10 grid of unit squares in set 1 and the same grid shifted by half a unit in
+  // set 2. Each shifted square overlaps the (up to) 4 squares around it.
+  vector<RectangleVal> rects;
+  vector<IntVal> table_ids;
+  int expected = 0;
+  for (int x = 0; x < 10; ++x) {
+    for (int y = 0; y < 10; ++y) {
+      rects.push_back(RectangleVal(x, y, x + 1, y + 1));
+      table_ids.push_back(IntVal(1));
+      rects.push_back(RectangleVal(x + 0.5, y + 0.5, x + 1.5, y + 1.5));
+      table_ids.push_back(IntVal(2));
+      expected += (x < 9 ? 2 : 1) * (y < 9 ? 2 : 1);
+    }
+  }
+  rects.push_back(RectangleVal::null());
+  table_ids.push_back(IntVal(1));
+
+  stringstream expected_str;
+  expected_str << expected;
+  if (!test.Execute(rects, table_ids, StringVal(expected_str.str().c_str()))) {
+    cerr << test.GetErrorMsg() << endl;
+    return false;
+  }
+  return true;
+}
+
 int main(int argc, char** argv) {
   bool passed = true;
   passed &= TestCount();
   passed &= TestAvg();
   passed &= TestStringConcat();
+  passed &= TestOverlapped();
   cerr << (passed ? "Tests passed." : "Tests failed.") << endl;
   return 0;
 }
@@ -14,14 +14,14 @@
 
 #include "uda-sample.h"
 #include <assert.h>
+#include <algorithm>
 #include <string>
 #include <stdio.h>
 #include <cstring>
 #include <iostream>
 #include <sstream>
-#include <iomanip>
-#include <fstream>
 #include <stdlib.h>
+#include <vector>
 
 using namespace impala_udf;
 using namespace std;
@@ -145,274 +145,161 @@ void SumSmallDecimalMerge(FunctionContext*, const DecimalVal& src, DecimalVal* d
 //Overlap aggregate function
 //-------------------------------------------------------------------------
 
-struct Rect{  
-  
+// One input shape of the join. Records are stored packed in the intermediate StringVal,
+// so no text encoding or parsing is needed between Update(), Merge() and Finalize().
+struct Rect {
   double x1;
-  double y1; 
-  double x2; 
+  double y1;
+  double x2;
   double y2;
+  int32_t table_id;
+};
 
-    Rect (double x1, double y1, double x2, double y2) {
-      this->x1 = x1;
-      this->y1 = y1;
-      this->x2 = x2;
-      this->y2 = y2;
-    }
+// Header of the intermediate StringVal. 'len' of the StringVal is the allocated capacity
+// in bytes; the header records how many Rect records follow it.
+struct OverlappedState {
+  int64_t num_records;
+
+  Rect* records() { return reinterpret_cast<Rect*>(this + 1); }
+  const Rect* records() const { return reinterpret_cast<const Rect*>(this + 1); }
 };
 
-typedef Rect* RectPtr;
+const static int INITIAL_RECORD_CAPACITY = 1024;
 
-int compareFunc (const void * val1, const void * val2)
-{
-  Rect* rect1 = * (Rect **) val1;
-  Rect* rect2 = * (Rect **) val2; 
-  
-    return ( rect1->x1 - rect2->x1 );
+static int Capacity(const StringVal& val) {
+  return (val.len - sizeof(OverlappedState)) / sizeof(Rect);
 }
 
-bool isIntersected(Rect* r, Rect* s){
-  return (s->x2 > r->x1 
-    && r->x2 > s->x1 
-    && s->y2 > r->y1 
-    && r->y2 > s->y1);
+static int StateLen(int64_t num_records) {
+  return sizeof(OverlappedState) + num_records * sizeof(Rect);
 }
 
-void OverlappedInit(FunctionContext* context, StringVal* val1) {
-  val1->is_null = true;
+// Makes sure 'val' has room for 'num_new_records' more records, doubling the buffer
+// as needed so that appending is amortized O(1). The buffer is allocated with
+// FunctionContext::Allocate(), so it lives until Serialize() or Finalize() frees it.
+static void EnsureCapacity(FunctionContext* context, int num_new_records,
+    StringVal* val) {
+  if (val->is_null) {
+    int len = StateLen(max(INITIAL_RECORD_CAPACITY, num_new_records));
+    *val = StringVal(context->Allocate(len), len);
+    reinterpret_cast<OverlappedState*>(val->ptr)->num_records = 0;
+    return;
+  }
+  const OverlappedState* state = reinterpret_cast<const OverlappedState*>(val->ptr);
+  int64_t needed = state->num_records + num_new_records;
+  if (needed <= Capacity(*val)) return;
+  int len = StateLen(max<int64_t>(needed, 2 * Capacity(*val)));
+  // Reallocate() keeps the records and frees the old buffer.
+  val->ptr = context->Reallocate(val->ptr, len);
+  val->len = len;
+}
 
-  ofstream myfile;
-  myfile.open ("./spatialJoin.out");
-  myfile << "\nStarting collecting ....\n\n ";
-  myfile.close();
+bool compareFunc(const Rect* r, const Rect* s) {
+  return r->x1 < s->x1;
+}
 
+bool isIntersected(const Rect* r, const Rect* s){
+  return (s->x2 > r->x1
+    && r->x2 > s->x1
+    && s->y2 > r->y1
+    && r->y2 > s->y1);
 }
 
-const static char defaultHeader[] = "0000000011#";
-const static int headerSize = strlen(defaultHeader);
+void OverlappedInit(FunctionContext* context, StringVal* val1) {
+  val1->is_null = true;
+}
 
 void OverlappedUpdate(FunctionContext* context, const RectangleVal& arg1,
     const IntVal& arg3, StringVal* val) {
-   
   if (arg1.is_null) return;
-  
-  stringstream recordStream;
-  string record;
-  
-  recordStream << setprecision(15);
-  recordStream << arg1.x1 <<",";
-  recordStream << arg1.y1 <<",";
-  recordStream << arg1.x2 <<",";
-  recordStream << arg1.y2;
-  
-  recordStream<<","<<arg3.val<<"/"; 
-
-  record = recordStream.str();
-
-  int MEMORY_ALLOCATED_RECORDS = 500000;
-
-  int recordSize = record.size();
-  
-  if (val->is_null) {
-    val->is_null = false;
-    *val = StringVal(context, recordSize * MEMORY_ALLOCATED_RECORDS);     
-    strcpy((char*)val->ptr, defaultHeader);       
-  } //else {
-    /*int valLen = strlen((char*)val->ptr);
-
-    if( (valLen/recordSize) % 10000 == 0 ){
-      ofstream myfile;
-      myfile.open ("./spatialJoin.out");
-      myfile << "Records Received " << (valLen/recordSize) ;
-      myfile.close();
-    }
-
-    if ((valLen + recordSize) > val->len) {
-      int new_len = val->len + recordSize * MEMORY_ALLOCATED_RECORDS;
-      StringVal new_val(context, new_len);
-      strcat((char*)new_val.ptr, (char*)val->ptr);
-      strcat((char*)new_val.ptr, (char*)record.c_str());
-      
-      //delete[] val->ptr;
-      *val = new_val;
-    }
-    else {*/
-  
-  int lengthFieldSize = headerSize - 1;
-
-  char totalLength_str[lengthFieldSize+1];
-  
-  memcpy(totalLength_str, (char*) val->ptr, sizeof(char) * lengthFieldSize);
-
-  int totalLength = atoi(totalLength_str);
-
-  strcat((char*)(val->ptr + totalLength), (char*)record.c_str());
-
-  totalLength += recordSize;
-  
-  stringstream temp;
-  temp << totalLength;
-  const char* newLength_str = temp.str().c_str();
-
-  int totalLength_str_len = strlen(newLength_str);
-
-  memcpy((char*)(val->ptr + (lengthFieldSize - totalLength_str_len)), newLength_str, totalLength_str_len);
-
-  if( (((totalLength-headerSize))/recordSize) % 10000 == 0 ){ 
-      ofstream myfile;
-      myfile.open ("./spatialJoin.out");
-      myfile << "Records Received " << ((totalLength-headerSize)/recordSize) << "\n";
-      myfile.close();
-  }
-
-  //printf("State : %s\n", val->ptr ); 
-  //printf("New Record : %s\n", record.c_str());
-  //printf("Record size : %d\n", recordSize ); 
-  //printf("Records received : %d\n", ((totalLength-headerSize)/recordSize) ); 
+  EnsureCapacity(context, 1, val);
+
+  OverlappedState* state = reinterpret_cast<OverlappedState*>(val->ptr);
+  Rect* rect = state->records() + state->num_records++;
+  rect->x1 = arg1.x1;
+  rect->y1 = arg1.y1;
+  rect->x2 = arg1.x2;
+  rect->y2 = arg1.y2;
+  rect->table_id = arg3.val;
 }
 
 void OverlappedMerge(FunctionContext* context, const StringVal& src, StringVal* dst) {
   if (src.is_null) return;
-  if (dst == NULL || dst->is_null) {
-    StringVal new_val(context, strlen((char*)src.ptr) + 1);
-    new_val.ptr[0] = '\0';
-    strcat((char*)new_val.ptr, (char*)src.ptr);
-    *dst = new_val;
-    return;
-  }
-  int new_len = strlen((char*)src.ptr) + strlen((char*)dst->ptr);
-  
-  StringVal new_val(context, new_len + 1);
-  new_val.ptr[0] = '\0';
-  
-  if(*(src.ptr + headerSize - 1) == '#')
-    strcat((char*)new_val.ptr, (char*)(src.ptr + headerSize));
-  else
-    strcat((char*)new_val.ptr, (char*)src.ptr );
-  
-  if(*(dst->ptr + headerSize - 1) == '#')
-    strcat((char*)new_val.ptr, (char*)(dst->ptr + headerSize));
-  else
-    strcat((char*)new_val.ptr, (char*)dst->ptr );
-
-  //delete[] dst->ptr;
-  *dst = new_val;
+  const OverlappedState* src_state = reinterpret_cast<const OverlappedState*>(src.ptr);
+  if (src_state->num_records == 0) return;
+  EnsureCapacity(context, src_state->num_records, dst);
+
+  OverlappedState* dst_state = reinterpret_cast<OverlappedState*>(dst->ptr);
+  memcpy(dst_state->records() + dst_state->num_records, src_state->records(),
+      src_state->num_records * sizeof(Rect));
+  dst_state->num_records += src_state->num_records;
 }
 
-StringVal OverlappedFinalize(FunctionContext* context, const StringVal& val) {      
-  
-  char* records_str = (char*)val.ptr;
-
-  double x1, y1, x2, y2;
-  char* restOfRecords= NULL;
-  char* colContext= NULL;
-  int tableID;
-  
-  ofstream myfile;
-  myfile.open ("./spatialJoin.out");
-  myfile << "\nParsing ....\n\n ";
-
-  int records_str_len = strlen((char*)records_str);
-
-  char *record;
-  char *field;
-  int count = 0;
-
-  Rect **list1 = NULL, **list2 = NULL;
-  int list1Size = 0, list2Size = 0;
-
-  try{
-  
-    while ((record = strtok_r(records_str, "/", &restOfRecords)) != NULL) {
-
-    
-      if(list1 == NULL) list1 = new RectPtr[records_str_len / (strlen(record)+1)];
-      if(list2 == NULL) list2 = new RectPtr[records_str_len / (strlen(record)+1)];
-
-
-      
-      x1 = atof(strtok_r(record, ",", &colContext));     
-      y1 = atof(strtok_r(NULL, ",", &colContext));      
-      x2 = atof(strtok_r(NULL, ",", &colContext));      
-      y2 = atof(strtok_r(NULL, ",", &colContext));      
-      tableID = atoi(strtok_r(NULL, ",", &colContext));
-
-      //printf("%f, %f, %f, %f, %d\n",x1,y1,x2,y2,tableID);     
+const StringVal OverlappedSerialize(FunctionContext* context, const StringVal& val) {
+  if (val.is_null) return val;
+  // Copy the records into a buffer that Impala owns and free the intermediate one.
+  const OverlappedState* state = reinterpret_cast<const OverlappedState*>(val.ptr);
+  StringVal result(context, StateLen(state->num_records));
+  memcpy(result.ptr, val.ptr, result.len);
+  context->Free(val.ptr);
+  return result;
+}
 
-      Rect *rect = new Rect(x1, y1, x2, y2);      
+StringVal OverlappedFinalize(FunctionContext* context, const StringVal& val) {
+  int64_t count = 0;
 
-      if (tableID == 1) {               
-          list1[list1Size++] = rect;
-      } else if (tableID == 2) {                
-          list2[list2Size++] = rect;
-      }           
-      
-      records_str = restOfRecords;       
-    
+  if (!val.is_null) {
+    const OverlappedState* state = reinterpret_cast<const OverlappedState*>(val.ptr);
+    const Rect* records = state->records();
 
+    vector<const Rect*> list1, list2;
+    for (int64_t i = 0; i < state->num_records; ++i) {
+      if (records[i].table_id == 1) {
+        list1.push_back(&records[i]);
+      } else if (records[i].table_id == 2) {
+        list2.push_back(&records[i]);
+      }
     }
 
-    qsort(list1, list1Size, sizeof(list1[0]), compareFunc);
-    qsort(list2, list2Size, sizeof(list2[0]), compareFunc);
-
-    myfile << "\nSpatial Joining ....\n\n"; 
-    myfile << "List 1 of size : " << list1Size << "\n";
-    myfile << "List 2 of size : " << list2Size << "\n";
+    sort(list1.begin(), list1.end(), compareFunc);
+    sort(list2.begin(), list2.end(), compareFunc);
 
-    Rect** R = list1;
-    Rect** S = list2;
+    const vector<const Rect*>& R = list1;
+    const vector<const Rect*>& S = list2;
 
-    int R_length = list1Size;
-    int S_length = list2Size;
+    int R_length = R.size();
+    int S_length = S.size();
 
     int i = 0, j = 0;
-    while (i < list1Size && j < list2Size) {
-      Rect* r;
-      Rect* s;
-      if (compareFunc(&R[i], &S[j]) < 0) {
+    while (i < R_length && j < S_length) {
+      const Rect* r;
+      const Rect* s;
+      if (compareFunc(R[i], S[j])) {
         r = R[i];
         int jj = j;
 
         while ((jj < S_length) && ((s = S[jj])->x1 <= r->x2)) {
-          if (isIntersected(r, s)) count++;         
+          if (isIntersected(r, s)) count++;
           jj++;
         }
-        i++;        
+        i++;
       } else {
         s = S[j];
         int ii = i;
 
         while ((ii < R_length) && ((r = R[ii])->x1 <= s->x2)) {
           if (isIntersected(r,s)) count++;
-          ii++;         
+          ii++;
         }
         j++;
-      }   
-
-      if(i % 1000 == 0) 
-        myfile << "List 1 : Processed " << i << " of " << list1Size << " Shapes\n";
-       
+      }
     }
-
-    myfile << "\nFinished processing, Count : " << count << "\n";
-
-    for(int i=0; i < list1Size; i++) delete list1[i];
-    for(int i=0; i < list2Size; i++) delete list2[i];
-
-    delete list1;
-    delete list2;
-  
-  }
-  catch (int e)
-  {
-    myfile << "An exception occurred. Exception Nr. " << e << '\n';
+    context->Free(val.ptr);
   }
 
   stringstream countstr;
   countstr << count;
   StringVal intersectedRect = StringVal(context, countstr.str().size());
   memcpy(intersectedRect.ptr, countstr.str().c_str(), countstr.str().size());
-
-  myfile.close();
-
   return intersectedRect;
 }
@@ -43,4 +43,14 @@ void StringConcatUpdate(FunctionContext* context, const StringVal& arg1,
 void StringConcatMerge(FunctionContext* context, const StringVal& src, StringVal* dst);
 StringVal StringConcatFinalize(FunctionContext* context, const StringVal& val);
 
+// Counts the intersecting pairs between two sets of rectangles, using a plane sweep in
+// Finalize(). The second argument is the id (1 or 2) of the set the rectangle belongs
+// to. The intermediate StringVal holds the packed rectangles.
+void OverlappedInit(FunctionContext* context, StringVal* val);
+void OverlappedUpdate(FunctionContext* context, const RectangleVal& rect,
+    const IntVal& table_id, StringVal* val);
+void OverlappedMerge(FunctionContext* context, const StringVal& src, StringVal* dst);
+const StringVal OverlappedSerialize(FunctionContext* context, const StringVal& val);
+StringVal OverlappedFinalize(FunctionContext* context, const StringVal& val);
+
 #endif
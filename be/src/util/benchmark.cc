@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -47,7 +48,7 @@ double Benchmark::Measure(BenchmarkFunction function, void* args,
     // in 20% increments.
     // TODO: we can make this more sophisticated if need to be dynamically ramp up and
     // ramp down the sizes.
-    batch_size = (iters_guess - iters) / 5;
+    batch_size = max<int64_t>((iters_guess - iters) / 5, 1);
   }
 
   while (sw.ElapsedTime() < target_cycles) {
@@ -61,7 +62,10 @@ double Benchmark::Measure(BenchmarkFunction function, void* args,
   return iters / ms_elapsed;
 }
 
-Benchmark::Benchmark(const string& name) : name_(name) {
+Benchmark::Benchmark(const string& name, int initial_batch_size)
+  : name_(name),
+    initial_batch_size_(initial_batch_size) {
+  DCHECK_GT(initial_batch_size, 0);
 #ifndef NDEBUG
   LOG(ERROR) << "WARNING: Running benchmark in DEBUG mode.";
 #endif
@@ -84,11 +88,12 @@ string Benchmark::Measure() {
   if (benchmarks_.empty()) return "";
 
   // Run a warmup to iterate through the data
-  benchmarks_[0].fn(10, benchmarks_[0].args);
+  benchmarks_[0].fn(min(10, initial_batch_size_), benchmarks_[0].args);
 
   stringstream ss;
   for (int i = 0; i < benchmarks_.size(); ++i) {
-    benchmarks_[i].rate = Measure(benchmarks_[i].fn, benchmarks_[i].args);
+    benchmarks_[i].rate = Measure(benchmarks_[i].fn, benchmarks_[i].args, 1000,
+        initial_batch_size_);
   }
 
   int function_out_width = 30;
@@ -31,7 +31,10 @@ namespace impala {
 class Benchmark {
  public:
   // Name of the microbenchmark.  This is outputted in the result.  
-  Benchmark(const std::string& name);
+  // initial_batch_size is the number of iterations the benchmarks are first run for
+  // (see Measure() below).  Use a small value for benchmarks where a single iteration
+  // takes a long time, e.g. a join over millions of rows.
+  Benchmark(const std::string& name, int initial_batch_size = 1000);
 
   // Function to benchmark.  The function should run iters time (to minimize function
   // call overhead).  The second argument is opaque and is whatever data the test 
@@ -73,6 +76,7 @@ class Benchmark {
   };
 
   std::string name_;
+  int initial_batch_size_;
   std::vector<BenchmarkResult> benchmarks_;
 };
   
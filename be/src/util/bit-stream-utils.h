@@ -119,6 +119,10 @@ class BitReader {
   // beginning of a byte. Return false if there were not enough bytes in the buffer.
   bool GetVlqInt(int32_t* v);
 
+  // Skips 'num_values' values of 'num_bits' bits. Returns false if there are not enough
+  // bytes left.
+  bool SkipValues(int num_bits, int num_values);
+
   // Returns the number of bytes left in the stream, not including the current byte (i.e.,
   // there may be an additional fraction of a byte).
   int bytes_left() { return max_bytes_ - (byte_offset_ + BitUtil::Ceil(bit_offset_, 8)); }
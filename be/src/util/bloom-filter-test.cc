@@ -0,0 +1,107 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+#include "util/bloom-filter.h"
+
+#include "gen-cpp/ImpalaInternalService_types.h"
+
+using namespace std;
+
+namespace impala {
+
+static uint32_t MakeHash(int i) {
+  return i * 2654435761U + 12345;
+}
+
+TEST(BloomFilterTest, NoFalseNegatives) {
+  for (int log_num_buckets = 0; log_num_buckets < 12; ++log_num_buckets) {
+    BloomFilter filter(log_num_buckets);
+    for (int i = 0; i < 10000; ++i) filter.Insert(MakeHash(i));
+    for (int i = 0; i < 10000; ++i) EXPECT_TRUE(filter.Find(MakeHash(i)));
+  }
+}
+
+TEST(BloomFilterTest, FalsePositiveProb) {
+  const int ndv = 100000;
+  for (double fpp = 0.01; fpp < 0.5; fpp *= 2) {
+    int log_num_buckets = BloomFilter::MinLogNumBuckets(ndv, fpp);
+    EXPECT_LE(BloomFilter::FalsePositiveProb(ndv, log_num_buckets), fpp);
+    EXPECT_GT(BloomFilter::FalsePositiveProb(ndv, log_num_buckets - 1), fpp);
+
+    BloomFilter filter(log_num_buckets);
+    for (int i = 0; i < ndv; ++i) filter.Insert(MakeHash(i));
+    int num_false_positives = 0;
+    for (int i = ndv; i < 2 * ndv; ++i) num_false_positives += filter.Find(MakeHash(i));
+    // Allow for the variance of the number of values per bucket.
+    EXPECT_LE(num_false_positives, 1.5 * fpp * ndv) << fpp;
+  }
+  EXPECT_EQ(BloomFilter::MinLogNumBuckets(0, 0.1), 0);
+  EXPECT_EQ(BloomFilter::BytesForLogNumBuckets(10), 32 * 1024);
+}
+
+TEST(BloomFilterTest, OrAndThrift) {
+  BloomFilter a(8);
+  BloomFilter b(8);
+  for (int i = 0; i < 1000; ++i) {
+    a.Insert(MakeHash(i));
+    b.Insert(MakeHash(i + 1000));
+  }
+  TBloomFilter thrift;
+  b.ToThrift(&thrift);
+  EXPECT_EQ(thrift.directory.size(), b.size_in_bytes());
+  EXPECT_TRUE(BloomFilter::ValidateThrift(thrift).ok());
+  BloomFilter c(thrift);
+  EXPECT_EQ(c.log_num_buckets(), 8);
+  c.Or(a);
+  for (int i = 0; i < 2000; ++i) EXPECT_TRUE(c.Find(MakeHash(i)));
+
+  // Larger filters are folded onto smaller ones.
+  BloomFilter small(5);
+  small.Or(c);
+  for (int i = 0; i < 2000; ++i) EXPECT_TRUE(small.Find(MakeHash(i)));
+}
+
+TEST(BloomFilterTest, ValidateThrift) {
+  TBloomFilter thrift;
+  BloomFilter(4).ToThrift(&thrift);
+  EXPECT_TRUE(BloomFilter::ValidateThrift(thrift).ok());
+
+  TBloomFilter bad = thrift;
+  bad.log_num_buckets = -1;
+  EXPECT_FALSE(BloomFilter::ValidateThrift(bad).ok());
+  bad.log_num_buckets = 32;
+  EXPECT_FALSE(BloomFilter::ValidateThrift(bad).ok());
+  bad.log_num_buckets = 1000;
+  EXPECT_FALSE(BloomFilter::ValidateThrift(bad).ok());
+
+  // The directory doesn't match log_num_buckets.
+  bad = thrift;
+  bad.log_num_buckets = 5;
+  EXPECT_FALSE(BloomFilter::ValidateThrift(bad).ok());
+  bad = thrift;
+  bad.directory.resize(thrift.directory.size() - 1);
+  EXPECT_FALSE(BloomFilter::ValidateThrift(bad).ok());
+  bad.directory.clear();
+  EXPECT_FALSE(BloomFilter::ValidateThrift(bad).ok());
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/bloom-filter.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <sstream>
+
+#include "gen-cpp/ImpalaInternalService_types.h"
+
+using namespace impala;
+using namespace std;
+
+const uint32_t BloomFilter::SALT[BUCKET_WORDS] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+BloomFilter::BloomFilter(int log_num_buckets)
+  : log_num_buckets_(log_num_buckets),
+    directory_mask_((1U << log_num_buckets) - 1) {
+  DCHECK_GE(log_num_buckets, 0);
+  DCHECK_LE(log_num_buckets, MAX_LOG_NUM_BUCKETS);
+  directory_.resize(1LL << log_num_buckets);
+  memset(&directory_[0], 0, size_in_bytes());
+}
+
+BloomFilter::BloomFilter(const TBloomFilter& thrift)
+  : log_num_buckets_(thrift.log_num_buckets),
+    directory_mask_((1U << thrift.log_num_buckets) - 1) {
+  DCHECK(ValidateThrift(thrift).ok());
+  directory_.resize(1LL << log_num_buckets_);
+  memcpy(&directory_[0], thrift.directory.data(), size_in_bytes());
+}
+
+Status BloomFilter::ValidateThrift(const TBloomFilter& thrift) {
+  if (thrift.log_num_buckets < 0 || thrift.log_num_buckets > MAX_LOG_NUM_BUCKETS) {
+    stringstream ss;
+    ss << "Invalid runtime filter: log_num_buckets=" << thrift.log_num_buckets;
+    return Status(ss.str());
+  }
+  if (static_cast<int64_t>(thrift.directory.size()) !=
+      BytesForLogNumBuckets(thrift.log_num_buckets)) {
+    stringstream ss;
+    ss << "Invalid runtime filter: directory of " << thrift.directory.size()
+       << " bytes for log_num_buckets=" << thrift.log_num_buckets;
+    return Status(ss.str());
+  }
+  return Status::OK;
+}
+
+int BloomFilter::MinLogNumBuckets(int64_t ndv, double fpp) {
+  // The probability that a given bit of a word is set after inserting 'ndv' values is
+  // 1 - exp(-ndv / (32 * num_buckets)), and a false positive needs all 8 bits probed
+  // by Find() to be set.
+  double num_bits = -BUCKET_WORDS * ndv / log(1 - pow(fpp, 1.0 / BUCKET_WORDS));
+  double num_buckets = max(1.0, num_bits / (8 * sizeof(Bucket)));
+  return static_cast<int>(ceil(log(num_buckets) / log(2.0)));
+}
+
+double BloomFilter::FalsePositiveProb(int64_t ndv, int log_num_buckets) {
+  double num_bits = (8 * sizeof(Bucket)) * static_cast<double>(1LL << log_num_buckets);
+  return pow(1 - exp(-BUCKET_WORDS * ndv / num_bits), BUCKET_WORDS);
+}
+
+void BloomFilter::Or(const BloomFilter& other) {
+  DCHECK_GE(other.log_num_buckets_, log_num_buckets_);
+  for (int64_t i = 0; i < other.directory_.size(); ++i) {
+    Bucket* bucket = &directory_[i & directory_mask_];
+    for (int j = 0; j < BUCKET_WORDS; ++j) {
+      bucket->words[j] |= other.directory_[i].words[j];
+    }
+  }
+}
+
+void BloomFilter::ToThrift(TBloomFilter* thrift) const {
+  thrift->log_num_buckets = log_num_buckets_;
+  thrift->directory.assign(
+      reinterpret_cast<const char*>(&directory_[0]), size_in_bytes());
+}
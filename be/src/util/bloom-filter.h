@@ -0,0 +1,117 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_UTIL_BLOOM_FILTER_H
+#define IMPALA_UTIL_BLOOM_FILTER_H
+
+#include <vector>
+
+#include "common/logging.h"
+#include "common/status.h"
+
+namespace impala {
+
+class TBloomFilter;
+
+// A blocked Bloom filter over 32-bit hash values. The filter is an array of 2^n
+// buckets of 256 bits, each the size of half a cache line. A value sets one bit in
+// each of the 8 words of a single bucket, so Insert() and Find() touch one cache line
+// however many bits are set. This costs a slightly higher false positive probability
+// than a standard Bloom filter of the same size.
+// Filters can be combined with Or(), e.g. to merge the filters built by the instances
+// of a partitioned join. A larger filter is folded onto a smaller one: buckets are
+// picked by the low bits of a rehash, so bucket i of a filter with 2^m buckets maps to
+// bucket i mod 2^n of one with 2^n buckets.
+class BloomFilter {
+ public:
+  // Creates an empty filter with 2^log_num_buckets buckets.
+  explicit BloomFilter(int log_num_buckets);
+
+  // Creates a filter from its serialized form, see ToThrift(). 'thrift' must have
+  // passed ValidateThrift().
+  explicit BloomFilter(const TBloomFilter& thrift);
+
+  // Returns an error if 'thrift', received from another process, is not the serialized
+  // form of a filter.
+  static Status ValidateThrift(const TBloomFilter& thrift);
+
+  // Returns the log2 of the smallest number of buckets for which a filter holding 'ndv'
+  // distinct values has a false positive probability of at most 'fpp'.
+  static int MinLogNumBuckets(int64_t ndv, double fpp);
+
+  // Returns the expected false positive probability of a filter with 2^log_num_buckets
+  // buckets holding 'ndv' distinct values.
+  static double FalsePositiveProb(int64_t ndv, int log_num_buckets);
+
+  // Returns the size in bytes of a filter with 2^log_num_buckets buckets.
+  static int64_t BytesForLogNumBuckets(int log_num_buckets) {
+    return sizeof(Bucket) << log_num_buckets;
+  }
+
+  void Insert(uint32_t hash) {
+    Bucket* bucket = &directory_[BucketIdx(hash)];
+    for (int i = 0; i < BUCKET_WORDS; ++i) {
+      bucket->words[i] |= 1U << ((hash * SALT[i]) >> 27);
+    }
+  }
+
+  // Returns false if no value with 'hash' was inserted. May return true even if none
+  // was.
+  bool Find(uint32_t hash) const {
+    const Bucket& bucket = directory_[BucketIdx(hash)];
+    for (int i = 0; i < BUCKET_WORDS; ++i) {
+      if ((bucket.words[i] & (1U << ((hash * SALT[i]) >> 27))) == 0) return false;
+    }
+    return true;
+  }
+
+  // Adds the values of 'other', which must not be smaller, to this filter.
+  void Or(const BloomFilter& other);
+
+  void ToThrift(TBloomFilter* thrift) const;
+
+  int log_num_buckets() const { return log_num_buckets_; }
+  int64_t size_in_bytes() const { return BytesForLogNumBuckets(log_num_buckets_); }
+
+ private:
+  static const int BUCKET_WORDS = 8;
+
+  // The directory mask is a uint32_t, so there can be at most 2^31 buckets.
+  static const int MAX_LOG_NUM_BUCKETS = 31;
+
+  struct Bucket {
+    uint32_t words[BUCKET_WORDS];
+  };
+
+  // Odd multipliers that pick the bit set in each word of a bucket from the top 5 bits
+  // of hash * SALT[i].
+  static const uint32_t SALT[BUCKET_WORDS];
+
+  // The bucket is chosen by the high bits of a 64-bit multiplicative rehash, which are
+  // independent of the bits picked within it. Callers often hash with the same function
+  // that partitioned the rows between fragment instances, so the low bits of 'hash' can
+  // be all alike within an instance.
+  uint32_t BucketIdx(uint32_t hash) const {
+    return ((hash * 0x9E3779B97F4A7C15ULL) >> 32) & directory_mask_;
+  }
+
+  int log_num_buckets_;
+  uint32_t directory_mask_;
+  std::vector<Bucket> directory_;
+};
+
+}
+
+#endif
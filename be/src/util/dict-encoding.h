@@ -152,6 +152,9 @@ class DictDecoderBase {
 
   virtual int num_entries() const = 0;
 
+  // Skips the next 'num_values' values. Returns false if there are fewer left.
+  bool SkipValues(int num_values) { return data_decoder_->Skip(num_values); }
+
  protected:
   boost::scoped_ptr<RleDecoder> data_decoder_;
 };
@@ -174,6 +177,21 @@ class DictDecoder : public DictDecoderBase {
   // the string data is from the dictionary buffer passed into the c'tor.
   bool GetValue(T* value);
 
+  // Returns the index into the dictionary of the next value. Returns false if the data
+  // is invalid.
+  bool GetIndex(int* index) {
+    DCHECK(data_decoder_.get() != NULL);
+    if (!data_decoder_->Get(index)) return false;
+    return *index < dict_.size();
+  }
+
+  // Returns the dictionary entry at 'index'. The entry is copied with memcpy() so
+  // 'value' does not need to be aligned (see IMPALA-959).
+  void GetEntry(int index, T* value) const {
+    DCHECK_LT(index, dict_.size());
+    memcpy(value, &dict_[index], sizeof(T));
+  }
+
  private:
   std::vector<T> dict_;
 };
@@ -58,6 +58,21 @@ void ValidateDict(const vector<T>& values, int fixed_buffer_byte_size) {
     decoder.GetValue(&j);
     EXPECT_EQ(i, j);
   }
+
+  // Decode again by dictionary index, skipping every other value.
+  decoder.SetData(data_buffer, data_len);
+  for (int i = 0; i < values.size(); ++i) {
+    if (i % 2 == 1) {
+      EXPECT_TRUE(decoder.SkipValues(1));
+      continue;
+    }
+    int index;
+    EXPECT_TRUE(decoder.GetIndex(&index));
+    EXPECT_LT(index, decoder.num_entries());
+    T j;
+    decoder.GetEntry(index, &j);
+    EXPECT_EQ(values[i], j);
+  }
   pool.FreeAll();
 }
 
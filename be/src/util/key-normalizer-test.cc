@@ -0,0 +1,331 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <gtest/gtest.h>
+
+#include "common/init.h"
+#include "common/object-pool.h"
+#include "exprs/expr-context.h"
+#include "exprs/slot-ref.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
+#include "runtime/string-value.inline.h"
+#include "runtime/timestamp-value.h"
+#include "runtime/tuple-row.h"
+#include "testutil/desc-tbl-builder.h"
+#include "util/key-normalizer.inline.h"
+#include "util/test-info.h"
+#include "util/tuple-row-compare.h"
+
+using namespace boost;
+using namespace impala;
+using namespace std;
+
+namespace impala {
+
+static const int NUM_ROWS = 300;
+
+// The sorter's normalized key length.
+static const int KEY_LEN = 24;
+
+// The slots of the test tuple.
+enum {
+  BOOLEAN_SLOT, TINYINT_SLOT, INT_SLOT, BIGINT_SLOT, FLOAT_SLOT, DOUBLE_SLOT,
+  STRING_SLOT, TIMESTAMP_SLOT, BIGINT2_SLOT
+};
+
+// Prefixes of the random strings. The long one fills the normalized key by itself, so
+// strings that only differ after it have equal normalized keys.
+static const char* PREFIXES[] = { "", "ab", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" };
+
+// Characters of the random suffixes, including ones that are negative as a char and
+// embedded nulls.
+static const char SUFFIX_CHARS[] = { 'a', 'b', '\0', '\x01', '\x7f', '\x80', '\xff' };
+
+// Orders row indexes on their normalized keys like the sorter does: on memcmp(), and
+// rows with equal keys on the comparator, unless the keys are complete.
+struct NormalizedLess {
+  const vector<vector<uint8_t> >* keys;
+  const vector<TupleRow*>* rows;
+  const TupleRowComparator* comparator;
+  bool is_complete;
+
+  bool operator()(int lhs, int rhs) const {
+    int result = memcmp(&(*keys)[lhs][0], &(*keys)[rhs][0], KEY_LEN);
+    if (result != 0) return result < 0;
+    if (is_complete) return false;
+    return comparator->Compare((*rows)[lhs], (*rows)[rhs]) < 0;
+  }
+};
+
+// Orders row indexes with the comparator.
+struct ComparatorLess {
+  const vector<TupleRow*>* rows;
+  const TupleRowComparator* comparator;
+
+  bool operator()(int lhs, int rhs) const {
+    return comparator->Compare((*rows)[lhs], (*rows)[rhs]) < 0;
+  }
+};
+
+// Tests that the normalized keys that KeyNormalizer::Create() sets up for the sorter
+// order random rows like TupleRowComparator does.
+class KeyNormalizerTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    srand(0);
+    state_.reset(new RuntimeState(TPlanFragmentInstanceCtx(), "", NULL));
+    DescriptorTblBuilder builder(&pool_);
+    builder.DeclareTuple() << TYPE_BOOLEAN << TYPE_TINYINT << TYPE_INT << TYPE_BIGINT
+        << TYPE_FLOAT << TYPE_DOUBLE << TYPE_STRING << TYPE_TIMESTAMP << TYPE_BIGINT;
+    DescriptorTbl* desc_tbl = builder.Build();
+    state_->set_desc_tbl(desc_tbl);
+    TupleDescriptor* tuple_desc = desc_tbl->GetTupleDescriptor(0);
+    slots_ = tuple_desc->slots();
+    row_desc_.reset(new RowDescriptor(tuple_desc, false));
+
+    batch_.reset(new RowBatch(*row_desc_, NUM_ROWS, &tracker_));
+    for (int row = 0; row < NUM_ROWS; ++row) {
+      Tuple* tuple = Tuple::Create(tuple_desc->byte_size(), batch_->tuple_data_pool());
+      for (int i = 0; i < slots_.size(); ++i) SetSlot(tuple, slots_[i]);
+      int idx = batch_->AddRow();
+      batch_->GetRow(idx)->SetTuple(0, tuple);
+      batch_->CommitLastRow();
+      rows_.push_back(batch_->GetRow(idx));
+    }
+  }
+
+  virtual void TearDown() {
+    for (int i = 0; i < ctxs_.size(); ++i) ctxs_[i]->Close(state_.get());
+    batch_.reset();
+    state_.reset();
+  }
+
+  // Returns one of the 'n' values in 'values' at random.
+  template <typename T>
+  static T Choose(const T* values, int n) { return values[rand() % n]; }
+
+  // Sets the slot to a random value from a small domain, so that rows have ties, or
+  // to NULL in some rows.
+  void SetSlot(Tuple* tuple, const SlotDescriptor* slot) {
+    if (rand() % 8 == 0) {
+      tuple->SetNull(slot->null_indicator_offset());
+      return;
+    }
+    void* dst = tuple->GetSlot(slot->tuple_offset());
+    switch (slot->type().type) {
+      case TYPE_BOOLEAN: *reinterpret_cast<bool*>(dst) = rand() % 2 == 0; break;
+      case TYPE_TINYINT: {
+        int8_t values[] = { -128, -1, 0, 1, 127 };
+        *reinterpret_cast<int8_t*>(dst) = Choose(values, 5);
+        break;
+      }
+      case TYPE_INT: {
+        int32_t values[] = { numeric_limits<int32_t>::min(), -256, -1, 0, 1, 256,
+            numeric_limits<int32_t>::max() };
+        *reinterpret_cast<int32_t*>(dst) = Choose(values, 7);
+        break;
+      }
+      case TYPE_BIGINT: {
+        int64_t values[] = { numeric_limits<int64_t>::min(), -(1LL << 40), -1, 0, 1,
+            1LL << 40, numeric_limits<int64_t>::max() };
+        *reinterpret_cast<int64_t*>(dst) = Choose(values, 7);
+        break;
+      }
+      case TYPE_FLOAT: {
+        float values[] = { -numeric_limits<float>::infinity(), -1.5f, -0.0f, 0.0f,
+            numeric_limits<float>::denorm_min(), 1.5f,
+            numeric_limits<float>::infinity(), numeric_limits<float>::quiet_NaN() };
+        *reinterpret_cast<float*>(dst) = Choose(values, 8);
+        break;
+      }
+      case TYPE_DOUBLE: {
+        double values[] = { -numeric_limits<double>::infinity(), -1e300, -0.0, 0.0,
+            numeric_limits<double>::denorm_min(), 1e300,
+            numeric_limits<double>::infinity(), numeric_limits<double>::quiet_NaN() };
+        *reinterpret_cast<double*>(dst) = Choose(values, 8);
+        break;
+      }
+      case TYPE_STRING: {
+        string s = Choose(PREFIXES, 3);
+        int suffix_len = rand() % 20;
+        for (int i = 0; i < suffix_len; ++i) {
+          s += Choose(SUFFIX_CHARS, sizeof(SUFFIX_CHARS));
+        }
+        char* ptr =
+            reinterpret_cast<char*>(batch_->tuple_data_pool()->Allocate(s.size()));
+        memcpy(ptr, s.data(), s.size());
+        *reinterpret_cast<StringValue*>(dst) = StringValue(ptr, s.size());
+        break;
+      }
+      case TYPE_TIMESTAMP:
+        *reinterpret_cast<TimestampValue*>(dst) = TimestampValue(
+            static_cast<int64_t>(1000000000 + rand() % 4 * 3600),
+            static_cast<int64_t>(0));
+        break;
+      default:
+        DCHECK(false) << slot->type();
+    }
+  }
+
+  // Returns a prepared and opened slot ref on each of 'slot_idxs'.
+  vector<ExprContext*> CreateKeyExprs(const vector<int>& slot_idxs) {
+    vector<ExprContext*> ctxs;
+    for (int i = 0; i < slot_idxs.size(); ++i) {
+      ctxs.push_back(
+          pool_.Add(new ExprContext(pool_.Add(new SlotRef(slots_[slot_idxs[i]])))));
+    }
+    Status status = Expr::Prepare(ctxs, state_.get(), *row_desc_, &tracker_);
+    DCHECK(status.ok()) << status.GetErrorMsg();
+    status = Expr::Open(ctxs, state_.get());
+    DCHECK(status.ok()) << status.GetErrorMsg();
+    ctxs_.insert(ctxs_.end(), ctxs.begin(), ctxs.end());
+    return ctxs;
+  }
+
+  // Sorts the rows on the keys 'slot_idxs', each in a random order, and checks that the
+  // normalized keys order each pair of rows like the comparator, and sort the rows like
+  // the comparator. 'expect_normalizer' and 'expect_complete' are the expected
+  // normalizer and completeness for the keys.
+  void CheckKeys(const vector<int>& slot_idxs, bool expect_normalizer,
+      bool expect_complete) {
+    vector<bool> is_asc;
+    vector<bool> nulls_first;
+    for (int i = 0; i < slot_idxs.size(); ++i) {
+      is_asc.push_back(rand() % 2 == 0);
+      nulls_first.push_back(rand() % 2 == 0);
+    }
+    TupleRowComparator comparator(CreateKeyExprs(slot_idxs), CreateKeyExprs(slot_idxs),
+        is_asc, nulls_first);
+    bool is_complete;
+    scoped_ptr<KeyNormalizer> normalizer(
+        KeyNormalizer::Create(comparator, KEY_LEN, &is_complete));
+    ASSERT_EQ(expect_normalizer, normalizer.get() != NULL);
+    EXPECT_EQ(expect_complete, is_complete);
+    if (normalizer.get() == NULL) return;
+
+    vector<vector<uint8_t> > keys(NUM_ROWS, vector<uint8_t>(KEY_LEN));
+    for (int i = 0; i < NUM_ROWS; ++i) normalizer->NormalizeKey(rows_[i], &keys[i][0]);
+
+    // Differing normalized keys order the rows like the comparator, except that they
+    // may order rows that compare equal. Equal complete keys mean equal rows.
+    for (int i = 0; i < NUM_ROWS; ++i) {
+      for (int j = 0; j < NUM_ROWS; ++j) {
+        int normalized = Sign(memcmp(&keys[i][0], &keys[j][0], KEY_LEN));
+        int expected = Sign(comparator.Compare(rows_[i], rows_[j]));
+        if (normalized != 0) {
+          EXPECT_NE(-normalized, expected) << "rows " << i << ", " << j;
+        } else if (is_complete) {
+          EXPECT_EQ(0, expected) << "rows " << i << ", " << j;
+        }
+      }
+    }
+
+    vector<int> expected_order;
+    for (int i = 0; i < NUM_ROWS; ++i) expected_order.push_back(i);
+    vector<int> actual_order = expected_order;
+    ComparatorLess comparator_less = { &rows_, &comparator };
+    stable_sort(expected_order.begin(), expected_order.end(), comparator_less);
+    NormalizedLess normalized_less = { &keys, &rows_, &comparator, is_complete };
+    sort(actual_order.begin(), actual_order.end(), normalized_less);
+    for (int i = 0; i < NUM_ROWS; ++i) {
+      EXPECT_EQ(0, comparator.Compare(rows_[expected_order[i]], rows_[actual_order[i]]))
+          << "position " << i;
+    }
+  }
+
+  static int Sign(int x) { return x < 0 ? -1 : (x > 0 ? 1 : 0); }
+
+  ObjectPool pool_;
+  MemTracker tracker_;
+  scoped_ptr<RuntimeState> state_;
+  scoped_ptr<RowDescriptor> row_desc_;
+  scoped_ptr<RowBatch> batch_;
+  vector<SlotDescriptor*> slots_;
+  vector<TupleRow*> rows_;
+  vector<ExprContext*> ctxs_;
+};
+
+TEST_F(KeyNormalizerTest, SingleKey) {
+  for (int i = 0; i < 4; ++i) {
+    CheckKeys(vector<int>(1, BOOLEAN_SLOT), true, true);
+    CheckKeys(vector<int>(1, TINYINT_SLOT), true, true);
+    CheckKeys(vector<int>(1, INT_SLOT), true, true);
+    CheckKeys(vector<int>(1, BIGINT_SLOT), true, true);
+    CheckKeys(vector<int>(1, FLOAT_SLOT), true, true);
+    CheckKeys(vector<int>(1, DOUBLE_SLOT), true, true);
+    // Strings longer than the key are truncated, and shorter ones padded.
+    CheckKeys(vector<int>(1, STRING_SLOT), true, false);
+  }
+}
+
+TEST_F(KeyNormalizerTest, MultipleKeys) {
+  for (int i = 0; i < 4; ++i) {
+    // 2 + 2 + 5 + 9 bytes fit in the key.
+    int fit[] = { BOOLEAN_SLOT, TINYINT_SLOT, INT_SLOT, BIGINT_SLOT };
+    CheckKeys(vector<int>(fit, fit + 4), true, true);
+    // 3 * 9 bytes don't, so the last key is truncated.
+    int truncated[] = { BIGINT_SLOT, DOUBLE_SLOT, BIGINT2_SLOT };
+    CheckKeys(vector<int>(truncated, truncated + 3), true, false);
+    // A string ends the key, even if it is shorter than the key.
+    int string_first[] = { STRING_SLOT, INT_SLOT };
+    CheckKeys(vector<int>(string_first, string_first + 2), true, false);
+    int string_last[] = { FLOAT_SLOT, STRING_SLOT };
+    CheckKeys(vector<int>(string_last, string_last + 2), true, false);
+  }
+}
+
+// Timestamps can't be normalized, so they end the normalized prefix of the keys.
+TEST_F(KeyNormalizerTest, Timestamp) {
+  EXPECT_FALSE(KeyNormalizer::IsSupported(TYPE_TIMESTAMP));
+  for (int i = 0; i < 4; ++i) {
+    CheckKeys(vector<int>(1, TIMESTAMP_SLOT), false, false);
+    int timestamp_first[] = { TIMESTAMP_SLOT, INT_SLOT };
+    CheckKeys(vector<int>(timestamp_first, timestamp_first + 2), false, false);
+    int timestamp_middle[] = { TINYINT_SLOT, TIMESTAMP_SLOT, BIGINT_SLOT };
+    CheckKeys(vector<int>(timestamp_middle, timestamp_middle + 3), true, false);
+  }
+}
+
+// StringValue::Compare() orders characters as unsigned, like the normalized keys,
+// whether they differ in a 16 byte block that is compared with SSE or in the tail
+// that is compared with strncmp().
+TEST(StringCompareTest, Unsigned) {
+  for (int pos = 0; pos < 40; ++pos) {
+    string low(40, 'x');
+    string high(40, 'x');
+    low[pos] = 'a';
+    high[pos] = '\x80';
+    StringValue low_val(const_cast<char*>(low.data()), low.size());
+    StringValue high_val(const_cast<char*>(high.data()), high.size());
+    EXPECT_LT(low_val.Compare(high_val), 0) << "position " << pos;
+    EXPECT_GT(high_val.Compare(low_val), 0) << "position " << pos;
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  InitCommonRuntime(argc, argv, false, TestInfo::BE_TEST);
+  return RUN_ALL_TESTS();
+}
@@ -19,6 +19,8 @@
 
 namespace impala {
 
+class TupleRowComparator;
+
 // Provides support for normalizing Impala expr values into a memcmp-able,
 // fixed-length format.
 //
@@ -37,35 +39,53 @@ namespace impala {
 //     the fraction. If the float is negative, though, we need to invert both the exponent
 //     and fraction (since smaller number means greater actual value when negative).
 //     Conveniently, IEEE floating point numbers are already in the correct order.
+//     NaN is written as all zeros, since RawValue::Compare() orders it before all
+//     other values.
 // Timestamps:
 //     32 bits for date: 23 bits for year, 4 bits for month, and 5 bits for day.
 //     64 bits for time of day in nanoseconds.
 //     All numbers assumed unsigned.
 // Strings:
-//     Write one character at a time with a null byte at the end (inverted if
-//     sort descending). Unlike other data types, we may write partial strings.
-//     NOTE: This assumes strings do not contain null characters.
+//     Write one character at a time up to the first null character, and pad all
+//     remaining bytes of the key with zeroes (inverted if sort descending). Nothing is
+//     written after a string, so it always ends the normalized key.
 // Booleans/Nulls:
 //     Left as-is.
 //
-// Finally, we pad any remaining bytes of the key with zeroes.
+// Finally, we pad any remaining bytes of the key with zeroes. This includes the bytes
+// of a key that doesn't fit, so two rows whose normalized keys are equal may still
+// differ in the truncated keys and must be compared with the exprs. If two normalized
+// keys differ, memcmp() orders them like TupleRowComparator, except that it may order
+// keys that compare equal (e.g. 0.0 and -0.0).
 class KeyNormalizer {
  public:
   // Initializes the normalizer with the key exprs and length alloted to each normalized
   // key.
-  KeyNormalizer(const std::vector<ExprContext*>& key_exprs_ctxs, int key_len,
+  KeyNormalizer(const std::vector<ExprContext*>& key_expr_ctxs, int key_len,
       const std::vector<bool>& is_asc, const std::vector<bool>& nulls_first)
       : key_expr_ctxs_(key_expr_ctxs), key_len_(key_len), is_asc_(is_asc),
         nulls_first_(nulls_first) {
   }
 
+  // Returns a normalizer, owned by the caller, for the longest prefix of the sort keys
+  // of 'comp' that can be normalized, or NULL if the first key can't be. Sets
+  // 'is_complete' to true if the normalized keys always hold all of the sort keys in
+  // full, i.e. rows with equal normalized keys compare equal with 'comp'.
+  static KeyNormalizer* Create(const TupleRowComparator& comp, int key_len,
+      bool* is_complete);
+
   // Normalizes all keys and writes the value into dst.
-  // Returns true if we went over the max key size while writing the key.
+  // Returns true if we went over the max key size while writing the key, or if the key
+  // was ended early by a string.
   // If the return value is true, then key_idx_over_budget will be set to
   // the index of the key expr which went over.
   // TODO: Handle non-nullable columns
   bool NormalizeKey(TupleRow* tuple_row, uint8_t* dst, int* key_idx_over_budget = NULL);
 
+  // Returns true if values of 'type' can be normalized. Timestamps can't, since an
+  // invalid TimestampValue has no year, month and day to write.
+  static bool IsSupported(const ColumnType& type);
+
  private:
   // Returns true if we went over the max key size while writing the null bit.
   static bool WriteNullBit(uint8_t null_bit, uint8_t* value, uint8_t* dst,
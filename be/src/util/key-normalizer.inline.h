@@ -23,6 +23,7 @@
 #include "runtime/string-value.h"
 #include "runtime/timestamp-value.h"
 #include "util/bit-util.h"
+#include "util/tuple-row-compare.h"
 
 namespace impala {
 
@@ -60,7 +61,11 @@ inline void KeyNormalizer::NormalizeFloat(void* src, void* dst, bool is_asc) {
   const ResultType sign_bit = (1LL << (num_bits - 1));
 
   ResultType value = *(reinterpret_cast<ResultType*>(src));
-  if (value & sign_bit) {
+  FloatType float_value = *(reinterpret_cast<FloatType*>(src));
+  if (float_value != float_value) {
+    // NaN sorts before all other values.
+    value = 0;
+  } else if (value & sign_bit) {
     // If the sign is negative, we'll end up inverting the whole thing.
     value = ~value;
   } else {
@@ -125,18 +130,17 @@ inline bool KeyNormalizer::WriteNormalizedKey(const ColumnType& type, bool is_as
     case TYPE_VARCHAR: {
       StringValue* string_val = reinterpret_cast<StringValue*>(value);
 
-      // Copy the string over, with an additional NULL at the end.
+      // Copy the string over up to the first null character, which compares like the
+      // padding, and pad the rest of the key. A later key would be compared against
+      // the characters of a longer string, so the string ends the key.
       int size = std::min(string_val->len, *bytes_left);
-      for (int i = 0; i < size; ++i) {
+      int i = 0;
+      for (; i < size && string_val->ptr[i] != '\0'; ++i) {
         StoreFinalValue<uint8_t>(string_val->ptr[i], dst + i, is_asc);
       }
-      *bytes_left -= size;
-
-      if (*bytes_left == 0) return true;
-
-      StoreFinalValue<uint8_t>(0, dst + size, is_asc);
-      --*bytes_left;
-      return false;
+      memset(dst + i, is_asc ? 0 : 0xff, *bytes_left - i);
+      *bytes_left = 0;
+      return true;
     }
 
     case TYPE_BOOLEAN:
@@ -152,6 +156,49 @@ inline bool KeyNormalizer::WriteNormalizedKey(const ColumnType& type, bool is_as
   return false;
 }
 
+inline bool KeyNormalizer::IsSupported(const ColumnType& type) {
+  switch (type.type) {
+    case TYPE_NULL:
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+inline KeyNormalizer* KeyNormalizer::Create(const TupleRowComparator& comp,
+    int key_len, bool* is_complete) {
+  const std::vector<ExprContext*>& key_expr_ctxs = comp.key_expr_ctxs_lhs();
+  std::vector<ExprContext*> normalized_expr_ctxs;
+  std::vector<bool> is_asc;
+  std::vector<bool> nulls_first;
+  int normalized_len = 0;
+  *is_complete = true;
+  for (int i = 0; i < key_expr_ctxs.size(); ++i) {
+    const ColumnType& type = key_expr_ctxs[i]->root()->type();
+    if (!IsSupported(type)) break;
+    normalized_expr_ctxs.push_back(key_expr_ctxs[i]);
+    is_asc.push_back(comp.is_asc()[i]);
+    nulls_first.push_back(comp.nulls_first(i));
+    // A null byte followed by the value. Strings always end the normalized key.
+    normalized_len += 1 + type.GetByteSize();
+    if (type.IsVarLen()) *is_complete = false;
+  }
+  if (normalized_expr_ctxs.size() < key_expr_ctxs.size() || normalized_len > key_len) {
+    *is_complete = false;
+  }
+  if (normalized_expr_ctxs.empty()) return NULL;
+  return new KeyNormalizer(normalized_expr_ctxs, key_len, is_asc, nulls_first);
+}
+
 inline bool KeyNormalizer::NormalizeKeyColumn(const ColumnType& type, uint8_t null_bit,
     bool is_asc, uint8_t* value, uint8_t* dst, int* bytes_left) {
   bool went_over = WriteNullBit(null_bit, value, dst, bytes_left);
@@ -162,14 +209,15 @@ inline bool KeyNormalizer::NormalizeKeyColumn(const ColumnType& type, uint8_t nu
 inline bool KeyNormalizer::NormalizeKey(TupleRow* row, uint8_t* dst,
     int* key_idx_over_budget) {
   int bytes_left = key_len_;
+  bool went_over = false;
   for (int i = 0; i < key_expr_ctxs_.size(); ++i) {
     uint8_t* key = reinterpret_cast<uint8_t*>(key_expr_ctxs_[i]->GetValue(row));
     int offset = key_len_ - bytes_left;
-    bool went_over = NormalizeKeyColumn(key_expr_ctxs_[i]->root()->type(),
+    went_over = NormalizeKeyColumn(key_expr_ctxs_[i]->root()->type(),
         !nulls_first_[i], is_asc_[i], key, dst + offset, &bytes_left);
     if (went_over) {
       if (key_idx_over_budget != NULL) *key_idx_over_budget = i;
-      return true;
+      break;
     }
   }
 
@@ -177,7 +225,7 @@ inline bool KeyNormalizer::NormalizeKey(TupleRow* row, uint8_t* dst,
   int offset = key_len_ - bytes_left;
   bzero(dst + offset, bytes_left);
 
-  return false;
+  return went_over;
 }
 
 }
@@ -94,7 +94,16 @@ class RleDecoder {
   template<typename T>
   bool Get(T* val);
 
+  // Skips the next 'num_values' values. Repeated runs are skipped as a whole and
+  // literal runs without decoding their values. Returns false if there are fewer values
+  // left.
+  bool Skip(int num_values);
+
  private:
+  // Reads the indicator of the next run and, for a repeated run, its value.
+  template<typename T>
+  bool NextRun();
+
   BitReader bit_reader_;
   int bit_width_;
   uint64_t current_value_;
@@ -225,25 +234,31 @@ class RleEncoder {
   uint8_t* literal_indicator_byte_;
 };
 
+template<typename T>
+inline bool RleDecoder::NextRun() {
+  // Read the next run's indicator int, it could be a literal or repeated run
+  // The int is encoded as a vlq-encoded value.
+  int32_t indicator_value = 0;
+  bool result = bit_reader_.GetVlqInt(&indicator_value);
+  if (!result) return false;
+
+  // lsb indicates if it is a literal run or repeated run
+  bool is_literal = indicator_value & 1;
+  if (is_literal) {
+    literal_count_ = (indicator_value >> 1) * 8;
+  } else {
+    repeat_count_ = indicator_value >> 1;
+    bool result = bit_reader_.GetAligned<T>(
+        BitUtil::Ceil(bit_width_, 8), reinterpret_cast<T*>(&current_value_));
+    DCHECK(result);
+  }
+  return true;
+}
+
 template<typename T>
 inline bool RleDecoder::Get(T* val) {
   if (UNLIKELY(literal_count_ == 0 && repeat_count_ == 0)) {
-    // Read the next run's indicator int, it could be a literal or repeated run
-    // The int is encoded as a vlq-encoded value.
-    int32_t indicator_value = 0;
-    bool result = bit_reader_.GetVlqInt(&indicator_value);
-    if (!result) return false;
-
-    // lsb indicates if it is a literal run or repeated run
-    bool is_literal = indicator_value & 1;
-    if (is_literal) {
-      literal_count_ = (indicator_value >> 1) * 8;
-    } else {
-      repeat_count_ = indicator_value >> 1;
-      bool result = bit_reader_.GetAligned<T>(
-          BitUtil::Ceil(bit_width_, 8), reinterpret_cast<T*>(&current_value_));
-      DCHECK(result);
-    }
+    if (!NextRun<T>()) return false;
   }
 
   if (LIKELY(repeat_count_ > 0)) {
@@ -259,6 +274,29 @@ inline bool RleDecoder::Get(T* val) {
   return true;
 }
 
+inline bool RleDecoder::Skip(int num_values) {
+  while (num_values > 0) {
+    if (literal_count_ == 0 && repeat_count_ == 0) {
+      // The repeated value is only read into the low bytes.
+      current_value_ = 0;
+      if (!NextRun<uint64_t>()) return false;
+      // An empty run would not make progress.
+      if (literal_count_ == 0 && repeat_count_ == 0) return false;
+    }
+    if (repeat_count_ > 0) {
+      int n = std::min<uint32_t>(num_values, repeat_count_);
+      repeat_count_ -= n;
+      num_values -= n;
+    } else {
+      int n = std::min<uint32_t>(num_values, literal_count_);
+      if (!bit_reader_.SkipValues(bit_width_, n)) return false;
+      literal_count_ -= n;
+      num_values -= n;
+    }
+  }
+  return true;
+}
+
 // This function buffers input values 8 at a time.  After seeing all 8 values,
 // it decides whether they should be encoded as a literal or repeated run.
 inline bool RleEncoder::Put(uint64_t value) {
@@ -356,6 +356,50 @@ TEST(BitRle, RepeatedPattern) {
   ValidateRle(values, 1, NULL, -1);
 }
 
+// Test skipping values of mixed repeated and literal runs, interleaved with reads.
+TEST(BitRle, Skip) {
+  vector<int> values;
+  for (int i = 0; i < 2000; ++i) {
+    // Runs of 50 values alternate with literal runs.
+    values.push_back((i / 50) % 2 == 0 ? 3 : i % 7);
+  }
+  for (int bit_width = 3; bit_width <= 20; bit_width += 17) {
+    const int len = 64 * 1024;
+    uint8_t buffer[len];
+    RleEncoder encoder(buffer, len, bit_width);
+    for (int i = 0; i < values.size(); ++i) EXPECT_TRUE(encoder.Put(values[i]));
+    int encoded_len = encoder.Flush();
+
+    for (int skip = 1; skip < 100; skip += 13) {
+      RleDecoder decoder(buffer, encoded_len, bit_width);
+      int i = 0;
+      while (i + skip < values.size()) {
+        EXPECT_TRUE(decoder.Skip(skip));
+        i += skip;
+        uint64_t val;
+        EXPECT_TRUE(decoder.Get(&val));
+        EXPECT_EQ(values[i], val) << i;
+        ++i;
+      }
+    }
+    RleDecoder decoder(buffer, encoded_len, bit_width);
+    EXPECT_TRUE(decoder.Skip(values.size()));
+    EXPECT_FALSE(decoder.Skip(1000));
+  }
+
+  uint8_t buffer[8];
+  BitWriter writer(buffer, sizeof(buffer));
+  for (int i = 0; i < 16; ++i) EXPECT_TRUE(writer.PutValue(i % 8, 3));
+  writer.Flush();
+  BitReader reader(buffer, sizeof(buffer));
+  int val;
+  EXPECT_TRUE(reader.SkipValues(3, 5));
+  EXPECT_TRUE(reader.GetValue(3, &val));
+  EXPECT_EQ(val, 5);
+  EXPECT_TRUE(reader.SkipValues(3, 10));
+  EXPECT_FALSE(reader.SkipValues(3, 10));
+}
+
 TEST(BitRle, Overflow) {
   for (int bit_width = 1; bit_width < 32; bit_width += 3) {
     const int len = RleEncoder::MinBufferSize(bit_width);
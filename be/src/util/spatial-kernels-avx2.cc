@@ -0,0 +1,103 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file is compiled with -mavx2 and its functions must only be called after
+// checking CpuInfo::IsSupported(CpuInfo::AVX2). It must not call any inline functions
+// defined in headers (e.g. RectangleValue::Intersects()): the compiler is free to emit
+// AVX2 code for them here, and the linker may pick that copy for the whole binary.
+
+#include "util/spatial-kernels.h"
+
+#include <immintrin.h>
+
+using namespace impala;
+
+// Same as AppendMatches() in spatial-kernels.cc.
+static inline int AppendMatches(int mask, int width, int base, int* matches) {
+  int num_matches = 0;
+  for (int k = 0; k < width; ++k) {
+    matches[num_matches] = base + k;
+    num_matches += (mask >> k) & 1;
+  }
+  return num_matches;
+}
+
+int SpatialKernels::IntersectsAvx2(const RectangleValue& r, const double* x1,
+    const double* y1, const double* x2, const double* y2, int n, int* matches) {
+  const __m256d r_x1 = _mm256_set1_pd(r.x1);
+  const __m256d r_y1 = _mm256_set1_pd(r.y1);
+  const __m256d r_x2 = _mm256_set1_pd(r.x2);
+  const __m256d r_y2 = _mm256_set1_pd(r.y2);
+  int num_matches = 0;
+  for (int i = 0; i + 4 <= n; i += 4) {
+    __m256d m = _mm256_cmp_pd(_mm256_loadu_pd(x2 + i), r_x1, _CMP_GT_OQ);
+    m = _mm256_and_pd(m, _mm256_cmp_pd(_mm256_loadu_pd(x1 + i), r_x2, _CMP_LT_OQ));
+    m = _mm256_and_pd(m, _mm256_cmp_pd(_mm256_loadu_pd(y2 + i), r_y1, _CMP_GT_OQ));
+    m = _mm256_and_pd(m, _mm256_cmp_pd(_mm256_loadu_pd(y1 + i), r_y2, _CMP_LT_OQ));
+    num_matches += AppendMatches(_mm256_movemask_pd(m), 4, i, matches + num_matches);
+  }
+  return num_matches;
+}
+
+int SpatialKernels::ContainsAvx2(const RectangleValue& r, const double* x1,
+    const double* y1, const double* x2, const double* y2, int n, int* matches) {
+  const __m256d r_x1 = _mm256_set1_pd(r.x1);
+  const __m256d r_y1 = _mm256_set1_pd(r.y1);
+  const __m256d r_x2 = _mm256_set1_pd(r.x2);
+  const __m256d r_y2 = _mm256_set1_pd(r.y2);
+  int num_matches = 0;
+  for (int i = 0; i + 4 <= n; i += 4) {
+    __m256d m = _mm256_cmp_pd(_mm256_loadu_pd(x1 + i), r_x1, _CMP_GE_OQ);
+    m = _mm256_and_pd(m, _mm256_cmp_pd(_mm256_loadu_pd(x2 + i), r_x2, _CMP_LE_OQ));
+    m = _mm256_and_pd(m, _mm256_cmp_pd(_mm256_loadu_pd(y1 + i), r_y1, _CMP_GE_OQ));
+    m = _mm256_and_pd(m, _mm256_cmp_pd(_mm256_loadu_pd(y2 + i), r_y2, _CMP_LE_OQ));
+    num_matches += AppendMatches(_mm256_movemask_pd(m), 4, i, matches + num_matches);
+  }
+  return num_matches;
+}
+
+int SpatialKernels::ContainsPointsAvx2(const RectangleValue& r, const double* x,
+    const double* y, int n, int* matches) {
+  const __m256d r_x1 = _mm256_set1_pd(r.x1);
+  const __m256d r_y1 = _mm256_set1_pd(r.y1);
+  const __m256d r_x2 = _mm256_set1_pd(r.x2);
+  const __m256d r_y2 = _mm256_set1_pd(r.y2);
+  int num_matches = 0;
+  for (int i = 0; i + 4 <= n; i += 4) {
+    __m256d px = _mm256_loadu_pd(x + i);
+    __m256d py = _mm256_loadu_pd(y + i);
+    __m256d m = _mm256_and_pd(_mm256_cmp_pd(px, r_x1, _CMP_GE_OQ),
+        _mm256_cmp_pd(px, r_x2, _CMP_LT_OQ));
+    m = _mm256_and_pd(m, _mm256_and_pd(_mm256_cmp_pd(py, r_y1, _CMP_GE_OQ),
+        _mm256_cmp_pd(py, r_y2, _CMP_LT_OQ)));
+    num_matches += AppendMatches(_mm256_movemask_pd(m), 4, i, matches + num_matches);
+  }
+  return num_matches;
+}
+
+int SpatialKernels::DWithinAvx2(const PointValue& p, double distance, const double* x,
+    const double* y, int n, int* matches) {
+  const __m256d p_x = _mm256_set1_pd(p.x);
+  const __m256d p_y = _mm256_set1_pd(p.y);
+  const __m256d max_dist_sq = _mm256_set1_pd(distance * distance);
+  int num_matches = 0;
+  for (int i = 0; i + 4 <= n; i += 4) {
+    __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), p_x);
+    __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), p_y);
+    __m256d dist_sq = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    __m256d m = _mm256_cmp_pd(dist_sq, max_dist_sq, _CMP_LE_OQ);
+    num_matches += AppendMatches(_mm256_movemask_pd(m), 4, i, matches + num_matches);
+  }
+  return num_matches;
+}
@@ -0,0 +1,136 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include <stdlib.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "util/cpu-info.h"
+#include "util/spatial-kernels.h"
+
+using namespace std;
+
+namespace impala {
+
+// Rectangles and points on a small integer grid, so that many values share edges and
+// coordinates with the query rectangle, plus a few NaN coordinates.
+class SpatialKernelsTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    srand(0);
+    // An odd number of values exercises the scalar tail of the vectorized kernels.
+    for (int i = 0; i < 1023; ++i) {
+      double x1 = rand() % 20;
+      double y1 = rand() % 20;
+      x1_.push_back(x1);
+      y1_.push_back(y1);
+      x2_.push_back(x1 + rand() % 5);
+      y2_.push_back(y1 + rand() % 5);
+    }
+    x1_[7] = numeric_limits<double>::quiet_NaN();
+    y2_[100] = numeric_limits<double>::quiet_NaN();
+    matches_.resize(x1_.size());
+  }
+
+  // Runs each kernel with the AVX2 and SSE paths enabled or disabled and checks the
+  // results against the scalar predicates.
+  void TestAllPaths(const RectangleValue& r, const PointValue& p, double distance) {
+    TestKernels(r, p, distance);
+    bool avx2 = CpuInfo::IsSupported(CpuInfo::AVX2);
+    bool sse4_2 = CpuInfo::IsSupported(CpuInfo::SSE4_2);
+    CpuInfo::EnableFeature(CpuInfo::AVX2, false);
+    TestKernels(r, p, distance);
+    CpuInfo::EnableFeature(CpuInfo::SSE4_2, false);
+    TestKernels(r, p, distance);
+    CpuInfo::EnableFeature(CpuInfo::SSE4_2, sse4_2);
+    CpuInfo::EnableFeature(CpuInfo::AVX2, avx2);
+  }
+
+  void TestKernels(const RectangleValue& r, const PointValue& p, double distance) {
+    int n = x1_.size();
+    vector<int> expected;
+    for (int i = 0; i < n; ++i) {
+      if (r.Intersects(RectangleValue(x1_[i], y1_[i], x2_[i], y2_[i]))) {
+        expected.push_back(i);
+      }
+    }
+    CheckMatches(expected, SpatialKernels::Intersects(
+        r, &x1_[0], &y1_[0], &x2_[0], &y2_[0], n, &matches_[0]));
+
+    expected.clear();
+    for (int i = 0; i < n; ++i) {
+      if (r.Contains(RectangleValue(x1_[i], y1_[i], x2_[i], y2_[i]))) {
+        expected.push_back(i);
+      }
+    }
+    CheckMatches(expected, SpatialKernels::Contains(
+        r, &x1_[0], &y1_[0], &x2_[0], &y2_[0], n, &matches_[0]));
+
+    expected.clear();
+    for (int i = 0; i < n; ++i) {
+      if (r.Contains(PointValue(x1_[i], y1_[i]))) expected.push_back(i);
+    }
+    CheckMatches(expected,
+        SpatialKernels::ContainsPoints(r, &x1_[0], &y1_[0], n, &matches_[0]));
+
+    expected.clear();
+    for (int i = 0; i < n; ++i) {
+      double dx = x1_[i] - p.x;
+      double dy = y1_[i] - p.y;
+      if (distance >= 0 && dx * dx + dy * dy <= distance * distance) {
+        expected.push_back(i);
+      }
+    }
+    CheckMatches(expected,
+        SpatialKernels::DWithin(p, distance, &x1_[0], &y1_[0], n, &matches_[0]));
+  }
+
+  void CheckMatches(const vector<int>& expected, int num_matches) {
+    ASSERT_EQ(expected.size(), num_matches);
+    for (int i = 0; i < num_matches; ++i) EXPECT_EQ(expected[i], matches_[i]);
+  }
+
+  vector<double> x1_;
+  vector<double> y1_;
+  vector<double> x2_;
+  vector<double> y2_;
+  vector<int> matches_;
+};
+
+TEST_F(SpatialKernelsTest, Basic) {
+  TestAllPaths(RectangleValue(5, 5, 10, 10), PointValue(10, 10), 3);
+  TestAllPaths(RectangleValue(0, 0, 20, 20), PointValue(0, 0), 0);
+}
+
+TEST_F(SpatialKernelsTest, Degenerate) {
+  // Empty rectangle, negative distance and NaN query values.
+  TestAllPaths(RectangleValue(5, 5, 5, 5), PointValue(5, 5), -1);
+  double nan = numeric_limits<double>::quiet_NaN();
+  TestAllPaths(RectangleValue(nan, 0, 20, 20), PointValue(nan, 0), nan);
+}
+
+TEST_F(SpatialKernelsTest, Empty) {
+  RectangleValue r(0, 0, 20, 20);
+  EXPECT_EQ(0, SpatialKernels::Intersects(r, NULL, NULL, NULL, NULL, 0, NULL));
+  EXPECT_EQ(0, SpatialKernels::ContainsPoints(r, NULL, NULL, 0, NULL));
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  impala::CpuInfo::Init();
+  return RUN_ALL_TESTS();
+}
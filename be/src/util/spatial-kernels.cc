@@ -0,0 +1,183 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/spatial-kernels.h"
+
+#include <emmintrin.h>
+
+#include "util/cpu-info.h"
+
+using namespace impala;
+
+// Appends 'base' + k to 'matches' for each bit k that is set in the 'width' lowest bits
+// of 'mask' and returns the number of appended indexes. The index is written
+// unconditionally and only kept if the bit is set, so there is no branch on the
+// comparison result.
+static inline int AppendMatches(int mask, int width, int base, int* matches) {
+  int num_matches = 0;
+  for (int k = 0; k < width; ++k) {
+    matches[num_matches] = base + k;
+    num_matches += (mask >> k) & 1;
+  }
+  return num_matches;
+}
+
+// The SSE implementations process the first n - n % 2 values and return the number of
+// matches among them. The comparisons are the ordered ones (cmplt, cmpgt etc.), which
+// are false if either operand is NaN, like their scalar counterparts.
+static int IntersectsSse(const RectangleValue& r, const double* x1, const double* y1,
+    const double* x2, const double* y2, int n, int* matches) {
+  const __m128d r_x1 = _mm_set1_pd(r.x1);
+  const __m128d r_y1 = _mm_set1_pd(r.y1);
+  const __m128d r_x2 = _mm_set1_pd(r.x2);
+  const __m128d r_y2 = _mm_set1_pd(r.y2);
+  int num_matches = 0;
+  for (int i = 0; i + 2 <= n; i += 2) {
+    __m128d m = _mm_cmpgt_pd(_mm_loadu_pd(x2 + i), r_x1);
+    m = _mm_and_pd(m, _mm_cmplt_pd(_mm_loadu_pd(x1 + i), r_x2));
+    m = _mm_and_pd(m, _mm_cmpgt_pd(_mm_loadu_pd(y2 + i), r_y1));
+    m = _mm_and_pd(m, _mm_cmplt_pd(_mm_loadu_pd(y1 + i), r_y2));
+    num_matches += AppendMatches(_mm_movemask_pd(m), 2, i, matches + num_matches);
+  }
+  return num_matches;
+}
+
+static int ContainsSse(const RectangleValue& r, const double* x1, const double* y1,
+    const double* x2, const double* y2, int n, int* matches) {
+  const __m128d r_x1 = _mm_set1_pd(r.x1);
+  const __m128d r_y1 = _mm_set1_pd(r.y1);
+  const __m128d r_x2 = _mm_set1_pd(r.x2);
+  const __m128d r_y2 = _mm_set1_pd(r.y2);
+  int num_matches = 0;
+  for (int i = 0; i + 2 <= n; i += 2) {
+    __m128d m = _mm_cmpge_pd(_mm_loadu_pd(x1 + i), r_x1);
+    m = _mm_and_pd(m, _mm_cmple_pd(_mm_loadu_pd(x2 + i), r_x2));
+    m = _mm_and_pd(m, _mm_cmpge_pd(_mm_loadu_pd(y1 + i), r_y1));
+    m = _mm_and_pd(m, _mm_cmple_pd(_mm_loadu_pd(y2 + i), r_y2));
+    num_matches += AppendMatches(_mm_movemask_pd(m), 2, i, matches + num_matches);
+  }
+  return num_matches;
+}
+
+static int ContainsPointsSse(const RectangleValue& r, const double* x, const double* y,
+    int n, int* matches) {
+  const __m128d r_x1 = _mm_set1_pd(r.x1);
+  const __m128d r_y1 = _mm_set1_pd(r.y1);
+  const __m128d r_x2 = _mm_set1_pd(r.x2);
+  const __m128d r_y2 = _mm_set1_pd(r.y2);
+  int num_matches = 0;
+  for (int i = 0; i + 2 <= n; i += 2) {
+    __m128d px = _mm_loadu_pd(x + i);
+    __m128d py = _mm_loadu_pd(y + i);
+    __m128d m = _mm_and_pd(_mm_cmpge_pd(px, r_x1), _mm_cmplt_pd(px, r_x2));
+    m = _mm_and_pd(m, _mm_and_pd(_mm_cmpge_pd(py, r_y1), _mm_cmplt_pd(py, r_y2)));
+    num_matches += AppendMatches(_mm_movemask_pd(m), 2, i, matches + num_matches);
+  }
+  return num_matches;
+}
+
+static int DWithinSse(const PointValue& p, double distance, const double* x,
+    const double* y, int n, int* matches) {
+  const __m128d p_x = _mm_set1_pd(p.x);
+  const __m128d p_y = _mm_set1_pd(p.y);
+  const __m128d max_dist_sq = _mm_set1_pd(distance * distance);
+  int num_matches = 0;
+  for (int i = 0; i + 2 <= n; i += 2) {
+    __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + i), p_x);
+    __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + i), p_y);
+    __m128d dist_sq = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+    __m128d m = _mm_cmple_pd(dist_sq, max_dist_sq);
+    num_matches += AppendMatches(_mm_movemask_pd(m), 2, i, matches + num_matches);
+  }
+  return num_matches;
+}
+
+// Returns the number of values that the vectorized code processes, i.e. 'n' rounded
+// down to a multiple of the widest vector width the CPU supports. Sets 'use_avx2'.
+static inline int VectorizedPrefix(int n, bool* use_avx2) {
+  *use_avx2 = CpuInfo::IsSupported(CpuInfo::AVX2);
+  if (*use_avx2) return n & ~3;
+  if (CpuInfo::IsSupported(CpuInfo::SSE4_2)) return n & ~1;
+  return 0;
+}
+
+int SpatialKernels::Intersects(const RectangleValue& r, const double* x1,
+    const double* y1, const double* x2, const double* y2, int n, int* matches) {
+  bool use_avx2;
+  int i = VectorizedPrefix(n, &use_avx2);
+  int num_matches = 0;
+  if (i > 0) {
+    num_matches = use_avx2 ? IntersectsAvx2(r, x1, y1, x2, y2, i, matches)
+        : IntersectsSse(r, x1, y1, x2, y2, i, matches);
+  }
+  for (; i < n; ++i) {
+    matches[num_matches] = i;
+    num_matches += r.Intersects(RectangleValue(x1[i], y1[i], x2[i], y2[i]));
+  }
+  return num_matches;
+}
+
+int SpatialKernels::Contains(const RectangleValue& r, const double* x1,
+    const double* y1, const double* x2, const double* y2, int n, int* matches) {
+  bool use_avx2;
+  int i = VectorizedPrefix(n, &use_avx2);
+  int num_matches = 0;
+  if (i > 0) {
+    num_matches = use_avx2 ? ContainsAvx2(r, x1, y1, x2, y2, i, matches)
+        : ContainsSse(r, x1, y1, x2, y2, i, matches);
+  }
+  for (; i < n; ++i) {
+    matches[num_matches] = i;
+    num_matches += r.Contains(RectangleValue(x1[i], y1[i], x2[i], y2[i]));
+  }
+  return num_matches;
+}
+
+int SpatialKernels::ContainsPoints(const RectangleValue& r, const double* x,
+    const double* y, int n, int* matches) {
+  bool use_avx2;
+  int i = VectorizedPrefix(n, &use_avx2);
+  int num_matches = 0;
+  if (i > 0) {
+    num_matches = use_avx2 ? ContainsPointsAvx2(r, x, y, i, matches)
+        : ContainsPointsSse(r, x, y, i, matches);
+  }
+  for (; i < n; ++i) {
+    matches[num_matches] = i;
+    num_matches += r.Contains(PointValue(x[i], y[i]));
+  }
+  return num_matches;
+}
+
+int SpatialKernels::DWithin(const PointValue& p, double distance, const double* x,
+    const double* y, int n, int* matches) {
+  // No point is at a negative distance. This also keeps the squared distance below from
+  // matching.
+  if (!(distance >= 0)) return 0;
+  bool use_avx2;
+  int i = VectorizedPrefix(n, &use_avx2);
+  int num_matches = 0;
+  if (i > 0) {
+    num_matches = use_avx2 ? DWithinAvx2(p, distance, x, y, i, matches)
+        : DWithinSse(p, distance, x, y, i, matches);
+  }
+  double max_dist_sq = distance * distance;
+  for (; i < n; ++i) {
+    double dx = x[i] - p.x;
+    double dy = y[i] - p.y;
+    matches[num_matches] = i;
+    num_matches += dx * dx + dy * dy <= max_dist_sq;
+  }
+  return num_matches;
+}
@@ -0,0 +1,68 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPALA_UTIL_SPATIAL_KERNELS_H
+#define IMPALA_UTIL_SPATIAL_KERNELS_H
+
+#include "runtime/spatial-value.h"
+
+namespace impala {
+
+// Batch versions of the spatial predicates in RectangleValue. Each kernel tests one
+// rectangle or point against 'n' values stored as separate columns of doubles
+// (structure of arrays), writes the indexes of the matching values to 'matches' in
+// ascending order and returns the number of matches. 'matches' must have room for 'n'
+// indexes. The results are the same as calling the corresponding RectangleValue
+// function on each value; comparisons with NaN coordinates are false.
+//
+// The kernels use AVX2 (4 values per instruction) or SSE (2 values per instruction),
+// whichever is the widest supported by the CPU according to CpuInfo, and fall back to
+// scalar code otherwise.
+class SpatialKernels {
+ public:
+  // Rectangles i with r.Intersects(RectangleValue(x1[i], y1[i], x2[i], y2[i])).
+  static int Intersects(const RectangleValue& r, const double* x1, const double* y1,
+      const double* x2, const double* y2, int n, int* matches);
+
+  // Rectangles i with r.Contains(RectangleValue(x1[i], y1[i], x2[i], y2[i])), i.e. the
+  // rectangles within 'r'.
+  static int Contains(const RectangleValue& r, const double* x1, const double* y1,
+      const double* x2, const double* y2, int n, int* matches);
+
+  // Points i with r.Contains(PointValue(x[i], y[i])).
+  static int ContainsPoints(const RectangleValue& r, const double* x, const double* y,
+      int n, int* matches);
+
+  // Points i whose euclidean distance to 'p' is at most 'distance'.
+  static int DWithin(const PointValue& p, double distance, const double* x,
+      const double* y, int n, int* matches);
+
+ private:
+  // AVX2 implementations, in spatial-kernels-avx2.cc, which is the only file compiled
+  // with -mavx2. They only process the first n - n % 4 values and must only be called
+  // if CpuInfo::IsSupported(CpuInfo::AVX2).
+  static int IntersectsAvx2(const RectangleValue& r, const double* x1, const double* y1,
+      const double* x2, const double* y2, int n, int* matches);
+  static int ContainsAvx2(const RectangleValue& r, const double* x1, const double* y1,
+      const double* x2, const double* y2, int n, int* matches);
+  static int ContainsPointsAvx2(const RectangleValue& r, const double* x,
+      const double* y, int n, int* matches);
+  static int DWithinAvx2(const PointValue& p, double distance, const double* x,
+      const double* y, int n, int* matches);
+};
+
+}
+
+#endif
@@ -0,0 +1,281 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <gtest/gtest.h>
+
+#include "codegen/llvm-codegen.h"
+#include "common/init.h"
+#include "common/object-pool.h"
+#include "exprs/expr-context.h"
+#include "exprs/slot-ref.h"
+#include "runtime/decimal-value.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/row-batch.h"
+#include "runtime/runtime-state.h"
+#include "runtime/string-value.h"
+#include "runtime/timestamp-value.h"
+#include "runtime/tuple-row.h"
+#include "testutil/desc-tbl-builder.h"
+#include "util/test-info.h"
+#include "util/tuple-row-compare.h"
+
+using namespace boost;
+using namespace impala;
+using namespace std;
+
+namespace impala {
+
+static const int NUM_ROWS = 30;
+
+static const char* STRINGS[] = { "", "a", "ab", "b", "ba" };
+
+// Adapts TupleRowComparator to the strict weak ordering that std::stable_sort() needs.
+struct LessThan {
+  const TupleRowComparator* comparator;
+  LessThan(const TupleRowComparator* c) : comparator(c) { }
+  bool operator()(TupleRow* lhs, TupleRow* rhs) const {
+    return comparator->Compare(lhs, rhs) < 0;
+  }
+};
+
+// Tests that the codegen'd TupleRowComparator orders rows the same way as the
+// interpreted one, for each key type that supports codegen, both sort orders and both
+// NULL orders.
+class TupleRowCompareTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    state_.reset(new RuntimeState(TPlanFragmentInstanceCtx(), "", NULL));
+    types_.push_back(TYPE_BOOLEAN);
+    types_.push_back(TYPE_TINYINT);
+    types_.push_back(TYPE_SMALLINT);
+    types_.push_back(TYPE_INT);
+    types_.push_back(TYPE_BIGINT);
+    types_.push_back(TYPE_FLOAT);
+    types_.push_back(TYPE_DOUBLE);
+    types_.push_back(TYPE_STRING);
+    types_.push_back(TYPE_TIMESTAMP);
+    // One of each decimal width.
+    types_.push_back(ColumnType::CreateDecimalType(9, 2));
+    types_.push_back(ColumnType::CreateDecimalType(18, 4));
+    types_.push_back(ColumnType::CreateDecimalType(38, 10));
+
+    DescriptorTblBuilder builder(&pool_);
+    TupleDescBuilder& tuple_builder = builder.DeclareTuple();
+    for (int i = 0; i < types_.size(); ++i) tuple_builder << types_[i];
+    DescriptorTbl* desc_tbl = builder.Build();
+    state_->set_desc_tbl(desc_tbl);
+    TupleDescriptor* tuple_desc = desc_tbl->GetTupleDescriptor(0);
+    slots_ = tuple_desc->slots();
+    row_desc_.reset(new RowDescriptor(tuple_desc, false));
+
+    batch_.reset(new RowBatch(*row_desc_, NUM_ROWS, &tracker_));
+    for (int row = 0; row < NUM_ROWS; ++row) {
+      Tuple* tuple = Tuple::Create(tuple_desc->byte_size(), batch_->tuple_data_pool());
+      for (int i = 0; i < slots_.size(); ++i) SetSlot(tuple, slots_[i], row);
+      int idx = batch_->AddRow();
+      batch_->GetRow(idx)->SetTuple(0, tuple);
+      batch_->CommitLastRow();
+      rows_.push_back(batch_->GetRow(idx));
+    }
+  }
+
+  virtual void TearDown() {
+    for (int i = 0; i < ctxs_.size(); ++i) ctxs_[i]->Close(state_.get());
+    batch_.reset();
+    state_.reset();
+  }
+
+  // Sets the slot to a value with duplicates in other rows, or to NULL in some rows.
+  // Float and double slots are NaN in some rows.
+  void SetSlot(Tuple* tuple, const SlotDescriptor* slot, int row) {
+    if (row % 7 == 3) {
+      tuple->SetNull(slot->null_indicator_offset());
+      return;
+    }
+    int v = row % 9 - 4;
+    void* dst = tuple->GetSlot(slot->tuple_offset());
+    switch (slot->type().type) {
+      case TYPE_BOOLEAN: *reinterpret_cast<bool*>(dst) = v % 2 == 0; break;
+      case TYPE_TINYINT: *reinterpret_cast<int8_t*>(dst) = v * 31; break;
+      case TYPE_SMALLINT: *reinterpret_cast<int16_t*>(dst) = v * 8000; break;
+      case TYPE_INT: *reinterpret_cast<int32_t*>(dst) = v * 500000000; break;
+      case TYPE_BIGINT:
+        *reinterpret_cast<int64_t*>(dst) = v * 2000000000000000000LL;
+        break;
+      case TYPE_FLOAT:
+        *reinterpret_cast<float*>(dst) = row % 5 == 1 ?
+            numeric_limits<float>::quiet_NaN() : v * 1.5f;
+        break;
+      case TYPE_DOUBLE:
+        *reinterpret_cast<double*>(dst) = row % 5 == 1 ?
+            numeric_limits<double>::quiet_NaN() : v * 1e300;
+        break;
+      case TYPE_STRING: {
+        const char* s = STRINGS[(v + 4) % 5];
+        *reinterpret_cast<StringValue*>(dst) =
+            StringValue(const_cast<char*>(s), strlen(s));
+        break;
+      }
+      case TYPE_TIMESTAMP:
+        // Values that differ only in the date or only in the time of day.
+        *reinterpret_cast<TimestampValue*>(dst) = TimestampValue(
+            static_cast<int64_t>(1000000000 + (v / 2) * 86400 + (v % 2) * 3600),
+            static_cast<int64_t>(0));
+        break;
+      case TYPE_DECIMAL:
+        switch (slot->type().GetByteSize()) {
+          case 4:
+            *reinterpret_cast<Decimal4Value*>(dst) = Decimal4Value(v * 200000000);
+            break;
+          case 8:
+            *reinterpret_cast<Decimal8Value*>(dst) =
+                Decimal8Value(v * 200000000000000000LL);
+            break;
+          case 16:
+            // Doesn't fit in 64 bits.
+            *reinterpret_cast<Decimal16Value*>(dst) =
+                Decimal16Value(static_cast<int128_t>(v) * 1000000000000000000LL * 1000);
+            break;
+          default:
+            DCHECK(false) << slot->type();
+        }
+        break;
+      default:
+        DCHECK(false) << slot->type();
+    }
+  }
+
+  // Returns a prepared and opened slot ref on each of 'slot_idxs'.
+  vector<ExprContext*> CreateKeyExprs(const vector<int>& slot_idxs) {
+    vector<ExprContext*> ctxs;
+    for (int i = 0; i < slot_idxs.size(); ++i) {
+      ctxs.push_back(
+          pool_.Add(new ExprContext(pool_.Add(new SlotRef(slots_[slot_idxs[i]])))));
+    }
+    Status status = Expr::Prepare(ctxs, state_.get(), *row_desc_, &tracker_);
+    DCHECK(status.ok()) << status.GetErrorMsg();
+    status = Expr::Open(ctxs, state_.get());
+    DCHECK(status.ok()) << status.GetErrorMsg();
+    ctxs_.insert(ctxs_.end(), ctxs.begin(), ctxs.end());
+    return ctxs;
+  }
+
+  // Adds an interpreted and a codegen'd comparator on the slots 'slot_idxs', to be
+  // checked by CheckComparators().
+  void AddComparators(const vector<int>& slot_idxs, const vector<bool>& is_asc,
+      const vector<bool>& nulls_first) {
+    vector<ExprContext*> lhs = CreateKeyExprs(slot_idxs);
+    vector<ExprContext*> rhs = CreateKeyExprs(slot_idxs);
+    interpreted_.push_back(
+        pool_.Add(new TupleRowComparator(lhs, rhs, is_asc, nulls_first)));
+    TupleRowComparator* codegend =
+        pool_.Add(new TupleRowComparator(lhs, rhs, is_asc, nulls_first));
+    ASSERT_TRUE(codegend->Codegen(state_.get()));
+    codegend_.push_back(codegend);
+  }
+
+  // Adds the comparators on the single key 'slot_idx' for each order.
+  void AddSingleKeyComparators(int slot_idx) {
+    for (int i = 0; i < 4; ++i) {
+      AddComparators(vector<int>(1, slot_idx), vector<bool>(1, i / 2 == 0),
+          vector<bool>(1, i % 2 == 0));
+    }
+  }
+
+  // Jits the codegen'd comparators and checks that they return the same sign as the
+  // interpreted ones for each pair of rows, and that they sort the rows the same way.
+  void CheckComparators() {
+    LlvmCodeGen* codegen;
+    ASSERT_TRUE(state_->GetCodegen(&codegen).ok());
+    Status status = codegen->FinalizeModule();
+    ASSERT_TRUE(status.ok()) << status.GetErrorMsg();
+
+    for (int c = 0; c < interpreted_.size(); ++c) {
+      const TupleRowComparator* interpreted = interpreted_[c];
+      const TupleRowComparator* codegend = codegend_[c];
+      for (int i = 0; i < NUM_ROWS; ++i) {
+        for (int j = 0; j < NUM_ROWS; ++j) {
+          int expected = interpreted->Compare(rows_[i], rows_[j]);
+          int actual = codegend->Compare(rows_[i], rows_[j]);
+          EXPECT_EQ(Sign(expected), Sign(actual))
+              << "comparator " << c << " rows " << i << ", " << j;
+        }
+      }
+
+      vector<TupleRow*> expected_order = rows_;
+      stable_sort(expected_order.begin(), expected_order.end(), LessThan(interpreted));
+      vector<TupleRow*> actual_order = rows_;
+      stable_sort(actual_order.begin(), actual_order.end(), LessThan(codegend));
+      EXPECT_TRUE(expected_order == actual_order) << "comparator " << c;
+    }
+  }
+
+  static int Sign(int x) { return x < 0 ? -1 : (x > 0 ? 1 : 0); }
+
+  ObjectPool pool_;
+  MemTracker tracker_;
+  scoped_ptr<RuntimeState> state_;
+  scoped_ptr<RowDescriptor> row_desc_;
+  scoped_ptr<RowBatch> batch_;
+  vector<ColumnType> types_;
+  vector<SlotDescriptor*> slots_;
+  vector<TupleRow*> rows_;
+  vector<ExprContext*> ctxs_;
+
+  // The comparators added by AddComparators(), at the same index.
+  vector<TupleRowComparator*> interpreted_;
+  vector<TupleRowComparator*> codegend_;
+};
+
+TEST_F(TupleRowCompareTest, SingleKey) {
+  for (int i = 0; i < slots_.size(); ++i) AddSingleKeyComparators(i);
+  CheckComparators();
+}
+
+// Rows with equal first keys are ordered by the next ones.
+TEST_F(TupleRowCompareTest, MultipleKeys) {
+  vector<int> slot_idxs;
+  vector<bool> is_asc;
+  vector<bool> nulls_first;
+  for (int i = 0; i < slots_.size(); ++i) {
+    slot_idxs.push_back(i);
+    is_asc.push_back(i % 2 == 0);
+    nulls_first.push_back(i % 3 == 0);
+  }
+  AddComparators(slot_idxs, is_asc, nulls_first);
+  // Boolean has the most duplicates; break its ties with desc double, which has NaNs,
+  // then with asc nulls first decimal.
+  int keys[] = { 0, 6, 11 };
+  bool asc[] = { true, false, true };
+  bool first[] = { false, false, true };
+  AddComparators(vector<int>(keys, keys + 3), vector<bool>(asc, asc + 3),
+      vector<bool>(first, first + 3));
+  CheckComparators();
+}
+
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  InitCommonRuntime(argc, argv, false, TestInfo::BE_TEST);
+  LlvmCodeGen::InitializeLlvm();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/tuple-row-compare.h"
+
+#include "codegen/codegen-anyval.h"
+#include "codegen/llvm-codegen.h"
+#include "runtime/runtime-state.h"
+
+using namespace impala;
+using namespace llvm;
+using namespace std;
+
+bool TupleRowComparator::Codegen(RuntimeState* state) {
+  LlvmCodeGen* codegen;
+  if (!state->GetCodegen(&codegen).ok()) return false;
+  Function* fn = CodegenCompare(state);
+  if (fn == NULL) return false;
+  codegen->AddFunctionToJit(fn, reinterpret_cast<void**>(&codegend_compare_fn_));
+  return true;
+}
+
+// Codegens an unrolled version of Compare(). The expr contexts are baked in as
+// constants, and descending keys compare rhs to lhs rather than negating the result.
+// For a single nullable int key, asc nulls last, the IR is:
+// define i32 @Compare(%"class.impala::TupleRow"* %lhs, %"class.impala::TupleRow"* %rhs) {
+// entry:
+//   %lhs_value = call i64 @GetSlotRef(%"class.impala::ExprContext"* inttoptr
+//       (i64 140226381340800 to %"class.impala::ExprContext"*), ... %lhs)
+//   %rhs_value = call i64 @GetSlotRef(%"class.impala::ExprContext"* inttoptr
+//       (i64 140226381341184 to %"class.impala::ExprContext"*), ... %rhs)
+//   ...
+//   br i1 %either_null, label %null, label %not_null
+// null:
+//   br i1 %both_null, label %next_key, label %null_result
+// null_result:
+//   %null_order = select i1 %lhs_is_null, i32 1, i32 -1
+//   ret i32 %null_order
+// not_null:
+//   ... (see CodegenAnyVal::Compare())
+//   %result_ne_zero = icmp ne i32 %result, 0
+//   br i1 %result_ne_zero, label %return_result, label %next_key
+// return_result:
+//   ret i32 %result
+// next_key:
+//   ret i32 0
+// }
+Function* TupleRowComparator::CodegenCompare(RuntimeState* state) {
+  LlvmCodeGen* codegen;
+  if (!state->GetCodegen(&codegen).ok()) return NULL;
+  for (int i = 0; i < key_expr_ctxs_lhs_.size(); ++i) {
+    if (!CodegenAnyVal::SupportsCompare(key_expr_ctxs_lhs_[i]->root()->type())) {
+      return NULL;
+    }
+  }
+
+  PointerType* tuple_row_ptr_type = codegen->GetPtrType(TupleRow::LLVM_CLASS_NAME);
+  LlvmCodeGen::FnPrototype prototype(codegen, "Compare", codegen->GetType(TYPE_INT));
+  prototype.AddArgument(LlvmCodeGen::NamedVariable("lhs", tuple_row_ptr_type));
+  prototype.AddArgument(LlvmCodeGen::NamedVariable("rhs", tuple_row_ptr_type));
+
+  LLVMContext& context = codegen->context();
+  LlvmCodeGen::LlvmBuilder builder(context);
+  Value* args[2];
+  Function* fn = prototype.GeneratePrototype(&builder, args);
+  Value* zero = codegen->GetIntConstant(TYPE_INT, 0);
+
+  for (int i = 0; i < key_expr_ctxs_lhs_.size(); ++i) {
+    const ColumnType& type = key_expr_ctxs_lhs_[i]->root()->type();
+    CodegenAnyVal values[2];
+    for (int j = 0; j < 2; ++j) {
+      ExprContext* ctx = j == 0 ? key_expr_ctxs_lhs_[i] : key_expr_ctxs_rhs_[i];
+      Function* expr_fn;
+      Status status = ctx->root()->GetCodegendComputeFn(state, &expr_fn);
+      if (!status.ok()) {
+        VLOG_QUERY << "Could not codegen TupleRowComparator: " << status.GetErrorMsg();
+        return NULL;
+      }
+      Value* ctx_arg = codegen->CastPtrToLlvmPtr(
+          codegen->GetPtrType(ExprContext::LLVM_CLASS_NAME), ctx);
+      Value* expr_fn_args[] = { ctx_arg, args[j] };
+      values[j] = CodegenAnyVal::CreateCallWrapped(codegen, &builder, type, expr_fn,
+          expr_fn_args, j == 0 ? "lhs_value" : "rhs_value");
+    }
+
+    BasicBlock* null_block = BasicBlock::Create(context, "null", fn);
+    BasicBlock* null_result_block = BasicBlock::Create(context, "null_result", fn);
+    BasicBlock* not_null_block = BasicBlock::Create(context, "not_null", fn);
+    BasicBlock* return_result_block = BasicBlock::Create(context, "return_result", fn);
+    BasicBlock* next_key_block = BasicBlock::Create(context, "next_key", fn);
+
+    // The sort order of NULLs is independent of asc/desc.
+    Value* lhs_is_null = values[0].GetIsNull("lhs_is_null");
+    Value* rhs_is_null = values[1].GetIsNull("rhs_is_null");
+    builder.CreateCondBr(builder.CreateOr(lhs_is_null, rhs_is_null, "either_null"),
+        null_block, not_null_block);
+
+    builder.SetInsertPoint(null_block);
+    builder.CreateCondBr(builder.CreateAnd(lhs_is_null, rhs_is_null, "both_null"),
+        next_key_block, null_result_block);
+
+    builder.SetInsertPoint(null_result_block);
+    builder.CreateRet(builder.CreateSelect(lhs_is_null,
+        codegen->GetIntConstant(TYPE_INT, nulls_first_[i]),
+        codegen->GetIntConstant(TYPE_INT, -nulls_first_[i]), "null_order"));
+
+    builder.SetInsertPoint(not_null_block);
+    Value* result = is_asc_[i] ? values[0].Compare(&values[1]) :
+        values[1].Compare(&values[0]);
+    DCHECK(result != NULL);
+    builder.CreateCondBr(builder.CreateICmpNE(result, zero, "result_ne_zero"),
+        return_result_block, next_key_block);
+
+    builder.SetInsertPoint(return_result_block);
+    builder.CreateRet(result);
+
+    builder.SetInsertPoint(next_key_block);
+  }
+  builder.CreateRet(zero);
+
+  return codegen->FinalizeFunction(fn);
+}
@@ -22,8 +22,14 @@
 #include "runtime/tuple-row.h"
 #include "runtime/descriptors.h"
 
+namespace llvm {
+  class Function;
+}
+
 namespace impala {
 
+class RuntimeState;
+
 class TupleRowComparator {
  public:
   // Compares two TupleRows based on a set of exprs, in order.
@@ -38,7 +44,8 @@ class TupleRowComparator {
       const std::vector<bool>& nulls_first)
       : key_expr_ctxs_lhs_(key_expr_ctxs_lhs),
         key_expr_ctxs_rhs_(key_expr_ctxs_rhs),
-        is_asc_(is_asc) {
+        is_asc_(is_asc),
+        codegend_compare_fn_(NULL) {
     DCHECK_EQ(key_expr_ctxs_lhs.size(), key_expr_ctxs_rhs.size());
     DCHECK_EQ(key_expr_ctxs_lhs.size(), is_asc.size());
     DCHECK_EQ(key_expr_ctxs_lhs.size(), nulls_first.size());
@@ -55,7 +62,8 @@ class TupleRowComparator {
       : key_expr_ctxs_lhs_(key_expr_ctxs_lhs),
         key_expr_ctxs_rhs_(key_expr_ctxs_rhs),
         is_asc_(key_expr_ctxs_lhs.size(), is_asc),
-        nulls_first_(key_expr_ctxs_lhs.size(), nulls_first ? -1 : 1) {
+        nulls_first_(key_expr_ctxs_lhs.size(), nulls_first ? -1 : 1),
+        codegend_compare_fn_(NULL) {
     DCHECK_EQ(key_expr_ctxs_lhs.size(), key_expr_ctxs_rhs.size());
   }
 
@@ -63,6 +71,7 @@ class TupleRowComparator {
   // than rhs, or 0 if they are equal. All exprs (key_exprs_lhs_ and key_exprs_rhs_)
   // must have been prepared and opened before calling this.
   int Compare(TupleRow* lhs, TupleRow* rhs) const {
+    if (codegend_compare_fn_ != NULL) return codegend_compare_fn_(lhs, rhs);
     for (int i = 0; i < key_expr_ctxs_lhs_.size(); ++i) {
       void* lhs_value = key_expr_ctxs_lhs_[i]->GetValue(lhs);
       void* rhs_value = key_expr_ctxs_rhs_[i]->GetValue(rhs);
@@ -96,11 +105,32 @@ class TupleRowComparator {
     return (*this)(lhs_row, rhs_row);
   }
 
+  // Generates the IR for Compare(), with the exprs, types and orders of the keys
+  // folded in, and adds it to the module to be jitted into codegend_compare_fn_, which
+  // Compare() then calls. Returns false if the keys can't be codegen'd.
+  // Must be called after the exprs are prepared and before the module is finalized.
+  // This comparator must live until then; comparators copied from it afterwards call
+  // the jitted function as well.
+  bool Codegen(RuntimeState* state);
+
+  const std::vector<ExprContext*>& key_expr_ctxs_lhs() const {
+    return key_expr_ctxs_lhs_;
+  }
+  const std::vector<bool>& is_asc() const { return is_asc_; }
+  bool nulls_first(int i) const { return nulls_first_[i] < 0; }
+
  private:
+  typedef int (*CompareFn)(TupleRow*, TupleRow*);
+
+  llvm::Function* CodegenCompare(RuntimeState* state);
+
   std::vector<ExprContext*> key_expr_ctxs_lhs_;
   std::vector<ExprContext*> key_expr_ctxs_rhs_;
   std::vector<bool> is_asc_;
   std::vector<int8_t> nulls_first_;
+
+  // Jitted version of Compare(), or NULL if it isn't codegen'd.
+  CompareFn codegend_compare_fn_;
 };
 
 // Compares the equality of two Tuples, going slot by slot.
@@ -482,4 +482,26 @@ functions = [
    '_ZN6impala16UtilityFunctions16FnvHashTimestampEPN10impala_udf15FunctionContextERKNS1_12TimestampValE'],
   [['fnv_hash'], 'BIGINT', ['DECIMAL'],
    '_ZN6impala16UtilityFunctions14FnvHashDecimalEPN10impala_udf15FunctionContextERKNS1_10DecimalValE'],
+
+  # Spatial functions
+  [['point'], 'POINT', ['DOUBLE', 'DOUBLE'],
+   '_ZN6impala16SpatialFunctions9MakePointEPN10impala_udf15FunctionContextERKNS1_9DoubleValES6_'],
+  [['rectangle'], 'RECTANGLE', ['DOUBLE', 'DOUBLE', 'DOUBLE', 'DOUBLE'],
+   '_ZN6impala16SpatialFunctions13MakeRectangleEPN10impala_udf15FunctionContextERKNS1_9DoubleValES6_S6_S6_'],
+  [['st_intersects'], 'BOOLEAN', ['RECTANGLE', 'RECTANGLE'],
+   '_ZN6impala16SpatialFunctions10IntersectsEPN10impala_udf15FunctionContextERKNS1_12RectangleValES6_'],
+  [['st_contains'], 'BOOLEAN', ['RECTANGLE', 'POINT'],
+   '_ZN6impala16SpatialFunctions13ContainsPointEPN10impala_udf15FunctionContextERKNS1_12RectangleValERKNS1_8PointValE'],
+  [['st_contains'], 'BOOLEAN', ['RECTANGLE', 'RECTANGLE'],
+   '_ZN6impala16SpatialFunctions8ContainsEPN10impala_udf15FunctionContextERKNS1_12RectangleValES6_'],
+  [['st_contains'], 'BOOLEAN', ['STRING', 'POINT'],
+   '_ZN6impala16SpatialFunctions20PolygonContainsPointEPN10impala_udf15FunctionContextERKNS1_9StringValERKNS1_8PointValE',
+   '_ZN6impala16SpatialFunctions22PolygonContainsPrepareEPN10impala_udf15FunctionContextENS2_18FunctionStateScopeE',
+   '_ZN6impala16SpatialFunctions20PolygonContainsCloseEPN10impala_udf15FunctionContextENS2_18FunctionStateScopeE'],
+  [['st_within'], 'BOOLEAN', ['RECTANGLE', 'RECTANGLE'],
+   '_ZN6impala16SpatialFunctions6WithinEPN10impala_udf15FunctionContextERKNS1_12RectangleValES6_'],
+  [['st_dwithin'], 'BOOLEAN', ['POINT', 'POINT', 'DOUBLE'],
+   '_ZN6impala16SpatialFunctions7DWithinEPN10impala_udf15FunctionContextERKNS1_8PointValES6_RKNS1_9DoubleValE'],
+  [['st_distance'], 'DOUBLE', ['POINT', 'POINT'],
+   '_ZN6impala16SpatialFunctions8DistanceEPN10impala_udf15FunctionContextERKNS1_8PointValES6_'],
 ]
@@ -48,6 +48,10 @@ struct TDataStreamSink {
 struct THdfsTableSink {
   1: required list<Exprs.TExpr> partition_key_exprs
   2: required bool overwrite
+
+  // Table column positions of the x and y columns to write a spatial index sidecar
+  // (Types.TSpatialIndex) for. Not set if the table has no spatial index.
+  3: optional list<i32> spatial_index_cols
 }
 
 // Union type of all table sinks.
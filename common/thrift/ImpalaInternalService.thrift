@@ -101,6 +101,10 @@ struct TQueryOptions {
   // disastrous query plans. Impala will excercise this option if a query
   // has no plan hints, and at least one table is missing relevant stats.
   29: optional bool disable_unsafe_spills = 0
+
+  // If true, the hash tables of partitioned hash joins and aggregations use open
+  // addressing with hash-tagged buckets instead of chaining.
+  30: optional bool hash_table_open_addressing = 0
 }
 
 // Impala currently has two types of sessions: Beeswax and HiveServer2
@@ -395,6 +399,68 @@ struct TTransmitDataParams {
 struct TTransmitDataResult {
   // required in V1
   1: optional Status.TStatus status
+
+  // Time in ns that the receiver blocked because its buffer was full before it accepted
+  // the row batch.
+  2: optional i64 receiver_wait_time_ns
+}
+
+// UpdateFilter
+
+// A blocked Bloom filter, see util/bloom-filter.h.
+struct TBloomFilter {
+  // log2 of the number of 32-byte buckets
+  1: required i32 log_num_buckets
+
+  // The buckets, 2^log_num_buckets * 32 bytes.
+  2: required binary directory
+}
+
+struct TUpdateFilterParams {
+  1: required ImpalaInternalServiceVersion protocol_version
+
+  // required in V1
+  2: optional Types.TUniqueId query_id
+
+  // Id of the join node that built the filter.
+  // required in V1
+  3: optional Types.TPlanNodeId node_id
+
+  // Probe side slot that the filter applies to.
+  // required in V1
+  4: optional Types.TSlotId slot_id
+
+  // The filter built by the sending fragment instance over its build rows. Not set if
+  // the instance could not build one (e.g. because its build side spilled), which
+  // disables the filter for the whole query.
+  5: optional TBloomFilter bloom_filter
+}
+
+struct TUpdateFilterResult {
+  // required in V1
+  1: optional Status.TStatus status
+}
+
+
+// PublishFilter
+
+struct TPublishFilterParams {
+  1: required ImpalaInternalServiceVersion protocol_version
+
+  // required in V1
+  2: optional Types.TUniqueId dest_fragment_instance_id
+
+  // required in V1
+  3: optional Types.TSlotId slot_id
+
+  // The union of the filters built by all instances of the join.
+  // required in V1
+  4: optional TBloomFilter bloom_filter
+}
+
+struct TPublishFilterResult {
+  // required in V1
+  1: optional Status.TStatus status
 }
 
 // Parameters for RequestPoolService.resolveRequestPool()
@@ -457,4 +523,12 @@ service ImpalaInternalService {
   // Called by sender to transmit single row batch. Returns error indication
   // if params.fragmentId or params.destNodeId are unknown or if data couldn't be read.
   TTransmitDataResult TransmitData(1:TTransmitDataParams params);
+
+  // Called by a fragment instance to send the runtime filter built by one of its joins
+  // to the coord. Once all instances of the join's fragment have sent theirs, the coord
+  // publishes their union to the fragment instances scanning the filtered slot.
+  TUpdateFilterResult UpdateFilter(1:TUpdateFilterParams params);
+
+  // Called by coord to deliver a runtime filter to a fragment instance.
+  TPublishFilterResult PublishFilter(1:TPublishFilterParams params);
 }
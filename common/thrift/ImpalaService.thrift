@@ -157,7 +157,11 @@ enum TImpalaQueryOptions {
   // If true, allows Impala to internally disable spilling for potentially
   // disastrous query plans. Impala will excercise this option if a query
   // has no plan hints, and at least one table is missing relevant stats.
-  DISABLE_UNSAFE_SPILLS
+  DISABLE_UNSAFE_SPILLS,
+
+  // If true, the hash tables of partitioned hash joins and aggregations use open
+  // addressing with hash-tagged buckets instead of chaining.
+  HASH_TABLE_OPEN_ADDRESSING
 }
 
 // The summary of an insert.
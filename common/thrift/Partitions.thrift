@@ -16,6 +16,7 @@ namespace cpp impala
 namespace java com.cloudera.impala.thrift
 
 include "Exprs.thrift"
+include "Types.thrift"
 
 enum TPartitionType {
   UNPARTITIONED,
@@ -29,7 +30,12 @@ enum TPartitionType {
 
   // ordered partition on a list of exprs
   // (partition bounds don't overlap)
-  RANGE_PARTITIONED
+  RANGE_PARTITIONED,
+
+  // partition on the cells of a spatial grid that the MBR of a single RECTANGLE or
+  // POINT expr overlaps; a row is sent to every partition owning one of those cells
+  // (partitions overlap)
+  SPATIAL_PARTITIONED
 }
 
 // Specification of how a single logical data stream is partitioned.
@@ -39,4 +45,7 @@ enum TPartitionType {
 struct TDataPartition {
   1: required TPartitionType type
   2: optional list<Exprs.TExpr> partition_exprs
+
+  // Set for SPATIAL_PARTITIONED. Cell i is owned by partition i % <#partitions>.
+  3: optional Types.TSpatialGrid spatial_grid
 }
@@ -39,7 +39,9 @@ enum TPlanNodeType {
   SELECT_NODE,
   CROSS_JOIN_NODE,
   DATA_SOURCE_NODE,
-  ANALYTIC_EVAL_NODE
+  ANALYTIC_EVAL_NODE,
+  SPATIAL_JOIN_NODE,
+  KNN_NODE
 }
 
 // phases of an execution node
@@ -84,6 +86,9 @@ struct THdfsFileSplit {
 
   // compression type of the hdfs file
   6: required CatalogObjects.THdfsCompression file_compression
+
+  // last modification time of the hdfs file, in milliseconds
+  7: optional i64 file_mtime
 }
 
 // key range for single THBaseScanNode
@@ -105,8 +110,32 @@ struct TScanRange {
   2: optional THBaseKeyRange hbase_key_range
 }
 
+// Window of a scan over a table with a spatial index. Files and splits whose indexed
+// points all lie outside of the window are not scanned.
+struct THdfsSpatialFilter {
+  // Table column positions of the indexed x and y columns.
+  1: required list<i32> index_cols
+  2: required Types.TRectangle window
+}
+
+// Query point of a k-nearest-neighbour search over a table with a spatial index. Files
+// are scanned in order of the minimum distance of their indexed MBR to the query point,
+// and files that can't hold a row closer than the current k-th nearest one are skipped.
+struct THdfsKnnFilter {
+  // Table column positions of the indexed x and y columns.
+  1: required list<i32> index_cols
+  2: required double query_x
+  3: required double query_y
+}
+
 struct THdfsScanNode {
   1: required Types.TTupleId tuple_id
+
+  // Set if the table has a spatial index and the conjuncts bound the indexed columns.
+  2: optional THdfsSpatialFilter spatial_filter
+
+  // Set if the scan feeds a KnnNode on the table's indexed columns.
+  3: optional THdfsKnnFilter knn_filter
 }
 
 struct TDataSourceScanNode {
@@ -183,6 +212,11 @@ struct THashJoinNode {
   // If true, this join node can (but may choose not to) generate slot filters
   // after constructing the build side that can be applied to the probe side.
   4: optional bool add_probe_filters
+
+  // True if both inputs are hash partitioned between the instances of the join, so
+  // that each instance builds on a share of the build rows. Otherwise the build input
+  // is broadcast to all instances.
+  5: optional bool is_partitioned
 }
 
 struct TAggregationNode {
@@ -262,6 +296,40 @@ struct TAnalyticWindow {
   3: optional TAnalyticWindowBoundary window_end
 }
 
+struct TSpatialJoinNode {
+  // RECTANGLE-typed exprs computing the MBR of the left (probe) and right (build) rows.
+  // The join condition is that the two MBRs intersect.
+  1: required Exprs.TExpr probe_expr
+  2: required Exprs.TExpr build_expr
+
+  // Grid that both inputs are partitioned on. Each row is joined in every cell its MBR
+  // overlaps; a result pair is only returned from the cell containing the lower-left
+  // corner of the intersection of the two MBRs (the reference point).
+  3: required Types.TSpatialGrid grid
+
+  // If true, both inputs are spatially partitioned across the instances of this fragment
+  // and an instance only joins the cells assigned to it, i.e. the cells with
+  // cell_id % num_fragment_instances == fragment_instance_idx.
+  4: required bool is_partitioned
+}
+
+// Returns the 'limit' input rows whose (x, y) coordinates are nearest to the query
+// point, in order of increasing distance. Rows with a NULL or NaN coordinate are
+// infinitely far away.
+struct TKnnNode {
+  // DOUBLE-typed exprs computing the coordinates of an input row.
+  1: required Exprs.TExpr x_expr
+  2: required Exprs.TExpr y_expr
+
+  3: required double query_x
+  4: required double query_y
+
+  // If set, the id of an HdfsScanNode in the subtree of this node that has a
+  // THdfsKnnFilter on the same coordinates. The distance of the current k-th nearest
+  // row is passed to that scan so that it can skip files that are farther away.
+  5: optional Types.TPlanNodeId pruned_scan_node_id
+}
+
 // Defines a group of one or more analytic functions that share the same window,
 // partitioning expressions and order-by expressions and are evaluated by a single
 // ExecNode.
@@ -357,6 +425,8 @@ struct TPlanNode {
   14: optional TUnionNode union_node
   15: optional TExchangeNode exchange_node
   20: optional TAnalyticNode analytic_node
+  21: optional TSpatialJoinNode spatial_join_node
+  22: optional TKnnNode knn_node
 
   // Label that should be used to print this node to the user.
   17: optional string label
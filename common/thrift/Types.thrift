@@ -40,7 +40,11 @@ enum TPrimitiveType {
   DECIMAL,
   // CHAR(n). Currently only supported in UDAs
   CHAR,
-  VARCHAR
+  VARCHAR,
+  // Fixed-width spatial types. POINT is (x, y) and RECTANGLE is (x1, y1, x2, y2), both
+  // stored as packed doubles.
+  POINT,
+  RECTANGLE
 }
 
 enum TTypeNodeType {
@@ -88,6 +92,48 @@ struct TColumnType {
   1: list<TTypeNode> types
 }
 
+// A grid of num_cols x num_rows cells covering the rectangle (x1, y1) - (x2, y2).
+// Spatial operators use it to split the plane into cells that can be processed
+// independently. The cells are uniform. Coordinates outside of the rectangle belong to
+// the nearest edge cell.
+struct TSpatialGrid {
+  1: required double x1
+  2: required double y1
+  3: required double x2
+  4: required double y2
+  5: required i32 num_cols
+  6: required i32 num_rows
+}
+
+// A rectangle with lower-left corner (x1, y1) and upper-right corner (x2, y2).
+struct TRectangle {
+  1: required double x1
+  2: required double y1
+  3: required double x2
+  4: required double y2
+}
+
+// The MBR of the rows that start in the byte range [offset, offset + length) of a file.
+struct TSpatialIndexEntry {
+  1: required i64 offset
+  2: required i64 length
+  3: required TRectangle mbr
+}
+
+// Contents of the spatial index sidecar of an HDFS data file. The index covers the
+// points formed by two DOUBLE columns of the table (index_cols are their positions in
+// the table schema). 'mbr' bounds all indexed points of the file and there is one entry
+// per block of rows, e.g. per Parquet row group. Rows with a NULL coordinate are not
+// covered by the index. The length and last modification time (in seconds) of the
+// data file when the index was written let readers detect a file that was replaced.
+struct TSpatialIndex {
+  1: required list<i32> index_cols
+  2: required TRectangle mbr
+  3: required list<TSpatialIndexEntry> entries
+  4: optional i64 data_file_length
+  5: optional i64 data_file_mtime
+}
+
 enum TStmtType {
   QUERY,
   DDL, // Data definition, e.g. CREATE TABLE (includes read-only functions e.g. SHOW)
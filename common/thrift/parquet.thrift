@@ -97,13 +97,24 @@ enum FieldRepetitionType {
  * All fields are optional.
  */
 struct Statistics {
-   /** min and max value of the column, encoded in PLAIN encoding */
+   /**
+    * DEPRECATED: min and max value of the column, encoded in PLAIN encoding. Some
+    * writers compared binary values as signed bytes, so these are only meaningful for
+    * numeric types. Use min_value and max_value instead.
+    */
    1: optional binary max;
    2: optional binary min;
    /** count of null value in the column */
    3: optional i64 null_count;
    /** count of distinct values occurring */
    4: optional i64 distinct_count;
+   /**
+    * Min and max value of the column, ordered by its logical type, i.e. binary values
+    * as unsigned bytes. Encoded in PLAIN encoding, except that binary values have no
+    * length prefix.
+    */
+   5: optional binary max_value;
+   6: optional binary min_value;
 }
 
 /**
@@ -242,8 +242,9 @@ terminal
   KW_INVALIDATE, KW_IS, KW_JOIN, KW_LAST, KW_LEFT, KW_LIKE, KW_LIMIT, KW_LINES, KW_LOAD,
   KW_LOCATION, KW_MAP, KW_MERGE_FN, KW_METADATA, KW_NOT, KW_NULL, KW_NULLS, KW_OFFSET,
   KW_ON, KW_OR, KW_ORDER, KW_OUTER, KW_OVER, KW_OVERWRITE, KW_PARQUET, KW_PARQUETFILE,
-  KW_PARTITION, KW_PARTITIONED, KW_PARTITIONS, KW_PRECEDING,
-  KW_PREPARE_FN, KW_PRODUCED, KW_RANGE, KW_RCFILE, KW_REFRESH, KW_REGEXP, KW_RENAME,
+  KW_PARTITION, KW_PARTITIONED, KW_PARTITIONS, KW_POINT, KW_PRECEDING,
+  KW_PREPARE_FN, KW_PRODUCED, KW_RANGE, KW_RCFILE, KW_RECTANGLE, KW_REFRESH, KW_REGEXP,
+  KW_RENAME,
   KW_REPLACE, KW_RETURNS, KW_REVOKE, KW_RIGHT, KW_RLIKE, KW_ROLE, KW_ROLES, KW_ROW,
   KW_ROWS, KW_SCHEMA, KW_SCHEMAS, KW_SELECT, KW_SEMI, KW_SEQUENCEFILE, KW_SERDEPROPERTIES,
   KW_SERIALIZE_FN, KW_SET, KW_SHOW, KW_SMALLINT, KW_STORED, KW_STRAIGHT_JOIN,
@@ -2067,6 +2068,11 @@ non_pred_expr ::=
   /* Since "IF" is a keyword, need to special case this function */
   | KW_IF LPAREN expr_list:exprs RPAREN
   {: RESULT = new FunctionCallExpr("if", exprs); :}
+  /* The constructors of the spatial types are named like their (keyword) types */
+  | KW_POINT LPAREN expr_list:exprs RPAREN
+  {: RESULT = new FunctionCallExpr("point", exprs); :}
+  | KW_RECTANGLE LPAREN expr_list:exprs RPAREN
+  {: RESULT = new FunctionCallExpr("rectangle", exprs); :}
   | cast_expr:c
   {: RESULT = c; :}
   | case_expr:c
@@ -2412,6 +2418,10 @@ type ::=
   {: RESULT = ScalarType.createDecimalType(precision.intValue(), scale.intValue()); :}
   | KW_DECIMAL
   {: RESULT = ScalarType.createDecimalType(); :}
+  | KW_POINT
+  {: RESULT = Type.POINT; :}
+  | KW_RECTANGLE
+  {: RESULT = Type.RECTANGLE; :}
   | KW_ARRAY LESSTHAN type:value_type GREATERTHAN
   {: RESULT = new ArrayType(value_type); :}
   | KW_MAP LESSTHAN type:key_type COMMA type:value_type GREATERTHAN
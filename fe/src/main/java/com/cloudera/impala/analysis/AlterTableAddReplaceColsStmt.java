@@ -88,6 +88,7 @@ public class AlterTableAddReplaceColsStmt extends AlterTableStmt {
     Set<String> colNames = Sets.newHashSet();
     for (ColumnDesc c: columnDefs_) {
       c.analyze();
+      c.checkIsStorable();
       analyzer.warnIfUnsupportedType(c.getType());
       String colName = c.getColName().toLowerCase();
       if (existingPartitionKeys.contains(colName)) {
@@ -88,6 +88,7 @@ public class AlterTableChangeColStmt extends AlterTableStmt {
 
     // Check that the new column def's name is valid.
     newColDef_.analyze();
+    newColDef_.checkIsStorable();
     analyzer.warnIfUnsupportedType(newColDef_.getType());
     // Verify that if the column name is being changed, the new name doesn't conflict
     // with an existing column.
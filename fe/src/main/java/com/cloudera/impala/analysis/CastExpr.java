@@ -91,6 +91,12 @@ public class CastExpr extends Expr {
         if (toType.isNull()) continue;
         // Disable casting from string to boolean
         if (fromType.isStringType() && toType.isBoolean()) continue;
+        // Spatial types can only be cast from and to their text form.
+        if ((fromType.isSpatialType() || toType.isSpatialType())
+            && !fromType.isScalarType(PrimitiveType.STRING)
+            && !toType.isScalarType(PrimitiveType.STRING)) {
+          continue;
+        }
         // Disable casting from boolean/timestamp to decimal
         if ((fromType.isBoolean() || fromType.isDateType()) && toType.isDecimal()) {
           continue;
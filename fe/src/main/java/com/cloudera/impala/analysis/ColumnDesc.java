@@ -53,6 +53,17 @@ public class ColumnDesc {
     type_.analyze();
   }
 
+  /**
+   * Checks that this column can be part of a table. Values of the spatial types only
+   * exist within queries, since no table format can store them.
+   */
+  public void checkIsStorable() throws AnalysisException {
+    if (type_.isSpatialType()) {
+      throw new AnalysisException(String.format(
+          "Type %s is not supported for table columns: %s", type_.toSql(), colName_));
+    }
+  }
+
   @Override
   public String toString() {
     StringBuilder sb = new StringBuilder(colName_);
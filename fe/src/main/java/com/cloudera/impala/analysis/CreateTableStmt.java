@@ -234,6 +234,7 @@ public class CreateTableStmt extends StatementBase {
     Set<String> colNames = Sets.newHashSet();
     for (ColumnDesc colDef: columnDefs_) {
       colDef.analyze();
+      colDef.checkIsStorable();
       analyzer.warnIfUnsupportedType(colDef.getType());
       if (!colNames.add(colDef.getColName().toLowerCase())) {
         throw new AnalysisException("Duplicate column name: " + colDef.getColName());
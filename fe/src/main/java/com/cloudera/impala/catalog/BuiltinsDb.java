@@ -715,6 +715,45 @@ public class BuiltinsDb extends Db {
             "20StringConcatFinalizeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
         false, false, false));
 
+    // St_extent(rectangle), st_extent(point)
+    final String extentUpdate = prefix +
+        "12ExtentUpdateEPN10impala_udf15FunctionContextERKNS1_12RectangleValEPS4_";
+    db.addBuiltin(AggregateFunction.createBuiltin(db, "st_extent",
+        Lists.<Type>newArrayList(Type.RECTANGLE), Type.RECTANGLE, Type.RECTANGLE,
+        initNull, extentUpdate, extentUpdate, null, null, true, false, false));
+    db.addBuiltin(AggregateFunction.createBuiltin(db, "st_extent",
+        Lists.<Type>newArrayList(Type.POINT), Type.RECTANGLE, Type.RECTANGLE, initNull,
+        prefix + "17PointExtentUpdateEPN10impala_udf15FunctionContextERKNS1_8PointVal" +
+            "EPNS1_12RectangleValE",
+        extentUpdate, null, null, true, false, false));
+
+    // St_grid_histogram(point, rectangle bounds, int num_cols, int num_rows)
+    db.addBuiltin(AggregateFunction.createBuiltin(db, "st_grid_histogram",
+        Lists.<Type>newArrayList(Type.POINT, Type.RECTANGLE, Type.INT, Type.INT),
+        Type.STRING, Type.STRING,
+        prefix + "17GridHistogramInitEPN10impala_udf15FunctionContextEPNS1_9StringValE",
+        prefix + "19GridHistogramUpdateEPN10impala_udf15FunctionContextERKNS1_8PointVal" +
+            "ERKNS1_12RectangleValERKNS1_6IntValESC_PNS1_9StringValE",
+        prefix +
+            "18GridHistogramMergeEPN10impala_udf15FunctionContextERKNS1_9StringValEPS4_",
+        stringValSerializeOrFinalize,
+        prefix +
+            "21GridHistogramFinalizeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
+        false, false, false));
+
+    // St_quadtree_sketch(point, rectangle bounds)
+    db.addBuiltin(AggregateFunction.createBuiltin(db, "st_quadtree_sketch",
+        Lists.<Type>newArrayList(Type.POINT, Type.RECTANGLE), Type.STRING, Type.STRING,
+        prefix + "18QuadtreeSketchInitEPN10impala_udf15FunctionContextEPNS1_9StringValE",
+        prefix + "20QuadtreeSketchUpdateEPN10impala_udf15FunctionContextERKNS1_8PointVal" +
+            "ERKNS1_12RectangleValEPNS1_9StringValE",
+        prefix +
+            "19QuadtreeSketchMergeEPN10impala_udf15FunctionContextERKNS1_9StringValEPS4_",
+        stringValSerializeOrFinalize,
+        prefix +
+            "22QuadtreeSketchFinalizeEPN10impala_udf15FunctionContextERKNS1_9StringValE",
+        false, false, false));
+
     // analytic functions
     // Rank
     db.addBuiltin(AggregateFunction.createAnalyticBuiltin(db, "rank",
@@ -393,6 +393,10 @@ public class Function implements CatalogObject {
       return "TimestampVal";
     case DECIMAL:
       return "DecimalVal";
+    case POINT:
+      return "PointVal";
+    case RECTANGLE:
+      return "RectangleVal";
     default:
       Preconditions.checkState(false, t.toString());
       return "";
@@ -97,6 +97,11 @@ public class HdfsTable extends Table {
   // hive's default value for table property 'serialization.null.format'
   private static final String DEFAULT_NULL_COLUMN_VALUE = "\\N";
 
+  // Table property naming the x and y columns, e.g. "lon,lat", that INSERTs build a
+  // spatial index sidecar for. Both must be non-partition DOUBLE columns.
+  public static final String TBL_PROP_SPATIAL_INDEX_COLUMNS =
+      "impala.spatial.index.columns";
+
   // Number of times to retry fetching the partitions from the HMS should an error occur.
   private final static int NUM_PARTITION_FETCH_RETRIES = 5;;
 
@@ -355,6 +360,30 @@ public class HdfsTable extends Table {
   }
   public boolean isMarkedCached() { return isMarkedCached_; }
 
+  /**
+   * Returns the positions of the x and y columns of this table's spatial index, or null
+   * if TBL_PROP_SPATIAL_INDEX_COLUMNS is not set or doesn't name two non-partition
+   * DOUBLE columns.
+   */
+  public List<Integer> getSpatialIndexColumns() {
+    if (getMetaStoreTable() == null || getMetaStoreTable().getParameters() == null) {
+      return null;
+    }
+    String colNames =
+        getMetaStoreTable().getParameters().get(TBL_PROP_SPATIAL_INDEX_COLUMNS);
+    if (colNames == null) return null;
+    String[] names = colNames.split(",");
+    if (names.length != 2) return null;
+    List<Integer> positions = Lists.newArrayList();
+    for (String name: names) {
+      Column col = getColumn(name.trim());
+      if (col == null || col.getPosition() < getNumClusteringCols()) return null;
+      if (!col.getType().equals(Type.DOUBLE)) return null;
+      positions.add(col.getPosition());
+    }
+    return positions;
+  }
+
   public HashMap<Long, HdfsPartition> getPartitionMap() { return partitionMap_; }
   public HashSet<Long> getNullPartitionIds(int i) { return nullPartitionIds_.get(i); }
   public HashSet<Long> getPartitionIds() { return partitionIds_; }
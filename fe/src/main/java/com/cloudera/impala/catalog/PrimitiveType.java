@@ -47,7 +47,11 @@ public enum PrimitiveType {
   DECIMAL("DECIMAL", 16, TPrimitiveType.DECIMAL),
 
   // Fixed length char array.
-  CHAR("CHAR", -1, TPrimitiveType.CHAR);
+  CHAR("CHAR", -1, TPrimitiveType.CHAR),
+
+  // Spatial types, stored as packed doubles: (x, y) and (x1, y1, x2, y2).
+  POINT("POINT", 16, TPrimitiveType.POINT),
+  RECTANGLE("RECTANGLE", 32, TPrimitiveType.RECTANGLE);
 
   private final String description_;
   private final int slotSize_;  // size of tuple slot for this type
@@ -81,6 +85,8 @@ public enum PrimitiveType {
       case CHAR: return CHAR;
       case DECIMAL: return DECIMAL;
       case BINARY: return BINARY;
+      case POINT: return POINT;
+      case RECTANGLE: return RECTANGLE;
     }
     return INVALID_TYPE;
   }
@@ -96,5 +102,5 @@ public enum PrimitiveType {
   }
 
   public int getSlotSize() { return slotSize_; }
-  public static int getMaxSlotSize() { return DECIMAL.slotSize_; }
+  public static int getMaxSlotSize() { return RECTANGLE.slotSize_; }
 }
@@ -70,6 +70,8 @@ public class ScalarType extends Type {
       case DATE: return DATE;
       case DATETIME: return DATETIME;
       case DECIMAL: return (ScalarType) createDecimalType();
+      case POINT: return POINT;
+      case RECTANGLE: return RECTANGLE;
       default:
         Preconditions.checkState(false);
         return NULL;
@@ -298,7 +300,8 @@ public class ScalarType extends Type {
 
   @Override
   public boolean supportsTablePartitioning() {
-    if (!isSupported() || isComplexType() || type_ == PrimitiveType.TIMESTAMP) {
+    if (!isSupported() || isComplexType() || isSpatialType()
+        || type_ == PrimitiveType.TIMESTAMP) {
       return false;
     }
     return true;
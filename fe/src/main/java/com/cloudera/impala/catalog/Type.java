@@ -66,6 +66,8 @@ public abstract class Type {
   public static final ScalarType DEFAULT_VARCHAR = ScalarType.createVarcharType(-1);
   public static final ScalarType VARCHAR = ScalarType.createVarcharType(-1);
   public static final ScalarType CHAR = (ScalarType) ScalarType.createCharType(-1);
+  public static final ScalarType POINT = new ScalarType(PrimitiveType.POINT);
+  public static final ScalarType RECTANGLE = new ScalarType(PrimitiveType.RECTANGLE);
 
   private static ArrayList<ScalarType> integerTypes;
   private static ArrayList<ScalarType> numericTypes;
@@ -101,6 +103,8 @@ public abstract class Type {
     supportedTypes.add(CHAR);
     supportedTypes.add(TIMESTAMP);
     supportedTypes.add(DECIMAL);
+    supportedTypes.add(POINT);
+    supportedTypes.add(RECTANGLE);
   }
 
   public static ArrayList<ScalarType> getIntegerTypes() {
@@ -172,6 +176,10 @@ public abstract class Type {
         || isScalarType(PrimitiveType.TIMESTAMP);
   }
 
+  public boolean isSpatialType() {
+    return isScalarType(PrimitiveType.POINT) || isScalarType(PrimitiveType.RECTANGLE);
+  }
+
   public boolean isComplexType() { return isStructType() || isCollectionType(); }
   public boolean isCollectionType() { return isMapType() || isArrayType(); }
   public boolean isMapType() { return this instanceof MapType; }
@@ -508,7 +516,7 @@ public abstract class Type {
   protected static PrimitiveType[][] compatibilityMatrix;
   static {
     compatibilityMatrix = new
-        PrimitiveType[CHAR.ordinal() + 1][CHAR.ordinal() + 1];
+        PrimitiveType[RECTANGLE.ordinal() + 1][RECTANGLE.ordinal() + 1];
 
     // NULL_TYPE is compatible with any type and results in the non-null type.
     compatibilityMatrix[NULL.ordinal()][NULL.ordinal()] = PrimitiveType.NULL_TYPE;
@@ -647,5 +655,14 @@ public abstract class Type {
     compatibilityMatrix[VARCHAR.ordinal()][CHAR.ordinal()] = PrimitiveType.INVALID_TYPE;
 
     compatibilityMatrix[CHAR.ordinal()][CHAR.ordinal()] = PrimitiveType.CHAR;
+
+    // Spatial types are only compatible with themselves and NULL.
+    for (ScalarType t: new ScalarType[] {POINT, RECTANGLE}) {
+      for (int i = 0; i < t.ordinal(); ++i) {
+        compatibilityMatrix[i][t.ordinal()] = PrimitiveType.INVALID_TYPE;
+      }
+      compatibilityMatrix[NULL.ordinal()][t.ordinal()] = t.getPrimitiveType();
+      compatibilityMatrix[t.ordinal()][t.ordinal()] = t.getPrimitiveType();
+    }
   }
 }
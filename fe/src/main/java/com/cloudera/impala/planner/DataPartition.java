@@ -22,8 +22,10 @@ import org.slf4j.LoggerFactory;
 import com.cloudera.impala.analysis.Analyzer;
 import com.cloudera.impala.analysis.Expr;
 import com.cloudera.impala.analysis.ExprSubstitutionMap;
+import com.cloudera.impala.catalog.PrimitiveType;
 import com.cloudera.impala.thrift.TDataPartition;
 import com.cloudera.impala.thrift.TPartitionType;
+import com.cloudera.impala.thrift.TSpatialGrid;
 import com.google.common.base.Joiner;
 import com.google.common.base.Objects;
 import com.google.common.base.Preconditions;
@@ -44,6 +46,9 @@ public class DataPartition {
   // for hash partition: exprs used to compute hash value
   private List<Expr> partitionExprs_;
 
+  // for spatial partition: the grid whose cells are assigned to partitions
+  private final TSpatialGrid spatialGrid_;
+
   public DataPartition(TPartitionType type, List<Expr> exprs) {
     Preconditions.checkNotNull(exprs);
     Preconditions.checkState(!exprs.isEmpty());
@@ -51,6 +56,7 @@ public class DataPartition {
         || type == TPartitionType.RANGE_PARTITIONED);
     type_ = type;
     partitionExprs_ = exprs;
+    spatialGrid_ = null;
   }
 
   public DataPartition(TPartitionType type) {
@@ -58,6 +64,21 @@ public class DataPartition {
         || type == TPartitionType.RANDOM);
     type_ = type;
     partitionExprs_ = Lists.newArrayList();
+    spatialGrid_ = null;
+  }
+
+  /**
+   * Creates a SPATIAL_PARTITIONED partition. 'mbrExpr' returns a RECTANGLE or POINT;
+   * each row is sent to the owners of all cells of 'grid' that it overlaps.
+   */
+  public DataPartition(Expr mbrExpr, TSpatialGrid grid) {
+    Preconditions.checkNotNull(mbrExpr);
+    Preconditions.checkNotNull(grid);
+    Preconditions.checkState(mbrExpr.getType().isScalarType(PrimitiveType.POINT)
+        || mbrExpr.getType().isScalarType(PrimitiveType.RECTANGLE));
+    type_ = TPartitionType.SPATIAL_PARTITIONED;
+    partitionExprs_ = Lists.newArrayList(mbrExpr);
+    spatialGrid_ = grid;
   }
 
   public final static DataPartition UNPARTITIONED =
@@ -70,6 +91,17 @@ public class DataPartition {
   public boolean isHashPartitioned() { return type_ == TPartitionType.HASH_PARTITIONED; }
   public TPartitionType getType() { return type_; }
   public List<Expr> getPartitionExprs() { return partitionExprs_; }
+  public TSpatialGrid getSpatialGrid() { return spatialGrid_; }
+
+  /**
+   * Returns a grid of numCols x numRows uniform cells covering (x1, y1) - (x2, y2).
+   */
+  public static TSpatialGrid createSpatialGrid(double x1, double y1, double x2,
+      double y2, int numCols, int numRows) {
+    Preconditions.checkState(x1 < x2 && y1 < y2);
+    Preconditions.checkState(numCols > 0 && numRows > 0);
+    return new TSpatialGrid(x1, y1, x2, y2, numCols, numRows);
+  }
 
   public void substitute(ExprSubstitutionMap smap, Analyzer analyzer) {
     partitionExprs_ = Expr.substituteList(partitionExprs_, smap, analyzer);
@@ -80,6 +112,7 @@ public class DataPartition {
     if (partitionExprs_ != null) {
       result.setPartition_exprs(Expr.treesToThrift(partitionExprs_));
     }
+    if (spatialGrid_ != null) result.setSpatial_grid(spatialGrid_);
     return result;
   }
 
@@ -89,6 +122,7 @@ public class DataPartition {
     if (obj.getClass() != this.getClass()) return false;
     DataPartition other = (DataPartition) obj;
     if (type_ != other.type_) return false;
+    if (!Objects.equal(spatialGrid_, other.spatialGrid_)) return false;
     return Expr.equalLists(partitionExprs_, other.partitionExprs_);
   }
 
@@ -117,6 +151,7 @@ public class DataPartition {
       case RANDOM: return "RANDOM";
       case HASH_PARTITIONED: return "HASH";
       case RANGE_PARTITIONED: return "RANGE";
+      case SPATIAL_PARTITIONED: return "SPATIAL";
       case UNPARTITIONED: return "UNPARTITIONED";
       default: return "";
     }
@@ -334,6 +334,7 @@ public class HashJoinNode extends PlanNode {
       msg.hash_join_node.addToOther_join_conjuncts(e.treeToThrift());
     }
     msg.hash_join_node.setAdd_probe_filters(addProbeFilters_);
+    msg.hash_join_node.setIs_partitioned(distrMode_ == DistributionMode.PARTITIONED);
   }
 
   @Override
@@ -34,6 +34,7 @@ import com.cloudera.impala.analysis.Expr;
 import com.cloudera.impala.analysis.InPredicate;
 import com.cloudera.impala.analysis.IsNullPredicate;
 import com.cloudera.impala.analysis.LiteralExpr;
+import com.cloudera.impala.analysis.NumericLiteral;
 import com.cloudera.impala.analysis.SlotDescriptor;
 import com.cloudera.impala.analysis.SlotId;
 import com.cloudera.impala.analysis.SlotRef;
@@ -50,11 +51,14 @@ import com.cloudera.impala.common.RuntimeEnv;
 import com.cloudera.impala.thrift.TExplainLevel;
 import com.cloudera.impala.thrift.THdfsFileBlock;
 import com.cloudera.impala.thrift.THdfsFileSplit;
+import com.cloudera.impala.thrift.THdfsKnnFilter;
 import com.cloudera.impala.thrift.THdfsScanNode;
+import com.cloudera.impala.thrift.THdfsSpatialFilter;
 import com.cloudera.impala.thrift.TNetworkAddress;
 import com.cloudera.impala.thrift.TPlanNode;
 import com.cloudera.impala.thrift.TPlanNodeType;
 import com.cloudera.impala.thrift.TQueryOptions;
+import com.cloudera.impala.thrift.TRectangle;
 import com.cloudera.impala.thrift.TScanRange;
 import com.cloudera.impala.thrift.TScanRangeLocation;
 import com.cloudera.impala.thrift.TScanRangeLocations;
@@ -96,6 +100,14 @@ public class HdfsScanNode extends ScanNode {
   // Total number of bytes from partitions_
   private long totalBytes_ = 0;
 
+  // Set if the table has a spatial index and the conjuncts bound its columns. The BE
+  // skips files and splits whose indexed points all lie outside of the window.
+  private THdfsSpatialFilter spatialFilter_ = null;
+
+  // Set if this scan feeds a KnnNode on the columns of the table's spatial index. The
+  // BE scans the nearest files first and skips files that can't hold a nearer row.
+  private THdfsKnnFilter knnFilter_ = null;
+
   /**
    * Constructs node to scan given data files of table 'tbl_'.
    */
@@ -129,6 +141,7 @@ public class HdfsScanNode extends ScanNode {
     // do partition pruning before deciding which slots to materialize,
     // we might end up removing some predicates
     prunePartitions(analyzer);
+    computeSpatialFilter();
 
     // mark all slots referenced by the remaining conjuncts as materialized
     markSlotsMaterialized(analyzer, conjuncts_);
@@ -144,6 +157,78 @@ public class HdfsScanNode extends ScanNode {
     assignedConjuncts_ = analyzer.getAssignedConjuncts();
   }
 
+  /**
+   * Sets spatialFilter_ from the conjuncts of the form "<col> op <numeric literal>" on the
+   * x and y columns of the table's spatial index. Strict and non-strict bounds are
+   * treated alike, so the window contains all rows that pass the conjuncts.
+   */
+  private void computeSpatialFilter() {
+    List<Integer> indexCols = tbl_.getSpatialIndexColumns();
+    if (indexCols == null) return;
+    double[] lower = { Double.NEGATIVE_INFINITY, Double.NEGATIVE_INFINITY };
+    double[] upper = { Double.POSITIVE_INFINITY, Double.POSITIVE_INFINITY };
+    boolean isBounded = false;
+    for (Expr conjunct: conjuncts_) {
+      if (!(conjunct instanceof BinaryPredicate)) continue;
+      BinaryPredicate pred = (BinaryPredicate) conjunct;
+      if (pred.getOp() == Operator.NULL_MATCHING_EQ) continue;
+      SlotRef slot = pred.getChild(0).unwrapSlotRef(true);
+      Expr bound = pred.getChild(1);
+      Operator op = pred.getOp();
+      if (slot == null) {
+        slot = pred.getChild(1).unwrapSlotRef(true);
+        bound = pred.getChild(0);
+        op = op.converse();
+      }
+      if (slot == null || !(bound instanceof NumericLiteral)) continue;
+      Column col = slot.getDesc().getColumn();
+      if (col == null) continue;
+      int dim = indexCols.indexOf(col.getPosition());
+      if (dim == -1) continue;
+      double value = ((NumericLiteral) bound).getDoubleValue();
+      switch (op) {
+        case EQ:
+          lower[dim] = Math.max(lower[dim], value);
+          upper[dim] = Math.min(upper[dim], value);
+          break;
+        case GE:
+        case GT:
+          lower[dim] = Math.max(lower[dim], value);
+          break;
+        case LE:
+        case LT:
+          upper[dim] = Math.min(upper[dim], value);
+          break;
+        default:
+          continue;
+      }
+      isBounded = true;
+    }
+    if (!isBounded) return;
+    spatialFilter_ = new THdfsSpatialFilter(indexCols,
+        new TRectangle(lower[0], lower[1], upper[0], upper[1]));
+  }
+
+  /**
+   * Sets knnFilter_ if 'xExpr' and 'yExpr' are the x and y columns of the table's
+   * spatial index. Returns true if the filter was set.
+   */
+  public boolean setKnnFilter(Expr xExpr, Expr yExpr, double queryX, double queryY) {
+    List<Integer> indexCols = tbl_.getSpatialIndexColumns();
+    if (indexCols == null) return false;
+    SlotRef xSlot = xExpr.unwrapSlotRef(true);
+    SlotRef ySlot = yExpr.unwrapSlotRef(true);
+    if (xSlot == null || ySlot == null) return false;
+    Column xCol = xSlot.getDesc().getColumn();
+    Column yCol = ySlot.getDesc().getColumn();
+    if (xCol == null || yCol == null) return false;
+    if (xCol.getPosition() != indexCols.get(0) || yCol.getPosition() != indexCols.get(1)) {
+      return false;
+    }
+    knnFilter_ = new THdfsKnnFilter(indexCols, queryX, queryY);
+    return true;
+  }
+
   /**
    * Computes scan ranges (hdfs splits) plus their storage locations, including volume
    * ids, based on the given maximum number of bytes each scan range should scan.
@@ -187,9 +272,11 @@ public class HdfsScanNode extends ScanNode {
               currentLength = maxScanRangeLength;
             }
             TScanRange scanRange = new TScanRange();
-            scanRange.setHdfs_file_split(new THdfsFileSplit(
+            THdfsFileSplit fileSplit = new THdfsFileSplit(
                 fileDesc.getFileName(), currentOffset, currentLength, partition.getId(),
-                fileDesc.getFileLength(), fileDesc.getFileCompression()));
+                fileDesc.getFileLength(), fileDesc.getFileCompression());
+            fileSplit.setFile_mtime(fileDesc.getModificationTime());
+            scanRange.setHdfs_file_split(fileSplit);
             TScanRangeLocations scanRangeLocations = new TScanRangeLocations();
             scanRangeLocations.scan_range = scanRange;
             scanRangeLocations.locations = locations;
@@ -611,6 +698,8 @@ public class HdfsScanNode extends ScanNode {
   protected void toThrift(TPlanNode msg) {
     // TODO: retire this once the migration to the new plan is complete
     msg.hdfs_scan_node = new THdfsScanNode(desc_.getId().asInt());
+    if (spatialFilter_ != null) msg.hdfs_scan_node.setSpatial_filter(spatialFilter_);
+    if (knnFilter_ != null) msg.hdfs_scan_node.setKnn_filter(knnFilter_);
     msg.node_type = TPlanNodeType.HDFS_SCAN_NODE;
   }
 
@@ -648,6 +737,16 @@ public class HdfsScanNode extends ScanNode {
         output.append(
             detailPrefix + "predicates: " + getExplainString(conjuncts_) + "\n");
       }
+      if (spatialFilter_ != null) {
+        TRectangle window = spatialFilter_.getWindow();
+        output.append(String.format("%sspatial index window: (%s %s, %s %s)\n",
+            detailPrefix, window.getX1(), window.getY1(), window.getX2(),
+            window.getY2()));
+      }
+      if (knnFilter_ != null) {
+        output.append(String.format("%sspatial index knn point: (%s %s)\n",
+            detailPrefix, knnFilter_.getQuery_x(), knnFilter_.getQuery_y()));
+      }
     }
     if (detailLevel.ordinal() >= TExplainLevel.EXTENDED.ordinal()) {
       output.append(getStatsExplainString(detailPrefix, detailLevel));
@@ -137,6 +137,9 @@ public class HdfsTableSink extends TableSink {
     TDataSink result = new TDataSink(TDataSinkType.TABLE_SINK);
     THdfsTableSink hdfsTableSink = new THdfsTableSink(
         Expr.treesToThrift(partitionKeyExprs_), overwrite_);
+    List<Integer> spatialIndexCols =
+        ((HdfsTable) targetTable_).getSpatialIndexColumns();
+    if (spatialIndexCols != null) hdfsTableSink.setSpatial_index_cols(spatialIndexCols);
     TTableSink tTableSink = new TTableSink(targetTable_.getId().asInt(),
         TTableSinkType.HDFS);
     tTableSink.hdfs_table_sink = hdfsTableSink;
@@ -0,0 +1,121 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package com.cloudera.impala.planner;
+
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+
+import com.cloudera.impala.analysis.Analyzer;
+import com.cloudera.impala.analysis.Expr;
+import com.cloudera.impala.catalog.Type;
+import com.cloudera.impala.thrift.TExplainLevel;
+import com.cloudera.impala.thrift.TKnnNode;
+import com.cloudera.impala.thrift.TPlanNode;
+import com.cloudera.impala.thrift.TPlanNodeType;
+import com.cloudera.impala.thrift.TQueryOptions;
+import com.google.common.base.Objects;
+import com.google.common.base.Preconditions;
+
+/**
+ * Returns the k (= limit) rows of its child whose (xExpr, yExpr) coordinates are
+ * nearest to a constant query point. Rows with a NULL or NaN coordinate are infinitely
+ * far away. The planner places a KnnNode below the TopN of
+ * "ORDER BY st_distance(...) LIMIT k"; in a distributed plan it runs in every fragment
+ * instance that feeds the TopN, whose merging exchange combines their results.
+ *
+ * If the child is a scan of a table with a spatial index on exactly the coordinate
+ * columns, the scan reads the nearest files first and skips files that are farther
+ * away than the current k-th nearest row.
+ */
+public class KnnNode extends PlanNode {
+  private final static Logger LOG = LoggerFactory.getLogger(KnnNode.class);
+
+  private final Expr xExpr_;
+  private final Expr yExpr_;
+  private final double queryX_;
+  private final double queryY_;
+
+  // The scan that the BE passes the current k-th nearest distance to, or null.
+  private final HdfsScanNode prunedScan_;
+
+  public KnnNode(PlanNodeId id, PlanNode child, Expr xExpr, Expr yExpr, double queryX,
+      double queryY, long k) {
+    super(id, child.getTupleIds(), "KNN");
+    Preconditions.checkState(xExpr.getType().equals(Type.DOUBLE));
+    Preconditions.checkState(yExpr.getType().equals(Type.DOUBLE));
+    Preconditions.checkState(k >= 0);
+    xExpr_ = xExpr;
+    yExpr_ = yExpr;
+    queryX_ = queryX;
+    queryY_ = queryY;
+    limit_ = k;
+    addChild(child);
+    tblRefIds_ = child.tblRefIds_;
+    nullableTupleIds_ = child.nullableTupleIds_;
+    if (child instanceof HdfsScanNode
+        && ((HdfsScanNode) child).setKnnFilter(xExpr, yExpr, queryX, queryY)) {
+      prunedScan_ = (HdfsScanNode) child;
+    } else {
+      prunedScan_ = null;
+    }
+  }
+
+  @Override
+  public void computeStats(Analyzer analyzer) {
+    super.computeStats(analyzer);
+    cardinality_ = getChild(0).cardinality_;
+    if (cardinality_ == -1 || cardinality_ > limit_) cardinality_ = limit_;
+    LOG.debug("stats Knn: cardinality=" + Long.toString(cardinality_));
+  }
+
+  @Override
+  protected String debugString() {
+    return Objects.toStringHelper(this)
+        .add("xExpr", xExpr_.debugString())
+        .add("yExpr", yExpr_.debugString())
+        .add("queryX", queryX_)
+        .add("queryY", queryY_)
+        .addValue(super.debugString())
+        .toString();
+  }
+
+  @Override
+  protected void toThrift(TPlanNode msg) {
+    msg.node_type = TPlanNodeType.KNN_NODE;
+    msg.knn_node = new TKnnNode(xExpr_.treeToThrift(), yExpr_.treeToThrift(), queryX_,
+        queryY_);
+    if (prunedScan_ != null) {
+      msg.knn_node.setPruned_scan_node_id(prunedScan_.getId().asInt());
+    }
+  }
+
+  @Override
+  protected String getNodeExplainString(String prefix, String detailPrefix,
+      TExplainLevel detailLevel) {
+    StringBuilder output = new StringBuilder();
+    output.append(String.format("%s%s:%s\n", prefix, id_.toString(), displayName_));
+    if (detailLevel.ordinal() >= TExplainLevel.STANDARD.ordinal()) {
+      output.append(String.format("%snearest to: (%s %s) on (%s, %s)\n", detailPrefix,
+          queryX_, queryY_, xExpr_.toSql(), yExpr_.toSql()));
+    }
+    return output.toString();
+  }
+
+  @Override
+  public void computeCosts(TQueryOptions queryOptions) {
+    Preconditions.checkState(hasValidStats());
+    perHostMemCost_ = (long) Math.ceil(limit_ * avgRowSize_);
+  }
+}
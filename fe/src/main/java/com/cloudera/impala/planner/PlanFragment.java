@@ -24,12 +24,9 @@ import com.cloudera.impala.analysis.BinaryPredicate;
 import com.cloudera.impala.analysis.Expr;
 import com.cloudera.impala.analysis.JoinOperator;
 import com.cloudera.impala.analysis.SlotRef;
-import com.cloudera.impala.catalog.HdfsFileFormat;
-import com.cloudera.impala.catalog.HdfsTable;
 import com.cloudera.impala.common.AnalysisException;
 import com.cloudera.impala.common.InternalException;
 import com.cloudera.impala.common.NotImplementedException;
-import com.cloudera.impala.planner.HashJoinNode.DistributionMode;
 import com.cloudera.impala.thrift.TExplainLevel;
 import com.cloudera.impala.thrift.TPartitionType;
 import com.cloudera.impala.thrift.TPlanFragment;
@@ -205,12 +202,6 @@ public class PlanFragment {
         // TODO: Add NULL_AWARE_LEFT_ANTI_JOIN.
         return false;
       }
-      // We can't push down predicates for partitioned joins yet.
-      // TODO: this can be hugely helpful to avoid network traffic. Implement this.
-      if (hashJoinNode.getDistributionMode() == DistributionMode.PARTITIONED) {
-        return false;
-      }
-
       List<BinaryPredicate> joinConjuncts = hashJoinNode.getEqJoinConjuncts();
       // We can only add these filters for conjuncts of the form:
       // <probe_slot> = *. If the hash join has any equal join conjuncts in this form,
@@ -224,20 +215,17 @@ public class PlanFragment {
       // Even if this join cannot add predicates, return true so the parent node can.
       return true;
     } else if (node instanceof HdfsScanNode) {
-      // Since currently only the Parquet scanner employs the slot filter optimization,
-      // we enable it only if the majority format is Parquet. Otherwise we are adding
-      // the overhead of creating the SlotFilters in the build side in queries not on
-      // Parquet data.
-      // TODO: Modify the other scanners to exploit the slot filter optimization.
-      HdfsScanNode scanNode = (HdfsScanNode) node;
-      Preconditions.checkNotNull(scanNode.desc_);
-      Preconditions.checkNotNull(scanNode.desc_.getTable() instanceof HdfsTable);
-      HdfsTable table = (HdfsTable) scanNode.desc_.getTable();
-      if (table.getMajorityFormat() == HdfsFileFormat.PARQUET) {
-        return true;
-      } else {
-        return false;
+      // All HDFS scans skip the ranges of partitions whose key values fail a filter, and
+      // the Parquet scanner also filters individual rows.
+      return true;
+    } else if (node instanceof ExchangeNode) {
+      // The filters are routed by the coordinator to the scans in the sending
+      // fragments, so they can be pushed through exchanges.
+      boolean result = true;
+      for (PlanNode child : node.getChildren()) {
+        result &= computeCanAddSlotFilters(child);
       }
+      return result;
     } else {
       for (PlanNode child : node.getChildren()) {
         computeCanAddSlotFilters(child);
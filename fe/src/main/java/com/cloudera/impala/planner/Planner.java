@@ -35,14 +35,18 @@ import com.cloudera.impala.analysis.BinaryPredicate;
 import com.cloudera.impala.analysis.EquivalenceClassId;
 import com.cloudera.impala.analysis.Expr;
 import com.cloudera.impala.analysis.ExprSubstitutionMap;
+import com.cloudera.impala.analysis.FunctionCallExpr;
+import com.cloudera.impala.analysis.FunctionName;
 import com.cloudera.impala.analysis.InlineViewRef;
 import com.cloudera.impala.analysis.InsertStmt;
 import com.cloudera.impala.analysis.JoinOperator;
+import com.cloudera.impala.analysis.NumericLiteral;
 import com.cloudera.impala.analysis.QueryStmt;
 import com.cloudera.impala.analysis.SelectStmt;
 import com.cloudera.impala.analysis.SlotDescriptor;
 import com.cloudera.impala.analysis.SlotId;
 import com.cloudera.impala.analysis.SlotRef;
+import com.cloudera.impala.analysis.SortInfo;
 import com.cloudera.impala.analysis.TableRef;
 import com.cloudera.impala.analysis.TupleDescriptor;
 import com.cloudera.impala.analysis.TupleId;
@@ -257,8 +261,9 @@ public class Planner {
     for (PlanNode child: root.getChildren()) {
       // allow child fragments to be partitioned, unless they contain a limit clause
       // (the result set with the limit constraint needs to be computed centrally);
-      // merge later if needed
-      boolean childIsPartitioned = !child.hasLimit();
+      // merge later if needed. The limit of a KnnNode applies to each instance, the
+      // TopN above it merges their results.
+      boolean childIsPartitioned = !child.hasLimit() || child instanceof KnnNode;
       childFragments.add(
           createPlanFragments(
             child, analyzer, childIsPartitioned, perNodeMemLimit, fragments));
@@ -278,6 +283,11 @@ public class Planner {
       result = createCrossJoinFragment(
           (CrossJoinNode) root, childFragments.get(1), childFragments.get(0),
           perNodeMemLimit, fragments, analyzer);
+    } else if (root instanceof SpatialJoinNode) {
+      Preconditions.checkState(childFragments.size() == 2);
+      result = createSpatialJoinFragment(
+          (SpatialJoinNode) root, childFragments.get(1), childFragments.get(0),
+          perNodeMemLimit, fragments, analyzer);
     } else if (root instanceof SelectNode) {
       result = createSelectNodeFragment((SelectNode) root, childFragments, analyzer);
     } else if (root instanceof UnionNode) {
@@ -295,6 +305,8 @@ public class Planner {
         result = createOrderByFragment(
             (SortNode) root, childFragments.get(0), fragments, analyzer);
       }
+    } else if (root instanceof KnnNode) {
+      result = createKnnFragment((KnnNode) root, childFragments.get(0));
     } else if (root instanceof AnalyticEvalNode) {
       result = createAnalyticFragment(root, childFragments.get(0), fragments, analyzer);
     } else if (root instanceof EmptySetNode) {
@@ -442,6 +454,79 @@ public class Planner {
     return leftChildFragment;
   }
 
+  /**
+   * Creates either a broadcast or a partitioned spatial join, choosing between them
+   * like createHashJoinFragment() does for hash joins.
+   * For a broadcast join, the right child input is sent to every instance of the
+   * leftChildFragment, and every instance joins all cells of the grid. For a
+   * partitioned join, both inputs are spatially partitioned on the join's grid by
+   * their MBR exprs, and every instance only joins the cells it owns. Rows that overlap
+   * several cells are sent to each of their owners; the partition cost does not
+   * account for that.
+   */
+  private PlanFragment createSpatialJoinFragment(SpatialJoinNode node,
+      PlanFragment rightChildFragment, PlanFragment leftChildFragment,
+      long perNodeMemLimit, ArrayList<PlanFragment> fragments,
+      Analyzer analyzer) throws InternalException {
+    PlanNode lhsTree = leftChildFragment.getPlanRoot();
+    PlanNode rhsTree = rightChildFragment.getPlanRoot();
+    long rhsDataSize = 0;
+    long broadcastCost = Long.MAX_VALUE;
+    if (rhsTree.getCardinality() != -1 && leftChildFragment.getNumNodes() != -1) {
+      rhsDataSize = Math.round(
+          (double) rhsTree.getCardinality() * rhsTree.getAvgRowSize());
+      broadcastCost = rhsDataSize * leftChildFragment.getNumNodes();
+    }
+    long partitionCost = Long.MAX_VALUE;
+    if (lhsTree.getCardinality() != -1 && rhsTree.getCardinality() != -1) {
+      partitionCost = Math.round(
+          (double) lhsTree.getCardinality() * lhsTree.getAvgRowSize()
+          + (double) rhsTree.getCardinality() * rhsTree.getAvgRowSize());
+    }
+    LOG.debug("spatial join broadcast: cost=" + Long.toString(broadcastCost));
+    LOG.debug("spatial join partition: cost=" + Long.toString(partitionCost));
+
+    // The build side of a broadcast join is materialized on every node, so we switch
+    // to a partitioned join if it exceeds perNodeMemLimit.
+    boolean doBroadcast = (perNodeMemLimit == 0 || rhsDataSize <= perNodeMemLimit)
+        && (node.getTableRef().isBroadcastJoin()
+            || (!node.getTableRef().isPartitionedJoin()
+                && broadcastCost <= partitionCost));
+
+    if (doBroadcast) {
+      node.setDistributionMode(HashJoinNode.DistributionMode.BROADCAST);
+      node.setChild(0, leftChildFragment.getPlanRoot());
+      connectChildFragment(analyzer, node, 1, rightChildFragment);
+      leftChildFragment.setPlanRoot(node);
+      return leftChildFragment;
+    }
+
+    node.setDistributionMode(HashJoinNode.DistributionMode.PARTITIONED);
+    DataPartition lhsJoinPartition =
+        new DataPartition(node.getProbeExpr().clone(), node.getGrid());
+    DataPartition rhsJoinPartition =
+        new DataPartition(node.getBuildExpr().clone(), node.getGrid());
+
+    // Create a new parent fragment containing the join with two ExchangeNodes as
+    // inputs, which are fed by the spatially partitioned left- and rightChildFragments.
+    ExchangeNode lhsExchange = new ExchangeNode(nodeIdGenerator_.getNextId());
+    lhsExchange.addChild(leftChildFragment.getPlanRoot(), false, analyzer);
+    lhsExchange.computeStats(null);
+    node.setChild(0, lhsExchange);
+    ExchangeNode rhsExchange = new ExchangeNode(nodeIdGenerator_.getNextId());
+    rhsExchange.addChild(rightChildFragment.getPlanRoot(), false, analyzer);
+    rhsExchange.computeStats(null);
+    node.setChild(1, rhsExchange);
+
+    PlanFragment joinFragment =
+        new PlanFragment(fragmentIdGenerator_.getNextId(), node, lhsJoinPartition);
+    leftChildFragment.setDestination(lhsExchange);
+    leftChildFragment.setOutputPartition(lhsJoinPartition);
+    rightChildFragment.setDestination(rhsExchange);
+    rightChildFragment.setOutputPartition(rhsJoinPartition);
+    return joinFragment;
+  }
+
   /**
    * Creates either a broadcast join or a repartitioning join, depending on the
    * expected cost.
@@ -986,6 +1071,17 @@ public class Planner {
     return mergeFragment;
   }
 
+  /**
+   * Adds the KnnNode to the root of childFragment, so that every instance of a
+   * partitioned childFragment returns its k nearest rows. The TopN above the KnnNode
+   * sorts them and a merging exchange combines the results of all instances.
+   */
+  private PlanFragment createKnnFragment(KnnNode node, PlanFragment childFragment) {
+    node.setChild(0, childFragment.getPlanRoot());
+    childFragment.addPlanRoot(node);
+    return childFragment;
+  }
+
   /**
    * Create plan tree for single-node execution. Generates PlanNodes for the
    * Select/Project/Join/Union [All]/Group by/Having/Order by clauses of the query stmt.
@@ -1042,6 +1138,10 @@ public class Planner {
       // TODO: External sort could be used for very large limits
       // not just unlimited order-by
       boolean useTopN = stmt.hasLimit() && !disableTopN;
+      if (useTopN) {
+        root = createKnnNode(analyzer, root, stmt.getSortInfo(),
+            limit + stmt.getOffset());
+      }
       root = new SortNode(nodeIdGenerator_.getNextId(), root, stmt.getSortInfo(),
           useTopN, stmt.getOffset());
       Preconditions.checkState(root.hasValidStats());
@@ -1055,6 +1155,67 @@ public class Planner {
     return root;
   }
 
+  /**
+   * If 'sortInfo' orders by st_distance(point(x, y), point(<c1>, <c2>)) ascending with
+   * NULLs last, with numeric literals c1 and c2, returns a KnnNode on top of root that
+   * returns the k rows of root that are nearest to (c1, c2). The TopN that is placed on
+   * top of it then only has to sort those k rows. Otherwise returns root unchanged.
+   */
+  private PlanNode createKnnNode(Analyzer analyzer, PlanNode root, SortInfo sortInfo,
+      long k) throws InternalException {
+    if (sortInfo.getOrderingExprs().size() != 1) return root;
+    if (!sortInfo.getIsAscOrder().get(0) || sortInfo.getNullsFirst().get(0)) return root;
+    Expr distance = sortInfo.getOrderingExprs().get(0);
+    if (!isBuiltinCall(distance, "st_distance")) return root;
+    Expr point = distance.getChild(0);
+    Expr queryPoint = distance.getChild(1);
+    if (point.isConstant()) {
+      // st_distance() is symmetric.
+      point = distance.getChild(1);
+      queryPoint = distance.getChild(0);
+    }
+    if (!isBuiltinCall(point, "point") || !isBuiltinCall(queryPoint, "point")) {
+      return root;
+    }
+    Expr queryX = queryPoint.getChild(0).ignoreImplicitCast();
+    Expr queryY = queryPoint.getChild(1).ignoreImplicitCast();
+    if (!(queryX instanceof NumericLiteral) || !(queryY instanceof NumericLiteral)) {
+      return root;
+    }
+
+    // The ordering exprs reference the sort tuple; map them back to the exprs of root's
+    // output that the sort materializes.
+    ExprSubstitutionMap sortTupleSmap = new ExprSubstitutionMap();
+    List<SlotDescriptor> sortTupleSlots = sortInfo.getSortTupleDescriptor().getSlots();
+    List<Expr> slotExprs = sortInfo.getSortTupleSlotExprs();
+    for (int i = 0; i < slotExprs.size(); ++i) {
+      sortTupleSmap.put(new SlotRef(sortTupleSlots.get(i)), slotExprs.get(i));
+    }
+    ExprSubstitutionMap smap = ExprSubstitutionMap.compose(sortTupleSmap,
+        root.getOutputSmap(), analyzer);
+    Expr x = point.getChild(0).substitute(smap, analyzer);
+    Expr y = point.getChild(1).substitute(smap, analyzer);
+    if (!x.isBoundByTupleIds(root.getTupleIds())
+        || !y.isBoundByTupleIds(root.getTupleIds())) {
+      return root;
+    }
+
+    KnnNode knnNode = new KnnNode(nodeIdGenerator_.getNextId(), root, x, y,
+        ((NumericLiteral) queryX).getDoubleValue(),
+        ((NumericLiteral) queryY).getDoubleValue(), k);
+    knnNode.init(analyzer);
+    return knnNode;
+  }
+
+  /**
+   * Returns true if 'e' is a call of the builtin function 'fnName'.
+   */
+  private static boolean isBuiltinCall(Expr e, String fnName) {
+    if (!(e instanceof FunctionCallExpr)) return false;
+    FunctionName name = ((FunctionCallExpr) e).getFnName();
+    return name.isBuiltin() && name.getFunction().equals(fnName);
+  }
+
   /**
    * If there are unassigned conjuncts_ that are bound by tupleIds_, returns a SelectNode
    * on top of root that evaluate those conjuncts_; otherwise returns root unchanged.
@@ -1787,6 +1948,8 @@ public class Planner {
     Preconditions.checkState(innerRef != null ^ outerRef != null);
     TableRef tblRef = (innerRef != null) ? innerRef : outerRef;
     if (tblRef.getJoinOp() == JoinOperator.CROSS_JOIN) {
+      PlanNode spatialJoin = createSpatialJoinNode(analyzer, outer, inner, tblRef);
+      if (spatialJoin != null) return spatialJoin;
       // TODO If there are eq join predicates then we should construct a hash join
       CrossJoinNode result = new CrossJoinNode(outer, inner);
       result.init(analyzer);
@@ -1811,6 +1974,10 @@ public class Planner {
       }
     }
     if (eqJoinConjuncts.isEmpty()) {
+      if (tblRef.getJoinOp() == JoinOperator.INNER_JOIN) {
+        PlanNode spatialJoin = createSpatialJoinNode(analyzer, outer, inner, tblRef);
+        if (spatialJoin != null) return spatialJoin;
+      }
       if (!throwOnError) return null;
       throw new NotImplementedException(
           String.format(
@@ -1859,6 +2026,44 @@ public class Planner {
     return result;
   }
 
+  /**
+   * Returns a SpatialJoinNode that joins outer with inner on an unassigned
+   * st_intersects() conjunct whose arguments are bound by outer and inner, respectively,
+   * or null if there is no such conjunct. The join computes exactly that predicate, so
+   * the conjunct is marked as assigned.
+   */
+  private PlanNode createSpatialJoinNode(Analyzer analyzer, PlanNode outer,
+      PlanNode inner, TableRef tblRef) throws InternalException {
+    List<TupleId> tblRefIds = Lists.newArrayList(outer.getTblRefIds());
+    tblRefIds.addAll(inner.getTblRefIds());
+    for (Expr e: analyzer.getUnassignedConjuncts(tblRefIds, false)) {
+      if (!(e instanceof FunctionCallExpr)) continue;
+      if (!isBuiltinCall(e, "st_intersects")) continue;
+      Preconditions.checkState(e.getChildren().size() == 2);
+      if (e.getChild(0).isConstant() || e.getChild(1).isConstant()) continue;
+      Expr probeExpr = null;
+      Expr buildExpr = null;
+      if (e.getChild(0).isBoundByTupleIds(outer.getTblRefIds())
+          && e.getChild(1).isBoundByTupleIds(inner.getTblRefIds())) {
+        probeExpr = e.getChild(0);
+        buildExpr = e.getChild(1);
+      } else if (e.getChild(1).isBoundByTupleIds(outer.getTblRefIds())
+          && e.getChild(0).isBoundByTupleIds(inner.getTblRefIds())) {
+        // st_intersects() is symmetric.
+        probeExpr = e.getChild(1);
+        buildExpr = e.getChild(0);
+      } else {
+        continue;
+      }
+      analyzer.markConjunctAssigned(e);
+      SpatialJoinNode result = new SpatialJoinNode(outer, inner, tblRef, probeExpr,
+          buildExpr, SpatialJoinNode.createDefaultGrid());
+      result.init(analyzer);
+      return result;
+    }
+    return null;
+  }
+
   /**
    * Create a tree of PlanNodes for the given tblRef, which can be a BaseTableRef or a
    * InlineViewRef
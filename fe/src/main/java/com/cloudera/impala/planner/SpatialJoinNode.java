@@ -0,0 +1,187 @@
+// Copyright 2012 Cloudera Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package com.cloudera.impala.planner;
+
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+
+import com.cloudera.impala.analysis.Analyzer;
+import com.cloudera.impala.analysis.Expr;
+import com.cloudera.impala.analysis.ExprSubstitutionMap;
+import com.cloudera.impala.analysis.TableRef;
+import com.cloudera.impala.catalog.Type;
+import com.cloudera.impala.common.InternalException;
+import com.cloudera.impala.planner.HashJoinNode.DistributionMode;
+import com.cloudera.impala.thrift.TExplainLevel;
+import com.cloudera.impala.thrift.TPlanNode;
+import com.cloudera.impala.thrift.TPlanNodeType;
+import com.cloudera.impala.thrift.TQueryOptions;
+import com.cloudera.impala.thrift.TSpatialGrid;
+import com.cloudera.impala.thrift.TSpatialJoinNode;
+import com.google.common.base.Objects;
+import com.google.common.base.Preconditions;
+
+/**
+ * Inner join of the left and right child on the intersection of their MBRs, which are
+ * computed by the RECTANGLE-typed probeExpr and buildExpr. If the join is partitioned,
+ * both children must be spatially partitioned on 'grid'; otherwise the right child is
+ * broadcast and every instance joins all cells.
+ * The planner creates a SpatialJoinNode for an inner or cross join that has a
+ * st_intersects() conjunct between the two sides and no equi-join conjuncts.
+ */
+public class SpatialJoinNode extends PlanNode {
+  private final static Logger LOG = LoggerFactory.getLogger(SpatialJoinNode.class);
+
+  // Default per-host memory requirement used if no valid stats are available.
+  private final static long DEFAULT_PER_HOST_MEM = 2L * 1024L * 1024L * 1024L;
+
+  // Without spatial stats the grid covers the range of longitude/latitude coordinates.
+  // Coordinates outside of it belong to the edge cells, so any input is joined
+  // correctly, but only inputs within this range are spread evenly over the cells.
+  // 2048 cells leave enough cells per instance for a partitioned join on a large
+  // cluster, and small enough cells for the plane sweeps of a single node.
+  private final static double DEFAULT_GRID_X1 = -180.0;
+  private final static double DEFAULT_GRID_Y1 = -90.0;
+  private final static double DEFAULT_GRID_X2 = 180.0;
+  private final static double DEFAULT_GRID_Y2 = 90.0;
+  private final static int DEFAULT_GRID_NUM_COLS = 64;
+  private final static int DEFAULT_GRID_NUM_ROWS = 32;
+
+  // tableRef corresponding to the left or right child of this join; only used for
+  // getting the plan hints of this join
+  private final TableRef tblRef_;
+
+  private Expr probeExpr_;
+  private Expr buildExpr_;
+  private final TSpatialGrid grid_;
+  private DistributionMode distrMode_;
+
+  public SpatialJoinNode(PlanNode outer, PlanNode inner, TableRef tblRef,
+      Expr probeExpr, Expr buildExpr, TSpatialGrid grid) {
+    super("SPATIAL JOIN");
+    Preconditions.checkState(probeExpr.getType().equals(Type.RECTANGLE));
+    Preconditions.checkState(buildExpr.getType().equals(Type.RECTANGLE));
+    tblRef_ = tblRef;
+    probeExpr_ = probeExpr;
+    buildExpr_ = buildExpr;
+    grid_ = grid;
+    distrMode_ = DistributionMode.NONE;
+    tupleIds_.addAll(outer.getTupleIds());
+    tupleIds_.addAll(inner.getTupleIds());
+    tblRefIds_.addAll(outer.getTblRefIds());
+    tblRefIds_.addAll(inner.getTblRefIds());
+    children_.add(outer);
+    children_.add(inner);
+    nullableTupleIds_.addAll(outer.getNullableTupleIds());
+    nullableTupleIds_.addAll(inner.getNullableTupleIds());
+  }
+
+  /**
+   * Returns the grid to join on, see DEFAULT_GRID_*.
+   */
+  public static TSpatialGrid createDefaultGrid() {
+    return DataPartition.createSpatialGrid(DEFAULT_GRID_X1, DEFAULT_GRID_Y1,
+        DEFAULT_GRID_X2, DEFAULT_GRID_Y2, DEFAULT_GRID_NUM_COLS, DEFAULT_GRID_NUM_ROWS);
+  }
+
+  public Expr getProbeExpr() { return probeExpr_; }
+  public Expr getBuildExpr() { return buildExpr_; }
+  public TSpatialGrid getGrid() { return grid_; }
+  public TableRef getTableRef() { return tblRef_; }
+  public DistributionMode getDistributionMode() { return distrMode_; }
+  public void setDistributionMode(DistributionMode distrMode) {
+    distrMode_ = distrMode;
+  }
+
+  @Override
+  public void init(Analyzer analyzer) throws InternalException {
+    super.init(analyzer);
+    assignedConjuncts_ = analyzer.getAssignedConjuncts();
+
+    ExprSubstitutionMap combinedChildSmap = getCombinedChildSmap();
+    probeExpr_ = probeExpr_.substitute(combinedChildSmap, analyzer);
+    buildExpr_ = buildExpr_.substitute(combinedChildSmap, analyzer);
+  }
+
+  @Override
+  public void computeStats(Analyzer analyzer) {
+    super.computeStats(analyzer);
+    if (getChild(0).cardinality_ == -1 || getChild(1).cardinality_ == -1) {
+      cardinality_ = -1;
+    } else {
+      // Without spatial stats, assume each probe row matches one build row.
+      cardinality_ = Math.max(getChild(0).cardinality_, getChild(1).cardinality_);
+      if (computeSelectivity() != -1) {
+        cardinality_ = Math.round(((double) cardinality_) * computeSelectivity());
+      }
+    }
+    LOG.debug("stats SpatialJoin: cardinality=" + Long.toString(cardinality_));
+  }
+
+  @Override
+  protected String debugString() {
+    return Objects.toStringHelper(this)
+        .add("probeExpr", probeExpr_.debugString())
+        .add("buildExpr", buildExpr_.debugString())
+        .add("distrMode", distrMode_)
+        .addValue(super.debugString())
+        .toString();
+  }
+
+  @Override
+  protected void toThrift(TPlanNode msg) {
+    msg.node_type = TPlanNodeType.SPATIAL_JOIN_NODE;
+    msg.spatial_join_node = new TSpatialJoinNode(probeExpr_.treeToThrift(),
+        buildExpr_.treeToThrift(), grid_,
+        distrMode_ == DistributionMode.PARTITIONED);
+  }
+
+  @Override
+  protected String getNodeExplainString(String prefix, String detailPrefix,
+      TExplainLevel detailLevel) {
+    StringBuilder output = new StringBuilder();
+    output.append(String.format("%s%s:%s", prefix, id_.toString(), displayName_));
+    if (distrMode_ != DistributionMode.NONE) {
+      output.append(" [" + distrMode_.toString() + "]");
+    }
+    output.append("\n");
+    if (detailLevel.ordinal() >= TExplainLevel.STANDARD.ordinal()) {
+      output.append(detailPrefix + "spatial predicate: intersects(" + probeExpr_.toSql()
+          + ", " + buildExpr_.toSql() + ")\n");
+      output.append(detailPrefix + "grid: " + grid_.getNum_cols() + "x"
+          + grid_.getNum_rows() + " cells\n");
+      if (!conjuncts_.isEmpty()) {
+        output.append(detailPrefix + "predicates: ")
+        .append(getExplainString(conjuncts_) + "\n");
+      }
+    }
+    return output.toString();
+  }
+
+  @Override
+  public void computeCosts(TQueryOptions queryOptions) {
+    if (getChild(0).getCardinality() == -1 || getChild(0).getAvgRowSize() == -1
+        || getChild(1).getCardinality() == -1 || getChild(1).getAvgRowSize() == -1
+        || numNodes_ == 0) {
+      perHostMemCost_ = DEFAULT_PER_HOST_MEM;
+      return;
+    }
+    // Both sides are materialized.
+    double totalSize = getChild(0).cardinality_ * getChild(0).avgRowSize_
+        + getChild(1).cardinality_ * getChild(1).avgRowSize_;
+    if (distrMode_ == DistributionMode.PARTITIONED) totalSize /= numNodes_;
+    perHostMemCost_ = (long) Math.ceil(totalSize);
+  }
+}
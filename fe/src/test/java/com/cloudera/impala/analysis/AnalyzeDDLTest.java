@@ -172,6 +172,11 @@ public class AnalyzeDDLTest extends AnalyzerTest {
     // Invalid column name.
     AnalysisError("alter table functional.alltypes add columns (`???` int)",
         "Invalid column/field name: ???");
+    // Spatial types cannot be stored in tables.
+    AnalysisError("alter table functional.alltypes add columns (p point)",
+        "Type POINT is not supported for table columns: p");
+    AnalysisError("alter table functional.alltypes replace columns (r rectangle)",
+        "Type RECTANGLE is not supported for table columns: r");
     AnalysisError("alter table functional.alltypes replace columns (`???` int)",
         "Invalid column/field name: ???");
 
@@ -266,6 +271,8 @@ public class AnalyzeDDLTest extends AnalyzerTest {
         "Column already exists: Tinyint_col");
 
     // Invalid column name.
+    AnalysisError("alter table functional.alltypes change column int_col c2 point",
+        "Type POINT is not supported for table columns: c2");
     AnalysisError("alter table functional.alltypes change column int_col `???` int",
         "Invalid column/field name: ???");
 
@@ -927,6 +934,14 @@ public class AnalyzeDDLTest extends AnalyzerTest {
         "Type 'DATE' is not supported as partition-column type in column: d");
     AnalysisError("create table new_table (i int) PARTITIONED BY (d datetime)",
         "Type 'DATETIME' is not supported as partition-column type in column: d");
+    AnalysisError("create table new_table (i int) PARTITIONED BY (p point)",
+        "Type 'POINT' is not supported as partition-column type in column: p");
+
+    // Spatial types cannot be stored in tables.
+    AnalysisError("create table new_table (p point)",
+        "Type POINT is not supported for table columns: p");
+    AnalysisError("create table new_table (i int, r rectangle)",
+        "Type RECTANGLE is not supported for table columns: r");
 
     AnalysisError("create table cached_tbl(i int) partitioned by(j int) " +
         "cached in 'testPool'", "HDFS caching is not supported on CDH4");
@@ -1190,6 +1205,9 @@ public class AnalyzeDDLTest extends AnalyzerTest {
     AnalyzesOk("create view if not exists foo as select * from functional.alltypes");
     AnalyzesOk("create view foo (a, b) as select int_col, string_col " +
         "from functional.alltypes");
+    // Views can have spatial-typed columns.
+    AnalyzesOk("create view foo (p, r) as select point(double_col, double_col), " +
+        "rectangle(0, 0, double_col, double_col) from functional.alltypes");
     AnalyzesOk("create view functional.foo (a, b) as select int_col x, double_col y " +
         "from functional.alltypes");
     // View can have complex-typed columns.
@@ -390,6 +390,42 @@ public class AnalyzeExprsTest extends AnalyzerTest {
         "Unsupported cast to complex type: STRUCT<a:INT,b:CHAR(20)>");
   }
 
+  /**
+   * Tests the constructors of and casts to/from the spatial types.
+   */
+  @Test
+  public void TestSpatialExprs() throws AnalysisException {
+    checkExprType("select point(1, 2)", Type.POINT);
+    checkExprType("select point(double_col, float_col) from functional.alltypes",
+        Type.POINT);
+    checkExprType("select rectangle(0, 0, 1, 1)", Type.RECTANGLE);
+    checkExprType("select cast('POINT(1 2)' as point)", Type.POINT);
+    checkExprType("select cast('RECTANGLE(0 0, 1 1)' as rectangle)", Type.RECTANGLE);
+    checkExprType("select cast(point(1, 2) as string)", Type.STRING);
+    checkExprType("select cast(rectangle(0, 0, 1, 1) as string)", Type.STRING);
+    checkExprType("select st_contains(rectangle(0, 0, 1, 1), point(1, 1))",
+        Type.BOOLEAN);
+    checkExprType("select st_intersects(rectangle(0, 0, 1, 1), rectangle(1, 1, 2, 2))",
+        Type.BOOLEAN);
+    checkExprType("select st_dwithin(point(0, 0), point(1, 1), 2)", Type.BOOLEAN);
+    AnalyzesOk("select * from functional.alltypes where " +
+        "st_contains(rectangle(0, 0, 10, 10), point(int_col, bigint_col))");
+
+    // Spatial types only convert from and to their text form.
+    AnalysisError("select cast(1 as point)",
+        "Invalid type cast of 1 from TINYINT to POINT");
+    AnalysisError("select cast(point(1, 2) as rectangle)",
+        "Invalid type cast of point(1, 2) from POINT to RECTANGLE");
+    AnalysisError("select cast(rectangle(0, 0, 1, 1) as double)",
+        "Invalid type cast of rectangle(0, 0, 1, 1) from RECTANGLE to DOUBLE");
+    AnalysisError("select point('a', 'b')",
+        "No matching function with signature: point(STRING, STRING).");
+    AnalysisError("select rectangle(0, 0, 1)",
+        "No matching function with signature: rectangle(TINYINT, TINYINT, TINYINT).");
+    AnalysisError("select st_contains(point(1, 1), rectangle(0, 0, 1, 1))",
+        "No matching function with signature: st_contains(POINT, RECTANGLE).");
+  }
+
   // Analyzes query and asserts that the first result expr returns the given type.
   // Requires query to parse to a SelectStmt.
   private void checkExprType(String query, Type type) {
@@ -1107,6 +1107,17 @@ public class ParserTest {
     ParserError("select if()");
   }
 
+  @Test
+  public void TestSpatialConstructors() {
+    ParsesOk("select point(1, 2) from t");
+    ParsesOk("select point(a, b + 1), rectangle(a, b, c, d) from t");
+    ParsesOk("select st_contains(rectangle(0, 0, 1, 1), point(x, y)) from t");
+    ParsesOk("select cast('POINT(1 2)' as point), cast(r as rectangle) from t");
+    ParserError("select point() from t");
+    ParserError("select rectangle from t");
+    ParserError("select point from t");
+  }
+
   @Test
   public void TestAggregateExprs() {
     ParsesOk("select count(*), count(a), count(distinct a, b) from t");
@@ -2296,6 +2307,8 @@ public class ParserTest {
     TypeDefsParseOk("BINARY");
     TypeDefsParseOk("DECIMAL");
     TypeDefsParseOk("TIMESTAMP");
+    TypeDefsParseOk("POINT");
+    TypeDefsParseOk("RECTANGLE");
 
     // Test decimal.
     TypeDefsParseOk("DECIMAL");
@@ -2311,6 +2324,8 @@ public class ParserTest {
     TypeDefsError("DECIMAL(1, a)");
     TypeDefsError("DECIMAL(1, 2, 3)");
     TypeDefsError("DECIMAL(-1)");
+    TypeDefsError("POINT(1)");
+    TypeDefsError("RECTANGLE(1, 2)");
 
     // Test complex types.
     TypeDefsParseOk("ARRAY<BIGINT>");
@@ -2387,7 +2402,7 @@ public class ParserTest {
         "       ^\n" +
         "Encountered: FROM\n" +
         "Expected: ALL, CASE, CAST, DISTINCT, EXISTS, " +
-        "FALSE, IF, INTERVAL, NOT, NULL, " +
+        "FALSE, IF, INTERVAL, NOT, NULL, POINT, RECTANGLE, " +
         "STRAIGHT_JOIN, TRUE, IDENTIFIER\n");
 
     // missing from
@@ -2414,7 +2429,7 @@ public class ParserTest {
         "                           ^\n" +
         "Encountered: EOF\n" +
         "Expected: CASE, CAST, EXISTS, FALSE, " +
-        "IF, INTERVAL, NOT, NULL, TRUE, IDENTIFIER\n");
+        "IF, INTERVAL, NOT, NULL, POINT, RECTANGLE, TRUE, IDENTIFIER\n");
 
     // missing predicate in where clause (group by)
     ParserError("select c, b, c from t where group by a, b",
@@ -2423,7 +2438,7 @@ public class ParserTest {
         "                            ^\n" +
         "Encountered: GROUP\n" +
         "Expected: CASE, CAST, EXISTS, FALSE, " +
-        "IF, INTERVAL, NOT, NULL, TRUE, IDENTIFIER\n");
+        "IF, INTERVAL, NOT, NULL, POINT, RECTANGLE, TRUE, IDENTIFIER\n");
 
     // unmatched string literal starting with "
     ParserError("select c, \"b, c from t",
@@ -2484,7 +2499,7 @@ public class ParserTest {
         "                             ^\n" +
         "Encountered: COMMA\n" +
         "Expected: CASE, CAST, EXISTS, FALSE, " +
-        "IF, INTERVAL, NOT, NULL, TRUE, IDENTIFIER\n");
+        "IF, INTERVAL, NOT, NULL, POINT, RECTANGLE, TRUE, IDENTIFIER\n");
 
     // Parsing identifiers that have different names printed as EXPECTED
     ParserError("DROP DATA SRC foo",
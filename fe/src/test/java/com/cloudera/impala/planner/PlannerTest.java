@@ -2,6 +2,7 @@
 
 package com.cloudera.impala.planner;
 
+import static org.junit.Assert.assertEquals;
 import static org.junit.Assert.fail;
 
 import java.io.File;
@@ -524,6 +525,30 @@ public class PlannerTest {
     runPlannerTestFile(testFile, "default");
   }
 
+  /**
+   * Returns whether each hash join of the distributed plan of 'query' adds runtime
+   * filters on its probe side, in the order of the join's plan node ids.
+   */
+  private List<Boolean> getAddProbeFilters(String query) throws ImpalaException {
+    TQueryCtx queryCtx = TestUtils.createQueryContext();
+    queryCtx.request.getQuery_options().setNum_nodes(
+        ImpalaInternalServiceConstants.NUM_NODES_ALL);
+    queryCtx.request.setStmt(query);
+    TExecRequest execRequest =
+        frontend_.createExecRequest(queryCtx, new StringBuilder());
+    buildMaps(execRequest.query_exec_request);
+    List<Integer> nodeIds = Lists.newArrayList(planMap_.keySet());
+    Collections.sort(nodeIds);
+    List<Boolean> result = Lists.newArrayList();
+    for (Integer nodeId: nodeIds) {
+      TPlanNode node = planMap_.get(nodeId);
+      if (node.isSetHash_join_node()) {
+        result.add(node.hash_join_node.add_probe_filters);
+      }
+    }
+    return result;
+  }
+
   @Test
   public void testPredicatePropagation() {
     runPlannerTestFile("predicate-propagation");
@@ -594,6 +619,42 @@ public class PlannerTest {
     runPlannerTestFile("topn");
   }
 
+  @Test
+  public void testSpatial() {
+    runPlannerTestFile("spatial");
+  }
+
+  @Test
+  public void testKnn() {
+    runPlannerTestFile("knn");
+  }
+
+  @Test
+  public void testRuntimeFilters() throws ImpalaException {
+    // The probe side scan is in the fragment of a broadcast join.
+    assertEquals(Lists.newArrayList(true), getAddProbeFilters(
+        "select count(*) from functional.alltypes a join [broadcast] " +
+        "functional.alltypestiny b on a.int_col = b.int_col"));
+    // The filters of a partitioned join cross the exchange of its probe side.
+    assertEquals(Lists.newArrayList(true), getAddProbeFilters(
+        "select count(*) from functional.alltypes a join [shuffle] " +
+        "functional.alltypestiny b on a.int_col = b.int_col"));
+    // The filters of the upper join cross the exchange above the lower join.
+    assertEquals(Lists.newArrayList(true, true), getAddProbeFilters(
+        "select count(*) from functional.alltypes a join [shuffle] " +
+        "functional.alltypestiny b on a.int_col = b.int_col join [shuffle] " +
+        "functional.alltypessmall c on a.id = c.id"));
+    // Rows of the probe side of an outer join can't be filtered.
+    assertEquals(Lists.newArrayList(false), getAddProbeFilters(
+        "select count(*) from functional.alltypes a left outer join [shuffle] " +
+        "functional.alltypestiny b on a.int_col = b.int_col"));
+    // Filters aren't pushed through the aggregation below the probe side exchange.
+    assertEquals(Lists.newArrayList(false), getAddProbeFilters(
+        "select count(*) from (select int_col from functional.alltypes " +
+        "group by int_col) a join [shuffle] functional.alltypestiny b " +
+        "on a.int_col = b.int_col"));
+  }
+
   @Test
   public void testInlineView() {
     runPlannerTestFile("inline-view");
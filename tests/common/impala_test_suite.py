@@ -219,6 +219,8 @@ class ImpalaTestSuite(BaseTestSuite):
       verify_raw_results(test_section, result,
                          vector.get_value('table_format').file_format,
                          pytest.config.option.update_results)
+      if 'RUNTIME_PROFILE' in test_section:
+        verify_runtime_profile(test_section['RUNTIME_PROFILE'], result.runtime_profile)
     if pytest.config.option.update_results:
       output_file = os.path.join('/tmp', test_file_name.replace('/','_') + ".test")
       write_test_file(output_file, sections, encoding=encoding)
@@ -243,6 +243,21 @@ def apply_error_match_filter(error_list):
     updated_errors.append(re.sub(r'Backend \d+:', '', row))
   return updated_errors
 
+def verify_runtime_profile(expected, actual):
+  """Checks that each line of 'expected' matches a line of the runtime profile 'actual'.
+  Lines with the 'row_regex:' prefix must match an entire line of the profile, others
+  must be contained in one."""
+  expected_lines = [l.strip() for l in remove_comments(expected).split('\n') if l.strip()]
+  actual_lines = actual.split('\n')
+  for expected_line in expected_lines:
+    if ROW_REGEX_PREFIX.match(expected_line):
+      pattern = re.compile(expected_line[len(ROW_REGEX_PREFIX_PATTERN):].strip())
+      matched = any(pattern.match(l.strip()) for l in actual_lines)
+    else:
+      matched = any(expected_line in l for l in actual_lines)
+    assert matched, "No line of the runtime profile matches '%s':\n%s" %\
+        (expected_line, actual)
+
 def verify_raw_results(test_section, exec_result, file_format, update_section=False):
   """
   Accepts a raw exec_result object and verifies it matches the expected results.
@@ -14,6 +14,7 @@
 # limitations under the License.
 
 import logging
+import re
 import pytest
 from copy import deepcopy
 from tests.common.custom_cluster_test_suite import CustomClusterTestSuite
@@ -89,3 +90,61 @@ class TestSpilling(CustomClusterTestSuite):
     # remove this. the test cases set this explicitly.
     del new_vector.get_value('exec_option')['num_nodes']
     self.run_test_case('QueryTest/spilling', new_vector)
+
+  # Spilled partitions are repartitioned with the next level's hash bits, which the
+  # open addressing tags must not depend on.
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(
+      impalad_args="--read_size=1000000")
+  def test_spilling_open_addressing(self, vector):
+    new_vector = deepcopy(vector)
+    del new_vector.get_value('exec_option')['num_nodes']
+    new_vector.get_value('exec_option')['hash_table_open_addressing'] = 1
+    self.run_test_case('QueryTest/spilling', new_vector)
+
+class TestSpillingTopN(CustomClusterTestSuite):
+  """Tests TopNs that keep their rows in a sorter, which is compacted and spills."""
+  # Query whose TopN spills, is compacted and pushes its cutoff down to the scan. The
+  # small batches keep the scan from reading ahead of the first compaction.
+  SPILLING_TOPN_QUERY = """select id, int_col, repeat(date_string_col, 100) s
+      from alltypesagg where day is not null order by int_col, id limit 5 offset 300"""
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestSpillingTopN, cls).add_test_dimensions()
+    cls.TestMatrix.clear_constraints()
+    cls.TestMatrix.add_dimension(create_parquet_dimension('functional'))
+    cls.TestMatrix.add_dimension(create_single_exec_option_dimension())
+
+  # Route TopNs with LIMIT + OFFSET above 100 through the sorter, and use small blocks so
+  # that it spills on small tables.
+  @pytest.mark.execute_serially
+  @CustomClusterTestSuite.with_args(
+      impalad_args="--max_in_memory_topn_rows=100 --read_size=65536")
+  def test_spilling_topn(self, vector):
+    new_vector = deepcopy(vector)
+    # remove this. the test cases set this explicitly.
+    del new_vector.get_value('exec_option')['num_nodes']
+    self.run_test_case('QueryTest/spilling-topn', new_vector)
+
+    exec_option = {'num_nodes': 1, 'max_block_mgr_memory': '1m', 'batch_size': 16,
+                   'num_scanner_threads': 1}
+    result = self.execute_query(self.SPILLING_TOPN_QUERY, exec_option,
+        table_format=vector.get_value('table_format'))
+    assert [row.split('\t')[0] for row in result.data] ==\
+        ['31', '1031', '2031', '3031', '4031']
+    assert self.__max_counter(result.runtime_profile, 'NumCompactions') > 1
+    assert self.__max_counter(result.runtime_profile, 'InitialRunsCreated') > 1
+    # Rows after the first compaction are dropped by the Parquet scanner.
+    assert self.__max_counter(result.runtime_profile, 'NumTopNFilteredRows') > 0
+
+  def __max_counter(self, profile, name):
+    """Returns the largest value of the counter 'name' in 'profile'."""
+    # Large values are printed as e.g. "9.35K (9350)".
+    values = [int(v) for v in re.findall(r'%s: (?:[\d.]+[KMB] \()?(\d+)' % name, profile)]
+    assert values, "Counter %s not found in profile:\n%s" % (name, profile)
+    return max(values)
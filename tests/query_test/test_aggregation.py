@@ -4,6 +4,7 @@
 #
 import logging
 import pytest
+from copy import deepcopy
 from tests.common.test_vector import *
 from tests.common.impala_test_suite import ImpalaTestSuite
 from tests.common.test_dimensions import create_exec_option_dimension
@@ -107,3 +108,10 @@ class TestAggregationQueries(ImpalaTestSuite):
     if vector.get_value('table_format').file_format == 'hbase':
       pytest.xfail(reason="IMPALA-283 - select count(*) produces inconsistent results")
     self.run_test_case('QueryTest/aggregation', vector)
+
+  def test_aggregation_open_addressing(self, vector):
+    if vector.get_value('table_format').file_format == 'hbase':
+      pytest.xfail(reason="IMPALA-283 - select count(*) produces inconsistent results")
+    new_vector = deepcopy(vector)
+    new_vector.get_value('exec_option')['hash_table_open_addressing'] = 1
+    self.run_test_case('QueryTest/aggregation', new_vector)
@@ -4,7 +4,7 @@
 #
 import logging
 import pytest
-from copy import copy
+from copy import copy, deepcopy
 from tests.common.test_vector import *
 from tests.common.impala_test_suite import *
 
@@ -39,6 +39,18 @@ class TestJoinQueries(ImpalaTestSuite):
     new_vector.get_value('exec_option')['batch_size'] = vector.get_value('batch_size')
     self.run_test_case('QueryTest/outer-joins', new_vector)
 
+  def test_joins_open_addressing(self, vector):
+    new_vector = deepcopy(vector)
+    new_vector.get_value('exec_option')['batch_size'] = vector.get_value('batch_size')
+    new_vector.get_value('exec_option')['hash_table_open_addressing'] = 1
+    self.run_test_case('QueryTest/joins', new_vector)
+    self.run_test_case('QueryTest/outer-joins', new_vector)
+
+  def test_spatial_joins(self, vector):
+    new_vector = copy(vector)
+    new_vector.get_value('exec_option')['batch_size'] = vector.get_value('batch_size')
+    self.run_test_case('QueryTest/spatial-joins', new_vector)
+
 class TestSemiJoinQueries(ImpalaTestSuite):
   IMP1160_TABLES = ['functional.imp1160a', 'functional.imp1160b']
 
@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+# Copyright (c) 2012 Cloudera, Inc. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Tests the row groups that the Parquet scanner skips and the rows it rejects by
+# evaluating the conjuncts on the entries of dictionary pages.
+
+import pytest
+from tests.common.impala_test_suite import ImpalaTestSuite
+from tests.util.parquet_util import *
+
+class TestParquetDictFilter(ImpalaTestSuite):
+  TEST_DB = "parquet_dict_filter_test_db"
+  TABLE_DIR = "test-warehouse/%s.db/t" % TEST_DB
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestParquetDictFilter, cls).add_test_dimensions()
+    cls.TestMatrix.add_constraint(lambda v:\
+        v.get_value('table_format').file_format == 'parquet' and\
+        v.get_value('table_format').compression_codec == 'none')
+
+  def setup_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+    self.execute_query("create database %s" % self.TEST_DB)
+    self.execute_query("create table %s.t (id int, n int, s string) stored as parquet"
+        % self.TEST_DB)
+    # One file with one row group. n has the odd numbers from 1 to 999 and NULL, s the
+    # strings 'v0', 'v2', ..., 'v198'.
+    self.execute_query("insert into %s.t "
+        "select id, if(id %% 10 = 0, null, (id %% 500) * 2 + 1), "
+        "concat('v', cast(id %% 100 * 2 as string)) from functional.alltypes"
+        % self.TEST_DB, {'num_nodes': 1})
+
+  def teardown_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+
+  @pytest.mark.execute_serially
+  def test_dict_filter(self, vector):
+    # The row group can only be skipped if n and s have no plain encoded values.
+    files = self.__data_files()
+    assert len(files) == 1
+    data = self.hdfs_client.read_file(files[0])
+    row_groups = get_file_metadata(data).row_groups
+    assert len(row_groups) == 1
+    for col in row_groups[0].columns[1:]:
+      assert col.meta_data.dictionary_page_offset is not None
+      assert Encoding.PLAIN not in col.meta_data.encodings
+    self.run_test_case('QueryTest/parquet-dict-filter', vector, use_db=self.TEST_DB)
+
+  def __data_files(self):
+    """Returns the paths of the data files of the table."""
+    ls = self.hdfs_client.list_dir(self.TABLE_DIR)
+    return ["%s/%s" % (self.TABLE_DIR, f['pathSuffix'])
+            for f in ls['FileStatuses']['FileStatus']
+            if f['type'] == 'FILE' and not f['pathSuffix'].startswith('.')]
@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+# Copyright (c) 2012 Cloudera, Inc. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Tests that the Parquet scanner returns the right rows when it materializes the columns
+# not referenced by the conjuncts late, skipping the values of the rejected rows across
+# page boundaries.
+
+import pytest
+from tests.common.impala_test_suite import ImpalaTestSuite
+from tests.util.parquet_util import *
+
+class TestParquetLateMaterialization(ImpalaTestSuite):
+  TEST_DB = "parquet_late_mat_test_db"
+  TABLE_DIR = "test-warehouse/%s.db/t" % TEST_DB
+  COLUMNS = "id bigint, n int, s string, d double, b boolean"
+
+  # Each column is written as several pages. n is dictionary encoded and b bit packed.
+  # id, s and d have too many distinct values for a dictionary and are mostly plain
+  # encoded. Every 10th n and every 7th s is NULL.
+  NUM_ROWS = 100000
+
+  # Selective predicates on one or two columns. Simple comparisons are evaluated over a
+  # batch of rows at a time, conjuncts that can't be vectorized, like LIKE, a row at a
+  # time.
+  PREDICATES = [
+      "n = 7",
+      "n = 7 and d < 20000",
+      "id % 9973 = 0",
+      "id % 30000 < 3",
+      "s like '%777'",
+      "b and n < 3",
+      "n is null and id % 101 = 0",
+      "s is null and n = 501",
+      "length(s) = 6 and n = 999"]
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestParquetLateMaterialization, cls).add_test_dimensions()
+    cls.TestMatrix.add_constraint(lambda v:\
+        v.get_value('table_format').file_format == 'parquet' and\
+        v.get_value('table_format').compression_codec == 'none')
+
+  def setup_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+    self.execute_query("create database %s" % self.TEST_DB)
+    # The same rows in a text table, which is scanned without late materialization.
+    for name, file_format in [('t', 'parquet'), ('t_text', 'textfile')]:
+      self.execute_query("create table %s.%s (%s) stored as %s"
+          % (self.TEST_DB, name, self.COLUMNS, file_format))
+      self.execute_query("insert into %s.%s "
+          "select id, if(id %% 10 = 0, null, cast(id %% 1000 as int)), "
+          "if(id %% 7 = 0, null, lpad(cast(id as string), 6, '0')), id / 2, "
+          "id %% 3 = 0 from ("
+          "  select a.id * 100 + b.id as id "
+          "  from functional.alltypes a cross join functional.alltypes b "
+          "  where a.id < 1000 and b.id < 100) v"
+          % (self.TEST_DB, name), {'num_nodes': 1})
+
+  def teardown_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+
+  @pytest.mark.execute_serially
+  def test_selective_predicates(self, vector):
+    # Make sure the skipped runs cross page boundaries.
+    files = self.__data_files()
+    assert len(files) == 1
+    data = self.hdfs_client.read_file(files[0])
+    row_groups = get_file_metadata(data).row_groups
+    assert len(row_groups) == 1
+    assert row_groups[0].num_rows == self.NUM_ROWS
+    for col in row_groups[0].columns:
+      assert len(get_data_page_headers(data, col)) > 1, col.meta_data.path_in_schema
+
+    for predicate in self.PREDICATES:
+      query = "select id, n, s, d, b from %s.%%s where %s" % (self.TEST_DB, predicate)
+      expected = self.execute_query(query % 't_text').data
+      result = self.execute_query(query % 't')
+      assert len(expected) > 0 and len(expected) < self.NUM_ROWS / 10, predicate
+      assert sorted(result.data) == sorted(expected), predicate
+
+  def __data_files(self):
+    """Returns the paths of the data files of the Parquet table."""
+    ls = self.hdfs_client.list_dir(self.TABLE_DIR)
+    return ["%s/%s" % (self.TABLE_DIR, f['pathSuffix'])
+            for f in ls['FileStatuses']['FileStatus']
+            if f['type'] == 'FILE' and not f['pathSuffix'].startswith('.')]
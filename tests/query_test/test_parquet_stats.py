@@ -0,0 +1,158 @@
+#!/usr/bin/env python
+# Copyright (c) 2012 Cloudera, Inc. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Tests the min/max statistics that the Parquet writer stores in the footer and in the
+# page headers, and the row groups and pages that the scanner skips with them.
+
+import pytest
+import re
+from tests.common.impala_test_suite import ImpalaTestSuite
+from tests.util.parquet_util import *
+
+class TestParquetStats(ImpalaTestSuite):
+  TEST_DB = "parquet_stats_test_db"
+  TABLE_DIR = "test-warehouse/%s.db/ids" % TEST_DB
+
+  # Each INSERT writes one file with one row group, holding the ids
+  # [i * ROWS_PER_FILE, (i + 1) * ROWS_PER_FILE) in order. There are more distinct ids
+  # than the writer puts in a dictionary, so they take several plain encoded pages.
+  NUM_FILES = 2
+  ROWS_PER_FILE = 100000
+
+  # The columns of the table, in file order, with the stats of file 'i' as
+  # (null count, min, max).
+  COLUMNS = [
+      ('id', 'bigint', lambda i, first, last: (0, first, last)),
+      ('n', 'int', lambda i, first, last: (TestParquetStats.ROWS_PER_FILE / 10, 1, 999)),
+      ('s', 'string', lambda i, first, last: (0, '%06d' % first, '%06d' % last)),
+      ('d', 'double', lambda i, first, last: (0, first / 2.0, last / 2.0))]
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestParquetStats, cls).add_test_dimensions()
+    cls.TestMatrix.add_constraint(lambda v:\
+        v.get_value('table_format').file_format == 'parquet' and\
+        v.get_value('table_format').compression_codec == 'none')
+
+  def setup_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+    self.execute_query("create database %s" % self.TEST_DB)
+    self.execute_query("create table %s.ids (id bigint, n int, s string, d double) "
+        "stored as parquet" % self.TEST_DB)
+    # functional.alltypes has the ids 0 to 7299, so each INSERT takes 1000 of them.
+    for i in range(self.NUM_FILES):
+      self.execute_query("insert into %s.ids "
+          "select id, if(id %% 10 = 0, null, cast(id %% 1000 as int)), "
+          "lpad(cast(id as string), 6, '0'), id / 2 from ("
+          "  select a.id * 100 + b.id as id "
+          "  from functional.alltypes a cross join functional.alltypes b "
+          "  where a.id >= %d and a.id < %d and b.id < 100) v "
+          "order by id limit %d"
+          % (self.TEST_DB, i * 1000, (i + 1) * 1000, self.ROWS_PER_FILE),
+          {'num_nodes': 1})
+
+  def teardown_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+
+  @pytest.mark.execute_serially
+  def test_skipping(self, vector):
+    self.run_test_case('QueryTest/parquet-stats', vector, use_db=self.TEST_DB)
+
+  @pytest.mark.execute_serially
+  def test_footer_and_page_stats(self, vector):
+    files = self.__data_files()
+    assert len(files) == self.NUM_FILES
+    for path in files:
+      data = self.hdfs_client.read_file(path)
+      row_groups = get_file_metadata(data).row_groups
+      assert len(row_groups) == 1
+      columns = row_groups[0].columns
+      assert len(columns) == len(self.COLUMNS)
+      first_id = self.__check_stats(columns[0], 'bigint')[0]
+      assert first_id % self.ROWS_PER_FILE == 0
+      file_idx = first_id / self.ROWS_PER_FILE
+      last_id = first_id + self.ROWS_PER_FILE - 1
+      for col, (name, col_type, expected) in zip(columns, self.COLUMNS):
+        null_count, min_value, max_value = expected(file_idx, first_id, last_id)
+        assert self.__check_stats(col, col_type) == (min_value, max_value), name
+        assert col.meta_data.statistics.null_count == null_count, name
+
+        # The pages' stats add up to the column chunk's.
+        headers = get_data_page_headers(data, col)
+        page_stats = [h.data_page_header.statistics for h in headers]
+        assert sum(s.null_count for s in page_stats) == null_count, name
+        assert min(decode_stats_value(s.min_value, col_type) for s in page_stats) ==\
+            min_value, name
+        assert max(decode_stats_value(s.max_value, col_type) for s in page_stats) ==\
+            max_value, name
+        for s in page_stats:
+          assert s.min is None and s.max is None, name
+
+      # The ids are ordered, so their pages cover consecutive ranges. Rows at either end
+      # of a page are returned, even though the other pages are skipped.
+      headers = get_data_page_headers(data, columns[0])
+      assert len(headers) > 1
+      next_id = first_id
+      for header in headers:
+        stats = header.data_page_header.statistics
+        page_min = decode_stats_value(stats.min_value, 'bigint')
+        page_max = decode_stats_value(stats.max_value, 'bigint')
+        assert page_min == next_id
+        assert page_max - page_min + 1 == header.data_page_header.num_values
+        next_id = page_max + 1
+      for header in [headers[0], headers[-1]]:
+        stats = header.data_page_header.statistics
+        page_min = decode_stats_value(stats.min_value, 'bigint')
+        page_max = decode_stats_value(stats.max_value, 'bigint')
+        for value in [page_min, page_max]:
+          result = self.execute_query(
+              "select id from %s.ids where id = %d" % (self.TEST_DB, value))
+          assert result.data == [str(value)]
+          assert self.__counter(result.runtime_profile, 'NumPagesSkipped') > 0
+        result = self.execute_query("select count(*) from %s.ids where id >= %d and "
+            "id <= %d" % (self.TEST_DB, page_min, page_max))
+        assert result.data == [str(header.data_page_header.num_values)]
+
+  def __check_stats(self, column_chunk, col_type):
+    """Returns the decoded (min_value, max_value) of 'column_chunk', after checking that
+    the deprecated min and max are not set."""
+    stats = column_chunk.meta_data.statistics
+    assert stats is not None
+    assert stats.min is None and stats.max is None
+    return (decode_stats_value(stats.min_value, col_type),
+            decode_stats_value(stats.max_value, col_type))
+
+  def __data_files(self):
+    """Returns the paths of the data files of the table."""
+    ls = self.hdfs_client.list_dir(self.TABLE_DIR)
+    return ["%s/%s" % (self.TABLE_DIR, f['pathSuffix'])
+            for f in ls['FileStatuses']['FileStatus']
+            if f['type'] == 'FILE' and not f['pathSuffix'].startswith('.')]
+
+  def __counter(self, profile, name):
+    """Returns the sum of the counter 'name' over the fragment instances in 'profile'.
+    The averaged fragment's counters are skipped."""
+    total = 0
+    in_averaged = False
+    for line in profile.split('\n'):
+      if 'Averaged Fragment' in line: in_averaged = True
+      elif re.match(r'\s*Fragment ', line): in_averaged = False
+      match = re.search(r' %s: (\d+)' % name, line)
+      if match and not in_averaged: total += int(match.group(1))
+    return total
@@ -71,6 +71,9 @@ class TestQueries(ImpalaTestSuite):
     # QueryTest/top-n is also run in test_sort with disable_outermost_topn = 1
     self.run_test_case('QueryTest/top-n', vector)
 
+  def test_knn(self, vector):
+    self.run_test_case('QueryTest/knn', vector)
+
   def test_union(self, vector):
     self.run_test_case('QueryTest/union', vector)
 
@@ -0,0 +1,104 @@
+#!/usr/bin/env python
+# Copyright (c) 2012 Cloudera, Inc. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Tests scan range pruning with the spatial index sidecars written by INSERT.
+
+import re
+import time
+import pytest
+from tests.common.impala_test_suite import ImpalaTestSuite
+
+class TestSpatialIndex(ImpalaTestSuite):
+  TEST_DB = "spatial_index_test_db"
+  TABLE_DIR = "test-warehouse/%s.db/points" % TEST_DB
+
+  # Each INSERT writes one file, into partition p=<offset>, whose points lie in a 10x10
+  # square at (offset, offset).
+  OFFSETS = [0, 100, 200]
+  WINDOW_QUERY = ("select count(*) from %s.points "
+                  "where x between 100 and 110 and y between 100 and 110" % TEST_DB)
+
+  @classmethod
+  def get_workload(self):
+    return 'functional-query'
+
+  @classmethod
+  def add_test_dimensions(cls):
+    super(TestSpatialIndex, cls).add_test_dimensions()
+    cls.TestMatrix.add_constraint(lambda v:\
+        v.get_value('table_format').file_format == 'parquet' and\
+        v.get_value('table_format').compression_codec == 'none')
+
+  def setup_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+    self.execute_query("create database %s" % self.TEST_DB)
+    self.execute_query("create table %s.points (x double, y double) "
+        "partitioned by (p int) stored as parquet "
+        "tblproperties ('impala.spatial.index.columns'='x,y')" % self.TEST_DB)
+    for offset in self.OFFSETS:
+      self.execute_query("insert into %s.points partition (p=%d) "
+          "select %d + int_col, %d + int_col from functional.alltypestiny"
+          % (self.TEST_DB, offset, offset, offset), {'num_nodes': 1})
+
+  def teardown_method(self, method):
+    self.cleanup_db(self.TEST_DB)
+
+  @pytest.mark.execute_serially
+  def test_prune_and_stale_index(self, vector):
+    files = dict((offset, self.__data_file(offset)) for offset in self.OFFSETS)
+    for path in files.values():
+      dir, name = path.rsplit('/', 1)
+      assert self.hdfs_client.exists("%s/.%s.mbr" % (dir, name))
+
+    # Only the file of p=100 overlaps the window.
+    result = self.execute_query(self.WINDOW_QUERY, {'num_nodes': 1})
+    assert result.data == ['8']
+    assert self.__counter(result.runtime_profile, 'RangesPrunedBySpatialIndex') == 2
+    assert self.__counter(result.runtime_profile, 'StaleSpatialIndexes') == 0
+
+    # Replace the file of p=0 with a copy of the file of p=100, keeping its old
+    # sidecar. The copy's rows must be returned even though the stale sidecar says
+    # they are outside the window. Sidecars record the modification time in seconds,
+    # so make sure it changes.
+    data = self.hdfs_client.read_file(files[100])
+    time.sleep(2)
+    self.hdfs_client.create_file(files[0], data, overwrite=True)
+    self.execute_query("refresh %s.points" % self.TEST_DB)
+
+    result = self.execute_query(self.WINDOW_QUERY, {'num_nodes': 1})
+    assert result.data == ['16']
+    assert self.__counter(result.runtime_profile, 'RangesPrunedBySpatialIndex') == 1
+    assert self.__counter(result.runtime_profile, 'StaleSpatialIndexes') == 1
+
+  def __data_file(self, offset):
+    """Returns the path of the only data file of partition p='offset'."""
+    dir = "%s/p=%d" % (self.TABLE_DIR, offset)
+    ls = self.hdfs_client.list_dir(dir)
+    names = [f['pathSuffix'] for f in ls['FileStatuses']['FileStatus']
+             if f['type'] == 'FILE' and not f['pathSuffix'].startswith('.')]
+    assert len(names) == 1
+    return "%s/%s" % (dir, names[0])
+
+  def __counter(self, profile, name):
+    """Returns the sum of the counter 'name' over the fragment instances in 'profile'.
+    The averaged fragment's counters are skipped."""
+    total = 0
+    in_averaged = False
+    for line in profile.split('\n'):
+      if 'Averaged Fragment' in line: in_averaged = True
+      elif re.match(r'\s*Fragment ', line): in_averaged = False
+      match = re.search(r' %s: (\d+)' % name, line)
+      if match and not in_averaged: total += int(match.group(1))
+    return total
@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+# Copyright (c) 2012 Cloudera, Inc. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Utilities to read the metadata of Parquet files
+
+import struct
+from parquet.ttypes import Encoding, FileMetaData, PageHeader, PageType
+from thrift.protocol import TCompactProtocol
+from thrift.transport import TTransport
+
+PARQUET_MAGIC = 'PAR1'
+
+# struct formats of the PLAIN encoded values of fixed size Impala types. TINYINT and
+# SMALLINT are stored as INT32.
+PLAIN_FORMATS = {'tinyint': '<i', 'smallint': '<i', 'int': '<i', 'bigint': '<q',
+                 'float': '<f', 'double': '<d'}
+
+def read_thrift(data, offset, thrift_obj):
+  """Deserializes 'thrift_obj' from 'data', a string, at 'offset' with the compact
+  protocol. Returns the offset of the first byte after it."""
+  transport = TTransport.TMemoryBuffer(data[offset:])
+  thrift_obj.read(TCompactProtocol.TCompactProtocol(transport))
+  return offset + transport._buffer.tell()
+
+def get_file_metadata(data):
+  """Returns the FileMetaData in the footer of 'data', the contents of a Parquet file."""
+  assert data[:4] == PARQUET_MAGIC and data[-4:] == PARQUET_MAGIC
+  footer_len = struct.unpack('<i', data[-8:-4])[0]
+  metadata = FileMetaData()
+  read_thrift(data, len(data) - 8 - footer_len, metadata)
+  return metadata
+
+def get_data_page_headers(data, column_chunk):
+  """Returns the PageHeaders of the data pages of 'column_chunk', a ColumnChunk of the
+  Parquet file contents 'data', in file order."""
+  meta_data = column_chunk.meta_data
+  offset = meta_data.data_page_offset
+  num_values = 0
+  headers = []
+  while num_values < meta_data.num_values:
+    header = PageHeader()
+    offset = read_thrift(data, offset, header) + header.compressed_page_size
+    assert header.type == PageType.DATA_PAGE
+    num_values += header.data_page_header.num_values
+    headers.append(header)
+  assert num_values == meta_data.num_values
+  return headers
+
+def decode_stats_value(value, column_type):
+  """Decodes 'value', a min_value or max_value of a column of 'column_type', the name
+  of an Impala type."""
+  if column_type in ('string', 'varchar'): return value
+  return struct.unpack(PLAIN_FORMATS[column_type], value)[0]